@@ -50,6 +50,7 @@ App::App( AppDesc appDesc )
     gameRunnerDesc.Game   = m_game.get( );
 
 #ifdef DZ_RUN_MODE_EDITOR
+    gameRunnerDesc.HotReload = true;
     m_gameRunner = std::make_unique<EditorGameRunner>( gameRunnerDesc );
 #else
     m_gameRunner = std::make_unique<GameRunner>( gameRunnerDesc );
@@ -20,6 +20,7 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 #include <spdlog/spdlog.h>
 #include "DZEngine/Assets/MaterialBatch.h"
 #include "DZEngine/Components/CameraComponent.h"
+#include "DZEngine/Components/Graphics/LightComponent.h"
 #include "DZEngine/Components/Graphics/MaterialComponent.h"
 #include "DZEngine/Components/Graphics/MeshComponent.h"
 #include "DZEngine/Components/Graphics/RenderableComponent.h"
@@ -182,6 +183,26 @@ void SceneViewRenderer::CreateScene( ) const
 
     auto &greenBoxRenderable   = greenBox.get_mut<RenderableComponent>( );
     greenBoxRenderable.Visible = true;
+
+    const auto sun = m_ecsWorld->entity( "Sun" );
+    sun.add<TransformComponent>( );
+    sun.add<DirectionalLightComponent>( );
+
+    // Rotates +Z onto normalize( -1, -1, -1 )
+    auto &sunTransform    = sun.get_mut<TransformComponent>( );
+    sunTransform.Rotation = { 0.62796f, -0.62796f, 0.0f, 0.45970f };
+
+    const auto pointLight = m_ecsWorld->entity( "PointLight" );
+    pointLight.add<TransformComponent>( );
+    pointLight.add<PointLightComponent>( );
+
+    auto &pointLightTransform    = pointLight.get_mut<TransformComponent>( );
+    pointLightTransform.Position = { 0.0f, 1.0f, -2.0f };
+
+    auto &pointLightComponent     = pointLight.get_mut<PointLightComponent>( );
+    pointLightComponent.Color     = { 1.0f, 0.8f, 0.6f };
+    pointLightComponent.Intensity = 4.0f;
+    pointLightComponent.Range     = 6.0f;
 }
 
 void SceneViewRenderer::CreateRenderTargets( )
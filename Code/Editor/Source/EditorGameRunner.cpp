@@ -56,6 +56,9 @@ void EditorGameRunner::Update( )
     {
         return;
     }
+    m_assetBatcher->UpdateResidency( );
+    UpdateHotReload( );
+    m_assetLoader->Update( );
     m_world->Progress( );
     const GameRenderView gameRenderView = m_editor->GetGameRenderView( frameState.FrameIndex );
 
@@ -18,11 +18,16 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 
 #pragma once
 
+#include <taskflow/taskflow.hpp>
 #include "Assets/AssetBatcher.h"
+#include "Assets/AssetHotReload.h"
+#include "Assets/AssetLoader.h"
 #include "Assets/AssetBundle.h"
+#include "Assets/AssetReferenceSystem.h"
 #include "Assets/AssetRegistry.h"
 #include "IGame.h"
 #include "Rendering/RenderLoop.h"
+#include "Rendering/ShaderHotReload.h"
 
 namespace DZEngine
 {
@@ -30,6 +35,7 @@ namespace DZEngine
     {
         Window *Window;
         IGame  *Game;
+        bool    HotReload = false; // Watches Assets and _Assets, reloads the changed assets and rebuilds the shaders that include a changed file
     };
 
     // Abstract game runner since context initialization is mostly common
@@ -45,6 +51,14 @@ namespace DZEngine
         std::unique_ptr<AssetBatcher>  m_assetBatcher;
         std::unique_ptr<AppContext>    m_appContext;
         std::unique_ptr<World>         m_world;
+        std::unique_ptr<tf::Executor>  m_executor;
+        std::unique_ptr<IFileIO>       m_fileIO; // Loose asset reads of m_assetBundle
+        std::unique_ptr<AssetLoader>   m_assetLoader; // Declared after the executor and the batcher, its destructor waits for its tasks
+
+        std::unique_ptr<IFileWatcher>    m_fileWatcher; // Null unless GameRunnerDesc::HotReload is set
+        std::unique_ptr<AssetHotReload>  m_assetHotReload;
+        std::unique_ptr<ShaderHotReload> m_shaderHotReload;
+        std::vector<FileChange>          m_fileChanges;
 
     public:
         explicit AGameRunner( const GameRunnerDesc &desc );
@@ -52,5 +66,8 @@ namespace DZEngine
         virtual ~AGameRunner( )                        = default;
         virtual void HandleEvent( const Event &event ) = 0;
         virtual void Update( )                         = 0;
+
+    protected:
+        void UpdateHotReload( ); // Call before AssetLoader::Update, which swaps the reloaded assets in
     };
 } // namespace DZEngine
@@ -19,9 +19,17 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 #pragma once
 
 #include "DZEngine/Assets/AssetBatcher.h"
+#include "DZEngine/Assets/AssetLoader.h"
+#include "DZEngine/Assets/AssetRegistry.h"
 #include "Rendering/GraphicsContext.h"
+#include "Rendering/ShaderHotReload.h"
 #include "Scene/World.h"
 
+namespace tf
+{
+    class Executor;
+}
+
 namespace DZEngine
 {
     struct AppContext
@@ -30,5 +38,9 @@ namespace DZEngine
         GraphicsContext *GraphicsContext;
         World           *World;
         AssetBatcher    *AssetBatcher;
+        AssetLoader     *AssetLoader; // Asynchronous loads into AssetBatcher, updated by the runner every frame
+        AssetRegistry   *AssetRegistry; // Uris of the handles stored by scenes, see SceneLoadDesc
+        tf::Executor    *Executor; // Shared worker pool for engine side parallel work
+        ShaderHotReload *ShaderHotReload = nullptr; // Set when GameRunnerDesc::HotReload is, renderers register their programs with it
     };
 } // namespace DZEngine
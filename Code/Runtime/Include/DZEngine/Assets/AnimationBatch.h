@@ -21,6 +21,9 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 #include <DenOfIzGraphics/DenOfIzGraphics.h>
 #include "AnimationAssetData.h"
 #include "DZEngine/Components/AssetHandle.h"
+#include "SlotMap.h"
+
+#include <shared_mutex>
 
 namespace DZEngine
 {
@@ -34,12 +37,10 @@ namespace DZEngine
         ILogicalDevice                    *m_logicalDevice;
         std::unique_ptr<BatchResourceCopy> m_batchResourceCopy;
 
-        std::vector<std::unique_ptr<AnimationAssetData>>     m_animationData;
+        mutable std::shared_mutex                            m_animationLock;
+        SlotMap<std::unique_ptr<AnimationAssetData>>         m_animationData;
         std::unordered_map<std::string, AnimationClipHandle> m_animAliases;
 
-        std::mutex m_nextAnimHandleLock;
-        size_t     m_nextAnimHandle = 0;
-
     public:
         explicit AnimationBatch( const AnimationBatchDesc &desc );
         ~AnimationBatch( ) = default;
@@ -49,11 +50,11 @@ namespace DZEngine
 
         AnimationClipHandle LoadAnimation( const std::string &alias, BinaryReader &reader );
         AnimationClipHandle AddAnimation( const std::string &alias, const AnimationAssetData &animationData );
+        bool                RemoveAnimation( AnimationClipHandle handle ); // No in flight frame may still use what is removed, its handles stop resolving
+        // Swaps the contents so target resolves to what was added as replacement, pointers stay valid and aliases of replacement move to target
+        bool                ReplaceAnimation( AnimationClipHandle target, AnimationClipHandle replacement );
 
         AnimationAssetData *GetAnimation( const std::string &alias );
         AnimationAssetData *GetAnimation( AnimationClipHandle handle ) const;
-
-    private:
-        size_t NextAnimationHandle( const std::string &alias );
     };
 } // namespace DZEngine
@@ -17,8 +17,10 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 */
 
 #pragma once
+#include <deque>
 #include "AnimationBatch.h"
 #include "AssetBundle.h"
+#include "AssetCache.h"
 #include "AssetRegistry.h"
 #include "DZEngine/Rendering/GraphicsContext.h"
 #include "MaterialBatch.h"
@@ -40,6 +42,7 @@ namespace DZEngine
         GraphicsContext *GraphicsContext;
         AssetBundle     *AssetBundle;
         AssetRegistry   *AssetRegistry;
+        size_t           GeometryPageBytes = 4194304; // Growth granularity of the geometry pools shared by the batches
     };
 
     class AssetBatcher
@@ -50,34 +53,81 @@ namespace DZEngine
             std::unique_ptr<MaterialBatch>  MaterialBatch;
             std::unique_ptr<AnimationBatch> AnimationBatch;
             std::unique_ptr<SkeletonBatch>  SkeletonBatch;
+
+            std::vector<std::unique_ptr<ISemaphore>> UpdateSemaphores; // Signaled by the lists of SubmitBatchUpdate
+        };
+
+        struct RetiredAsset
+        {
+            AssetCacheKey Key;
+            uint64_t      Frame; // Of the UpdateResidency that evicted or replaced it
+        };
+
+        // Geometry as of an UpdateResidency, what it replaced is released NumFramesInFlight calls later
+        struct GeometrySnapshot
+        {
+            uint64_t              Frame = 0;
+            std::vector<uint32_t> DefragmentVersions{ }; // Per batch, see MeshBatch::GetDefragmentVersion
+            std::vector<uint32_t> PoolVersions{ };       // Per geometry pool, see GeometryPool::GetVersion
         };
 
-        GraphicsContext *m_graphicsContext;
-        AssetBundle     *m_assetBundle;
-        AssetRegistry   *m_assetRegistry;
+        GraphicsContext            *m_graphicsContext;
+        AssetBundle                *m_assetBundle;
+        AssetRegistry              *m_assetRegistry;
+        size_t                      m_geometryPageBytes;
+        std::unique_ptr<AssetCache> m_assetCache;
 
-        std::mutex                               m_addBatchMutex;
+        std::mutex                                 m_addBatchMutex;
+        std::vector<std::unique_ptr<GeometryPool>> m_geometryPools; // One per layout and vertex format, declared first to outlive the batches
         std::vector<std::unique_ptr<AssetBatch>> m_batches;
         std::unordered_map<std::string, size_t>  m_batchAliases;
 
+        uint64_t                     m_frame = 0;
+        std::deque<RetiredAsset>     m_retiredAssets;
+        std::deque<GeometrySnapshot> m_geometrySnapshots;
+
     public:
         explicit AssetBatcher( const AssetBatcherDesc &desc );
         ~AssetBatcher( ) = default;
 
-        size_t AddBatch( const std::string &alias, GeometryLayout layout = GeometryLayout::GPUDriven );
+        size_t AddBatch( const std::string &alias, GeometryLayout layout = GeometryLayout::GPUDriven, VertexFormat vertexFormat = VertexFormat::Full );
+        // LogicalDevice and Pool are filled in, the reservation fields are honoured
+        size_t AddBatch( const std::string &alias, MeshBatchDesc meshBatchDesc );
         size_t NumBatches( ) const;
+        // Destroys every geometry buffer replaced by pool growth right away, the device has to be idle. UpdateResidency releases them once
+        // the frames in flight are done with them.
+        void ReleaseRetiredGeometry( ) const;
+        // Call once per frame after the fence of the frame about to be recorded was waited on. Unloads the assets Cache( ) evicts, they are
+        // unregistered right away and destroyed NumFramesInFlight calls later, once no frame that was in flight when they were evicted uses them.
+        // The source ranges of committed defragments and the geometry buffers replaced by pool growth are released the same way.
+        void UpdateResidency( );
+        void ReleaseRetiredAssets( ); // Destroys the evicted assets and the retired geometry right away, the device has to be idle
+        // Reloads target in place: its handle resolves to the asset added as replacementId from now on, which takes the previous contents
+        // and is destroyed like an evicted asset. Call at the frame boundary, the replacement mustn't be registered or cached.
+        bool ReplaceAsset( const AssetCacheKey &target, uint32_t replacementId );
+        // Drops the reference a uri overload took, returns the remaining references. UpdateResidency unloads the asset once it's evicted.
+        uint32_t ReleaseAsset( const AssetCacheKey &key ) const;
 
         void BeginBatchUpdate( size_t batchId = 0 ) const;
         void EndBatchUpdate( size_t batchId = 0 ) const;
-
-        void       AddMesh( BinaryReader &reader, const std::vector<std::string> &submeshAliases = { } ) const;
+        // Non blocking EndBatchUpdate, what was added may only be used and the next update begun once PollBatchUpdate returns true
+        void SubmitBatchUpdate( size_t batchId ) const;
+        bool PollBatchUpdate( size_t batchId ) const;
+        // Begins an update that moves up to maxBytesToMove bytes of the batch's meshes into the holes of its pool and submits it like
+        // SubmitBatchUpdate, PollBatchUpdate commits it. Returns false without an update when MeshBatch::NeedsDefragment is false.
+        bool DefragmentGeometry( size_t batchId, size_t maxBytesToMove ) const;
+
+        MeshHandle AddMesh( BinaryReader &reader, const std::vector<std::string> &submeshAliases = { } ) const;
         void       AddGeometry( const GeometryData *data, const std::string &alias ) const;
-        void       AddMesh( size_t batchId, BinaryReader &reader, const std::vector<std::string> &submeshAliases = { } ) const;
+        MeshHandle AddMesh( size_t batchId, BinaryReader &reader, const std::vector<std::string> &submeshAliases = { } ) const;
+        // The uri overloads load an asset once per batch, later calls return the same handle with one more reference in Cache( ). Each call
+        // is paired with a ReleaseAsset, the asset is unloaded once the cache evicts it.
         MeshHandle AddMesh( size_t batchId, const std::string &uri, const std::vector<std::string> &submeshAliases = { } ) const;
         void       AddGeometry( size_t batchId, const GeometryData *data, const std::string &alias ) const;
 
         TextureHandle  LoadTexture( const std::string &alias, const std::string &uri ) const;
         TextureHandle  LoadTexture( size_t batchId, const std::string &alias, const std::string &uri ) const;
+        TextureHandle  LoadTexture( size_t batchId, const std::string &alias, BinaryReader &reader ) const;
         TextureHandle  AddTexture( const std::string &alias, ITextureResource *texture ) const;
         TextureHandle  AddTexture( size_t batchId, const std::string &alias, ITextureResource *texture ) const;
         MaterialHandle AddMaterial( const std::string &alias, const MaterialDataRequest &material ) const;
@@ -85,13 +135,20 @@ namespace DZEngine
 
         AnimationClipHandle AddAnimation( size_t batchId, const std::string &uri, const std::string &alias ) const;
         AnimationClipHandle AddAnimation( const std::string &uri, const std::string &alias ) const;
+        AnimationClipHandle AddAnimation( size_t batchId, const std::string &alias, const AnimationAssetData &animationData ) const;
 
         SkeletonHandle AddSkeleton( size_t batchId, const std::string &uri, const std::string &alias ) const;
         SkeletonHandle AddSkeleton( const std::string &uri, const std::string &alias ) const;
+        SkeletonHandle AddSkeleton( size_t batchId, const std::string &alias, const SkeletonAssetData &skeletonData ) const;
 
         MeshBatch const      *Mesh( size_t batchId = 0 ) const;
         MaterialBatch const  *Material( size_t batchId = 0 ) const;
         AnimationBatch const *Animation( size_t batchId = 0 ) const;
         SkeletonBatch const  *Skeleton( size_t batchId = 0 ) const;
+        AssetCache           *Cache( ) const;
+
+    private:
+        GeometryPool *GetGeometryPool( const MeshBatchDesc &meshBatchDesc );
+        void          UnloadAsset( const AssetCacheKey &key ) const;
     };
 } // namespace DZEngine
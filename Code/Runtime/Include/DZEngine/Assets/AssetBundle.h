@@ -21,7 +21,11 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 #include <DenOfIzGraphics/Assets/Stream/BinaryReader.h>
 #include <filesystem>
 #include <memory>
+#include <span>
 #include <string>
+#include <vector>
+#include "AssetPack.h"
+#include "FileIO.h"
 
 using namespace DenOfIz;
 
@@ -36,28 +40,50 @@ namespace DZEngine
         ReadError
     };
 
+    struct AssetRead
+    {
+        std::string Uri;
+        Byte       *Dst       = nullptr;
+        size_t      NumBytes  = 0; // Must equal GetAssetNumBytes( Uri )
+        bool        Succeeded = false;
+    };
+
     /**
      * AssetBundle handles URI-based asset loading with support for:
      * - assets://relative/path/to/asset.ext (loads from assets directory)
-     * - assets://bundle/path/to/asset.ext (loads from bundle file - TODO)
+     * - the same uris from mounted packs, see AssetPack::Build
      *
-     * Currently only implements file-based loading. Bundle support is reserved for future implementation.
+     * Packed assets may be block compressed, LoadAsset decompresses them into memory owned by the reader and ReadAsset straight into the destination.
+ * Loose files are read through the IFileIO given to SetFileIO, ReadAssets submits all of its loose reads as one batch.
+ * Mounted packs are searched first, the most recently mounted one wins, then the loose files of the assets directory.
+     * Rebuild or unmount the pack to iterate on loose files that are also packed.
      */
     class AssetBundle
     {
-        std::filesystem::path m_assetsDirectory;
+        std::filesystem::path                   m_assetsDirectory;
+        std::vector<std::unique_ptr<AssetPack>> m_packs;
+        IFileIO                                *m_fileIO = nullptr;
 
     public:
         explicit AssetBundle( const std::filesystem::path &assetsDir );
 
-        std::unique_ptr<BinaryReader> LoadAsset( const std::string &uri ) const;
-        bool                          AssetExists( const std::string &uri ) const;
-        AssetLoadResult               ResolveUri( const std::string &uri, std::filesystem::path &outPath ) const;
+        bool MountPack( const std::filesystem::path &packPath, tf::Executor *executor = nullptr ); // Decompresses the assets of the pack
+        void UnmountPacks( );
+        void SetFileIO( IFileIO *fileIO ); // Blocking reads on the calling thread when null
+
+        AssetReader     LoadAsset( const std::string &uri ) const;
+        bool            ReadAsset( const std::string &uri, Byte *dst, size_t dstNumBytes ) const; // Reads or decompresses straight into dst
+        void            ReadAssets( std::span<AssetRead> reads ) const;                          // Returns once every read completed
+        bool            AssetExists( const std::string &uri ) const;
+        bool            IsPacked( const std::string &uri ) const; // LoadAsset of a packed asset reads the mapped pack instead of a file
+        size_t          GetAssetNumBytes( const std::string &uri ) const; // 0 when the asset doesn't exist
+        AssetLoadResult ResolveUri( const std::string &uri, std::filesystem::path &outPath ) const; // Loose file path only
 
         const std::filesystem::path &GetAssetsDirectory( ) const;
 
     private:
-        bool        IsValidAssetUri( const std::string &uri ) const;
-        std::string ExtractPathFromUri( const std::string &uri ) const;
+        bool             IsValidAssetUri( const std::string &uri ) const;
+        std::string      ExtractPathFromUri( const std::string &uri ) const;
+        const AssetPack *FindPack( const std::string &path ) const;
     };
 } // namespace DZEngine
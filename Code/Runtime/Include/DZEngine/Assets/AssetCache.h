@@ -0,0 +1,136 @@
+/*
+Den Of Iz - Game/Game Engine
+Copyright (c) 2020-2024 Muhammed Murat Cengiz
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <array>
+#include <condition_variable>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "AssetRegistry.h"
+
+namespace DZEngine
+{
+    enum class AssetCacheState
+    {
+        Loading,
+        Ready,
+        Failed
+    };
+
+    struct AssetCacheKey
+    {
+        AssetRegistryType Type;
+        size_t            BatchId;
+        uint32_t          Id;
+
+        bool operator==( const AssetCacheKey &other ) const = default;
+    };
+
+    struct AssetCacheStats
+    {
+        size_t Budget;               // Referenced assets are never evicted, the resident bytes may exceed it
+        size_t NumResidentBytes;     // Of the ready assets
+        size_t NumUnreferencedBytes; // Evictable, least recently released first
+        size_t NumAssets;
+        size_t NumUnreferenced;
+        size_t NumEvicted;
+    };
+
+    /// Loaded assets by uri and batch with the number of references to each, so an asset is loaded once however many times it is requested.
+    /// Acquire collapses concurrent loads of a uri: the first caller loads the asset and publishes its handle, the others wait for it and share it.
+    /// A failed load isn't cached, the next Acquire tries again. Thread safe.
+    ///
+    /// Assets without references stay cached in a least recently released order per type until Evict finds their type over its budget.
+    /// Budgets are in resident bytes of the type and default to 0, unreferenced assets are then evicted by the next Evict. An evicted asset releases the references it held to its
+    /// dependencies, types are evicted in AssetRegistryType order so materials released by an evicted mesh are evicted by the same call.
+    /// The cache only decides what to unload, AssetBatcher::UpdateResidency destroys the evicted assets.
+    class AssetCache
+    {
+        struct Entry
+        {
+            AssetRegistryType                  Type          = AssetRegistryType::Count;
+            size_t                             BatchId       = 0;
+            uint32_t                           Id            = UINT32_MAX;
+            uint32_t                           NumReferences = 0;
+            AssetCacheState                    State         = AssetCacheState::Loading;
+            size_t                             NumBytes      = 0;
+            std::vector<AssetCacheKey>         Dependencies{ }; // References held by the asset, released once it's evicted
+            bool                               Unreferenced = false;
+            std::list<AssetCacheKey>::iterator LruPosition{ };
+        };
+
+        struct KeyHash
+        {
+            size_t operator( )( const AssetCacheKey &key ) const;
+        };
+
+        struct Category
+        {
+            size_t                   Budget               = 0;
+            size_t                   NumResidentBytes     = 0;
+            size_t                   NumUnreferencedBytes = 0;
+            size_t                   NumAssets            = 0;
+            size_t                   NumEvicted           = 0;
+            std::list<AssetCacheKey> Unreferenced; // Least recently released first
+        };
+
+        mutable std::mutex                                                    m_lock;
+        std::condition_variable                                               m_published;
+        std::unordered_map<std::string, std::vector<Entry>>                   m_entries; // By uri, one per type and batch
+        std::unordered_map<AssetCacheKey, std::string, KeyHash>               m_uris;
+        std::array<Category, static_cast<size_t>( AssetRegistryType::Count )> m_categories;
+
+    public:
+        // True when the caller has to load the asset and Publish it, otherwise outId is the shared handle, invalid when its load failed
+        bool Acquire( AssetRegistryType type, size_t batchId, const std::string &uri, uint32_t &outId );
+        // Only succeeds for an asset that finished loading, never waits
+        bool TryAcquire( AssetRegistryType type, size_t batchId, const std::string &uri, uint32_t &outId );
+        // Ends the load handed out by Acquire, UINT32_MAX when it failed. numBytes is what the asset counts against the budget of its type.
+        void Publish( AssetRegistryType type, size_t batchId, const std::string &uri, uint32_t id, size_t numBytes = 0 );
+        // An asset loaded without Acquire, e.g. by AssetLoader
+        void     Add( AssetRegistryType type, size_t batchId, const std::string &uri, uint32_t id, uint32_t numReferences, size_t numBytes = 0 );
+        uint32_t Retain( AssetRegistryType type, size_t batchId, uint32_t id );  // Returns the references, 0 when the asset isn't cached
+        uint32_t Release( AssetRegistryType type, size_t batchId, uint32_t id ); // Returns the remaining references
+        // Hands the references to the dependencies of an asset over to it. Returns false when it already has dependencies or isn't cached,
+        // the caller keeps the references then.
+        bool SetDependencies( AssetRegistryType type, size_t batchId, uint32_t id, std::vector<AssetCacheKey> dependencies );
+        // The asset was reloaded in place keeping its handle. Takes over the references to the new dependencies and releases the old ones.
+        bool Reload( AssetRegistryType type, size_t batchId, uint32_t id, size_t numBytes, std::vector<AssetCacheKey> dependencies );
+
+        void SetBudget( AssetRegistryType type, size_t numBytes );
+        // Removes the least recently released assets of each type over its budget, appends them to outEvicted
+        void Evict( std::vector<AssetCacheKey> &outEvicted );
+
+        [[nodiscard]] uint32_t GetNumReferences( AssetRegistryType type, size_t batchId, uint32_t id ) const;
+        // Global lookup, the first batch the asset is loaded into
+        [[nodiscard]] bool            FindAny( AssetRegistryType type, const std::string &uri, size_t &outBatchId, uint32_t &outId ) const;
+        [[nodiscard]] size_t          GetNumEntries( ) const;
+        [[nodiscard]] AssetCacheStats GetStats( AssetRegistryType type ) const;
+
+    private:
+        static Entry *FindEntry( std::vector<Entry> &entries, AssetRegistryType type, size_t batchId );
+        Entry        *FindEntry( const AssetCacheKey &key );                                            // Requires m_lock
+        void          SetReady( Entry &entry, const std::string &uri, uint32_t id, size_t numBytes );   // Requires m_lock
+        void          UpdateResidency( Entry &entry );                                                  // Requires m_lock, after the state or references changed
+        void          ReleaseLocked( const AssetCacheKey &key );                                        // Requires m_lock
+    };
+} // namespace DZEngine
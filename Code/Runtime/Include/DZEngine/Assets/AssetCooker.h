@@ -0,0 +1,157 @@
+/*
+Den Of Iz - Game/Game Engine
+Copyright (c) 2020-2024 Muhammed Murat Cengiz
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <filesystem>
+#include <map>
+#include <optional>
+#include <string>
+#include <vector>
+#include "AssetRegistry.h"
+#include "DerivedDataCache.h"
+#include "MeshAssetProcessor.h"
+
+namespace tf
+{
+    class Executor;
+}
+
+namespace DZEngine
+{
+    struct AssetCookerDesc
+    {
+        std::filesystem::path SourceDirectory;
+        std::filesystem::path OutputDirectory;          // Mirrors the source tree and holds the cook database and the registry of the cooked assets
+        tf::Executor         *Executor       = nullptr; // Sources are cooked one after the other without it
+        DerivedDataCache     *Cache          = nullptr; // Optional, outputs of sources cooked before, on any machine sharing the cache, are copied instead
+        size_t                BatchId        = 0;       // Of the cooked assets in the registry
+        bool                  Force          = false;   // Cook every source, ignoring the cook database
+        bool                  OptimizeMeshes = true;    // Vertex cache, overdraw and vertex fetch order of every cooked mesh, see MeshAssetProcessor
+        MeshLODChainDesc      LODs;                     // Levels of detail appended to every cooked mesh
+    };
+
+    enum class AssetCookStatus
+    {
+        UpToDate,
+        Cooked,
+        CacheHit,
+        Failed
+    };
+
+    struct AssetCookResult
+    {
+        std::string              Path; // Relative to the source directory with forward slashes
+        AssetCookStatus          Status  = AssetCookStatus::Failed;
+        double                   Seconds = 0.0;
+        std::vector<std::string> Outputs; // Relative to the output directory with forward slashes
+    };
+
+    struct AssetCookStats
+    {
+        size_t NumSources;
+        size_t NumCooked;
+        size_t NumCacheHits;
+        size_t NumUpToDate;
+        size_t NumFailed;
+        size_t NumRemoved; // Sources deleted since the last cook, their outputs are removed too
+        double Seconds;
+    };
+
+    /// Offline conversion of the source assets of a tree, models through AssimpImporter and images through TextureImporter, into engine assets.
+    /// Every source and the files it references (glTF buffers and images, OBJ material libraries and their textures) form the dependency graph,
+    /// images referenced by a model are cooked by the import of the model and not on their own. Sources are cooked in parallel on a task graph
+    /// in which sources sharing a referenced file run one after the other, both imports write the outputs of that file.
+    ///
+    /// Cooks are incremental, the cook database in the output directory records the size, write time and hash of each source and its references.
+    /// A source whose files kept their size and write time is up to date without being read, otherwise it is hashed and cooked again only when
+    /// a hash or CookVersion changed. The outputs are registered in AssetRegistryFile of the output directory, uris keep their ids across cooks
+    /// so scenes can reference cooked assets.
+    ///
+    /// Cooked meshes are optimized and get the levels of detail of AssetCookerDesc::LODs, the settings are part of the key so changing them cooks
+    /// every model again.
+    class AssetCooker
+    {
+    public:
+        static constexpr uint32_t CookVersion       = 3; // Bump when the import settings or the importers change, every source is cooked again
+        static constexpr auto     DatabaseFile      = "CookDatabase.json";
+        static constexpr auto     AssetRegistryFile = "AssetRegistry.dzreg";
+
+    private:
+        enum class ProcessorType
+        {
+            Model,
+            Texture
+        };
+
+        struct Source
+        {
+            std::string              Path;
+            ProcessorType            Processor;
+            std::vector<std::string> Dependencies; // Existing files referenced by the source, relative to the source directory
+        };
+
+        struct FileState
+        {
+            uint64_t    NumBytes  = 0;
+            int64_t     LastWrite = 0;
+            ContentHash Hash;
+        };
+
+        struct Record
+        {
+            FileState                        State;
+            std::map<std::string, FileState> Dependencies;
+            ContentHash                      Key; // Of everything the outputs derive from, also the derived data cache key
+            std::vector<std::string>         Outputs;
+        };
+
+        std::filesystem::path         m_sourceDirectory;
+        std::filesystem::path         m_outputDirectory;
+        tf::Executor                 *m_executor;
+        DerivedDataCache             *m_cache;
+        size_t                        m_batchId;
+        bool                          m_force;
+        MeshAssetProcessorDesc        m_meshProcessing;
+        std::map<std::string, Record> m_records; // Of the cook database, by source path
+        std::vector<AssetCookResult>  m_results;
+        AssetCookStats                m_stats{ };
+
+    public:
+        explicit AssetCooker( const AssetCookerDesc &desc );
+
+        bool                                              Cook( );             // False when a source failed to cook or the database couldn't be written
+        [[nodiscard]] const std::vector<AssetCookResult> &GetResults( ) const; // Of the last cook, in the order of the source paths
+        [[nodiscard]] AssetCookStats                      GetStats( ) const;
+
+    private:
+        [[nodiscard]] std::vector<Source> Scan( ) const;
+        void                              FindDependencies( Source &source ) const;
+        AssetCookResult                   CookSource( const Source &source, std::optional<Record> &outRecord ) const;
+        bool                              Import( const Source &source, std::vector<std::string> &outOutputs ) const;
+        [[nodiscard]] bool                OutputsExist( const Record &record ) const;
+        bool                              StateOf( const std::string &path, FileState &outState ) const; // Size and write time
+        bool                              HashOf( const std::string &path, FileState &outState ) const;
+        [[nodiscard]] std::vector<Byte>   PackOutputs( const std::vector<std::string> &outputs ) const;
+        bool                              UnpackOutputs( std::span<const Byte> data, std::vector<std::string> &outOutputs ) const;
+        void                              RemoveStaleOutputs( const std::map<std::string, Record> &previousRecords ) const;
+        bool                              UpdateRegistry( ) const;
+        bool                              LoadDatabase( );
+        bool                              SaveDatabase( ) const;
+    };
+} // namespace DZEngine
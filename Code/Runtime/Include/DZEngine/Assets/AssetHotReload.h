@@ -0,0 +1,63 @@
+/*
+Den Of Iz - Game/Game Engine
+Copyright (c) 2020-2024 Muhammed Murat Cengiz
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <span>
+#include "AssetLoader.h"
+#include "FileWatcher.h"
+
+namespace DZEngine
+{
+    struct AssetHotReloadDesc
+    {
+        AssetBundle   *AssetBundle;
+        AssetBatcher  *AssetBatcher;
+        AssetRegistry *AssetRegistry; // Maps the changed files to the loaded assets
+        AssetLoader   *AssetLoader;
+    };
+
+    /// Reloads the assets of changed files. A file under the assets directory is the uri assets://<relative path>, every asset the registry
+    /// has of that uri, in any batch and of any type, is reloaded through AssetLoader::Reload and swapped in place by its Update, so handles held
+    /// by components stay valid and nothing else is touched. Removed files keep their assets loaded, files of packed assets are ignored.
+    /// Every member of the desc is required, changes are ignored without them.
+    class AssetHotReload
+    {
+        struct PendingReload
+        {
+            AssetLoadHandle Handle;
+            std::string     Uri;
+        };
+
+        AssetBundle               *m_assetBundle;
+        AssetBatcher              *m_assetBatcher;
+        AssetRegistry             *m_assetRegistry;
+        AssetLoader               *m_assetLoader;
+        std::vector<PendingReload> m_pending;
+
+    public:
+        explicit AssetHotReload( const AssetHotReloadDesc &desc );
+
+        uint32_t             OnFilesChanged( std::span<const FileChange> changes ); // Returns the number of reloads requested
+        void                 Update( );                                             // Logs the finished reloads, call after AssetLoader::Update
+        [[nodiscard]] size_t NumPending( ) const;
+
+        // assets:// uri of a file under the assets directory, empty for any other file
+        [[nodiscard]] std::string ToUri( const std::filesystem::path &path ) const;
+    };
+} // namespace DZEngine
@@ -0,0 +1,240 @@
+/*
+Den Of Iz - Game/Game Engine
+Copyright (c) 2020-2024 Muhammed Murat Cengiz
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <optional>
+#include "AssetBatcher.h"
+#include "AssetScheduler.h"
+#include "SlotMap.h"
+
+namespace tf
+{
+    class Executor;
+}
+
+namespace DZEngine
+{
+    struct TAssetLoadHandle;
+    using AssetLoadHandle = AssetHandle<TAssetLoadHandle>;
+
+    enum class AssetLoadState
+    {
+        Pending,
+        Ready,
+        Failed,
+        Cancelled
+    };
+
+    enum class AssetLoadType
+    {
+        Mesh,
+        Texture,
+        Animation,
+        Skeleton,
+        Material
+    };
+
+    struct AssetLoaderDesc
+    {
+        AssetBatcher  *AssetBatcher;
+        AssetBundle   *AssetBundle;
+        AssetRegistry *AssetRegistry;
+        tf::Executor  *Executor             = nullptr; // Optional, requests are decoded in Update without it
+        uint32_t       MaxRequestsPerUpdate = 64;      // Dispatched per batch per update
+        // Moved per Update by the defragment of a batch whose geometry pool has no update in flight, see AssetBatcher::DefragmentGeometry. 0 disables it.
+        size_t DefragmentBytesPerUpdate = 1048576;
+
+        AssetSchedulerDesc Scheduler{ }; // Order and per frame budgets of the dispatched requests, sized by their asset files
+    };
+
+    struct AssetLoaderStats
+    {
+        size_t NumRequested       = 0;
+        size_t NumReady           = 0;
+        size_t NumFailed          = 0;
+        size_t NumPending         = 0;
+        size_t NumCancelled       = 0;
+        size_t NumDeduplicated    = 0;   // Shared a request of the same uri or an asset of AssetBatcher::Cache instead of loading it again
+        size_t NumMissedDeadlines = 0;   // Dispatched after the deadline of their schedule
+        size_t NumBytesLoaded     = 0;   // Size of the asset files of the ready requests
+        double BusySeconds        = 0.0; // Time with at least one pending request, the rates below are over it
+        double AssetsPerSecond    = 0.0;
+        double MegabytesPerSecond = 0.0;
+        double AverageLatencyMs   = 0.0; // From the request to the update that published it
+        // Bytes moved between CPU buffers on the way to the GPU, includes the mesh uploads of every batch and the texels staged by MaterialBatch
+        size_t NumCopiedBytes      = 0;
+        double CopiedBytesPerAsset = 0.0;
+        size_t PeakResidentBytes   = 0; // Of the process
+    };
+
+    struct MeshDependencies
+    {
+        std::vector<MaterialHandle>      SubMeshMaterials; // Indexed like the submeshes, invalid without a MaterialRef or when it failed to load
+        SkeletonHandle                   Skeleton;
+        std::vector<AnimationClipHandle> Animations; // Indexed like MeshAssetData::AnimationRefs
+    };
+
+    /// Loads assets into an AssetBatcher without blocking the frame. Requests return a handle right away that stays Pending until the asset is
+    /// decoded on the executor, its GPU copies have completed and it was published by Update, the Get functions return the fallback until then.
+    /// Each geometry pool has at most one update in flight, of one of the batches sharing it: Update begins it with the queued requests of the batch,
+    /// submits it once they are decoded and publishes its requests once its copy lists signal their semaphores.
+    /// Queued requests are dispatched by an AssetScheduler in order of their schedule within its per frame budgets, until dispatched they may be
+    /// cancelled or rescheduled, e.g. as the camera moves. Batches that take no request in an Update defragment their geometry in an update instead.
+    /// Meshes loaded with their dependencies and materials stay Pending until everything they reference is published. References are looked up
+    /// by uri among the requests of the loader and then in the registry, only the missing ones are requested, all with the schedule of the mesh.
+    /// Meshes, animations and skeletons are decoded on the workers, textures are only read there and uploaded in Update as MaterialBatch isn't thread safe.
+    /// Requests of a uri that is already pending return the same handle, ones of a uri in AssetBatcher::Cache are Ready right away. Every load
+    /// holds a reference to the asset until Release, ready assets are counted in the cache with the references their dependents hold and hold
+    /// the references to their own dependencies until the cache evicts them. Handles are generational ids of a SlotMap: once a request finished
+    /// and every load released its handle the slot is reused, a released handle reads as Failed and never resolves to the next request.
+    /// Don't begin synchronous updates of a batch while it has pending requests.
+    class AssetLoader
+    {
+        struct Request
+        {
+            AssetLoadType            Type;
+            size_t                   BatchId;
+            std::string              Uri;
+            std::string              Alias;
+            std::vector<std::string> SubmeshAliases;
+            AssetLoadState           State         = AssetLoadState::Pending;
+            uint32_t                 AssetId       = UINT32_MAX; // Id of the handle of the asset type, valid once Ready
+            size_t                   NumBytes      = 0;
+            uint32_t                 NumReferences = 1;          // Loads and dependents sharing the request, moved to the cache once Ready
+            uint32_t                 NumHandles    = 0;          // Loads holding the handle until Release, 0 for requested dependencies
+            bool                     Cached        = false;      // Took the asset from the cache instead of loading it
+            uint32_t                 ReloadTarget  = UINT32_MAX; // Asset replaced by this one once Ready, see Reload
+
+            // Produced by the worker, consumed in Update
+            bool                              Decoded = false;
+            std::vector<Byte>                 FileData;
+            AssetReader                       TextureReader; // Over FileData, or the mapped pack for packed textures
+            std::optional<AnimationAssetData> Animation;
+            std::optional<SkeletonAssetData>  Skeleton;
+
+            // References of the asset, found by Decode and resolved on the Update thread
+            struct Dependency
+            {
+                AssetLoadType Type;
+                std::string   Uri;
+                uint32_t      Slot      = 0;          // Submesh or animation index of a mesh, texture slot of a material
+                uint32_t      RequestId = UINT32_MAX; // Request it waits for
+                uint32_t      AssetId   = UINT32_MAX; // Once loaded
+            };
+            bool                               ResolveDependencies    = false;
+            std::vector<Dependency>            Dependencies;
+            uint32_t                           NumPendingDependencies = 0;
+            bool                               AwaitingDependencies   = false; // Published itself, completes with its last dependency
+            std::vector<uint32_t>              Dependents;                     // Requests waiting for this one
+            uint32_t                           NumSubMeshes           = 0;
+            std::optional<MaterialDataRequest> Material;                       // Texture handles are filled in from the dependencies
+
+            AssetSchedule                         Schedule;
+            std::chrono::steady_clock::time_point RequestTime;
+        };
+
+        struct BatchUpdate
+        {
+            std::vector<uint32_t> Requests;
+            std::atomic<size_t>   NumDecoding = 0;
+            bool                  Submitted   = false;
+        };
+
+        AssetBatcher  *m_assetBatcher;
+        AssetBundle   *m_assetBundle;
+        AssetRegistry *m_assetRegistry;
+        tf::Executor  *m_executor;
+        uint32_t       m_maxRequestsPerUpdate;
+        size_t         m_defragmentBytesPerUpdate;
+
+        mutable std::mutex                                       m_lock;
+        SlotMap<std::unique_ptr<Request>>                        m_requests; // AssetLoadHandle::Id -> request, see RecycleLocked
+        AssetScheduler                                           m_scheduler;
+        std::unordered_map<std::string, uint32_t>                m_uriRequests; // Type, batch and uri -> latest request of it
+        std::unordered_map<size_t, std::unique_ptr<BatchUpdate>> m_batchUpdates;
+        std::atomic<size_t>                                      m_numDecoding = 0;
+
+        AssetLoaderStats                      m_stats{ };
+        double                                m_totalLatencyMs = 0.0;
+        std::chrono::steady_clock::time_point m_lastUpdate;
+
+    public:
+        explicit AssetLoader( const AssetLoaderDesc &desc );
+        ~AssetLoader( ); // Waits for the requests being decoded
+
+        AssetLoadHandle LoadMesh( size_t batchId, const std::string &uri, const std::vector<std::string> &submeshAliases = { }, const AssetSchedule &schedule = { } );
+        AssetLoadHandle LoadTexture( size_t batchId, const std::string &alias, const std::string &uri, const AssetSchedule &schedule = { } );
+        AssetLoadHandle LoadAnimation( size_t batchId, const std::string &uri, const std::string &alias, const AssetSchedule &schedule = { } );
+        AssetLoadHandle LoadSkeleton( size_t batchId, const std::string &uri, const std::string &alias, const AssetSchedule &schedule = { } );
+        // Also loads the textures the material references
+        AssetLoadHandle LoadMaterial( size_t batchId, const std::string &uri, const std::string &alias, const AssetSchedule &schedule = { } );
+        // One handle for the whole closure: the materials and their textures, the skeleton and the animations the mesh references
+        AssetLoadHandle LoadMeshWithDependencies( size_t batchId, const std::string &uri, const std::vector<std::string> &aliases = { }, const AssetSchedule &schedule = { } );
+        // Loads the uri again and swaps it into the loaded asset targetId once Ready, see AssetBatcher::ReplaceAsset. The handles, references and
+        // registration of the target stay, meshes and materials resolve their dependencies again. Never shared with other loads, Release only frees the handle.
+        AssetLoadHandle Reload( AssetLoadType type, size_t batchId, const std::string &uri, uint32_t targetId, const AssetSchedule &schedule = { } );
+        // Both fail once the request was dispatched, a cancelled request ends in AssetLoadState::Cancelled.
+        // A request shared by several loads only drops the reference of the caller until the last one cancels it.
+        bool Cancel( AssetLoadHandle handle );
+        bool Reschedule( AssetLoadHandle handle, const AssetSchedule &schedule );
+        // Drops the reference of one load, the last reference of a request that wasn't dispatched yet cancels it. Call once per load, the handle
+        // stops resolving once the request finished and every load sharing it released it.
+        void Release( AssetLoadHandle handle );
+
+        /// Call once per frame at the frame boundary, before the scene is read for rendering
+        void Update( );
+        /// Updates until nothing is pending, blocks on the executor and the copy queues
+        void WaitIdle( );
+
+        [[nodiscard]] AssetLoadState      GetState( AssetLoadHandle handle ) const;
+        [[nodiscard]] MeshHandle          GetMesh( AssetLoadHandle handle, MeshHandle fallback = InvalidMeshHandle ) const;
+        [[nodiscard]] TextureHandle       GetTexture( AssetLoadHandle handle, TextureHandle fallback = InvalidTextureHandle ) const;
+        [[nodiscard]] AnimationClipHandle GetAnimation( AssetLoadHandle handle, AnimationClipHandle fallback = InvalidAnimationClipHandle ) const;
+        [[nodiscard]] SkeletonHandle      GetSkeleton( AssetLoadHandle handle, SkeletonHandle fallback = InvalidSkeletonHandle ) const;
+        [[nodiscard]] MaterialHandle      GetMaterial( AssetLoadHandle handle, MaterialHandle fallback = InvalidMaterialHandle ) const;
+        [[nodiscard]] MeshDependencies    GetMeshDependencies( AssetLoadHandle handle ) const; // Empty until the mesh is Ready
+        [[nodiscard]] AssetLoaderStats    GetStats( ) const;
+
+    private:
+        AssetLoadHandle                Enqueue( std::unique_ptr<Request> request, const AssetSchedule &schedule );
+        uint32_t                       EnqueueLocked( std::unique_ptr<Request> request, const AssetSchedule &schedule ); // Requires m_lock
+        uint32_t                       ShareLocked( Request &request );                                                  // Requires m_lock
+        void                           CancelLocked( uint32_t requestId );                                               // Requires m_lock
+        void                           RecycleLocked( uint32_t requestId ); // Requires m_lock, frees the slot of a finished request no load holds
+        [[nodiscard]] Request         *FindRequest( uint32_t requestId ) const; // Requires m_lock, null for a stale id
+        void                           Dispatch( );
+        void                           Defragment( ); // Of the batches without an update in flight
+        [[nodiscard]] bool             IsPoolUpdating( size_t batchId ) const; // Requires m_lock, a batch sharing the geometry pool has an update in flight
+        void                           Decode( Request &request ) const;
+        void                           CollectDependencies( Request &request, MeshHandle mesh ) const;
+        void                           Finish( Request &request ) const; // On the Update thread, after the batch's requests are decoded
+        void                           ResolveDependencies( uint32_t requestId );
+        void                           Publish( uint32_t requestId );
+        void                           Complete( uint32_t requestId ); // Final state of a published request and the dependents it was the last of, see RecycleLocked
+        void                           NotifyDependents( uint32_t requestId );
+        void                           HandOverDependencies( const Request &request ) const; // To the cached asset, or releases them
+        bool                           ReplaceTarget( Request &request ) const;              // Swaps a decoded reload into its target, false when the batch rejected it
+        void                           RegisterAsset( const Request &request ) const;
+        [[nodiscard]] uint32_t         FindRegisteredAsset( AssetLoadType type, size_t batchId, const std::string &uri ) const;
+        [[nodiscard]] uint32_t         ReadyAssetId( AssetLoadHandle handle, AssetLoadType type ) const;
+        [[nodiscard]] AssetLoaderStats ComputeStats( ) const; // Requires m_lock
+    };
+} // namespace DZEngine
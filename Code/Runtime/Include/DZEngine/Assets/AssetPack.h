@@ -0,0 +1,134 @@
+/*
+Den Of Iz - Game/Game Engine
+Copyright (c) 2020-2024 Muhammed Murat Cengiz
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#pragma once
+
+#include <DenOfIzGraphics/Assets/Stream/BinaryReader.h>
+#include <filesystem>
+#include <memory>
+#include <streambuf>
+#include <string>
+#include <vector>
+#include "BlockCompression.h"
+#include "DerivedDataCache.h"
+#include "MappedFile.h"
+
+using namespace DenOfIz;
+
+namespace DZEngine
+{
+    /// Owns the stream of a reader over mapped or decompressed memory, the stream and storage are destroyed after the reader
+    struct AssetReaderDeleter
+    {
+        std::unique_ptr<Byte[]>         Storage; // Decompressed asset, empty for a reader over the mapping
+        std::unique_ptr<std::streambuf> Buffer;
+        std::unique_ptr<std::istream>   Stream;
+
+        void operator( )( const BinaryReader *reader ) const
+        {
+            delete reader;
+        }
+    };
+    using AssetReader = std::unique_ptr<BinaryReader, AssetReaderDeleter>;
+
+    /// Pack file layout, all offsets are from the start of the file:
+    /// AssetPackHeader | payloads, each starting at a multiple of Alignment | AssetPackSlot[ NumSlots ] | paths
+    /// The slots are an open addressing table keyed by the hash of the path relative to the assets directory, linear probing, Hash == 0 is empty.
+    /// Payloads with a Codec other than None are BlockCompression blocks.
+    struct AssetPackHeader
+    {
+        static constexpr uint32_t Magic   = 0x4B505A44; // DZPK
+        static constexpr uint32_t Version = 2;
+
+        uint32_t FileMagic;
+        uint32_t FileVersion;
+        uint32_t Alignment;
+        uint32_t NumEntries;
+        uint32_t NumSlots; // Power of two
+        uint32_t Reserved;
+        uint64_t SlotsOffset;
+        uint64_t PathsOffset;
+        uint64_t PathsNumBytes;
+    };
+
+    struct AssetPackSlot
+    {
+        uint64_t              Hash;
+        uint64_t              Offset;
+        uint64_t              NumBytes; // Stored in the pack
+        uint64_t              UncompressedNumBytes;
+        uint32_t              PathOffset; // Into the paths block, not null terminated
+        uint32_t              PathLength;
+        BlockCompressionCodec Codec;
+        uint32_t              Reserved;
+    };
+
+    struct AssetPackBuildDesc
+    {
+        std::filesystem::path AssetsDirectory;
+        std::filesystem::path OutputPath;
+        uint32_t              Alignment = 4096; // Payloads start on a page so each asset maps and reads ahead on its own
+        // Codec None keeps every asset readable straight from the mapping, assets that don't shrink are always stored uncompressed
+        BlockCompressionDesc Compression = { BlockCompressionCodec::None };
+        DerivedDataCache    *Cache       = nullptr; // Optional, compressed blocks of unchanged assets are looked up instead of compressed again
+    };
+
+    /// Read only, memory mapped pack of the assets:// tree. Lookups don't touch the file system and uncompressed assets are read straight from the mapping.
+    class AssetPack
+    {
+        static constexpr uint32_t CompressVersion = 1; // Of the cached blocks, bump when BlockCompression output changes for the same input
+
+        std::filesystem::path m_path;
+        MappedFile            m_file;
+        tf::Executor         *m_executor = nullptr;
+
+        const AssetPackHeader *m_header = nullptr;
+        const AssetPackSlot   *m_slots  = nullptr;
+        const char            *m_paths  = nullptr;
+
+    public:
+        static constexpr auto Extension = ".dzpack"; // Files with it are never packed, nor temporary .tmp files and the output itself
+
+        // Compressed assets are decompressed in parallel on the executor when one is given
+        explicit AssetPack( const std::filesystem::path &packPath, tf::Executor *executor = nullptr );
+        ~AssetPack( );
+        AssetPack( const AssetPack & )            = delete;
+        AssetPack &operator=( const AssetPack & ) = delete;
+
+        [[nodiscard]] bool IsValid( ) const;
+        /// path is relative to the assets directory with forward slashes, same as the path of an assets:// uri
+        [[nodiscard]] bool                         Contains( const std::string &path ) const;
+        [[nodiscard]] AssetReader                  LoadAsset( const std::string &path ) const; // Decompresses into memory owned by the reader
+        // Copies or decompresses the asset straight into dst, dstNumBytes must equal GetAssetNumBytes( path )
+        bool                                       ReadAsset( const std::string &path, Byte *dst, size_t dstNumBytes ) const;
+        [[nodiscard]] size_t                       GetAssetNumBytes( const std::string &path ) const; // Uncompressed
+        [[nodiscard]] size_t                       GetAssetStoredNumBytes( const std::string &path ) const;
+        [[nodiscard]] std::vector<std::string>     GetAssetPaths( ) const;
+        [[nodiscard]] const std::filesystem::path &GetPath( ) const;
+
+        static bool     Build( const AssetPackBuildDesc &desc );
+        static uint64_t HashPath( const std::string &path );
+
+    private:
+        [[nodiscard]] const AssetPackSlot *Find( const std::string &path ) const;
+        void                               Unmap( );
+        static std::vector<Byte>           CompressCached( const std::vector<Byte> &payload, const AssetPackBuildDesc &desc );
+    };
+
+    /// Reader over a mapped region without copying it, the region must outlive the reader
+    AssetReader CreateMemoryReader( const Byte *data, size_t numBytes );
+} // namespace DZEngine
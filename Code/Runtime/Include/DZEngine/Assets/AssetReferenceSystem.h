@@ -0,0 +1,36 @@
+/*
+Den Of Iz - Game/Game Engine
+Copyright (c) 2020-2024 Muhammed Murat Cengiz
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#pragma once
+
+#include <flecs.h>
+#include "AssetCache.h"
+
+namespace DZEngine
+{
+    /// Ties the lifetime of assets to the components referencing them. An entity holds a reference in AssetCache to the asset of each of its
+    /// MeshComponent, MaterialComponent, SkeletonComponent and AnimationComponent, taken once the handle is set and released when the handle
+    /// changes or the component is removed, including when the entity is deleted. Handles the cache doesn't know, e.g. of assets added
+    /// without a uri, are ignored. Materials, skeletons and animations are looked up in the batch of the MeshComponent of the entity, 0 without one,
+    /// and move to its batch when the MeshComponent is set after them.
+    /// The cache has to outlive the world.
+    class AssetReferenceSystem
+    {
+    public:
+        static void Register( const flecs::world &world, AssetCache *cache );
+    };
+} // namespace DZEngine
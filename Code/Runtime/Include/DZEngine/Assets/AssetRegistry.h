@@ -20,15 +20,84 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 
 #include <filesystem>
 #include <string>
-#include <unordered_map>
+#include <string_view>
+#include <vector>
 #include "DZEngine/Components/AssetHandle.h"
+#include "MappedFile.h"
 
 namespace DZEngine
 {
-    struct AssetEntry
+    enum class AssetRegistryType : uint32_t
     {
-        std::string Uri;
-        std::string AssetType; // "mesh", "material", "texture", etc.
+        Mesh,
+        Material,
+        Texture,
+        Animation,
+        Skeleton,
+        Count
+    };
+
+    /// Binary registry layout, all offsets are from the start of the file:
+    /// AssetRegistryHeader | handle slots | uri slots | AssetRegistryUri[ NumUris ] | intern slots | uri bytes
+    /// Handle slots map ( type, batch, handle ) to the index of the uri and uri slots map ( type, batch, uri index ) back to the handle.
+    /// Both are AssetRegistrySlot tables, intern slots hold uri indices keyed by AssetRegistryUri::Hash. All tables are open addressing with
+    /// linear probing and a power of two size, at most half full including the removed slots.
+    struct AssetRegistryHeader
+    {
+        static constexpr uint32_t Magic   = 0x52415A44; // DZAR
+        static constexpr uint32_t Version = 1;
+
+        uint32_t FileMagic;
+        uint32_t FileVersion;
+        uint32_t NumHandleSlots;
+        uint32_t NumHandleEntries;
+        uint32_t NumHandleSlotsUsed; // Entries and removed slots
+        uint32_t NumUriSlots;
+        uint32_t NumUriEntries;
+        uint32_t NumUriSlotsUsed;
+        uint32_t NumUris;
+        uint32_t NumInternSlots;
+        uint64_t HandleSlotsOffset;
+        uint64_t UriSlotsOffset;
+        uint64_t UrisOffset;
+        uint64_t InternSlotsOffset;
+        uint64_t UriDataOffset;
+        uint64_t UriDataNumBytes;
+    };
+
+    struct AssetRegistrySlot
+    {
+        static constexpr uint32_t Empty   = UINT32_MAX;
+        static constexpr uint32_t Removed = UINT32_MAX - 1;
+
+        uint64_t          BatchId;
+        AssetRegistryType Type;
+        uint32_t          Key;   // Handle id or uri index
+        uint32_t          Value; // The other one, Empty or Removed for an unused slot
+        uint32_t          Reserved;
+    };
+
+    struct AssetRegistryUri
+    {
+        uint64_t Hash;
+        uint32_t Offset; // Into the uri bytes, not null terminated
+        uint32_t NumBytes;
+    };
+
+    /// Array of the registry, views the mapped file until the registry is first modified
+    template <typename T>
+    struct AssetRegistryTable
+    {
+        std::vector<T> Owned;
+        const T       *Data = nullptr; // Owned.data( ) or into the mapped file
+        size_t         Size = 0;
+    };
+
+    struct AssetRegistrySlotTable
+    {
+        AssetRegistryTable<AssetRegistrySlot> Slots;
+        uint32_t                              NumEntries = 0;
+        uint32_t                              NumUsed    = 0; // Entries and removed slots
     };
 
     /**
@@ -36,7 +105,10 @@ namespace DZEngine
      * This allows components to store lightweight BatchId/Handle references while
      * maintaining the connection to actual asset files.
      *
-     * Registry format:
+     * Every uri is stored once, lookups in either direction are a single probe sequence of a flat table. A binary registry is mapped by
+     * LoadFromFile and used in place without allocating per entry, it is only copied out of the mapping when the registry is modified.
+     *
+     * JSON format, for import and export:
      * {
      *   "batches": {
      *     "0": {
@@ -50,21 +122,23 @@ namespace DZEngine
      */
     class AssetRegistry
     {
-        // BatchId -> HandleId -> AssetEntry
-        std::unordered_map<size_t, std::unordered_map<uint32_t, AssetEntry>> m_meshRegistry;
-        std::unordered_map<size_t, std::unordered_map<uint32_t, AssetEntry>> m_materialRegistry;
-        std::unordered_map<size_t, std::unordered_map<uint32_t, AssetEntry>> m_textureRegistry;
-        std::unordered_map<size_t, std::unordered_map<uint32_t, AssetEntry>> m_animationRegistry;
-        std::unordered_map<size_t, std::unordered_map<uint32_t, AssetEntry>> m_skeletonRegistry;
+        AssetRegistrySlotTable               m_handles;    // ( type, batch, handle ) -> uri index
+        AssetRegistrySlotTable               m_uriHandles; // ( type, batch, uri index ) -> handle
+        AssetRegistryTable<AssetRegistryUri> m_uris;
+        AssetRegistryTable<uint32_t>         m_internSlots;
+        AssetRegistryTable<char>             m_uriData;
+        MappedFile                           m_file;
 
         std::filesystem::path m_registryPath;
 
     public:
+        static constexpr auto BinaryExtension = ".dzreg";
+
         AssetRegistry( ) = default;
         explicit AssetRegistry( const std::filesystem::path &registryPath );
 
-        bool LoadFromFile( const std::filesystem::path &registryPath );
-        bool SaveToFile( const std::filesystem::path &registryPath );
+        bool LoadFromFile( const std::filesystem::path &registryPath ); // Binary or JSON, detected from the contents, binary tables are validated
+        bool SaveToFile( const std::filesystem::path &registryPath );   // Binary with BinaryExtension, JSON otherwise
 
         void RegisterMeshAsset( size_t batchId, MeshHandle handle, const std::string &uri );
         void RegisterMaterialAsset( size_t batchId, MaterialHandle handle, const std::string &uri );
@@ -72,18 +146,47 @@ namespace DZEngine
         void RegisterAnimationAsset( size_t batchId, AnimationClipHandle handle, const std::string &uri );
         void RegisterSkeletonAsset( size_t batchId, SkeletonHandle handle, const std::string &uri );
 
-        bool GetMeshAssetUri( size_t batchId, MeshHandle handle, std::string &outUri );
-        bool GetMaterialAssetUri( size_t batchId, MaterialHandle handle, std::string &outUri );
-        bool GetTextureAssetUri( size_t batchId, TextureHandle handle, std::string &outUri );
-        bool GetAnimationAssetUri( size_t batchId, AnimationClipHandle handle, std::string &outUri );
-        bool GetSkeletonAssetUri( size_t batchId, SkeletonHandle handle, std::string &outUri );
+        bool GetMeshAssetUri( size_t batchId, MeshHandle handle, std::string &outUri ) const;
+        bool GetMaterialAssetUri( size_t batchId, MaterialHandle handle, std::string &outUri ) const;
+        bool GetTextureAssetUri( size_t batchId, TextureHandle handle, std::string &outUri ) const;
+        bool GetAnimationAssetUri( size_t batchId, AnimationClipHandle handle, std::string &outUri ) const;
+        bool GetSkeletonAssetUri( size_t batchId, SkeletonHandle handle, std::string &outUri ) const;
+
+        // The handle registered last for the uri
+        bool FindMeshAsset( size_t batchId, const std::string &uri, MeshHandle &outHandle ) const;
+        bool FindMaterialAsset( size_t batchId, const std::string &uri, MaterialHandle &outHandle ) const;
+        bool FindTextureAsset( size_t batchId, const std::string &uri, TextureHandle &outHandle ) const;
+        bool FindAnimationAsset( size_t batchId, const std::string &uri, AnimationClipHandle &outHandle ) const;
+        bool FindSkeletonAsset( size_t batchId, const std::string &uri, SkeletonHandle &outHandle ) const;
+
+        void Register( AssetRegistryType type, size_t batchId, uint32_t handleId, std::string_view uri );
+        void Unregister( AssetRegistryType type, size_t batchId, uint32_t handleId ); // Of unloaded assets, the uri stays interned
+        bool GetUri( AssetRegistryType type, size_t batchId, uint32_t handleId, std::string_view &outUri ) const; // Valid until the registry is modified
+        bool Find( AssetRegistryType type, size_t batchId, std::string_view uri, uint32_t &outHandleId ) const;
 
         void ClearBatch( size_t batchId );
         void Clear( );
 
-        void LogRegistry( );
+        void LogRegistry( ) const;
 
+        [[nodiscard]] size_t         GetNumEntries( ) const;
         const std::filesystem::path &GetRegistryPath( ) const;
         void                         SetRegistryPath( const std::filesystem::path &path );
+
+    private:
+        bool LoadBinary( const std::filesystem::path &registryPath );
+        bool LoadJson( const std::filesystem::path &registryPath );
+        bool SaveBinary( const std::filesystem::path &registryPath ) const;
+        bool SaveJson( const std::filesystem::path &registryPath ) const;
+
+        void                           MakeWritable( );
+        uint32_t                       Intern( std::string_view uri );
+        [[nodiscard]] uint32_t         FindUri( std::string_view uri ) const;
+        [[nodiscard]] std::string_view UriAt( uint32_t uriIndex ) const;
+
+        [[nodiscard]] static uint32_t FindSlot( const AssetRegistrySlotTable &table, AssetRegistryType type, size_t batchId, uint32_t key );
+        static void                   SetSlot( AssetRegistrySlotTable &table, AssetRegistryType type, size_t batchId, uint32_t key, uint32_t value );
+        static void                   RemoveSlot( AssetRegistrySlotTable &table, uint32_t slot );
+        static void                   Rehash( AssetRegistrySlotTable &table, size_t numSlots );
     };
 } // namespace DZEngine
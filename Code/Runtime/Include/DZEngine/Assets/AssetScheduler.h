@@ -0,0 +1,104 @@
+/*
+Den Of Iz - Game/Game Engine
+Copyright (c) 2020-2024 Muhammed Murat Cengiz
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+namespace DZEngine
+{
+    using AssetSchedulerClock = std::chrono::steady_clock;
+
+    struct AssetSchedule
+    {
+        float                           Priority = 0.0f; // Higher is dispatched first
+        AssetSchedulerClock::time_point Deadline{ };     // None when default constructed
+    };
+
+    struct AssetSchedulerDesc
+    {
+        std::function<AssetSchedulerClock::time_point( )> Clock; // AssetSchedulerClock::now when empty, replace it to simulate time
+
+        size_t   BytesPerFrame       = 33554432;  // Read bandwidth, the first request of a frame is dispatched even if it is larger
+        size_t   MaxInFlightBytes    = 134217728; // Dispatched but not completed, bounds the memory staged for upload
+        uint32_t MaxRequestsPerFrame = 256;
+        double   UrgencySeconds      = 0.1;  // Requests this close to their deadline go ahead of every priority, earliest deadline first
+        float    AgingPerSecond      = 0.0f; // Added to the priority of a queued request per second waited, avoids starving low priorities
+    };
+
+    struct AssetSchedulerStats
+    {
+        size_t NumQueued;
+        size_t NumInFlight;
+        size_t InFlightBytes;
+        size_t NumDispatched;
+        size_t NumCancelled;
+        size_t NumMissedDeadlines; // Dispatched after their deadline
+    };
+
+    /// Orders asset requests by urgency and priority and releases them in per frame budgets, it only holds ids and sizes so the policy can be
+    /// driven by a simulated clock without loading anything. Not thread safe.
+    class AssetScheduler
+    {
+        struct Entry
+        {
+            uint32_t                        Id;
+            size_t                          NumBytes;
+            AssetSchedule                   Schedule;
+            uint64_t                        Sequence; // FIFO among equals
+            AssetSchedulerClock::time_point QueueTime;
+        };
+
+        std::function<AssetSchedulerClock::time_point( )> m_clock;
+        size_t                                            m_bytesPerFrame;
+        size_t                                            m_maxInFlightBytes;
+        uint32_t                                          m_maxRequestsPerFrame;
+        AssetSchedulerClock::duration                     m_urgency;
+        float                                             m_agingPerSecond;
+
+        std::vector<Entry>                   m_queued;
+        std::unordered_map<uint32_t, size_t> m_queuedIndices; // Id -> index into m_queued
+        std::unordered_map<uint32_t, size_t> m_inFlight;      // Id -> bytes
+        uint64_t                             m_nextSequence = 0;
+        AssetSchedulerStats                  m_stats{ };
+
+    public:
+        explicit AssetScheduler( const AssetSchedulerDesc &desc = { } );
+
+        void Push( uint32_t id, size_t numBytes, const AssetSchedule &schedule = { } );
+        bool Cancel( uint32_t id );                                    // False once dispatched
+        bool Reschedule( uint32_t id, const AssetSchedule &schedule ); // False once dispatched
+        // Returns the ids to start this frame in dispatch order, ids canDispatch rejects stay queued and don't use the budget
+        std::vector<uint32_t> Schedule( const std::function<bool( uint32_t id )> &canDispatch = { } );
+        void                  Complete( uint32_t id ); // Returns the bytes of a dispatched request to the in flight budget
+
+        [[nodiscard]] bool                            IsQueued( uint32_t id ) const;
+        [[nodiscard]] AssetSchedulerStats             GetStats( ) const;
+        [[nodiscard]] AssetSchedulerClock::time_point Now( ) const;
+
+    private:
+        void Remove( size_t index );
+        // Urgent requests first by deadline, then by aged priority, then earliest deadline, then FIFO
+        [[nodiscard]] bool Precedes( const Entry &a, const Entry &b, AssetSchedulerClock::time_point now ) const;
+        [[nodiscard]] bool IsUrgent( const Entry &entry, AssetSchedulerClock::time_point now ) const;
+    };
+} // namespace DZEngine
@@ -0,0 +1,75 @@
+/*
+Den Of Iz - Game/Game Engine
+Copyright (c) 2020-2024 Muhammed Murat Cengiz
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <DenOfIzGraphics/Utilities/Common_Arrays.h>
+#include <cstdint>
+#include <vector>
+
+using namespace DenOfIz;
+
+namespace tf
+{
+    class Executor;
+}
+
+namespace DZEngine
+{
+    enum class BlockCompressionCodec : uint32_t
+    {
+        None,
+        LZ4,  // Fast to decompress, for assets on the critical path of a load
+        Zstd, // Smaller, for large assets that are bound by the disk
+    };
+
+    /// Compressed block layout: BlockCompressionHeader | uint32_t ChunkNumBytes[ NumChunks ] | chunks back to back
+    /// Every chunk but the last holds ChunkSize uncompressed bytes and is compressed on its own, a chunk that doesn't shrink is stored raw
+    /// (its ChunkNumBytes equals its uncompressed size) so incompressible data costs a memcpy instead of a decode.
+    struct BlockCompressionHeader
+    {
+        static constexpr uint32_t Magic = 0x43425A44; // DZBC
+
+        uint32_t              FileMagic;
+        BlockCompressionCodec Codec;
+        uint32_t              ChunkSize;
+        uint32_t              NumChunks;
+        uint64_t              NumBytes; // Uncompressed
+    };
+
+    struct BlockCompressionDesc
+    {
+        BlockCompressionCodec Codec     = BlockCompressionCodec::LZ4;
+        uint32_t              ChunkSize = 262144;  // Small enough to spread one asset over the workers, large enough to compress well
+        int                   Level     = 0;       // 0 selects the default level of the codec, LZ4 levels above 0 use LZ4 HC
+        tf::Executor         *Executor  = nullptr; // Optional, chunks are compressed serially without it
+    };
+
+    class BlockCompression
+    {
+    public:
+        static std::vector<Byte> Compress( const Byte *data, size_t numBytes, const BlockCompressionDesc &desc );
+
+        [[nodiscard]] static bool   IsCompressed( const Byte *block, size_t blockNumBytes );
+        [[nodiscard]] static size_t GetNumBytes( const Byte *block, size_t blockNumBytes ); // Uncompressed, 0 if block isn't valid
+
+        /// Decompresses straight into dst, which must hold GetNumBytes( block ) bytes. The chunks are decoded in parallel on the executor,
+        /// callers already running on one of its workers join in instead of blocking it.
+        static bool Decompress( const Byte *block, size_t blockNumBytes, Byte *dst, size_t dstNumBytes, tf::Executor *executor = nullptr );
+    };
+} // namespace DZEngine
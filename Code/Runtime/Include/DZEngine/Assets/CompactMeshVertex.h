@@ -0,0 +1,37 @@
+/*
+Den Of Iz - Game/Game Engine
+Copyright (c) 2020-2024 Muhammed Murat Cengiz
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <cstdint>
+
+namespace DZEngine
+{
+    /// 24 byte alternative to StaticMeshVertex, see VertexQuantization. Every field is a 32 bit word so the layout matches the HLSL mirror exactly.
+    struct CompactMeshVertex
+    {
+        uint32_t PositionXY; // unorm16 x2, relative to the submesh bounds
+        uint32_t PositionZW; // unorm16 z, the high 16 bits store the tangent handedness, 0 = +1 and 1 = -1
+        uint32_t Normal;     // Octahedral snorm16 x2
+        uint32_t Tangent;    // Octahedral snorm16 x2
+        uint32_t TexCoord;   // half x2
+        uint32_t Color;      // RGBA8 unorm
+    };
+
+    static_assert( sizeof( CompactMeshVertex ) == 24 );
+} // namespace DZEngine
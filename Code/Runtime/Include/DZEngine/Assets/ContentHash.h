@@ -0,0 +1,82 @@
+/*
+Den Of Iz - Game/Game Engine
+Copyright (c) 2020-2024 Muhammed Murat Cengiz
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <DenOfIzGraphics/Utilities/Common_Arrays.h>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+using namespace DenOfIz;
+
+namespace DZEngine
+{
+    /// 128 bit hash of content, two XXH64 streams with different seeds. Not cryptographic, collisions of unrelated content are negligible.
+    struct ContentHash
+    {
+        uint64_t High = 0;
+        uint64_t Low  = 0;
+
+        bool operator==( const ContentHash &other ) const = default;
+
+        [[nodiscard]] std::string ToString( ) const; // 32 lower case hex digits
+        static bool               FromString( std::string_view hex, ContentHash &outHash );
+        static ContentHash        Of( const Byte *data, size_t numBytes );
+    };
+
+    struct ContentHashHasher
+    {
+        size_t operator( )( const ContentHash &hash ) const
+        {
+            return static_cast<size_t>( hash.Low );
+        }
+    };
+
+    /// Incremental ContentHash, Update( data ) in pieces equals ContentHash::Of the concatenation
+    class ContentHasher
+    {
+        struct Stream
+        {
+            uint64_t Lanes[ 4 ];
+            uint64_t Seed;
+        };
+
+        Stream   m_streams[ 2 ];
+        Byte     m_buffer[ 32 ];
+        size_t   m_bufferNumBytes = 0;
+        uint64_t m_numBytes       = 0;
+
+    public:
+        ContentHasher( );
+
+        void Update( const Byte *data, size_t numBytes );
+        void Update( std::string_view text ); // Length prefixed, so consecutive strings can't run into each other
+        template <typename T>
+            requires std::is_trivially_copyable_v<T>
+        void UpdateValue( const T &value )
+        {
+            Update( reinterpret_cast<const Byte *>( &value ), sizeof( T ) );
+        }
+        [[nodiscard]] ContentHash Finish( ) const;
+
+    private:
+        void Consume( const Byte *stripe ); // 32 bytes into both streams
+    };
+} // namespace DZEngine
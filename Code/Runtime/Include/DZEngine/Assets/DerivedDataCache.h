@@ -0,0 +1,127 @@
+/*
+Den Of Iz - Game/Game Engine
+Copyright (c) 2020-2024 Muhammed Murat Cengiz
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <filesystem>
+#include <mutex>
+#include <span>
+#include <unordered_map>
+#include <vector>
+#include "ContentHash.h"
+
+namespace DZEngine
+{
+    struct DerivedDataCacheDesc
+    {
+        std::filesystem::path Directory;                      // Local store, created when missing
+        std::filesystem::path SharedDirectory;                // Optional, e.g. a network share of the team. Read on local misses, written by Put.
+        size_t                MaxNumBytes = 8ull << 30;       // Of the local store, 0 disables trimming
+        double                TrimRatio   = 0.8;              // Trimming removes the least recently used entries down to this share of MaxNumBytes
+    };
+
+    struct DerivedDataCacheStats
+    {
+        size_t NumLocalHits;
+        size_t NumSharedHits; // Also copied into the local store
+        size_t NumMisses;
+        size_t NumPuts;
+        size_t NumTrimmed;
+        size_t NumCorrupted; // Entries that failed validation, removed and counted as misses
+        size_t NumEntries;   // Of the local store
+        size_t NumBytes;
+        size_t NumBytesRead;
+        size_t NumBytesWritten;
+    };
+
+    /// Content addressed store of derived data, e.g. compressed or optimized assets, so unchanged content is cooked once per machine or team.
+    /// Keys hash everything the data is derived from, see MakeKey, so entries are never invalidated, only trimmed. Each entry is a file
+    /// <Directory>/<first two hex digits>/<hex key> with a header validating its key, size and hash, written to a temporary file and renamed so
+    /// concurrent cooks, also of other machines sharing SharedDirectory, never see partial entries. A hit touches the entry, the last write
+    /// times order the least recently used entries across runs. Thread safe.
+    class DerivedDataCache
+    {
+        struct Header
+        {
+            static constexpr uint32_t Magic   = 0x44445A44; // DZDD
+            static constexpr uint32_t Version = 2;
+
+            uint32_t    FileMagic;
+            uint32_t    FileVersion;
+            uint64_t    NumBytes;
+            ContentHash Key; // Of the path the entry was written to, catches entries copied or renamed by hand
+            ContentHash PayloadHash;
+        };
+
+        struct Entry
+        {
+            size_t                          NumBytes; // Of the file
+            std::filesystem::file_time_type LastUse;
+        };
+
+        std::filesystem::path m_directory;
+        std::filesystem::path m_sharedDirectory;
+        size_t                m_maxNumBytes;
+        double                m_trimRatio;
+        bool                  m_valid = false;
+
+        mutable std::mutex                                        m_lock;
+        std::unordered_map<ContentHash, Entry, ContentHashHasher> m_entries; // Local store
+        size_t                                                    m_numBytes = 0;
+        DerivedDataCacheStats                                     m_stats{ };
+
+    public:
+        explicit DerivedDataCache( const DerivedDataCacheDesc &desc );
+
+        /// processor names the step deriving the data and processorVersion must change whenever its output does, parameters are its settings
+        static ContentHash MakeKey( std::string_view processor, uint32_t processorVersion, const ContentHash &source, std::span<const Byte> parameters = { } );
+
+        [[nodiscard]] bool IsValid( ) const;
+        bool               Get( const ContentHash &key, std::vector<Byte> &outData );
+        bool               Put( const ContentHash &key, std::span<const Byte> data );
+        [[nodiscard]] bool Contains( const ContentHash &key ) const; // Local store only, doesn't count as a use
+
+        /// Get, or derive the data with build( std::vector<Byte> & ) -> bool and Put it. False when build failed.
+        template <typename Fn>
+        bool GetOrBuild( const ContentHash &key, std::vector<Byte> &outData, Fn &&build )
+        {
+            if ( Get( key, outData ) )
+            {
+                return true;
+            }
+            outData.clear( );
+            if ( !build( outData ) )
+            {
+                return false;
+            }
+            Put( key, outData );
+            return true;
+        }
+
+        void                                Trim( size_t maxNumBytes ); // Least recently used first
+        [[nodiscard]] DerivedDataCacheStats GetStats( ) const;
+
+    private:
+        [[nodiscard]] static std::filesystem::path EntryPath( const std::filesystem::path &directory, const ContentHash &key );
+        static bool ReadEntry( const std::filesystem::path &path, const ContentHash &key, std::vector<Byte> &outData, bool &outCorrupted );
+        static bool WriteEntry( const std::filesystem::path &path, const ContentHash &key, std::span<const Byte> data );
+        void        Scan( );
+        void        AddEntry( const ContentHash &key, size_t numBytes ); // Trims when the store grew past MaxNumBytes
+        void        TrimLocked( size_t maxNumBytes );                     // Requires m_lock
+    };
+} // namespace DZEngine
@@ -0,0 +1,103 @@
+/*
+Den Of Iz - Game/Game Engine
+Copyright (c) 2020-2024 Muhammed Murat Cengiz
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <DenOfIzGraphics/Utilities/Common_Arrays.h>
+#include <atomic>
+#include <filesystem>
+#include <memory>
+#include <span>
+
+using namespace DenOfIz;
+
+namespace tf
+{
+    class Executor;
+}
+
+namespace DZEngine
+{
+    enum class FileIOBackend
+    {
+        Default,    // IoUring on Linux, ThreadPool elsewhere or when io_uring is unavailable
+        ThreadPool, // Blocking reads on the executor, or on the calling thread without one
+        IoUring,    // Linux only
+    };
+
+    struct FileIODesc
+    {
+        FileIOBackend Backend  = FileIOBackend::Default;
+        tf::Executor *Executor = nullptr;
+        // io_uring only
+        uint32_t QueueDepth           = 64;    // Reads in flight, further reads wait for a completion
+        uint32_t NumRegisteredBuffers = 32;    // Reads of up to RegisteredBufferSize bytes land in a registered buffer and are copied out
+        uint32_t RegisteredBufferSize = 65536; // Larger reads land directly in the destination
+    };
+
+    struct FileRead
+    {
+        std::filesystem::path Path;
+        uint64_t              Offset   = 0;
+        Byte                 *Dst      = nullptr;
+        size_t                NumBytes = 0;
+
+        // Written by the backend before the read completes
+        size_t NumBytesRead = 0;
+        bool   Succeeded    = false; // All of NumBytes was read
+    };
+
+    /// Counts the pending reads of Read calls, the reads and the batch must outlive them so Wait before destroying either
+    class FileReadBatch
+    {
+        std::atomic<uint32_t> m_numPending = 0;
+
+    public:
+        [[nodiscard]] bool IsComplete( ) const;
+        void               Wait( ) const;
+
+        // Backend side
+        void Add( uint32_t numReads );
+        void Complete( );
+    };
+
+    class IFileIO
+    {
+    public:
+        virtual ~IFileIO( ) = default;
+        /// Starts every read and returns, batch completes once all of them have. Safe to call from any thread.
+        virtual void                        Read( std::span<FileRead> reads, FileReadBatch &batch ) = 0;
+        [[nodiscard]] virtual FileIOBackend GetBackend( ) const                                     = 0;
+
+        /// Falls back to the ThreadPool backend when the requested one isn't available
+        static std::unique_ptr<IFileIO> Create( const FileIODesc &desc );
+    };
+
+    class ThreadPoolFileIO final : public IFileIO
+    {
+        tf::Executor *m_executor;
+
+    public:
+        explicit ThreadPoolFileIO( const FileIODesc &desc );
+
+        void                        Read( std::span<FileRead> reads, FileReadBatch &batch ) override;
+        [[nodiscard]] FileIOBackend GetBackend( ) const override;
+
+        static void ReadFile( FileRead &read ); // Blocking
+    };
+} // namespace DZEngine
@@ -0,0 +1,110 @@
+/*
+Den Of Iz - Game/Game Engine
+Copyright (c) 2020-2024 Muhammed Murat Cengiz
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <chrono>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace DZEngine
+{
+    enum class FileWatcherBackend
+    {
+        Default, // Inotify on Linux, Polling elsewhere or when inotify is unavailable
+        Polling, // Compares the write times of every watched file each PollInterval
+        Inotify, // Linux only
+    };
+
+    enum class FileChangeType
+    {
+        Modified,
+        Added,
+        Removed
+    };
+
+    struct FileChange
+    {
+        std::filesystem::path Path; // The watched directory as given to Watch joined with the path below it
+        FileChangeType        Type;
+    };
+
+    struct FileWatcherDesc
+    {
+        FileWatcherBackend        Backend      = FileWatcherBackend::Default;
+        std::chrono::milliseconds Debounce     = std::chrono::milliseconds( 200 ); // A file is reported once it had no event for this long
+        std::chrono::milliseconds PollInterval = std::chrono::milliseconds( 500 ); // Polling only
+    };
+
+    /// Collapses the events of a file into a single change that is reported once the file was quiet for the debounce time, so an editor that
+    /// saves with several writes, or through a temporary file that is renamed over the original, causes one reload.
+    class FileChangeDebouncer
+    {
+        struct Pending
+        {
+            std::filesystem::path                 Path;
+            FileChangeType                        Type;
+            std::chrono::steady_clock::time_point LastEvent;
+        };
+
+        std::chrono::milliseconds                m_debounce;
+        std::unordered_map<std::string, Pending> m_pending; // By path
+
+    public:
+        explicit FileChangeDebouncer( std::chrono::milliseconds debounce );
+
+        void Add( const std::filesystem::path &path, FileChangeType type, std::chrono::steady_clock::time_point now );
+        void Collect( std::chrono::steady_clock::time_point now, std::vector<FileChange> &outChanges ); // Appends and forgets the settled changes
+    };
+
+    class IFileWatcher
+    {
+    public:
+        virtual ~IFileWatcher( ) = default;
+        /// Watches every file below the directory, including the ones of directories created later
+        virtual bool Watch( const std::filesystem::path &directory ) = 0;
+        /// Never blocks, appends the debounced changes. Call once per frame from one thread.
+        virtual void                             Poll( std::vector<FileChange> &outChanges ) = 0;
+        [[nodiscard]] virtual FileWatcherBackend GetBackend( ) const                        = 0;
+
+        /// Falls back to the Polling backend when the requested one isn't available
+        static std::unique_ptr<IFileWatcher> Create( const FileWatcherDesc &desc );
+    };
+
+    class PollingFileWatcher final : public IFileWatcher
+    {
+        FileChangeDebouncer                                              m_debouncer;
+        std::chrono::milliseconds                                        m_pollInterval;
+        std::chrono::steady_clock::time_point                            m_lastScan;
+        std::vector<std::filesystem::path>                               m_directories;
+        std::unordered_map<std::string, std::filesystem::file_time_type> m_writeTimes; // By path, of the files seen by the last scan
+
+    public:
+        explicit PollingFileWatcher( const FileWatcherDesc &desc );
+
+        bool                             Watch( const std::filesystem::path &directory ) override;
+        void                             Poll( std::vector<FileChange> &outChanges ) override;
+        [[nodiscard]] FileWatcherBackend GetBackend( ) const override;
+
+    private:
+        void Scan( const std::filesystem::path &directory, std::unordered_map<std::string, std::filesystem::file_time_type> &outWriteTimes ) const;
+    };
+} // namespace DZEngine
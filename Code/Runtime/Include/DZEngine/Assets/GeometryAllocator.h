@@ -0,0 +1,102 @@
+/*
+Den Of Iz - Game/Game Engine
+Copyright (c) 2020-2024 Muhammed Murat Cengiz
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <limits>
+#include <map>
+#include <vector>
+
+namespace DZEngine
+{
+    struct GeometryAllocatorDesc
+    {
+        size_t Capacity = 0; // In units, the owner decides what a unit is (a vertex, 4 index bytes, ...)
+    };
+
+    struct GeometryAllocation
+    {
+        static constexpr size_t Invalid = std::numeric_limits<size_t>::max( );
+
+        size_t Offset = Invalid;
+        size_t Size   = 0;
+
+        [[nodiscard]] bool IsValid( ) const
+        {
+            return Offset != Invalid;
+        }
+    };
+
+    struct GeometryMove
+    {
+        size_t SrcOffset;
+        size_t DstOffset;
+        size_t Size;
+    };
+
+    struct GeometryAllocatorStats
+    {
+        size_t Capacity         = 0;
+        size_t UsedSize         = 0;
+        size_t FreeSize         = 0;
+        size_t LargestFreeBlock = 0;
+        size_t NumFreeBlocks    = 0;
+        size_t NumAllocations   = 0;
+        size_t HighWaterMark    = 0;    // End of the last live allocation
+        size_t FirstFreeOffset  = 0;    // Start of the lowest free block, Capacity when there is none
+        float  Fragmentation    = 0.0f; // 1 - LargestFreeBlock / FreeSize, 0 when all free space is a single block
+    };
+
+    /// Best fit free list allocator for ranges of the mesh mega buffers. Only bookkeeping, no GPU resources, freed neighbours are coalesced.
+    /// Defragmentation is incremental: PlanDefragment moves live ranges towards the start of the buffer and keeps their old ranges reserved
+    /// until CompleteDefragment, so the caller can copy the data on the GPU and patch its offsets once the copies have finished.
+    /// Several owners can share one allocator, each plans and completes the moves of its own ranges.
+    class GeometryAllocator
+    {
+        size_t m_capacity;
+
+        std::map<size_t, size_t>      m_freeBlocks;  // Offset -> Size
+        std::multimap<size_t, size_t> m_freeBySize;  // Size -> Offset
+        std::map<size_t, size_t>      m_allocations; // Offset -> Size, includes the sources of pending moves
+        std::vector<GeometryMove>     m_pendingMoves;
+
+    public:
+        explicit GeometryAllocator( const GeometryAllocatorDesc &desc );
+
+        GeometryAllocation Allocate( size_t size );
+        void               Free( const GeometryAllocation &allocation );
+        /// Appends [ capacity, newCapacity ) as free space, shrinking is not supported
+        void Grow( size_t newCapacity );
+
+        /// Moves at most maxSize units of the allocations accepted by canMove (all when empty), returns the moves in the order they should be copied
+        std::vector<GeometryMove> PlanDefragment( size_t maxSize, const std::function<bool( size_t offset )> &canMove = { } );
+        /// Releases the source ranges of the planned moves, call once the copies are complete
+        void               CompleteDefragment( const std::vector<GeometryMove> &moves );
+        [[nodiscard]] bool HasPendingDefragment( ) const;
+
+        [[nodiscard]] GeometryAllocatorStats GetStats( ) const;
+        [[nodiscard]] size_t                 GetCapacity( ) const;
+
+    private:
+        [[nodiscard]] bool IsPendingMove( size_t offset ) const;
+        void               InsertFreeBlock( size_t offset, size_t size );
+        void               EraseFreeBlock( std::map<size_t, size_t>::iterator block );
+    };
+} // namespace DZEngine
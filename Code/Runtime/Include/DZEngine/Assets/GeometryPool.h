@@ -0,0 +1,134 @@
+/*
+Den Of Iz - Game/Game Engine
+Copyright (c) 2020-2024 Muhammed Murat Cengiz
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <DenOfIzGraphics/DenOfIzGraphics.h>
+#include <mutex>
+#include "GeometryAllocator.h"
+#include "VertexQuantization.h"
+
+namespace DZEngine
+{
+    enum class GeometryLayout
+    {
+        Traditional,
+        GPUDriven /*Vertex Buffers are created as structured buffers*/
+    };
+
+    enum class GeometryStream
+    {
+        Vertices, // Units are vertices, the position stream shares the allocation
+        Indices   // Units are GeometryPool::IndexAllocationUnit bytes
+    };
+
+    struct GeometryPoolDesc
+    {
+        ILogicalDevice *LogicalDevice;
+        GeometryLayout  GeometryLayout         = GeometryLayout::GPUDriven;
+        VertexFormat    VertexFormat           = VertexFormat::Full;
+        bool            SeparatePositionStream = false;
+
+        size_t PageBytes            = 4194304; // Both buffers grow in multiples of this
+        size_t InitialVertexBytes   = 0;       // Rounded up to pages, at least one page is created
+        size_t InitialIndexBytes    = 0;
+        size_t MaxVertexBufferBytes = 1073741824;
+        size_t MaxIndexBufferBytes  = 536870912;
+    };
+
+    struct GeometryPoolStats
+    {
+        size_t                 VertexCapacityBytes;
+        size_t                 IndexCapacityBytes;
+        size_t                 ReservedVertexBytes; // Sum of the reservations of the batches sharing the pool
+        size_t                 ReservedIndexBytes;
+        uint32_t               NumGrowths;
+        uint32_t               FreeVersion; // Changes whenever space is freed or added, a defragment that found no move can only find one after that
+        GeometryAllocatorStats Vertices;
+        GeometryAllocatorStats Indices;
+    };
+
+    /// Vertex, index and optional position buffers shared by several MeshBatches with the same layout and vertex format. Buffers start small
+    /// and grow page by page on demand: a larger buffer is created, the live range is copied on the GPU with the copy list of the batch that
+    /// needed the space and the old buffer is retired. GetVersion changes with every growth so bindings know to pick up the new buffers, and
+    /// retired buffers are kept until ReleaseRetiredBuffers, which must only be called once no in flight frame uses them, see AssetBatcher::UpdateResidency.
+    class GeometryPool
+    {
+    public:
+        static constexpr size_t IndexAllocationUnit = sizeof( uint32_t ); // Keeps Uint16 and Uint32 ranges 4 byte aligned
+
+    private:
+        struct Stream
+        {
+            GeometryAllocator                Allocator{ GeometryAllocatorDesc{ } };
+            std::unique_ptr<IBufferResource> Buffer;
+            std::unique_ptr<IBufferResource> PositionBuffer; // Vertices only
+            uint32_t                         Stride        = 0;
+            size_t                           MaxUnits      = 0;
+            size_t                           ReservedUnits = 0;
+        };
+
+        ILogicalDevice  *m_logicalDevice;
+        GeometryPoolDesc m_desc;
+        Stream           m_vertices;
+        Stream           m_indices;
+        uint32_t         m_version     = 0;
+        uint32_t         m_numGrowths  = 0;
+        uint32_t         m_freeVersion = 0;
+
+        struct RetiredBuffer
+        {
+            uint32_t                         Version; // GetVersion once it was replaced
+            std::unique_ptr<IBufferResource> Buffer;
+        };
+
+        std::vector<RetiredBuffer> m_retiredBuffers;
+        mutable std::mutex         m_lock;
+
+    public:
+        explicit GeometryPool( const GeometryPoolDesc &desc );
+
+        /// Grows the pool if the reservation can't fit, copy may only be null while the pool is empty
+        void               Reserve( GeometryStream stream, size_t size, BatchResourceCopy *copy = nullptr );
+        void               Unreserve( GeometryStream stream, size_t size );
+        /// Without a copy list the pool only grows while it is empty, otherwise an invalid allocation is returned
+        GeometryAllocation Allocate( GeometryStream stream, size_t size, BatchResourceCopy *copy );
+        void               Free( GeometryStream stream, const GeometryAllocation &allocation );
+
+        /// Plans the moves of the ranges accepted by canMove and records their GPU copies, see GeometryAllocator::PlanDefragment
+        std::vector<GeometryMove> Defragment( GeometryStream stream, size_t maxSize, const std::function<bool( size_t offset )> &canMove, BatchResourceCopy *copy );
+        void                      CompleteDefragment( GeometryStream stream, const std::vector<GeometryMove> &moves );
+
+        /// Destroys the buffers replaced by the growths up to version, every one of them by default
+        void ReleaseRetiredBuffers( uint32_t version = UINT32_MAX );
+
+        [[nodiscard]] IBufferResource  *GetBuffer( GeometryStream stream ) const;
+        [[nodiscard]] IBufferResource  *GetPositionBuffer( ) const;
+        [[nodiscard]] uint32_t          GetStride( GeometryStream stream ) const; // Bytes per unit
+        [[nodiscard]] size_t            GetHighWaterMark( GeometryStream stream ) const;
+        [[nodiscard]] uint32_t          GetVersion( ) const;
+        [[nodiscard]] GeometryPoolStats GetStats( ) const;
+        [[nodiscard]] bool              IsCompatible( GeometryLayout layout, VertexFormat vertexFormat, bool separatePositionStream ) const;
+
+    private:
+        Stream                          &GetStream( GeometryStream stream );
+        [[nodiscard]] const Stream      &GetStream( GeometryStream stream ) const;
+        bool                             Grow( GeometryStream stream, size_t minUnits, BatchResourceCopy *copy );
+        std::unique_ptr<IBufferResource> CreateBuffer( GeometryStream stream, size_t numUnits, bool positions ) const;
+    };
+} // namespace DZEngine
@@ -0,0 +1,50 @@
+/*
+Den Of Iz - Game/Game Engine
+Copyright (c) 2020-2024 Muhammed Murat Cengiz
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "FileWatcher.h"
+
+#ifdef __linux__
+namespace DZEngine
+{
+    /// inotify only watches single directories, every directory below a watched one gets its own watch descriptor, including the ones created
+    /// later. Events are read without blocking in Poll and fed to the debouncer, a queue overflow loses events and is only reported.
+    class InotifyFileWatcher final : public IFileWatcher
+    {
+        int                                            m_inotify = -1;
+        FileChangeDebouncer                            m_debouncer;
+        std::unordered_map<int, std::filesystem::path> m_directories; // By watch descriptor
+        std::vector<char>                              m_buffer;
+
+    public:
+        explicit InotifyFileWatcher( const FileWatcherDesc &desc );
+        ~InotifyFileWatcher( ) override;
+
+        [[nodiscard]] bool               IsValid( ) const;
+        bool                             Watch( const std::filesystem::path &directory ) override;
+        void                             Poll( std::vector<FileChange> &outChanges ) override;
+        [[nodiscard]] FileWatcherBackend GetBackend( ) const override;
+
+    private:
+        bool AddWatch( const std::filesystem::path &directory );
+        void WatchNewDirectory( const std::filesystem::path &directory, std::chrono::steady_clock::time_point now ); // Reports the files it already contains
+        void Read( std::chrono::steady_clock::time_point now );
+    };
+} // namespace DZEngine
+#endif
@@ -0,0 +1,99 @@
+/*
+Den Of Iz - Game/Game Engine
+Copyright (c) 2020-2024 Muhammed Murat Cengiz
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "FileIO.h"
+
+#ifdef __linux__
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct io_uring_sqe;
+struct io_uring_cqe;
+
+namespace DZEngine
+{
+    /// Read prepares one submission queue entry per read and submits all of them with a single io_uring_enter. A completion thread reaps the
+    /// completion queue, resubmits short reads and completes the batches. Reads that fit a registered buffer use READ_FIXED and are copied out,
+    /// larger ones land directly in FileRead::Dst. Every batch must be complete before the backend is destroyed.
+    class IoUringFileIO final : public IFileIO
+    {
+        static constexpr uint32_t MaxReadNumBytes = 1u << 30; // Per submission, larger reads continue like short reads
+
+        struct Operation
+        {
+            FileRead      *Read;
+            FileReadBatch *Batch;
+            int            File;
+            int            BufferIndex; // Registered buffer, -1 to read into FileRead::Dst
+        };
+
+        int m_ring = -1;
+
+        void         *m_sqRing         = nullptr;
+        size_t        m_sqRingNumBytes = 0;
+        void         *m_cqRing         = nullptr; // Same as m_sqRing with IORING_FEAT_SINGLE_MMAP
+        size_t        m_cqRingNumBytes = 0;
+        io_uring_sqe *m_sqes           = nullptr;
+        size_t        m_sqesNumBytes   = 0;
+        uint32_t     *m_sqTail         = nullptr;
+        uint32_t      m_sqMask         = 0;
+        uint32_t     *m_sqArray        = nullptr;
+        uint32_t     *m_cqHead         = nullptr;
+        uint32_t     *m_cqTail         = nullptr;
+        uint32_t      m_cqMask         = 0;
+        io_uring_cqe *m_cqes           = nullptr;
+
+        Byte    *m_buffers         = nullptr; // NumRegisteredBuffers * RegisteredBufferSize, registered with the ring
+        size_t   m_buffersNumBytes = 0;
+        uint32_t m_bufferSize      = 0;
+
+        // Guards the submission queue and the free lists, the completion queue is only touched by m_completionThread
+        std::mutex              m_submitLock;
+        std::condition_variable m_operationFreed;
+        std::vector<Operation>  m_operations;
+        std::vector<uint32_t>   m_freeOperations;
+        std::vector<int>        m_freeBuffers;
+        uint32_t                m_numUnsubmitted = 0;
+        std::thread             m_completionThread;
+
+    public:
+        explicit IoUringFileIO( const FileIODesc &desc );
+        ~IoUringFileIO( ) override;
+
+        [[nodiscard]] bool          IsValid( ) const;
+        void                        Read( std::span<FileRead> reads, FileReadBatch &batch ) override;
+        [[nodiscard]] FileIOBackend GetBackend( ) const override;
+
+    private:
+        bool CreateRing( uint32_t queueDepth );
+        void RegisterBuffers( const FileIODesc &desc );
+        void PrepareRead( uint32_t operationIndex ); // Requires m_submitLock
+        void PrepareNop( );                          // Requires m_submitLock, wakes the completion thread up to exit
+        void SubmitPending( );                       // Requires m_submitLock
+        void FailUnsubmitted( );                     // Requires m_submitLock, completes the reads io_uring_enter couldn't submit as failed
+        void CompletionLoop( );
+        void Complete( uint64_t userData, int result ); // Completion thread only
+        void Finish( uint32_t operationIndex );
+        void Unmap( );
+    };
+} // namespace DZEngine
+#endif
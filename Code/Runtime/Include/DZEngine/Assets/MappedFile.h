@@ -0,0 +1,49 @@
+/*
+Den Of Iz - Game/Game Engine
+Copyright (c) 2020-2024 Muhammed Murat Cengiz
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <DenOfIzGraphics/Assets/Stream/BinaryReader.h>
+#include <filesystem>
+
+using namespace DenOfIz;
+
+namespace DZEngine
+{
+    /// Read only mapping of a whole file, unmapped on destruction
+    class MappedFile
+    {
+        const Byte *m_data        = nullptr;
+        size_t      m_numBytes    = 0;
+        void       *m_fileMapping = nullptr; // Windows only
+
+    public:
+        MappedFile( ) = default;
+        explicit MappedFile( const std::filesystem::path &path ); // Invalid when the file is missing or empty
+        ~MappedFile( );
+        MappedFile( MappedFile &&other ) noexcept;
+        MappedFile &operator=( MappedFile &&other ) noexcept;
+        MappedFile( const MappedFile & )            = delete;
+        MappedFile &operator=( const MappedFile & ) = delete;
+
+        [[nodiscard]] bool        IsValid( ) const;
+        [[nodiscard]] const Byte *GetData( ) const;
+        [[nodiscard]] size_t      GetNumBytes( ) const;
+        void                      Unmap( );
+    };
+} // namespace DZEngine
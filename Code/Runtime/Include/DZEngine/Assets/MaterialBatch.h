@@ -21,6 +21,9 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 #include <DenOfIzGraphics/DenOfIzGraphics.h>
 #include "DZEngine/Components/AssetHandle.h"
 #include "MeshAssetData.h"
+#include "SlotMap.h"
+
+#include <shared_mutex>
 
 namespace DZEngine
 {
@@ -64,18 +67,16 @@ namespace DZEngine
         ILogicalDevice                    *m_logicalDevice;
         std::unique_ptr<BatchResourceCopy> m_batchResourceCopy;
 
-        std::vector<ITextureResource *>            m_textures;
-        std::vector<std::unique_ptr<MaterialData>> m_materialData;
+        // Guards the texture tables, the getters hold it shared
+        mutable std::shared_mutex                                       m_textureLock;
+        SlotMap<ITextureResource *>                                     m_textures;       // Index( ) of a texture handle is its slot in the bindless texture array
+        std::unordered_map<uint32_t, std::unique_ptr<ITextureResource>> m_loadedTextures; // Created by LoadTexture, AddTexture doesn't take ownership
+        std::unordered_map<std::string, TextureHandle>                  m_texAliases;
 
-        std::unordered_map<std::string, TextureHandle>  m_texAliases;
+        mutable std::shared_mutex                       m_materialLock;
+        SlotMap<std::unique_ptr<MaterialData>>          m_materialData;
         std::unordered_map<std::string, MaterialHandle> m_matAliases;
 
-        std::mutex m_nextTexHandleLock;
-        size_t     m_nextTexHandle = 0;
-
-        std::mutex m_nextMatHandleLock;
-        size_t     m_nextMatHandle = 0;
-
     public:
         explicit MaterialBatch( const MaterialBatchDesc &desc );
         ~MaterialBatch( ) = default;
@@ -86,17 +87,22 @@ namespace DZEngine
         TextureHandle  LoadTexture( const std::string &alias, BinaryReader &reader );
         TextureHandle  AddTexture( const std::string &alias, ITextureResource *texture );
         MaterialHandle AddMaterial( const std::string &alias, MaterialDataRequest material );
+        // No in flight frame may still use what is removed, its handles stop resolving. Loaded textures are destroyed.
+        bool RemoveTexture( TextureHandle handle );
+        bool RemoveMaterial( MaterialHandle handle );
+        // Swap the contents of both handles so target resolves to what was added as replacement, used to reload an asset in place.
+        // Pointers returned by the getters stay valid, aliases of replacement move to target. Removing replacement destroys the previous contents.
+        bool ReplaceTexture( TextureHandle target, TextureHandle replacement );
+        bool ReplaceMaterial( MaterialHandle target, MaterialHandle replacement );
 
         MaterialData *GetMaterial( const std::string &alias ) const;
         MaterialData *GetMaterial( MaterialHandle handle ) const;
 
         ITextureResource *GetTexture( const std::string &alias ) const;
         ITextureResource *GetTexture( TextureHandle handle ) const;
+        // Slot of the texture in the bindless texture array, 0 for invalid handles and handles of removed textures
+        uint32_t GetTextureIndex( TextureHandle handle ) const;
 
         std::vector<TextureData> GetTextures( ) const;
-
-    private:
-        size_t NextTextureHandle( const std::string &alias );
-        size_t NextMaterialHandle( const std::string &alias );
     };
 } // namespace DZEngine
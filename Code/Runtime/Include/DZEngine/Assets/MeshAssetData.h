@@ -5,6 +5,7 @@
 #include <string>
 #include <vector>
 #include "DenOfIzGraphics/Assets/Serde/Mesh/MeshAsset.h"
+#include "StaticMeshVertex.h"
 
 using namespace DenOfIz;
 
@@ -41,6 +42,15 @@ namespace DZEngine
         CapsuleBoundingVolume Capsule;
     };
 
+    struct SubMeshLOD
+    {
+        // Mesh user property of type Float4 per level: base submesh index, submesh index of the level, level, error
+        static constexpr auto PropertyName = "DZ.LOD";
+
+        uint32_t SubMeshIndex = 0;    // Into MeshAssetData::SubMeshes
+        float    Error        = 0.0f; // Largest deviation from the base submesh in mesh units, see MeshSimplifier
+    };
+
     struct SubMeshData
     {
         std::string                 Name;
@@ -52,6 +62,8 @@ namespace DZEngine
         Float3                      MaxBounds;
         std::string                 MaterialRef;
         std::vector<BoundingVolume> BoundingVolumes;
+        std::vector<SubMeshLOD>     LODs;       // Coarser levels of this submesh from the most detailed, appended after the base submeshes
+        int32_t                     LODOf = -1; // Index of the base submesh when this submesh is one of its levels of detail
     };
 
     struct UserProperty
@@ -77,6 +89,8 @@ namespace DZEngine
 
         static MeshAssetData LoadFromMeshAsset( const MeshAsset &meshAsset );
         size_t               GetVertexNumBytes( ) const;
+        // Reads vertices laid out as described by EnabledAttributes/AttributeConfig, only the first UV and color channels are kept
+        void UnpackVertices( const Byte *data, size_t numVertices, StaticMeshVertex *outVertices ) const;
         size_t               GetTotalNumVertices( ) const;
         size_t               GetTotalNumIndices( ) const;
         void                 GetBounds( Float3 &outMin, Float3 &outMax ) const;
@@ -0,0 +1,58 @@
+/*
+Den Of Iz - Game/Game Engine
+Copyright (c) 2020-2024 Muhammed Murat Cengiz
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <filesystem>
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+
+namespace DZEngine
+{
+    struct MeshAssetProcessorDesc
+    {
+        bool             Optimize = true; // Reorders the base submeshes and the levels with MeshOptimizer
+        MeshLODChainDesc LODs;            // No levels when NumLevels is 0
+    };
+
+    struct MeshAssetProcessorStats
+    {
+        size_t NumSubMeshes;     // Base submeshes that got at least one level
+        size_t NumLODs;          // Levels appended to the mesh
+        size_t NumBaseTriangles; // Of the simplified base submeshes
+        size_t NumLODTriangles;  // Of every level
+        float  MaxError;         // Of the coarsest levels, in mesh units
+        size_t NumOptimized;     // Optimized submeshes, levels included
+        float  ACMRBefore;       // Of the base triangle submeshes, see MeshOptimizer::AnalyzeVertexCache
+        float  ACMRAfter;
+    };
+
+    /// Cook time processing of a mesh asset, runs on every triangle submesh:
+    /// - Optimize deduplicates the vertices and reorders triangles and vertices for the vertex cache, overdraw and vertex fetch
+    /// - LODs generates the levels of detail and appends them to the asset as additional submeshes
+    /// A level only holds the vertices it references and shares the material of its base submesh, the SubMeshLOD::PropertyName user properties
+    /// of the mesh link the levels to their base submesh with their error, see SubMeshData::LODs. Levels are optimized as well.
+    ///
+    /// Meshes with morph targets or convex hull bounding volumes are left as they are, the per submesh streams of both would need to be remapped.
+    class MeshAssetProcessor
+    {
+    public:
+        // Rewrites the asset in place, true when it was rewritten or left as it is
+        static bool Process( const std::filesystem::path &meshPath, const MeshAssetProcessorDesc &desc, MeshAssetProcessorStats *outStats = nullptr );
+    };
+} // namespace DZEngine
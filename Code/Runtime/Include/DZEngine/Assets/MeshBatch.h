@@ -21,23 +21,59 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 #include <DenOfIzGraphics/DenOfIzGraphics.h>
 #include "DZEngine/Components/AssetHandle.h"
 #include "DenOfIzGraphics/Support/GPUBufferView.h"
+#include "GeometryPool.h"
 #include "MeshAssetData.h"
+#include "SlotMap.h"
+#include "UploadBuffer.h"
+
+#include <atomic>
+#include <deque>
+#include <map>
+#include <shared_mutex>
+#include <span>
+#include <thread>
 
 namespace DZEngine
 {
-    enum class GeometryLayout
-    {
-        Traditional,
-        GPUDriven /*Vertex Buffers are created as structured buffers*/
-    };
-
     struct MeshBatchDesc
     {
         ILogicalDevice *LogicalDevice;
         GeometryLayout  GeometryLayout = GeometryLayout::GPUDriven;
+        VertexFormat    VertexFormat   = VertexFormat::Full; // Compact is only decoded by the GPUDriven shaders
+        // Keeps a tightly packed copy of the positions for depth only passes, see VertexQuantization::PositionStride
+        bool SeparatePositionStream = false;
+        // Submeshes with at most 65536 vertices store Uint16 indices, the index buffer then holds ranges of both widths
+        bool Allow16BitIndices = true;
+        // AddGeometry reorders triangles and vertices for the vertex cache, overdraw and vertex fetch, see MeshOptimizer. Meshes are optimized when cooked.
+        bool OptimizeGeometry = true;
 
-        size_t MaxVertexBufferBytes = 67108864;
+        // Shared with other batches of the same layout and format, when null the batch creates a private pool from the sizes below
+        GeometryPool *Pool                = nullptr;
+        size_t        ReservedVertexBytes = 1048576; // Initial reservation in the pool, the pool grows past it on demand
+        size_t        ReservedIndexBytes  = 524288;
+
+        size_t MaxVertexBufferBytes = 67108864; // Private pool only
         size_t MaxIndexBufferBytes  = 33554432;
+
+        // Vertex and index payloads are read or converted straight into this much mapped memory and copied to the pool from it.
+        // Uploads that don't fit, or all of them when 0, are staged by BatchResourceCopy with an extra copy.
+        size_t UploadBufferNumBytes = 16777216;
+    };
+
+    struct MeshBatchUploadStats
+    {
+        size_t NumUploadedBytes;      // Copied to the pool from the upload buffer
+        size_t NumStagedBytes;        // Staged by BatchResourceCopy as the upload buffer was full or disabled
+        size_t NumCopiedBytes;        // Moved between CPU buffers on the way to the GPU, reads and conversions aren't counted
+        size_t PeakUploadBufferBytes; // Most of the upload buffer used by a single update
+    };
+
+    struct MeshBatchGeometryUsage
+    {
+        size_t UsedVertexBytes;
+        size_t ReservedVertexBytes; // max( reservation, used )
+        size_t UsedIndexBytes;
+        size_t ReservedIndexBytes;
     };
 
     struct GPUSubMesh
@@ -46,6 +82,8 @@ namespace DZEngine
         SubMeshData  *Metadata;
         GPUBufferView VertexBuffer;
         GPUBufferView IndexBuffer;
+        GPUBufferView PositionBuffer; // Empty unless MeshBatchDesc::SeparatePositionStream is set
+        IndexType     IndexType = IndexType::Uint32; // Width of the indices in IndexBuffer, may differ from the source asset
     };
 
     struct GPUMesh
@@ -58,43 +96,181 @@ namespace DZEngine
     {
         ILogicalDevice *m_logicalDevice;
         GeometryLayout  m_geometryLayout;
+        VertexFormat    m_vertexFormat;
+        bool            m_separatePositionStream;
+        bool            m_allow16BitIndices;
+        bool            m_optimizeGeometry;
 
-        std::unique_ptr<IBufferResource> m_vertexBuffer;
-        std::unique_ptr<IBufferResource> m_indexBuffer;
+        static constexpr size_t IndexAllocationUnit = GeometryPool::IndexAllocationUnit;
 
-        size_t m_nextVertexOffset = 0;
-        size_t m_nextIndexOffset  = 0;
+        struct MeshRanges
+        {
+            GeometryAllocation Vertices; // In vertices
+            GeometryAllocation Indices;  // In IndexAllocationUnit
+        };
 
-        std::vector<std::unique_ptr<MeshAssetData>> m_meshDataStorage;
+        struct PublishedSubMesh
+        {
+            GPUSubMesh SubMesh;
+            size_t     MeshIndex = 0; // Into m_meshes
+        };
 
-        std::mutex m_nextHandleLock;
-        size_t     m_nextHandle = 0;
+        GeometryPool                 *m_pool;
+        std::unique_ptr<GeometryPool> m_ownedPool;
+        size_t                        m_reservedVertices;
+        size_t                        m_reservedIndexUnits;
+        size_t                        m_usedVertices   = 0;
+        size_t                        m_usedIndexUnits = 0;
 
-        std::mutex              m_newMeshLock;
-        std::vector<GPUMesh>    m_meshes;
-        std::vector<GPUSubMesh> m_subMeshes;
+        struct CommittedMoves
+        {
+            uint32_t                  Version; // GetDefragmentVersion after the commit
+            std::vector<GeometryMove> Vertices;
+            std::vector<GeometryMove> Indices;
+        };
+
+        std::unordered_map<size_t, MeshRanges> m_meshRanges;         // Index into m_meshes -> ranges
+        std::map<size_t, size_t>               m_vertexRangeOwners;  // Allocation offset -> index into m_meshes, ordered to find the last range
+        std::map<size_t, size_t>               m_indexRangeOwners;   // Allocation offset -> index into m_meshes
+        std::vector<GeometryMove>              m_pendingVertexMoves; // Applied to the submeshes in CommitDefragment
+        std::vector<GeometryMove>              m_pendingIndexMoves;
+        std::deque<CommittedMoves>             m_committedMoves;     // Source ranges still reserved for the frames in flight
+        uint32_t                               m_defragmentVersion  = 0;
+        uint32_t                               m_stalledFreeVersion = UINT32_MAX; // GeometryPoolStats::FreeVersion of the last Defragment that moved nothing
+
+        size_t m_numIndexBytes16 = 0;
+        size_t m_numIndexBytes32 = 0;
+
+        std::vector<std::unique_ptr<MeshAssetData>> m_meshDataStorage;
+
+        // Guards the mesh tables, AddMesh only takes it exclusively to publish a mesh whose uploads are already recorded
+        // Submesh handles are handed out there too instead of from an atomic counter: a SlotMap id needs its slot and generation, which
+        // only the map knows, and taking a free slot is a pop next to the table inserts that publishing does under the same lock anyway
+        mutable std::shared_mutex m_newMeshLock;
+        std::vector<GPUMesh>      m_meshes;
+        std::vector<size_t>       m_freeMeshIndices; // Slots of m_meshes cleared by RemoveMesh, reused by the next PublishMesh
+        SlotMap<PublishedSubMesh> m_subMeshes; // Submesh handles are ids of this map, assigned when the mesh is published
 
         std::unordered_map<std::string, MeshHandle> m_aliases;
         std::unordered_map<std::string, size_t>     m_parentMeshes;
-        std::unique_ptr<BatchResourceCopy>          m_batchResourceCopy;
+
+        // Recording uploads holds it shared, growing the pool, Defragment and EndUpdate hold it exclusively
+        std::shared_mutex                  m_geometryLock;
+        std::atomic<bool>                  m_updating   = false;
+        std::atomic<bool>                  m_hasUploads = false; // Since BeginUpdate, Defragment refuses to run alongside uploads
+        std::thread::id                    m_updateThread;
+        std::unique_ptr<BatchResourceCopy> m_batchResourceCopy; // Owned by the thread that called BeginUpdate, signals onComplete
+        std::mutex                         m_threadCopyLock;
+        std::unordered_map<std::thread::id, std::unique_ptr<BatchResourceCopy>> m_threadCopies; // One copy list per other thread adding meshes
+
+        struct SubmittedCopy
+        {
+            std::unique_ptr<BatchResourceCopy> Copy;
+            std::unique_ptr<ISemaphore>        Semaphore;
+        };
+        std::vector<SubmittedCopy> m_submittedCopies; // Lists of the other threads kept alive until their copies complete
+
+        std::unique_ptr<UploadBuffer> m_uploadBuffer; // Null when MeshBatchDesc::UploadBufferNumBytes is 0
+        std::atomic<size_t>           m_numUploadedBytes = 0;
+        std::atomic<size_t>           m_numStagedBytes   = 0;
+        std::atomic<size_t>           m_numCopiedBytes   = 0;
+
+        struct StagedUpload
+        {
+            IBufferResource  *DstBuffer = nullptr;
+            size_t            DstOffset = 0;
+            size_t            NumBytes  = 0;
+            UploadAllocation  Allocation;
+            std::vector<Byte> Staging;        // Only used when the upload buffer is full
+            Byte             *Data = nullptr; // Write only, may be write combined
+        };
 
     public:
         explicit MeshBatch( const MeshBatchDesc &desc );
+        ~MeshBatch( );
 
         void BeginUpdate( );
         void EndUpdate( ISemaphore *onComplete = nullptr ); // nullptr will block execution
+        // onComplete only covers the list of the BeginUpdate thread, the lists of the other threads are polled here
+        [[nodiscard]] bool IsUpdateComplete( );
 
+        // AddMesh and AddGeometry may be called from any number of threads between BeginUpdate and EndUpdate, every call has to return before EndUpdate.
+        // Each thread records into its own copy list, EndUpdate submits the lists of the other threads blocking unless onComplete is given.
+        // Batches sharing a GeometryPool must not be updated concurrently, a growing pool only flushes the uploads of the batch that grew it.
         GPUMesh AddMesh( BinaryReader &reader, const std::vector<std::string> &aliases = { /*Index matches submesh index*/ } );
         GPUMesh AddGeometry( const GeometryData *geometry, std::string alias = "" );
+        // Removes the mesh the submesh belongs to, its ranges are reused by the next AddMesh so no in flight frame may still draw it
+        bool RemoveMesh( MeshHandle handle );
+        // The submesh handles of target's mesh resolve to the mesh of replacement and the other way around, both need as many submeshes.
+        // Used to reload a mesh in place, removing replacement afterwards frees the previous geometry.
+        bool ReplaceMesh( MeshHandle target, MeshHandle replacement );
+
+        // Moves up to maxBytesToMove bytes per buffer towards the start of the buffers with GPU copies, call between BeginUpdate and EndUpdate
+        // of an update without AddMesh or AddGeometry calls, nothing orders the copy lists of other threads against the moves on the GPU.
+        // The submesh offsets are patched in CommitDefragment, EndUpdate( nullptr ) commits right away, otherwise call it once onComplete is signaled.
+        // Returns the number of bytes moved.
+        size_t Defragment( size_t maxBytesToMove );
+        void   CommitDefragment( );
+        // True when a range of this batch lies past a hole of the pool and the pool changed since the last Defragment that moved nothing
+        [[nodiscard]] bool NeedsDefragment( ) const;
+        // Frames recorded before a commit still draw from the source ranges, they stay allocated until released here. Frees the sources of
+        // every commit up to version, call once no in flight frame was recorded before GetDefragmentVersion returned it.
+        void                   ReleaseDefragmentSources( uint32_t version );
+        [[nodiscard]] uint32_t GetDefragmentVersion( ) const; // Changes with every CommitDefragment that moved something
+        // Recycles the upload buffer, EndUpdate( nullptr ) releases right away, otherwise call it once onComplete is signaled
+        void ReleaseUploads( );
 
-        [[nodiscard]] GPUSubMesh    GetSubMesh( MeshHandle handle ) const;
-        [[nodiscard]] GPUBufferView GetVertexBuffer( ) const;
-        [[nodiscard]] GPUBufferView GetIndexBuffer( ) const;
+        [[nodiscard]] MeshBatchGeometryUsage GetGeometryUsage( ) const;
+        [[nodiscard]] const GeometryPool    *GetPool( ) const;
+        [[nodiscard]] GeometryPoolStats      GetPoolStats( ) const; // Shared by every batch of the pool
+        [[nodiscard]] uint32_t               GetGeometryVersion( ) const; // Changes when the pool grows and the buffers are replaced
+        [[nodiscard]] MeshBatchUploadStats   GetUploadStats( ) const;
+
+        [[nodiscard]] GPUSubMesh           GetSubMesh( MeshHandle handle ) const;
+        [[nodiscard]] const MeshAssetData *GetMeshMetadata( MeshHandle handle ) const; // Of the mesh the submesh belongs to, null once removed
+        // Levels of detail of a submesh are submeshes of the same mesh, see SubMeshData::LODs. Level 0 is the submesh itself, levels past the
+        // coarsest one return the coarsest one. SelectLOD returns the coarsest level whose error projects to at most maxPixelError pixels,
+        // pixelsPerUnit is the size in pixels of one mesh unit at the distance of the submesh, viewportHeight / ( 2 tan( fovY / 2 ) distance ).
+        [[nodiscard]] uint32_t   GetNumLODs( MeshHandle handle ) const; // 1 when the submesh has no levels of detail
+        [[nodiscard]] GPUSubMesh GetLOD( MeshHandle handle, uint32_t level ) const;
+        [[nodiscard]] MeshHandle SelectLOD( MeshHandle handle, float pixelsPerUnit, float maxPixelError = 1.0f ) const;
+        [[nodiscard]] GPUBufferView        GetVertexBuffer( ) const;
+        [[nodiscard]] GPUBufferView        GetIndexBuffer( ) const;
+        [[nodiscard]] VertexFormat         GetVertexFormat( ) const;
+        [[nodiscard]] uint32_t             GetVertexStride( ) const;
+        [[nodiscard]] bool                 HasPositionStream( ) const;
+        [[nodiscard]] GPUBufferView        GetPositionBuffer( ) const; // Elements are indexed the same as the vertex buffer
+        [[nodiscard]] size_t               GetNumIndexBytes( IndexType indexType ) const;
+
+        [[nodiscard]] static uint32_t IndexStride( IndexType indexType );
 
         GPUMesh    GetParentMesh( const std::string &subMeshAlias );
         GPUSubMesh GetSubMesh( const std::string &alias ) const;
 
     private:
-        size_t NextHandle( const std::string &alias );
+        BatchResourceCopy *ThreadCopy( );
+        void               FlushCopies( );
+        // Makes a fully uploaded mesh visible to the getters and hands out its submesh handles, aliases are indexed like the submeshes
+        GPUMesh PublishMesh( GPUMesh mesh, std::unique_ptr<MeshAssetData> metadata, const std::vector<std::string> &aliases, const MeshRanges &ranges );
+        // Data points into the upload buffer when it has space, EndUpload records the copy of the written bytes to the destination
+        StagedUpload BeginUpload( IBufferResource *dstBuffer, size_t dstOffset, size_t numBytes );
+        void         EndUpload( BatchResourceCopy *copy, const StagedUpload &upload );
+        void         UploadStream( BatchResourceCopy *copy, MeshAssetReader &meshReader, BinaryReader &reader, AssetDataStream stream, IBufferResource *dst, size_t dstOffset );
+        void         UploadData( BatchResourceCopy *copy, const Byte *data, size_t numBytes, IBufferResource *dstBuffer, size_t dstOffset );
+        // Quantizes relative to the exact vertex bounds, which are written back to the metadata as the shaders decode with them
+        size_t CopyCompactVertices( BatchResourceCopy *copy, std::span<const StaticMeshVertex> vertices, SubMeshData &metadata, size_t dstOffset );
+        void   CopyPositions( BatchResourceCopy *copy, std::span<const StaticMeshVertex> vertices, size_t dstOffset );
+
+        [[nodiscard]] IndexType SelectIndexType( size_t numVertices ) const;
+        // Every range starts 4 byte aligned so FirstIndex is exact for either width when the whole buffer is bound at offset 0
+        [[nodiscard]] static size_t IndexRangeNumBytes( size_t numIndices, IndexType indexType );
+        // Grows the pool only after flushing the recorded uploads, so none of them can target a replaced buffer
+        bool AllocateRanges( size_t numVertices, size_t numIndexBytes, MeshRanges &outRanges );
+        bool TryAllocateRanges( size_t numVertices, size_t numIndexBytes, BatchResourceCopy *copy, MeshRanges &outRanges ) const;
+        void RegisterRanges( size_t meshIndex, const MeshRanges &ranges ); // Requires m_newMeshLock
+        // Submeshes keep their offsets when the pool grows, the buffers are always the current ones of the pool
+        [[nodiscard]] GPUSubMesh ResolveBuffers( GPUSubMesh subMesh ) const;
+        [[nodiscard]] const SubMeshData *FindBaseSubMesh( const PublishedSubMesh &published ) const; // Requires m_newMeshLock
+        void CopyIndices( BatchResourceCopy *copy, const Byte *indices, size_t numIndices, IndexType srcType, IndexType dstType, size_t dstOffset );
     };
 } // namespace DZEngine
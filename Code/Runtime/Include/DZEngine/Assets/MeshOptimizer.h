@@ -0,0 +1,84 @@
+/*
+Den Of Iz - Game/Game Engine
+Copyright (c) 2020-2024 Muhammed Murat Cengiz
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <DenOfIzGraphics/Utilities/Common_Arrays.h>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+using namespace DenOfIz;
+
+namespace DZEngine
+{
+    struct MeshVertexCacheStats
+    {
+        size_t NumTransformed; // Vertex shader invocations of a FIFO post transform cache
+        float  ACMR;           // Transformed vertices per triangle, 0.5 at best for large regular meshes, 3 at worst
+        float  ATVR;           // Transformed vertices per referenced vertex, 1 at best
+    };
+
+    struct MeshOverdrawStats
+    {
+        size_t NumCovered; // Pixels covered in every view
+        size_t NumShaded;  // Pixels that passed the depth test, some of them shaded more than once
+        float  Overdraw;   // NumShaded / NumCovered, 1 at best
+    };
+
+    struct MeshVertexFetchStats
+    {
+        size_t NumBytesFetched; // In cache lines of a small direct mapped cache
+        float  Overfetch;       // NumBytesFetched per byte of the referenced vertices, 1 at best
+    };
+
+    /// Reorders the triangles and vertices of indexed triangle lists for the GPU, the mesh renders the same in a different order:
+    /// - DeduplicateVertices merges vertices with identical bytes and drops unreferenced ones
+    /// - OptimizeVertexCache orders triangles for post transform cache hits (Forsyth, "Linear-Speed Vertex Cache Optimisation")
+    /// - OptimizeOverdraw splits the cache ordered triangles into clusters and draws the outward facing ones first, keeping the ACMR within
+    ///   threshold of the cache order (Sander et al., "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw")
+    /// - OptimizeVertexFetch orders vertices by first use so consecutive triangles read neighboring memory
+    /// Optimize runs all of them in that order. Vertices are raw bytes of vertexStride, the position is the first three floats of a vertex.
+    ///
+    /// The Analyze functions measure an order on the CPU with the same models, so the stages can be compared and regressions detected.
+    class MeshOptimizer
+    {
+    public:
+        static constexpr uint32_t CacheSize         = 16;    // Post transform cache modelled by the stages and AnalyzeVertexCache
+        static constexpr float    OverdrawThreshold = 1.05f; // ACMR OptimizeOverdraw may give up, relative to the cache order
+
+        // Returns the number of vertices left at the start of vertices
+        static size_t Optimize( Byte *vertices, size_t numVertices, size_t vertexStride, std::vector<uint32_t> &indices, float overdrawThreshold = OverdrawThreshold );
+
+        // Vertices are compacted at the start of vertices in the order of their first use, returns their number
+        static size_t DeduplicateVertices( Byte *vertices, size_t numVertices, size_t vertexStride, std::span<uint32_t> indices );
+        static void   OptimizeVertexCache( std::span<uint32_t> indices, size_t numVertices );
+        static void   OptimizeOverdraw( std::span<uint32_t> indices, const Byte *vertices, size_t numVertices, size_t vertexStride, float threshold = OverdrawThreshold );
+        static size_t OptimizeVertexFetch( Byte *vertices, size_t numVertices, size_t vertexStride, std::span<uint32_t> indices ); // Same as deduplication without merging
+
+        static MeshVertexCacheStats AnalyzeVertexCache( std::span<const uint32_t> indices, size_t numVertices, uint32_t cacheSize = CacheSize );
+        // Rasterizes the mesh from the six axis directions into a small depth buffer, back faces are culled
+        static MeshOverdrawStats    AnalyzeOverdraw( std::span<const uint32_t> indices, const Byte *vertices, size_t numVertices, size_t vertexStride );
+        static MeshVertexFetchStats AnalyzeVertexFetch( std::span<const uint32_t> indices, size_t numVertices, size_t vertexStride );
+
+    private:
+        // Triangle index where each cluster of the cache order starts, a new cluster starts wherever all vertices of a triangle miss the cache
+        static std::vector<uint32_t> FindClusters( std::span<const uint32_t> indices, size_t numVertices, float threshold );
+        static size_t                ReorderVertices( Byte *vertices, size_t numVertices, size_t vertexStride, std::span<uint32_t> indices, std::span<const uint32_t> remap );
+    };
+} // namespace DZEngine
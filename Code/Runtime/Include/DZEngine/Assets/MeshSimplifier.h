@@ -0,0 +1,136 @@
+/*
+Den Of Iz - Game/Game Engine
+Copyright (c) 2020-2024 Muhammed Murat Cengiz
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <cfloat>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace DZEngine
+{
+    struct MeshSimplifierDesc
+    {
+        const float              *Positions      = nullptr;             // x, y, z of the first vertex
+        size_t                    PositionStride = 3 * sizeof( float ); // Bytes between consecutive positions
+        size_t                    NumVertices    = 0;
+        std::span<const uint32_t> Indices; // Triangle list
+    };
+
+    struct MeshLODChainDesc
+    {
+        uint32_t NumLevels       = 3;       // Levels generated past the base mesh, 0 disables the chain
+        float    Reduction       = 0.5f;    // Triangles of each level relative to the previous one
+        float    MaxError        = FLT_MAX; // In mesh units, the chain stops at the first level that would exceed it
+        size_t   MinNumTriangles = 32;      // No level is made of fewer triangles
+        float    MinProgress     = 0.9f;    // A level keeping more than this fraction of the triangles of the previous one ends the chain
+    };
+
+    struct MeshLODLevel
+    {
+        std::vector<uint32_t> Indices; // Into the vertices of the simplified mesh
+        float                 Error = 0.0f;
+    };
+
+    /// Edge collapse simplification driven by quadric error metrics (Garland and Heckbert), every collapse moves a vertex onto one of its neighbors
+    /// so the vertices of the source mesh are kept and only the indices change.
+    ///
+    /// Vertices sharing a position with different indices are the two sides of an attribute seam, UV islands or hard normals. A seam vertex only
+    /// collapses along the seam and together with its other side, open borders only collapse along the border and corners where either meet more
+    /// than two edges are locked, so simplification never tears the mesh or smears attributes across a seam. Collapses flipping a triangle are
+    /// rejected. Borders and seams carry extra quadrics keeping their outline.
+    ///
+    /// Simplify continues from the previous result so a chain of levels costs about as much as its most detailed level. Errors are the largest
+    /// quadric distance of any collapse so far, in mesh units, and grow monotonically along the chain.
+    class MeshSimplifier
+    {
+        enum class VertexKind : uint8_t
+        {
+            Manifold, // Interior, collapses towards any neighbor
+            Border,   // On an open edge, collapses along it
+            Seam,     // Shares its position with one other vertex, collapses along the seam with it
+            Locked
+        };
+
+        struct Position
+        {
+            float X, Y, Z;
+        };
+
+        struct Quadric
+        {
+            double A00 = 0, A11 = 0, A22 = 0, A10 = 0, A20 = 0, A21 = 0;
+            double B0 = 0, B1 = 0, B2 = 0;
+            double C      = 0;
+            double Weight = 0;
+
+            void   AddPlane( double a, double b, double c, double d, double weight );
+            void   Add( const Quadric &other );
+            double Error( const Position &position ) const; // Weighted mean of the squared distances to the planes
+        };
+
+        struct OpenEdge
+        {
+            uint32_t Corner; // Of the triangle the edge leaves, into the indices
+            bool     Seam;   // The other side of the seam has the opposite edge, otherwise the edge is a border of the surface
+        };
+
+        struct Collapse
+        {
+            uint32_t Vertex;
+            uint32_t Target;
+            float    Error; // Squared, normalized
+        };
+
+        static constexpr uint32_t InvalidVertex = ~0u;
+
+        std::vector<Position>   m_positions;    // Normalized into the unit cube for the precision of the quadrics
+        float                   m_scale = 1.0f; // Of the normalization, errors are scaled back by it
+        std::vector<uint32_t>   m_remap;        // First vertex with the same position
+        std::vector<uint32_t>   m_wedges;       // Next vertex with the same position, a ring per position
+        std::vector<VertexKind> m_kinds;
+        std::vector<uint32_t>   m_openNext; // The other vertex of the open edge leaving the vertex
+        std::vector<uint32_t>   m_openPrev; // The other vertex of the open edge arriving at the vertex
+        std::vector<Quadric>    m_quadrics; // By position, at m_remap of the vertex
+        std::vector<uint32_t>   m_indices;
+        float                   m_error = 0.0f; // Squared, normalized
+
+    public:
+        explicit MeshSimplifier( const MeshSimplifierDesc &desc );
+
+        // Collapses edges until at most targetNumIndices indices remain or the next collapse would exceed maxError, in mesh units.
+        // Returns the number of indices left, more than targetNumIndices when every remaining collapse is locked or too expensive.
+        size_t                                     Simplify( size_t targetNumIndices, float maxError = FLT_MAX );
+        [[nodiscard]] const std::vector<uint32_t> &GetIndices( ) const;
+        [[nodiscard]] float                        GetError( ) const; // In mesh units
+
+        // Levels from the most detailed, each one simplified from the previous
+        static std::vector<MeshLODLevel> BuildLODChain( const MeshSimplifierDesc &desc, const MeshLODChainDesc &chainDesc );
+
+    private:
+        void BuildPositions( const MeshSimplifierDesc &desc );
+        void ClassifyVertices( std::vector<OpenEdge> &outOpenEdges );
+        void BuildQuadrics( std::span<const OpenEdge> openEdges );
+        bool CanCollapse( uint32_t vertex, uint32_t target ) const;
+        // The other side of a seam collapse, InvalidVertex when the seam doesn't continue to target on both sides
+        uint32_t SeamTarget( uint32_t vertex, uint32_t target ) const;
+        bool     HasTriangleFlips( std::span<const uint32_t> triangles, const std::vector<uint32_t> &collapseRemap, uint32_t vertex, uint32_t target ) const;
+        size_t   CollapseEdges( size_t numTrianglesToRemove, float maxError ); // One pass, maxError is squared and normalized, returns the number of collapses
+    };
+} // namespace DZEngine
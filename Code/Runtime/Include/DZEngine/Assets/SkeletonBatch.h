@@ -21,6 +21,9 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 #include <DenOfIzGraphics/DenOfIzGraphics.h>
 #include "DZEngine/Components/AssetHandle.h"
 #include "SkeletonAssetData.h"
+#include "SlotMap.h"
+
+#include <shared_mutex>
 
 namespace DZEngine
 {
@@ -34,12 +37,10 @@ namespace DZEngine
         ILogicalDevice                    *m_logicalDevice;
         std::unique_ptr<BatchResourceCopy> m_batchResourceCopy;
 
-        std::vector<std::unique_ptr<SkeletonAssetData>> m_skeletonData;
+        mutable std::shared_mutex                       m_skeletonLock;
+        SlotMap<std::unique_ptr<SkeletonAssetData>>     m_skeletonData;
         std::unordered_map<std::string, SkeletonHandle> m_skelAliases;
 
-        std::mutex m_nextSkelHandleLock;
-        size_t     m_nextSkelHandle = 0;
-
     public:
         explicit SkeletonBatch( const SkeletonBatchDesc &desc );
         ~SkeletonBatch( ) = default;
@@ -49,11 +50,11 @@ namespace DZEngine
 
         SkeletonHandle LoadSkeleton( const std::string &alias, BinaryReader &reader );
         SkeletonHandle AddSkeleton( const std::string &alias, const SkeletonAssetData &skeletonData );
+        bool           RemoveSkeleton( SkeletonHandle handle ); // No in flight frame may still use what is removed, its handles stop resolving
+        // Swaps the contents so target resolves to what was added as replacement, pointers stay valid and aliases of replacement move to target
+        bool           ReplaceSkeleton( SkeletonHandle target, SkeletonHandle replacement );
 
         SkeletonAssetData *GetSkeleton( const std::string &alias );
         SkeletonAssetData *GetSkeleton( SkeletonHandle handle ) const;
-
-    private:
-        size_t NextSkeletonHandle( const std::string &alias );
     };
 } // namespace DZEngine
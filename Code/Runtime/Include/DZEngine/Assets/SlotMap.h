@@ -0,0 +1,152 @@
+/*
+Den Of Iz - Game/Game Engine
+Copyright (c) 2020-2024 Muhammed Murat Cengiz
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <deque>
+#include <spdlog/spdlog.h>
+#include <vector>
+#include "DZEngine/Components/AssetHandle.h"
+
+namespace DZEngine
+{
+    /**
+     * Values addressed by generational ids, see AssetHandle for the layout. Lookups are one bounds check and one generation compare.
+     * Remove moves the slot to the next generation so the ids of the removed value never resolve again, even after the slot is reused.
+     * Freed slots are reused oldest first to keep the generations from wrapping, a slot that runs out of generations is retired.
+     * Index 0 is never handed out. Not thread safe, the batches lock around it.
+     */
+    template <typename T>
+    class SlotMap
+    {
+        static constexpr uint32_t MaxSlots = AssetHandleIndexMask; // The all ones index is left to AssetHandle::Invalid
+
+        struct Slot
+        {
+            T        Value{ };
+            uint32_t Generation = 0;
+            bool     Occupied   = false;
+        };
+
+        std::vector<Slot>    m_slots{ 1 };
+        std::deque<uint32_t> m_freeSlots;
+        size_t               m_size = 0;
+
+    public:
+        uint32_t Insert( T value ) // AssetHandle::Invalid once every slot is in use
+        {
+            uint32_t index;
+            if ( !m_freeSlots.empty( ) )
+            {
+                index = m_freeSlots.front( );
+                m_freeSlots.pop_front( );
+            }
+            else if ( m_slots.size( ) < MaxSlots )
+            {
+                index = static_cast<uint32_t>( m_slots.size( ) );
+                m_slots.emplace_back( );
+            }
+            else
+            {
+                spdlog::error( "SlotMap::Insert - All {} slots are in use", MaxSlots - 1 );
+                return UINT32_MAX;
+            }
+
+            Slot &slot    = m_slots[ index ];
+            slot.Value    = std::move( value );
+            slot.Occupied = true;
+            ++m_size;
+            return MakeAssetHandleId( index, slot.Generation );
+        }
+
+        bool Remove( const uint32_t id )
+        {
+            Slot *slot = Resolve( id );
+            if ( !slot )
+            {
+                return false;
+            }
+            slot->Value    = T{ };
+            slot->Occupied = false;
+            --m_size;
+            if ( slot->Generation < AssetHandleMaxGeneration )
+            {
+                ++slot->Generation;
+                m_freeSlots.push_back( id & AssetHandleIndexMask );
+            }
+            return true;
+        }
+
+        T *Find( const uint32_t id )
+        {
+            Slot *slot = Resolve( id );
+            return slot ? &slot->Value : nullptr;
+        }
+
+        const T *Find( const uint32_t id ) const
+        {
+            return const_cast<SlotMap *>( this )->Find( id );
+        }
+
+        bool Contains( const uint32_t id ) const // Doesn't report stale ids
+        {
+            const uint32_t index = id & AssetHandleIndexMask;
+            return index < m_slots.size( ) && m_slots[ index ].Occupied && m_slots[ index ].Generation == id >> AssetHandleIndexBits;
+        }
+
+        size_t Size( ) const
+        {
+            return m_size;
+        }
+
+        uint32_t NumSlots( ) const // Every index handed out so far is below it, sizes tables indexed by AssetHandle::Index
+        {
+            return static_cast<uint32_t>( m_slots.size( ) );
+        }
+
+        template <typename F>
+        void ForEach( F &&fn ) const // fn( id, value ) for every value in index order
+        {
+            for ( uint32_t index = 1; index < m_slots.size( ); ++index )
+            {
+                if ( m_slots[ index ].Occupied )
+                {
+                    fn( MakeAssetHandleId( index, m_slots[ index ].Generation ), m_slots[ index ].Value );
+                }
+            }
+        }
+
+    private:
+        Slot *Resolve( const uint32_t id )
+        {
+            const uint32_t index = id & AssetHandleIndexMask;
+            if ( index < m_slots.size( ) && m_slots[ index ].Occupied && m_slots[ index ].Generation == id >> AssetHandleIndexBits )
+            {
+                return &m_slots[ index ];
+            }
+#ifndef NDEBUG
+            // Components may hold a stale handle for many frames, tracing keeps them from flooding the log
+            if ( id != UINT32_MAX && index < m_slots.size( ) )
+            {
+                spdlog::trace( "SlotMap - Stale id {}, generation {} of slot {} was removed", id, id >> AssetHandleIndexBits, index );
+            }
+#endif
+            return nullptr;
+        }
+    };
+} // namespace DZEngine
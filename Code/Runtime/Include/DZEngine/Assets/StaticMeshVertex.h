@@ -20,6 +20,8 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 
 #include <DenOfIzGraphics/Utilities/InteropMath.h>
 
+using namespace DenOfIz;
+
 namespace DZEngine
 {
     struct StaticMeshVertex
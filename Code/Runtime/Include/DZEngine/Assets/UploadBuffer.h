@@ -0,0 +1,67 @@
+/*
+Den Of Iz - Game/Game Engine
+Copyright (c) 2020-2024 Muhammed Murat Cengiz
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <DenOfIzGraphics/DenOfIzGraphics.h>
+#include <atomic>
+
+namespace DZEngine
+{
+    struct UploadBufferDesc
+    {
+        ILogicalDevice *LogicalDevice;
+        size_t          NumBytes = 16777216;
+    };
+
+    struct UploadAllocation
+    {
+        IBufferResource *Buffer = nullptr;
+        size_t           Offset = 0;
+        Byte            *Data   = nullptr; // Mapped, write only, reading it back may be uncached
+
+        [[nodiscard]] bool IsValid( ) const
+        {
+            return Data != nullptr;
+        }
+    };
+
+    /// Persistently mapped upload memory that asset payloads are read or converted straight into and copied to their GPU buffers from.
+    /// Allocation is a lock free bump so any number of loading threads can share it, the whole buffer is recycled by Reset once every copy
+    /// recorded from it has completed. An allocation that doesn't fit fails and the caller falls back to its own staging.
+    class UploadBuffer
+    {
+        std::unique_ptr<IBufferResource> m_buffer;
+        Byte                            *m_mappedMemory = nullptr;
+        size_t                           m_numBytes     = 0;
+        std::atomic<size_t>              m_usedBytes    = 0;
+        std::atomic<size_t>              m_peakBytes    = 0;
+
+    public:
+        static constexpr size_t Alignment = 16;
+
+        explicit UploadBuffer( const UploadBufferDesc &desc );
+        ~UploadBuffer( );
+
+        UploadAllocation Allocate( size_t numBytes );
+        void             Reset( );
+
+        [[nodiscard]] size_t GetNumBytes( ) const;
+        [[nodiscard]] size_t GetPeakBytes( ) const; // Most bytes in use between two resets
+    };
+} // namespace DZEngine
@@ -0,0 +1,62 @@
+/*
+Den Of Iz - Game/Game Engine
+Copyright (c) 2020-2024 Muhammed Murat Cengiz
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <vector>
+#include "CompactMeshVertex.h"
+#include "StaticMeshVertex.h"
+
+namespace DZEngine
+{
+    enum class VertexFormat
+    {
+        Full,   // StaticMeshVertex, 72 bytes
+        Compact // CompactMeshVertex, 24 bytes
+    };
+
+    struct VertexQuantizationError
+    {
+        float MaxPositionError = 0.0f; // Object space units
+        float MaxNormalAngle   = 0.0f; // Radians
+        float MaxTangentAngle  = 0.0f; // Radians
+        float MaxTexCoordError = 0.0f;
+        float MaxColorError    = 0.0f;
+    };
+
+    /// Encodes StaticMeshVertex into CompactMeshVertex, positions are quantized relative to the given bounds so the same bounds are needed to decode.
+    /// The decode functions mirror GPUDrivenRootSignature.hlsli.
+    class VertexQuantization
+    {
+    public:
+        static uint32_t VertexStride( VertexFormat format );
+        /// Stride of the optional position only stream, Float4 for Full and the two position words of CompactMeshVertex for Compact
+        static uint32_t PositionStride( VertexFormat format );
+
+        static CompactMeshVertex Encode( const StaticMeshVertex &vertex, const Float3 &boundsMin, const Float3 &boundsMax );
+        static StaticMeshVertex  Decode( const CompactMeshVertex &vertex, const Float3 &boundsMin, const Float3 &boundsMax );
+        static void Encode( const StaticMeshVertex *vertices, size_t numVertices, const Float3 &boundsMin, const Float3 &boundsMax, CompactMeshVertex *outVertices );
+        /// Grows the bounds to contain every vertex position
+        static void ComputeBounds( const StaticMeshVertex *vertices, size_t numVertices, Float3 &outMin, Float3 &outMax );
+        /// Round trips every vertex and reports the worst error per attribute
+        static VertexQuantizationError MeasureError( const StaticMeshVertex *vertices, size_t numVertices, const Float3 &boundsMin, const Float3 &boundsMax );
+
+        static uint32_t EncodeOctahedral( const Float3 &direction );
+        static Float3   DecodeOctahedral( uint32_t encoded );
+    };
+} // namespace DZEngine
@@ -23,9 +23,20 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 
 namespace DZEngine
 {
+    constexpr uint32_t AssetHandleIndexBits     = 24;
+    constexpr uint32_t AssetHandleIndexMask     = ( 1u << AssetHandleIndexBits ) - 1;
+    constexpr uint32_t AssetHandleMaxGeneration = UINT32_MAX >> AssetHandleIndexBits;
+
+    constexpr uint32_t MakeAssetHandleId( const uint32_t index, const uint32_t generation )
+    {
+        return ( generation << AssetHandleIndexBits ) | ( index & AssetHandleIndexMask );
+    }
+
     /**
      * Handle format:
      * - 32-bit ID with UINT32_MAX representing invalid handle
+     * - Low 24 bits index a slot of the owning batch, high 8 bits are the generation of that slot, see SlotMap
+     * - A removed asset's slot moves to the next generation, so its handles stop resolving instead of aliasing the next asset
      * - Type-safe via inheritance
      * - Lightweight for ECS components
      * - Thread-safe comparison and validation
@@ -48,6 +59,14 @@ namespace DZEngine
         {
             Id = Invalid;
         }
+        constexpr uint32_t Index( ) const // Dense, reused once the asset is removed, e.g. the bindless texture index
+        {
+            return Id & AssetHandleIndexMask;
+        }
+        constexpr uint32_t Generation( ) const
+        {
+            return Id >> AssetHandleIndexBits;
+        }
         constexpr bool operator==( const AssetHandle &Other ) const
         {
             return Id == Other.Id;
@@ -0,0 +1,50 @@
+/*
+Den Of Iz - Game/Game Engine
+Copyright (c) 2020-2024 Muhammed Murat Cengiz
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "DenOfIzGraphics/Utilities/InteropMath.h"
+
+using namespace DenOfIz;
+
+namespace DZEngine
+{
+    /// Light direction is taken from the TransformComponent rotation applied to +Z (forward)
+    struct DirectionalLightComponent
+    {
+        Float3 Color{ 1.0f, 1.0f, 1.0f };
+        float  Intensity = 1.0f;
+    };
+
+    struct PointLightComponent
+    {
+        Float3 Color{ 1.0f, 1.0f, 1.0f };
+        float  Intensity = 1.0f;
+        float  Range     = 10.0f;
+    };
+
+    /// Cone angles are half angles in radians
+    struct SpotLightComponent
+    {
+        Float3 Color{ 1.0f, 1.0f, 1.0f };
+        float  Intensity      = 1.0f;
+        float  Range          = 10.0f;
+        float  InnerConeAngle = 0.35f;
+        float  OuterConeAngle = 0.5f;
+    };
+} // namespace DZEngine
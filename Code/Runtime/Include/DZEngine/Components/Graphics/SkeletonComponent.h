@@ -18,7 +18,7 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 
 #pragma once
 
-#include "DZEngine/AssetHandle.h"
+#include "../AssetHandle.h"
 
 namespace DZEngine
 {
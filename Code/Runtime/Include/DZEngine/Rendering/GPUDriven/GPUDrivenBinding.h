@@ -21,6 +21,7 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 #include "DZEngine/Rendering/IRenderer.h"
 #include "GPUDrivenDataUpload.h"
 #include "GPUDrivenRootSig.h"
+#include "GPUDrivenShadowPass.h"
 
 namespace DZEngine
 {
@@ -28,6 +29,7 @@ namespace DZEngine
     {
         GPUDrivenRootSig    *RootSig;
         GPUDrivenDataUpload *DataUpload;
+        GPUDrivenShadowPass *ShadowPass;
         AppContext          *AppContext;
         uint32_t             BatchId;
     };
@@ -42,6 +44,7 @@ namespace DZEngine
         uint32_t             m_numFrames;
         GPUDrivenRootSig    *m_rootSig;
         GPUDrivenDataUpload *m_dataUpload;
+        GPUDrivenShadowPass *m_shadowPass;
         AssetBatcher        *m_assetBatcher;
         World               *m_world;
         uint32_t             m_batchId;
@@ -50,6 +53,7 @@ namespace DZEngine
         {
             std::unique_ptr<IResourceBindGroup> BuffersBinding;
             std::unique_ptr<IResourceBindGroup> TexturesBinding;
+            uint32_t                            GeometryVersion = 0; // MeshBatch::GetGeometryVersion the buffers were bound with
         };
         std::unique_ptr<ISampler>         m_linearSampler;
         std::unique_ptr<ISampler>         m_pointSampler;
@@ -73,6 +77,7 @@ namespace DZEngine
     private:
         void CreateSamplersBinding( );
         void CreateBuffersBinding( ) const;
+        void UpdateBuffers( uint32_t frameIndex ) const;
         void CreateTexturesBinding( );
         void UpdateTextures( uint32_t frameIndex ) const;
     };
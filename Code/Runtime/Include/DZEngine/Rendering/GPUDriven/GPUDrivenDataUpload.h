@@ -18,7 +18,10 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 
 #pragma once
 
+#include <array>
 #include "DZEngine/Assets/AssetBatcher.h"
+#include "DZEngine/Rendering/Lighting/ClusteredLightCulling.h"
+#include "DZEngine/Rendering/Shadows/ShadowCascades.h"
 #include "DZEngine/Scene/Scene.h"
 #include "DenOfIzGraphics/DenOfIzGraphics.h"
 #include "GPUDrivenSceneData.h"
@@ -27,16 +30,23 @@ using namespace DenOfIz;
 
 namespace DZEngine
 {
+    class GPUDrivenDataUpload;
+
     struct GPUDrivenDataUploadDesc
     {
-        GraphicsContext *GraphicsContext;
-        AssetBatcher    *Assets;
-        World           *World;
-        uint32_t         BatchId;
-        uint32_t         NumFrames;
-        uint32_t         MaxObjects   = 65536;
-        uint32_t         MaxMaterials = 512;
-        uint32_t         MaxMeshes    = 2048;
+        GraphicsContext           *GraphicsContext;
+        AssetBatcher              *Assets;
+        World                     *World;
+        ClusteredLightCulling     *LightCulling; // Optional, shared between batches
+        const GPUDrivenDataUpload *LightOwner;   // Optional, the batch uploading the lights of LightCulling, this batch binds its light buffers
+        const ShadowCascades      *Shadows;      // Optional, shared between batches, casters are culled per cascade when valid
+        uint32_t                   BatchId;
+        uint32_t                   NumFrames;
+        uint32_t                   MaxObjects                 = 65536;
+        uint32_t                   MaxMaterials               = 512;
+        uint32_t                   MaxMeshes                  = 2048;
+        uint32_t                   MaxShadowCastersPerCascade = 16384;
+        float                      MaxLODPixelError           = 1.0f; // Objects draw the coarsest level of detail within it on screen, 0 always draws level 0
     };
 
     struct GPUDrivenBuffers
@@ -48,6 +58,9 @@ namespace DZEngine
         IBufferResource *InstanceBuffer;
         IBufferResource *DrawArgsBuffer;
         IBufferResource *IndirectBuffer;
+        IBufferResource *LightBuffer;
+        IBufferResource *LightClusterBuffer;
+        IBufferResource *LightIndexBuffer;
     };
 
     class GPUDrivenDataUpload
@@ -79,6 +92,15 @@ namespace DZEngine
 
             size_t IndirectBufferNumBytes;
             size_t IndirectBufferOffset;
+
+            size_t LightBufferNumBytes;
+            size_t LightBufferOffset;
+
+            size_t LightClusterBufferNumBytes;
+            size_t LightClusterBufferOffset;
+
+            size_t LightIndexBufferNumBytes;
+            size_t LightIndexBufferOffset;
         };
 
         struct FrameData
@@ -99,7 +121,20 @@ namespace DZEngine
             std::unique_ptr<IBufferResource> DrawArgsBuffer; // g_DrawArgsBuffer;
             std::unique_ptr<IBufferResource> IndirectBuffer; // Indirect draw commands
 
-            uint32_t NumDraws = 0;
+            std::unique_ptr<IBufferResource> LightBuffer;        // g_LightBuffer
+            std::unique_ptr<IBufferResource> LightClusterBuffer; // g_LightClusterBuffer
+            std::unique_ptr<IBufferResource> LightIndexBuffer;   // g_LightIndexBuffer
+            // Staged by UpdateLightBuffers, only these are copied. The cluster grid is skipped while it stays empty
+            size_t NumLightBytes        = 0;
+            size_t NumLightClusterBytes = 0;
+            size_t NumLightIndexBytes   = 0;
+            bool   LightClustersEmpty   = false;
+
+            // Commands are grouped by index width, the first NumDraws16 of each list use Uint16 indices
+            uint32_t                                NumDraws   = 0;
+            uint32_t                                NumDraws16 = 0;
+            std::array<uint32_t, MaxShadowCascades> NumShadowDraws{ };
+            std::array<uint32_t, MaxShadowCascades> NumShadowDraws16{ };
         };
 
         DataRanges                              m_dataRanges;
@@ -110,12 +145,21 @@ namespace DZEngine
         ISemaphore      *UpdateFrame( uint32_t frameIndex ) const;
         void             UpdateStagingBuffer( uint32_t frameIndex ) const;
         void             UpdateGlobalDataBuffer( uint32_t frameIndex ) const;
+        void             UpdateLightBuffers( uint32_t frameIndex ) const;
         void             Submit( ISemaphore *onComplete, const ICommandListArray &commandListsToSubmit ) const;
         GPUDrivenBuffers GetBuffers( uint32_t frameIndex ) const;
         uint32_t         GetNumDraws( uint32_t frameIndex ) const;
+        uint32_t         GetNumDraws( uint32_t frameIndex, IndexType indexType ) const;
+        uint64_t         GetDrawOffset( uint32_t frameIndex, IndexType indexType ) const; // Byte offset of the indexType commands in IndirectBuffer
+        uint32_t         GetNumShadowDraws( uint32_t frameIndex, uint32_t cascade ) const;
+        uint32_t         GetNumShadowDraws( uint32_t frameIndex, uint32_t cascade, IndexType indexType ) const;
+        uint64_t         GetShadowDrawOffset( uint32_t cascade ) const; // Byte offset of the cascade's commands in IndirectBuffer
+        uint64_t         GetShadowDrawOffset( uint32_t frameIndex, uint32_t cascade, IndexType indexType ) const;
         ~GPUDrivenDataUpload( );
 
     private:
         std::unique_ptr<IBufferResource> CreateStructuredBuffer( const StructuredBufferDesc &structDesc ) const;
+        // Shadow instances and commands are stored after the main pass ones, one MaxShadowCastersPerCascade sized region per cascade
+        uint32_t ShadowRegionOffset( uint32_t cascade ) const;
     };
 } // namespace DZEngine
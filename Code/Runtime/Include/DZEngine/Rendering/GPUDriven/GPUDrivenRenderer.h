@@ -22,6 +22,7 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 #include "GPUDrivenBinding.h"
 #include "GPUDrivenDataUpload.h"
 #include "GPUDrivenRootSig.h"
+#include "GPUDrivenShadowPass.h"
 
 namespace DZEngine
 {
@@ -32,6 +33,11 @@ namespace DZEngine
         std::unique_ptr<GPUDrivenRootSig> m_rootSig;
         AssetBatcher                     *m_assetBatcher;
         World                            *m_world;
+        ShaderHotReload                  *m_shaderHotReload;
+        uint32_t                          m_shaderHotReloadId = 0;
+
+        std::unique_ptr<ClusteredLightCulling> m_lightCulling;
+        std::unique_ptr<GPUDrivenShadowPass>   m_shadowPass;
 
         struct BatchData
         {
@@ -58,6 +64,10 @@ namespace DZEngine
         ISemaphore *RenderFrame( const RenderFrameDesc &renderFrame ) override;
         void        InitTestPipeline( ); // Todo use render graph here and more dynamic pipelines
         void        RecreateDepthTexturesIfNeeded( );
-        ~GPUDrivenRenderer( ) override = default;
+        void        RenderShadows( ICommandList *cmdList, uint32_t frameIndex ) const;
+        ~GPUDrivenRenderer( ) override;
+
+    private:
+        bool CreatePipeline( ); // Keeps the current pipeline when the shaders fail to compile
     };
 } // namespace DZEngine
@@ -10,9 +10,10 @@ namespace DZEngine
 {
     class GPUDrivenRootSig
     {
-        std::vector<ResourceBindingDesc> m_resourceBindings;
-        RootSignatureDesc                m_desc;
-        std::unique_ptr<IRootSignature>  m_rootSignature;
+        std::vector<ResourceBindingDesc>             m_resourceBindings;
+        std::vector<RootConstantResourceBindingDesc> m_rootConstants;
+        RootSignatureDesc                            m_desc;
+        std::unique_ptr<IRootSignature>              m_rootSignature;
 
     public:
         explicit GPUDrivenRootSig( ILogicalDevice *device );
@@ -25,7 +25,9 @@ using namespace DenOfIz;
 
 namespace DZEngine
 {
-    constexpr uint32_t MaxNumTextures = 1024;
+    constexpr uint32_t MaxNumTextures          = 1024;
+    constexpr uint32_t MaxNumDirectionalLights = 4;
+    constexpr uint32_t MaxShadowCascades       = 4;
 
     struct GPUMaterialData
     {
@@ -68,10 +70,10 @@ namespace DZEngine
         uint32_t IndexCount;
         uint32_t VertexCount;
 
-        Float3 AABBMin;
-        float  Padding0;
-        Float3 AABBMax;
-        float  Padding1;
+        Float3   AABBMin;      // Position decode bounds when VertexFormat is Compact
+        uint32_t VertexFormat; // 0 = StaticMeshVertex, 1 = CompactMeshVertex
+        Float3   AABBMax;
+        uint32_t PositionStream; // 1 when g_PositionBuffer holds the positions of this mesh
     };
 
     struct DrawIndexedIndirectCommand
@@ -117,6 +119,56 @@ namespace DZEngine
         Float2   ScreenSize;
         float    Time;
         float    DeltaTime;
+
+        uint32_t NumDirectionalLights;
+        uint32_t NumClustersX;
+        uint32_t NumClustersY;
+        uint32_t NumClustersZ;
+        float    ClusterDepthScale; // slice = log(viewZ) * ClusterDepthScale + ClusterDepthBias
+        float    ClusterDepthBias;
+        float    ClusterNear;
+        float    ClusterFar;
+
+        Float4x4 CascadeViewProj[ MaxShadowCascades ];
+        Float4   CascadeSplits;     // View space far distance of each cascade
+        Float4   CascadeTexelSizes; // World space size of a shadow map texel of each cascade
+        uint32_t NumShadowCascades;
+        uint32_t ShadowMapResolution; // Of a single cascade, cascades are laid out horizontally in the atlas
+        float    ShadowDepthBias;
+        float    ShadowNormalBias;
+    };
+
+    enum class GPULightType : uint32_t
+    {
+        Directional = 0,
+        Point       = 1,
+        Spot        = 2
+    };
+
+    struct GPULightData
+    {
+        Float3       Position;
+        float        Range;
+        Float3       Direction;
+        GPULightType Type;
+        Float3       Color;
+        float        Intensity;
+        float        SpotCosOuter;
+        float        SpotCosInner;
+        Float2       Padding;
+    };
+
+    struct GPULightCluster
+    {
+        uint32_t Offset; // Into g_LightIndexBuffer
+        uint32_t Count;
+    };
+
+    // Root constants of the shadow depth pass, register b0 space31
+    struct GPUShadowPassConstants
+    {
+        uint32_t CascadeIndex;
+        uint32_t Padding[ 3 ];
     };
 
     struct DrawArguments
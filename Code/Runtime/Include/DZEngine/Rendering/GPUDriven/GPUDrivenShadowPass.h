@@ -0,0 +1,74 @@
+/*
+Den Of Iz - Game/Game Engine
+Copyright (c) 2020-2024 Muhammed Murat Cengiz
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <array>
+#include "DZEngine/Rendering/IRenderer.h"
+#include "DZEngine/Rendering/Lighting/ClusteredLightCulling.h"
+#include "DZEngine/Rendering/ShaderHotReload.h"
+#include "DZEngine/Rendering/Shadows/ShadowCascades.h"
+#include "GPUDrivenRootSig.h"
+
+namespace DZEngine
+{
+    struct GPUDrivenShadowPassDesc
+    {
+        GraphicsContext   *GraphicsContext;
+        GPUDrivenRootSig  *RootSig;
+        uint32_t           NumFrames;
+        ShadowCascadesDesc Cascades;
+        ShaderHotReload   *ShaderHotReload = nullptr; // Optional, rebuilds the pipeline when its shaders change
+    };
+
+    /// Depth only pass rendering the cascades of the first directional light into a horizontal atlas, one tile per cascade.
+    /// Casters are culled and written into per cascade indirect regions by GPUDrivenDataUpload, this class owns the atlas, the pipeline and the
+    /// cascade index root constants.
+    class GPUDrivenShadowPass
+    {
+        GraphicsContext  *m_graphicsContext;
+        GPUDrivenRootSig *m_rootSig;
+        ShadowCascades    m_cascades;
+        ShaderHotReload  *m_shaderHotReload;
+        uint32_t          m_shaderHotReloadId = 0;
+
+        std::unique_ptr<ShaderProgram>                 m_program;
+        std::unique_ptr<IPipeline>                     m_pipeline;
+        std::vector<std::unique_ptr<ITextureResource>> m_shadowMaps;
+
+        std::array<GPUShadowPassConstants, MaxShadowCascades>              m_cascadeConstants{ };
+        std::array<std::unique_ptr<IResourceBindGroup>, MaxShadowCascades> m_cascadeBindGroups;
+
+    public:
+        explicit GPUDrivenShadowPass( const GPUDrivenShadowPassDesc &desc );
+        /// Fits the cascades to the active camera and the first directional light, invalidates them if either is missing
+        void Update( const ClusteredLightCulling &lightCulling );
+
+        /// Clears the atlas and binds the shadow pipeline, the atlas is cleared even when there are no cascades so it is always safe to sample
+        void Begin( ICommandList *cmdList, uint32_t frameIndex ) const;
+        void BindCascade( ICommandList *cmdList, uint32_t cascade ) const;
+        void End( ICommandList *cmdList, uint32_t frameIndex ) const;
+
+        [[nodiscard]] const ShadowCascades &GetCascades( ) const;
+        [[nodiscard]] ITextureResource     *GetShadowMap( uint32_t frameIndex ) const;
+        ~GPUDrivenShadowPass( );
+
+    private:
+        bool CreatePipeline( ); // Keeps the current pipeline when the shader fails to compile
+    };
+} // namespace DZEngine
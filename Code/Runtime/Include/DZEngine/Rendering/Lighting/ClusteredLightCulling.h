@@ -0,0 +1,56 @@
+/*
+Den Of Iz - Game/Game Engine
+Copyright (c) 2020-2024 Muhammed Murat Cengiz
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "DZEngine/Scene/World.h"
+#include "LightClusterBuilder.h"
+
+namespace DZEngine
+{
+    struct ClusteredLightCullingDesc
+    {
+        World                  *World;
+        LightClusterBuilderDesc Clusters;
+    };
+
+    /// Gathers light components from the world every frame and bins point and spot lights into the cluster grid of the active camera.
+    /// Lights are packed as [ directional lights | clustered lights ], cluster light indices are relative to the first clustered light.
+    class ClusteredLightCulling
+    {
+        World                          *m_world;
+        LightClusterBuilder             m_builder;
+        std::vector<GPULightData>       m_lights;
+        std::vector<ClusterLightBounds> m_bounds;
+        uint32_t                        m_numDirectionalLights = 0;
+        Float4x4                        m_view{ };
+        Float4x4                        m_projection{ };
+        bool                            m_hasActiveCamera = false;
+
+    public:
+        explicit ClusteredLightCulling( const ClusteredLightCullingDesc &desc );
+        void Update( );
+
+        [[nodiscard]] const std::vector<GPULightData> &GetLights( ) const;
+        [[nodiscard]] uint32_t                         NumDirectionalLights( ) const;
+        [[nodiscard]] const LightClusterBuilder       &GetClusters( ) const;
+        [[nodiscard]] bool                             HasActiveCamera( ) const;
+        [[nodiscard]] const Float4x4                  &GetView( ) const;
+        [[nodiscard]] const Float4x4                  &GetProjection( ) const;
+    };
+} // namespace DZEngine
@@ -0,0 +1,122 @@
+/*
+Den Of Iz - Game/Game Engine
+Copyright (c) 2020-2024 Muhammed Murat Cengiz
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <vector>
+#include "DZEngine/Rendering/GPUDriven/GPUDrivenSceneData.h"
+
+namespace tf
+{
+    class Executor;
+}
+
+namespace DZEngine
+{
+    struct LightClusterBuilderDesc
+    {
+        uint32_t      NumClustersX    = 16;
+        uint32_t      NumClustersY    = 9;
+        uint32_t      NumClustersZ    = 24;
+        uint32_t      MaxLights       = 4096;
+        uint32_t      MaxLightIndices = 262144;
+        tf::Executor *Executor        = nullptr; // Optional, slices are binned serially without it
+    };
+
+    /// World space bounding sphere of a point or spot light
+    struct ClusterLightBounds
+    {
+        Float3 Position;
+        float  Radius;
+    };
+
+    struct LightClusterStats
+    {
+        uint32_t NumLights           = 0;
+        uint32_t NumLightIndices     = 0;
+        uint32_t NumDroppedLights    = 0; // Over MaxLights
+        uint32_t NumDroppedIndices   = 0; // Over MaxLightIndices
+        uint32_t MaxLightsPerCluster = 0;
+        double   BuildMilliseconds   = 0.0;
+    };
+
+    /// Bins light spheres into a view space froxel grid with exponential depth slices. Clusters are laid out as x + y * NumClustersX + z * NumClustersX * NumClustersY,
+    /// y = 0 being the top row of the screen. Every cluster list is sorted by light index.
+    /// Expects a left-handed perspective projection, near and far planes are recovered from it.
+    class LightClusterBuilder
+    {
+        LightClusterBuilderDesc m_desc;
+        uint32_t                m_numClusters;
+
+        // Cluster AABBs are separable: the x extent only depends on (slice, x), y on (slice, y) and z on slice
+        Float4x4           m_cachedProjection{ };
+        std::vector<float> m_sliceMinZ;
+        std::vector<float> m_sliceMaxZ;
+        std::vector<float> m_tileMinX; // [ slice * NumClustersX + x ]
+        std::vector<float> m_tileMaxX;
+        std::vector<float> m_tileMinY; // [ slice * NumClustersY + y ]
+        std::vector<float> m_tileMaxY;
+        float              m_near = 0.0f;
+        float              m_far  = 0.0f;
+
+        struct SliceScratch
+        {
+            std::vector<uint32_t> Pairs; // (cluster in slice, light) pairs, in light order
+            std::vector<uint32_t> Indices;
+            std::vector<uint32_t> Cursors;
+            std::vector<float>    DistSqX;
+            std::vector<float>    DistSqY;
+            uint32_t              Base = 0; // First index of this slice in m_lightIndices
+        };
+
+        std::vector<Float4>          m_viewLights; // xyz view space center, w radius
+        std::vector<SliceScratch>    m_sliceScratch;
+        std::vector<GPULightCluster> m_clusters;
+        std::vector<uint32_t>        m_lightIndices;
+        LightClusterStats            m_stats;
+
+    public:
+        explicit LightClusterBuilder( const LightClusterBuilderDesc &desc );
+        void Build( const Float4x4 &view, const Float4x4 &projection, const std::vector<ClusterLightBounds> &lights );
+        /// Brute force assignment, every light against every cluster. Produces the same output as Build, used for validation
+        void BuildReference( const Float4x4 &view, const Float4x4 &projection, const std::vector<ClusterLightBounds> &lights );
+        /// Empties every cluster
+        void Reset( );
+        /// Returns true if both builders produced identical cluster lists
+        [[nodiscard]] bool Matches( const LightClusterBuilder &other ) const;
+
+        [[nodiscard]] const std::vector<GPULightCluster> &GetClusters( ) const;
+        [[nodiscard]] const std::vector<uint32_t>        &GetLightIndices( ) const;
+        [[nodiscard]] const LightClusterStats            &GetStats( ) const;
+        [[nodiscard]] const LightClusterBuilderDesc      &GetDesc( ) const;
+        [[nodiscard]] uint32_t                            NumClusters( ) const;
+        [[nodiscard]] float                               GetNear( ) const;
+        [[nodiscard]] float                               GetFar( ) const;
+        [[nodiscard]] float                               GetDepthScale( ) const;
+        [[nodiscard]] float                               GetDepthBias( ) const;
+
+        /// Bounding sphere of a spot light cone
+        static ClusterLightBounds SpotLightBounds( const Float3 &position, const Float3 &direction, float range, float outerConeAngle );
+
+    private:
+        void     UpdateClusterBounds( const Float4x4 &projection );
+        void     TransformLights( const Float4x4 &view, const std::vector<ClusterLightBounds> &lights );
+        void     BinSlice( uint32_t slice );
+        uint32_t ClampIndexCounts( );
+    };
+} // namespace DZEngine
@@ -0,0 +1,56 @@
+/*
+Den Of Iz - Game/Game Engine
+Copyright (c) 2020-2024 Muhammed Murat Cengiz
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <functional>
+#include <span>
+#include <unordered_map>
+#include <unordered_set>
+#include "DZEngine/Assets/FileWatcher.h"
+
+namespace DZEngine
+{
+    /// Rebuilds the shader programs whose sources changed. A program is registered with the files its stages compile, the files they include
+    /// with #include "..." are found transitively, relative to the including file or the working directory, so a change to a shared include only
+    /// rebuilds the programs that include it. Rebuild runs on the thread calling OnFilesChanged and should keep the previous program and pipeline
+    /// when compilation fails. Not thread safe, use from the frame thread.
+    class ShaderHotReload
+    {
+        struct Program
+        {
+            std::vector<std::filesystem::path> Sources;
+            std::function<void( )>             Rebuild;
+            std::unordered_set<std::string>    Files; // Sources and their includes
+        };
+
+        uint32_t                              m_nextId = 1;
+        std::unordered_map<uint32_t, Program> m_programs;
+
+    public:
+        uint32_t Register( std::vector<std::filesystem::path> sources, std::function<void( )> rebuild ); // Returns the id for Unregister
+        void     Unregister( uint32_t id );
+        uint32_t OnFilesChanged( std::span<const FileChange> changes ); // Returns the number of programs rebuilt
+
+        [[nodiscard]] size_t NumPrograms( ) const;
+
+    private:
+        static std::string                     FileKey( const std::filesystem::path &path );
+        static std::unordered_set<std::string> CollectFiles( const std::vector<std::filesystem::path> &sources );
+    };
+} // namespace DZEngine
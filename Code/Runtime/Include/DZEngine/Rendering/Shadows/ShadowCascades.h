@@ -0,0 +1,75 @@
+/*
+Den Of Iz - Game/Game Engine
+Copyright (c) 2020-2024 Muhammed Murat Cengiz
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <vector>
+#include "DZEngine/Rendering/GPUDriven/GPUDrivenSceneData.h"
+
+namespace DZEngine
+{
+    struct ShadowCascadesDesc
+    {
+        uint32_t NumCascades       = 4;
+        uint32_t Resolution        = 1024;  // Per cascade
+        float    MaxShadowDistance = 60.0f; // Cascades stop at min( camera far, MaxShadowDistance )
+        float    SplitLambda       = 0.75f; // 0 = uniform splits, 1 = logarithmic splits
+        float    DepthBias         = 0.001f;
+        float    NormalBias        = 1.5f; // In texels of the sampled cascade
+    };
+
+    struct ShadowCascade
+    {
+        Float4x4 View;
+        Float4x4 Projection;
+        Float4x4 ViewProjection;
+        float    SplitNear;
+        float    SplitFar;
+        float    Radius;
+        float    TexelSize;
+        Float3   LightSpaceCenter; // Snapped to texel increments
+    };
+
+    /// Fits one orthographic projection per cascade around a bounding sphere of the camera frustum slice. The sphere radius does not depend on the
+    /// camera orientation and the center is snapped to shadow map texels in light space, so shadows don't shimmer as the camera moves or turns.
+    /// Expects a left-handed perspective camera projection, same as LightClusterBuilder.
+    class ShadowCascades
+    {
+        ShadowCascadesDesc         m_desc;
+        std::vector<ShadowCascade> m_cascades;
+        Float4x4                   m_lightView{ };
+        bool                       m_valid = false;
+
+    public:
+        explicit ShadowCascades( const ShadowCascadesDesc &desc );
+        void Fit( const Float4x4 &cameraView, const Float4x4 &cameraProjection, const Float3 &lightDirection );
+        void Invalidate( );
+
+        /// Casters are accepted anywhere between the light and the cascade volume, they are pancaked onto the near plane while rendering
+        [[nodiscard]] bool IsCasterVisible( uint32_t cascade, const Float4 &worldSphere ) const;
+        /// Appends the indices of the spheres that can cast into the cascade
+        void CullCasters( uint32_t cascade, const std::vector<Float4> &worldSpheres, std::vector<uint32_t> &outVisible ) const;
+
+        [[nodiscard]] bool                              IsValid( ) const;
+        [[nodiscard]] uint32_t                          NumCascades( ) const;
+        [[nodiscard]] const std::vector<ShadowCascade> &GetCascades( ) const;
+        [[nodiscard]] const ShadowCascadesDesc         &GetDesc( ) const;
+
+        static void ComputeSplits( float nearPlane, float farPlane, uint32_t numCascades, float lambda, float *outSplitFar );
+    };
+} // namespace DZEngine
@@ -22,6 +22,7 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 #include <string>
 #include <filesystem>
 #include "DZEngine/Rendering/GraphicsContext.h"
+#include "DZEngine/Scene/SceneLoader.h"
 
 namespace DZEngine
 {
@@ -56,7 +57,7 @@ namespace DZEngine
 
         const std::string &GetName( ) const;
         flecs::entity      GetRoot( ) const;
-        
-        bool LoadFromFile( const std::filesystem::path &filePath );
+
+        bool LoadFromFile( const std::filesystem::path &filePath, const SceneLoadDesc &desc = { } );
     };
 } // namespace DZEngine
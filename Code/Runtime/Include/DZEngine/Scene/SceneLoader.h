@@ -19,12 +19,20 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 #pragma once
 
 #include <flecs.h>
+#include <functional>
+#include <nlohmann/json_fwd.hpp>
 #include <string>
 #include <filesystem>
+#include <vector>
+#include "DZEngine/Components/AssetHandle.h"
 
 namespace DZEngine
 {
     class Scene;
+    class AssetLoader;
+    class AssetRegistry;
+    struct TAssetLoadHandle;
+    using AssetLoadHandle = AssetHandle<TAssetLoadHandle>;
 
     enum class LoadResult
     {
@@ -36,10 +44,35 @@ namespace DZEngine
         ComponentRegistrationError
     };
 
+    struct SceneLoadProgress
+    {
+        size_t NumAssets    = 0; // Distinct assets referenced by the scene
+        size_t NumCompleted = 0; // Including the failed ones
+        size_t NumFailed    = 0;
+    };
+
+    using SceneLoadProgressCallback = std::function<void( const SceneLoadProgress &progress )>;
+
+    struct SceneLoadDesc
+    {
+        // Both required to preload, without them entities keep the handles of the file as they are
+        AssetLoader              *AssetLoader   = nullptr;
+        AssetRegistry            *AssetRegistry = nullptr;
+        SceneLoadProgressCallback OnProgress; // Called on the loading thread whenever a preloaded asset completes
+    };
+
+    /// Assets referenced by the entities are collected before any entity is created, mapped to their uris through the registry and
+    /// requested from the loader all at once, so they are read and decoded in parallel. Loading blocks until every one of them completed,
+    /// then the entities are created with the handles of the loaded assets. An asset that fails to load leaves an invalid handle.
+    /// The loads are released once the entities are created, from then on the components keep the assets alive, see AssetReferenceSystem.
     class SceneLoader
     {
     public:
-        static LoadResult LoadSceneFromFile( Scene *scene, const std::filesystem::path &filePath );
-        static LoadResult LoadSceneFromJson( Scene *scene, const std::string &jsonData );
+        static LoadResult LoadSceneFromFile( Scene *scene, const std::filesystem::path &filePath, const SceneLoadDesc &desc = { } );
+        static LoadResult LoadSceneFromJson( Scene *scene, const std::string &jsonData, const SceneLoadDesc &desc = { } );
+
+    private:
+        // Returns the loads to release once the entities reference the assets
+        static std::vector<AssetLoadHandle> PreloadAssets( flecs::world &world, nlohmann::json &entities, const SceneLoadDesc &desc );
     };
 } // namespace DZEngine
\ No newline at end of file
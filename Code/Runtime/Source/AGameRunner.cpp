@@ -17,6 +17,7 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 */
 
 #include "DZEngine/AGameRunner.h"
+#include <spdlog/spdlog.h>
 
 using namespace DZEngine;
 using namespace DenOfIz;
@@ -32,13 +33,26 @@ AGameRunner::AGameRunner( const GameRunnerDesc &desc ) : m_windowHandle( desc.Wi
     m_appContext->NumFrames       = 3;
     m_appContext->GraphicsContext = m_graphicsContext;
 
+    m_executor             = std::make_unique<tf::Executor>( );
+    m_appContext->Executor = m_executor.get( );
+
     WorldDesc worldDesc{ };
     worldDesc.GraphicsContext = m_graphicsContext;
     m_world                   = std::make_unique<World>( worldDesc );
     m_appContext->World       = m_world.get( );
 
-    m_assetBundle   = std::make_unique<AssetBundle>( "Assets" );
-    m_assetRegistry = std::make_unique<AssetRegistry>( "AssetRegistry.json" );
+    FileIODesc fileIODesc{ };
+    fileIODesc.Executor = m_executor.get( );
+    m_fileIO            = IFileIO::Create( fileIODesc );
+
+    m_assetBundle = std::make_unique<AssetBundle>( "Assets" );
+    m_assetBundle->SetFileIO( m_fileIO.get( ) );
+    if ( std::filesystem::exists( "Assets.dzpack" ) ) // Built by DZPack, packed assets take precedence over the loose files
+    {
+        m_assetBundle->MountPack( "Assets.dzpack", m_executor.get( ) );
+    }
+    m_assetRegistry             = std::make_unique<AssetRegistry>( "AssetRegistry.json" );
+    m_appContext->AssetRegistry = m_assetRegistry.get( );
 
     AssetBatcherDesc batcherDesc{ };
     batcherDesc.GraphicsContext = m_graphicsContext;
@@ -46,8 +60,57 @@ AGameRunner::AGameRunner( const GameRunnerDesc &desc ) : m_windowHandle( desc.Wi
     batcherDesc.AssetRegistry   = m_assetRegistry.get( );
     m_assetBatcher              = std::make_unique<AssetBatcher>( batcherDesc );
     m_appContext->AssetBatcher  = m_assetBatcher.get( );
+    AssetReferenceSystem::Register( m_world->GetWorld( ), m_assetBatcher->Cache( ) ); // The batcher outlives the world
+
+    AssetLoaderDesc loaderDesc{ };
+    loaderDesc.AssetBatcher   = m_assetBatcher.get( );
+    loaderDesc.AssetBundle    = m_assetBundle.get( );
+    loaderDesc.AssetRegistry  = m_assetRegistry.get( );
+    loaderDesc.Executor       = m_executor.get( );
+    m_assetLoader             = std::make_unique<AssetLoader>( loaderDesc );
+    m_appContext->AssetLoader = m_assetLoader.get( );
+
+    if ( desc.HotReload )
+    {
+        // The directories read at runtime, shaders are compiled from _Assets and assets are loaded from the loose files of the bundle
+        m_fileWatcher = IFileWatcher::Create( FileWatcherDesc{ } );
+        for ( const std::filesystem::path &directory : { m_assetBundle->GetAssetsDirectory( ), std::filesystem::path( "_Assets" ) } )
+        {
+            if ( std::filesystem::is_directory( directory ) )
+            {
+                m_fileWatcher->Watch( directory );
+            }
+        }
+
+        AssetHotReloadDesc assetHotReloadDesc{ };
+        assetHotReloadDesc.AssetBundle   = m_assetBundle.get( );
+        assetHotReloadDesc.AssetBatcher  = m_assetBatcher.get( );
+        assetHotReloadDesc.AssetRegistry = m_assetRegistry.get( );
+        assetHotReloadDesc.AssetLoader   = m_assetLoader.get( );
+        m_assetHotReload                 = std::make_unique<AssetHotReload>( assetHotReloadDesc );
+        m_shaderHotReload                = std::make_unique<ShaderHotReload>( );
+        m_appContext->ShaderHotReload    = m_shaderHotReload.get( );
+    }
 
     m_game->Init( m_appContext.get( ) );
 
     m_world->GetWorld( ).set_ctx( m_appContext.get( ) );
 }
+
+void AGameRunner::UpdateHotReload( )
+{
+    if ( !m_fileWatcher )
+    {
+        return;
+    }
+
+    m_fileChanges.clear( );
+    m_fileWatcher->Poll( m_fileChanges );
+    if ( !m_fileChanges.empty( ) )
+    {
+        const uint32_t numAssets   = m_assetHotReload->OnFilesChanged( m_fileChanges );
+        const uint32_t numPrograms = m_shaderHotReload->OnFilesChanged( m_fileChanges );
+        spdlog::info( "AGameRunner: {} files changed, reloading {} assets, rebuilt {} shader programs", m_fileChanges.size( ), numAssets, numPrograms );
+    }
+    m_assetHotReload->Update( );
+}
@@ -17,6 +17,7 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 */
 
 #include "DZEngine/Assets/AnimationBatch.h"
+#include <ranges>
 #include <spdlog/spdlog.h>
 
 using namespace DZEngine;
@@ -73,39 +74,63 @@ AnimationClipHandle AnimationBatch::LoadAnimation( const std::string &alias, Bin
 
 AnimationClipHandle AnimationBatch::AddAnimation( const std::string &alias, const AnimationAssetData &animationData )
 {
-    const size_t nextAnimHandle               = NextAnimationHandle( alias );
-    m_animationData[ nextAnimHandle ]         = std::make_unique<AnimationAssetData>( animationData );
-    m_animationData[ nextAnimHandle ]->Handle = AnimationClipHandle( nextAnimHandle );
-    return AnimationClipHandle( nextAnimHandle );
+    auto                      data    = std::make_unique<AnimationAssetData>( animationData );
+    AnimationAssetData       *dataPtr = data.get( );
+    std::lock_guard           lock( m_animationLock );
+    const AnimationClipHandle handle( m_animationData.Insert( std::move( data ) ) );
+    if ( handle.IsValid( ) )
+    {
+        dataPtr->Handle        = handle;
+        m_animAliases[ alias ] = handle;
+    }
+    return handle;
 }
 
-AnimationAssetData *AnimationBatch::GetAnimation( const std::string &alias )
+bool AnimationBatch::RemoveAnimation( const AnimationClipHandle handle )
 {
-    const auto it = m_animAliases.find( alias );
-    if ( it == m_animAliases.end( ) )
+    std::lock_guard lock( m_animationLock );
+    if ( !m_animationData.Remove( handle.Id ) )
     {
-        return nullptr;
+        spdlog::error( "AnimationBatch::RemoveAnimation - Invalid handle: {}", handle.Id );
+        return false;
     }
-    return m_animationData[ it->second.Id ].get( );
+    std::erase_if( m_animAliases, [ & ]( const auto &alias ) { return alias.second == handle; } );
+    return true;
 }
 
-AnimationAssetData *AnimationBatch::GetAnimation( const AnimationClipHandle handle ) const
+bool AnimationBatch::ReplaceAnimation( const AnimationClipHandle target, const AnimationClipHandle replacement )
 {
-    if ( handle.Id >= m_animationData.size( ) )
+    std::lock_guard lock( m_animationLock );
+    const auto     *targetData      = m_animationData.Find( target.Id );
+    const auto     *replacementData = m_animationData.Find( replacement.Id );
+    if ( !targetData || !replacementData )
     {
-        return nullptr;
+        spdlog::error( "AnimationBatch::ReplaceAnimation - Invalid handle: {} or {}", target.Id, replacement.Id );
+        return false;
+    }
+    std::swap( **targetData, **replacementData );
+    std::swap( ( *targetData )->Handle, ( *replacementData )->Handle );
+    for ( AnimationClipHandle &handle : m_animAliases | std::views::values )
+    {
+        handle = handle == replacement ? target : handle;
     }
-    return m_animationData[ handle.Id ].get( );
+    return true;
 }
 
-size_t AnimationBatch::NextAnimationHandle( const std::string &alias )
+AnimationAssetData *AnimationBatch::GetAnimation( const std::string &alias )
 {
-    std::lock_guard lock( m_nextAnimHandleLock );
-    m_nextAnimHandle++;
-    if ( m_nextAnimHandle >= m_animationData.size( ) )
+    std::shared_lock lock( m_animationLock );
+    const auto       it = m_animAliases.find( alias );
+    if ( it == m_animAliases.end( ) )
     {
-        m_animationData.resize( m_nextAnimHandle + 1 );
+        return nullptr;
     }
-    m_animAliases[ alias ] = AnimationClipHandle( m_nextAnimHandle );
-    return m_nextAnimHandle;
+    return m_animationData.Find( it->second.Id )->get( );
+}
+
+AnimationAssetData *AnimationBatch::GetAnimation( const AnimationClipHandle handle ) const
+{
+    std::shared_lock lock( m_animationLock );
+    const auto      *data = m_animationData.Find( handle.Id );
+    return data ? data->get( ) : nullptr;
 }
@@ -21,22 +21,30 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 
 using namespace DZEngine;
 
-AssetBatcher::AssetBatcher( const AssetBatcherDesc &desc ) : m_graphicsContext( desc.GraphicsContext ), m_assetBundle( desc.AssetBundle ), m_assetRegistry( desc.AssetRegistry )
+AssetBatcher::AssetBatcher( const AssetBatcherDesc &desc ) : m_graphicsContext( desc.GraphicsContext ), m_assetBundle( desc.AssetBundle ), m_assetRegistry( desc.AssetRegistry ),
+    m_geometryPageBytes( desc.GeometryPageBytes ), m_assetCache( std::make_unique<AssetCache>( ) )
 {
     m_batches.reserve( 1024 );
     AddBatch( "Default", GeometryLayout::GPUDriven );
 }
 
-size_t AssetBatcher::AddBatch( const std::string &alias, GeometryLayout layout )
+size_t AssetBatcher::AddBatch( const std::string &alias, GeometryLayout layout, const VertexFormat vertexFormat )
+{
+    MeshBatchDesc batchDesc{ };
+    batchDesc.GeometryLayout = layout;
+    batchDesc.VertexFormat   = vertexFormat;
+    return AddBatch( alias, batchDesc );
+}
+
+size_t AssetBatcher::AddBatch( const std::string &alias, MeshBatchDesc meshBatchDesc )
 {
     std::lock_guard lock( m_addBatchMutex );
 
     const size_t index = m_batches.size( );
 
-    MeshBatchDesc batchDesc{ };
-    batchDesc.LogicalDevice  = m_graphicsContext->LogicalDevice;
-    batchDesc.GeometryLayout = layout;
-    const auto meshBatch     = new MeshBatch( batchDesc );
+    meshBatchDesc.LogicalDevice = m_graphicsContext->LogicalDevice;
+    meshBatchDesc.Pool          = GetGeometryPool( meshBatchDesc );
+    const auto meshBatch        = new MeshBatch( meshBatchDesc );
 
     MaterialBatchDesc matBatchDesc{ };
     matBatchDesc.LogicalDevice = m_graphicsContext->LogicalDevice;
@@ -66,6 +74,178 @@ size_t AssetBatcher::NumBatches( ) const
     return m_batches.size( );
 }
 
+void AssetBatcher::ReleaseRetiredGeometry( ) const
+{
+    for ( const auto &pool : m_geometryPools )
+    {
+        pool->ReleaseRetiredBuffers( );
+    }
+}
+
+void AssetBatcher::UpdateResidency( )
+{
+    ++m_frame;
+    std::vector<AssetCacheKey> evicted;
+    m_assetCache->Evict( evicted );
+    for ( const AssetCacheKey &key : evicted )
+    {
+        // Loads of the uri from now on can't find the handle, it only stays valid for the frames in flight
+        if ( m_assetRegistry )
+        {
+            m_assetRegistry->Unregister( key.Type, key.BatchId, key.Id );
+        }
+        m_retiredAssets.push_back( RetiredAsset{ key, m_frame } );
+    }
+    if ( !evicted.empty( ) )
+    {
+        spdlog::debug( "AssetBatcher::UpdateResidency - Evicted {} assets, {} awaiting destruction", evicted.size( ), m_retiredAssets.size( ) );
+    }
+
+    while ( !m_retiredAssets.empty( ) && m_retiredAssets.front( ).Frame + m_graphicsContext->NumFramesInFlight <= m_frame )
+    {
+        UnloadAsset( m_retiredAssets.front( ).Key );
+        m_retiredAssets.pop_front( );
+    }
+
+    GeometrySnapshot snapshot{ .Frame = m_frame };
+    for ( const auto &batch : m_batches )
+    {
+        snapshot.DefragmentVersions.push_back( batch->MeshBatch->GetDefragmentVersion( ) );
+    }
+    for ( const auto &pool : m_geometryPools )
+    {
+        snapshot.PoolVersions.push_back( pool->GetVersion( ) );
+    }
+    const bool changed = m_geometrySnapshots.empty( ) || m_geometrySnapshots.back( ).DefragmentVersions != snapshot.DefragmentVersions ||
+                         m_geometrySnapshots.back( ).PoolVersions != snapshot.PoolVersions;
+    if ( changed )
+    {
+        m_geometrySnapshots.push_back( std::move( snapshot ) );
+    }
+    // Keeps the newest snapshot taken at least NumFramesInFlight calls ago, everything up to it is no longer read by a frame in flight
+    while ( m_geometrySnapshots.size( ) > 1 && m_geometrySnapshots[ 1 ].Frame + m_graphicsContext->NumFramesInFlight <= m_frame )
+    {
+        m_geometrySnapshots.pop_front( );
+    }
+    if ( const GeometrySnapshot &oldest = m_geometrySnapshots.front( ); oldest.Frame + m_graphicsContext->NumFramesInFlight <= m_frame )
+    {
+        for ( size_t i = 0; i < oldest.DefragmentVersions.size( ); ++i )
+        {
+            m_batches[ i ]->MeshBatch->ReleaseDefragmentSources( oldest.DefragmentVersions[ i ] );
+        }
+        for ( size_t i = 0; i < oldest.PoolVersions.size( ); ++i )
+        {
+            m_geometryPools[ i ]->ReleaseRetiredBuffers( oldest.PoolVersions[ i ] );
+        }
+    }
+}
+
+void AssetBatcher::ReleaseRetiredAssets( )
+{
+    for ( const RetiredAsset &retired : m_retiredAssets )
+    {
+        UnloadAsset( retired.Key );
+    }
+    m_retiredAssets.clear( );
+
+    for ( const auto &batch : m_batches )
+    {
+        batch->MeshBatch->ReleaseDefragmentSources( batch->MeshBatch->GetDefragmentVersion( ) );
+    }
+    ReleaseRetiredGeometry( );
+    m_geometrySnapshots.clear( );
+}
+
+bool AssetBatcher::ReplaceAsset( const AssetCacheKey &target, const uint32_t replacementId )
+{
+    if ( target.BatchId >= m_batches.size( ) )
+    {
+        spdlog::error( "AssetBatcher::ReplaceAsset - Invalid batch id: {}", target.BatchId );
+        return false;
+    }
+
+    const AssetBatch &batch    = *m_batches[ target.BatchId ];
+    bool              replaced = false;
+    switch ( target.Type )
+    {
+    case AssetRegistryType::Mesh:
+        replaced = batch.MeshBatch->ReplaceMesh( MeshHandle( target.Id ), MeshHandle( replacementId ) );
+        break;
+    case AssetRegistryType::Material:
+        replaced = batch.MaterialBatch->ReplaceMaterial( MaterialHandle( target.Id ), MaterialHandle( replacementId ) );
+        break;
+    case AssetRegistryType::Texture:
+        replaced = batch.MaterialBatch->ReplaceTexture( TextureHandle( target.Id ), TextureHandle( replacementId ) );
+        break;
+    case AssetRegistryType::Animation:
+        replaced = batch.AnimationBatch->ReplaceAnimation( AnimationClipHandle( target.Id ), AnimationClipHandle( replacementId ) );
+        break;
+    case AssetRegistryType::Skeleton:
+        replaced = batch.SkeletonBatch->ReplaceSkeleton( SkeletonHandle( target.Id ), SkeletonHandle( replacementId ) );
+        break;
+    default:
+        break;
+    }
+    // Either way the replacement is unused, the frames in flight may still read the previous contents it holds now
+    m_retiredAssets.push_back( RetiredAsset{ AssetCacheKey{ target.Type, target.BatchId, replacementId }, m_frame } );
+    return replaced;
+}
+
+uint32_t AssetBatcher::ReleaseAsset( const AssetCacheKey &key ) const
+{
+    if ( key.BatchId >= m_batches.size( ) )
+    {
+        spdlog::error( "AssetBatcher::ReleaseAsset - Invalid batch id: {}", key.BatchId );
+        return 0;
+    }
+    return m_assetCache->Release( key.Type, key.BatchId, key.Id );
+}
+
+void AssetBatcher::UnloadAsset( const AssetCacheKey &key ) const
+{
+    const AssetBatch &batch = *m_batches[ key.BatchId ];
+    switch ( key.Type )
+    {
+    case AssetRegistryType::Mesh:
+        batch.MeshBatch->RemoveMesh( MeshHandle( key.Id ) );
+        break;
+    case AssetRegistryType::Material:
+        batch.MaterialBatch->RemoveMaterial( MaterialHandle( key.Id ) );
+        break;
+    case AssetRegistryType::Texture:
+        batch.MaterialBatch->RemoveTexture( TextureHandle( key.Id ) );
+        break;
+    case AssetRegistryType::Animation:
+        batch.AnimationBatch->RemoveAnimation( AnimationClipHandle( key.Id ) );
+        break;
+    case AssetRegistryType::Skeleton:
+        batch.SkeletonBatch->RemoveSkeleton( SkeletonHandle( key.Id ) );
+        break;
+    default:
+        break;
+    }
+}
+
+GeometryPool *AssetBatcher::GetGeometryPool( const MeshBatchDesc &meshBatchDesc )
+{
+    for ( const auto &pool : m_geometryPools )
+    {
+        if ( pool->IsCompatible( meshBatchDesc.GeometryLayout, meshBatchDesc.VertexFormat, meshBatchDesc.SeparatePositionStream ) )
+        {
+            return pool.get( );
+        }
+    }
+
+    // Starts empty, the batches reserve what they declare
+    GeometryPoolDesc poolDesc{ };
+    poolDesc.LogicalDevice          = m_graphicsContext->LogicalDevice;
+    poolDesc.GeometryLayout         = meshBatchDesc.GeometryLayout;
+    poolDesc.VertexFormat           = meshBatchDesc.VertexFormat;
+    poolDesc.SeparatePositionStream = meshBatchDesc.SeparatePositionStream;
+    poolDesc.PageBytes              = m_geometryPageBytes;
+    return m_geometryPools.emplace_back( std::make_unique<GeometryPool>( poolDesc ) ).get( );
+}
+
 void AssetBatcher::BeginBatchUpdate( size_t batchId ) const
 {
     if ( batchId >= m_batches.size( ) )
@@ -94,7 +274,76 @@ void AssetBatcher::EndBatchUpdate( size_t batchId ) const
     m_batches[ batchId ]->SkeletonBatch->EndUpdate( );
 }
 
-void AssetBatcher::AddMesh( BinaryReader &reader, const std::vector<std::string> &submeshAliases ) const
+void AssetBatcher::SubmitBatchUpdate( size_t batchId ) const
+{
+    if ( batchId >= m_batches.size( ) )
+    {
+        spdlog::error( "Invalid batch id: {}, call AddBatch first", batchId );
+        return;
+    }
+
+    AssetBatch &batch = *m_batches[ batchId ];
+    batch.UpdateSemaphores.clear( );
+    for ( int i = 0; i < 4; ++i )
+    {
+        batch.UpdateSemaphores.emplace_back( m_graphicsContext->LogicalDevice->CreateSemaphore( ) );
+    }
+    batch.MeshBatch->EndUpdate( batch.UpdateSemaphores[ 0 ].get( ) );
+    batch.MaterialBatch->EndUpdate( batch.UpdateSemaphores[ 1 ].get( ) );
+    batch.AnimationBatch->EndUpdate( batch.UpdateSemaphores[ 2 ].get( ) );
+    batch.SkeletonBatch->EndUpdate( batch.UpdateSemaphores[ 3 ].get( ) );
+}
+
+bool AssetBatcher::PollBatchUpdate( size_t batchId ) const
+{
+    if ( batchId >= m_batches.size( ) )
+    {
+        spdlog::error( "Invalid batch id: {}, call AddBatch first", batchId );
+        return false;
+    }
+
+    AssetBatch &batch = *m_batches[ batchId ];
+    for ( const auto &semaphore : batch.UpdateSemaphores )
+    {
+        if ( !semaphore->IsCompleted( ) )
+        {
+            return false;
+        }
+    }
+    if ( !batch.MeshBatch->IsUpdateComplete( ) )
+    {
+        return false;
+    }
+
+    if ( !batch.UpdateSemaphores.empty( ) )
+    {
+        batch.MeshBatch->CommitDefragment( );
+        batch.MeshBatch->ReleaseUploads( );
+        batch.UpdateSemaphores.clear( );
+    }
+    return true;
+}
+
+bool AssetBatcher::DefragmentGeometry( const size_t batchId, const size_t maxBytesToMove ) const
+{
+    if ( batchId >= m_batches.size( ) )
+    {
+        spdlog::error( "Invalid batch id: {}, call AddBatch first", batchId );
+        return false;
+    }
+    if ( !m_batches[ batchId ]->MeshBatch->NeedsDefragment( ) )
+    {
+        return false;
+    }
+
+    BeginBatchUpdate( batchId );
+    const size_t numMovedBytes = m_batches[ batchId ]->MeshBatch->Defragment( maxBytesToMove );
+    SubmitBatchUpdate( batchId );
+    spdlog::debug( "AssetBatcher::DefragmentGeometry - Moving {} bytes of batch {}", numMovedBytes, batchId );
+    return true;
+}
+
+MeshHandle AssetBatcher::AddMesh( BinaryReader &reader, const std::vector<std::string> &submeshAliases ) const
 {
     return AddMesh( 0, reader, submeshAliases );
 }
@@ -104,15 +353,16 @@ void AssetBatcher::AddGeometry( const GeometryData *data, const std::string &ali
     return AddGeometry( 0, data, alias );
 }
 
-void AssetBatcher::AddMesh( size_t batchId, BinaryReader &reader, const std::vector<std::string> &submeshAliases ) const
+MeshHandle AssetBatcher::AddMesh( size_t batchId, BinaryReader &reader, const std::vector<std::string> &submeshAliases ) const
 {
     if ( batchId >= m_batches.size( ) )
     {
         spdlog::error( "Invalid batch id: {}, call AddBatch first", batchId );
-        return;
+        return InvalidMeshHandle;
     }
 
-    m_batches[ batchId ]->MeshBatch->AddMesh( reader, submeshAliases );
+    const GPUMesh gpuMesh = m_batches[ batchId ]->MeshBatch->AddMesh( reader, submeshAliases );
+    return gpuMesh.SubMeshes.empty( ) ? InvalidMeshHandle : gpuMesh.SubMeshes[ 0 ].Handle;
 }
 
 void AssetBatcher::AddGeometry( size_t batchId, const GeometryData *data, const std::string &alias ) const
@@ -153,11 +403,16 @@ MeshHandle AssetBatcher::AddMesh( size_t batchId, const std::string &uri, const
         spdlog::error( "AssetBatcher::AddMeshFromUri - Invalid batch id: {}", batchId );
         return InvalidMeshHandle;
     }
+    if ( uint32_t cachedId; !m_assetCache->Acquire( AssetRegistryType::Mesh, batchId, uri, cachedId ) )
+    {
+        return MeshHandle( cachedId );
+    }
 
     const auto reader = m_assetBundle->LoadAsset( uri );
     if ( !reader )
     {
         spdlog::error( "AssetBatcher::AddMeshFromUri - Failed to load asset: {}", uri );
+        m_assetCache->Publish( AssetRegistryType::Mesh, batchId, uri, InvalidMeshHandle.Id );
         return InvalidMeshHandle;
     }
 
@@ -165,12 +420,14 @@ MeshHandle AssetBatcher::AddMesh( size_t batchId, const std::string &uri, const
     {
         MeshHandle meshHandle = gpuMesh.SubMeshes[ 0 ].Handle;
         m_assetRegistry->RegisterMeshAsset( batchId, meshHandle, uri );
+        m_assetCache->Publish( AssetRegistryType::Mesh, batchId, uri, meshHandle.Id, m_assetBundle->GetAssetNumBytes( uri ) );
 
         spdlog::info( "AssetBatcher::AddMeshFromUri - Added mesh from {} to batch {} with handle {}", uri, batchId, meshHandle.Id );
         return meshHandle;
     }
 
     spdlog::error( "AssetBatcher::AddMeshFromUri - Failed to get valid handle for mesh: {}", uri );
+    m_assetCache->Publish( AssetRegistryType::Mesh, batchId, uri, InvalidMeshHandle.Id );
     return InvalidMeshHandle;
 }
 
@@ -186,14 +443,31 @@ TextureHandle AssetBatcher::LoadTexture( size_t batchId, const std::string &alia
         spdlog::error( "AssetBatcher::LoadTexture - Invalid batch id: {}", batchId );
         return InvalidTextureHandle;
     }
+    if ( uint32_t cachedId; !m_assetCache->Acquire( AssetRegistryType::Texture, batchId, uri, cachedId ) )
+    {
+        return TextureHandle( cachedId );
+    }
     const auto reader = m_assetBundle->LoadAsset( uri );
     if ( !reader )
     {
         spdlog::error( "AssetBatcher::AddMeshFromUri - Failed to load asset: {}", uri );
+        m_assetCache->Publish( AssetRegistryType::Texture, batchId, uri, InvalidTextureHandle.Id );
         return InvalidTextureHandle;
     }
 
-    return m_batches[ batchId ]->MaterialBatch->LoadTexture( alias, *reader );
+    const TextureHandle handle = m_batches[ batchId ]->MaterialBatch->LoadTexture( alias, *reader );
+    m_assetCache->Publish( AssetRegistryType::Texture, batchId, uri, handle.Id, m_assetBundle->GetAssetNumBytes( uri ) );
+    return handle;
+}
+
+TextureHandle AssetBatcher::LoadTexture( size_t batchId, const std::string &alias, BinaryReader &reader ) const
+{
+    if ( batchId >= m_batches.size( ) )
+    {
+        spdlog::error( "AssetBatcher::LoadTexture - Invalid batch id: {}", batchId );
+        return InvalidTextureHandle;
+    }
+    return m_batches[ batchId ]->MaterialBatch->LoadTexture( alias, reader );
 }
 
 TextureHandle AssetBatcher::AddTexture( const std::string &alias, ITextureResource *texture ) const
@@ -233,15 +507,21 @@ AnimationClipHandle AssetBatcher::AddAnimation( size_t batchId, const std::strin
         spdlog::error( "AssetBatcher::AddAnimationFromUri - Invalid batch id: {}", batchId );
         return InvalidAnimationClipHandle;
     }
+    if ( uint32_t cachedId; !m_assetCache->Acquire( AssetRegistryType::Animation, batchId, uri, cachedId ) )
+    {
+        return AnimationClipHandle( cachedId );
+    }
 
     const auto reader = m_assetBundle->LoadAsset( uri );
     if ( !reader )
     {
         spdlog::error( "AssetBatcher::AddAnimationFromUri - Failed to load asset: {}", uri );
+        m_assetCache->Publish( AssetRegistryType::Animation, batchId, uri, InvalidAnimationClipHandle.Id );
         return InvalidAnimationClipHandle;
     }
 
     const AnimationClipHandle handle = m_batches[ batchId ]->AnimationBatch->LoadAnimation( alias, *reader );
+    m_assetCache->Publish( AssetRegistryType::Animation, batchId, uri, handle.Id, m_assetBundle->GetAssetNumBytes( uri ) );
     if ( handle.IsValid( ) )
     {
         m_assetRegistry->RegisterAnimationAsset( batchId, handle, uri );
@@ -260,6 +540,16 @@ AnimationClipHandle AssetBatcher::AddAnimation( const std::string &uri, const st
     return AddAnimation( 0, uri, alias );
 }
 
+AnimationClipHandle AssetBatcher::AddAnimation( size_t batchId, const std::string &alias, const AnimationAssetData &animationData ) const
+{
+    if ( batchId >= m_batches.size( ) )
+    {
+        spdlog::error( "AssetBatcher::AddAnimation - Invalid batch id: {}", batchId );
+        return InvalidAnimationClipHandle;
+    }
+    return m_batches[ batchId ]->AnimationBatch->AddAnimation( alias, animationData );
+}
+
 SkeletonHandle AssetBatcher::AddSkeleton( size_t batchId, const std::string &uri, const std::string &alias ) const
 {
     if ( batchId >= m_batches.size( ) )
@@ -267,15 +557,21 @@ SkeletonHandle AssetBatcher::AddSkeleton( size_t batchId, const std::string &uri
         spdlog::error( "AssetBatcher::AddSkeletonFromUri - Invalid batch id: {}", batchId );
         return InvalidSkeletonHandle;
     }
+    if ( uint32_t cachedId; !m_assetCache->Acquire( AssetRegistryType::Skeleton, batchId, uri, cachedId ) )
+    {
+        return SkeletonHandle( cachedId );
+    }
 
     const auto reader = m_assetBundle->LoadAsset( uri );
     if ( !reader )
     {
         spdlog::error( "AssetBatcher::AddSkeletonFromUri - Failed to load asset: {}", uri );
+        m_assetCache->Publish( AssetRegistryType::Skeleton, batchId, uri, InvalidSkeletonHandle.Id );
         return InvalidSkeletonHandle;
     }
 
     const SkeletonHandle handle = m_batches[ batchId ]->SkeletonBatch->LoadSkeleton( alias, *reader );
+    m_assetCache->Publish( AssetRegistryType::Skeleton, batchId, uri, handle.Id, m_assetBundle->GetAssetNumBytes( uri ) );
     if ( handle.IsValid( ) )
     {
         m_assetRegistry->RegisterSkeletonAsset( batchId, handle, uri );
@@ -294,6 +590,16 @@ SkeletonHandle AssetBatcher::AddSkeleton( const std::string &uri, const std::str
     return AddSkeleton( 0, uri, alias );
 }
 
+SkeletonHandle AssetBatcher::AddSkeleton( size_t batchId, const std::string &alias, const SkeletonAssetData &skeletonData ) const
+{
+    if ( batchId >= m_batches.size( ) )
+    {
+        spdlog::error( "AssetBatcher::AddSkeleton - Invalid batch id: {}", batchId );
+        return InvalidSkeletonHandle;
+    }
+    return m_batches[ batchId ]->SkeletonBatch->AddSkeleton( alias, skeletonData );
+}
+
 AnimationBatch const *AssetBatcher::Animation( size_t batchId ) const
 {
     if ( batchId >= m_batches.size( ) )
@@ -313,3 +619,8 @@ SkeletonBatch const *AssetBatcher::Skeleton( size_t batchId ) const
     }
     return m_batches[ batchId ]->SkeletonBatch.get( );
 }
+
+AssetCache *AssetBatcher::Cache( ) const
+{
+    return m_assetCache.get( );
+}
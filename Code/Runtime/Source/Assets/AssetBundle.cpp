@@ -17,6 +17,7 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 */
 
 #include "DZEngine/Assets/AssetBundle.h"
+#include <ranges>
 #include <spdlog/spdlog.h>
 
 using namespace DZEngine;
@@ -26,7 +27,29 @@ AssetBundle::AssetBundle( const std::filesystem::path &assetsDir ) : m_assetsDir
     spdlog::info( "AssetBundle: Created with assets directory: {}", assetsDir.string( ) );
 }
 
-std::unique_ptr<BinaryReader> AssetBundle::LoadAsset( const std::string &uri ) const
+bool AssetBundle::MountPack( const std::filesystem::path &packPath, tf::Executor *executor )
+{
+    auto pack = std::make_unique<AssetPack>( packPath, executor );
+    if ( !pack->IsValid( ) )
+    {
+        spdlog::error( "AssetBundle::MountPack - Failed to mount {}", packPath.string( ) );
+        return false;
+    }
+    m_packs.push_back( std::move( pack ) );
+    return true;
+}
+
+void AssetBundle::UnmountPacks( )
+{
+    m_packs.clear( );
+}
+
+void AssetBundle::SetFileIO( IFileIO *fileIO )
+{
+    m_fileIO = fileIO;
+}
+
+AssetReader AssetBundle::LoadAsset( const std::string &uri ) const
 {
     if ( !IsValidAssetUri( uri ) )
     {
@@ -34,6 +57,12 @@ std::unique_ptr<BinaryReader> AssetBundle::LoadAsset( const std::string &uri ) c
         return nullptr;
     }
 
+    const std::string path = ExtractPathFromUri( uri );
+    if ( const AssetPack *pack = FindPack( path ) )
+    {
+        return pack->LoadAsset( path );
+    }
+
     std::filesystem::path resolvedPath;
     if ( const AssetLoadResult result = ResolveUri( uri, resolvedPath ); result != AssetLoadResult::Success )
     {
@@ -47,8 +76,68 @@ std::unique_ptr<BinaryReader> AssetBundle::LoadAsset( const std::string &uri ) c
         return nullptr;
     }
 
-    auto reader = std::make_unique<BinaryReader>( resolvedPath.string( ).c_str( ) );
-    return reader;
+    return AssetReader( new BinaryReader( resolvedPath.string( ).c_str( ) ) );
+}
+
+bool AssetBundle::ReadAsset( const std::string &uri, Byte *dst, const size_t dstNumBytes ) const
+{
+    AssetRead read{ };
+    read.Uri      = uri;
+    read.Dst      = dst;
+    read.NumBytes = dstNumBytes;
+    ReadAssets( std::span( &read, 1 ) );
+    return read.Succeeded;
+}
+
+void AssetBundle::ReadAssets( const std::span<AssetRead> reads ) const
+{
+    std::vector<FileRead>    fileReads;
+    std::vector<AssetRead *> looseReads;
+    for ( AssetRead &read : reads )
+    {
+        read.Succeeded = false;
+        if ( !IsValidAssetUri( read.Uri ) )
+        {
+            spdlog::error( "AssetBundle::ReadAssets - Invalid asset URI: {}", read.Uri );
+            continue;
+        }
+
+        const std::string path = ExtractPathFromUri( read.Uri );
+        if ( const AssetPack *pack = FindPack( path ) )
+        {
+            read.Succeeded = pack->ReadAsset( path, read.Dst, read.NumBytes );
+            continue;
+        }
+
+        FileRead &fileRead = fileReads.emplace_back( );
+        ResolveUri( read.Uri, fileRead.Path );
+        fileRead.Dst      = read.Dst;
+        fileRead.NumBytes = read.NumBytes;
+        looseReads.push_back( &read );
+    }
+
+    if ( m_fileIO )
+    {
+        FileReadBatch batch;
+        m_fileIO->Read( fileReads, batch );
+        batch.Wait( );
+    }
+    else
+    {
+        for ( FileRead &fileRead : fileReads )
+        {
+            ThreadPoolFileIO::ReadFile( fileRead );
+        }
+    }
+
+    for ( size_t i = 0; i < looseReads.size( ); ++i )
+    {
+        looseReads[ i ]->Succeeded = fileReads[ i ].Succeeded;
+        if ( !fileReads[ i ].Succeeded )
+        {
+            spdlog::error( "AssetBundle::ReadAssets - Failed to read {} bytes from {}", fileReads[ i ].NumBytes, fileReads[ i ].Path.string( ) );
+        }
+    }
 }
 
 bool AssetBundle::AssetExists( const std::string &uri ) const
@@ -57,6 +146,10 @@ bool AssetBundle::AssetExists( const std::string &uri ) const
     {
         return false;
     }
+    if ( FindPack( ExtractPathFromUri( uri ) ) )
+    {
+        return true;
+    }
 
     std::filesystem::path resolvedPath;
     if ( ResolveUri( uri, resolvedPath ) != AssetLoadResult::Success )
@@ -67,6 +160,34 @@ bool AssetBundle::AssetExists( const std::string &uri ) const
     return std::filesystem::exists( resolvedPath );
 }
 
+bool AssetBundle::IsPacked( const std::string &uri ) const
+{
+    return IsValidAssetUri( uri ) && FindPack( ExtractPathFromUri( uri ) );
+}
+
+size_t AssetBundle::GetAssetNumBytes( const std::string &uri ) const
+{
+    if ( !IsValidAssetUri( uri ) )
+    {
+        return 0;
+    }
+
+    const std::string path = ExtractPathFromUri( uri );
+    if ( const AssetPack *pack = FindPack( path ) )
+    {
+        return pack->GetAssetNumBytes( path );
+    }
+
+    std::filesystem::path resolvedPath;
+    std::error_code       error;
+    if ( ResolveUri( uri, resolvedPath ) != AssetLoadResult::Success )
+    {
+        return 0;
+    }
+    const auto numBytes = std::filesystem::file_size( resolvedPath, error );
+    return error ? 0 : static_cast<size_t>( numBytes );
+}
+
 AssetLoadResult AssetBundle::ResolveUri( const std::string &uri, std::filesystem::path &outPath ) const
 {
     if ( !IsValidAssetUri( uri ) )
@@ -110,3 +231,15 @@ std::string AssetBundle::ExtractPathFromUri( const std::string &uri ) const
 
     return uri.substr( prefix.length( ) );
 }
+
+const AssetPack *AssetBundle::FindPack( const std::string &path ) const
+{
+    for ( const auto &pack : m_packs | std::views::reverse )
+    {
+        if ( pack->Contains( path ) )
+        {
+            return pack.get( );
+        }
+    }
+    return nullptr;
+}
@@ -0,0 +1,356 @@
+/*
+Den Of Iz - Game/Game Engine
+Copyright (c) 2020-2024 Muhammed Murat Cengiz
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "DZEngine/Assets/AssetCache.h"
+#include <utility>
+
+using namespace DZEngine;
+
+size_t AssetCache::KeyHash::operator( )( const AssetCacheKey &key ) const
+{
+    return std::hash<size_t>{ }( key.BatchId * 31 + key.Id ) ^ static_cast<size_t>( key.Type );
+}
+
+bool AssetCache::Acquire( const AssetRegistryType type, const size_t batchId, const std::string &uri, uint32_t &outId )
+{
+    std::unique_lock    lock( m_lock );
+    std::vector<Entry> &entries = m_entries[ uri ];
+    Entry              *entry   = FindEntry( entries, type, batchId );
+    if ( !entry )
+    {
+        entries.push_back( Entry{ .Type = type, .BatchId = batchId, .NumReferences = 1, .State = AssetCacheState::Loading } );
+        return true;
+    }
+    if ( entry->State == AssetCacheState::Failed )
+    {
+        entry->NumReferences = 1;
+        entry->State         = AssetCacheState::Loading;
+        return true;
+    }
+
+    ++entry->NumReferences;
+    UpdateResidency( *entry );
+    // The vector of the uri may grow while waiting, the entry is looked up again
+    m_published.wait( lock, [ & ] { return FindEntry( m_entries[ uri ], type, batchId )->State != AssetCacheState::Loading; } );
+    outId = FindEntry( m_entries[ uri ], type, batchId )->Id;
+    return false;
+}
+
+bool AssetCache::TryAcquire( const AssetRegistryType type, const size_t batchId, const std::string &uri, uint32_t &outId )
+{
+    std::lock_guard lock( m_lock );
+    const auto      entries = m_entries.find( uri );
+    if ( entries == m_entries.end( ) )
+    {
+        return false;
+    }
+    Entry *entry = FindEntry( entries->second, type, batchId );
+    if ( !entry || entry->State != AssetCacheState::Ready )
+    {
+        return false;
+    }
+    ++entry->NumReferences;
+    UpdateResidency( *entry );
+    outId = entry->Id;
+    return true;
+}
+
+void AssetCache::Publish( const AssetRegistryType type, const size_t batchId, const std::string &uri, const uint32_t id, const size_t numBytes )
+{
+    {
+        std::lock_guard lock( m_lock );
+        Entry          *entry = FindEntry( m_entries[ uri ], type, batchId );
+        if ( !entry )
+        {
+            return;
+        }
+        if ( id == UINT32_MAX )
+        {
+            entry->State         = AssetCacheState::Failed;
+            entry->NumReferences = 0;
+        }
+        else
+        {
+            SetReady( *entry, uri, id, numBytes );
+        }
+    }
+    m_published.notify_all( );
+}
+
+void AssetCache::Add( const AssetRegistryType type, const size_t batchId, const std::string &uri, const uint32_t id, const uint32_t numReferences, const size_t numBytes )
+{
+    {
+        std::lock_guard     lock( m_lock );
+        std::vector<Entry> &entries = m_entries[ uri ];
+        Entry              *entry   = FindEntry( entries, type, batchId );
+        if ( !entry )
+        {
+            entry = &entries.emplace_back( Entry{ .Type = type, .BatchId = batchId } );
+        }
+        if ( entry->State == AssetCacheState::Failed )
+        {
+            entry->NumReferences = 0;
+        }
+        entry->NumReferences += numReferences;
+        SetReady( *entry, uri, id, numBytes );
+    }
+    // Loads waiting on Acquire take the added asset
+    m_published.notify_all( );
+}
+
+uint32_t AssetCache::Retain( const AssetRegistryType type, const size_t batchId, const uint32_t id )
+{
+    std::lock_guard lock( m_lock );
+    Entry          *entry = FindEntry( AssetCacheKey{ type, batchId, id } );
+    if ( !entry )
+    {
+        return 0;
+    }
+    ++entry->NumReferences;
+    UpdateResidency( *entry );
+    return entry->NumReferences;
+}
+
+uint32_t AssetCache::Release( const AssetRegistryType type, const size_t batchId, const uint32_t id )
+{
+    std::lock_guard lock( m_lock );
+    Entry          *entry = FindEntry( AssetCacheKey{ type, batchId, id } );
+    if ( !entry || entry->NumReferences == 0 )
+    {
+        return 0;
+    }
+    --entry->NumReferences;
+    UpdateResidency( *entry );
+    return entry->NumReferences;
+}
+
+bool AssetCache::SetDependencies( const AssetRegistryType type, const size_t batchId, const uint32_t id, std::vector<AssetCacheKey> dependencies )
+{
+    std::lock_guard lock( m_lock );
+    Entry          *entry = FindEntry( AssetCacheKey{ type, batchId, id } );
+    if ( !entry || !entry->Dependencies.empty( ) )
+    {
+        return false;
+    }
+    entry->Dependencies = std::move( dependencies );
+    return true;
+}
+
+bool AssetCache::Reload( const AssetRegistryType type, const size_t batchId, const uint32_t id, const size_t numBytes, std::vector<AssetCacheKey> dependencies )
+{
+    std::lock_guard lock( m_lock );
+    Entry          *entry = FindEntry( AssetCacheKey{ type, batchId, id } );
+    if ( !entry )
+    {
+        return false;
+    }
+    Category &category = m_categories[ static_cast<size_t>( type ) ];
+    category.NumResidentBytes += numBytes - entry->NumBytes;
+    if ( entry->Unreferenced )
+    {
+        category.NumUnreferencedBytes += numBytes - entry->NumBytes;
+    }
+    entry->NumBytes = numBytes;
+    // Released after the swap, a dependency shared by both versions keeps its references
+    const std::vector<AssetCacheKey> previous = std::exchange( entry->Dependencies, std::move( dependencies ) );
+    for ( const AssetCacheKey &dependency : previous )
+    {
+        ReleaseLocked( dependency );
+    }
+    return true;
+}
+
+void AssetCache::SetBudget( const AssetRegistryType type, const size_t numBytes )
+{
+    std::lock_guard lock( m_lock );
+    m_categories[ static_cast<size_t>( type ) ].Budget = numBytes;
+}
+
+void AssetCache::Evict( std::vector<AssetCacheKey> &outEvicted )
+{
+    std::lock_guard lock( m_lock );
+    for ( Category &category : m_categories )
+    {
+        while ( !category.Unreferenced.empty( ) && ( category.Budget == 0 || category.NumResidentBytes > category.Budget ) )
+        {
+            const AssetCacheKey key     = category.Unreferenced.front( );
+            const auto          uri     = m_uris.find( key );
+            std::vector<Entry> &entries = m_entries[ uri->second ];
+            Entry              *entry   = FindEntry( entries, key.Type, key.BatchId );
+
+            category.Unreferenced.pop_front( );
+            category.NumResidentBytes -= entry->NumBytes;
+            category.NumUnreferencedBytes -= entry->NumBytes;
+            --category.NumAssets;
+            ++category.NumEvicted;
+            // May add unreferenced assets to this or a later category
+            const std::vector<AssetCacheKey> dependencies = std::move( entry->Dependencies );
+            std::erase_if( entries, [ & ]( const Entry &other ) { return &other == entry; } );
+            if ( entries.empty( ) )
+            {
+                m_entries.erase( uri->second );
+            }
+            m_uris.erase( uri );
+            for ( const AssetCacheKey &dependency : dependencies )
+            {
+                ReleaseLocked( dependency );
+            }
+            outEvicted.push_back( key );
+        }
+    }
+}
+
+uint32_t AssetCache::GetNumReferences( const AssetRegistryType type, const size_t batchId, const uint32_t id ) const
+{
+    std::lock_guard lock( m_lock );
+    const auto      uri = m_uris.find( AssetCacheKey{ type, batchId, id } );
+    if ( uri == m_uris.end( ) )
+    {
+        return 0;
+    }
+    for ( const Entry &entry : m_entries.at( uri->second ) )
+    {
+        if ( entry.Type == type && entry.BatchId == batchId && entry.Id == id )
+        {
+            return entry.NumReferences;
+        }
+    }
+    return 0;
+}
+
+bool AssetCache::FindAny( const AssetRegistryType type, const std::string &uri, size_t &outBatchId, uint32_t &outId ) const
+{
+    std::lock_guard lock( m_lock );
+    const auto      entries = m_entries.find( uri );
+    if ( entries == m_entries.end( ) )
+    {
+        return false;
+    }
+    for ( const Entry &entry : entries->second )
+    {
+        if ( entry.Type == type && entry.State == AssetCacheState::Ready )
+        {
+            outBatchId = entry.BatchId;
+            outId      = entry.Id;
+            return true;
+        }
+    }
+    return false;
+}
+
+size_t AssetCache::GetNumEntries( ) const
+{
+    std::lock_guard lock( m_lock );
+    return m_uris.size( );
+}
+
+AssetCacheStats AssetCache::GetStats( const AssetRegistryType type ) const
+{
+    std::lock_guard lock( m_lock );
+    const Category &category = m_categories[ static_cast<size_t>( type ) ];
+    AssetCacheStats stats{ };
+    stats.Budget               = category.Budget;
+    stats.NumResidentBytes     = category.NumResidentBytes;
+    stats.NumUnreferencedBytes = category.NumUnreferencedBytes;
+    stats.NumAssets            = category.NumAssets;
+    stats.NumUnreferenced      = category.Unreferenced.size( );
+    stats.NumEvicted           = category.NumEvicted;
+    return stats;
+}
+
+AssetCache::Entry *AssetCache::FindEntry( std::vector<Entry> &entries, const AssetRegistryType type, const size_t batchId )
+{
+    for ( Entry &entry : entries )
+    {
+        if ( entry.Type == type && entry.BatchId == batchId )
+        {
+            return &entry;
+        }
+    }
+    return nullptr;
+}
+
+AssetCache::Entry *AssetCache::FindEntry( const AssetCacheKey &key )
+{
+    const auto uri = m_uris.find( key );
+    if ( uri == m_uris.end( ) )
+    {
+        return nullptr;
+    }
+    Entry *entry = FindEntry( m_entries[ uri->second ], key.Type, key.BatchId );
+    return entry && entry->Id == key.Id ? entry : nullptr;
+}
+
+void AssetCache::SetReady( Entry &entry, const std::string &uri, const uint32_t id, const size_t numBytes )
+{
+    // Only ready entries are resident, one published again is counted with its new handle and size
+    Category &category = m_categories[ static_cast<size_t>( entry.Type ) ];
+    if ( entry.State == AssetCacheState::Ready )
+    {
+        if ( entry.Unreferenced )
+        {
+            category.Unreferenced.erase( entry.LruPosition );
+            category.NumUnreferencedBytes -= entry.NumBytes;
+            entry.Unreferenced = false;
+        }
+        category.NumResidentBytes -= entry.NumBytes;
+        --category.NumAssets;
+    }
+    if ( entry.Id != UINT32_MAX && entry.Id != id )
+    {
+        m_uris.erase( AssetCacheKey{ entry.Type, entry.BatchId, entry.Id } );
+    }
+    entry.Id       = id;
+    entry.State    = AssetCacheState::Ready;
+    entry.NumBytes = numBytes;
+    category.NumResidentBytes += numBytes;
+    ++category.NumAssets;
+    m_uris.insert_or_assign( AssetCacheKey{ entry.Type, entry.BatchId, id }, uri );
+    UpdateResidency( entry );
+}
+
+void AssetCache::UpdateResidency( Entry &entry )
+{
+    const bool unreferenced = entry.State == AssetCacheState::Ready && entry.NumReferences == 0;
+    if ( unreferenced == entry.Unreferenced )
+    {
+        return;
+    }
+
+    Category &category = m_categories[ static_cast<size_t>( entry.Type ) ];
+    if ( unreferenced )
+    {
+        entry.LruPosition = category.Unreferenced.insert( category.Unreferenced.end( ), AssetCacheKey{ entry.Type, entry.BatchId, entry.Id } );
+        category.NumUnreferencedBytes += entry.NumBytes;
+    }
+    else
+    {
+        category.Unreferenced.erase( entry.LruPosition );
+        category.NumUnreferencedBytes -= entry.NumBytes;
+    }
+    entry.Unreferenced = unreferenced;
+}
+
+void AssetCache::ReleaseLocked( const AssetCacheKey &key )
+{
+    if ( Entry *entry = FindEntry( key ); entry && entry->NumReferences > 0 )
+    {
+        --entry->NumReferences;
+        UpdateResidency( *entry );
+    }
+}
@@ -0,0 +1,772 @@
+/*
+Den Of Iz - Game/Game Engine
+Copyright (c) 2020-2024 Muhammed Murat Cengiz
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "DZEngine/Assets/AssetCooker.h"
+#include <DenOfIzGraphics/Assets/Import/AssimpImporter.h>
+#include <DenOfIzGraphics/Assets/Import/TextureImporter.h>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <nlohmann/json.hpp>
+#include <ranges>
+#include <set>
+#include <spdlog/spdlog.h>
+#include <sstream>
+#include <taskflow/taskflow.hpp>
+#include <unordered_map>
+#include "DZEngine/Assets/MeshAssetProcessor.h"
+
+using namespace DZEngine;
+using json = nlohmann::json;
+
+namespace
+{
+    constexpr uint32_t DatabaseVersion  = 1;
+    constexpr size_t   HashBufferSize   = 1 << 20;
+    constexpr auto     ModelExtensions  = { ".gltf", ".glb", ".fbx", ".obj", ".dae" };
+    constexpr auto     ImageExtensions  = { ".png", ".jpg", ".jpeg", ".tga", ".bmp", ".hdr" };
+    constexpr auto     TextureMapPrefix = "map_";
+
+    std::string Lower( std::string text )
+    {
+        std::ranges::transform( text, text.begin( ), []( const unsigned char c ) { return static_cast<char>( std::tolower( c ) ); } );
+        return text;
+    }
+
+    bool HasExtension( const std::filesystem::path &path, const std::initializer_list<const char *> extensions )
+    {
+        const std::string extension = Lower( path.extension( ).string( ) );
+        return std::ranges::any_of( extensions, [ & ]( const char *candidate ) { return extension == candidate; } );
+    }
+
+    // glTF uris are percent encoded
+    std::string DecodeUri( const std::string &uri )
+    {
+        std::string decoded;
+        for ( size_t i = 0; i < uri.size( ); ++i )
+        {
+            if ( uri[ i ] == '%' && i + 2 < uri.size( ) )
+            {
+                decoded += static_cast<char>( std::stoi( uri.substr( i + 1, 2 ), nullptr, 16 ) );
+                i += 2;
+                continue;
+            }
+            decoded += uri[ i ];
+        }
+        return decoded;
+    }
+
+    std::optional<AssetRegistryType> RegistryTypeOf( const std::filesystem::path &path )
+    {
+        const std::string extension = path.extension( ).string( );
+        if ( extension == ".dzmesh" )
+        {
+            return AssetRegistryType::Mesh;
+        }
+        if ( extension == ".dzmat" )
+        {
+            return AssetRegistryType::Material;
+        }
+        if ( extension == ".dztex" )
+        {
+            return AssetRegistryType::Texture;
+        }
+        if ( extension == ".dzanim" )
+        {
+            return AssetRegistryType::Animation;
+        }
+        if ( extension == ".dzskel" )
+        {
+            return AssetRegistryType::Skeleton;
+        }
+        return std::nullopt;
+    }
+
+    template <typename T>
+    void Append( std::vector<Byte> &data, const T &value )
+    {
+        const auto *bytes = reinterpret_cast<const Byte *>( &value );
+        data.insert( data.end( ), bytes, bytes + sizeof( T ) );
+    }
+
+    template <typename T>
+    bool Consume( std::span<const Byte> &data, T &outValue )
+    {
+        if ( data.size( ) < sizeof( T ) )
+        {
+            return false;
+        }
+        std::memcpy( &outValue, data.data( ), sizeof( T ) );
+        data = data.subspan( sizeof( T ) );
+        return true;
+    }
+} // namespace
+
+AssetCooker::AssetCooker( const AssetCookerDesc &desc ) :
+    m_sourceDirectory( std::filesystem::absolute( desc.SourceDirectory ) ), m_outputDirectory( std::filesystem::absolute( desc.OutputDirectory ) ), m_executor( desc.Executor ),
+    m_cache( desc.Cache ), m_batchId( desc.BatchId ), m_force( desc.Force ),
+    m_meshProcessing{ desc.OptimizeMeshes, desc.LODs }
+{
+}
+
+bool AssetCooker::Cook( )
+{
+    const auto start = std::chrono::steady_clock::now( );
+    m_results.clear( );
+    m_stats = { };
+
+    std::error_code error;
+    if ( !std::filesystem::is_directory( m_sourceDirectory, error ) )
+    {
+        spdlog::error( "AssetCooker: Source directory {} doesn't exist", m_sourceDirectory.string( ) );
+        return false;
+    }
+    std::filesystem::create_directories( m_outputDirectory, error );
+    if ( error )
+    {
+        spdlog::error( "AssetCooker: Failed to create {}: {}", m_outputDirectory.string( ), error.message( ) );
+        return false;
+    }
+    LoadDatabase( );
+
+    const std::vector<Source>          sources = Scan( );
+    std::vector<std::optional<Record>> records( sources.size( ) );
+    m_results.resize( sources.size( ) );
+
+    // Sources sharing a referenced file run one after the other, each depends on the previous one referencing the file
+    tf::Taskflow                            taskflow;
+    std::vector<tf::Task>                   tasks;
+    std::unordered_map<std::string, size_t> lastReferences;
+    for ( size_t i = 0; i < sources.size( ); ++i )
+    {
+        tasks.push_back( taskflow.emplace( [ this, &sources, &records, i ] { m_results[ i ] = CookSource( sources[ i ], records[ i ] ); } ) );
+        for ( const std::string &dependency : sources[ i ].Dependencies )
+        {
+            if ( const auto [ last, inserted ] = lastReferences.try_emplace( dependency, i ); !inserted )
+            {
+                tasks[ last->second ].precede( tasks[ i ] );
+                last->second = i;
+            }
+        }
+    }
+    if ( m_executor )
+    {
+        m_executor->run( taskflow ).wait( );
+    }
+    else
+    {
+        tf::Executor executor( 1 );
+        executor.run( taskflow ).wait( );
+    }
+
+    // Failed sources keep their previous record, so their outputs stay and they are cooked again on the next run
+    std::map<std::string, Record> previousRecords = std::move( m_records );
+    m_records.clear( );
+    for ( size_t i = 0; i < sources.size( ); ++i )
+    {
+        if ( records[ i ] )
+        {
+            m_records[ sources[ i ].Path ] = std::move( *records[ i ] );
+        }
+        else if ( const auto previous = previousRecords.find( sources[ i ].Path ); previous != previousRecords.end( ) )
+        {
+            m_records[ sources[ i ].Path ] = previous->second;
+        }
+
+        switch ( m_results[ i ].Status )
+        {
+        case AssetCookStatus::UpToDate:
+            ++m_stats.NumUpToDate;
+            break;
+        case AssetCookStatus::Cooked:
+            ++m_stats.NumCooked;
+            break;
+        case AssetCookStatus::CacheHit:
+            ++m_stats.NumCacheHits;
+            break;
+        case AssetCookStatus::Failed:
+            ++m_stats.NumFailed;
+            break;
+        }
+    }
+    for ( const auto &path : previousRecords | std::views::keys )
+    {
+        if ( !m_records.contains( path ) )
+        {
+            spdlog::info( "AssetCooker: {} was removed", path );
+            ++m_stats.NumRemoved;
+        }
+    }
+    RemoveStaleOutputs( previousRecords );
+
+    const bool saved   = UpdateRegistry( ) && SaveDatabase( );
+    m_stats.NumSources = sources.size( );
+    m_stats.Seconds    = std::chrono::duration<double>( std::chrono::steady_clock::now( ) - start ).count( );
+    spdlog::info( "AssetCooker: {} sources, {} cooked, {} from the cache, {} up to date, {} failed, {} removed in {:.3f} s", m_stats.NumSources, m_stats.NumCooked,
+                  m_stats.NumCacheHits, m_stats.NumUpToDate, m_stats.NumFailed, m_stats.NumRemoved, m_stats.Seconds );
+    return saved && m_stats.NumFailed == 0;
+}
+
+const std::vector<AssetCookResult> &AssetCooker::GetResults( ) const
+{
+    return m_results;
+}
+
+AssetCookStats AssetCooker::GetStats( ) const
+{
+    return m_stats;
+}
+
+std::vector<AssetCooker::Source> AssetCooker::Scan( ) const
+{
+    std::vector<Source> models;
+    std::vector<Source> textures;
+    std::error_code     error;
+    for ( const auto &file : std::filesystem::recursive_directory_iterator( m_sourceDirectory, error ) )
+    {
+        if ( !file.is_regular_file( error ) )
+        {
+            continue;
+        }
+        const std::string path = std::filesystem::relative( file.path( ), m_sourceDirectory ).generic_string( );
+        if ( HasExtension( file.path( ), ModelExtensions ) )
+        {
+            models.push_back( Source{ path, ProcessorType::Model, { } } );
+            FindDependencies( models.back( ) );
+        }
+        else if ( HasExtension( file.path( ), ImageExtensions ) )
+        {
+            textures.push_back( Source{ path, ProcessorType::Texture, { } } );
+        }
+    }
+    if ( error )
+    {
+        spdlog::warn( "AssetCooker: Failed to scan {} completely: {}", m_sourceDirectory.string( ), error.message( ) );
+    }
+
+    // Images referenced by a model are imported with it
+    std::set<std::string> referenced;
+    for ( const Source &model : models )
+    {
+        referenced.insert( model.Dependencies.begin( ), model.Dependencies.end( ) );
+    }
+    std::vector<Source> sources = std::move( models );
+    std::ranges::copy_if( textures, std::back_inserter( sources ), [ & ]( const Source &texture ) { return !referenced.contains( texture.Path ); } );
+    std::ranges::sort( sources, { }, &Source::Path );
+    return sources;
+}
+
+void AssetCooker::FindDependencies( Source &source ) const
+{
+    const std::filesystem::path path      = m_sourceDirectory / source.Path;
+    const std::filesystem::path directory = path.parent_path( );
+    const auto                  add       = [ & ]( const std::filesystem::path &file )
+    {
+        std::error_code             error;
+        const std::filesystem::path dependency = ( directory / file ).lexically_normal( );
+        if ( std::filesystem::is_regular_file( dependency, error ) )
+        {
+            source.Dependencies.push_back( std::filesystem::relative( dependency, m_sourceDirectory, error ).generic_string( ) );
+        }
+        else
+        {
+            spdlog::warn( "AssetCooker: {} references {}, which doesn't exist", source.Path, dependency.string( ) );
+        }
+    };
+
+    const std::string extension = Lower( path.extension( ).string( ) );
+    if ( extension == ".gltf" )
+    {
+        std::ifstream file( path );
+        const json    gltf = json::parse( file, nullptr, false );
+        if ( gltf.is_discarded( ) )
+        {
+            spdlog::warn( "AssetCooker: Invalid JSON in {}", source.Path );
+            return;
+        }
+        for ( const char *key : { "buffers", "images" } )
+        {
+            const auto entries = gltf.find( key );
+            if ( entries == gltf.end( ) || !entries->is_array( ) )
+            {
+                continue;
+            }
+            for ( const json &entry : *entries )
+            {
+                const std::string uri = entry.value( "uri", "" );
+                if ( !uri.empty( ) && !uri.starts_with( "data:" ) ) // Embedded otherwise
+                {
+                    add( std::filesystem::path( DecodeUri( uri ) ) );
+                }
+            }
+        }
+    }
+    else if ( extension == ".obj" )
+    {
+        std::ifstream file( path );
+        std::string   line;
+        while ( std::getline( file, line ) )
+        {
+            if ( !line.starts_with( "mtllib " ) )
+            {
+                continue;
+            }
+            std::istringstream names( line.substr( 7 ) );
+            std::string        name;
+            while ( names >> name )
+            {
+                const size_t numDependencies = source.Dependencies.size( );
+                add( name );
+                if ( source.Dependencies.size( ) == numDependencies )
+                {
+                    continue;
+                }
+                // The last token of a texture statement is the file, options precede it
+                std::ifstream library( directory / name );
+                std::string   statement;
+                while ( std::getline( library, statement ) )
+                {
+                    std::istringstream tokens( statement );
+                    std::string        keyword;
+                    std::string        token;
+                    std::string        texture;
+                    tokens >> keyword;
+                    if ( !keyword.starts_with( TextureMapPrefix ) && keyword != "bump" && keyword != "disp" && keyword != "norm" )
+                    {
+                        continue;
+                    }
+                    while ( tokens >> token )
+                    {
+                        texture = token;
+                    }
+                    if ( !texture.empty( ) )
+                    {
+                        add( texture );
+                    }
+                }
+            }
+        }
+    }
+    // glb and dae embed or reference their images in ways not tracked here, fbx is binary, they are cooked again when the file itself changes
+
+    std::ranges::sort( source.Dependencies );
+    const auto [ first, last ] = std::ranges::unique( source.Dependencies );
+    source.Dependencies.erase( first, last );
+}
+
+AssetCookResult AssetCooker::CookSource( const Source &source, std::optional<Record> &outRecord ) const
+{
+    const auto      start = std::chrono::steady_clock::now( );
+    AssetCookResult result{ };
+    result.Path = source.Path;
+
+    const auto finish = [ & ]( const AssetCookStatus status )
+    {
+        result.Status  = status;
+        result.Seconds = std::chrono::duration<double>( std::chrono::steady_clock::now( ) - start ).count( );
+        if ( status == AssetCookStatus::Cooked )
+        {
+            spdlog::info( "AssetCooker: Cooked {} in {:.1f} ms, {} outputs", source.Path, result.Seconds * 1000.0, result.Outputs.size( ) );
+        }
+        else if ( status == AssetCookStatus::CacheHit )
+        {
+            spdlog::info( "AssetCooker: Copied {} from the cache in {:.1f} ms, {} outputs", source.Path, result.Seconds * 1000.0, result.Outputs.size( ) );
+        }
+        return result;
+    };
+
+    Record record{ };
+    if ( !StateOf( source.Path, record.State ) )
+    {
+        return finish( AssetCookStatus::Failed );
+    }
+    for ( const std::string &dependency : source.Dependencies )
+    {
+        if ( !StateOf( dependency, record.Dependencies[ dependency ] ) )
+        {
+            return finish( AssetCookStatus::Failed );
+        }
+    }
+
+    const auto previous       = m_records.find( source.Path );
+    const bool known          = !m_force && previous != m_records.end( ) && OutputsExist( previous->second );
+    const auto sameFile       = []( const FileState &a, const FileState &b ) { return a.NumBytes == b.NumBytes && a.LastWrite == b.LastWrite; };
+    const auto sameDependency = [ & ]( const auto &a, const auto &b ) { return a.first == b.first && sameFile( a.second, b.second ); };
+    if ( known && sameFile( record.State, previous->second.State ) && std::ranges::equal( record.Dependencies, previous->second.Dependencies, sameDependency ) )
+    {
+        outRecord      = previous->second;
+        result.Outputs = previous->second.Outputs;
+        return finish( AssetCookStatus::UpToDate );
+    }
+
+    // The source path is part of the key since the outputs are written next to it
+    ContentHasher hasher;
+    hasher.Update( source.Path );
+    if ( !HashOf( source.Path, record.State ) )
+    {
+        return finish( AssetCookStatus::Failed );
+    }
+    hasher.UpdateValue( record.State.Hash );
+    for ( auto &[ path, state ] : record.Dependencies )
+    {
+        if ( !HashOf( path, state ) )
+        {
+            return finish( AssetCookStatus::Failed );
+        }
+        hasher.Update( path );
+        hasher.UpdateValue( state.Hash );
+    }
+    if ( source.Processor == ProcessorType::Model ) // Field by field, the padding of the desc isn't initialized
+    {
+        hasher.UpdateValue( m_meshProcessing.Optimize );
+        hasher.UpdateValue( m_meshProcessing.LODs.NumLevels );
+        hasher.UpdateValue( m_meshProcessing.LODs.Reduction );
+        hasher.UpdateValue( m_meshProcessing.LODs.MaxError );
+        hasher.UpdateValue( m_meshProcessing.LODs.MinNumTriangles );
+        hasher.UpdateValue( m_meshProcessing.LODs.MinProgress );
+    }
+    record.Key = DerivedDataCache::MakeKey( source.Processor == ProcessorType::Model ? "AssetCooker.Model" : "AssetCooker.Texture", CookVersion, hasher.Finish( ) );
+
+    if ( known && record.Key == previous->second.Key ) // Only touched
+    {
+        record.Outputs = previous->second.Outputs;
+        result.Outputs = record.Outputs;
+        outRecord      = std::move( record );
+        return finish( AssetCookStatus::UpToDate );
+    }
+
+    std::vector<Byte> cached;
+    if ( m_cache && m_cache->Get( record.Key, cached ) && UnpackOutputs( cached, record.Outputs ) )
+    {
+        result.Outputs = record.Outputs;
+        outRecord      = std::move( record );
+        return finish( AssetCookStatus::CacheHit );
+    }
+
+    if ( !Import( source, record.Outputs ) )
+    {
+        return finish( AssetCookStatus::Failed );
+    }
+    if ( m_cache )
+    {
+        m_cache->Put( record.Key, PackOutputs( record.Outputs ) );
+    }
+    result.Outputs = record.Outputs;
+    outRecord      = std::move( record );
+    return finish( AssetCookStatus::Cooked );
+}
+
+bool AssetCooker::Import( const Source &source, std::vector<std::string> &outOutputs ) const
+{
+    const std::filesystem::path sourcePath      = m_sourceDirectory / source.Path;
+    const std::filesystem::path targetDirectory = ( m_outputDirectory / source.Path ).parent_path( );
+    std::error_code             error;
+    std::filesystem::create_directories( targetDirectory, error );
+
+    ImporterResult result;
+    if ( source.Processor == ProcessorType::Model )
+    {
+        AssimpImportDesc desc{ };
+        desc.SourceFilePath  = sourcePath.string( ).c_str( );
+        desc.TargetDirectory = targetDirectory.string( ).c_str( );
+        const AssimpImporter importer;
+        result = importer.Import( desc );
+    }
+    else
+    {
+        TextureImportDesc desc{ };
+        desc.SourceFilePath  = sourcePath.string( ).c_str( );
+        desc.TargetDirectory = targetDirectory.string( ).c_str( );
+        const TextureImporter importer;
+        result = importer.Import( desc );
+    }
+    if ( result.ResultCode != ImporterResultCode::Success )
+    {
+        spdlog::error( "AssetCooker: Failed to cook {}: {}", source.Path, result.ErrorMessage.Get( ) ? result.ErrorMessage.Get( ) : "unknown error" );
+        return false;
+    }
+
+    outOutputs.clear( );
+    for ( size_t i = 0; i < result.CreatedAssets.NumElements; ++i )
+    {
+        std::filesystem::path output = result.CreatedAssets.Elements[ i ].Get( );
+        if ( output.is_relative( ) )
+        {
+            output = targetDirectory / output;
+        }
+        if ( output.extension( ) == ".dzmesh" && !MeshAssetProcessor::Process( output, m_meshProcessing ) )
+        {
+            spdlog::error( "AssetCooker: Failed to process {}", output.string( ) );
+            return false;
+        }
+        outOutputs.push_back( std::filesystem::relative( output, m_outputDirectory, error ).generic_string( ) );
+    }
+    std::ranges::sort( outOutputs );
+    return true;
+}
+
+bool AssetCooker::OutputsExist( const Record &record ) const
+{
+    std::error_code error;
+    return std::ranges::all_of( record.Outputs, [ & ]( const std::string &output ) { return std::filesystem::exists( m_outputDirectory / output, error ); } );
+}
+
+bool AssetCooker::StateOf( const std::string &path, FileState &outState ) const
+{
+    std::error_code             error;
+    const std::filesystem::path file = m_sourceDirectory / path;
+    outState.NumBytes                = std::filesystem::file_size( file, error );
+    if ( !error )
+    {
+        outState.LastWrite = std::filesystem::last_write_time( file, error ).time_since_epoch( ).count( );
+    }
+    if ( error )
+    {
+        spdlog::error( "AssetCooker: Failed to stat {}: {}", file.string( ), error.message( ) );
+        return false;
+    }
+    return true;
+}
+
+bool AssetCooker::HashOf( const std::string &path, FileState &outState ) const
+{
+    std::ifstream file( m_sourceDirectory / path, std::ios::binary );
+    if ( !file )
+    {
+        spdlog::error( "AssetCooker: Failed to read {}", path );
+        return false;
+    }
+    ContentHasher     hasher;
+    std::vector<Byte> buffer( HashBufferSize );
+    while ( file )
+    {
+        file.read( reinterpret_cast<char *>( buffer.data( ) ), static_cast<std::streamsize>( buffer.size( ) ) );
+        hasher.Update( buffer.data( ), static_cast<size_t>( file.gcount( ) ) );
+    }
+    outState.Hash = hasher.Finish( );
+    return true;
+}
+
+// uint32_t NumOutputs, then per output uint32_t NumPathBytes | path | uint64_t NumBytes | bytes
+std::vector<Byte> AssetCooker::PackOutputs( const std::vector<std::string> &outputs ) const
+{
+    std::vector<Byte> data;
+    Append( data, static_cast<uint32_t>( outputs.size( ) ) );
+    for ( const std::string &output : outputs )
+    {
+        std::ifstream file( m_outputDirectory / output, std::ios::binary | std::ios::ate );
+        if ( !file )
+        {
+            return { };
+        }
+        const auto numBytes = static_cast<uint64_t>( file.tellg( ) );
+        file.seekg( 0 );
+        Append( data, static_cast<uint32_t>( output.size( ) ) );
+        data.insert( data.end( ), output.begin( ), output.end( ) );
+        Append( data, numBytes );
+        const size_t offset = data.size( );
+        data.resize( offset + numBytes );
+        file.read( reinterpret_cast<char *>( data.data( ) + offset ), static_cast<std::streamsize>( numBytes ) );
+    }
+    return data;
+}
+
+bool AssetCooker::UnpackOutputs( std::span<const Byte> data, std::vector<std::string> &outOutputs ) const
+{
+    uint32_t numOutputs = 0;
+    if ( !Consume( data, numOutputs ) )
+    {
+        return false;
+    }
+    outOutputs.clear( );
+    for ( uint32_t i = 0; i < numOutputs; ++i )
+    {
+        uint32_t numPathBytes = 0;
+        uint64_t numBytes     = 0;
+        if ( !Consume( data, numPathBytes ) || data.size( ) < numPathBytes )
+        {
+            return false;
+        }
+        std::string output( reinterpret_cast<const char *>( data.data( ) ), numPathBytes );
+        data = data.subspan( numPathBytes );
+        if ( !Consume( data, numBytes ) || data.size( ) < numBytes )
+        {
+            return false;
+        }
+
+        const std::filesystem::path path = m_outputDirectory / output;
+        std::error_code             error;
+        std::filesystem::create_directories( path.parent_path( ), error );
+        std::ofstream file( path, std::ios::binary | std::ios::trunc );
+        file.write( reinterpret_cast<const char *>( data.data( ) ), static_cast<std::streamsize>( numBytes ) );
+        if ( !file )
+        {
+            spdlog::error( "AssetCooker: Failed to write {}", path.string( ) );
+            return false;
+        }
+        data = data.subspan( numBytes );
+        outOutputs.push_back( std::move( output ) );
+    }
+    return true;
+}
+
+void AssetCooker::RemoveStaleOutputs( const std::map<std::string, Record> &previousRecords ) const
+{
+    std::set<std::string> outputs;
+    for ( const Record &record : m_records | std::views::values )
+    {
+        outputs.insert( record.Outputs.begin( ), record.Outputs.end( ) );
+    }
+    for ( const Record &record : previousRecords | std::views::values )
+    {
+        for ( const std::string &output : record.Outputs )
+        {
+            if ( !outputs.contains( output ) )
+            {
+                std::error_code error;
+                std::filesystem::remove( m_outputDirectory / output, error );
+            }
+        }
+    }
+}
+
+bool AssetCooker::UpdateRegistry( ) const
+{
+    const std::filesystem::path registryPath = m_outputDirectory / AssetRegistryFile;
+    AssetRegistry               registry;
+    std::error_code             error;
+    if ( std::filesystem::exists( registryPath, error ) && !registry.LoadFromFile( registryPath ) )
+    {
+        spdlog::warn( "AssetCooker: Rebuilding {}, the ids of the cooked assets change", registryPath.string( ) );
+    }
+
+    // Known uris keep their ids, new ones are numbered after the largest id of their type
+    struct Output
+    {
+        AssetRegistryType Type;
+        std::string       Uri;
+        uint32_t          Id;
+    };
+    std::vector<Output> outputs;
+    uint32_t            nextIds[ static_cast<uint32_t>( AssetRegistryType::Count ) ] = { };
+    for ( const Record &record : m_records | std::views::values )
+    {
+        for ( const std::string &path : record.Outputs )
+        {
+            if ( const auto type = RegistryTypeOf( path ) )
+            {
+                Output output{ *type, "assets://" + path, UINT32_MAX };
+                if ( registry.Find( output.Type, m_batchId, output.Uri, output.Id ) )
+                {
+                    uint32_t &nextId = nextIds[ static_cast<uint32_t>( output.Type ) ];
+                    nextId           = std::max( nextId, output.Id + 1 );
+                }
+                outputs.push_back( std::move( output ) );
+            }
+        }
+    }
+
+    registry.ClearBatch( m_batchId );
+    for ( Output &output : outputs )
+    {
+        if ( output.Id == UINT32_MAX )
+        {
+            output.Id = nextIds[ static_cast<uint32_t>( output.Type ) ]++;
+        }
+        registry.Register( output.Type, m_batchId, output.Id, output.Uri );
+    }
+    return registry.SaveToFile( registryPath );
+}
+
+bool AssetCooker::LoadDatabase( )
+{
+    m_records.clear( );
+    const std::filesystem::path databasePath = m_outputDirectory / DatabaseFile;
+    std::ifstream               file( databasePath );
+    if ( !file )
+    {
+        return false; // First cook
+    }
+    const json database = json::parse( file, nullptr, false );
+    if ( database.is_discarded( ) || database.value( "version", 0u ) != DatabaseVersion )
+    {
+        spdlog::warn( "AssetCooker: Ignoring invalid cook database {}, every source is cooked", databasePath.string( ) );
+        return false;
+    }
+
+    const auto readState = []( const json &stateJson, FileState &outState )
+    {
+        outState.NumBytes  = stateJson.value( "bytes", uint64_t{ 0 } );
+        outState.LastWrite = stateJson.value( "time", int64_t{ 0 } );
+        ContentHash::FromString( stateJson.value( "hash", "" ), outState.Hash );
+    };
+    const bool sameVersion = database.value( "cookVersion", 0u ) == CookVersion;
+    const auto sources     = database.find( "sources" );
+    if ( sources == database.end( ) || !sources->is_object( ) )
+    {
+        return true;
+    }
+    for ( const auto &[ path, sourceJson ] : sources->items( ) )
+    {
+        Record &record = m_records[ path ];
+        readState( sourceJson.value( "state", json::object( ) ), record.State );
+        ContentHash::FromString( sourceJson.value( "key", "" ), record.Key );
+        const json dependencies = sourceJson.value( "dependencies", json::object( ) );
+        for ( const auto &[ dependency, stateJson ] : dependencies.items( ) )
+        {
+            readState( stateJson, record.Dependencies[ dependency ] );
+        }
+        record.Outputs = sourceJson.value( "outputs", std::vector<std::string>{ } );
+        if ( !sameVersion ) // Keeps the outputs to clean them up, the write times no longer match so every source is hashed and cooked again
+        {
+            record.State.LastWrite = -1;
+        }
+    }
+    return true;
+}
+
+bool AssetCooker::SaveDatabase( ) const
+{
+    const auto writeState = []( const FileState &state ) { return json{ { "bytes", state.NumBytes }, { "time", state.LastWrite }, { "hash", state.Hash.ToString( ) } }; };
+
+    json sources = json::object( );
+    for ( const auto &[ path, record ] : m_records )
+    {
+        json dependencies = json::object( );
+        for ( const auto &[ dependency, state ] : record.Dependencies )
+        {
+            dependencies[ dependency ] = writeState( state );
+        }
+        sources[ path ] = json{ { "state", writeState( record.State ) },
+                                { "key", record.Key.ToString( ) },
+                                { "dependencies", dependencies },
+                                { "outputs", record.Outputs } };
+    }
+    const json database = { { "version", DatabaseVersion }, { "cookVersion", CookVersion }, { "sources", sources } };
+
+    const std::filesystem::path databasePath = m_outputDirectory / DatabaseFile;
+    std::ofstream               file( databasePath );
+    file << database.dump( 2 );
+    if ( !file )
+    {
+        spdlog::error( "AssetCooker: Failed to write {}", databasePath.string( ) );
+        return false;
+    }
+    return true;
+}
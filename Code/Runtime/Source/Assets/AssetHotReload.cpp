@@ -0,0 +1,130 @@
+/*
+Den Of Iz - Game/Game Engine
+Copyright (c) 2020-2024 Muhammed Murat Cengiz
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "DZEngine/Assets/AssetHotReload.h"
+#include <spdlog/spdlog.h>
+
+using namespace DZEngine;
+
+namespace
+{
+    AssetLoadType ToLoadType( const AssetRegistryType type )
+    {
+        switch ( type )
+        {
+        case AssetRegistryType::Material:
+            return AssetLoadType::Material;
+        case AssetRegistryType::Texture:
+            return AssetLoadType::Texture;
+        case AssetRegistryType::Animation:
+            return AssetLoadType::Animation;
+        case AssetRegistryType::Skeleton:
+            return AssetLoadType::Skeleton;
+        default:
+            return AssetLoadType::Mesh;
+        }
+    }
+} // namespace
+
+AssetHotReload::AssetHotReload( const AssetHotReloadDesc &desc ) :
+    m_assetBundle( desc.AssetBundle ), m_assetBatcher( desc.AssetBatcher ), m_assetRegistry( desc.AssetRegistry ), m_assetLoader( desc.AssetLoader )
+{
+    if ( !m_assetBundle || !m_assetBatcher || !m_assetRegistry || !m_assetLoader )
+    {
+        spdlog::error( "AssetHotReload: AssetBundle, AssetBatcher, AssetRegistry and AssetLoader are required" );
+    }
+}
+
+uint32_t AssetHotReload::OnFilesChanged( const std::span<const FileChange> changes )
+{
+    if ( !m_assetBundle || !m_assetBatcher || !m_assetRegistry || !m_assetLoader )
+    {
+        return 0; // Logged by the constructor
+    }
+
+    uint32_t numRequested = 0;
+    for ( const FileChange &change : changes )
+    {
+        if ( change.Type == FileChangeType::Removed )
+        {
+            continue;
+        }
+        const std::string uri = ToUri( change.Path );
+        if ( uri.empty( ) || m_assetBundle->IsPacked( uri ) )
+        {
+            continue;
+        }
+
+        for ( size_t batchId = 0; batchId < m_assetBatcher->NumBatches( ); ++batchId )
+        {
+            for ( uint32_t type = 0; type < static_cast<uint32_t>( AssetRegistryType::Count ); ++type )
+            {
+                uint32_t handleId;
+                if ( !m_assetRegistry->Find( static_cast<AssetRegistryType>( type ), batchId, uri, handleId ) )
+                {
+                    continue;
+                }
+                const AssetLoadHandle handle = m_assetLoader->Reload( ToLoadType( static_cast<AssetRegistryType>( type ) ), batchId, uri, handleId );
+                if ( handle.IsValid( ) )
+                {
+                    m_pending.push_back( PendingReload{ handle, uri } );
+                    ++numRequested;
+                }
+            }
+        }
+    }
+    return numRequested;
+}
+
+void AssetHotReload::Update( )
+{
+    std::erase_if( m_pending,
+                   [ & ]( const PendingReload &reload )
+                   {
+                       const AssetLoadState state = m_assetLoader->GetState( reload.Handle );
+                       if ( state == AssetLoadState::Ready )
+                       {
+                           spdlog::info( "AssetHotReload: Reloaded {}", reload.Uri );
+                       }
+                       if ( state == AssetLoadState::Failed )
+                       {
+                           spdlog::warn( "AssetHotReload: Failed to reload {}, the previous contents stay", reload.Uri );
+                       }
+                       if ( state == AssetLoadState::Pending )
+                       {
+                           return false;
+                       }
+                       m_assetLoader->Release( reload.Handle );
+                       return true;
+                   } );
+}
+
+size_t AssetHotReload::NumPending( ) const
+{
+    return m_pending.size( );
+}
+
+std::string AssetHotReload::ToUri( const std::filesystem::path &path ) const
+{
+    const std::filesystem::path relative = path.lexically_normal( ).lexically_relative( m_assetBundle->GetAssetsDirectory( ).lexically_normal( ) );
+    if ( relative.empty( ) || *relative.begin( ) == ".." )
+    {
+        return "";
+    }
+    return "assets://" + relative.generic_string( );
+}
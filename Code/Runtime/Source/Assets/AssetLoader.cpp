@@ -0,0 +1,1056 @@
+/*
+Den Of Iz - Game/Game Engine
+Copyright (c) 2020-2024 Muhammed Murat Cengiz
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#include "DZEngine/Assets/AssetLoader.h"
+
+#include <DenOfIzGraphics/Assets/Serde/Material/MaterialAssetReader.h>
+#include <algorithm>
+#include <ranges>
+#include <spdlog/spdlog.h>
+#include <taskflow/taskflow.hpp>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+using namespace DZEngine;
+
+namespace
+{
+    size_t PeakResidentBytes( )
+    {
+#ifdef _WIN32
+        PROCESS_MEMORY_COUNTERS counters{ };
+        return GetProcessMemoryInfo( GetCurrentProcess( ), &counters, sizeof( counters ) ) ? counters.PeakWorkingSetSize : 0;
+#else
+        rusage usage{ };
+        if ( getrusage( RUSAGE_SELF, &usage ) != 0 )
+        {
+            return 0;
+        }
+#ifdef __APPLE__
+        return static_cast<size_t>( usage.ru_maxrss );
+#else
+        return static_cast<size_t>( usage.ru_maxrss ) * 1024; // Kilobytes
+#endif
+#endif
+    }
+
+    // Dependency::Slot of the textures of a material, metallic and roughness share a map
+    constexpr TextureHandle MaterialDataRequest::*MaterialTextureSlots[] = {
+        &MaterialDataRequest::Albedo,   &MaterialDataRequest::Normal,   &MaterialDataRequest::Metallic,
+        &MaterialDataRequest::Roughness, &MaterialDataRequest::Emissive, &MaterialDataRequest::Occlusion,
+    };
+
+    // References are stored as paths relative to the assets directory
+    std::string ToAssetUri( const std::string &reference )
+    {
+        if ( reference.empty( ) || reference.find( "://" ) != std::string::npos )
+        {
+            return reference;
+        }
+        return "assets://" + reference;
+    }
+
+    std::string RequestKey( const AssetLoadType type, const size_t batchId, const std::string &uri )
+    {
+        return std::to_string( static_cast<int>( type ) ) + ":" + std::to_string( batchId ) + ":" + uri;
+    }
+
+    AssetRegistryType ToRegistryType( const AssetLoadType type )
+    {
+        switch ( type )
+        {
+        case AssetLoadType::Texture:
+            return AssetRegistryType::Texture;
+        case AssetLoadType::Animation:
+            return AssetRegistryType::Animation;
+        case AssetLoadType::Skeleton:
+            return AssetRegistryType::Skeleton;
+        case AssetLoadType::Material:
+            return AssetRegistryType::Material;
+        default:
+            return AssetRegistryType::Mesh;
+        }
+    }
+} // namespace
+
+AssetLoader::AssetLoader( const AssetLoaderDesc &desc ) :
+    m_assetBatcher( desc.AssetBatcher ), m_assetBundle( desc.AssetBundle ), m_assetRegistry( desc.AssetRegistry ), m_executor( desc.Executor ),
+    m_maxRequestsPerUpdate( std::max( 1u, desc.MaxRequestsPerUpdate ) ), m_defragmentBytesPerUpdate( desc.DefragmentBytesPerUpdate ), m_scheduler( desc.Scheduler )
+{
+    if ( !m_assetBatcher || !m_assetBundle )
+    {
+        spdlog::error( "AssetLoader: AssetBatcher and AssetBundle are required" );
+    }
+}
+
+AssetLoader::~AssetLoader( )
+{
+    for ( size_t numDecoding = m_numDecoding.load( ); numDecoding > 0; numDecoding = m_numDecoding.load( ) )
+    {
+        m_numDecoding.wait( numDecoding );
+    }
+}
+
+AssetLoadHandle AssetLoader::LoadMesh( const size_t batchId, const std::string &uri, const std::vector<std::string> &submeshAliases, const AssetSchedule &schedule )
+{
+    auto request            = std::make_unique<Request>( );
+    request->Type           = AssetLoadType::Mesh;
+    request->BatchId        = batchId;
+    request->Uri            = uri;
+    request->SubmeshAliases = submeshAliases;
+    return Enqueue( std::move( request ), schedule );
+}
+
+AssetLoadHandle AssetLoader::LoadTexture( const size_t batchId, const std::string &alias, const std::string &uri, const AssetSchedule &schedule )
+{
+    auto request     = std::make_unique<Request>( );
+    request->Type    = AssetLoadType::Texture;
+    request->BatchId = batchId;
+    request->Uri     = uri;
+    request->Alias   = alias;
+    return Enqueue( std::move( request ), schedule );
+}
+
+AssetLoadHandle AssetLoader::LoadAnimation( const size_t batchId, const std::string &uri, const std::string &alias, const AssetSchedule &schedule )
+{
+    auto request     = std::make_unique<Request>( );
+    request->Type    = AssetLoadType::Animation;
+    request->BatchId = batchId;
+    request->Uri     = uri;
+    request->Alias   = alias;
+    return Enqueue( std::move( request ), schedule );
+}
+
+AssetLoadHandle AssetLoader::LoadSkeleton( const size_t batchId, const std::string &uri, const std::string &alias, const AssetSchedule &schedule )
+{
+    auto request     = std::make_unique<Request>( );
+    request->Type    = AssetLoadType::Skeleton;
+    request->BatchId = batchId;
+    request->Uri     = uri;
+    request->Alias   = alias;
+    return Enqueue( std::move( request ), schedule );
+}
+
+AssetLoadHandle AssetLoader::LoadMaterial( const size_t batchId, const std::string &uri, const std::string &alias, const AssetSchedule &schedule )
+{
+    auto request                 = std::make_unique<Request>( );
+    request->Type                = AssetLoadType::Material;
+    request->BatchId             = batchId;
+    request->Uri                 = uri;
+    request->Alias               = alias;
+    request->ResolveDependencies = true;
+    return Enqueue( std::move( request ), schedule );
+}
+
+AssetLoadHandle AssetLoader::LoadMeshWithDependencies( const size_t batchId, const std::string &uri, const std::vector<std::string> &aliases, const AssetSchedule &schedule )
+{
+    auto request                 = std::make_unique<Request>( );
+    request->Type                = AssetLoadType::Mesh;
+    request->BatchId             = batchId;
+    request->Uri                 = uri;
+    request->SubmeshAliases      = aliases;
+    request->ResolveDependencies = true;
+    return Enqueue( std::move( request ), schedule );
+}
+
+AssetLoadHandle AssetLoader::Reload( const AssetLoadType type, const size_t batchId, const std::string &uri, const uint32_t targetId, const AssetSchedule &schedule )
+{
+    auto request                 = std::make_unique<Request>( );
+    request->Type                = type;
+    request->BatchId             = batchId;
+    request->Uri                 = uri;
+    request->Alias               = uri;
+    request->ResolveDependencies = type == AssetLoadType::Mesh || type == AssetLoadType::Material;
+    request->ReloadTarget        = targetId;
+    return Enqueue( std::move( request ), schedule );
+}
+
+bool AssetLoader::Cancel( const AssetLoadHandle handle )
+{
+    std::lock_guard lock( m_lock );
+    Request        *request = FindRequest( handle.Id );
+    if ( !request )
+    {
+        return false;
+    }
+    if ( request->State == AssetLoadState::Pending && request->NumReferences > 1 )
+    {
+        --request->NumReferences;
+        return true;
+    }
+    if ( !m_scheduler.Cancel( handle.Id ) )
+    {
+        return false;
+    }
+    CancelLocked( handle.Id );
+    return true;
+}
+
+void AssetLoader::Release( const AssetLoadHandle handle )
+{
+    std::lock_guard lock( m_lock );
+    Request        *request = FindRequest( handle.Id );
+    if ( !request || request->NumHandles == 0 )
+    {
+        return;
+    }
+    --request->NumHandles;
+
+    if ( request->State == AssetLoadState::Pending )
+    {
+        // A dispatched request still completes, into the cache without the reference
+        if ( request->NumReferences == 1 && m_scheduler.Cancel( handle.Id ) )
+        {
+            CancelLocked( handle.Id );
+        }
+        else if ( request->NumReferences > 0 )
+        {
+            --request->NumReferences;
+        }
+    }
+    else if ( request->State == AssetLoadState::Ready && request->ReloadTarget == UINT32_MAX )
+    {
+        m_assetBatcher->Cache( )->Release( ToRegistryType( request->Type ), request->BatchId, request->AssetId );
+    }
+    RecycleLocked( handle.Id );
+}
+
+bool AssetLoader::Reschedule( const AssetLoadHandle handle, const AssetSchedule &schedule )
+{
+    std::lock_guard lock( m_lock );
+    return FindRequest( handle.Id ) && m_scheduler.Reschedule( handle.Id, schedule );
+}
+
+void AssetLoader::Update( )
+{
+    const auto      now = std::chrono::steady_clock::now( );
+    std::lock_guard lock( m_lock );
+    if ( m_stats.NumPending > 0 && m_lastUpdate != std::chrono::steady_clock::time_point{ } )
+    {
+        m_stats.BusySeconds += std::chrono::duration<double>( now - m_lastUpdate ).count( );
+    }
+    m_lastUpdate = now;
+
+    for ( auto it = m_batchUpdates.begin( ); it != m_batchUpdates.end( ); )
+    {
+        const size_t batchId = it->first;
+        BatchUpdate &update  = *it->second;
+        if ( !update.Submitted )
+        {
+            if ( update.NumDecoding.load( std::memory_order_acquire ) == 0 )
+            {
+                for ( const uint32_t requestId : update.Requests )
+                {
+                    Finish( *FindRequest( requestId ) );
+                    ResolveDependencies( requestId );
+                }
+                m_assetBatcher->SubmitBatchUpdate( batchId );
+                update.Submitted = true;
+            }
+            ++it;
+            continue;
+        }
+
+        if ( !m_assetBatcher->PollBatchUpdate( batchId ) )
+        {
+            ++it;
+            continue;
+        }
+        if ( update.Requests.empty( ) )
+        {
+            it = m_batchUpdates.erase( it ); // Defragment
+            continue;
+        }
+        for ( const uint32_t requestId : update.Requests )
+        {
+            m_scheduler.Complete( requestId );
+            Publish( requestId );
+            RecycleLocked( requestId );
+        }
+
+        const AssetLoaderStats stats = ComputeStats( );
+        spdlog::info( "AssetLoader: Published {} requests of batch {}, {} pending, {:.1f} assets/s, {:.2f} MB/s, {:.0f} copied bytes/asset, {:.1f} MB peak resident",
+                      update.Requests.size( ), batchId, stats.NumPending, stats.AssetsPerSecond, stats.MegabytesPerSecond, stats.CopiedBytesPerAsset,
+                      static_cast<double>( stats.PeakResidentBytes ) / ( 1024.0 * 1024.0 ) );
+        it = m_batchUpdates.erase( it );
+    }
+
+    Dispatch( );
+    Defragment( );
+}
+
+void AssetLoader::WaitIdle( )
+{
+    while ( true )
+    {
+        Update( );
+        {
+            std::lock_guard lock( m_lock );
+            if ( m_stats.NumPending == 0 )
+            {
+                return;
+            }
+        }
+        std::this_thread::yield( );
+    }
+}
+
+AssetLoadState AssetLoader::GetState( const AssetLoadHandle handle ) const
+{
+    std::lock_guard      lock( m_lock );
+    const Request *const request = FindRequest( handle.Id );
+    return request ? request->State : AssetLoadState::Failed;
+}
+
+MeshHandle AssetLoader::GetMesh( const AssetLoadHandle handle, const MeshHandle fallback ) const
+{
+    const uint32_t assetId = ReadyAssetId( handle, AssetLoadType::Mesh );
+    return assetId == UINT32_MAX ? fallback : MeshHandle( assetId );
+}
+
+TextureHandle AssetLoader::GetTexture( const AssetLoadHandle handle, const TextureHandle fallback ) const
+{
+    const uint32_t assetId = ReadyAssetId( handle, AssetLoadType::Texture );
+    return assetId == UINT32_MAX ? fallback : TextureHandle( assetId );
+}
+
+AnimationClipHandle AssetLoader::GetAnimation( const AssetLoadHandle handle, const AnimationClipHandle fallback ) const
+{
+    const uint32_t assetId = ReadyAssetId( handle, AssetLoadType::Animation );
+    return assetId == UINT32_MAX ? fallback : AnimationClipHandle( assetId );
+}
+
+SkeletonHandle AssetLoader::GetSkeleton( const AssetLoadHandle handle, const SkeletonHandle fallback ) const
+{
+    const uint32_t assetId = ReadyAssetId( handle, AssetLoadType::Skeleton );
+    return assetId == UINT32_MAX ? fallback : SkeletonHandle( assetId );
+}
+
+MaterialHandle AssetLoader::GetMaterial( const AssetLoadHandle handle, const MaterialHandle fallback ) const
+{
+    const uint32_t assetId = ReadyAssetId( handle, AssetLoadType::Material );
+    return assetId == UINT32_MAX ? fallback : MaterialHandle( assetId );
+}
+
+MeshDependencies AssetLoader::GetMeshDependencies( const AssetLoadHandle handle ) const
+{
+    std::lock_guard      lock( m_lock );
+    MeshDependencies     dependencies{ };
+    const Request *const request = FindRequest( handle.Id );
+    if ( !request || request->Type != AssetLoadType::Mesh || request->State != AssetLoadState::Ready )
+    {
+        return dependencies;
+    }
+
+    dependencies.SubMeshMaterials.resize( request->NumSubMeshes );
+    for ( const Request::Dependency &dependency : request->Dependencies )
+    {
+        switch ( dependency.Type )
+        {
+        case AssetLoadType::Material:
+            dependencies.SubMeshMaterials[ dependency.Slot ] = MaterialHandle( dependency.AssetId );
+            break;
+        case AssetLoadType::Skeleton:
+            dependencies.Skeleton = SkeletonHandle( dependency.AssetId );
+            break;
+        case AssetLoadType::Animation:
+            dependencies.Animations.resize( std::max<size_t>( dependencies.Animations.size( ), dependency.Slot + 1 ) );
+            dependencies.Animations[ dependency.Slot ] = AnimationClipHandle( dependency.AssetId );
+            break;
+        default:
+            break;
+        }
+    }
+    return dependencies;
+}
+
+AssetLoaderStats AssetLoader::GetStats( ) const
+{
+    std::lock_guard lock( m_lock );
+    return ComputeStats( );
+}
+
+AssetLoadHandle AssetLoader::Enqueue( std::unique_ptr<Request> request, const AssetSchedule &schedule )
+{
+    if ( request->BatchId >= m_assetBatcher->NumBatches( ) )
+    {
+        spdlog::error( "AssetLoader: Invalid batch id: {}, call AddBatch first", request->BatchId );
+        return AssetLoadHandle{ };
+    }
+    // The budgets of the scheduler are in file bytes, a pack lookup or a stat of the loose file
+    request->NumBytes   = m_assetBundle->GetAssetNumBytes( request->Uri );
+    request->NumHandles = 1;
+
+    std::lock_guard lock( m_lock );
+    if ( request->ReloadTarget != UINT32_MAX )
+    {
+        return AssetLoadHandle( EnqueueLocked( std::move( request ), schedule ) );
+    }
+    if ( const uint32_t sharedId = ShareLocked( *request ); sharedId != UINT32_MAX )
+    {
+        return AssetLoadHandle( sharedId );
+    }
+
+    uint32_t cachedId;
+    if ( !m_assetBatcher->Cache( )->TryAcquire( ToRegistryType( request->Type ), request->BatchId, request->Uri, cachedId ) )
+    {
+        return AssetLoadHandle( EnqueueLocked( std::move( request ), schedule ) );
+    }
+
+    // Nothing to load, a mesh still resolves the dependencies it references and completes with them
+    request->AssetId     = cachedId;
+    request->Decoded     = true;
+    request->Cached      = true;
+    request->NumBytes    = 0;
+    request->RequestTime = std::chrono::steady_clock::now( );
+    request->Schedule    = schedule;
+    if ( request->ResolveDependencies && request->Type == AssetLoadType::Mesh )
+    {
+        CollectDependencies( *request, MeshHandle( cachedId ) );
+    }
+    const AssetRegistryType type    = ToRegistryType( request->Type );
+    const size_t            batchId = request->BatchId;
+    const std::string       key     = RequestKey( request->Type, batchId, request->Uri );
+    const uint32_t          id      = m_requests.Insert( std::move( request ) );
+    if ( id == UINT32_MAX )
+    {
+        m_assetBatcher->Cache( )->Release( type, batchId, cachedId );
+        return AssetLoadHandle( );
+    }
+    m_uriRequests[ key ] = id;
+    ++m_stats.NumRequested;
+    ++m_stats.NumPending;
+    ++m_stats.NumDeduplicated;
+    ResolveDependencies( id );
+    Publish( id );
+    return AssetLoadHandle( id );
+}
+
+uint32_t AssetLoader::ShareLocked( Request &request )
+{
+    const auto existing = m_uriRequests.find( RequestKey( request.Type, request.BatchId, request.Uri ) );
+    if ( existing == m_uriRequests.end( ) )
+    {
+        return UINT32_MAX;
+    }
+    // One that doesn't resolve its dependencies can't stand in for one that does, the aliases of the first request are kept
+    Request &shared = *FindRequest( existing->second );
+    uint32_t cachedId;
+    if ( request.ResolveDependencies && !shared.ResolveDependencies )
+    {
+        return UINT32_MAX;
+    }
+    if ( shared.State == AssetLoadState::Pending )
+    {
+        ++shared.NumReferences;
+    }
+    else if ( shared.State != AssetLoadState::Ready || !m_assetBatcher->Cache( )->TryAcquire( ToRegistryType( shared.Type ), shared.BatchId, shared.Uri, cachedId ) )
+    {
+        return UINT32_MAX;
+    }
+    ++shared.NumHandles;
+    ++m_stats.NumRequested;
+    ++m_stats.NumDeduplicated;
+    return existing->second;
+}
+
+void AssetLoader::CancelLocked( const uint32_t requestId )
+{
+    FindRequest( requestId )->State = AssetLoadState::Cancelled;
+    --m_stats.NumPending;
+    ++m_stats.NumCancelled;
+    NotifyDependents( requestId );
+}
+
+void AssetLoader::RecycleLocked( const uint32_t requestId )
+{
+    // Dependencies are requested without a handle and recycled as soon as they finish, their dependents were notified by then
+    const Request *const request = FindRequest( requestId );
+    if ( !request || request->NumHandles > 0 || request->State == AssetLoadState::Pending )
+    {
+        return;
+    }
+    const auto uriRequest = m_uriRequests.find( RequestKey( request->Type, request->BatchId, request->Uri ) );
+    if ( uriRequest != m_uriRequests.end( ) && uriRequest->second == requestId )
+    {
+        m_uriRequests.erase( uriRequest );
+    }
+    m_requests.Remove( requestId );
+}
+
+AssetLoader::Request *AssetLoader::FindRequest( const uint32_t requestId ) const
+{
+    const std::unique_ptr<Request> *request = m_requests.Find( requestId );
+    return request ? request->get( ) : nullptr;
+}
+
+uint32_t AssetLoader::EnqueueLocked( std::unique_ptr<Request> request, const AssetSchedule &schedule )
+{
+    request->RequestTime  = std::chrono::steady_clock::now( );
+    request->Schedule     = schedule;
+    const Request &queued = *request;
+    const uint32_t id     = m_requests.Insert( std::move( request ) );
+    if ( id == UINT32_MAX )
+    {
+        return UINT32_MAX;
+    }
+    m_scheduler.Push( id, queued.NumBytes, schedule );
+    if ( queued.ReloadTarget == UINT32_MAX )
+    {
+        m_uriRequests[ RequestKey( queued.Type, queued.BatchId, queued.Uri ) ] = id;
+    }
+    ++m_stats.NumRequested;
+    ++m_stats.NumPending;
+    return id;
+}
+
+void AssetLoader::Dispatch( )
+{
+    // A batch only takes new requests when it has no update in flight, so every update is eventually submitted. Batches sharing a geometry
+    // pool wait for each other's updates, a pool growing in one update would replace the buffers the copies of the other one target.
+    // The scheduler only offers requests that fit its budgets, an update is begun for the first one offered for its batch.
+    std::vector<BatchUpdate *> opened;
+    const auto                 canDispatch = [ & ]( const uint32_t requestId )
+    {
+        const size_t batchId = FindRequest( requestId )->BatchId;
+        auto         update  = m_batchUpdates.find( batchId );
+        if ( update == m_batchUpdates.end( ) )
+        {
+            if ( IsPoolUpdating( batchId ) )
+            {
+                return false;
+            }
+            m_assetBatcher->BeginBatchUpdate( batchId );
+            update = m_batchUpdates.emplace( batchId, std::make_unique<BatchUpdate>( ) ).first;
+            opened.push_back( update->second.get( ) );
+        }
+        else if ( std::ranges::find( opened, update->second.get( ) ) == opened.end( ) || update->second->Requests.size( ) >= m_maxRequestsPerUpdate )
+        {
+            return false;
+        }
+        update->second->Requests.push_back( requestId );
+        return true;
+    };
+    m_scheduler.Schedule( canDispatch );
+
+    for ( BatchUpdate *update : opened )
+    {
+        update->NumDecoding = update->Requests.size( );
+        m_numDecoding += update->Requests.size( );
+        for ( const uint32_t requestId : update->Requests )
+        {
+            auto decode = [ this, update, &request = *FindRequest( requestId ) ]
+            {
+                Decode( request );
+                update->NumDecoding.fetch_sub( 1, std::memory_order_release );
+                if ( m_numDecoding.fetch_sub( 1, std::memory_order_release ) == 1 )
+                {
+                    m_numDecoding.notify_all( );
+                }
+            };
+            if ( m_executor )
+            {
+                m_executor->silent_async( decode );
+            }
+            else
+            {
+                decode( );
+            }
+        }
+    }
+}
+
+void AssetLoader::Defragment( )
+{
+    if ( m_defragmentBytesPerUpdate == 0 )
+    {
+        return;
+    }
+    // Submitted right away with no requests, new requests of the batch wait until Update polled it
+    for ( size_t batchId = 0; batchId < m_assetBatcher->NumBatches( ); ++batchId )
+    {
+        if ( !IsPoolUpdating( batchId ) && m_assetBatcher->DefragmentGeometry( batchId, m_defragmentBytesPerUpdate ) )
+        {
+            auto update       = std::make_unique<BatchUpdate>( );
+            update->Submitted = true;
+            m_batchUpdates.emplace( batchId, std::move( update ) );
+        }
+    }
+}
+
+bool AssetLoader::IsPoolUpdating( const size_t batchId ) const
+{
+    const GeometryPool *pool = m_assetBatcher->Mesh( batchId )->GetPool( );
+    return std::ranges::any_of( m_batchUpdates | std::views::keys, [ & ]( const size_t updating ) { return m_assetBatcher->Mesh( updating )->GetPool( ) == pool; } );
+}
+
+void AssetLoader::Decode( Request &request ) const
+{
+    if ( request.Type == AssetLoadType::Texture )
+    {
+        // Packed textures are read from the mapping or decompressed into the reader, loose ones are read here so Update never waits on the disk
+        if ( m_assetBundle->IsPacked( request.Uri ) )
+        {
+            request.TextureReader = m_assetBundle->LoadAsset( request.Uri );
+            request.Decoded       = request.TextureReader != nullptr;
+            return;
+        }
+        request.FileData.resize( request.NumBytes );
+        request.Decoded = request.NumBytes > 0 && m_assetBundle->ReadAsset( request.Uri, request.FileData.data( ), request.FileData.size( ) );
+        return;
+    }
+
+    const auto reader = m_assetBundle->LoadAsset( request.Uri );
+    if ( !reader )
+    {
+        return;
+    }
+
+    switch ( request.Type )
+    {
+    case AssetLoadType::Mesh:
+        {
+            const MeshHandle handle = m_assetBatcher->AddMesh( request.BatchId, *reader, request.SubmeshAliases );
+            request.AssetId         = handle.Id;
+            request.Decoded         = handle.IsValid( );
+            if ( request.Decoded && request.ResolveDependencies )
+            {
+                CollectDependencies( request, handle );
+            }
+            break;
+        }
+    case AssetLoadType::Material:
+        {
+            MaterialAssetReaderDesc readerDesc{ };
+            readerDesc.Reader = reader.get( );
+            MaterialAssetReader materialReader( readerDesc );
+            const MaterialAsset *materialAsset = materialReader.Read( );
+            if ( !materialAsset )
+            {
+                break;
+            }
+
+            MaterialDataRequest material{ };
+            material.BaseColorFactor   = materialAsset->BaseColorFactor;
+            material.MetallicFactor    = materialAsset->MetallicFactor;
+            material.RoughnessFactor   = materialAsset->RoughnessFactor;
+            material.NormalScale       = 1.0f;
+            material.OcclusionStrength = 1.0f;
+            material.EmissiveFactor    = { materialAsset->EmissiveFactor.X, materialAsset->EmissiveFactor.Y, materialAsset->EmissiveFactor.Z, 1.0f };
+            request.Material           = material;
+
+            const AssetUri *textureRefs[] = { &materialAsset->AlbedoMapRef,            &materialAsset->NormalMapRef,   &materialAsset->MetallicRoughnessMapRef,
+                                              &materialAsset->MetallicRoughnessMapRef, &materialAsset->EmissiveMapRef, &materialAsset->OcclusionMapRef };
+            for ( uint32_t slot = 0; slot < std::size( textureRefs ); ++slot )
+            {
+                if ( std::string uri = ToAssetUri( textureRefs[ slot ]->Path.Get( ) ); !uri.empty( ) )
+                {
+                    request.Dependencies.push_back( Request::Dependency{ AssetLoadType::Texture, std::move( uri ), slot } );
+                }
+            }
+            request.Decoded = true;
+            break;
+        }
+    case AssetLoadType::Animation:
+        {
+            AnimationAssetReaderDesc readerDesc{ };
+            readerDesc.Reader = reader.get( );
+            AnimationAssetReader animReader( readerDesc );
+            if ( const AnimationAsset *animAsset = animReader.Read( ) )
+            {
+                request.Animation = AnimationAssetData::LoadFromAnimationAsset( *animAsset );
+                request.Decoded   = true;
+            }
+            break;
+        }
+    case AssetLoadType::Skeleton:
+        {
+            SkeletonAssetReaderDesc readerDesc{ };
+            readerDesc.Reader = reader.get( );
+            SkeletonAssetReader skelReader( readerDesc );
+            if ( const SkeletonAsset *skelAsset = skelReader.Read( ) )
+            {
+                request.Skeleton = SkeletonAssetData::LoadFromSkeletonAsset( *skelAsset );
+                request.Decoded  = true;
+            }
+            break;
+        }
+    default:
+        break;
+    }
+}
+
+void AssetLoader::CollectDependencies( Request &request, const MeshHandle mesh ) const
+{
+    const MeshAssetData *metadata = m_assetBatcher->Mesh( request.BatchId )->GetMeshMetadata( mesh );
+    if ( !metadata )
+    {
+        return;
+    }
+
+    request.NumSubMeshes = static_cast<uint32_t>( metadata->SubMeshes.size( ) );
+    for ( uint32_t i = 0; i < metadata->SubMeshes.size( ); ++i )
+    {
+        if ( std::string uri = ToAssetUri( metadata->SubMeshes[ i ].MaterialRef ); !uri.empty( ) )
+        {
+            request.Dependencies.push_back( Request::Dependency{ AssetLoadType::Material, std::move( uri ), i } );
+        }
+    }
+    if ( std::string uri = ToAssetUri( metadata->SkeletonRef ); !uri.empty( ) )
+    {
+        request.Dependencies.push_back( Request::Dependency{ AssetLoadType::Skeleton, std::move( uri ), 0 } );
+    }
+    for ( uint32_t i = 0; i < metadata->AnimationRefs.size( ); ++i )
+    {
+        if ( std::string uri = ToAssetUri( metadata->AnimationRefs[ i ] ); !uri.empty( ) )
+        {
+            request.Dependencies.push_back( Request::Dependency{ AssetLoadType::Animation, std::move( uri ), i } );
+        }
+    }
+}
+
+void AssetLoader::Finish( Request &request ) const
+{
+    if ( !request.Decoded )
+    {
+        return;
+    }
+
+    switch ( request.Type )
+    {
+    case AssetLoadType::Texture:
+        {
+            if ( !request.TextureReader )
+            {
+                request.TextureReader = CreateMemoryReader( request.FileData.data( ), request.FileData.size( ) );
+            }
+            const TextureHandle handle = m_assetBatcher->LoadTexture( request.BatchId, request.Alias, *request.TextureReader );
+            request.AssetId            = handle.Id;
+            break;
+        }
+    case AssetLoadType::Animation:
+        request.AssetId = m_assetBatcher->AddAnimation( request.BatchId, request.Alias, *request.Animation ).Id;
+        request.Animation.reset( );
+        break;
+    case AssetLoadType::Skeleton:
+        request.AssetId = m_assetBatcher->AddSkeleton( request.BatchId, request.Alias, *request.Skeleton ).Id;
+        request.Skeleton.reset( );
+        break;
+    default:
+        break;
+    }
+}
+
+void AssetLoader::ResolveDependencies( const uint32_t requestId )
+{
+    Request &request = *FindRequest( requestId );
+    if ( !request.Decoded )
+    {
+        return;
+    }
+
+    for ( Request::Dependency &dependency : request.Dependencies )
+    {
+        // Pending requests of the loader first, each dependent holds a reference to what it waits for
+        if ( const auto existing = m_uriRequests.find( RequestKey( dependency.Type, request.BatchId, dependency.Uri ) ); existing != m_uriRequests.end( ) )
+        {
+            if ( Request &loaded = *FindRequest( existing->second ); loaded.State == AssetLoadState::Pending )
+            {
+                dependency.RequestId = existing->second;
+                loaded.Dependents.push_back( requestId );
+                ++loaded.NumReferences;
+                ++request.NumPendingDependencies;
+                continue;
+            }
+        }
+        // Then loaded assets, a failed or cancelled one is requested again. Registered ones were loaded without the cache and aren't counted.
+        if ( m_assetBatcher->Cache( )->TryAcquire( ToRegistryType( dependency.Type ), request.BatchId, dependency.Uri, dependency.AssetId ) )
+        {
+            continue;
+        }
+        if ( const uint32_t assetId = FindRegisteredAsset( dependency.Type, request.BatchId, dependency.Uri ); assetId != UINT32_MAX )
+        {
+            dependency.AssetId = assetId;
+            continue;
+        }
+
+        auto dependencyRequest                 = std::make_unique<Request>( );
+        dependencyRequest->Type                = dependency.Type;
+        dependencyRequest->BatchId             = request.BatchId;
+        dependencyRequest->Uri                 = dependency.Uri;
+        dependencyRequest->Alias               = dependency.Uri;
+        dependencyRequest->ResolveDependencies = dependency.Type == AssetLoadType::Material;
+        dependencyRequest->NumBytes            = m_assetBundle->GetAssetNumBytes( dependency.Uri );
+        dependency.RequestId                   = EnqueueLocked( std::move( dependencyRequest ), request.Schedule );
+        if ( dependency.RequestId == UINT32_MAX )
+        {
+            continue; // Left invalid like a failed dependency
+        }
+        FindRequest( dependency.RequestId )->Dependents.push_back( requestId );
+        ++request.NumPendingDependencies;
+    }
+}
+
+void AssetLoader::Publish( const uint32_t requestId )
+{
+    // Texture data may be read until the copies complete
+    Request &request = *FindRequest( requestId );
+    request.TextureReader.reset( );
+    std::vector<Byte>( ).swap( request.FileData );
+
+    if ( request.Decoded && request.NumPendingDependencies > 0 )
+    {
+        request.AwaitingDependencies = true;
+        return;
+    }
+    Complete( requestId );
+}
+
+void AssetLoader::Complete( const uint32_t requestId )
+{
+    Request &request = *FindRequest( requestId );
+    if ( request.Type == AssetLoadType::Material && request.Material )
+    {
+        // MaterialBatch only keeps the data, it can be added outside of an update once the textures are published
+        MaterialDataRequest material = *request.Material;
+        for ( const Request::Dependency &dependency : request.Dependencies )
+        {
+            material.*MaterialTextureSlots[ dependency.Slot ] = TextureHandle( dependency.AssetId );
+        }
+        request.AssetId = m_assetBatcher->AddMaterial( request.BatchId, request.Alias, material ).Id;
+    }
+    --m_stats.NumPending;
+
+    // A reload only becomes Ready once it replaced its target
+    if ( request.Decoded && request.AssetId != UINT32_MAX && request.ReloadTarget != UINT32_MAX && !ReplaceTarget( request ) )
+    {
+        request.AssetId = UINT32_MAX;
+    }
+    if ( !request.Decoded || request.AssetId == UINT32_MAX )
+    {
+        spdlog::error( "AssetLoader: Failed to load {}", request.Uri );
+        request.State = AssetLoadState::Failed;
+        ++m_stats.NumFailed;
+        for ( const Request::Dependency &dependency : request.Dependencies )
+        {
+            if ( dependency.AssetId != UINT32_MAX )
+            {
+                m_assetBatcher->Cache( )->Release( ToRegistryType( dependency.Type ), request.BatchId, dependency.AssetId );
+            }
+        }
+        NotifyDependents( requestId );
+        return;
+    }
+
+    request.State = AssetLoadState::Ready;
+    if ( request.Cached )
+    {
+        HandOverDependencies( request );
+        NotifyDependents( requestId );
+        return;
+    }
+
+    ++m_stats.NumReady;
+    m_stats.NumBytesLoaded += request.NumBytes;
+    if ( request.Type == AssetLoadType::Texture )
+    {
+        m_stats.NumCopiedBytes += request.NumBytes; // BatchResourceCopy has no buffer to texture copy to stage texels without it
+    }
+    m_totalLatencyMs += std::chrono::duration<double, std::milli>( m_lastUpdate - request.RequestTime ).count( );
+
+    if ( request.ReloadTarget != UINT32_MAX )
+    {
+        return;
+    }
+
+    // With the references of the loads and dependents sharing the request
+    m_assetBatcher->Cache( )->Add( ToRegistryType( request.Type ), request.BatchId, request.Uri, request.AssetId, request.NumReferences, request.NumBytes );
+    HandOverDependencies( request );
+    if ( m_assetRegistry )
+    {
+        RegisterAsset( request );
+    }
+    NotifyDependents( requestId );
+}
+
+bool AssetLoader::ReplaceTarget( Request &request ) const
+{
+    const AssetCacheKey target{ ToRegistryType( request.Type ), request.BatchId, request.ReloadTarget };
+    if ( !m_assetBatcher->ReplaceAsset( target, request.AssetId ) )
+    {
+        // The batch retired the replacement either way, the target keeps its previous contents
+        spdlog::error( "AssetLoader: Failed to replace asset {} of batch {} with the reload of {}", target.Id, target.BatchId, request.Uri );
+        return false;
+    }
+    request.AssetId = request.ReloadTarget;
+
+    // The target holds the references to the new dependencies, registered assets aren't cached and keep none
+    std::vector<AssetCacheKey> dependencies;
+    for ( const Request::Dependency &dependency : request.Dependencies )
+    {
+        if ( dependency.AssetId != UINT32_MAX )
+        {
+            dependencies.push_back( AssetCacheKey{ ToRegistryType( dependency.Type ), request.BatchId, dependency.AssetId } );
+        }
+    }
+    if ( !m_assetBatcher->Cache( )->Reload( target.Type, target.BatchId, target.Id, request.NumBytes, dependencies ) )
+    {
+        for ( const AssetCacheKey &dependency : dependencies )
+        {
+            m_assetBatcher->Cache( )->Release( dependency.Type, dependency.BatchId, dependency.Id );
+        }
+    }
+    return true;
+}
+
+void AssetLoader::RegisterAsset( const Request &request ) const
+{
+    switch ( request.Type )
+    {
+    case AssetLoadType::Mesh:
+        m_assetRegistry->RegisterMeshAsset( request.BatchId, MeshHandle( request.AssetId ), request.Uri );
+        break;
+    case AssetLoadType::Texture:
+        m_assetRegistry->RegisterTextureAsset( request.BatchId, TextureHandle( request.AssetId ), request.Uri );
+        break;
+    case AssetLoadType::Material:
+        m_assetRegistry->RegisterMaterialAsset( request.BatchId, MaterialHandle( request.AssetId ), request.Uri );
+        break;
+    case AssetLoadType::Animation:
+        m_assetRegistry->RegisterAnimationAsset( request.BatchId, AnimationClipHandle( request.AssetId ), request.Uri );
+        break;
+    case AssetLoadType::Skeleton:
+        m_assetRegistry->RegisterSkeletonAsset( request.BatchId, SkeletonHandle( request.AssetId ), request.Uri );
+        break;
+    default:
+        break;
+    }
+}
+
+void AssetLoader::NotifyDependents( const uint32_t requestId )
+{
+    const Request &request = *FindRequest( requestId );
+    const uint32_t assetId = request.State == AssetLoadState::Ready ? request.AssetId : UINT32_MAX;
+    for ( const uint32_t dependentId : request.Dependents )
+    {
+        Request &dependent = *FindRequest( dependentId );
+        for ( Request::Dependency &dependency : dependent.Dependencies )
+        {
+            if ( dependency.RequestId == requestId )
+            {
+                dependency.AssetId = assetId;
+            }
+        }
+        // A failed dependency is logged by its own request, the dependent still completes with it left invalid
+        if ( --dependent.NumPendingDependencies == 0 && dependent.AwaitingDependencies )
+        {
+            Complete( dependentId );
+            RecycleLocked( dependentId );
+        }
+    }
+}
+
+void AssetLoader::HandOverDependencies( const Request &request ) const
+{
+    std::vector<AssetCacheKey> dependencies;
+    for ( const Request::Dependency &dependency : request.Dependencies )
+    {
+        if ( dependency.AssetId != UINT32_MAX )
+        {
+            dependencies.push_back( AssetCacheKey{ ToRegistryType( dependency.Type ), request.BatchId, dependency.AssetId } );
+        }
+    }
+    // A cached asset that already holds its dependencies, e.g. the same mesh loaded with them before
+    if ( !dependencies.empty( ) && !m_assetBatcher->Cache( )->SetDependencies( ToRegistryType( request.Type ), request.BatchId, request.AssetId, dependencies ) )
+    {
+        for ( const AssetCacheKey &dependency : dependencies )
+        {
+            m_assetBatcher->Cache( )->Release( dependency.Type, dependency.BatchId, dependency.Id );
+        }
+    }
+}
+
+uint32_t AssetLoader::FindRegisteredAsset( const AssetLoadType type, const size_t batchId, const std::string &uri ) const
+{
+    if ( !m_assetRegistry )
+    {
+        return UINT32_MAX;
+    }
+    switch ( type )
+    {
+    case AssetLoadType::Texture:
+        {
+            TextureHandle handle;
+            return m_assetRegistry->FindTextureAsset( batchId, uri, handle ) ? handle.Id : UINT32_MAX;
+        }
+    case AssetLoadType::Material:
+        {
+            MaterialHandle handle;
+            return m_assetRegistry->FindMaterialAsset( batchId, uri, handle ) ? handle.Id : UINT32_MAX;
+        }
+    case AssetLoadType::Animation:
+        {
+            AnimationClipHandle handle;
+            return m_assetRegistry->FindAnimationAsset( batchId, uri, handle ) ? handle.Id : UINT32_MAX;
+        }
+    case AssetLoadType::Skeleton:
+        {
+            SkeletonHandle handle;
+            return m_assetRegistry->FindSkeletonAsset( batchId, uri, handle ) ? handle.Id : UINT32_MAX;
+        }
+    default:
+        {
+            MeshHandle handle;
+            return m_assetRegistry->FindMeshAsset( batchId, uri, handle ) ? handle.Id : UINT32_MAX;
+        }
+    }
+}
+
+uint32_t AssetLoader::ReadyAssetId( const AssetLoadHandle handle, const AssetLoadType type ) const
+{
+    std::lock_guard      lock( m_lock );
+    const Request *const request = FindRequest( handle.Id );
+    return request && request->Type == type && request->State == AssetLoadState::Ready ? request->AssetId : UINT32_MAX;
+}
+
+AssetLoaderStats AssetLoader::ComputeStats( ) const
+{
+    AssetLoaderStats stats   = m_stats;
+    stats.NumMissedDeadlines = m_scheduler.GetStats( ).NumMissedDeadlines;
+    if ( stats.BusySeconds > 0.0 )
+    {
+        stats.AssetsPerSecond    = static_cast<double>( stats.NumReady ) / stats.BusySeconds;
+        stats.MegabytesPerSecond = static_cast<double>( stats.NumBytesLoaded ) / ( 1024.0 * 1024.0 ) / stats.BusySeconds;
+    }
+    for ( size_t batchId = 0; batchId < m_assetBatcher->NumBatches( ); ++batchId )
+    {
+        stats.NumCopiedBytes += m_assetBatcher->Mesh( batchId )->GetUploadStats( ).NumCopiedBytes;
+    }
+    if ( stats.NumReady > 0 )
+    {
+        stats.AverageLatencyMs    = m_totalLatencyMs / static_cast<double>( stats.NumReady );
+        stats.CopiedBytesPerAsset = static_cast<double>( stats.NumCopiedBytes ) / static_cast<double>( stats.NumReady );
+    }
+    stats.PeakResidentBytes = PeakResidentBytes( );
+    return stats;
+}
@@ -0,0 +1,398 @@
+/*
+Den Of Iz - Game/Game Engine
+Copyright (c) 2020-2024 Muhammed Murat Cengiz
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#include "DZEngine/Assets/AssetPack.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <fstream>
+#include <istream>
+#include <spdlog/spdlog.h>
+
+using namespace DZEngine;
+
+namespace
+{
+    /// Seekable get area over memory that isn't owned or copied
+    class MemoryStreamBuffer final : public std::streambuf
+    {
+    public:
+        MemoryStreamBuffer( const Byte *data, const size_t numBytes )
+        {
+            char *begin = const_cast<char *>( reinterpret_cast<const char *>( data ) );
+            setg( begin, begin, begin + numBytes );
+        }
+
+    protected:
+        pos_type seekoff( const off_type offset, const std::ios_base::seekdir dir, const std::ios_base::openmode which ) override
+        {
+            if ( !( which & std::ios_base::in ) )
+            {
+                return pos_type( off_type( -1 ) );
+            }
+
+            off_type base = 0;
+            if ( dir == std::ios_base::cur )
+            {
+                base = gptr( ) - eback( );
+            }
+            else if ( dir == std::ios_base::end )
+            {
+                base = egptr( ) - eback( );
+            }
+            const off_type position = base + offset;
+            if ( position < 0 || position > egptr( ) - eback( ) )
+            {
+                return pos_type( off_type( -1 ) );
+            }
+            setg( eback( ), eback( ) + position, egptr( ) );
+            return pos_type( position );
+        }
+
+        pos_type seekpos( const pos_type position, const std::ios_base::openmode which ) override
+        {
+            return seekoff( off_type( position ), std::ios_base::beg, which );
+        }
+    };
+
+    // Packs, the output among them, and files still being written aren't assets, packing a previous pack would nest it in every rebuild
+    bool IsAsset( const std::filesystem::path &file, const std::filesystem::path &outputPath )
+    {
+        std::error_code error;
+        const auto      extension = file.extension( );
+        return extension != AssetPack::Extension && extension != ".tmp" && std::filesystem::weakly_canonical( file, error ) != outputPath;
+    }
+} // namespace
+
+AssetReader DZEngine::CreateMemoryReader( const Byte *data, const size_t numBytes )
+{
+#ifdef _WIN32
+    // The istream constructor of BinaryReader isn't exported from the DenOfIz dll, this path copies the region
+    return AssetReader( new BinaryReader( ByteArrayView{ data, numBytes } ) );
+#else
+    AssetReaderDeleter deleter{ };
+    deleter.Buffer = std::make_unique<MemoryStreamBuffer>( data, numBytes );
+    deleter.Stream = std::make_unique<std::istream>( deleter.Buffer.get( ) );
+
+    BinaryReaderDesc readerDesc{ };
+    readerDesc.NumBytes = numBytes;
+    auto *reader        = new BinaryReader( deleter.Stream.get( ), readerDesc );
+    return AssetReader( reader, std::move( deleter ) );
+#endif
+}
+
+AssetPack::AssetPack( const std::filesystem::path &packPath, tf::Executor *executor ) : m_path( packPath ), m_file( packPath ), m_executor( executor )
+{
+    if ( !m_file.IsValid( ) )
+    {
+        spdlog::error( "AssetPack: Failed to map {}", packPath.string( ) );
+        return;
+    }
+
+    const Byte  *data     = m_file.GetData( );
+    const size_t numBytes = m_file.GetNumBytes( );
+    m_header              = reinterpret_cast<const AssetPackHeader *>( data );
+    if ( numBytes < sizeof( AssetPackHeader ) || m_header->FileMagic != AssetPackHeader::Magic || m_header->FileVersion != AssetPackHeader::Version ||
+         !std::has_single_bit( m_header->NumSlots ) || m_header->SlotsOffset + m_header->NumSlots * sizeof( AssetPackSlot ) > numBytes ||
+         m_header->PathsOffset + m_header->PathsNumBytes > numBytes )
+    {
+        spdlog::error( "AssetPack: {} is not a valid pack", packPath.string( ) );
+        Unmap( );
+        return;
+    }
+    m_slots = reinterpret_cast<const AssetPackSlot *>( data + m_header->SlotsOffset );
+    m_paths = reinterpret_cast<const char *>( data + m_header->PathsOffset );
+    spdlog::info( "AssetPack: Mapped {} with {} assets", packPath.string( ), m_header->NumEntries );
+}
+
+AssetPack::~AssetPack( )
+{
+    Unmap( );
+}
+
+bool AssetPack::IsValid( ) const
+{
+    return m_slots != nullptr;
+}
+
+bool AssetPack::Contains( const std::string &path ) const
+{
+    return Find( path ) != nullptr;
+}
+
+AssetReader AssetPack::LoadAsset( const std::string &path ) const
+{
+    const AssetPackSlot *slot = Find( path );
+    if ( !slot )
+    {
+        return nullptr;
+    }
+    if ( slot->Codec == BlockCompressionCodec::None )
+    {
+        return CreateMemoryReader( m_file.GetData( ) + slot->Offset, slot->NumBytes );
+    }
+
+    auto storage = std::make_unique_for_overwrite<Byte[]>( slot->UncompressedNumBytes );
+    if ( !BlockCompression::Decompress( m_file.GetData( ) + slot->Offset, slot->NumBytes, storage.get( ), slot->UncompressedNumBytes, m_executor ) )
+    {
+        spdlog::error( "AssetPack: Failed to decompress {}", path );
+        return nullptr;
+    }
+    AssetReader reader            = CreateMemoryReader( storage.get( ), slot->UncompressedNumBytes );
+    reader.get_deleter( ).Storage = std::move( storage );
+    return reader;
+}
+
+bool AssetPack::ReadAsset( const std::string &path, Byte *dst, const size_t dstNumBytes ) const
+{
+    const AssetPackSlot *slot = Find( path );
+    if ( !slot || slot->UncompressedNumBytes != dstNumBytes )
+    {
+        spdlog::error( "AssetPack: {} is not in {} or has a different size", path, m_path.string( ) );
+        return false;
+    }
+    if ( slot->Codec == BlockCompressionCodec::None )
+    {
+        std::memcpy( dst, m_file.GetData( ) + slot->Offset, dstNumBytes );
+        return true;
+    }
+    return BlockCompression::Decompress( m_file.GetData( ) + slot->Offset, slot->NumBytes, dst, dstNumBytes, m_executor );
+}
+
+size_t AssetPack::GetAssetNumBytes( const std::string &path ) const
+{
+    const AssetPackSlot *slot = Find( path );
+    return slot ? slot->UncompressedNumBytes : 0;
+}
+
+size_t AssetPack::GetAssetStoredNumBytes( const std::string &path ) const
+{
+    const AssetPackSlot *slot = Find( path );
+    return slot ? slot->NumBytes : 0;
+}
+
+std::vector<std::string> AssetPack::GetAssetPaths( ) const
+{
+    std::vector<std::string> paths;
+    if ( !IsValid( ) )
+    {
+        return paths;
+    }
+    paths.reserve( m_header->NumEntries );
+    for ( uint32_t i = 0; i < m_header->NumSlots; ++i )
+    {
+        if ( m_slots[ i ].Hash != 0 )
+        {
+            paths.emplace_back( m_paths + m_slots[ i ].PathOffset, m_slots[ i ].PathLength );
+        }
+    }
+    std::ranges::sort( paths );
+    return paths;
+}
+
+const std::filesystem::path &AssetPack::GetPath( ) const
+{
+    return m_path;
+}
+
+std::vector<Byte> AssetPack::CompressCached( const std::vector<Byte> &payload, const AssetPackBuildDesc &desc )
+{
+    if ( !desc.Cache )
+    {
+        return BlockCompression::Compress( payload.data( ), payload.size( ), desc.Compression );
+    }
+
+    struct
+    {
+        uint32_t Codec;
+        uint32_t ChunkSize;
+        int32_t  Level;
+    } parameters{ static_cast<uint32_t>( desc.Compression.Codec ), desc.Compression.ChunkSize, desc.Compression.Level };
+    const ContentHash key = DerivedDataCache::MakeKey( "AssetPack.Compress", CompressVersion, ContentHash::Of( payload.data( ), payload.size( ) ),
+                                                       std::span( reinterpret_cast<const Byte *>( &parameters ), sizeof( parameters ) ) );
+
+    std::vector<Byte> block;
+    desc.Cache->GetOrBuild( key, block,
+                            [ & ]( std::vector<Byte> &outBlock )
+                            {
+                                outBlock = BlockCompression::Compress( payload.data( ), payload.size( ), desc.Compression );
+                                return !outBlock.empty( );
+                            } );
+    return block;
+}
+
+bool AssetPack::Build( const AssetPackBuildDesc &desc )
+{
+    if ( !std::has_single_bit( desc.Alignment ) )
+    {
+        spdlog::error( "AssetPack: Alignment must be a power of two" );
+        return false;
+    }
+
+    std::error_code                    error;
+    std::vector<std::filesystem::path> files;
+    std::error_code                    outputError;
+    const std::filesystem::path        outputPath = std::filesystem::weakly_canonical( desc.OutputPath, outputError );
+    for ( const auto &entry : std::filesystem::recursive_directory_iterator( desc.AssetsDirectory, error ) )
+    {
+        if ( entry.is_regular_file( ) && IsAsset( entry.path( ), outputPath ) )
+        {
+            files.push_back( entry.path( ) );
+        }
+    }
+    if ( error )
+    {
+        spdlog::error( "AssetPack: Failed to list {}: {}", desc.AssetsDirectory.string( ), error.message( ) );
+        return false;
+    }
+    std::ranges::sort( files ); // Deterministic packs, and assets of a directory end up next to each other
+
+    std::ofstream out( desc.OutputPath, std::ios::binary | std::ios::trunc );
+    if ( !out )
+    {
+        spdlog::error( "AssetPack: Failed to create {}", desc.OutputPath.string( ) );
+        return false;
+    }
+
+    const auto numSlots = std::bit_ceil( std::max<uint32_t>( 16, static_cast<uint32_t>( files.size( ) ) * 2 ) ); // At most half full
+    std::vector<AssetPackSlot> slots( numSlots );
+    std::string                paths;
+
+    const auto alignTo = [ & ]( const uint64_t offset ) { return ( offset + desc.Alignment - 1 ) & ~static_cast<uint64_t>( desc.Alignment - 1 ); };
+    const auto padTo   = [ & ]( const uint64_t offset )
+    {
+        const auto position = static_cast<uint64_t>( out.tellp( ) );
+        const std::vector<char> padding( offset - position, 0 );
+        out.write( padding.data( ), static_cast<std::streamsize>( padding.size( ) ) );
+    };
+
+    AssetPackHeader header{ };
+    out.write( reinterpret_cast<const char *>( &header ), sizeof( header ) );
+
+    std::vector<Byte> payload;
+    uint64_t          numBytes       = 0;
+    uint64_t          numStoredBytes = 0;
+    for ( const auto &file : files )
+    {
+        const std::string path = std::filesystem::relative( file, desc.AssetsDirectory ).generic_string( );
+        std::ifstream     in( file, std::ios::binary | std::ios::ate );
+        if ( !in )
+        {
+            spdlog::error( "AssetPack: Failed to read {}", file.string( ) );
+            return false;
+        }
+        payload.resize( static_cast<size_t>( in.tellg( ) ) );
+        in.seekg( 0 );
+        in.read( reinterpret_cast<char *>( payload.data( ) ), static_cast<std::streamsize>( payload.size( ) ) );
+
+        BlockCompressionCodec    codec  = BlockCompressionCodec::None;
+        std::vector<Byte>        block;
+        const std::vector<Byte> *stored = &payload;
+        if ( desc.Compression.Codec != BlockCompressionCodec::None )
+        {
+            block = CompressCached( payload, desc );
+            if ( !block.empty( ) && block.size( ) < payload.size( ) )
+            {
+                codec  = desc.Compression.Codec;
+                stored = &block;
+            }
+        }
+        numBytes += payload.size( );
+        numStoredBytes += stored->size( );
+
+        const uint64_t offset = alignTo( static_cast<uint64_t>( out.tellp( ) ) );
+        padTo( offset );
+        out.write( reinterpret_cast<const char *>( stored->data( ) ), static_cast<std::streamsize>( stored->size( ) ) );
+
+        const uint64_t hash = HashPath( path );
+        uint32_t       slot = static_cast<uint32_t>( hash ) & ( numSlots - 1 );
+        while ( slots[ slot ].Hash != 0 )
+        {
+            slot = ( slot + 1 ) & ( numSlots - 1 );
+        }
+        slots[ slot ] = AssetPackSlot{ hash, offset, stored->size( ), payload.size( ), static_cast<uint32_t>( paths.size( ) ), static_cast<uint32_t>( path.size( ) ), codec, 0 };
+        paths += path;
+    }
+
+    header.FileMagic     = AssetPackHeader::Magic;
+    header.FileVersion   = AssetPackHeader::Version;
+    header.Alignment     = desc.Alignment;
+    header.NumEntries    = static_cast<uint32_t>( files.size( ) );
+    header.NumSlots      = numSlots;
+    header.SlotsOffset   = alignTo( static_cast<uint64_t>( out.tellp( ) ) );
+    header.PathsOffset   = header.SlotsOffset + numSlots * sizeof( AssetPackSlot );
+    header.PathsNumBytes = paths.size( );
+
+    padTo( header.SlotsOffset );
+    out.write( reinterpret_cast<const char *>( slots.data( ) ), static_cast<std::streamsize>( slots.size( ) * sizeof( AssetPackSlot ) ) );
+    out.write( paths.data( ), static_cast<std::streamsize>( paths.size( ) ) );
+    out.seekp( 0 );
+    out.write( reinterpret_cast<const char *>( &header ), sizeof( header ) );
+    if ( !out )
+    {
+        spdlog::error( "AssetPack: Failed to write {}", desc.OutputPath.string( ) );
+        return false;
+    }
+
+    spdlog::info( "AssetPack: Packed {} assets from {} into {}, {} bytes stored as {}", files.size( ), desc.AssetsDirectory.string( ), desc.OutputPath.string( ), numBytes,
+                  numStoredBytes );
+    return true;
+}
+
+uint64_t AssetPack::HashPath( const std::string &path )
+{
+    // FNV-1a, 0 marks an empty slot
+    uint64_t hash = 14695981039346656037ull;
+    for ( const char c : path )
+    {
+        hash ^= static_cast<uint8_t>( c );
+        hash *= 1099511628211ull;
+    }
+    return hash == 0 ? 1 : hash;
+}
+
+const AssetPackSlot *AssetPack::Find( const std::string &path ) const
+{
+    if ( !IsValid( ) )
+    {
+        return nullptr;
+    }
+
+    const uint64_t hash = HashPath( path );
+    const uint32_t mask = m_header->NumSlots - 1;
+    for ( uint32_t slot = static_cast<uint32_t>( hash ) & mask;; slot = ( slot + 1 ) & mask )
+    {
+        const AssetPackSlot &candidate = m_slots[ slot ];
+        if ( candidate.Hash == 0 )
+        {
+            return nullptr;
+        }
+        if ( candidate.Hash == hash && candidate.PathLength == path.size( ) && std::memcmp( m_paths + candidate.PathOffset, path.data( ), path.size( ) ) == 0 )
+        {
+            return &candidate;
+        }
+    }
+}
+
+void AssetPack::Unmap( )
+{
+    m_file.Unmap( );
+    m_header = nullptr;
+    m_slots  = nullptr;
+    m_paths  = nullptr;
+}
@@ -0,0 +1,107 @@
+/*
+Den Of Iz - Game/Game Engine
+Copyright (c) 2020-2024 Muhammed Murat Cengiz
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#include "DZEngine/Assets/AssetReferenceSystem.h"
+#include <memory>
+#include <type_traits>
+#include <unordered_map>
+#include "DZEngine/Components/Graphics/AnimationComponent.h"
+#include "DZEngine/Components/Graphics/MaterialComponent.h"
+#include "DZEngine/Components/Graphics/MeshComponent.h"
+#include "DZEngine/Components/Graphics/SkeletonComponent.h"
+
+using namespace DZEngine;
+
+namespace
+{
+    struct RetainedAsset
+    {
+        size_t   BatchId;
+        uint32_t Id;
+    };
+
+    size_t EntityBatch( const flecs::entity e )
+    {
+        return e.has<MeshComponent>( ) ? e.get<MeshComponent>( ).BatchId : 0;
+    }
+
+    // OnSet rather than OnAdd as the handle is only known once the component is set. What each entity holds is kept outside of the world,
+    // a component written from the observer would only be visible once the deferred commands are flushed.
+    template <typename T, typename HandleOf>
+    void Track( const flecs::world &world, AssetCache *cache, const AssetRegistryType type, HandleOf handleOf )
+    {
+        auto       retainedAssets = std::make_shared<std::unordered_map<flecs::entity_t, RetainedAsset>>( );
+        const auto update         = [ = ]( const flecs::entity e, const T &component )
+        {
+            const RetainedAsset asset    = handleOf( e, component );
+            const auto          retained = retainedAssets->find( e.id( ) );
+            if ( retained != retainedAssets->end( ) && retained->second.BatchId == asset.BatchId && retained->second.Id == asset.Id )
+            {
+                return;
+            }
+            // Retained first, the asset may be the one released
+            const bool isCached = asset.Id != UINT32_MAX && cache->Retain( type, asset.BatchId, asset.Id ) > 0;
+            if ( retained != retainedAssets->end( ) )
+            {
+                cache->Release( type, retained->second.BatchId, retained->second.Id );
+                retainedAssets->erase( retained );
+            }
+            if ( isCached )
+            {
+                retainedAssets->emplace( e.id( ), asset );
+            }
+        };
+        world.observer<const T>( ).event( flecs::OnSet ).each( update );
+        world.observer<const T>( )
+            .event( flecs::OnRemove )
+            .each(
+                [ = ]( const flecs::entity e, const T & )
+                {
+                    if ( const auto retained = retainedAssets->find( e.id( ) ); retained != retainedAssets->end( ) )
+                    {
+                        cache->Release( type, retained->second.BatchId, retained->second.Id );
+                        retainedAssets->erase( retained );
+                    }
+                } );
+
+        if constexpr ( !std::is_same_v<T, MeshComponent> )
+        {
+            // The batch comes from the MeshComponent, which may be set after T or change batches, the reference follows it
+            world.observer<const MeshComponent>( )
+                .event( flecs::OnSet )
+                .each(
+                    [ = ]( const flecs::entity e, const MeshComponent & )
+                    {
+                        if ( e.has<T>( ) )
+                        {
+                            update( e, e.get<T>( ) );
+                        }
+                    } );
+        }
+    }
+} // namespace
+
+void AssetReferenceSystem::Register( const flecs::world &world, AssetCache *cache )
+{
+    Track<MeshComponent>( world, cache, AssetRegistryType::Mesh, []( flecs::entity, const MeshComponent &mesh ) { return RetainedAsset{ mesh.BatchId, mesh.Handle.Id }; } );
+    Track<MaterialComponent>( world, cache, AssetRegistryType::Material,
+                              []( const flecs::entity e, const MaterialComponent &material ) { return RetainedAsset{ EntityBatch( e ), material.Handle.Id }; } );
+    Track<SkeletonComponent>( world, cache, AssetRegistryType::Skeleton,
+                              []( const flecs::entity e, const SkeletonComponent &skeleton ) { return RetainedAsset{ EntityBatch( e ), skeleton.Handle.Id }; } );
+    Track<AnimationComponent>( world, cache, AssetRegistryType::Animation,
+                               []( const flecs::entity e, const AnimationComponent &animation ) { return RetainedAsset{ EntityBatch( e ), animation.AnimationClip.Id }; } );
+}
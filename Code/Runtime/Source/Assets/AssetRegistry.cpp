@@ -17,216 +17,344 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 */
 
 #include "DZEngine/Assets/AssetRegistry.h"
+#include <algorithm>
+#include <bit>
+#include <cstring>
 #include <fstream>
 #include <nlohmann/json.hpp>
-#include <set>
 #include <spdlog/spdlog.h>
+#include <tuple>
 
 using namespace DZEngine;
 using json = nlohmann::json;
 
-AssetRegistry::AssetRegistry( const std::filesystem::path &registryPath ) : m_registryPath( registryPath )
+namespace
 {
-    spdlog::info( "AssetRegistry: Created with registry path: {}", registryPath.string( ) );
-}
+    constexpr size_t MinSlots = 64;
 
-bool AssetRegistry::LoadFromFile( const std::filesystem::path &registryPath )
-{
-    m_registryPath = registryPath;
+    constexpr const char *TypeNames[] = { "mesh", "material", "texture", "animation", "skeleton" };
+    constexpr const char *TypeKeys[]  = { "meshes", "materials", "textures", "animations", "skeletons" };
+    constexpr const char *LogNames[]  = { "Mesh", "Material", "Texture", "Animation", "Skeleton" };
 
-    if ( !std::filesystem::exists( registryPath ) )
+    uint64_t Mix( uint64_t x )
     {
-        spdlog::info( "AssetRegistry::LoadFromFile - Registry file not found, starting with empty registry: {}", registryPath.string( ) );
-        return true;
+        x ^= x >> 30;
+        x *= 0xBF58476D1CE4E5B9ull;
+        x ^= x >> 27;
+        x *= 0x94D049BB133111EBull;
+        x ^= x >> 31;
+        return x;
     }
 
-    std::ifstream file( registryPath );
-    if ( !file.is_open( ) )
+    uint64_t HashSlotKey( const AssetRegistryType type, const size_t batchId, const uint32_t key )
     {
-        spdlog::error( "AssetRegistry::LoadFromFile - Failed to open registry file: {}", registryPath.string( ) );
-        return false;
+        return Mix( Mix( batchId ) ^ ( static_cast<uint64_t>( key ) << 3 | static_cast<uint64_t>( type ) ) );
     }
 
-    std::string jsonData( ( std::istreambuf_iterator<char>( file ) ), std::istreambuf_iterator<char>( ) );
-    file.close( );
+    uint64_t HashUri( const std::string_view uri )
+    {
+        // FNV-1a
+        uint64_t hash = 14695981039346656037ull;
+        for ( const char c : uri )
+        {
+            hash ^= static_cast<uint8_t>( c );
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
 
-    if ( !json::accept( jsonData ) )
+    size_t TableSizeFor( const size_t numEntries )
     {
-        spdlog::error( "AssetRegistry::LoadFromFile - Invalid JSON in registry file: {}", registryPath.string( ) );
-        return false;
+        return std::bit_ceil( std::max( MinSlots, numEntries * 4 ) );
     }
 
-    json registryJson = json::parse( jsonData );
+    template <typename T>
+    void Sync( AssetRegistryTable<T> &table )
+    {
+        table.Data = table.Owned.data( );
+        table.Size = table.Owned.size( );
+    }
 
-    // Clear existing registries
-    Clear( );
+    template <typename T>
+    void View( AssetRegistryTable<T> &table, const Byte *data, const size_t size )
+    {
+        table.Owned.clear( );
+        table.Data = reinterpret_cast<const T *>( data );
+        table.Size = size;
+    }
 
-    // Load batches
-    if ( registryJson.contains( "batches" ) && registryJson[ "batches" ].is_object( ) )
+    template <typename T>
+    bool InBounds( const AssetRegistryHeader &header, const uint64_t offset, const uint64_t size, const size_t numBytes )
     {
-        for ( const auto &[ batchIdStr, batchData ] : registryJson[ "batches" ].items( ) )
-        {
-            size_t batchId = std::stoull( batchIdStr );
+        return offset % alignof( T ) == 0 && offset >= sizeof( header ) && offset <= numBytes && size <= ( numBytes - offset ) / sizeof( T );
+    }
 
-            // Load meshes
-            if ( batchData.contains( "meshes" ) && batchData[ "meshes" ].is_object( ) )
+    // Used slots reference existing uris and the counts match, at most half full keeps an empty slot that ends every probe sequence
+    bool IsValidSlotTable( const AssetRegistrySlot *slots, const uint32_t numSlots, const uint32_t numEntries, const uint32_t numUsed, const uint32_t numUris,
+                           const bool keyIsUri )
+    {
+        uint32_t entries = 0;
+        uint32_t used    = 0;
+        for ( uint32_t i = 0; i < numSlots; ++i )
+        {
+            const AssetRegistrySlot &slot = slots[ i ];
+            if ( slot.Value == AssetRegistrySlot::Empty )
             {
-                for ( const auto &[ handleIdStr, assetData ] : batchData[ "meshes" ].items( ) )
-                {
-                    uint32_t   handleId = std::stoul( handleIdStr );
-                    AssetEntry entry;
-                    entry.Uri                             = assetData.value( "uri", "" );
-                    entry.AssetType                       = assetData.value( "type", "mesh" );
-                    m_meshRegistry[ batchId ][ handleId ] = entry;
-                }
+                continue;
             }
-
-            // Load materials
-            if ( batchData.contains( "materials" ) && batchData[ "materials" ].is_object( ) )
+            ++used;
+            if ( slot.Value == AssetRegistrySlot::Removed )
             {
-                for ( const auto &[ handleIdStr, assetData ] : batchData[ "materials" ].items( ) )
-                {
-                    uint32_t   handleId = std::stoul( handleIdStr );
-                    AssetEntry entry;
-                    entry.Uri                                 = assetData.value( "uri", "" );
-                    entry.AssetType                           = assetData.value( "type", "material" );
-                    m_materialRegistry[ batchId ][ handleId ] = entry;
-                }
+                continue;
             }
-
-            // Load textures
-            if ( batchData.contains( "textures" ) && batchData[ "textures" ].is_object( ) )
+            ++entries;
+            if ( slot.Type >= AssetRegistryType::Count || ( keyIsUri ? slot.Key : slot.Value ) >= numUris )
             {
-                for ( const auto &[ handleIdStr, assetData ] : batchData[ "textures" ].items( ) )
-                {
-                    uint32_t   handleId = std::stoul( handleIdStr );
-                    AssetEntry entry;
-                    entry.Uri                                = assetData.value( "uri", "" );
-                    entry.AssetType                          = assetData.value( "type", "texture" );
-                    m_textureRegistry[ batchId ][ handleId ] = entry;
-                }
+                return false;
             }
+        }
+        return entries == numEntries && used == numUsed && static_cast<uint64_t>( used ) * 2 <= numSlots;
+    }
 
-            if ( batchData.contains( "animations" ) && batchData[ "animations" ].is_object( ) )
+    bool IsValidUriTables( const AssetRegistryHeader &header, const AssetRegistryUri *uris, const uint32_t *internSlots )
+    {
+        for ( uint32_t i = 0; i < header.NumUris; ++i )
+        {
+            if ( static_cast<uint64_t>( uris[ i ].Offset ) + uris[ i ].NumBytes > header.UriDataNumBytes )
             {
-                for ( const auto &[ handleIdStr, assetData ] : batchData[ "animations" ].items( ) )
-                {
-                    uint32_t   handleId = std::stoul( handleIdStr );
-                    AssetEntry entry;
-                    entry.Uri                                  = assetData.value( "uri", "" );
-                    entry.AssetType                            = assetData.value( "type", "animation" );
-                    m_animationRegistry[ batchId ][ handleId ] = entry;
-                }
+                return false;
             }
+        }
 
-            if ( batchData.contains( "skeletons" ) && batchData[ "skeletons" ].is_object( ) )
+        uint32_t numInterned = 0;
+        for ( uint32_t i = 0; i < header.NumInternSlots; ++i )
+        {
+            if ( internSlots[ i ] == UINT32_MAX )
             {
-                for ( const auto &[ handleIdStr, assetData ] : batchData[ "skeletons" ].items( ) )
-                {
-                    uint32_t   handleId = std::stoul( handleIdStr );
-                    AssetEntry entry;
-                    entry.Uri                                 = assetData.value( "uri", "" );
-                    entry.AssetType                           = assetData.value( "type", "skeleton" );
-                    m_skeletonRegistry[ batchId ][ handleId ] = entry;
-                }
+                continue;
             }
+            if ( internSlots[ i ] >= header.NumUris )
+            {
+                return false;
+            }
+            ++numInterned;
         }
+        return numInterned == header.NumUris && static_cast<uint64_t>( numInterned ) * 2 <= header.NumInternSlots;
     }
 
-    spdlog::info( "AssetRegistry::LoadFromFile - Loaded asset registry from: {}", registryPath.string( ) );
-    return true;
+    template <typename T>
+    void Write( std::ofstream &file, const AssetRegistryTable<T> &table )
+    {
+        file.write( reinterpret_cast<const char *>( table.Data ), static_cast<std::streamsize>( table.Size * sizeof( T ) ) );
+    }
+} // namespace
+
+AssetRegistry::AssetRegistry( const std::filesystem::path &registryPath ) : m_registryPath( registryPath )
+{
+    spdlog::info( "AssetRegistry: Created with registry path: {}", registryPath.string( ) );
+}
+
+bool AssetRegistry::LoadFromFile( const std::filesystem::path &registryPath )
+{
+    m_registryPath = registryPath;
+
+    if ( !std::filesystem::exists( registryPath ) )
+    {
+        spdlog::info( "AssetRegistry::LoadFromFile - Registry file not found, starting with empty registry: {}", registryPath.string( ) );
+        return true;
+    }
+
+    std::ifstream file( registryPath, std::ios::binary );
+    if ( !file.is_open( ) )
+    {
+        spdlog::error( "AssetRegistry::LoadFromFile - Failed to open registry file: {}", registryPath.string( ) );
+        return false;
+    }
+    uint32_t magic = 0;
+    file.read( reinterpret_cast<char *>( &magic ), sizeof( magic ) );
+    file.close( );
+
+    const bool loaded = magic == AssetRegistryHeader::Magic ? LoadBinary( registryPath ) : LoadJson( registryPath );
+    if ( loaded )
+    {
+        spdlog::info( "AssetRegistry::LoadFromFile - Loaded {} assets from: {}", GetNumEntries( ), registryPath.string( ) );
+    }
+    return loaded;
 }
 
 bool AssetRegistry::SaveToFile( const std::filesystem::path &registryPath )
 {
     m_registryPath = registryPath;
 
-    json registryJson;
-    registryJson[ "batches" ] = json::object( );
-    std::set<size_t> allBatchIds;
-    for ( const auto &batchId : m_meshRegistry | std::views::keys )
+    std::error_code ec;
+    std::filesystem::create_directories( registryPath.parent_path( ), ec );
+    if ( ec )
+    {
+        spdlog::error( "AssetRegistry::SaveToFile - Failed to create directories: {}", ec.message( ) );
+        return false;
+    }
+
+    const bool saved = registryPath.extension( ) == BinaryExtension ? SaveBinary( registryPath ) : SaveJson( registryPath );
+    if ( saved )
     {
-        allBatchIds.insert( batchId );
+        spdlog::info( "AssetRegistry::SaveToFile - Saved {} assets to: {}", GetNumEntries( ), registryPath.string( ) );
     }
-    for ( const auto &batchId : m_materialRegistry | std::views::keys )
+    return saved;
+}
+
+bool AssetRegistry::LoadBinary( const std::filesystem::path &registryPath )
+{
+    MappedFile file( registryPath );
+    if ( !file.IsValid( ) || file.GetNumBytes( ) < sizeof( AssetRegistryHeader ) )
     {
-        allBatchIds.insert( batchId );
+        spdlog::error( "AssetRegistry::LoadBinary - Failed to map registry file: {}", registryPath.string( ) );
+        return false;
     }
-    for ( const auto &batchId : m_textureRegistry | std::views::keys )
+
+    const Byte                *data        = file.GetData( );
+    const size_t               numBytes    = file.GetNumBytes( );
+    const AssetRegistryHeader &header      = *reinterpret_cast<const AssetRegistryHeader *>( data );
+    const auto                 isTableSize = []( const uint32_t size ) { return size == 0 || std::has_single_bit( size ); };
+    if ( header.FileVersion != AssetRegistryHeader::Version || !isTableSize( header.NumHandleSlots ) || !isTableSize( header.NumUriSlots ) ||
+         !isTableSize( header.NumInternSlots ) || !InBounds<AssetRegistrySlot>( header, header.HandleSlotsOffset, header.NumHandleSlots, numBytes ) ||
+         !InBounds<AssetRegistrySlot>( header, header.UriSlotsOffset, header.NumUriSlots, numBytes ) ||
+         !InBounds<AssetRegistryUri>( header, header.UrisOffset, header.NumUris, numBytes ) ||
+         !InBounds<uint32_t>( header, header.InternSlotsOffset, header.NumInternSlots, numBytes ) ||
+         !InBounds<char>( header, header.UriDataOffset, header.UriDataNumBytes, numBytes ) )
     {
-        allBatchIds.insert( batchId );
+        spdlog::error( "AssetRegistry::LoadBinary - {} is not a valid registry", registryPath.string( ) );
+        return false;
     }
-    for ( const auto &batchId : m_animationRegistry | std::views::keys )
+
+    // Lookups trust the tables, a truncated or corrupt file would read out of bounds or probe forever
+    const auto *handleSlots = reinterpret_cast<const AssetRegistrySlot *>( data + header.HandleSlotsOffset );
+    const auto *uriSlots    = reinterpret_cast<const AssetRegistrySlot *>( data + header.UriSlotsOffset );
+    const auto *uris        = reinterpret_cast<const AssetRegistryUri *>( data + header.UrisOffset );
+    const auto *internSlots = reinterpret_cast<const uint32_t *>( data + header.InternSlotsOffset );
+    if ( !IsValidSlotTable( handleSlots, header.NumHandleSlots, header.NumHandleEntries, header.NumHandleSlotsUsed, header.NumUris, false ) ||
+         !IsValidSlotTable( uriSlots, header.NumUriSlots, header.NumUriEntries, header.NumUriSlotsUsed, header.NumUris, true ) || !IsValidUriTables( header, uris, internSlots ) )
     {
-        allBatchIds.insert( batchId );
+        spdlog::error( "AssetRegistry::LoadBinary - {} has corrupt tables", registryPath.string( ) );
+        return false;
     }
-    for ( const auto &batchId : m_skeletonRegistry | std::views::keys )
+
+    Clear( );
+    View( m_handles.Slots, data + header.HandleSlotsOffset, header.NumHandleSlots );
+    View( m_uriHandles.Slots, data + header.UriSlotsOffset, header.NumUriSlots );
+    View( m_uris, data + header.UrisOffset, header.NumUris );
+    View( m_internSlots, data + header.InternSlotsOffset, header.NumInternSlots );
+    View( m_uriData, data + header.UriDataOffset, header.UriDataNumBytes );
+    m_handles.NumEntries    = header.NumHandleEntries;
+    m_handles.NumUsed       = header.NumHandleSlotsUsed;
+    m_uriHandles.NumEntries = header.NumUriEntries;
+    m_uriHandles.NumUsed    = header.NumUriSlotsUsed;
+    m_file                  = std::move( file );
+    return true;
+}
+
+bool AssetRegistry::LoadJson( const std::filesystem::path &registryPath )
+{
+    std::ifstream file( registryPath );
+    if ( !file.is_open( ) )
     {
-        allBatchIds.insert( batchId );
+        spdlog::error( "AssetRegistry::LoadJson - Failed to open registry file: {}", registryPath.string( ) );
+        return false;
     }
-    for ( size_t batchId : allBatchIds )
+
+    const json registryJson = json::parse( file, nullptr, false );
+    if ( registryJson.is_discarded( ) )
     {
-        std::string batchIdStr                  = std::to_string( batchId );
-        registryJson[ "batches" ][ batchIdStr ] = json::object( );
-        if ( m_meshRegistry.contains( batchId ) )
-        {
-            registryJson[ "batches" ][ batchIdStr ][ "meshes" ] = json::object( );
-            for ( const auto &[ handleId, entry ] : m_meshRegistry[ batchId ] )
-            {
-                std::string handleIdStr                                            = std::to_string( handleId );
-                registryJson[ "batches" ][ batchIdStr ][ "meshes" ][ handleIdStr ] = { { "uri", entry.Uri }, { "type", entry.AssetType } };
-            }
-        }
-        if ( m_materialRegistry.contains( batchId ) )
-        {
-            registryJson[ "batches" ][ batchIdStr ][ "materials" ] = json::object( );
-            for ( const auto &[ handleId, entry ] : m_materialRegistry[ batchId ] )
-            {
-                std::string handleIdStr                                               = std::to_string( handleId );
-                registryJson[ "batches" ][ batchIdStr ][ "materials" ][ handleIdStr ] = { { "uri", entry.Uri }, { "type", entry.AssetType } };
-            }
-        }
-        if ( m_textureRegistry.contains( batchId ) )
-        {
-            registryJson[ "batches" ][ batchIdStr ][ "textures" ] = json::object( );
-            for ( const auto &[ handleId, entry ] : m_textureRegistry[ batchId ] )
-            {
-                std::string handleIdStr                                              = std::to_string( handleId );
-                registryJson[ "batches" ][ batchIdStr ][ "textures" ][ handleIdStr ] = { { "uri", entry.Uri }, { "type", entry.AssetType } };
-            }
-        }
-        if ( m_animationRegistry.contains( batchId ) )
+        spdlog::error( "AssetRegistry::LoadJson - Invalid JSON in registry file: {}", registryPath.string( ) );
+        return false;
+    }
+
+    Clear( );
+    const auto batches = registryJson.find( "batches" );
+    if ( batches == registryJson.end( ) || !batches->is_object( ) )
+    {
+        return true;
+    }
+    for ( const auto &[ batchIdStr, batchData ] : batches->items( ) )
+    {
+        const size_t batchId = std::stoull( batchIdStr );
+        for ( uint32_t type = 0; type < static_cast<uint32_t>( AssetRegistryType::Count ); ++type )
         {
-            registryJson[ "batches" ][ batchIdStr ][ "animations" ] = json::object( );
-            for ( const auto &[ handleId, entry ] : m_animationRegistry[ batchId ] )
+            const auto assets = batchData.find( TypeKeys[ type ] );
+            if ( assets == batchData.end( ) || !assets->is_object( ) )
             {
-                std::string handleIdStr                                                = std::to_string( handleId );
-                registryJson[ "batches" ][ batchIdStr ][ "animations" ][ handleIdStr ] = { { "uri", entry.Uri }, { "type", entry.AssetType } };
+                continue;
             }
-        }
-        if ( m_skeletonRegistry.contains( batchId ) )
-        {
-            registryJson[ "batches" ][ batchIdStr ][ "skeletons" ] = json::object( );
-            for ( const auto &[ handleId, entry ] : m_skeletonRegistry[ batchId ] )
+            for ( const auto &[ handleIdStr, assetData ] : assets->items( ) )
             {
-                std::string handleIdStr                                               = std::to_string( handleId );
-                registryJson[ "batches" ][ batchIdStr ][ "skeletons" ][ handleIdStr ] = { { "uri", entry.Uri }, { "type", entry.AssetType } };
+                Register( static_cast<AssetRegistryType>( type ), batchId, static_cast<uint32_t>( std::stoul( handleIdStr ) ), assetData.value( "uri", "" ) );
             }
         }
     }
+    return true;
+}
 
-    std::error_code ec;
-    std::filesystem::create_directories( registryPath.parent_path( ), ec );
-    if ( ec )
+bool AssetRegistry::SaveBinary( const std::filesystem::path &registryPath ) const
+{
+    AssetRegistryHeader header{ };
+    header.FileMagic          = AssetRegistryHeader::Magic;
+    header.FileVersion        = AssetRegistryHeader::Version;
+    header.NumHandleSlots     = static_cast<uint32_t>( m_handles.Slots.Size );
+    header.NumHandleEntries   = m_handles.NumEntries;
+    header.NumHandleSlotsUsed = m_handles.NumUsed;
+    header.NumUriSlots        = static_cast<uint32_t>( m_uriHandles.Slots.Size );
+    header.NumUriEntries      = m_uriHandles.NumEntries;
+    header.NumUriSlotsUsed    = m_uriHandles.NumUsed;
+    header.NumUris            = static_cast<uint32_t>( m_uris.Size );
+    header.NumInternSlots     = static_cast<uint32_t>( m_internSlots.Size );
+    header.HandleSlotsOffset  = sizeof( AssetRegistryHeader );
+    header.UriSlotsOffset     = header.HandleSlotsOffset + m_handles.Slots.Size * sizeof( AssetRegistrySlot );
+    header.UrisOffset         = header.UriSlotsOffset + m_uriHandles.Slots.Size * sizeof( AssetRegistrySlot );
+    header.InternSlotsOffset  = header.UrisOffset + m_uris.Size * sizeof( AssetRegistryUri );
+    header.UriDataOffset      = header.InternSlotsOffset + m_internSlots.Size * sizeof( uint32_t );
+    header.UriDataNumBytes    = m_uriData.Size;
+
+    std::ofstream file( registryPath, std::ios::binary );
+    if ( !file.is_open( ) )
     {
-        spdlog::error( "AssetRegistry::SaveToFile - Failed to create directories: {}", ec.message( ) );
+        spdlog::error( "AssetRegistry::SaveBinary - Failed to create registry file: {}", registryPath.string( ) );
+        return false;
+    }
+    file.write( reinterpret_cast<const char *>( &header ), sizeof( header ) );
+    Write( file, m_handles.Slots );
+    Write( file, m_uriHandles.Slots );
+    Write( file, m_uris );
+    Write( file, m_internSlots );
+    Write( file, m_uriData );
+    file.close( );
+
+    if ( file.fail( ) )
+    {
+        spdlog::error( "AssetRegistry::SaveBinary - Failed to write registry file: {}", registryPath.string( ) );
         return false;
     }
+    return true;
+}
+
+bool AssetRegistry::SaveJson( const std::filesystem::path &registryPath ) const
+{
+    json registryJson;
+    registryJson[ "batches" ] = json::object( );
+    for ( size_t i = 0; i < m_handles.Slots.Size; ++i )
+    {
+        const AssetRegistrySlot &slot = m_handles.Slots.Data[ i ];
+        if ( slot.Value == AssetRegistrySlot::Empty || slot.Value == AssetRegistrySlot::Removed )
+        {
+            continue;
+        }
+        const auto type = static_cast<uint32_t>( slot.Type );
+        registryJson[ "batches" ][ std::to_string( slot.BatchId ) ][ TypeKeys[ type ] ][ std::to_string( slot.Key ) ] = { { "uri", UriAt( slot.Value ) },
+                                                                                                                          { "type", TypeNames[ type ] } };
+    }
 
     std::ofstream file( registryPath );
     if ( !file.is_open( ) )
     {
-        spdlog::error( "AssetRegistry::SaveToFile - Failed to create registry file: {}", registryPath.string( ) );
+        spdlog::error( "AssetRegistry::SaveJson - Failed to create registry file: {}", registryPath.string( ) );
         return false;
     }
 
@@ -235,214 +363,413 @@ bool AssetRegistry::SaveToFile( const std::filesystem::path &registryPath )
 
     if ( file.fail( ) )
     {
-        spdlog::error( "AssetRegistry::SaveToFile - Failed to write registry file: {}", registryPath.string( ) );
+        spdlog::error( "AssetRegistry::SaveJson - Failed to write registry file: {}", registryPath.string( ) );
         return false;
     }
-
-    spdlog::info( "AssetRegistry::SaveToFile - Saved asset registry to: {}", registryPath.string( ) );
     return true;
 }
 
-void AssetRegistry::RegisterMeshAsset( size_t batchId, MeshHandle handle, const std::string &uri )
+void AssetRegistry::RegisterMeshAsset( const size_t batchId, const MeshHandle handle, const std::string &uri )
 {
-    AssetEntry entry;
-    entry.Uri                              = uri;
-    entry.AssetType                        = "mesh";
-    m_meshRegistry[ batchId ][ handle.Id ] = entry;
-
+    Register( AssetRegistryType::Mesh, batchId, handle.Id, uri );
     spdlog::debug( "AssetRegistry::RegisterMeshAsset - Batch: {}, Handle: {}, URI: {}", batchId, handle.Id, uri );
 }
 
-void AssetRegistry::RegisterMaterialAsset( size_t batchId, MaterialHandle handle, const std::string &uri )
+void AssetRegistry::RegisterMaterialAsset( const size_t batchId, const MaterialHandle handle, const std::string &uri )
 {
-    AssetEntry entry;
-    entry.Uri                                  = uri;
-    entry.AssetType                            = "material";
-    m_materialRegistry[ batchId ][ handle.Id ] = entry;
-
+    Register( AssetRegistryType::Material, batchId, handle.Id, uri );
     spdlog::debug( "AssetRegistry::RegisterMaterialAsset - Batch: {}, Handle: {}, URI: {}", batchId, handle.Id, uri );
 }
 
-void AssetRegistry::RegisterTextureAsset( size_t batchId, TextureHandle handle, const std::string &uri )
+void AssetRegistry::RegisterTextureAsset( const size_t batchId, const TextureHandle handle, const std::string &uri )
 {
-    AssetEntry entry;
-    entry.Uri                                 = uri;
-    entry.AssetType                           = "texture";
-    m_textureRegistry[ batchId ][ handle.Id ] = entry;
-
+    Register( AssetRegistryType::Texture, batchId, handle.Id, uri );
     spdlog::debug( "AssetRegistry::RegisterTextureAsset - Batch: {}, Handle: {}, URI: {}", batchId, handle.Id, uri );
 }
 
-void AssetRegistry::RegisterAnimationAsset( size_t batchId, AnimationClipHandle handle, const std::string &uri )
+void AssetRegistry::RegisterAnimationAsset( const size_t batchId, const AnimationClipHandle handle, const std::string &uri )
 {
-    AssetEntry entry;
-    entry.Uri                                   = uri;
-    entry.AssetType                             = "animation";
-    m_animationRegistry[ batchId ][ handle.Id ] = entry;
-
+    Register( AssetRegistryType::Animation, batchId, handle.Id, uri );
     spdlog::debug( "AssetRegistry::RegisterAnimationAsset - Batch: {}, Handle: {}, URI: {}", batchId, handle.Id, uri );
 }
 
-void AssetRegistry::RegisterSkeletonAsset( size_t batchId, SkeletonHandle handle, const std::string &uri )
+void AssetRegistry::RegisterSkeletonAsset( const size_t batchId, const SkeletonHandle handle, const std::string &uri )
 {
-    AssetEntry entry;
-    entry.Uri                                  = uri;
-    entry.AssetType                            = "skeleton";
-    m_skeletonRegistry[ batchId ][ handle.Id ] = entry;
-
+    Register( AssetRegistryType::Skeleton, batchId, handle.Id, uri );
     spdlog::debug( "AssetRegistry::RegisterSkeletonAsset - Batch: {}, Handle: {}, URI: {}", batchId, handle.Id, uri );
 }
 
-bool AssetRegistry::GetMeshAssetUri( const size_t batchId, const MeshHandle handle, std::string &outUri )
+bool AssetRegistry::GetMeshAssetUri( const size_t batchId, const MeshHandle handle, std::string &outUri ) const
 {
-    if ( m_meshRegistry.contains( batchId ) && m_meshRegistry[ batchId ].contains( handle.Id ) )
+    std::string_view uri;
+    if ( !GetUri( AssetRegistryType::Mesh, batchId, handle.Id, uri ) )
     {
-        outUri = m_meshRegistry[ batchId ][ handle.Id ].Uri;
-        return true;
+        return false;
     }
-    return false;
+    outUri = uri;
+    return true;
 }
 
-bool AssetRegistry::GetMaterialAssetUri( const size_t batchId, const MaterialHandle handle, std::string &outUri )
+bool AssetRegistry::GetMaterialAssetUri( const size_t batchId, const MaterialHandle handle, std::string &outUri ) const
 {
-    if ( m_materialRegistry.contains( batchId ) && m_materialRegistry[ batchId ].contains( handle.Id ) )
+    std::string_view uri;
+    if ( !GetUri( AssetRegistryType::Material, batchId, handle.Id, uri ) )
     {
-        outUri = m_materialRegistry[ batchId ][ handle.Id ].Uri;
-        return true;
+        return false;
     }
-    return false;
+    outUri = uri;
+    return true;
 }
 
-bool AssetRegistry::GetTextureAssetUri( const size_t batchId, const TextureHandle handle, std::string &outUri )
+bool AssetRegistry::GetTextureAssetUri( const size_t batchId, const TextureHandle handle, std::string &outUri ) const
 {
-    if ( m_textureRegistry.contains( batchId ) && m_textureRegistry[ batchId ].contains( handle.Id ) )
+    std::string_view uri;
+    if ( !GetUri( AssetRegistryType::Texture, batchId, handle.Id, uri ) )
     {
-        outUri = m_textureRegistry[ batchId ][ handle.Id ].Uri;
-        return true;
+        return false;
     }
-    return false;
+    outUri = uri;
+    return true;
 }
 
-bool AssetRegistry::GetAnimationAssetUri( const size_t batchId, const AnimationClipHandle handle, std::string &outUri )
+bool AssetRegistry::GetAnimationAssetUri( const size_t batchId, const AnimationClipHandle handle, std::string &outUri ) const
 {
-    if ( m_animationRegistry.contains( batchId ) && m_animationRegistry[ batchId ].contains( handle.Id ) )
+    std::string_view uri;
+    if ( !GetUri( AssetRegistryType::Animation, batchId, handle.Id, uri ) )
     {
-        outUri = m_animationRegistry[ batchId ][ handle.Id ].Uri;
-        return true;
+        return false;
     }
-    return false;
+    outUri = uri;
+    return true;
 }
 
-bool AssetRegistry::GetSkeletonAssetUri( const size_t batchId, const SkeletonHandle handle, std::string &outUri )
+bool AssetRegistry::GetSkeletonAssetUri( const size_t batchId, const SkeletonHandle handle, std::string &outUri ) const
 {
-    if ( m_skeletonRegistry.contains( batchId ) && m_skeletonRegistry[ batchId ].contains( handle.Id ) )
+    std::string_view uri;
+    if ( !GetUri( AssetRegistryType::Skeleton, batchId, handle.Id, uri ) )
     {
-        outUri = m_skeletonRegistry[ batchId ][ handle.Id ].Uri;
-        return true;
+        return false;
     }
-    return false;
+    outUri = uri;
+    return true;
+}
+
+bool AssetRegistry::FindMeshAsset( const size_t batchId, const std::string &uri, MeshHandle &outHandle ) const
+{
+    return Find( AssetRegistryType::Mesh, batchId, uri, outHandle.Id );
 }
 
-void AssetRegistry::ClearBatch( size_t batchId )
+bool AssetRegistry::FindMaterialAsset( const size_t batchId, const std::string &uri, MaterialHandle &outHandle ) const
 {
-    m_meshRegistry.erase( batchId );
-    m_materialRegistry.erase( batchId );
-    m_textureRegistry.erase( batchId );
-    m_animationRegistry.erase( batchId );
-    m_skeletonRegistry.erase( batchId );
+    return Find( AssetRegistryType::Material, batchId, uri, outHandle.Id );
+}
 
-    spdlog::debug( "AssetRegistry::ClearBatch - Cleared batch: {}", batchId );
+bool AssetRegistry::FindTextureAsset( const size_t batchId, const std::string &uri, TextureHandle &outHandle ) const
+{
+    return Find( AssetRegistryType::Texture, batchId, uri, outHandle.Id );
 }
 
-void AssetRegistry::Clear( )
+bool AssetRegistry::FindAnimationAsset( const size_t batchId, const std::string &uri, AnimationClipHandle &outHandle ) const
 {
-    m_meshRegistry.clear( );
-    m_materialRegistry.clear( );
-    m_textureRegistry.clear( );
-    m_animationRegistry.clear( );
-    m_skeletonRegistry.clear( );
+    return Find( AssetRegistryType::Animation, batchId, uri, outHandle.Id );
+}
 
-    spdlog::debug( "AssetRegistry::Clear - Cleared all registries" );
+bool AssetRegistry::FindSkeletonAsset( const size_t batchId, const std::string &uri, SkeletonHandle &outHandle ) const
+{
+    return Find( AssetRegistryType::Skeleton, batchId, uri, outHandle.Id );
 }
 
-void AssetRegistry::LogRegistry( )
+void AssetRegistry::Register( const AssetRegistryType type, const size_t batchId, const uint32_t handleId, const std::string_view uri )
 {
-    spdlog::info( "=== AssetRegistry Contents ===" );
+    MakeWritable( );
+    const uint32_t uriIndex = Intern( uri );
+    if ( const uint32_t slot = FindSlot( m_handles, type, batchId, handleId ); slot != UINT32_MAX )
+    {
+        const uint32_t previousUri = m_handles.Slots.Data[ slot ].Value;
+        if ( previousUri == uriIndex )
+        {
+            return;
+        }
+        // The previous uri may have been registered again for another handle since
+        if ( const uint32_t uriSlot = FindSlot( m_uriHandles, type, batchId, previousUri ); uriSlot != UINT32_MAX && m_uriHandles.Slots.Data[ uriSlot ].Value == handleId )
+        {
+            RemoveSlot( m_uriHandles, uriSlot );
+        }
+    }
+    SetSlot( m_handles, type, batchId, handleId, uriIndex );
+    SetSlot( m_uriHandles, type, batchId, uriIndex, handleId );
+}
 
-    std::set<size_t> allBatchIds;
-    for ( const auto &batchId : m_meshRegistry | std::views::keys )
+void AssetRegistry::Unregister( const AssetRegistryType type, const size_t batchId, const uint32_t handleId )
+{
+    const uint32_t slot = FindSlot( m_handles, type, batchId, handleId );
+    if ( slot == UINT32_MAX )
     {
-        allBatchIds.insert( batchId );
+        return;
     }
-    for ( const auto &batchId : m_materialRegistry | std::views::keys )
+    MakeWritable( ); // Copies the slots as they are
+    const uint32_t uri = m_handles.Slots.Data[ slot ].Value;
+    RemoveSlot( m_handles, slot );
+    if ( const uint32_t uriSlot = FindSlot( m_uriHandles, type, batchId, uri ); uriSlot != UINT32_MAX && m_uriHandles.Slots.Data[ uriSlot ].Value == handleId )
     {
-        allBatchIds.insert( batchId );
+        RemoveSlot( m_uriHandles, uriSlot );
     }
-    for ( const auto &batchId : m_textureRegistry | std::views::keys )
+}
+
+bool AssetRegistry::GetUri( const AssetRegistryType type, const size_t batchId, const uint32_t handleId, std::string_view &outUri ) const
+{
+    const uint32_t slot = FindSlot( m_handles, type, batchId, handleId );
+    if ( slot == UINT32_MAX )
     {
-        allBatchIds.insert( batchId );
+        return false;
     }
-    for ( const auto &batchId : m_animationRegistry | std::views::keys )
+    outUri = UriAt( m_handles.Slots.Data[ slot ].Value );
+    return true;
+}
+
+bool AssetRegistry::Find( const AssetRegistryType type, const size_t batchId, const std::string_view uri, uint32_t &outHandleId ) const
+{
+    outHandleId             = UINT32_MAX;
+    const uint32_t uriIndex = FindUri( uri );
+    if ( uriIndex == UINT32_MAX )
     {
-        allBatchIds.insert( batchId );
+        return false;
     }
-    for ( const auto &batchId : m_skeletonRegistry | std::views::keys )
+    const uint32_t slot = FindSlot( m_uriHandles, type, batchId, uriIndex );
+    if ( slot == UINT32_MAX )
     {
-        allBatchIds.insert( batchId );
+        return false;
     }
+    outHandleId = m_uriHandles.Slots.Data[ slot ].Value;
+    return true;
+}
 
-    for ( size_t batchId : allBatchIds )
+void AssetRegistry::ClearBatch( const size_t batchId )
+{
+    MakeWritable( );
+    for ( AssetRegistrySlotTable *table : { &m_handles, &m_uriHandles } )
     {
-        spdlog::info( "Batch {}:", batchId );
-
-        if ( m_meshRegistry.contains( batchId ) )
+        for ( size_t i = 0; i < table->Slots.Size; ++i )
         {
-            for ( const auto &[ handleId, entry ] : m_meshRegistry[ batchId ] )
+            const AssetRegistrySlot &slot = table->Slots.Data[ i ];
+            if ( slot.BatchId == batchId && slot.Value != AssetRegistrySlot::Empty && slot.Value != AssetRegistrySlot::Removed )
             {
-                spdlog::info( "  Mesh {}: {}", handleId, entry.Uri );
+                RemoveSlot( *table, static_cast<uint32_t>( i ) );
             }
         }
+    }
+
+    spdlog::debug( "AssetRegistry::ClearBatch - Cleared batch: {}", batchId );
+}
 
-        if ( m_materialRegistry.contains( batchId ) )
+void AssetRegistry::Clear( )
+{
+    m_handles     = { };
+    m_uriHandles  = { };
+    m_uris        = { };
+    m_internSlots = { };
+    m_uriData     = { };
+    m_file.Unmap( );
+
+    spdlog::debug( "AssetRegistry::Clear - Cleared all registries" );
+}
+
+void AssetRegistry::LogRegistry( ) const
+{
+    spdlog::info( "=== AssetRegistry Contents ===" );
+
+    std::vector<const AssetRegistrySlot *> slots;
+    slots.reserve( m_handles.NumEntries );
+    for ( size_t i = 0; i < m_handles.Slots.Size; ++i )
+    {
+        if ( const AssetRegistrySlot &slot = m_handles.Slots.Data[ i ]; slot.Value != AssetRegistrySlot::Empty && slot.Value != AssetRegistrySlot::Removed )
         {
-            for ( const auto &[ handleId, entry ] : m_materialRegistry[ batchId ] )
-            {
-                spdlog::info( "  Material {}: {}", handleId, entry.Uri );
-            }
+            slots.push_back( &slot );
         }
+    }
+    std::ranges::sort( slots, { }, []( const AssetRegistrySlot *slot ) { return std::tuple( slot->BatchId, slot->Type, slot->Key ); } );
 
-        if ( m_textureRegistry.contains( batchId ) )
+    for ( size_t i = 0; i < slots.size( ); ++i )
+    {
+        if ( i == 0 || slots[ i ]->BatchId != slots[ i - 1 ]->BatchId )
         {
-            for ( const auto &[ handleId, entry ] : m_textureRegistry[ batchId ] )
-            {
-                spdlog::info( "  Texture {}: {}", handleId, entry.Uri );
-            }
+            spdlog::info( "Batch {}:", slots[ i ]->BatchId );
         }
+        spdlog::info( "  {} {}: {}", LogNames[ static_cast<uint32_t>( slots[ i ]->Type ) ], slots[ i ]->Key, UriAt( slots[ i ]->Value ) );
+    }
+}
 
-        if ( m_animationRegistry.contains( batchId ) )
+size_t AssetRegistry::GetNumEntries( ) const
+{
+    return m_handles.NumEntries;
+}
+
+const std::filesystem::path &AssetRegistry::GetRegistryPath( ) const
+{
+    return m_registryPath;
+}
+
+void AssetRegistry::SetRegistryPath( const std::filesystem::path &path )
+{
+    m_registryPath = path;
+}
+
+void AssetRegistry::MakeWritable( )
+{
+    if ( !m_file.IsValid( ) )
+    {
+        return;
+    }
+    // A few bulk copies, the mapping is released right after
+    m_handles.Slots.Owned.assign( m_handles.Slots.Data, m_handles.Slots.Data + m_handles.Slots.Size );
+    m_uriHandles.Slots.Owned.assign( m_uriHandles.Slots.Data, m_uriHandles.Slots.Data + m_uriHandles.Slots.Size );
+    m_uris.Owned.assign( m_uris.Data, m_uris.Data + m_uris.Size );
+    m_internSlots.Owned.assign( m_internSlots.Data, m_internSlots.Data + m_internSlots.Size );
+    m_uriData.Owned.assign( m_uriData.Data, m_uriData.Data + m_uriData.Size );
+    Sync( m_handles.Slots );
+    Sync( m_uriHandles.Slots );
+    Sync( m_uris );
+    Sync( m_internSlots );
+    Sync( m_uriData );
+    m_file.Unmap( );
+}
+
+uint32_t AssetRegistry::Intern( const std::string_view uri )
+{
+    if ( const uint32_t uriIndex = FindUri( uri ); uriIndex != UINT32_MAX )
+    {
+        return uriIndex;
+    }
+
+    const auto uriIndex = static_cast<uint32_t>( m_uris.Size );
+    m_uris.Owned.push_back( AssetRegistryUri{ HashUri( uri ), static_cast<uint32_t>( m_uriData.Size ), static_cast<uint32_t>( uri.size( ) ) } );
+    m_uriData.Owned.insert( m_uriData.Owned.end( ), uri.begin( ), uri.end( ) );
+    Sync( m_uris );
+    Sync( m_uriData );
+
+    if ( m_uris.Size * 2 > m_internSlots.Size )
+    {
+        m_internSlots.Owned.assign( TableSizeFor( m_uris.Size ), UINT32_MAX );
+        Sync( m_internSlots );
+        for ( uint32_t i = 0; i < m_uris.Size; ++i )
         {
-            for ( const auto &[ handleId, entry ] : m_animationRegistry[ batchId ] )
+            const size_t mask = m_internSlots.Size - 1;
+            size_t       slot = m_uris.Data[ i ].Hash & mask;
+            while ( m_internSlots.Owned[ slot ] != UINT32_MAX )
             {
-                spdlog::info( "  Animation {}: {}", handleId, entry.Uri );
+                slot = ( slot + 1 ) & mask;
             }
+            m_internSlots.Owned[ slot ] = i;
         }
+        return uriIndex;
+    }
+
+    const size_t mask = m_internSlots.Size - 1;
+    size_t       slot = m_uris.Data[ uriIndex ].Hash & mask;
+    while ( m_internSlots.Owned[ slot ] != UINT32_MAX )
+    {
+        slot = ( slot + 1 ) & mask;
+    }
+    m_internSlots.Owned[ slot ] = uriIndex;
+    return uriIndex;
+}
 
-        if ( m_skeletonRegistry.contains( batchId ) )
+uint32_t AssetRegistry::FindUri( const std::string_view uri ) const
+{
+    if ( m_internSlots.Size == 0 )
+    {
+        return UINT32_MAX;
+    }
+    const uint64_t hash = HashUri( uri );
+    const size_t   mask = m_internSlots.Size - 1;
+    for ( size_t slot = hash & mask;; slot = ( slot + 1 ) & mask )
+    {
+        const uint32_t uriIndex = m_internSlots.Data[ slot ];
+        if ( uriIndex == UINT32_MAX )
         {
-            for ( const auto &[ handleId, entry ] : m_skeletonRegistry[ batchId ] )
-            {
-                spdlog::info( "  Skeleton {}: {}", handleId, entry.Uri );
-            }
+            return UINT32_MAX;
+        }
+        if ( m_uris.Data[ uriIndex ].Hash == hash && UriAt( uriIndex ) == uri )
+        {
+            return uriIndex;
         }
     }
 }
 
-const std::filesystem::path &AssetRegistry::GetRegistryPath( ) const
+std::string_view AssetRegistry::UriAt( const uint32_t uriIndex ) const
 {
-    return m_registryPath;
+    const AssetRegistryUri &uri = m_uris.Data[ uriIndex ];
+    return { m_uriData.Data + uri.Offset, uri.NumBytes };
 }
 
-void AssetRegistry::SetRegistryPath( const std::filesystem::path &path )
+uint32_t AssetRegistry::FindSlot( const AssetRegistrySlotTable &table, const AssetRegistryType type, const size_t batchId, const uint32_t key )
 {
-    m_registryPath = path;
+    if ( table.Slots.Size == 0 )
+    {
+        return UINT32_MAX;
+    }
+    const size_t mask = table.Slots.Size - 1;
+    for ( size_t i = HashSlotKey( type, batchId, key ) & mask;; i = ( i + 1 ) & mask )
+    {
+        const AssetRegistrySlot &slot = table.Slots.Data[ i ];
+        if ( slot.Value == AssetRegistrySlot::Empty )
+        {
+            return UINT32_MAX;
+        }
+        if ( slot.Value != AssetRegistrySlot::Removed && slot.Key == key && slot.BatchId == batchId && slot.Type == type )
+        {
+            return static_cast<uint32_t>( i );
+        }
+    }
+}
+
+void AssetRegistry::SetSlot( AssetRegistrySlotTable &table, const AssetRegistryType type, const size_t batchId, const uint32_t key, const uint32_t value )
+{
+    if ( const uint32_t slot = FindSlot( table, type, batchId, key ); slot != UINT32_MAX )
+    {
+        table.Slots.Owned[ slot ].Value = value;
+        return;
+    }
+    if ( ( table.NumUsed + 1 ) * 2 > table.Slots.Size )
+    {
+        Rehash( table, TableSizeFor( table.NumEntries + 1 ) );
+    }
+
+    const size_t mask = table.Slots.Size - 1;
+    size_t       i    = HashSlotKey( type, batchId, key ) & mask;
+    while ( table.Slots.Owned[ i ].Value != AssetRegistrySlot::Empty && table.Slots.Owned[ i ].Value != AssetRegistrySlot::Removed )
+    {
+        i = ( i + 1 ) & mask;
+    }
+    table.NumUsed += table.Slots.Owned[ i ].Value == AssetRegistrySlot::Empty;
+    table.Slots.Owned[ i ] = AssetRegistrySlot{ batchId, type, key, value, 0 };
+    ++table.NumEntries;
+}
+
+void AssetRegistry::RemoveSlot( AssetRegistrySlotTable &table, const uint32_t slot )
+{
+    table.Slots.Owned[ slot ].Value = AssetRegistrySlot::Removed;
+    --table.NumEntries;
+}
+
+void AssetRegistry::Rehash( AssetRegistrySlotTable &table, const size_t numSlots )
+{
+    std::vector<AssetRegistrySlot> slots( numSlots, AssetRegistrySlot{ 0, AssetRegistryType::Mesh, 0, AssetRegistrySlot::Empty, 0 } );
+    const size_t                   mask = numSlots - 1;
+    for ( const AssetRegistrySlot &slot : table.Slots.Owned )
+    {
+        if ( slot.Value == AssetRegistrySlot::Empty || slot.Value == AssetRegistrySlot::Removed )
+        {
+            continue;
+        }
+        size_t i = HashSlotKey( slot.Type, slot.BatchId, slot.Key ) & mask;
+        while ( slots[ i ].Value != AssetRegistrySlot::Empty )
+        {
+            i = ( i + 1 ) & mask;
+        }
+        slots[ i ] = slot;
+    }
+    table.Slots.Owned = std::move( slots );
+    table.NumUsed     = table.NumEntries;
+    Sync( table.Slots );
 }
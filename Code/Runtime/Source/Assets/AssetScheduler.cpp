@@ -0,0 +1,203 @@
+/*
+Den Of Iz - Game/Game Engine
+Copyright (c) 2020-2024 Muhammed Murat Cengiz
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "DZEngine/Assets/AssetScheduler.h"
+
+#include <algorithm>
+#include <numeric>
+#include <spdlog/spdlog.h>
+
+using namespace DZEngine;
+
+AssetScheduler::AssetScheduler( const AssetSchedulerDesc &desc ) :
+    m_clock( desc.Clock ), m_bytesPerFrame( desc.BytesPerFrame ), m_maxInFlightBytes( desc.MaxInFlightBytes ), m_maxRequestsPerFrame( std::max( 1u, desc.MaxRequestsPerFrame ) ),
+    m_urgency( std::chrono::duration_cast<AssetSchedulerClock::duration>( std::chrono::duration<double>( desc.UrgencySeconds ) ) ), m_agingPerSecond( desc.AgingPerSecond )
+{
+    if ( !m_clock )
+    {
+        m_clock = [] { return AssetSchedulerClock::now( ); };
+    }
+}
+
+void AssetScheduler::Push( const uint32_t id, const size_t numBytes, const AssetSchedule &schedule )
+{
+    if ( m_queuedIndices.contains( id ) || m_inFlight.contains( id ) )
+    {
+        spdlog::error( "AssetScheduler: Request {} is already scheduled", id );
+        return;
+    }
+    m_queuedIndices[ id ] = m_queued.size( );
+    m_queued.push_back( Entry{ id, numBytes, schedule, m_nextSequence++, Now( ) } );
+    ++m_stats.NumQueued;
+}
+
+bool AssetScheduler::Cancel( const uint32_t id )
+{
+    const auto index = m_queuedIndices.find( id );
+    if ( index == m_queuedIndices.end( ) )
+    {
+        return false;
+    }
+    Remove( index->second );
+    ++m_stats.NumCancelled;
+    return true;
+}
+
+bool AssetScheduler::Reschedule( const uint32_t id, const AssetSchedule &schedule )
+{
+    const auto index = m_queuedIndices.find( id );
+    if ( index == m_queuedIndices.end( ) )
+    {
+        return false;
+    }
+    // Keeps its place among equals and the time it has already waited
+    m_queued[ index->second ].Schedule = schedule;
+    return true;
+}
+
+std::vector<uint32_t> AssetScheduler::Schedule( const std::function<bool( uint32_t id )> &canDispatch )
+{
+    std::vector<uint32_t> dispatched;
+    if ( m_queued.empty( ) )
+    {
+        return dispatched;
+    }
+
+    // Aging and urgency change with time so the order is recomputed every frame
+    const auto          now = Now( );
+    std::vector<size_t> order( m_queued.size( ) );
+    std::iota( order.begin( ), order.end( ), 0 );
+    std::ranges::sort( order, [ & ]( const size_t a, const size_t b ) { return Precedes( m_queued[ a ], m_queued[ b ], now ); } );
+
+    size_t frameBytes = 0;
+    for ( const size_t index : order )
+    {
+        const Entry &entry = m_queued[ index ];
+        // Budgets stop the frame instead of letting smaller, less important requests overtake, a request larger than a budget goes alone
+        if ( dispatched.size( ) >= m_maxRequestsPerFrame )
+        {
+            break;
+        }
+        if ( frameBytes > 0 && frameBytes + entry.NumBytes > m_bytesPerFrame )
+        {
+            break;
+        }
+        if ( m_stats.InFlightBytes > 0 && m_stats.InFlightBytes + entry.NumBytes > m_maxInFlightBytes )
+        {
+            break;
+        }
+        if ( canDispatch && !canDispatch( entry.Id ) )
+        {
+            continue;
+        }
+
+        frameBytes += entry.NumBytes;
+        m_stats.InFlightBytes += entry.NumBytes;
+        m_inFlight[ entry.Id ] = entry.NumBytes;
+        ++m_stats.NumDispatched;
+        if ( entry.Schedule.Deadline != AssetSchedulerClock::time_point{ } && now > entry.Schedule.Deadline )
+        {
+            ++m_stats.NumMissedDeadlines;
+        }
+        dispatched.push_back( entry.Id );
+    }
+
+    for ( const uint32_t id : dispatched )
+    {
+        Remove( m_queuedIndices.at( id ) );
+    }
+    m_stats.NumInFlight = m_inFlight.size( );
+    return dispatched;
+}
+
+void AssetScheduler::Complete( const uint32_t id )
+{
+    const auto inFlight = m_inFlight.find( id );
+    if ( inFlight == m_inFlight.end( ) )
+    {
+        return;
+    }
+    m_stats.InFlightBytes -= inFlight->second;
+    m_inFlight.erase( inFlight );
+    m_stats.NumInFlight = m_inFlight.size( );
+}
+
+bool AssetScheduler::IsQueued( const uint32_t id ) const
+{
+    return m_queuedIndices.contains( id );
+}
+
+AssetSchedulerStats AssetScheduler::GetStats( ) const
+{
+    return m_stats;
+}
+
+AssetSchedulerClock::time_point AssetScheduler::Now( ) const
+{
+    return m_clock( );
+}
+
+void AssetScheduler::Remove( const size_t index )
+{
+    m_queuedIndices.erase( m_queued[ index ].Id );
+    if ( index != m_queued.size( ) - 1 )
+    {
+        m_queued[ index ]                       = m_queued.back( );
+        m_queuedIndices[ m_queued[ index ].Id ] = index;
+    }
+    m_queued.pop_back( );
+    --m_stats.NumQueued;
+}
+
+bool AssetScheduler::Precedes( const Entry &a, const Entry &b, const AssetSchedulerClock::time_point now ) const
+{
+    const bool urgentA = IsUrgent( a, now );
+    if ( const bool urgentB = IsUrgent( b, now ); urgentA != urgentB )
+    {
+        return urgentA;
+    }
+    if ( urgentA && a.Schedule.Deadline != b.Schedule.Deadline )
+    {
+        return a.Schedule.Deadline < b.Schedule.Deadline;
+    }
+
+    const auto agedPriority = [ & ]( const Entry &entry )
+    { return entry.Schedule.Priority + m_agingPerSecond * std::chrono::duration<float>( now - entry.QueueTime ).count( ); };
+    const float priorityA = agedPriority( a );
+    if ( const float priorityB = agedPriority( b ); priorityA != priorityB )
+    {
+        return priorityA > priorityB;
+    }
+
+    constexpr AssetSchedulerClock::time_point noDeadline{ };
+    const bool                                hasDeadlineA = a.Schedule.Deadline != noDeadline;
+    if ( const bool hasDeadlineB = b.Schedule.Deadline != noDeadline; hasDeadlineA != hasDeadlineB )
+    {
+        return hasDeadlineA;
+    }
+    if ( hasDeadlineA && a.Schedule.Deadline != b.Schedule.Deadline )
+    {
+        return a.Schedule.Deadline < b.Schedule.Deadline;
+    }
+    return a.Sequence < b.Sequence;
+}
+
+bool AssetScheduler::IsUrgent( const Entry &entry, const AssetSchedulerClock::time_point now ) const
+{
+    return entry.Schedule.Deadline != AssetSchedulerClock::time_point{ } && entry.Schedule.Deadline - now <= m_urgency;
+}
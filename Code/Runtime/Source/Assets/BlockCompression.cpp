@@ -0,0 +1,259 @@
+/*
+Den Of Iz - Game/Game Engine
+Copyright (c) 2020-2024 Muhammed Murat Cengiz
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "DZEngine/Assets/BlockCompression.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <lz4.h>
+#include <lz4hc.h>
+#include <memory>
+#include <spdlog/spdlog.h>
+#include <taskflow/algorithm/for_each.hpp>
+#include <taskflow/taskflow.hpp>
+#include <zstd.h>
+
+using namespace DZEngine;
+
+namespace
+{
+    struct ZstdContextDeleter
+    {
+        void operator( )( ZSTD_DCtx *context ) const
+        {
+            ZSTD_freeDCtx( context );
+        }
+    };
+
+    template <typename Fn>
+    void ForEachChunk( tf::Executor *executor, const uint32_t numChunks, Fn &&fn )
+    {
+        if ( !executor || numChunks < 2 )
+        {
+            for ( uint32_t chunk = 0; chunk < numChunks; ++chunk )
+            {
+                fn( chunk );
+            }
+            return;
+        }
+
+        tf::Taskflow taskflow;
+        taskflow.for_each_index( 0u, numChunks, 1u, [ &fn ]( const uint32_t chunk ) { fn( chunk ); } );
+        if ( executor->this_worker_id( ) >= 0 )
+        {
+            executor->corun( taskflow ); // Blocking a worker on run( ).wait( ) could deadlock once every worker decompresses
+        }
+        else
+        {
+            executor->run( taskflow ).wait( );
+        }
+    }
+
+    size_t CompressBound( const BlockCompressionCodec codec, const size_t numBytes )
+    {
+        switch ( codec )
+        {
+        case BlockCompressionCodec::LZ4:
+            return static_cast<size_t>( LZ4_compressBound( static_cast<int>( numBytes ) ) );
+        case BlockCompressionCodec::Zstd:
+            return ZSTD_compressBound( numBytes );
+        default:
+            return 0;
+        }
+    }
+
+    // Returns the compressed size, 0 when the chunk should be stored raw
+    size_t CompressChunk( const BlockCompressionDesc &desc, const Byte *src, const size_t numBytes, Byte *dst, const size_t dstCapacity )
+    {
+        size_t compressedNumBytes = 0;
+        switch ( desc.Codec )
+        {
+        case BlockCompressionCodec::LZ4:
+            {
+                const auto *source      = reinterpret_cast<const char *>( src );
+                auto       *destination = reinterpret_cast<char *>( dst );
+                const int   result      = desc.Level > 0 ? LZ4_compress_HC( source, destination, static_cast<int>( numBytes ), static_cast<int>( dstCapacity ), desc.Level )
+                                                         : LZ4_compress_default( source, destination, static_cast<int>( numBytes ), static_cast<int>( dstCapacity ) );
+                compressedNumBytes = result > 0 ? static_cast<size_t>( result ) : 0;
+                break;
+            }
+        case BlockCompressionCodec::Zstd:
+            {
+                const size_t result = ZSTD_compress( dst, dstCapacity, src, numBytes, desc.Level );
+                compressedNumBytes  = ZSTD_isError( result ) ? 0 : result;
+                break;
+            }
+        default:
+            break;
+        }
+        return compressedNumBytes < numBytes ? compressedNumBytes : 0;
+    }
+
+    bool DecompressChunk( const BlockCompressionCodec codec, const Byte *src, const size_t numBytes, Byte *dst, const size_t dstNumBytes )
+    {
+        switch ( codec )
+        {
+        case BlockCompressionCodec::LZ4:
+            {
+                const int result = LZ4_decompress_safe( reinterpret_cast<const char *>( src ), reinterpret_cast<char *>( dst ), static_cast<int>( numBytes ),
+                                                        static_cast<int>( dstNumBytes ) );
+                return result >= 0 && static_cast<size_t>( result ) == dstNumBytes;
+            }
+        case BlockCompressionCodec::Zstd:
+            {
+                thread_local std::unique_ptr<ZSTD_DCtx, ZstdContextDeleter> context( ZSTD_createDCtx( ) );
+                const size_t result = ZSTD_decompressDCtx( context.get( ), dst, dstNumBytes, src, numBytes );
+                return !ZSTD_isError( result ) && result == dstNumBytes;
+            }
+        default:
+            return false;
+        }
+    }
+
+    uint32_t NumChunks( const uint64_t numBytes, const uint32_t chunkSize )
+    {
+        return static_cast<uint32_t>( ( numBytes + chunkSize - 1 ) / chunkSize );
+    }
+
+    const BlockCompressionHeader *ValidHeader( const Byte *block, const size_t blockNumBytes )
+    {
+        if ( !block || blockNumBytes < sizeof( BlockCompressionHeader ) )
+        {
+            return nullptr;
+        }
+        const auto *header = reinterpret_cast<const BlockCompressionHeader *>( block );
+        if ( header->FileMagic != BlockCompressionHeader::Magic || header->ChunkSize == 0 || header->NumChunks != NumChunks( header->NumBytes, header->ChunkSize ) ||
+             sizeof( BlockCompressionHeader ) + header->NumChunks * sizeof( uint32_t ) > blockNumBytes )
+        {
+            return nullptr;
+        }
+        return header;
+    }
+} // namespace
+
+std::vector<Byte> BlockCompression::Compress( const Byte *data, const size_t numBytes, const BlockCompressionDesc &desc )
+{
+    if ( desc.ChunkSize == 0 )
+    {
+        spdlog::error( "BlockCompression: ChunkSize must not be 0" );
+        return { };
+    }
+
+    const uint32_t                 numChunks = NumChunks( numBytes, desc.ChunkSize );
+    std::vector<std::vector<Byte>> chunks( numChunks ); // Empty when stored raw
+    ForEachChunk( desc.Executor, numChunks,
+                  [ & ]( const uint32_t chunk )
+                  {
+                      const size_t       offset        = static_cast<size_t>( chunk ) * desc.ChunkSize;
+                      const size_t       chunkNumBytes = std::min<size_t>( desc.ChunkSize, numBytes - offset );
+                      std::vector<Byte> &compressed    = chunks[ chunk ];
+                      compressed.resize( CompressBound( desc.Codec, chunkNumBytes ) );
+                      compressed.resize( CompressChunk( desc, data + offset, chunkNumBytes, compressed.data( ), compressed.size( ) ) );
+                  } );
+
+    BlockCompressionHeader header{ };
+    header.FileMagic = BlockCompressionHeader::Magic;
+    header.Codec     = desc.Codec;
+    header.ChunkSize = desc.ChunkSize;
+    header.NumChunks = numChunks;
+    header.NumBytes  = numBytes;
+
+    std::vector<uint32_t> chunkNumBytes( numChunks );
+    size_t                blockNumBytes = sizeof( BlockCompressionHeader ) + numChunks * sizeof( uint32_t );
+    for ( uint32_t chunk = 0; chunk < numChunks; ++chunk )
+    {
+        const size_t offset    = static_cast<size_t>( chunk ) * desc.ChunkSize;
+        chunkNumBytes[ chunk ] = static_cast<uint32_t>( chunks[ chunk ].empty( ) ? std::min<size_t>( desc.ChunkSize, numBytes - offset ) : chunks[ chunk ].size( ) );
+        blockNumBytes += chunkNumBytes[ chunk ];
+    }
+
+    std::vector<Byte> block( blockNumBytes );
+    Byte             *dst = block.data( );
+    std::memcpy( dst, &header, sizeof( header ) );
+    dst += sizeof( header );
+    std::memcpy( dst, chunkNumBytes.data( ), chunkNumBytes.size( ) * sizeof( uint32_t ) );
+    dst += chunkNumBytes.size( ) * sizeof( uint32_t );
+    for ( uint32_t chunk = 0; chunk < numChunks; ++chunk )
+    {
+        const Byte *src = chunks[ chunk ].empty( ) ? data + static_cast<size_t>( chunk ) * desc.ChunkSize : chunks[ chunk ].data( );
+        std::memcpy( dst, src, chunkNumBytes[ chunk ] );
+        dst += chunkNumBytes[ chunk ];
+    }
+    return block;
+}
+
+bool BlockCompression::IsCompressed( const Byte *block, const size_t blockNumBytes )
+{
+    return ValidHeader( block, blockNumBytes ) != nullptr;
+}
+
+size_t BlockCompression::GetNumBytes( const Byte *block, const size_t blockNumBytes )
+{
+    const BlockCompressionHeader *header = ValidHeader( block, blockNumBytes );
+    return header ? static_cast<size_t>( header->NumBytes ) : 0;
+}
+
+bool BlockCompression::Decompress( const Byte *block, const size_t blockNumBytes, Byte *dst, const size_t dstNumBytes, tf::Executor *executor )
+{
+    const BlockCompressionHeader *header = ValidHeader( block, blockNumBytes );
+    if ( !header || header->NumBytes != dstNumBytes )
+    {
+        spdlog::error( "BlockCompression: Invalid block or destination size" );
+        return false;
+    }
+
+    // Prefix sum of the chunk sizes, also validates that every chunk is inside the block
+    const auto         *chunkNumBytes = reinterpret_cast<const uint32_t *>( block + sizeof( BlockCompressionHeader ) );
+    std::vector<size_t> chunkOffsets( header->NumChunks );
+    size_t              offset = sizeof( BlockCompressionHeader ) + header->NumChunks * sizeof( uint32_t );
+    for ( uint32_t chunk = 0; chunk < header->NumChunks; ++chunk )
+    {
+        chunkOffsets[ chunk ] = offset;
+        offset += chunkNumBytes[ chunk ];
+    }
+    if ( offset > blockNumBytes )
+    {
+        spdlog::error( "BlockCompression: Block is truncated" );
+        return false;
+    }
+
+    std::atomic<bool> failed = false;
+    ForEachChunk( executor, header->NumChunks,
+                  [ & ]( const uint32_t chunk )
+                  {
+                      const size_t dstOffset     = static_cast<size_t>( chunk ) * header->ChunkSize;
+                      const size_t dstChunkBytes = std::min<size_t>( header->ChunkSize, dstNumBytes - dstOffset );
+                      const Byte  *src           = block + chunkOffsets[ chunk ];
+                      if ( chunkNumBytes[ chunk ] == dstChunkBytes )
+                      {
+                          std::memcpy( dst + dstOffset, src, dstChunkBytes );
+                      }
+                      else if ( !DecompressChunk( header->Codec, src, chunkNumBytes[ chunk ], dst + dstOffset, dstChunkBytes ) )
+                      {
+                          failed.store( true, std::memory_order_relaxed );
+                      }
+                  } );
+
+    if ( failed.load( std::memory_order_relaxed ) )
+    {
+        spdlog::error( "BlockCompression: Failed to decompress a chunk" );
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,221 @@
+/*
+Den Of Iz - Game/Game Engine
+Copyright (c) 2020-2024 Muhammed Murat Cengiz
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "DZEngine/Assets/ContentHash.h"
+#include <algorithm>
+#include <bit>
+#include <cstring>
+
+using namespace DZEngine;
+
+namespace
+{
+    // XXH64, see https://github.com/Cyan4973/xxHash/blob/dev/doc/xxhash_spec.md
+    constexpr uint64_t Prime1 = 0x9E3779B185EBCA87ull;
+    constexpr uint64_t Prime2 = 0xC2B2AE3D27D4EB4Full;
+    constexpr uint64_t Prime3 = 0x165667B19E3779F9ull;
+    constexpr uint64_t Prime4 = 0x85EBCA77C2B2AE63ull;
+    constexpr uint64_t Prime5 = 0x27D4EB2F165667C5ull;
+
+    constexpr uint64_t LowSeed  = 0;
+    constexpr uint64_t HighSeed = 0x6A09E667F3BCC908ull;
+
+    uint64_t Read64( const Byte *data )
+    {
+        uint64_t value;
+        std::memcpy( &value, data, sizeof( value ) );
+        return value;
+    }
+
+    uint32_t Read32( const Byte *data )
+    {
+        uint32_t value;
+        std::memcpy( &value, data, sizeof( value ) );
+        return value;
+    }
+
+    uint64_t Round( uint64_t lane, const uint64_t input )
+    {
+        lane += input * Prime2;
+        lane = std::rotl( lane, 31 );
+        return lane * Prime1;
+    }
+
+    uint64_t MergeRound( uint64_t hash, const uint64_t lane )
+    {
+        hash ^= Round( 0, lane );
+        return hash * Prime1 + Prime4;
+    }
+
+    uint64_t Finalize( const uint64_t lanes[ 4 ], const uint64_t seed, const uint64_t numBytes, const Byte *tail, const size_t tailNumBytes )
+    {
+        uint64_t hash;
+        if ( numBytes >= 32 )
+        {
+            hash = std::rotl( lanes[ 0 ], 1 ) + std::rotl( lanes[ 1 ], 7 ) + std::rotl( lanes[ 2 ], 12 ) + std::rotl( lanes[ 3 ], 18 );
+            for ( int i = 0; i < 4; ++i )
+            {
+                hash = MergeRound( hash, lanes[ i ] );
+            }
+        }
+        else
+        {
+            hash = seed + Prime5;
+        }
+        hash += numBytes;
+
+        size_t offset = 0;
+        for ( ; offset + 8 <= tailNumBytes; offset += 8 )
+        {
+            hash ^= Round( 0, Read64( tail + offset ) );
+            hash = std::rotl( hash, 27 ) * Prime1 + Prime4;
+        }
+        if ( offset + 4 <= tailNumBytes )
+        {
+            hash ^= static_cast<uint64_t>( Read32( tail + offset ) ) * Prime1;
+            hash = std::rotl( hash, 23 ) * Prime2 + Prime3;
+            offset += 4;
+        }
+        for ( ; offset < tailNumBytes; ++offset )
+        {
+            hash ^= static_cast<uint64_t>( tail[ offset ] ) * Prime5;
+            hash = std::rotl( hash, 11 ) * Prime1;
+        }
+
+        hash ^= hash >> 33;
+        hash *= Prime2;
+        hash ^= hash >> 29;
+        hash *= Prime3;
+        hash ^= hash >> 32;
+        return hash;
+    }
+
+    constexpr char HexDigits[] = "0123456789abcdef";
+} // namespace
+
+std::string ContentHash::ToString( ) const
+{
+    std::string hex( 32, '0' );
+    for ( int i = 0; i < 16; ++i )
+    {
+        const uint64_t word = i < 8 ? High : Low;
+        const int      byte = static_cast<int>( ( word >> ( ( 7 - i % 8 ) * 8 ) ) & 0xFF );
+        hex[ i * 2 ]        = HexDigits[ byte >> 4 ];
+        hex[ i * 2 + 1 ]    = HexDigits[ byte & 0xF ];
+    }
+    return hex;
+}
+
+bool ContentHash::FromString( const std::string_view hex, ContentHash &outHash )
+{
+    if ( hex.size( ) != 32 )
+    {
+        return false;
+    }
+    ContentHash hash{ };
+    for ( size_t i = 0; i < hex.size( ); ++i )
+    {
+        const char c = hex[ i ];
+        uint64_t   digit;
+        if ( c >= '0' && c <= '9' )
+        {
+            digit = c - '0';
+        }
+        else if ( c >= 'a' && c <= 'f' )
+        {
+            digit = c - 'a' + 10;
+        }
+        else
+        {
+            return false;
+        }
+        uint64_t &word = i < 16 ? hash.High : hash.Low;
+        word           = word << 4 | digit;
+    }
+    outHash = hash;
+    return true;
+}
+
+ContentHash ContentHash::Of( const Byte *data, const size_t numBytes )
+{
+    ContentHasher hasher;
+    hasher.Update( data, numBytes );
+    return hasher.Finish( );
+}
+
+ContentHasher::ContentHasher( )
+{
+    for ( Stream &stream : m_streams )
+    {
+        stream.Seed       = &stream == &m_streams[ 0 ] ? LowSeed : HighSeed;
+        stream.Lanes[ 0 ] = stream.Seed + Prime1 + Prime2;
+        stream.Lanes[ 1 ] = stream.Seed + Prime2;
+        stream.Lanes[ 2 ] = stream.Seed;
+        stream.Lanes[ 3 ] = stream.Seed - Prime1;
+    }
+}
+
+void ContentHasher::Update( const Byte *data, size_t numBytes )
+{
+    m_numBytes += numBytes;
+    if ( m_bufferNumBytes > 0 )
+    {
+        const size_t numCopied = std::min( numBytes, sizeof( m_buffer ) - m_bufferNumBytes );
+        std::memcpy( m_buffer + m_bufferNumBytes, data, numCopied );
+        m_bufferNumBytes += numCopied;
+        data += numCopied;
+        numBytes -= numCopied;
+        if ( m_bufferNumBytes < sizeof( m_buffer ) )
+        {
+            return;
+        }
+        Consume( m_buffer );
+        m_bufferNumBytes = 0;
+    }
+    for ( ; numBytes >= sizeof( m_buffer ); data += sizeof( m_buffer ), numBytes -= sizeof( m_buffer ) )
+    {
+        Consume( data );
+    }
+    std::memcpy( m_buffer, data, numBytes );
+    m_bufferNumBytes = numBytes;
+}
+
+void ContentHasher::Update( const std::string_view text )
+{
+    UpdateValue( static_cast<uint64_t>( text.size( ) ) );
+    Update( reinterpret_cast<const Byte *>( text.data( ) ), text.size( ) );
+}
+
+ContentHash ContentHasher::Finish( ) const
+{
+    ContentHash hash{ };
+    hash.Low  = Finalize( m_streams[ 0 ].Lanes, m_streams[ 0 ].Seed, m_numBytes, m_buffer, m_bufferNumBytes );
+    hash.High = Finalize( m_streams[ 1 ].Lanes, m_streams[ 1 ].Seed, m_numBytes, m_buffer, m_bufferNumBytes );
+    return hash;
+}
+
+void ContentHasher::Consume( const Byte *stripe )
+{
+    for ( Stream &stream : m_streams )
+    {
+        for ( int i = 0; i < 4; ++i )
+        {
+            stream.Lanes[ i ] = Round( stream.Lanes[ i ], Read64( stripe + i * 8 ) );
+        }
+    }
+}
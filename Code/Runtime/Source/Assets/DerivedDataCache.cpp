@@ -0,0 +1,369 @@
+/*
+Den Of Iz - Game/Game Engine
+Copyright (c) 2020-2024 Muhammed Murat Cengiz
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "DZEngine/Assets/DerivedDataCache.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <spdlog/spdlog.h>
+#include <thread>
+
+using namespace DZEngine;
+
+namespace
+{
+    constexpr auto TemporaryExtension = ".tmp";
+    constexpr auto StaleTemporaryAge  = std::chrono::hours( 1 ); // Left behind by crashed writers, younger ones may still be written
+
+    std::filesystem::path TemporaryPath( const std::filesystem::path &path )
+    {
+        static std::atomic<uint64_t> counter = 0;
+        const size_t                 thread  = std::hash<std::thread::id>{ }( std::this_thread::get_id( ) );
+        const auto                   time    = static_cast<uint64_t>( std::chrono::steady_clock::now( ).time_since_epoch( ).count( ) );
+        // Unique across threads and, with high probability, across processes and machines writing the same shared directory
+        return path.string( ) + fmt::format( ".{:x}{:x}{:x}{}", thread, time, counter.fetch_add( 1, std::memory_order_relaxed ), TemporaryExtension );
+    }
+} // namespace
+
+DerivedDataCache::DerivedDataCache( const DerivedDataCacheDesc &desc ) :
+    m_directory( desc.Directory ), m_sharedDirectory( desc.SharedDirectory ), m_maxNumBytes( desc.MaxNumBytes ), m_trimRatio( std::clamp( desc.TrimRatio, 0.0, 1.0 ) )
+{
+    static_assert( sizeof( Header ) == 48, "Entry header layout is part of the file format" );
+
+    std::error_code error;
+    std::filesystem::create_directories( m_directory, error );
+    if ( error )
+    {
+        spdlog::error( "DerivedDataCache: Failed to create {}: {}", m_directory.string( ), error.message( ) );
+        return;
+    }
+    if ( !m_sharedDirectory.empty( ) )
+    {
+        std::filesystem::create_directories( m_sharedDirectory, error );
+        if ( error )
+        {
+            spdlog::warn( "DerivedDataCache: Shared directory {} is unavailable, using the local store only: {}", m_sharedDirectory.string( ), error.message( ) );
+            m_sharedDirectory.clear( );
+        }
+    }
+
+    Scan( );
+    m_valid = true;
+    spdlog::info( "DerivedDataCache: Opened {} with {} entries, {:.1f} MiB", m_directory.string( ), m_entries.size( ), m_numBytes / ( 1024.0 * 1024.0 ) );
+    if ( m_maxNumBytes != 0 && m_numBytes > m_maxNumBytes )
+    {
+        Trim( static_cast<size_t>( m_maxNumBytes * m_trimRatio ) );
+    }
+}
+
+ContentHash DerivedDataCache::MakeKey( const std::string_view processor, const uint32_t processorVersion, const ContentHash &source, const std::span<const Byte> parameters )
+{
+    ContentHasher hasher;
+    hasher.Update( processor );
+    hasher.UpdateValue( processorVersion );
+    hasher.UpdateValue( source.High );
+    hasher.UpdateValue( source.Low );
+    hasher.UpdateValue( static_cast<uint64_t>( parameters.size( ) ) );
+    hasher.Update( parameters.data( ), parameters.size( ) );
+    return hasher.Finish( );
+}
+
+bool DerivedDataCache::IsValid( ) const
+{
+    return m_valid;
+}
+
+bool DerivedDataCache::Get( const ContentHash &key, std::vector<Byte> &outData )
+{
+    if ( !m_valid )
+    {
+        return false;
+    }
+
+    const std::filesystem::path path      = EntryPath( m_directory, key );
+    bool                        corrupted = false;
+    if ( ReadEntry( path, key, outData, corrupted ) )
+    {
+        std::error_code error;
+        const auto      now = std::filesystem::file_time_type::clock::now( );
+        std::filesystem::last_write_time( path, now, error ); // Best effort, orders the next Scan
+
+        std::lock_guard lock( m_lock );
+        if ( const auto entry = m_entries.find( key ); entry != m_entries.end( ) )
+        {
+            entry->second.LastUse = now;
+        }
+        else // Written by another process since Scan
+        {
+            const size_t numBytes = sizeof( Header ) + outData.size( );
+            m_entries.emplace( key, Entry{ numBytes, now } );
+            m_numBytes += numBytes;
+        }
+        ++m_stats.NumLocalHits;
+        m_stats.NumBytesRead += outData.size( );
+        return true;
+    }
+    if ( corrupted )
+    {
+        spdlog::warn( "DerivedDataCache: Removing corrupted entry {}", path.string( ) );
+        std::error_code error;
+        std::filesystem::remove( path, error );
+
+        std::lock_guard lock( m_lock );
+        if ( const auto entry = m_entries.find( key ); entry != m_entries.end( ) )
+        {
+            m_numBytes -= entry->second.NumBytes;
+            m_entries.erase( entry );
+        }
+        ++m_stats.NumCorrupted;
+    }
+
+    if ( !m_sharedDirectory.empty( ) )
+    {
+        const std::filesystem::path sharedPath = EntryPath( m_sharedDirectory, key );
+        if ( ReadEntry( sharedPath, key, outData, corrupted ) )
+        {
+            if ( WriteEntry( path, key, outData ) )
+            {
+                AddEntry( key, sizeof( Header ) + outData.size( ) );
+            }
+            std::lock_guard lock( m_lock );
+            ++m_stats.NumSharedHits;
+            m_stats.NumBytesRead += outData.size( );
+            return true;
+        }
+        if ( corrupted )
+        {
+            spdlog::warn( "DerivedDataCache: Removing corrupted entry {}", sharedPath.string( ) );
+            std::error_code error;
+            std::filesystem::remove( sharedPath, error );
+
+            std::lock_guard lock( m_lock );
+            ++m_stats.NumCorrupted;
+        }
+    }
+
+    outData.clear( );
+    std::lock_guard lock( m_lock );
+    ++m_stats.NumMisses;
+    return false;
+}
+
+bool DerivedDataCache::Put( const ContentHash &key, const std::span<const Byte> data )
+{
+    if ( !m_valid )
+    {
+        return false;
+    }
+
+    if ( !WriteEntry( EntryPath( m_directory, key ), key, data ) )
+    {
+        return false;
+    }
+    if ( !m_sharedDirectory.empty( ) )
+    {
+        std::error_code error;
+        if ( const std::filesystem::path sharedPath = EntryPath( m_sharedDirectory, key ); !std::filesystem::exists( sharedPath, error ) )
+        {
+            WriteEntry( sharedPath, key, data ); // The local store still has the entry when the share is unreachable
+        }
+    }
+
+    AddEntry( key, sizeof( Header ) + data.size( ) );
+    std::lock_guard lock( m_lock );
+    ++m_stats.NumPuts;
+    m_stats.NumBytesWritten += data.size( );
+    return true;
+}
+
+bool DerivedDataCache::Contains( const ContentHash &key ) const
+{
+    std::lock_guard lock( m_lock );
+    return m_entries.contains( key );
+}
+
+void DerivedDataCache::Trim( const size_t maxNumBytes )
+{
+    std::lock_guard lock( m_lock );
+    TrimLocked( maxNumBytes );
+}
+
+DerivedDataCacheStats DerivedDataCache::GetStats( ) const
+{
+    std::lock_guard       lock( m_lock );
+    DerivedDataCacheStats stats = m_stats;
+    stats.NumEntries            = m_entries.size( );
+    stats.NumBytes              = m_numBytes;
+    return stats;
+}
+
+std::filesystem::path DerivedDataCache::EntryPath( const std::filesystem::path &directory, const ContentHash &key )
+{
+    const std::string name = key.ToString( );
+    return directory / name.substr( 0, 2 ) / name; // Fans out so no directory holds more than a few thousand entries
+}
+
+bool DerivedDataCache::ReadEntry( const std::filesystem::path &path, const ContentHash &key, std::vector<Byte> &outData, bool &outCorrupted )
+{
+    outCorrupted = false;
+    std::ifstream in( path, std::ios::binary | std::ios::ate );
+    if ( !in )
+    {
+        return false;
+    }
+
+    const auto fileNumBytes = static_cast<uint64_t>( in.tellg( ) );
+    in.seekg( 0 );
+    Header header{ };
+    in.read( reinterpret_cast<char *>( &header ), sizeof( header ) );
+    if ( !in || header.FileMagic != Header::Magic || header.FileVersion != Header::Version || header.Key != key || header.NumBytes != fileNumBytes - sizeof( header ) )
+    {
+        outCorrupted = true;
+        return false;
+    }
+
+    outData.resize( header.NumBytes );
+    in.read( reinterpret_cast<char *>( outData.data( ) ), static_cast<std::streamsize>( outData.size( ) ) );
+    if ( !in || ContentHash::Of( outData.data( ), outData.size( ) ) != header.PayloadHash )
+    {
+        outCorrupted = true;
+        return false;
+    }
+    return true;
+}
+
+bool DerivedDataCache::WriteEntry( const std::filesystem::path &path, const ContentHash &key, const std::span<const Byte> data )
+{
+    std::error_code error;
+    std::filesystem::create_directories( path.parent_path( ), error );
+
+    Header header{ };
+    header.FileMagic   = Header::Magic;
+    header.FileVersion = Header::Version;
+    header.NumBytes    = data.size( );
+    header.Key         = key;
+    header.PayloadHash = ContentHash::Of( data.data( ), data.size( ) );
+
+    const std::filesystem::path temporaryPath = TemporaryPath( path );
+    {
+        std::ofstream out( temporaryPath, std::ios::binary | std::ios::trunc );
+        out.write( reinterpret_cast<const char *>( &header ), sizeof( header ) );
+        out.write( reinterpret_cast<const char *>( data.data( ) ), static_cast<std::streamsize>( data.size( ) ) );
+        out.close( );
+        if ( !out )
+        {
+            spdlog::error( "DerivedDataCache: Failed to write {}", temporaryPath.string( ) );
+            std::filesystem::remove( temporaryPath, error );
+            return false;
+        }
+    }
+    // Atomic replace, readers see either no entry or a complete one. Concurrent writers of the same key write the same data.
+    std::filesystem::rename( temporaryPath, path, error );
+    if ( error )
+    {
+        spdlog::error( "DerivedDataCache: Failed to move {} to {}: {}", temporaryPath.string( ), path.string( ), error.message( ) );
+        std::filesystem::remove( temporaryPath, error );
+        return false;
+    }
+    return true;
+}
+
+void DerivedDataCache::Scan( )
+{
+    const auto      now = std::filesystem::file_time_type::clock::now( );
+    std::error_code error;
+    for ( const auto &file : std::filesystem::recursive_directory_iterator( m_directory, error ) )
+    {
+        if ( !file.is_regular_file( error ) )
+        {
+            continue;
+        }
+        const auto lastWrite = file.last_write_time( error );
+        if ( file.path( ).extension( ) == TemporaryExtension )
+        {
+            if ( !error && now - lastWrite > StaleTemporaryAge )
+            {
+                std::filesystem::remove( file.path( ), error );
+            }
+            continue;
+        }
+        ContentHash key;
+        if ( !ContentHash::FromString( file.path( ).filename( ).string( ), key ) )
+        {
+            continue;
+        }
+        const auto numBytes = static_cast<size_t>( file.file_size( error ) );
+        m_entries[ key ]    = Entry{ numBytes, lastWrite };
+        m_numBytes += numBytes;
+    }
+    if ( error )
+    {
+        spdlog::warn( "DerivedDataCache: Failed to scan {} completely: {}", m_directory.string( ), error.message( ) );
+    }
+}
+
+void DerivedDataCache::AddEntry( const ContentHash &key, const size_t numBytes )
+{
+    std::lock_guard lock( m_lock );
+    const auto [ entry, inserted ] = m_entries.try_emplace( key, Entry{ numBytes, std::filesystem::file_time_type::clock::now( ) } );
+    if ( !inserted )
+    {
+        m_numBytes -= entry->second.NumBytes;
+        entry->second = Entry{ numBytes, std::filesystem::file_time_type::clock::now( ) };
+    }
+    m_numBytes += numBytes;
+
+    if ( m_maxNumBytes != 0 && m_numBytes > m_maxNumBytes )
+    {
+        TrimLocked( static_cast<size_t>( m_maxNumBytes * m_trimRatio ) ); // Below the cap, so a full store doesn't trim on every Put
+    }
+}
+
+void DerivedDataCache::TrimLocked( const size_t maxNumBytes )
+{
+    if ( m_numBytes <= maxNumBytes )
+    {
+        return;
+    }
+
+    std::vector<std::pair<std::filesystem::file_time_type, ContentHash>> lastUses;
+    lastUses.reserve( m_entries.size( ) );
+    for ( const auto &[ key, entry ] : m_entries )
+    {
+        lastUses.emplace_back( entry.LastUse, key );
+    }
+    std::ranges::sort( lastUses, { }, &std::pair<std::filesystem::file_time_type, ContentHash>::first );
+
+    size_t numTrimmed = 0;
+    for ( const auto &[ lastUse, key ] : lastUses )
+    {
+        if ( m_numBytes <= maxNumBytes )
+        {
+            break;
+        }
+        std::error_code error;
+        std::filesystem::remove( EntryPath( m_directory, key ), error );
+        const auto entry = m_entries.find( key );
+        m_numBytes -= entry->second.NumBytes;
+        m_entries.erase( entry );
+        ++numTrimmed;
+    }
+    m_stats.NumTrimmed += numTrimmed;
+    spdlog::info( "DerivedDataCache: Trimmed {} entries, {:.1f} MiB left", numTrimmed, m_numBytes / ( 1024.0 * 1024.0 ) );
+}
@@ -0,0 +1,118 @@
+/*
+Den Of Iz - Game/Game Engine
+Copyright (c) 2020-2024 Muhammed Murat Cengiz
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "DZEngine/Assets/FileIO.h"
+#include "DZEngine/Assets/IoUringFileIO.h"
+
+#include <fstream>
+#include <spdlog/spdlog.h>
+#include <taskflow/taskflow.hpp>
+
+using namespace DZEngine;
+
+bool FileReadBatch::IsComplete( ) const
+{
+    return m_numPending.load( std::memory_order_acquire ) == 0;
+}
+
+void FileReadBatch::Wait( ) const
+{
+    for ( uint32_t numPending = m_numPending.load( std::memory_order_acquire ); numPending != 0; numPending = m_numPending.load( std::memory_order_acquire ) )
+    {
+        m_numPending.wait( numPending, std::memory_order_acquire );
+    }
+}
+
+void FileReadBatch::Add( const uint32_t numReads )
+{
+    m_numPending.fetch_add( numReads, std::memory_order_relaxed );
+}
+
+void FileReadBatch::Complete( )
+{
+    if ( m_numPending.fetch_sub( 1, std::memory_order_acq_rel ) == 1 )
+    {
+        m_numPending.notify_all( );
+    }
+}
+
+std::unique_ptr<IFileIO> IFileIO::Create( const FileIODesc &desc )
+{
+#ifdef __linux__
+    if ( desc.Backend != FileIOBackend::ThreadPool )
+    {
+        if ( auto fileIO = std::make_unique<IoUringFileIO>( desc ); fileIO->IsValid( ) )
+        {
+            return fileIO;
+        }
+        spdlog::warn( "FileIO: io_uring is unavailable, falling back to the thread pool" );
+    }
+#else
+    if ( desc.Backend == FileIOBackend::IoUring )
+    {
+        spdlog::warn( "FileIO: io_uring is only available on Linux, falling back to the thread pool" );
+    }
+#endif
+    return std::make_unique<ThreadPoolFileIO>( desc );
+}
+
+ThreadPoolFileIO::ThreadPoolFileIO( const FileIODesc &desc ) : m_executor( desc.Executor )
+{
+}
+
+void ThreadPoolFileIO::Read( const std::span<FileRead> reads, FileReadBatch &batch )
+{
+    batch.Add( static_cast<uint32_t>( reads.size( ) ) );
+    // A worker waiting on reads queued behind it could deadlock the executor, so workers read on their own thread
+    const bool readInline = !m_executor || m_executor->this_worker_id( ) >= 0;
+    for ( FileRead &read : reads )
+    {
+        if ( readInline )
+        {
+            ReadFile( read );
+            batch.Complete( );
+            continue;
+        }
+        m_executor->silent_async(
+            [ &read, &batch ]
+            {
+                ReadFile( read );
+                batch.Complete( );
+            } );
+    }
+}
+
+FileIOBackend ThreadPoolFileIO::GetBackend( ) const
+{
+    return FileIOBackend::ThreadPool;
+}
+
+void ThreadPoolFileIO::ReadFile( FileRead &read )
+{
+    std::ifstream file( read.Path, std::ios::binary );
+    if ( file && read.Offset > 0 )
+    {
+        file.seekg( static_cast<std::streamoff>( read.Offset ) );
+    }
+    if ( file )
+    {
+        file.read( reinterpret_cast<char *>( read.Dst ), static_cast<std::streamsize>( read.NumBytes ) );
+    }
+    read.NumBytesRead = file.is_open( ) ? static_cast<size_t>( std::max<std::streamsize>( file.gcount( ), 0 ) ) : 0;
+    read.Succeeded    = read.NumBytesRead == read.NumBytes;
+}
@@ -0,0 +1,171 @@
+/*
+Den Of Iz - Game/Game Engine
+Copyright (c) 2020-2024 Muhammed Murat Cengiz
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "DZEngine/Assets/FileWatcher.h"
+#include "DZEngine/Assets/InotifyFileWatcher.h"
+
+#include <ranges>
+#include <spdlog/spdlog.h>
+
+using namespace DZEngine;
+
+FileChangeDebouncer::FileChangeDebouncer( const std::chrono::milliseconds debounce ) : m_debounce( debounce )
+{
+}
+
+void FileChangeDebouncer::Add( const std::filesystem::path &path, const FileChangeType type, const std::chrono::steady_clock::time_point now )
+{
+    const auto [ it, inserted ] = m_pending.try_emplace( path.generic_string( ), Pending{ path, type, now } );
+    if ( inserted )
+    {
+        return;
+    }
+
+    Pending &pending  = it->second;
+    pending.LastEvent = now;
+    switch ( type )
+    {
+    case FileChangeType::Removed:
+        if ( pending.Type == FileChangeType::Added )
+        {
+            m_pending.erase( it ); // Temporary file, never seen by the consumer
+            return;
+        }
+        pending.Type = FileChangeType::Removed;
+        break;
+    case FileChangeType::Added:
+    case FileChangeType::Modified:
+        if ( pending.Type == FileChangeType::Removed )
+        {
+            pending.Type = FileChangeType::Modified; // Replaced, e.g. written to a temporary file and renamed over the original
+        }
+        break;
+    }
+}
+
+void FileChangeDebouncer::Collect( const std::chrono::steady_clock::time_point now, std::vector<FileChange> &outChanges )
+{
+    for ( auto it = m_pending.begin( ); it != m_pending.end( ); )
+    {
+        if ( now - it->second.LastEvent < m_debounce )
+        {
+            ++it;
+            continue;
+        }
+        outChanges.push_back( FileChange{ std::move( it->second.Path ), it->second.Type } );
+        it = m_pending.erase( it );
+    }
+}
+
+std::unique_ptr<IFileWatcher> IFileWatcher::Create( const FileWatcherDesc &desc )
+{
+#ifdef __linux__
+    if ( desc.Backend != FileWatcherBackend::Polling )
+    {
+        if ( auto watcher = std::make_unique<InotifyFileWatcher>( desc ); watcher->IsValid( ) )
+        {
+            return watcher;
+        }
+        spdlog::warn( "FileWatcher: inotify is unavailable, falling back to polling" );
+    }
+#else
+    if ( desc.Backend == FileWatcherBackend::Inotify )
+    {
+        spdlog::warn( "FileWatcher: inotify is only available on Linux, falling back to polling" );
+    }
+#endif
+    return std::make_unique<PollingFileWatcher>( desc );
+}
+
+PollingFileWatcher::PollingFileWatcher( const FileWatcherDesc &desc ) :
+    m_debouncer( desc.Debounce ), m_pollInterval( desc.PollInterval ), m_lastScan( std::chrono::steady_clock::now( ) )
+{
+}
+
+bool PollingFileWatcher::Watch( const std::filesystem::path &directory )
+{
+    std::error_code error;
+    if ( !std::filesystem::is_directory( directory, error ) )
+    {
+        spdlog::error( "PollingFileWatcher::Watch - {} is not a directory", directory.string( ) );
+        return false;
+    }
+    m_directories.push_back( directory );
+    Scan( directory, m_writeTimes );
+    return true;
+}
+
+void PollingFileWatcher::Poll( std::vector<FileChange> &outChanges )
+{
+    const auto now = std::chrono::steady_clock::now( );
+    if ( now - m_lastScan >= m_pollInterval )
+    {
+        m_lastScan = now;
+
+        std::unordered_map<std::string, std::filesystem::file_time_type> writeTimes;
+        writeTimes.reserve( m_writeTimes.size( ) );
+        for ( const auto &directory : m_directories )
+        {
+            Scan( directory, writeTimes );
+        }
+        for ( const auto &[ path, writeTime ] : writeTimes )
+        {
+            if ( const auto it = m_writeTimes.find( path ); it == m_writeTimes.end( ) )
+            {
+                m_debouncer.Add( path, FileChangeType::Added, now );
+            }
+            else if ( it->second != writeTime )
+            {
+                m_debouncer.Add( path, FileChangeType::Modified, now );
+            }
+        }
+        for ( const auto &path : m_writeTimes | std::views::keys )
+        {
+            if ( !writeTimes.contains( path ) )
+            {
+                m_debouncer.Add( path, FileChangeType::Removed, now );
+            }
+        }
+        m_writeTimes = std::move( writeTimes );
+    }
+    m_debouncer.Collect( now, outChanges );
+}
+
+FileWatcherBackend PollingFileWatcher::GetBackend( ) const
+{
+    return FileWatcherBackend::Polling;
+}
+
+void PollingFileWatcher::Scan( const std::filesystem::path &directory, std::unordered_map<std::string, std::filesystem::file_time_type> &outWriteTimes ) const
+{
+    // Files can disappear mid iteration, errors skip them instead of throwing
+    std::error_code error;
+    for ( auto it = std::filesystem::recursive_directory_iterator( directory, std::filesystem::directory_options::skip_permission_denied, error );
+          !error && it != std::filesystem::recursive_directory_iterator( ); it.increment( error ) )
+    {
+        if ( !it->is_regular_file( error ) )
+        {
+            continue;
+        }
+        if ( const auto writeTime = it->last_write_time( error ); !error )
+        {
+            outWriteTimes[ it->path( ).generic_string( ) ] = writeTime;
+        }
+        error.clear( );
+    }
+}
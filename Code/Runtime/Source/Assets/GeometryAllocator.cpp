@@ -0,0 +1,237 @@
+/*
+Den Of Iz - Game/Game Engine
+Copyright (c) 2020-2024 Muhammed Murat Cengiz
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "DZEngine/Assets/GeometryAllocator.h"
+#include <algorithm>
+#include <spdlog/spdlog.h>
+
+using namespace DZEngine;
+
+GeometryAllocator::GeometryAllocator( const GeometryAllocatorDesc &desc ) : m_capacity( desc.Capacity )
+{
+    if ( m_capacity > 0 )
+    {
+        InsertFreeBlock( 0, m_capacity );
+    }
+}
+
+GeometryAllocation GeometryAllocator::Allocate( const size_t size )
+{
+    if ( size == 0 )
+    {
+        return GeometryAllocation{ };
+    }
+
+    const auto bestFit = m_freeBySize.lower_bound( size );
+    if ( bestFit == m_freeBySize.end( ) )
+    {
+        return GeometryAllocation{ };
+    }
+
+    const size_t blockOffset = bestFit->second;
+    const size_t blockSize   = bestFit->first;
+    EraseFreeBlock( m_freeBlocks.find( blockOffset ) );
+    if ( blockSize > size )
+    {
+        InsertFreeBlock( blockOffset + size, blockSize - size );
+    }
+
+    m_allocations[ blockOffset ] = size;
+    return GeometryAllocation{ .Offset = blockOffset, .Size = size };
+}
+
+void GeometryAllocator::Free( const GeometryAllocation &allocation )
+{
+    if ( !allocation.IsValid( ) )
+    {
+        return;
+    }
+
+    const auto it = m_allocations.find( allocation.Offset );
+    if ( it == m_allocations.end( ) )
+    {
+        spdlog::error( "GeometryAllocator: Free called with an unknown offset {}", allocation.Offset );
+        return;
+    }
+
+    // Freeing a range that is being moved, the destination has no owner anymore once the move is dropped
+    const auto pendingMove = std::ranges::find( m_pendingMoves, allocation.Offset, &GeometryMove::SrcOffset );
+    if ( pendingMove != m_pendingMoves.end( ) )
+    {
+        const size_t dstOffset = pendingMove->DstOffset;
+        const size_t dstSize   = pendingMove->Size;
+        m_pendingMoves.erase( pendingMove );
+        m_allocations.erase( dstOffset );
+        InsertFreeBlock( dstOffset, dstSize );
+    }
+
+    const size_t size = it->second;
+    m_allocations.erase( allocation.Offset );
+    InsertFreeBlock( allocation.Offset, size );
+}
+
+void GeometryAllocator::Grow( const size_t newCapacity )
+{
+    if ( newCapacity <= m_capacity )
+    {
+        return;
+    }
+    InsertFreeBlock( m_capacity, newCapacity - m_capacity );
+    m_capacity = newCapacity;
+}
+
+std::vector<GeometryMove> GeometryAllocator::PlanDefragment( const size_t maxSize, const std::function<bool( size_t offset )> &canMove )
+{
+    std::vector<GeometryMove> moves;
+    if ( m_freeBlocks.empty( ) )
+    {
+        return moves;
+    }
+
+    // Tail allocations are moved into the first hole before them that fits, the source and destination never overlap so the copies are safe
+    // within the same buffer
+    std::vector<std::pair<size_t, size_t>> candidates( m_allocations.rbegin( ), m_allocations.rend( ) );
+    size_t                                 movedSize = 0;
+    for ( const auto &[ offset, size ] : candidates )
+    {
+        if ( movedSize + size > maxSize || IsPendingMove( offset ) || ( canMove && !canMove( offset ) ) )
+        {
+            continue;
+        }
+
+        auto hole = m_freeBlocks.begin( );
+        for ( ; hole != m_freeBlocks.end( ) && hole->first < offset; ++hole )
+        {
+            if ( hole->second >= size )
+            {
+                break;
+            }
+        }
+        if ( hole == m_freeBlocks.end( ) || hole->first >= offset )
+        {
+            continue;
+        }
+
+        const size_t dstOffset = hole->first;
+        const size_t holeSize  = hole->second;
+        EraseFreeBlock( hole );
+        if ( holeSize > size )
+        {
+            InsertFreeBlock( dstOffset + size, holeSize - size );
+        }
+        m_allocations[ dstOffset ] = size;
+
+        moves.push_back( GeometryMove{ .SrcOffset = offset, .DstOffset = dstOffset, .Size = size } );
+        movedSize += size;
+    }
+
+    m_pendingMoves.insert( m_pendingMoves.end( ), moves.begin( ), moves.end( ) );
+    return moves;
+}
+
+void GeometryAllocator::CompleteDefragment( const std::vector<GeometryMove> &moves )
+{
+    for ( const GeometryMove &move : moves )
+    {
+        // Dropped by Free when the range was released while it was moving
+        const auto pendingMove = std::ranges::find_if( m_pendingMoves, [ & ]( const GeometryMove &pending ) { return pending.SrcOffset == move.SrcOffset && pending.DstOffset == move.DstOffset; } );
+        if ( pendingMove == m_pendingMoves.end( ) )
+        {
+            continue;
+        }
+        m_pendingMoves.erase( pendingMove );
+        m_allocations.erase( move.SrcOffset );
+        InsertFreeBlock( move.SrcOffset, move.Size );
+    }
+}
+
+bool GeometryAllocator::HasPendingDefragment( ) const
+{
+    return !m_pendingMoves.empty( );
+}
+
+GeometryAllocatorStats GeometryAllocator::GetStats( ) const
+{
+    GeometryAllocatorStats stats{ };
+    stats.Capacity        = m_capacity;
+    stats.NumFreeBlocks   = m_freeBlocks.size( );
+    stats.FirstFreeOffset = m_freeBlocks.empty( ) ? m_capacity : m_freeBlocks.begin( )->first;
+    stats.NumAllocations  = m_allocations.size( ) - m_pendingMoves.size( );
+    for ( const auto &[ offset, size ] : m_freeBlocks )
+    {
+        stats.FreeSize += size;
+        stats.LargestFreeBlock = std::max( stats.LargestFreeBlock, size );
+    }
+    stats.UsedSize = m_capacity - stats.FreeSize;
+    if ( !m_allocations.empty( ) )
+    {
+        stats.HighWaterMark = m_allocations.rbegin( )->first + m_allocations.rbegin( )->second;
+    }
+    if ( stats.FreeSize > 0 )
+    {
+        stats.Fragmentation = 1.0f - static_cast<float>( stats.LargestFreeBlock ) / static_cast<float>( stats.FreeSize );
+    }
+    return stats;
+}
+
+size_t GeometryAllocator::GetCapacity( ) const
+{
+    return m_capacity;
+}
+
+bool GeometryAllocator::IsPendingMove( const size_t offset ) const
+{
+    return std::ranges::any_of( m_pendingMoves, [ & ]( const GeometryMove &move ) { return move.SrcOffset == offset || move.DstOffset == offset; } );
+}
+
+void GeometryAllocator::InsertFreeBlock( size_t offset, size_t size )
+{
+    if ( const auto next = m_freeBlocks.find( offset + size ); next != m_freeBlocks.end( ) )
+    {
+        size += next->second;
+        EraseFreeBlock( next );
+    }
+
+    if ( auto prev = m_freeBlocks.lower_bound( offset ); prev != m_freeBlocks.begin( ) )
+    {
+        --prev;
+        if ( prev->first + prev->second == offset )
+        {
+            offset = prev->first;
+            size += prev->second;
+            EraseFreeBlock( prev );
+        }
+    }
+
+    m_freeBlocks[ offset ] = size;
+    m_freeBySize.emplace( size, offset );
+}
+
+void GeometryAllocator::EraseFreeBlock( const std::map<size_t, size_t>::iterator block )
+{
+    auto [ first, last ] = m_freeBySize.equal_range( block->second );
+    for ( ; first != last; ++first )
+    {
+        if ( first->second == block->first )
+        {
+            m_freeBySize.erase( first );
+            break;
+        }
+    }
+    m_freeBlocks.erase( block );
+}
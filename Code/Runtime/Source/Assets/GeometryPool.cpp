@@ -0,0 +1,308 @@
+/*
+Den Of Iz - Game/Game Engine
+Copyright (c) 2020-2024 Muhammed Murat Cengiz
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "DZEngine/Assets/GeometryPool.h"
+#include <spdlog/spdlog.h>
+
+using namespace DZEngine;
+
+GeometryPool::GeometryPool( const GeometryPoolDesc &desc ) : m_logicalDevice( desc.LogicalDevice ), m_desc( desc )
+{
+    if ( !m_logicalDevice )
+    {
+        spdlog::error( "GeometryPool: LogicalDevice is required" );
+        return;
+    }
+
+    m_desc.SeparatePositionStream = desc.SeparatePositionStream && desc.GeometryLayout == GeometryLayout::GPUDriven;
+
+    m_vertices.Stride   = VertexQuantization::VertexStride( desc.VertexFormat );
+    m_vertices.MaxUnits = desc.MaxVertexBufferBytes / m_vertices.Stride;
+    m_indices.Stride    = IndexAllocationUnit;
+    m_indices.MaxUnits  = desc.MaxIndexBufferBytes / m_indices.Stride;
+
+    Grow( GeometryStream::Vertices, desc.InitialVertexBytes / m_vertices.Stride, nullptr );
+    Grow( GeometryStream::Indices, desc.InitialIndexBytes / m_indices.Stride, nullptr );
+}
+
+void GeometryPool::Reserve( const GeometryStream stream, const size_t size, BatchResourceCopy *copy )
+{
+    std::lock_guard lock( m_lock );
+    Stream         &s = GetStream( stream );
+    s.ReservedUnits += size;
+
+    // Without a copy list the live geometry can't be moved, the next Allocate grows the pool instead
+    const bool canGrow = copy || s.Allocator.GetStats( ).HighWaterMark == 0;
+    if ( canGrow && s.ReservedUnits > s.Allocator.GetCapacity( ) )
+    {
+        Grow( stream, s.ReservedUnits, copy );
+    }
+}
+
+void GeometryPool::Unreserve( const GeometryStream stream, const size_t size )
+{
+    std::lock_guard lock( m_lock );
+    Stream         &s = GetStream( stream );
+    s.ReservedUnits -= std::min( s.ReservedUnits, size );
+}
+
+GeometryAllocation GeometryPool::Allocate( const GeometryStream stream, const size_t size, BatchResourceCopy *copy )
+{
+    std::lock_guard lock( m_lock );
+    Stream         &s = GetStream( stream );
+    if ( const GeometryAllocation allocation = s.Allocator.Allocate( size ); allocation.IsValid( ) || size == 0 )
+    {
+        return allocation;
+    }
+
+    if ( !copy && s.Allocator.GetStats( ).HighWaterMark > 0 )
+    {
+        return GeometryAllocation{ }; // The caller retries with a copy list once its uploads are flushed
+    }
+
+    // The tail free block merges with the new pages, so growing past the high water mark is enough for the request to fit
+    const size_t minUnits = std::max( s.Allocator.GetStats( ).HighWaterMark, s.ReservedUnits ) + size;
+    if ( !Grow( stream, minUnits, copy ) )
+    {
+        return GeometryAllocation{ };
+    }
+    return s.Allocator.Allocate( size );
+}
+
+void GeometryPool::Free( const GeometryStream stream, const GeometryAllocation &allocation )
+{
+    if ( !allocation.IsValid( ) )
+    {
+        return;
+    }
+    std::lock_guard lock( m_lock );
+    GetStream( stream ).Allocator.Free( allocation );
+    m_freeVersion++;
+}
+
+std::vector<GeometryMove> GeometryPool::Defragment( const GeometryStream stream, const size_t maxSize, const std::function<bool( size_t offset )> &canMove,
+                                                    BatchResourceCopy *copy )
+{
+    if ( !copy )
+    {
+        spdlog::error( "GeometryPool: Defragment requires a copy list" );
+        return { };
+    }
+
+    std::lock_guard                 lock( m_lock );
+    Stream                         &s     = GetStream( stream );
+    const std::vector<GeometryMove> moves = s.Allocator.PlanDefragment( maxSize, canMove );
+
+    // Source and destination ranges never overlap, so the copies stay within the same buffer
+    const uint32_t positionStride = VertexQuantization::PositionStride( m_desc.VertexFormat );
+    for ( const GeometryMove &move : moves )
+    {
+        CopyBufferRegionDesc copyDesc{ };
+        copyDesc.SrcBuffer = s.Buffer.get( );
+        copyDesc.DstBuffer = s.Buffer.get( );
+        copyDesc.SrcOffset = move.SrcOffset * s.Stride;
+        copyDesc.DstOffset = move.DstOffset * s.Stride;
+        copyDesc.NumBytes  = move.Size * s.Stride;
+        copy->CopyBufferRegion( copyDesc );
+
+        if ( s.PositionBuffer )
+        {
+            CopyBufferRegionDesc positionCopyDesc{ };
+            positionCopyDesc.SrcBuffer = s.PositionBuffer.get( );
+            positionCopyDesc.DstBuffer = s.PositionBuffer.get( );
+            positionCopyDesc.SrcOffset = move.SrcOffset * positionStride;
+            positionCopyDesc.DstOffset = move.DstOffset * positionStride;
+            positionCopyDesc.NumBytes  = move.Size * positionStride;
+            copy->CopyBufferRegion( positionCopyDesc );
+        }
+    }
+    return moves;
+}
+
+void GeometryPool::CompleteDefragment( const GeometryStream stream, const std::vector<GeometryMove> &moves )
+{
+    if ( moves.empty( ) )
+    {
+        return;
+    }
+    std::lock_guard lock( m_lock );
+    GetStream( stream ).Allocator.CompleteDefragment( moves );
+    m_freeVersion++;
+}
+
+void GeometryPool::ReleaseRetiredBuffers( const uint32_t version )
+{
+    std::lock_guard lock( m_lock );
+    std::erase_if( m_retiredBuffers, [ & ]( const RetiredBuffer &retired ) { return retired.Version <= version; } );
+}
+
+IBufferResource *GeometryPool::GetBuffer( const GeometryStream stream ) const
+{
+    std::lock_guard lock( m_lock );
+    return GetStream( stream ).Buffer.get( );
+}
+
+IBufferResource *GeometryPool::GetPositionBuffer( ) const
+{
+    std::lock_guard lock( m_lock );
+    return m_vertices.PositionBuffer.get( );
+}
+
+uint32_t GeometryPool::GetStride( const GeometryStream stream ) const
+{
+    return GetStream( stream ).Stride;
+}
+
+size_t GeometryPool::GetHighWaterMark( const GeometryStream stream ) const
+{
+    std::lock_guard lock( m_lock );
+    return GetStream( stream ).Allocator.GetStats( ).HighWaterMark;
+}
+
+uint32_t GeometryPool::GetVersion( ) const
+{
+    std::lock_guard lock( m_lock );
+    return m_version;
+}
+
+GeometryPoolStats GeometryPool::GetStats( ) const
+{
+    std::lock_guard   lock( m_lock );
+    GeometryPoolStats stats{ };
+    stats.Vertices            = m_vertices.Allocator.GetStats( );
+    stats.Indices             = m_indices.Allocator.GetStats( );
+    stats.VertexCapacityBytes = stats.Vertices.Capacity * m_vertices.Stride;
+    stats.IndexCapacityBytes  = stats.Indices.Capacity * m_indices.Stride;
+    stats.ReservedVertexBytes = m_vertices.ReservedUnits * m_vertices.Stride;
+    stats.ReservedIndexBytes  = m_indices.ReservedUnits * m_indices.Stride;
+    stats.NumGrowths          = m_numGrowths;
+    stats.FreeVersion         = m_freeVersion;
+    return stats;
+}
+
+bool GeometryPool::IsCompatible( const GeometryLayout layout, const VertexFormat vertexFormat, const bool separatePositionStream ) const
+{
+    const bool positionStream = separatePositionStream && layout == GeometryLayout::GPUDriven;
+    return m_desc.GeometryLayout == layout && m_desc.VertexFormat == vertexFormat && m_desc.SeparatePositionStream == positionStream;
+}
+
+GeometryPool::Stream &GeometryPool::GetStream( const GeometryStream stream )
+{
+    return stream == GeometryStream::Vertices ? m_vertices : m_indices;
+}
+
+const GeometryPool::Stream &GeometryPool::GetStream( const GeometryStream stream ) const
+{
+    return stream == GeometryStream::Vertices ? m_vertices : m_indices;
+}
+
+bool GeometryPool::Grow( const GeometryStream stream, const size_t minUnits, BatchResourceCopy *copy )
+{
+    Stream      &s            = GetStream( stream );
+    const size_t currentUnits = s.Allocator.GetCapacity( );
+    const size_t pageBytes    = std::max<size_t>( m_desc.PageBytes, s.Stride );
+    const size_t numPages     = ( std::max<size_t>( minUnits, 1 ) * s.Stride + pageBytes - 1 ) / pageBytes;
+    const size_t newUnits     = std::min( numPages * pageBytes / s.Stride, s.MaxUnits );
+    if ( newUnits < minUnits )
+    {
+        spdlog::error( "GeometryPool: Out of {} space, {} units requested, the limit is {}", stream == GeometryStream::Vertices ? "vertex" : "index", minUnits, s.MaxUnits );
+        return false;
+    }
+    if ( newUnits <= currentUnits )
+    {
+        return true;
+    }
+
+    const size_t liveUnits = s.Allocator.GetStats( ).HighWaterMark;
+    if ( liveUnits > 0 && !copy )
+    {
+        spdlog::error( "GeometryPool: Growing a pool with live geometry requires a copy list" );
+        return false;
+    }
+
+    auto buffer         = CreateBuffer( stream, newUnits, false );
+    auto positionBuffer = stream == GeometryStream::Vertices && m_desc.SeparatePositionStream ? CreateBuffer( stream, newUnits, true ) : nullptr;
+    if ( liveUnits > 0 )
+    {
+        CopyBufferRegionDesc copyDesc{ };
+        copyDesc.SrcBuffer = s.Buffer.get( );
+        copyDesc.DstBuffer = buffer.get( );
+        copyDesc.NumBytes  = liveUnits * s.Stride;
+        copy->CopyBufferRegion( copyDesc );
+
+        if ( positionBuffer )
+        {
+            CopyBufferRegionDesc positionCopyDesc{ };
+            positionCopyDesc.SrcBuffer = s.PositionBuffer.get( );
+            positionCopyDesc.DstBuffer = positionBuffer.get( );
+            positionCopyDesc.NumBytes  = liveUnits * VertexQuantization::PositionStride( m_desc.VertexFormat );
+            copy->CopyBufferRegion( positionCopyDesc );
+        }
+    }
+
+    if ( s.Buffer )
+    {
+        m_retiredBuffers.push_back( RetiredBuffer{ m_version + 1, std::move( s.Buffer ) } );
+        m_numGrowths++;
+    }
+    if ( s.PositionBuffer )
+    {
+        m_retiredBuffers.push_back( RetiredBuffer{ m_version + 1, std::move( s.PositionBuffer ) } );
+    }
+    s.Buffer         = std::move( buffer );
+    s.PositionBuffer = std::move( positionBuffer );
+    s.Allocator.Grow( newUnits );
+    m_version++;
+    m_freeVersion++;
+    return true;
+}
+
+std::unique_ptr<IBufferResource> GeometryPool::CreateBuffer( const GeometryStream stream, const size_t numUnits, const bool positions ) const
+{
+    BufferDesc bufferDesc{ };
+    bufferDesc.HeapType = HeapType::GPU;
+    bufferDesc.Usages   = ResourceUsage::CopyDst | ResourceUsage::CopySrc; // CopySrc for growing and defragmenting
+    if ( stream == GeometryStream::Indices )
+    {
+        bufferDesc.Descriptor = ResourceDescriptor::IndexBuffer;
+        bufferDesc.NumBytes   = numUnits * m_indices.Stride;
+        bufferDesc.DebugName  = "Geometry Pool Index Buffer";
+    }
+    else if ( positions )
+    {
+        const uint32_t positionStride        = VertexQuantization::PositionStride( m_desc.VertexFormat );
+        bufferDesc.Descriptor                = ResourceDescriptor::StructuredBuffer;
+        bufferDesc.StructureDesc.NumElements = numUnits;
+        bufferDesc.StructureDesc.Stride      = positionStride;
+        bufferDesc.NumBytes                  = numUnits * positionStride;
+        bufferDesc.DebugName                 = "Geometry Pool Position Buffer";
+    }
+    else
+    {
+        bufferDesc.Descriptor = ResourceDescriptor::VertexBuffer;
+        bufferDesc.NumBytes   = numUnits * m_vertices.Stride;
+        bufferDesc.DebugName  = "Geometry Pool Vertex Buffer";
+        if ( m_desc.GeometryLayout == GeometryLayout::GPUDriven )
+        {
+            bufferDesc.Descriptor                = ResourceDescriptor::StructuredBuffer;
+            bufferDesc.StructureDesc.NumElements = numUnits;
+            bufferDesc.StructureDesc.Stride      = m_vertices.Stride;
+        }
+    }
+    return std::unique_ptr<IBufferResource>( m_logicalDevice->CreateBufferResource( bufferDesc ) );
+}
@@ -0,0 +1,192 @@
+/*
+Den Of Iz - Game/Game Engine
+Copyright (c) 2020-2024 Muhammed Murat Cengiz
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "DZEngine/Assets/InotifyFileWatcher.h"
+
+#ifdef __linux__
+#include <cerrno>
+#include <cstring>
+#include <spdlog/spdlog.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+using namespace DZEngine;
+
+namespace
+{
+    // IN_CLOSE_WRITE alone would miss editors that rename over the original, IN_MODIFY catches writes of files that are kept open
+    constexpr uint32_t WatchMask = IN_CLOSE_WRITE | IN_MODIFY | IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_ONLYDIR;
+    constexpr size_t   ReadNumBytes = 64 * 1024;
+} // namespace
+
+InotifyFileWatcher::InotifyFileWatcher( const FileWatcherDesc &desc ) : m_debouncer( desc.Debounce ), m_buffer( ReadNumBytes )
+{
+    m_inotify = inotify_init1( IN_NONBLOCK | IN_CLOEXEC );
+    if ( m_inotify < 0 )
+    {
+        spdlog::error( "InotifyFileWatcher - inotify_init1 failed: {}", std::strerror( errno ) );
+    }
+}
+
+InotifyFileWatcher::~InotifyFileWatcher( )
+{
+    if ( m_inotify >= 0 )
+    {
+        close( m_inotify );
+    }
+}
+
+bool InotifyFileWatcher::IsValid( ) const
+{
+    return m_inotify >= 0;
+}
+
+bool InotifyFileWatcher::Watch( const std::filesystem::path &directory )
+{
+    std::error_code error;
+    if ( !std::filesystem::is_directory( directory, error ) )
+    {
+        spdlog::error( "InotifyFileWatcher::Watch - {} is not a directory", directory.string( ) );
+        return false;
+    }
+    if ( !AddWatch( directory ) )
+    {
+        return false;
+    }
+    for ( auto it = std::filesystem::recursive_directory_iterator( directory, std::filesystem::directory_options::skip_permission_denied, error );
+          !error && it != std::filesystem::recursive_directory_iterator( ); it.increment( error ) )
+    {
+        if ( it->is_directory( error ) )
+        {
+            AddWatch( it->path( ) );
+        }
+        error.clear( );
+    }
+    return true;
+}
+
+void InotifyFileWatcher::Poll( std::vector<FileChange> &outChanges )
+{
+    const auto now = std::chrono::steady_clock::now( );
+    Read( now );
+    m_debouncer.Collect( now, outChanges );
+}
+
+FileWatcherBackend InotifyFileWatcher::GetBackend( ) const
+{
+    return FileWatcherBackend::Inotify;
+}
+
+bool InotifyFileWatcher::AddWatch( const std::filesystem::path &directory )
+{
+    const int watch = inotify_add_watch( m_inotify, directory.c_str( ), WatchMask );
+    if ( watch < 0 )
+    {
+        spdlog::error( "InotifyFileWatcher::AddWatch - Failed to watch {}: {}", directory.string( ), std::strerror( errno ) );
+        return false;
+    }
+    m_directories[ watch ] = directory; // inotify returns the existing descriptor for a directory that is already watched
+    return true;
+}
+
+void InotifyFileWatcher::WatchNewDirectory( const std::filesystem::path &directory, const std::chrono::steady_clock::time_point now )
+{
+    if ( !AddWatch( directory ) )
+    {
+        return;
+    }
+    // Files created before the watch was added have no events of their own
+    std::error_code error;
+    for ( auto it = std::filesystem::directory_iterator( directory, error ); !error && it != std::filesystem::directory_iterator( ); it.increment( error ) )
+    {
+        if ( it->is_directory( error ) )
+        {
+            WatchNewDirectory( it->path( ), now );
+        }
+        else if ( !error )
+        {
+            m_debouncer.Add( it->path( ), FileChangeType::Added, now );
+        }
+        error.clear( );
+    }
+}
+
+void InotifyFileWatcher::Read( const std::chrono::steady_clock::time_point now )
+{
+    while ( true )
+    {
+        const ssize_t numBytes = read( m_inotify, m_buffer.data( ), m_buffer.size( ) );
+        if ( numBytes <= 0 )
+        {
+            if ( numBytes < 0 && errno != EAGAIN && errno != EINTR )
+            {
+                spdlog::error( "InotifyFileWatcher::Read - read failed: {}", std::strerror( errno ) );
+            }
+            return;
+        }
+
+        for ( ssize_t offset = 0; offset < numBytes; )
+        {
+            const auto *event = reinterpret_cast<const inotify_event *>( m_buffer.data( ) + offset );
+            offset += static_cast<ssize_t>( sizeof( inotify_event ) + event->len );
+
+            if ( event->mask & IN_Q_OVERFLOW )
+            {
+                spdlog::warn( "InotifyFileWatcher::Read - Event queue overflowed, some changes were lost" );
+                continue;
+            }
+            const auto directory = m_directories.find( event->wd );
+            if ( directory == m_directories.end( ) )
+            {
+                continue;
+            }
+            if ( event->mask & IN_IGNORED )
+            {
+                m_directories.erase( directory ); // Removed or unmounted
+                continue;
+            }
+            if ( event->len == 0 )
+            {
+                continue;
+            }
+
+            const std::filesystem::path path = directory->second / event->name;
+            if ( event->mask & IN_ISDIR )
+            {
+                if ( event->mask & ( IN_CREATE | IN_MOVED_TO ) )
+                {
+                    WatchNewDirectory( path, now );
+                }
+                continue;
+            }
+            if ( event->mask & ( IN_CREATE | IN_MOVED_TO ) )
+            {
+                m_debouncer.Add( path, FileChangeType::Added, now );
+            }
+            else if ( event->mask & ( IN_DELETE | IN_MOVED_FROM ) )
+            {
+                m_debouncer.Add( path, FileChangeType::Removed, now );
+            }
+            else if ( event->mask & ( IN_MODIFY | IN_CLOSE_WRITE ) )
+            {
+                m_debouncer.Add( path, FileChangeType::Modified, now );
+            }
+        }
+    }
+}
+#endif
@@ -0,0 +1,439 @@
+/*
+Den Of Iz - Game/Game Engine
+Copyright (c) 2020-2024 Muhammed Murat Cengiz
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "DZEngine/Assets/IoUringFileIO.h"
+
+#ifdef __linux__
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <spdlog/spdlog.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+using namespace DZEngine;
+
+namespace
+{
+    // liburing isn't a dependency, the three syscalls are all it would wrap here
+    int IoUringSetup( const uint32_t entries, io_uring_params *params )
+    {
+        return static_cast<int>( syscall( __NR_io_uring_setup, entries, params ) );
+    }
+
+    int IoUringEnter( const int ring, const uint32_t toSubmit, const uint32_t minComplete, const uint32_t flags )
+    {
+        return static_cast<int>( syscall( __NR_io_uring_enter, ring, toSubmit, minComplete, flags, nullptr, 0 ) );
+    }
+
+    int IoUringRegister( const int ring, const uint32_t opcode, const void *args, const uint32_t numArgs )
+    {
+        return static_cast<int>( syscall( __NR_io_uring_register, ring, opcode, args, numArgs ) );
+    }
+
+    uint32_t *RingField( void *ring, const uint32_t offset )
+    {
+        return reinterpret_cast<uint32_t *>( static_cast<Byte *>( ring ) + offset );
+    }
+} // namespace
+
+IoUringFileIO::IoUringFileIO( const FileIODesc &desc )
+{
+    const uint32_t queueDepth = std::max( 1u, desc.QueueDepth );
+    if ( !CreateRing( queueDepth ) )
+    {
+        spdlog::warn( "IoUringFileIO: Failed to create the ring: {}", std::strerror( errno ) );
+        Unmap( );
+        return;
+    }
+    RegisterBuffers( desc );
+
+    // The submission queue may be larger than requested, in flight reads are still capped at queueDepth so the completion queue can't overflow
+    m_operations.resize( queueDepth );
+    m_freeOperations.reserve( queueDepth );
+    for ( uint32_t i = queueDepth; i > 0; --i )
+    {
+        m_freeOperations.push_back( i - 1 );
+    }
+    m_completionThread = std::thread( [ this ] { CompletionLoop( ); } );
+}
+
+IoUringFileIO::~IoUringFileIO( )
+{
+    if ( m_completionThread.joinable( ) )
+    {
+        {
+            std::lock_guard lock( m_submitLock );
+            PrepareNop( );
+            SubmitPending( );
+        }
+        m_completionThread.join( );
+    }
+    Unmap( );
+}
+
+bool IoUringFileIO::IsValid( ) const
+{
+    return m_ring >= 0;
+}
+
+void IoUringFileIO::Read( const std::span<FileRead> reads, FileReadBatch &batch )
+{
+    batch.Add( static_cast<uint32_t>( reads.size( ) ) );
+
+    std::unique_lock lock( m_submitLock );
+    for ( FileRead &read : reads )
+    {
+        read.NumBytesRead = 0;
+        read.Succeeded    = false;
+        const int file    = open( read.Path.c_str( ), O_RDONLY | O_CLOEXEC );
+        if ( file < 0 || read.NumBytes == 0 )
+        {
+            if ( file >= 0 )
+            {
+                close( file );
+            }
+            read.Succeeded = file >= 0;
+            batch.Complete( );
+            continue;
+        }
+
+        if ( m_freeOperations.empty( ) )
+        {
+            SubmitPending( ); // The queue is full, whatever is prepared has to complete before anything else can be
+            m_operationFreed.wait( lock, [ this ] { return !m_freeOperations.empty( ); } );
+        }
+        const uint32_t operationIndex = m_freeOperations.back( );
+        m_freeOperations.pop_back( );
+
+        Operation &operation  = m_operations[ operationIndex ];
+        operation.Read        = &read;
+        operation.Batch       = &batch;
+        operation.File        = file;
+        operation.BufferIndex = -1;
+        if ( read.NumBytes <= m_bufferSize && !m_freeBuffers.empty( ) )
+        {
+            operation.BufferIndex = m_freeBuffers.back( );
+            m_freeBuffers.pop_back( );
+        }
+        PrepareRead( operationIndex );
+    }
+    SubmitPending( );
+}
+
+FileIOBackend IoUringFileIO::GetBackend( ) const
+{
+    return FileIOBackend::IoUring;
+}
+
+bool IoUringFileIO::CreateRing( const uint32_t queueDepth )
+{
+    io_uring_params params{ };
+    m_ring = IoUringSetup( queueDepth, &params );
+    if ( m_ring < 0 )
+    {
+        return false;
+    }
+
+    m_sqRingNumBytes = params.sq_off.array + params.sq_entries * sizeof( uint32_t );
+    m_cqRingNumBytes = params.cq_off.cqes + params.cq_entries * sizeof( io_uring_cqe );
+    const bool singleMap = ( params.features & IORING_FEAT_SINGLE_MMAP ) != 0;
+    if ( singleMap )
+    {
+        m_sqRingNumBytes = std::max( m_sqRingNumBytes, m_cqRingNumBytes );
+        m_cqRingNumBytes = 0;
+    }
+
+    void *sqRing = mmap( nullptr, m_sqRingNumBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_ring, IORING_OFF_SQ_RING );
+    if ( sqRing == MAP_FAILED )
+    {
+        return false;
+    }
+    m_sqRing = sqRing;
+    m_cqRing = m_sqRing;
+    if ( !singleMap )
+    {
+        void *cqRing = mmap( nullptr, m_cqRingNumBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_ring, IORING_OFF_CQ_RING );
+        if ( cqRing == MAP_FAILED )
+        {
+            return false;
+        }
+        m_cqRing = cqRing;
+    }
+
+    m_sqesNumBytes = params.sq_entries * sizeof( io_uring_sqe );
+    void *sqes     = mmap( nullptr, m_sqesNumBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_ring, IORING_OFF_SQES );
+    if ( sqes == MAP_FAILED )
+    {
+        return false;
+    }
+    m_sqes = static_cast<io_uring_sqe *>( sqes );
+
+    m_sqTail  = RingField( m_sqRing, params.sq_off.tail );
+    m_sqMask  = *RingField( m_sqRing, params.sq_off.ring_mask );
+    m_sqArray = RingField( m_sqRing, params.sq_off.array );
+    m_cqHead  = RingField( m_cqRing, params.cq_off.head );
+    m_cqTail  = RingField( m_cqRing, params.cq_off.tail );
+    m_cqMask  = *RingField( m_cqRing, params.cq_off.ring_mask );
+    m_cqes    = reinterpret_cast<io_uring_cqe *>( static_cast<Byte *>( m_cqRing ) + params.cq_off.cqes );
+    return true;
+}
+
+void IoUringFileIO::RegisterBuffers( const FileIODesc &desc )
+{
+    if ( desc.NumRegisteredBuffers == 0 || desc.RegisteredBufferSize == 0 )
+    {
+        return;
+    }
+
+    m_buffersNumBytes = static_cast<size_t>( desc.NumRegisteredBuffers ) * desc.RegisteredBufferSize;
+    void *buffers     = mmap( nullptr, m_buffersNumBytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0 );
+    if ( buffers == MAP_FAILED )
+    {
+        m_buffersNumBytes = 0;
+        return;
+    }
+
+    std::vector<iovec> iovecs( desc.NumRegisteredBuffers );
+    for ( uint32_t i = 0; i < desc.NumRegisteredBuffers; ++i )
+    {
+        iovecs[ i ].iov_base = static_cast<Byte *>( buffers ) + static_cast<size_t>( i ) * desc.RegisteredBufferSize;
+        iovecs[ i ].iov_len  = desc.RegisteredBufferSize;
+    }
+    if ( IoUringRegister( m_ring, IORING_REGISTER_BUFFERS, iovecs.data( ), desc.NumRegisteredBuffers ) < 0 )
+    {
+        // Usually RLIMIT_MEMLOCK, every read goes straight to its destination instead
+        spdlog::warn( "IoUringFileIO: Failed to register buffers: {}", std::strerror( errno ) );
+        munmap( buffers, m_buffersNumBytes );
+        m_buffersNumBytes = 0;
+        return;
+    }
+
+    m_buffers    = static_cast<Byte *>( buffers );
+    m_bufferSize = desc.RegisteredBufferSize;
+    for ( uint32_t i = desc.NumRegisteredBuffers; i > 0; --i )
+    {
+        m_freeBuffers.push_back( static_cast<int>( i - 1 ) );
+    }
+}
+
+void IoUringFileIO::PrepareRead( const uint32_t operationIndex )
+{
+    const Operation &operation = m_operations[ operationIndex ];
+    const FileRead  &read      = *operation.Read;
+    const size_t     remaining = read.NumBytes - read.NumBytesRead;
+
+    // Without SQPOLL io_uring_enter consumes every prepared entry and at most one entry per operation is pending, so the queue can't be full
+    const uint32_t tail  = *m_sqTail; // Only written by this side
+    const uint32_t index = tail & m_sqMask;
+    io_uring_sqe  &sqe   = m_sqes[ index ];
+    std::memset( &sqe, 0, sizeof( sqe ) );
+    sqe.fd        = operation.File;
+    sqe.off       = read.Offset + read.NumBytesRead;
+    sqe.len       = static_cast<uint32_t>( std::min<size_t>( remaining, MaxReadNumBytes ) );
+    sqe.user_data = operationIndex + 1;
+    if ( operation.BufferIndex >= 0 )
+    {
+        sqe.opcode    = IORING_OP_READ_FIXED;
+        sqe.addr      = reinterpret_cast<uint64_t>( m_buffers + static_cast<size_t>( operation.BufferIndex ) * m_bufferSize );
+        sqe.buf_index = static_cast<uint16_t>( operation.BufferIndex );
+    }
+    else
+    {
+        sqe.opcode = IORING_OP_READ;
+        sqe.addr   = reinterpret_cast<uint64_t>( read.Dst + read.NumBytesRead );
+    }
+
+    m_sqArray[ index ] = index;
+    std::atomic_ref( *m_sqTail ).store( tail + 1, std::memory_order_release );
+    ++m_numUnsubmitted;
+}
+
+void IoUringFileIO::PrepareNop( )
+{
+    const uint32_t tail  = *m_sqTail;
+    const uint32_t index = tail & m_sqMask;
+    std::memset( &m_sqes[ index ], 0, sizeof( io_uring_sqe ) );
+    m_sqes[ index ].opcode = IORING_OP_NOP;
+
+    m_sqArray[ index ] = index;
+    std::atomic_ref( *m_sqTail ).store( tail + 1, std::memory_order_release );
+    ++m_numUnsubmitted;
+}
+
+void IoUringFileIO::SubmitPending( )
+{
+    while ( m_numUnsubmitted > 0 )
+    {
+        const int numSubmitted = IoUringEnter( m_ring, m_numUnsubmitted, 0, 0 );
+        if ( numSubmitted < 0 )
+        {
+            if ( errno == EINTR || errno == EAGAIN || errno == EBUSY )
+            {
+                continue;
+            }
+            spdlog::critical( "IoUringFileIO: io_uring_enter failed: {}", std::strerror( errno ) );
+            FailUnsubmitted( );
+            return;
+        }
+        m_numUnsubmitted -= static_cast<uint32_t>( numSubmitted );
+    }
+}
+
+void IoUringFileIO::FailUnsubmitted( )
+{
+    // The kernel consumes entries in order and took none of the last m_numUnsubmitted, they are withdrawn by moving the tail back
+    const uint32_t tail = *m_sqTail - m_numUnsubmitted;
+    for ( uint32_t i = tail; i != *m_sqTail; ++i )
+    {
+        const uint64_t userData = m_sqes[ m_sqArray[ i & m_sqMask ] ].user_data;
+        if ( userData == 0 )
+        {
+            continue; // The nop waking the completion thread up
+        }
+
+        const auto operationIndex = static_cast<uint32_t>( userData - 1 );
+        Operation &operation      = m_operations[ operationIndex ];
+        close( operation.File );
+        operation.Read->Succeeded = false;
+        if ( operation.BufferIndex >= 0 )
+        {
+            m_freeBuffers.push_back( operation.BufferIndex );
+        }
+        m_freeOperations.push_back( operationIndex );
+        operation.Batch->Complete( );
+    }
+    std::atomic_ref( *m_sqTail ).store( tail, std::memory_order_release );
+    m_numUnsubmitted = 0;
+    m_operationFreed.notify_all( );
+}
+
+void IoUringFileIO::CompletionLoop( )
+{
+    bool exit = false;
+    while ( !exit )
+    {
+        if ( IoUringEnter( m_ring, 0, 1, IORING_ENTER_GETEVENTS ) < 0 && errno != EINTR )
+        {
+            spdlog::critical( "IoUringFileIO: Waiting for completions failed: {}", std::strerror( errno ) );
+            return;
+        }
+
+        uint32_t       head = *m_cqHead; // Only written by this thread
+        const uint32_t tail = std::atomic_ref( *m_cqTail ).load( std::memory_order_acquire );
+        for ( ; head != tail; ++head )
+        {
+            const io_uring_cqe &cqe = m_cqes[ head & m_cqMask ];
+            if ( cqe.user_data == 0 )
+            {
+                exit = true;
+                continue;
+            }
+            Complete( cqe.user_data, cqe.res );
+        }
+        std::atomic_ref( *m_cqHead ).store( head, std::memory_order_release );
+    }
+}
+
+void IoUringFileIO::Complete( const uint64_t userData, const int result )
+{
+    const auto operationIndex = static_cast<uint32_t>( userData - 1 );
+    Operation &operation      = m_operations[ operationIndex ];
+    FileRead  &read           = *operation.Read;
+
+    if ( result == -EINTR || result == -EAGAIN )
+    {
+        std::lock_guard lock( m_submitLock );
+        PrepareRead( operationIndex );
+        SubmitPending( );
+        return;
+    }
+    if ( result <= 0 ) // Error or end of file
+    {
+        Finish( operationIndex );
+        return;
+    }
+
+    if ( operation.BufferIndex >= 0 )
+    {
+        std::memcpy( read.Dst + read.NumBytesRead, m_buffers + static_cast<size_t>( operation.BufferIndex ) * m_bufferSize, static_cast<size_t>( result ) );
+    }
+    read.NumBytesRead += static_cast<size_t>( result );
+    if ( read.NumBytesRead == read.NumBytes )
+    {
+        Finish( operationIndex );
+        return;
+    }
+
+    std::lock_guard lock( m_submitLock );
+    PrepareRead( operationIndex ); // Short read, continue from where it stopped
+    SubmitPending( );
+}
+
+void IoUringFileIO::Finish( const uint32_t operationIndex )
+{
+    Operation     &operation = m_operations[ operationIndex ];
+    FileReadBatch *batch     = operation.Batch;
+    close( operation.File );
+    operation.Read->Succeeded = operation.Read->NumBytesRead == operation.Read->NumBytes;
+    {
+        std::lock_guard lock( m_submitLock );
+        if ( operation.BufferIndex >= 0 )
+        {
+            m_freeBuffers.push_back( operation.BufferIndex );
+        }
+        m_freeOperations.push_back( operationIndex );
+    }
+    m_operationFreed.notify_one( );
+    batch->Complete( ); // Last access, the reads and the batch may be destroyed right after
+}
+
+void IoUringFileIO::Unmap( )
+{
+    if ( m_sqes )
+    {
+        munmap( m_sqes, m_sqesNumBytes );
+    }
+    if ( m_cqRing && m_cqRing != m_sqRing )
+    {
+        munmap( m_cqRing, m_cqRingNumBytes );
+    }
+    if ( m_sqRing )
+    {
+        munmap( m_sqRing, m_sqRingNumBytes );
+    }
+    if ( m_ring >= 0 )
+    {
+        close( m_ring ); // Also unregisters the buffers
+    }
+    if ( m_buffers )
+    {
+        munmap( m_buffers, m_buffersNumBytes );
+    }
+    m_sqes    = nullptr;
+    m_cqRing  = nullptr;
+    m_sqRing  = nullptr;
+    m_ring    = -1;
+    m_buffers = nullptr;
+}
+#endif
@@ -0,0 +1,132 @@
+/*
+Den Of Iz - Game/Game Engine
+Copyright (c) 2020-2024 Muhammed Murat Cengiz
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "DZEngine/Assets/MappedFile.h"
+#include <utility>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace DZEngine;
+
+MappedFile::MappedFile( const std::filesystem::path &path )
+{
+#ifdef _WIN32
+    const HANDLE file = CreateFileW( path.c_str( ), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr );
+    if ( file == INVALID_HANDLE_VALUE )
+    {
+        return;
+    }
+    LARGE_INTEGER fileSize{ };
+    GetFileSizeEx( file, &fileSize );
+    m_numBytes    = static_cast<size_t>( fileSize.QuadPart );
+    m_fileMapping = m_numBytes > 0 ? CreateFileMappingW( file, nullptr, PAGE_READONLY, 0, 0, nullptr ) : nullptr;
+    CloseHandle( file );
+    if ( m_fileMapping )
+    {
+        m_data = static_cast<const Byte *>( MapViewOfFile( m_fileMapping, FILE_MAP_READ, 0, 0, 0 ) );
+    }
+#else
+    const int file = open( path.c_str( ), O_RDONLY );
+    if ( file < 0 )
+    {
+        return;
+    }
+    struct stat fileStat{ };
+    if ( fstat( file, &fileStat ) == 0 && fileStat.st_size > 0 )
+    {
+        m_numBytes = static_cast<size_t>( fileStat.st_size );
+        if ( void *mapping = mmap( nullptr, m_numBytes, PROT_READ, MAP_PRIVATE, file, 0 ); mapping != MAP_FAILED )
+        {
+            m_data = static_cast<const Byte *>( mapping );
+        }
+    }
+    close( file ); // The mapping keeps the file referenced
+#endif
+
+    if ( !m_data )
+    {
+        Unmap( );
+    }
+}
+
+MappedFile::~MappedFile( )
+{
+    Unmap( );
+}
+
+MappedFile::MappedFile( MappedFile &&other ) noexcept :
+    m_data( std::exchange( other.m_data, nullptr ) ), m_numBytes( std::exchange( other.m_numBytes, 0 ) ), m_fileMapping( std::exchange( other.m_fileMapping, nullptr ) )
+{
+}
+
+MappedFile &MappedFile::operator=( MappedFile &&other ) noexcept
+{
+    if ( this != &other )
+    {
+        Unmap( );
+        m_data        = std::exchange( other.m_data, nullptr );
+        m_numBytes    = std::exchange( other.m_numBytes, 0 );
+        m_fileMapping = std::exchange( other.m_fileMapping, nullptr );
+    }
+    return *this;
+}
+
+bool MappedFile::IsValid( ) const
+{
+    return m_data != nullptr;
+}
+
+const Byte *MappedFile::GetData( ) const
+{
+    return m_data;
+}
+
+size_t MappedFile::GetNumBytes( ) const
+{
+    return m_numBytes;
+}
+
+void MappedFile::Unmap( )
+{
+#ifdef _WIN32
+    if ( m_data )
+    {
+        UnmapViewOfFile( m_data );
+    }
+    if ( m_fileMapping )
+    {
+        CloseHandle( m_fileMapping );
+    }
+#else
+    if ( m_data )
+    {
+        munmap( const_cast<Byte *>( m_data ), m_numBytes );
+    }
+#endif
+    m_data        = nullptr;
+    m_numBytes    = 0;
+    m_fileMapping = nullptr;
+}
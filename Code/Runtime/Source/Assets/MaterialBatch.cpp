@@ -17,6 +17,7 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 */
 
 #include "DZEngine/Assets/MaterialBatch.h"
+#include <ranges>
 #include <spdlog/spdlog.h>
 
 using namespace DZEngine;
@@ -62,94 +63,153 @@ TextureHandle MaterialBatch::LoadTexture( const std::string &alias, BinaryReader
 
     CreateAssetTextureDesc assetTextureDesc{ };
     assetTextureDesc.Reader = &texReader;
-    ITextureResource *tex   = m_batchResourceCopy->CreateAndLoadAssetTexture( assetTextureDesc );
-    return AddTexture( alias, tex );
+    std::unique_ptr<ITextureResource> tex( m_batchResourceCopy->CreateAndLoadAssetTexture( assetTextureDesc ) );
+    const TextureHandle               handle = AddTexture( alias, tex.get( ) );
+    if ( handle.IsValid( ) )
+    {
+        std::lock_guard lock( m_textureLock );
+        m_loadedTextures[ handle.Id ] = std::move( tex );
+    }
+    return handle;
 }
 
 TextureHandle MaterialBatch::AddTexture( const std::string &alias, ITextureResource *texture )
 {
-    const size_t nextTexHandle  = NextTextureHandle( alias );
-    m_textures[ nextTexHandle ] = texture;
-    return TextureHandle( nextTexHandle );
+    std::lock_guard     lock( m_textureLock );
+    const TextureHandle handle( m_textures.Insert( texture ) );
+    if ( handle.IsValid( ) )
+    {
+        m_texAliases[ alias ] = handle;
+    }
+    return handle;
 }
 
 MaterialHandle MaterialBatch::AddMaterial( const std::string &alias, MaterialDataRequest material )
 {
-    const size_t nextMatHandle              = NextMaterialHandle( alias );
-    m_materialData[ nextMatHandle ]         = std::make_unique<MaterialData>( material );
-    m_materialData[ nextMatHandle ]->Handle = MaterialHandle( nextMatHandle );
-    return MaterialHandle( nextMatHandle );
+    auto                 materialData = std::make_unique<MaterialData>( material );
+    MaterialData        *data         = materialData.get( );
+    std::lock_guard      lock( m_materialLock );
+    const MaterialHandle handle( m_materialData.Insert( std::move( materialData ) ) );
+    if ( handle.IsValid( ) )
+    {
+        data->Handle          = handle;
+        m_matAliases[ alias ] = handle;
+    }
+    return handle;
 }
 
-MaterialData *MaterialBatch::GetMaterial( const std::string &alias ) const
+bool MaterialBatch::RemoveTexture( const TextureHandle handle )
 {
-    const auto it = m_matAliases.find( alias );
-    if ( it == m_matAliases.end( ) )
+    std::lock_guard lock( m_textureLock );
+    if ( !m_textures.Remove( handle.Id ) )
     {
-        return nullptr;
+        spdlog::error( "MaterialBatch::RemoveTexture - Invalid handle: {}", handle.Id );
+        return false;
     }
-    return m_materialData[ it->second.Id ].get( );
+    m_loadedTextures.erase( handle.Id );
+    std::erase_if( m_texAliases, [ & ]( const auto &alias ) { return alias.second == handle; } );
+    return true;
 }
 
-MaterialData *MaterialBatch::GetMaterial( const MaterialHandle handle ) const
+bool MaterialBatch::RemoveMaterial( const MaterialHandle handle )
 {
-    if ( handle.Id >= m_materialData.size( ) )
+    std::lock_guard lock( m_materialLock );
+    if ( !m_materialData.Remove( handle.Id ) )
     {
-        return nullptr;
+        spdlog::error( "MaterialBatch::RemoveMaterial - Invalid handle: {}", handle.Id );
+        return false;
     }
-    return m_materialData[ handle.Id ].get( );
+    std::erase_if( m_matAliases, [ & ]( const auto &alias ) { return alias.second == handle; } );
+    return true;
 }
 
-ITextureResource *MaterialBatch::GetTexture( const std::string &alias ) const
+bool MaterialBatch::ReplaceTexture( const TextureHandle target, const TextureHandle replacement )
 {
-    const auto it = m_texAliases.find( alias );
-    if ( it == m_texAliases.end( ) )
+    std::lock_guard          lock( m_textureLock );
+    ITextureResource **const targetTexture      = m_textures.Find( target.Id );
+    ITextureResource **const replacementTexture = m_textures.Find( replacement.Id );
+    if ( !targetTexture || !replacementTexture )
     {
-        return nullptr;
+        spdlog::error( "MaterialBatch::ReplaceTexture - Invalid handle: {} or {}", target.Id, replacement.Id );
+        return false;
+    }
+    // The bindless slot of target now holds the new texture
+    std::swap( *targetTexture, *replacementTexture );
+    std::swap( m_loadedTextures[ target.Id ], m_loadedTextures[ replacement.Id ] );
+    std::erase_if( m_loadedTextures, []( const auto &loaded ) { return loaded.second == nullptr; } );
+    for ( TextureHandle &handle : m_texAliases | std::views::values )
+    {
+        handle = handle == replacement ? target : handle;
     }
-    return m_textures[ it->second.Id ];
+    return true;
 }
 
-ITextureResource *MaterialBatch::GetTexture( const TextureHandle handle ) const
+bool MaterialBatch::ReplaceMaterial( const MaterialHandle target, const MaterialHandle replacement )
 {
-    if ( handle.Id >= m_textures.size( ) )
+    std::lock_guard                      lock( m_materialLock );
+    const std::unique_ptr<MaterialData> *targetData      = m_materialData.Find( target.Id );
+    const std::unique_ptr<MaterialData> *replacementData = m_materialData.Find( replacement.Id );
+    if ( !targetData || !replacementData )
     {
-        return nullptr;
+        spdlog::error( "MaterialBatch::ReplaceMaterial - Invalid handle: {} or {}", target.Id, replacement.Id );
+        return false;
     }
-    return m_textures[ handle.Id ];
+    std::swap( static_cast<MaterialDataRequest &>( **targetData ), static_cast<MaterialDataRequest &>( **replacementData ) );
+    for ( MaterialHandle &handle : m_matAliases | std::views::values )
+    {
+        handle = handle == replacement ? target : handle;
+    }
+    return true;
 }
 
-std::vector<TextureData> MaterialBatch::GetTextures( ) const
+MaterialData *MaterialBatch::GetMaterial( const std::string &alias ) const
 {
-    std::vector<TextureData> textures;
-    for ( int i = 0; i < m_textures.size( ); i++ )
+    std::shared_lock lock( m_materialLock );
+    const auto       it = m_matAliases.find( alias );
+    if ( it == m_matAliases.end( ) )
     {
-        const TextureHandle texHandle( i );
-        textures.push_back( { texHandle, m_textures[ i ] } );
+        return nullptr;
     }
-    return textures;
+    return m_materialData.Find( it->second.Id )->get( );
 }
 
-size_t MaterialBatch::NextTextureHandle( const std::string &alias )
+MaterialData *MaterialBatch::GetMaterial( const MaterialHandle handle ) const
 {
-    std::lock_guard lock( m_nextTexHandleLock );
-    m_nextTexHandle++;
-    if ( m_nextTexHandle >= m_textures.size( ) )
-    {
-        m_textures.resize( m_nextTexHandle + 1 );
-    }
-    m_texAliases[ alias ] = TextureHandle( m_nextTexHandle );
-    return m_nextTexHandle;
+    std::shared_lock lock( m_materialLock );
+    const auto      *materialData = m_materialData.Find( handle.Id );
+    return materialData ? materialData->get( ) : nullptr;
 }
 
-size_t MaterialBatch::NextMaterialHandle( const std::string &alias )
+ITextureResource *MaterialBatch::GetTexture( const std::string &alias ) const
 {
-    std::lock_guard lock( m_nextMatHandleLock );
-    m_nextMatHandle++;
-    if ( m_nextMatHandle >= m_materialData.size( ) )
+    std::shared_lock lock( m_textureLock );
+    const auto       it = m_texAliases.find( alias );
+    if ( it == m_texAliases.end( ) )
     {
-        m_materialData.resize( m_nextMatHandle + 1 );
+        return nullptr;
     }
-    m_matAliases[ alias ] = MaterialHandle( m_nextMatHandle );
-    return m_nextMatHandle;
+    return *m_textures.Find( it->second.Id );
+}
+
+ITextureResource *MaterialBatch::GetTexture( const TextureHandle handle ) const
+{
+    std::shared_lock lock( m_textureLock );
+    const auto       texture = m_textures.Find( handle.Id );
+    return texture ? *texture : nullptr;
+}
+
+uint32_t MaterialBatch::GetTextureIndex( const TextureHandle handle ) const
+{
+    // A stale handle's index may already belong to the texture that reused the slot
+    std::shared_lock lock( m_textureLock );
+    return m_textures.Contains( handle.Id ) ? handle.Index( ) : 0;
+}
+
+std::vector<TextureData> MaterialBatch::GetTextures( ) const
+{
+    std::shared_lock         lock( m_textureLock );
+    std::vector<TextureData> textures;
+    textures.reserve( m_textures.Size( ) );
+    m_textures.ForEach( [ & ]( const uint32_t id, ITextureResource *texture ) { textures.push_back( { TextureHandle( id ), texture } ); } );
+    return textures;
 }
@@ -18,6 +18,9 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 
 #include "DZEngine/Assets/MeshAssetData.h"
 
+#include <algorithm>
+#include <cstring>
+
 using namespace DZEngine;
 
 MeshAssetData MeshAssetData::LoadFromMeshAsset( const MeshAsset &meshAsset )
@@ -83,6 +86,28 @@ MeshAssetData MeshAssetData::LoadFromMeshAsset( const MeshAsset &meshAsset )
         data.SubMeshes.push_back( subMesh );
     }
 
+    for ( uint32_t i = 0; i < meshAsset.UserProperties.NumElements; ++i )
+    {
+        const DenOfIz::UserProperty &property = meshAsset.UserProperties.Elements[ i ];
+        if ( property.PropertyType != DenOfIz::UserProperty::Type::Float4 || !property.Name.Get( ) || std::strcmp( property.Name.Get( ), SubMeshLOD::PropertyName ) != 0 )
+        {
+            continue;
+        }
+
+        const auto baseIndex = static_cast<uint32_t>( property.Vector4Value.X );
+        const auto lodIndex  = static_cast<uint32_t>( property.Vector4Value.Y );
+        if ( baseIndex >= data.SubMeshes.size( ) || lodIndex >= data.SubMeshes.size( ) || baseIndex == lodIndex )
+        {
+            continue;
+        }
+        data.SubMeshes[ baseIndex ].LODs.push_back( SubMeshLOD{ lodIndex, property.Vector4Value.W } );
+        data.SubMeshes[ lodIndex ].LODOf = static_cast<int32_t>( baseIndex );
+    }
+    for ( SubMeshData &subMesh : data.SubMeshes )
+    {
+        std::ranges::sort( subMesh.LODs, { }, &SubMeshLOD::Error );
+    }
+
     data.MorphTargetDeltaAttributes.Position = meshAsset.MorphTargetDeltaAttributes.Position;
     data.MorphTargetDeltaAttributes.Normal   = meshAsset.MorphTargetDeltaAttributes.Normal;
     data.MorphTargetDeltaAttributes.Tangent  = meshAsset.MorphTargetDeltaAttributes.Tangent;
@@ -158,6 +183,69 @@ size_t MeshAssetData::GetVertexNumBytes( ) const
     return numBytes;
 }
 
+void MeshAssetData::UnpackVertices( const Byte *data, const size_t numVertices, StaticMeshVertex *outVertices ) const
+{
+    const size_t stride = GetVertexNumBytes( );
+    for ( size_t i = 0; i < numVertices; ++i )
+    {
+        const auto      *floats = reinterpret_cast<const float *>( data + i * stride );
+        StaticMeshVertex vertex{ };
+        vertex.Position = { 0.0f, 0.0f, 0.0f, 1.0f };
+        vertex.Color    = { 1.0f, 1.0f, 1.0f, 1.0f };
+
+        if ( EnabledAttributes.Position )
+        {
+            vertex.Position = { floats[ 0 ], floats[ 1 ], floats[ 2 ], floats[ 3 ] };
+            floats += 4;
+        }
+        if ( EnabledAttributes.Normal )
+        {
+            vertex.Normal = { floats[ 0 ], floats[ 1 ], floats[ 2 ], floats[ 3 ] };
+            floats += 4;
+        }
+        if ( EnabledAttributes.UV )
+        {
+            if ( AttributeConfig.NumUVAttributes > 0 )
+            {
+                vertex.TexCoord = { floats[ 0 ], floats[ 1 ] };
+            }
+            floats += AttributeConfig.NumUVAttributes * 2;
+        }
+        if ( EnabledAttributes.Color )
+        {
+            for ( size_t c = 0; c < AttributeConfig.ColorFormats.size( ); ++c )
+            {
+                uint32_t numComponents = 4;
+                switch ( AttributeConfig.ColorFormats[ c ] )
+                {
+                case ColorFormat::RGBA:
+                    numComponents = 4;
+                    break;
+                case ColorFormat::RGB:
+                    numComponents = 3;
+                    break;
+                case ColorFormat::RG:
+                    numComponents = 2;
+                    break;
+                case ColorFormat::R:
+                    numComponents = 1;
+                    break;
+                }
+                if ( c == 0 )
+                {
+                    std::memcpy( &vertex.Color, floats, numComponents * sizeof( float ) );
+                }
+                floats += numComponents;
+            }
+        }
+        if ( EnabledAttributes.Tangent )
+        {
+            vertex.Tangent = { floats[ 0 ], floats[ 1 ], floats[ 2 ], floats[ 3 ] };
+        }
+        outVertices[ i ] = vertex;
+    }
+}
+
 size_t MeshAssetData::GetTotalNumVertices( ) const
 {
     size_t count = 0;
@@ -0,0 +1,347 @@
+/*
+Den Of Iz - Game/Game Engine
+Copyright (c) 2020-2024 Muhammed Murat Cengiz
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "DZEngine/Assets/MeshAssetProcessor.h"
+#include <DenOfIzGraphics/Assets/Serde/Mesh/MeshAssetReader.h>
+#include <DenOfIzGraphics/Assets/Serde/Mesh/MeshAssetWriter.h>
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <spdlog/spdlog.h>
+#include "DZEngine/Assets/MeshAssetData.h"
+
+using namespace DZEngine;
+
+namespace
+{
+    struct SubMeshStreams
+    {
+        std::vector<Byte>     Vertices; // As stored in the asset, MeshAssetData::GetVertexNumBytes each
+        std::vector<uint32_t> Indices;
+    };
+
+    uint32_t NumColorComponents( const ColorFormat format )
+    {
+        switch ( format )
+        {
+        case ColorFormat::RGBA:
+            return 4;
+        case ColorFormat::RGB:
+            return 3;
+        case ColorFormat::RG:
+            return 2;
+        case ColorFormat::R:
+            return 1;
+        }
+        return 4;
+    }
+
+    // The writer takes MeshVertex, its arrays point into data and outColors
+    MeshVertex DecodeVertex( const MeshAssetData &layout, Byte *data, std::vector<Float4> &outColors )
+    {
+        MeshVertex vertex{ };
+        auto      *floats = reinterpret_cast<float *>( data );
+        const auto read4  = [ & ]
+        {
+            const Float4 value{ floats[ 0 ], floats[ 1 ], floats[ 2 ], floats[ 3 ] };
+            floats += 4;
+            return value;
+        };
+
+        if ( layout.EnabledAttributes.Position )
+        {
+            vertex.Position = read4( );
+        }
+        if ( layout.EnabledAttributes.Normal )
+        {
+            vertex.Normal = read4( );
+        }
+        if ( layout.EnabledAttributes.UV )
+        {
+            vertex.UVs = Float2Array{ reinterpret_cast<Float2 *>( floats ), layout.AttributeConfig.NumUVAttributes };
+            floats += layout.AttributeConfig.NumUVAttributes * 2;
+        }
+        if ( layout.EnabledAttributes.Color )
+        {
+            outColors.clear( );
+            for ( const ColorFormat format : layout.AttributeConfig.ColorFormats )
+            {
+                Float4         color{ 0.0f, 0.0f, 0.0f, 1.0f };
+                const uint32_t numComponents = NumColorComponents( format );
+                std::memcpy( &color, floats, numComponents * sizeof( float ) );
+                outColors.push_back( color );
+                floats += numComponents;
+            }
+            vertex.Colors = Float4Array{ outColors.data( ), outColors.size( ) };
+        }
+        if ( layout.EnabledAttributes.Tangent )
+        {
+            vertex.Tangent = read4( );
+        }
+        if ( layout.EnabledAttributes.Bitangent )
+        {
+            vertex.Bitangent = read4( );
+        }
+        if ( layout.EnabledAttributes.BlendIndices )
+        {
+            auto *indices       = reinterpret_cast<uint32_t *>( floats ) + 1; // After the number of influences
+            vertex.BlendIndices = UInt32Array{ indices, layout.AttributeConfig.NumBoneInfluences };
+            floats += 1 + layout.AttributeConfig.NumBoneInfluences;
+        }
+        if ( layout.EnabledAttributes.BlendWeights )
+        {
+            vertex.BoneWeights = FloatArray{ floats, layout.AttributeConfig.NumBoneInfluences };
+        }
+        return vertex;
+    }
+} // namespace
+
+bool MeshAssetProcessor::Process( const std::filesystem::path &meshPath, const MeshAssetProcessorDesc &desc, MeshAssetProcessorStats *outStats )
+{
+    MeshAssetProcessorStats stats{ };
+    if ( outStats )
+    {
+        *outStats = stats;
+    }
+    if ( !desc.Optimize && desc.LODs.NumLevels == 0 )
+    {
+        return true;
+    }
+
+    std::unique_ptr<MeshAsset>  meshAsset;
+    std::vector<SubMeshStreams> streams;
+    {
+        BinaryReader        reader( meshPath.string( ).c_str( ) );
+        MeshAssetReaderDesc readerDesc{ };
+        readerDesc.Reader = &reader;
+        MeshAssetReader meshReader( readerDesc );
+        meshAsset.reset( meshReader.Read( ) );
+        if ( !meshAsset )
+        {
+            spdlog::error( "MeshAssetProcessor: Failed to read {}", meshPath.string( ) );
+            return false;
+        }
+
+        const auto isConvexHull  = []( const DenOfIz::BoundingVolume &bv ) { return bv.Type == BoundingVolumeType::ConvexHull; };
+        const auto hasConvexHull = [ & ]( const DenOfIz::SubMeshData &subMesh )
+        { return std::ranges::any_of( std::span( subMesh.BoundingVolumes.Elements, subMesh.BoundingVolumes.NumElements ), isConvexHull ); };
+        const auto isLOD = []( const DenOfIz::UserProperty &property ) { return property.Name.Get( ) && std::strcmp( property.Name.Get( ), SubMeshLOD::PropertyName ) == 0; };
+
+        const std::span subMeshes( meshAsset->SubMeshes.Elements, meshAsset->SubMeshes.NumElements );
+        const bool      built = std::ranges::any_of( std::span( meshAsset->UserProperties.Elements, meshAsset->UserProperties.NumElements ), isLOD );
+        if ( built || meshAsset->MorphTargets.NumElements > 0 || !meshAsset->EnabledAttributes.Position || std::ranges::any_of( subMeshes, hasConvexHull ) )
+        {
+            spdlog::info( "MeshAssetProcessor: Kept {} as it is", meshPath.string( ) );
+            return true;
+        }
+
+        streams.reserve( subMeshes.size( ) * ( 1 + desc.LODs.NumLevels ) ); // Levels read the streams of their base while appending their own
+        for ( const DenOfIz::SubMeshData &subMesh : subMeshes )
+        {
+            SubMeshStreams  &subMeshStreams = streams.emplace_back( );
+            LoadToMemoryDesc loadDesc{ };
+            subMeshStreams.Vertices.resize( subMesh.VertexStream.NumBytes );
+            loadDesc.Stream = subMesh.VertexStream;
+            loadDesc.Memory = ByteArray{ subMeshStreams.Vertices.data( ), subMeshStreams.Vertices.size( ) };
+            meshReader.LoadStreamToMemory( loadDesc );
+
+            std::vector<Byte> indices( subMesh.IndexStream.NumBytes );
+            loadDesc.Stream = subMesh.IndexStream;
+            loadDesc.Memory = ByteArray{ indices.data( ), indices.size( ) };
+            meshReader.LoadStreamToMemory( loadDesc );
+            const bool   is16Bit    = subMesh.IndexType == IndexType::Uint16;
+            const size_t numIndices = std::min<size_t>( subMesh.NumIndices, indices.size( ) / ( is16Bit ? sizeof( uint16_t ) : sizeof( uint32_t ) ) );
+            subMeshStreams.Indices.resize( numIndices );
+            for ( size_t i = 0; i < numIndices; ++i )
+            {
+                uint16_t index16;
+                if ( is16Bit )
+                {
+                    std::memcpy( &index16, indices.data( ) + i * sizeof( uint16_t ), sizeof( uint16_t ) );
+                    subMeshStreams.Indices[ i ] = index16;
+                }
+                else
+                {
+                    std::memcpy( &subMeshStreams.Indices[ i ], indices.data( ) + i * sizeof( uint32_t ), sizeof( uint32_t ) );
+                }
+            }
+        }
+    }
+
+    const MeshAssetData layout       = MeshAssetData::LoadFromMeshAsset( *meshAsset );
+    const size_t        vertexStride = layout.GetVertexNumBytes( );
+    const uint32_t      numBase      = meshAsset->SubMeshes.NumElements;
+
+    std::vector<DenOfIz::SubMeshData>  subMeshes( meshAsset->SubMeshes.Elements, meshAsset->SubMeshes.Elements + numBase );
+    std::vector<DenOfIz::UserProperty> properties( meshAsset->UserProperties.Elements, meshAsset->UserProperties.Elements + meshAsset->UserProperties.NumElements );
+    size_t                             numOptimizedTriangles = 0;
+    size_t                             numTransformedBefore  = 0;
+    size_t                             numTransformedAfter   = 0;
+    for ( uint32_t baseIndex = 0; baseIndex < numBase; ++baseIndex )
+    {
+        const DenOfIz::SubMeshData &base        = meshAsset->SubMeshes.Elements[ baseIndex ];
+        size_t                      numVertices = vertexStride > 0 ? std::min<size_t>( base.NumVertices, streams[ baseIndex ].Vertices.size( ) / vertexStride ) : 0;
+        if ( base.Topology != PrimitiveTopology::Triangle || numVertices == 0 || streams[ baseIndex ].Indices.size( ) < 3 )
+        {
+            continue;
+        }
+
+        if ( desc.Optimize )
+        {
+            SubMeshStreams &baseStreams = streams[ baseIndex ];
+            numOptimizedTriangles += baseStreams.Indices.size( ) / 3;
+            numTransformedBefore  += MeshOptimizer::AnalyzeVertexCache( baseStreams.Indices, numVertices ).NumTransformed;
+            numVertices            = MeshOptimizer::Optimize( baseStreams.Vertices.data( ), numVertices, vertexStride, baseStreams.Indices );
+            numTransformedAfter   += MeshOptimizer::AnalyzeVertexCache( baseStreams.Indices, numVertices ).NumTransformed;
+
+            baseStreams.Vertices.resize( numVertices * vertexStride );
+            subMeshes[ baseIndex ].NumVertices = numVertices;
+            subMeshes[ baseIndex ].NumIndices  = baseStreams.Indices.size( );
+            stats.NumOptimized++;
+        }
+        if ( desc.LODs.NumLevels == 0 )
+        {
+            continue;
+        }
+
+        MeshSimplifierDesc simplifierDesc{ };
+        simplifierDesc.Positions         = reinterpret_cast<const float *>( streams[ baseIndex ].Vertices.data( ) );
+        simplifierDesc.PositionStride    = vertexStride;
+        simplifierDesc.NumVertices       = numVertices;
+        simplifierDesc.Indices           = streams[ baseIndex ].Indices;
+        std::vector<MeshLODLevel> levels = MeshSimplifier::BuildLODChain( simplifierDesc, desc.LODs );
+        for ( size_t level = 0; level < levels.size( ); ++level )
+        {
+            if ( desc.Optimize )
+            {
+                MeshOptimizer::OptimizeVertexCache( levels[ level ].Indices, numVertices );
+                MeshOptimizer::OptimizeOverdraw( levels[ level ].Indices, streams[ baseIndex ].Vertices.data( ), numVertices, vertexStride );
+                stats.NumOptimized++;
+            }
+
+            // Only the referenced vertices are kept, in the order of their first use, which is the vertex fetch order of an optimized level
+            SubMeshStreams       &lodStreams = streams.emplace_back( );
+            std::vector<uint32_t> remap( numVertices, ~0u );
+            Float3                minBounds{ FLT_MAX, FLT_MAX, FLT_MAX };
+            Float3                maxBounds{ -FLT_MAX, -FLT_MAX, -FLT_MAX };
+            for ( const uint32_t index : levels[ level ].Indices )
+            {
+                if ( remap[ index ] == ~0u )
+                {
+                    remap[ index ]     = static_cast<uint32_t>( lodStreams.Vertices.size( ) / vertexStride );
+                    const Byte *vertex = streams[ baseIndex ].Vertices.data( ) + index * vertexStride;
+                    lodStreams.Vertices.insert( lodStreams.Vertices.end( ), vertex, vertex + vertexStride );
+
+                    const auto *position = reinterpret_cast<const float *>( vertex );
+                    minBounds            = Float3{ std::min( minBounds.X, position[ 0 ] ), std::min( minBounds.Y, position[ 1 ] ), std::min( minBounds.Z, position[ 2 ] ) };
+                    maxBounds            = Float3{ std::max( maxBounds.X, position[ 0 ] ), std::max( maxBounds.Y, position[ 1 ] ), std::max( maxBounds.Z, position[ 2 ] ) };
+                }
+                lodStreams.Indices.push_back( remap[ index ] );
+            }
+
+            const auto            lodIndex = static_cast<uint32_t>( subMeshes.size( ) );
+            DenOfIz::SubMeshData &lod      = subMeshes.emplace_back( base );
+            lod.Name                       = ( std::string( base.Name.Get( ) ? base.Name.Get( ) : "" ) + "_LOD" + std::to_string( level + 1 ) ).c_str( );
+            lod.NumVertices                = lodStreams.Vertices.size( ) / vertexStride;
+            lod.NumIndices                 = lodStreams.Indices.size( );
+            lod.IndexType                  = lod.NumVertices <= 65536 && base.IndexType == IndexType::Uint16 ? IndexType::Uint16 : IndexType::Uint32;
+            lod.VertexStream               = AssetDataStream{ };
+            lod.IndexStream                = AssetDataStream{ };
+            lod.MinBounds                  = minBounds;
+            lod.MaxBounds                  = maxBounds;
+
+            DenOfIz::UserProperty &property = properties.emplace_back( );
+            property.Name                   = SubMeshLOD::PropertyName;
+            property.PropertyType           = DenOfIz::UserProperty::Type::Float4;
+            property.Vector4Value           = Float4{ static_cast<float>( baseIndex ), static_cast<float>( lodIndex ), static_cast<float>( level + 1 ), levels[ level ].Error };
+
+            stats.NumLODs++;
+            stats.NumLODTriangles += levels[ level ].Indices.size( ) / 3;
+        }
+        if ( !levels.empty( ) )
+        {
+            stats.NumSubMeshes++;
+            stats.NumBaseTriangles += streams[ baseIndex ].Indices.size( ) / 3;
+            stats.MaxError = std::max( stats.MaxError, levels.back( ).Error );
+        }
+    }
+    if ( stats.NumLODs == 0 && stats.NumOptimized == 0 )
+    {
+        return true;
+    }
+    if ( numOptimizedTriangles > 0 )
+    {
+        stats.ACMRBefore = static_cast<float>( numTransformedBefore ) / static_cast<float>( numOptimizedTriangles );
+        stats.ACMRAfter  = static_cast<float>( numTransformedAfter ) / static_cast<float>( numOptimizedTriangles );
+    }
+
+    // Written next to the asset and renamed over it, so a failed write leaves the imported asset intact
+    const std::filesystem::path tempPath = meshPath.string( ) + ".tmp";
+    {
+        const SubMeshDataArray  previousSubMeshes  = meshAsset->SubMeshes;
+        const UserPropertyArray previousProperties = meshAsset->UserProperties;
+        meshAsset->SubMeshes                       = SubMeshDataArray{ subMeshes.data( ), static_cast<uint32_t>( subMeshes.size( ) ) };
+        meshAsset->UserProperties                  = UserPropertyArray{ properties.data( ), static_cast<uint32_t>( properties.size( ) ) };
+
+        BinaryWriter        writer( tempPath.string( ).c_str( ) );
+        MeshAssetWriterDesc writerDesc{ };
+        writerDesc.Writer = &writer;
+        MeshAssetWriter meshWriter( writerDesc );
+        meshWriter.Write( *meshAsset );
+
+        std::vector<Float4> colors;
+        for ( size_t i = 0; i < subMeshes.size( ); ++i )
+        {
+            for ( size_t offset = 0; offset + vertexStride <= streams[ i ].Vertices.size( ); offset += vertexStride )
+            {
+                meshWriter.AddVertex( DecodeVertex( layout, streams[ i ].Vertices.data( ) + offset, colors ) );
+            }
+            for ( const uint32_t index : streams[ i ].Indices )
+            {
+                if ( subMeshes[ i ].IndexType == IndexType::Uint16 )
+                {
+                    meshWriter.AddIndex16( static_cast<uint16_t>( index ) );
+                }
+                else
+                {
+                    meshWriter.AddIndex32( index );
+                }
+            }
+        }
+        meshWriter.FinalizeAsset( );
+        writer.Flush( );
+
+        // The arrays of the asset live in its arena
+        meshAsset->SubMeshes      = previousSubMeshes;
+        meshAsset->UserProperties = previousProperties;
+    }
+
+    std::error_code error;
+    std::filesystem::rename( tempPath, meshPath, error );
+    if ( error )
+    {
+        spdlog::error( "MeshAssetProcessor: Failed to replace {}: {}", meshPath.string( ), error.message( ) );
+        std::filesystem::remove( tempPath, error );
+        return false;
+    }
+    if ( outStats )
+    {
+        *outStats = stats;
+    }
+    return true;
+}
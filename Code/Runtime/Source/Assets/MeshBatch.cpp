@@ -17,14 +17,20 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 */
 
 #include "DZEngine/Assets/MeshBatch.h"
+#include "DZEngine/Assets/MeshOptimizer.h"
 #include "DZEngine/Assets/StaticMeshVertex.h"
 #include "DZEngine/Math/Math.h"
 
+#include <cstring>
+#include <ranges>
 #include <spdlog/spdlog.h>
 
 using namespace DZEngine;
 
-MeshBatch::MeshBatch( const MeshBatchDesc &desc ) : m_logicalDevice( desc.LogicalDevice ), m_geometryLayout( desc.GeometryLayout )
+MeshBatch::MeshBatch( const MeshBatchDesc &desc ) : m_logicalDevice( desc.LogicalDevice ), m_geometryLayout( desc.GeometryLayout ), m_vertexFormat( desc.VertexFormat ),
+    m_separatePositionStream( desc.SeparatePositionStream && desc.GeometryLayout == GeometryLayout::GPUDriven ), m_allow16BitIndices( desc.Allow16BitIndices ),
+    m_optimizeGeometry( desc.OptimizeGeometry ), m_pool( desc.Pool ), m_reservedVertices( desc.ReservedVertexBytes / VertexQuantization::VertexStride( desc.VertexFormat ) ),
+    m_reservedIndexUnits( desc.ReservedIndexBytes / IndexAllocationUnit )
 {
     if ( !m_logicalDevice )
     {
@@ -33,29 +39,51 @@ MeshBatch::MeshBatch( const MeshBatchDesc &desc ) : m_logicalDevice( desc.Logica
     }
     m_batchResourceCopy = std::make_unique<BatchResourceCopy>( m_logicalDevice );
 
-    BufferDesc vertexBufferDesc{ };
-    vertexBufferDesc.Descriptor = ResourceDescriptor::VertexBuffer;
-    vertexBufferDesc.NumBytes   = desc.MaxVertexBufferBytes;
-    vertexBufferDesc.HeapType   = HeapType::GPU;
-    vertexBufferDesc.Usages     = ResourceUsage::CopyDst;
-    vertexBufferDesc.DebugName  = "Mesh Pool Vertex Buffer";
-    if ( m_geometryLayout == GeometryLayout::GPUDriven )
+    if ( m_pool && !m_pool->IsCompatible( m_geometryLayout, m_vertexFormat, m_separatePositionStream ) )
     {
-        vertexBufferDesc.Descriptor                = ResourceDescriptor::StructuredBuffer;
-        vertexBufferDesc.StructureDesc.NumElements = desc.MaxVertexBufferBytes / sizeof( StaticMeshVertex ); // TODO dynamic
-        vertexBufferDesc.StructureDesc.Stride      = sizeof( StaticMeshVertex );                             // TODO dynamic
+        spdlog::error( "MeshBatch: GeometryPool layout or vertex format doesn't match the batch, using a private pool" );
+        m_pool = nullptr;
+    }
+    if ( !m_pool )
+    {
+        GeometryPoolDesc poolDesc{ };
+        poolDesc.LogicalDevice          = m_logicalDevice;
+        poolDesc.GeometryLayout         = m_geometryLayout;
+        poolDesc.VertexFormat           = m_vertexFormat;
+        poolDesc.SeparatePositionStream = m_separatePositionStream;
+        poolDesc.InitialVertexBytes     = desc.ReservedVertexBytes;
+        poolDesc.InitialIndexBytes      = desc.ReservedIndexBytes;
+        poolDesc.MaxVertexBufferBytes   = desc.MaxVertexBufferBytes;
+        poolDesc.MaxIndexBufferBytes    = desc.MaxIndexBufferBytes;
+        m_ownedPool                     = std::make_unique<GeometryPool>( poolDesc );
+        m_pool                          = m_ownedPool.get( );
+    }
+    m_pool->Reserve( GeometryStream::Vertices, m_reservedVertices );
+    m_pool->Reserve( GeometryStream::Indices, m_reservedIndexUnits );
+
+    if ( desc.UploadBufferNumBytes > 0 )
+    {
+        m_uploadBuffer = std::make_unique<UploadBuffer>( UploadBufferDesc{ m_logicalDevice, desc.UploadBufferNumBytes } );
     }
-    m_vertexBuffer = std::unique_ptr<IBufferResource>( m_logicalDevice->CreateBufferResource( vertexBufferDesc ) );
 
-    BufferDesc indexBufferDesc{ };
-    indexBufferDesc.Descriptor = ResourceDescriptor::IndexBuffer;
-    indexBufferDesc.NumBytes   = desc.MaxIndexBufferBytes;
-    indexBufferDesc.HeapType   = HeapType::GPU;
-    indexBufferDesc.Usages     = ResourceUsage::CopyDst;
-    indexBufferDesc.DebugName  = "Mesh Pool Index Buffer";
-    m_indexBuffer              = std::unique_ptr<IBufferResource>( m_logicalDevice->CreateBufferResource( indexBufferDesc ) );
+    m_meshes.reserve( 1024 );
+}
 
-    m_meshes.resize( 1024 );
+MeshBatch::~MeshBatch( )
+{
+    // Only a shared pool outlives the batch
+    if ( m_ownedPool )
+    {
+        return;
+    }
+    for ( const auto &ranges : m_meshRanges | std::views::values )
+    {
+        m_pool->Free( GeometryStream::Vertices, ranges.Vertices );
+        m_pool->Free( GeometryStream::Indices, ranges.Indices );
+    }
+    ReleaseDefragmentSources( m_defragmentVersion );
+    m_pool->Unreserve( GeometryStream::Vertices, m_reservedVertices );
+    m_pool->Unreserve( GeometryStream::Indices, m_reservedIndexUnits );
 }
 
 void MeshBatch::BeginUpdate( )
@@ -65,42 +93,90 @@ void MeshBatch::BeginUpdate( )
         m_batchResourceCopy = std::make_unique<BatchResourceCopy>( m_logicalDevice );
     }
     m_batchResourceCopy->Begin( );
+    m_updateThread = std::this_thread::get_id( );
+    m_hasUploads   = false;
+    m_updating     = true;
 }
 
 void MeshBatch::EndUpdate( ISemaphore *onComplete )
 {
-    if ( !m_batchResourceCopy )
+    if ( !m_batchResourceCopy || !m_updating )
     {
         spdlog::error( "BeginUpdate not called" );
         return;
     }
+
+    {
+        std::unique_lock geometryLock( m_geometryLock );
+        std::lock_guard  copyLock( m_threadCopyLock );
+        for ( auto &copy : m_threadCopies | std::views::values )
+        {
+            if ( !onComplete )
+            {
+                copy->Submit( nullptr );
+                continue;
+            }
+            auto semaphore = std::unique_ptr<ISemaphore>( m_logicalDevice->CreateSemaphore( ) );
+            copy->Submit( semaphore.get( ) );
+            m_submittedCopies.push_back( SubmittedCopy{ std::move( copy ), std::move( semaphore ) } );
+        }
+        m_threadCopies.clear( );
+        m_updating = false;
+    }
+
     m_batchResourceCopy->Submit( onComplete );
     if ( !onComplete )
     {
         m_batchResourceCopy.reset( );
+        CommitDefragment( );
+        ReleaseUploads( );
     }
 }
 
+bool MeshBatch::IsUpdateComplete( )
+{
+    std::lock_guard lock( m_threadCopyLock );
+    std::erase_if( m_submittedCopies, []( const SubmittedCopy &submitted ) { return submitted.Semaphore->IsCompleted( ); } );
+    return m_submittedCopies.empty( );
+}
+
 GPUMesh MeshBatch::AddMesh( BinaryReader &reader, const std::vector<std::string> &aliases )
 {
+    if ( !m_updating )
+    {
+        spdlog::error( "AddMesh: BeginUpdate not called" );
+        return GPUMesh{ };
+    }
+
     MeshAssetReaderDesc meshReaderDesc{ };
     meshReaderDesc.Reader = &reader;
     MeshAssetReader                  meshAssetReader( meshReaderDesc );
     const std::unique_ptr<MeshAsset> meshAsset( meshAssetReader.Read( ) );
 
-    const auto  &meshAssetData = m_meshDataStorage.emplace_back( std::make_unique<MeshAssetData>( MeshAssetData::LoadFromMeshAsset( *meshAsset ) ) );
-    const size_t vertexOffset  = m_nextVertexOffset;
-    const size_t indexOffset   = m_nextIndexOffset;
+    auto         meshAssetData = std::make_unique<MeshAssetData>( MeshAssetData::LoadFromMeshAsset( *meshAsset ) );
+    const size_t vertexStride  = m_vertexFormat == VertexFormat::Compact ? GetVertexStride( ) : meshAssetData->GetVertexNumBytes( );
+    size_t       numIndexBytes = 0;
+    for ( const auto &subMeshData : meshAssetData->SubMeshes )
     {
-        std::lock_guard lock( m_newMeshLock );
-        m_nextVertexOffset = m_nextVertexOffset + meshAssetData->GetTotalNumVertices( ) * meshAssetData->GetVertexNumBytes( );
-        m_nextIndexOffset  = m_nextIndexOffset + meshAssetData->GetTotalNumIndices( ) * sizeof( uint32_t );
+        numIndexBytes += IndexRangeNumBytes( subMeshData.NumIndices, SelectIndexType( subMeshData.NumVertices ) );
     }
 
-    const size_t parentMeshIndex = m_meshes.size( );
-    GPUMesh     &newGPUMesh      = m_meshes.emplace_back( GPUMesh{ } );
-    newGPUMesh.Metadata          = meshAssetData.get( );
+    const size_t numVertices = ( meshAssetData->GetTotalNumVertices( ) * vertexStride + GetVertexStride( ) - 1 ) / GetVertexStride( );
+    MeshRanges   ranges{ };
+    if ( !AllocateRanges( numVertices, numIndexBytes, ranges ) )
+    {
+        spdlog::error( "MeshBatch: Not enough geometry space for {}", meshAssetData->Name );
+        return GPUMesh{ };
+    }
+    size_t vertexOffset = ranges.Vertices.Offset * GetVertexStride( );
+    size_t indexOffset  = ranges.Indices.IsValid( ) ? ranges.Indices.Offset * IndexAllocationUnit : 0;
+
+    GPUMesh newGPUMesh{ };
+    newGPUMesh.Metadata = meshAssetData.get( );
+    std::vector<std::string> subMeshAliases;
 
+    std::shared_lock   geometryLock( m_geometryLock );
+    BatchResourceCopy *copy = ThreadCopy( );
     for ( uint32_t meshIndex = 0; meshIndex < meshAsset->SubMeshes.NumElements; ++meshIndex )
     {
         std::string alias = meshAssetData->SubMeshes[ meshIndex ].Name;
@@ -108,45 +184,81 @@ GPUMesh MeshBatch::AddMesh( BinaryReader &reader, const std::vector<std::string>
         {
             alias = aliases[ meshIndex ];
         }
-        const size_t handleId   = NextHandle( alias );
-        m_parentMeshes[ alias ] = parentMeshIndex;
+        subMeshAliases.push_back( alias );
 
         auto &gpuSubMesh    = newGPUMesh.SubMeshes.emplace_back( );
-        gpuSubMesh.Handle   = MeshHandle( handleId );
         gpuSubMesh.Metadata = &meshAssetData->SubMeshes[ meshIndex ];
 
         auto       &subMesh     = meshAsset->SubMeshes.Elements[ meshIndex ];
         std::string subMeshName = subMesh.Name.Get( );
 
-        LoadAssetStreamToBufferDesc vertexLoadDesc;
-        vertexLoadDesc.Stream          = subMesh.VertexStream;
-        vertexLoadDesc.DstBuffer       = m_vertexBuffer.get( );
-        vertexLoadDesc.DstBufferOffset = vertexOffset;
-        vertexLoadDesc.Reader          = &reader;
-        m_batchResourceCopy->LoadAssetStreamToBuffer( vertexLoadDesc );
+        size_t numVertexBytes = subMesh.VertexStream.NumBytes;
+        if ( m_vertexFormat == VertexFormat::Compact || m_separatePositionStream )
+        {
+            // The packed vertices are unpacked on the CPU, the converted streams are written straight into upload memory
+            std::vector<Byte> packedVertices( subMesh.VertexStream.NumBytes );
+            LoadToMemoryDesc  loadDesc{ };
+            loadDesc.Stream = subMesh.VertexStream;
+            loadDesc.Memory = ByteArray{ packedVertices.data( ), packedVertices.size( ) };
+            meshAssetReader.LoadStreamToMemory( loadDesc );
 
-        gpuSubMesh.VertexBuffer.Buffer   = m_vertexBuffer.get( );
+            const size_t                  numSubMeshVertices = std::min<size_t>( gpuSubMesh.Metadata->NumVertices, packedVertices.size( ) / meshAssetData->GetVertexNumBytes( ) );
+            std::vector<StaticMeshVertex> vertices( numSubMeshVertices );
+            meshAssetData->UnpackVertices( packedVertices.data( ), numSubMeshVertices, vertices.data( ) );
+            if ( m_vertexFormat == VertexFormat::Compact )
+            {
+                numVertexBytes = CopyCompactVertices( copy, vertices, *gpuSubMesh.Metadata, vertexOffset );
+            }
+            else
+            {
+                UploadData( copy, packedVertices.data( ), packedVertices.size( ), m_pool->GetBuffer( GeometryStream::Vertices ), vertexOffset );
+                CopyPositions( copy, vertices, vertexOffset );
+            }
+        }
+        else
+        {
+            UploadStream( copy, meshAssetReader, reader, subMesh.VertexStream, m_pool->GetBuffer( GeometryStream::Vertices ), vertexOffset );
+        }
+
+        gpuSubMesh.VertexBuffer.Buffer   = m_pool->GetBuffer( GeometryStream::Vertices );
         gpuSubMesh.VertexBuffer.Offset   = vertexOffset;
-        gpuSubMesh.VertexBuffer.NumBytes = subMesh.VertexStream.NumBytes;
+        gpuSubMesh.VertexBuffer.NumBytes = numVertexBytes;
+        if ( m_separatePositionStream )
+        {
+            gpuSubMesh.PositionBuffer.Buffer   = m_pool->GetPositionBuffer( );
+            gpuSubMesh.PositionBuffer.Offset   = vertexOffset / GetVertexStride( ) * VertexQuantization::PositionStride( m_vertexFormat );
+            gpuSubMesh.PositionBuffer.NumBytes = gpuSubMesh.Metadata->NumVertices * VertexQuantization::PositionStride( m_vertexFormat );
+        }
+        vertexOffset += numVertexBytes;
 
+        gpuSubMesh.IndexType = SelectIndexType( gpuSubMesh.Metadata->NumVertices );
         if ( subMesh.IndexStream.NumBytes > 0 )
         {
-            LoadAssetStreamToBufferDesc indexLoadDesc;
-            indexLoadDesc.Stream          = subMesh.IndexStream;
-            indexLoadDesc.DstBuffer       = m_indexBuffer.get( );
-            indexLoadDesc.DstBufferOffset = indexOffset;
-            indexLoadDesc.Reader          = &reader;
-            m_batchResourceCopy->LoadAssetStreamToBuffer( indexLoadDesc );
-
-            gpuSubMesh.IndexBuffer.Buffer   = m_indexBuffer.get( );
+            const IndexType srcIndexType = gpuSubMesh.Metadata->IndexType;
+            const size_t    numIndices   = std::min<size_t>( gpuSubMesh.Metadata->NumIndices, subMesh.IndexStream.NumBytes / IndexStride( srcIndexType ) );
+            if ( srcIndexType == gpuSubMesh.IndexType )
+            {
+                UploadStream( copy, meshAssetReader, reader, subMesh.IndexStream, m_pool->GetBuffer( GeometryStream::Indices ), indexOffset );
+            }
+            else
+            {
+                std::vector<Byte> srcIndices( subMesh.IndexStream.NumBytes );
+                LoadToMemoryDesc  loadDesc{ };
+                loadDesc.Stream = subMesh.IndexStream;
+                loadDesc.Memory = ByteArray{ srcIndices.data( ), srcIndices.size( ) };
+                meshAssetReader.LoadStreamToMemory( loadDesc );
+                CopyIndices( copy, srcIndices.data( ), numIndices, srcIndexType, gpuSubMesh.IndexType, indexOffset );
+            }
+
+            gpuSubMesh.IndexBuffer.Buffer   = m_pool->GetBuffer( GeometryStream::Indices );
             gpuSubMesh.IndexBuffer.Offset   = indexOffset;
-            gpuSubMesh.IndexBuffer.NumBytes = subMesh.IndexStream.NumBytes;
+            gpuSubMesh.IndexBuffer.NumBytes = numIndices * IndexStride( gpuSubMesh.IndexType );
         }
-
-        m_subMeshes[ handleId ] = gpuSubMesh;
+        indexOffset += IndexRangeNumBytes( gpuSubMesh.Metadata->NumIndices, gpuSubMesh.IndexType );
     }
+    geometryLock.unlock( );
 
-    return newGPUMesh;
+    return PublishMesh( newGPUMesh, std::move( meshAssetData ), subMeshAliases, ranges );
 }
 
 GPUMesh MeshBatch::AddGeometry( const GeometryData *geometry, std::string alias )
@@ -156,15 +268,16 @@ GPUMesh MeshBatch::AddGeometry( const GeometryData *geometry, std::string alias
         spdlog::error( "AddGeometry: geometry is required" );
         return GPUMesh{ };
     }
-
-    const size_t parentMeshIndex = m_meshes.size( );
-    GPUMesh     &newGPUMesh      = m_meshes.emplace_back( GPUMesh{ } );
-    m_parentMeshes[ alias ]      = parentMeshIndex;
+    if ( !m_updating )
+    {
+        spdlog::error( "AddGeometry: BeginUpdate not called" );
+        return GPUMesh{ };
+    }
 
     const auto &geometryData = *geometry;
 
-    const uint32_t numVertices = geometryData.Vertices.NumElements;
-    const uint32_t numIndices  = geometryData.Indices.NumElements;
+    uint32_t numVertices = geometryData.Vertices.NumElements;
+    uint32_t numIndices  = geometryData.Indices.NumElements;
 
     if ( numVertices == 0 )
     {
@@ -212,33 +325,29 @@ GPUMesh MeshBatch::AddGeometry( const GeometryData *geometry, std::string alias
         DirectX::XMStoreFloat3( &maxBounds, DirectX::XMVectorMax( posVec, maxVec ) );
     }
 
-    const size_t numVertexBytes = vertices.size( ) * sizeof( StaticMeshVertex );
-    const size_t numIndexBytes  = numIndices * sizeof( uint32_t );
-
-    size_t vertexOffset = m_nextVertexOffset;
-    size_t indexOffset  = m_nextIndexOffset;
+    std::vector<uint32_t> indices( geometryData.Indices.Elements, geometryData.Indices.Elements + numIndices );
+    if ( m_optimizeGeometry && numIndices >= 3 )
     {
-        std::lock_guard lock( m_newMeshLock );
-        m_nextVertexOffset = m_nextVertexOffset + numVertexBytes;
-        m_nextIndexOffset  = m_nextIndexOffset + numIndexBytes;
+        numVertices = static_cast<uint32_t>( MeshOptimizer::Optimize( reinterpret_cast<Byte *>( vertices.data( ) ), numVertices, sizeof( StaticMeshVertex ), indices ) );
+        numIndices  = static_cast<uint32_t>( indices.size( ) );
+        vertices.resize( numVertices );
     }
 
-    CopyToGpuBufferDesc vertexCopyDesc{ };
-    vertexCopyDesc.DstBuffer       = m_vertexBuffer.get( );
-    vertexCopyDesc.DstBufferOffset = vertexOffset;
-    vertexCopyDesc.Data            = { reinterpret_cast<const Byte *>( vertices.data( ) ), numVertexBytes };
-    m_batchResourceCopy->CopyToGPUBuffer( vertexCopyDesc );
+    const IndexType indexType      = SelectIndexType( numVertices );
+    const size_t    numVertexBytes = vertices.size( ) * GetVertexStride( );
+    const size_t    numIndexBytes  = numIndices * IndexStride( indexType );
 
-    if ( numIndices > 0 )
+    MeshRanges ranges{ };
+    if ( !AllocateRanges( numVertices, IndexRangeNumBytes( numIndices, indexType ), ranges ) )
     {
-        CopyToGpuBufferDesc indexCopyDesc{ };
-        indexCopyDesc.DstBuffer       = m_indexBuffer.get( );
-        indexCopyDesc.DstBufferOffset = indexOffset;
-        indexCopyDesc.Data            = { reinterpret_cast<const Byte *>( geometryData.Indices.Elements ), numIndexBytes };
-        m_batchResourceCopy->CopyToGPUBuffer( indexCopyDesc );
+        spdlog::error( "AddGeometry: Not enough geometry space" );
+        return GPUMesh{ };
     }
+    const size_t vertexOffset = ranges.Vertices.Offset * GetVertexStride( );
+    const size_t indexOffset  = ranges.Indices.IsValid( ) ? ranges.Indices.Offset * IndexAllocationUnit : 0;
 
-    auto &meshAssetData                                 = m_meshDataStorage.emplace_back( std::make_unique<MeshAssetData>( MeshAssetData{ } ) );
+    auto    meshAssetData = std::make_unique<MeshAssetData>( MeshAssetData{ } );
+    GPUMesh newGPUMesh{ };
     newGPUMesh.Metadata                                 = meshAssetData.get( );
     newGPUMesh.Metadata->Name                           = "MeshPool Geometry";
     newGPUMesh.Metadata->EnabledAttributes.Position     = true;
@@ -252,75 +361,801 @@ GPUMesh MeshBatch::AddGeometry( const GeometryData *geometry, std::string alias
 
     GPUSubMesh &subMesh = newGPUMesh.SubMeshes.emplace_back( );
 
-    size_t handle                 = NextHandle( alias );
-    subMesh.Handle                = MeshHandle( handle );
-    subMesh.VertexBuffer.Buffer   = m_vertexBuffer.get( );
+    subMesh.VertexBuffer.Buffer   = m_pool->GetBuffer( GeometryStream::Vertices );
     subMesh.VertexBuffer.Offset   = vertexOffset;
     subMesh.VertexBuffer.NumBytes = numVertexBytes;
-    subMesh.IndexBuffer.Buffer    = m_indexBuffer.get( );
+    subMesh.IndexBuffer.Buffer    = m_pool->GetBuffer( GeometryStream::Indices );
     subMesh.IndexBuffer.Offset    = indexOffset;
     subMesh.IndexBuffer.NumBytes  = numIndexBytes;
+    subMesh.IndexType             = indexType;
+    if ( m_separatePositionStream )
+    {
+        subMesh.PositionBuffer.Buffer   = m_pool->GetPositionBuffer( );
+        subMesh.PositionBuffer.Offset   = vertexOffset / GetVertexStride( ) * VertexQuantization::PositionStride( m_vertexFormat );
+        subMesh.PositionBuffer.NumBytes = numVertices * VertexQuantization::PositionStride( m_vertexFormat );
+    }
 
     subMesh.Metadata              = &meshAssetData->SubMeshes.emplace_back( );
     subMesh.Metadata->NumVertices = numVertices;
     subMesh.Metadata->NumIndices  = numIndices;
-    subMesh.Metadata->IndexType   = IndexType::Uint32;
+    subMesh.Metadata->IndexType   = indexType;
     subMesh.Metadata->MinBounds   = { minBounds.x, minBounds.y, minBounds.z };
     subMesh.Metadata->MaxBounds   = { maxBounds.x, maxBounds.y, maxBounds.z };
 
-    m_subMeshes[ handle ] = subMesh;
+    {
+        std::shared_lock   geometryLock( m_geometryLock );
+        BatchResourceCopy *copy = ThreadCopy( );
+        if ( m_vertexFormat == VertexFormat::Compact )
+        {
+            CopyCompactVertices( copy, vertices, *subMesh.Metadata, vertexOffset );
+        }
+        else
+        {
+            UploadData( copy, reinterpret_cast<const Byte *>( vertices.data( ) ), numVertexBytes, m_pool->GetBuffer( GeometryStream::Vertices ), vertexOffset );
+            CopyPositions( copy, vertices, vertexOffset );
+        }
+
+        if ( numIndices > 0 )
+        {
+            CopyIndices( copy, reinterpret_cast<const Byte *>( indices.data( ) ), numIndices, IndexType::Uint32, indexType, indexOffset );
+        }
+    }
 
-    return newGPUMesh;
+    return PublishMesh( newGPUMesh, std::move( meshAssetData ), { alias }, ranges );
+}
+
+bool MeshBatch::RemoveMesh( const MeshHandle handle )
+{
+    std::lock_guard               lock( m_newMeshLock );
+    const PublishedSubMesh *const published = m_subMeshes.Find( handle.Id );
+    if ( !published )
+    {
+        spdlog::error( "RemoveMesh: Invalid handle" );
+        return false;
+    }
+
+    const size_t meshIndex = published->MeshIndex;
+    GPUMesh     &mesh      = m_meshes[ meshIndex ];
+    for ( const GPUSubMesh &subMesh : mesh.SubMeshes )
+    {
+        ( subMesh.IndexType == IndexType::Uint16 ? m_numIndexBytes16 : m_numIndexBytes32 ) -= subMesh.IndexBuffer.NumBytes;
+        m_subMeshes.Remove( subMesh.Handle.Id );
+    }
+    std::erase_if( m_aliases, [ & ]( const auto &alias ) { return !m_subMeshes.Contains( alias.second.Id ); } );
+    std::erase_if( m_parentMeshes, [ & ]( const auto &parentMesh ) { return parentMesh.second == meshIndex; } );
+
+    if ( const auto ranges = m_meshRanges.find( meshIndex ); ranges != m_meshRanges.end( ) )
+    {
+        m_vertexRangeOwners.erase( ranges->second.Vertices.Offset );
+        m_indexRangeOwners.erase( ranges->second.Indices.Offset );
+        m_usedVertices -= ranges->second.Vertices.Size;
+        m_usedIndexUnits -= ranges->second.Indices.Size;
+        // Freeing a moving range drops its move in the pool, the next mesh may be given the same offset before CommitDefragment
+        std::erase_if( m_pendingVertexMoves, [ & ]( const GeometryMove &move ) { return move.SrcOffset == ranges->second.Vertices.Offset; } );
+        std::erase_if( m_pendingIndexMoves, [ & ]( const GeometryMove &move ) { return move.SrcOffset == ranges->second.Indices.Offset; } );
+        m_pool->Free( GeometryStream::Vertices, ranges->second.Vertices );
+        m_pool->Free( GeometryStream::Indices, ranges->second.Indices );
+        m_meshRanges.erase( ranges );
+    }
+
+    std::erase_if( m_meshDataStorage, [ & ]( const std::unique_ptr<MeshAssetData> &data ) { return data.get( ) == mesh.Metadata; } );
+    mesh = GPUMesh{ };
+    m_freeMeshIndices.push_back( meshIndex );
+    return true;
+}
+
+bool MeshBatch::ReplaceMesh( const MeshHandle target, const MeshHandle replacement )
+{
+    std::lock_guard               lock( m_newMeshLock );
+    const PublishedSubMesh *const targetSubMesh      = m_subMeshes.Find( target.Id );
+    const PublishedSubMesh *const replacementSubMesh = m_subMeshes.Find( replacement.Id );
+    if ( !targetSubMesh || !replacementSubMesh )
+    {
+        spdlog::error( "ReplaceMesh: Invalid handle" );
+        return false;
+    }
+
+    const size_t targetIndex      = targetSubMesh->MeshIndex;
+    const size_t replacementIndex = replacementSubMesh->MeshIndex;
+    GPUMesh     &targetMesh       = m_meshes[ targetIndex ];
+    GPUMesh     &replacementMesh  = m_meshes[ replacementIndex ];
+    if ( targetIndex == replacementIndex || targetMesh.SubMeshes.size( ) != replacementMesh.SubMeshes.size( ) )
+    {
+        spdlog::error( "ReplaceMesh: The meshes must differ and have the same number of submeshes" );
+        return false;
+    }
+
+    // The meshes keep their ranges and metadata, only the handles trade places
+    for ( size_t i = 0; i < targetMesh.SubMeshes.size( ); ++i )
+    {
+        std::swap( targetMesh.SubMeshes[ i ].Handle, replacementMesh.SubMeshes[ i ].Handle );
+        *m_subMeshes.Find( targetMesh.SubMeshes[ i ].Handle.Id )      = PublishedSubMesh{ targetMesh.SubMeshes[ i ], targetIndex };
+        *m_subMeshes.Find( replacementMesh.SubMeshes[ i ].Handle.Id ) = PublishedSubMesh{ replacementMesh.SubMeshes[ i ], replacementIndex };
+    }
+    for ( size_t &meshIndex : m_parentMeshes | std::views::values )
+    {
+        meshIndex = meshIndex == targetIndex ? replacementIndex : meshIndex == replacementIndex ? targetIndex : meshIndex;
+    }
+    return true;
+}
+
+size_t MeshBatch::Defragment( const size_t maxBytesToMove )
+{
+    if ( !m_batchResourceCopy || !m_updating )
+    {
+        spdlog::error( "Defragment: BeginUpdate not called" );
+        return 0;
+    }
+
+    // Uploads of other threads go through their own copy lists, the GPU doesn't order those against the moves of m_batchResourceCopy
+    std::unique_lock geometryLock( m_geometryLock );
+    if ( m_hasUploads )
+    {
+        spdlog::error( "Defragment: Meshes were added in this update, defragment in an update of its own" );
+        return 0;
+    }
+    std::lock_guard lock( m_newMeshLock );
+    if ( !m_pendingVertexMoves.empty( ) || !m_pendingIndexMoves.empty( ) )
+    {
+        return 0; // The previous moves are not committed yet
+    }
+
+    // Only this batch's ranges are moved, the other batches of the pool patch their own submeshes
+    const uint32_t freeVersion  = m_pool->GetStats( ).FreeVersion;
+    const auto     ownsVertices = [ & ]( const size_t offset ) { return m_vertexRangeOwners.contains( offset ); };
+    const auto     ownsIndices  = [ & ]( const size_t offset ) { return m_indexRangeOwners.contains( offset ); };
+    m_pendingVertexMoves        = m_pool->Defragment( GeometryStream::Vertices, maxBytesToMove / GetVertexStride( ), ownsVertices, m_batchResourceCopy.get( ) );
+    m_pendingIndexMoves         = m_pool->Defragment( GeometryStream::Indices, maxBytesToMove / IndexAllocationUnit, ownsIndices, m_batchResourceCopy.get( ) );
+
+    size_t numMovedBytes = 0;
+    for ( const GeometryMove &move : m_pendingVertexMoves )
+    {
+        numMovedBytes += move.Size * GetVertexStride( );
+    }
+    for ( const GeometryMove &move : m_pendingIndexMoves )
+    {
+        numMovedBytes += move.Size * IndexAllocationUnit;
+    }
+    m_stalledFreeVersion = numMovedBytes == 0 ? freeVersion : UINT32_MAX;
+    return numMovedBytes;
+}
+
+void MeshBatch::CommitDefragment( )
+{
+    std::lock_guard lock( m_newMeshLock );
+
+    const uint32_t vertexStride   = GetVertexStride( );
+    const uint32_t positionStride = VertexQuantization::PositionStride( m_vertexFormat );
+    for ( const GeometryMove &move : m_pendingVertexMoves )
+    {
+        const auto owner = m_vertexRangeOwners.find( move.SrcOffset );
+        if ( owner == m_vertexRangeOwners.end( ) )
+        {
+            continue; // Removed while the copy was in flight
+        }
+        const size_t meshIndex = owner->second;
+        m_vertexRangeOwners.erase( owner );
+        m_vertexRangeOwners[ move.DstOffset ]     = meshIndex;
+        m_meshRanges[ meshIndex ].Vertices.Offset = move.DstOffset;
+
+        const size_t delta = move.SrcOffset - move.DstOffset;
+        for ( GPUSubMesh &subMesh : m_meshes[ meshIndex ].SubMeshes )
+        {
+            subMesh.VertexBuffer.Offset -= delta * vertexStride;
+            if ( m_separatePositionStream )
+            {
+                subMesh.PositionBuffer.Offset -= delta * positionStride;
+            }
+            m_subMeshes.Find( subMesh.Handle.Id )->SubMesh = subMesh;
+        }
+    }
+
+    for ( const GeometryMove &move : m_pendingIndexMoves )
+    {
+        const auto owner = m_indexRangeOwners.find( move.SrcOffset );
+        if ( owner == m_indexRangeOwners.end( ) )
+        {
+            continue;
+        }
+        const size_t meshIndex = owner->second;
+        m_indexRangeOwners.erase( owner );
+        m_indexRangeOwners[ move.DstOffset ]     = meshIndex;
+        m_meshRanges[ meshIndex ].Indices.Offset = move.DstOffset;
+
+        const size_t delta = ( move.SrcOffset - move.DstOffset ) * IndexAllocationUnit;
+        for ( GPUSubMesh &subMesh : m_meshes[ meshIndex ].SubMeshes )
+        {
+            if ( subMesh.IndexBuffer.Buffer )
+            {
+                subMesh.IndexBuffer.Offset -= delta;
+            }
+            m_subMeshes.Find( subMesh.Handle.Id )->SubMesh = subMesh;
+        }
+    }
+
+    // Frames recorded before the commit still read the sources, they stay allocated until ReleaseDefragmentSources
+    if ( !m_pendingVertexMoves.empty( ) || !m_pendingIndexMoves.empty( ) )
+    {
+        m_committedMoves.push_back( CommittedMoves{ ++m_defragmentVersion, std::move( m_pendingVertexMoves ), std::move( m_pendingIndexMoves ) } );
+    }
+    m_pendingVertexMoves.clear( );
+    m_pendingIndexMoves.clear( );
+}
+
+bool MeshBatch::NeedsDefragment( ) const
+{
+    std::shared_lock lock( m_newMeshLock );
+    if ( !m_pendingVertexMoves.empty( ) || !m_pendingIndexMoves.empty( ) )
+    {
+        return false;
+    }
+
+    const GeometryPoolStats stats = m_pool->GetStats( );
+    if ( stats.FreeVersion == m_stalledFreeVersion )
+    {
+        return false;
+    }
+    const bool movableVertices = !m_vertexRangeOwners.empty( ) && m_vertexRangeOwners.rbegin( )->first > stats.Vertices.FirstFreeOffset;
+    const bool movableIndices  = !m_indexRangeOwners.empty( ) && m_indexRangeOwners.rbegin( )->first > stats.Indices.FirstFreeOffset;
+    return movableVertices || movableIndices;
+}
+
+void MeshBatch::ReleaseDefragmentSources( const uint32_t version )
+{
+    std::lock_guard lock( m_newMeshLock );
+    while ( !m_committedMoves.empty( ) && m_committedMoves.front( ).Version <= version )
+    {
+        m_pool->CompleteDefragment( GeometryStream::Vertices, m_committedMoves.front( ).Vertices );
+        m_pool->CompleteDefragment( GeometryStream::Indices, m_committedMoves.front( ).Indices );
+        m_committedMoves.pop_front( );
+    }
+}
+
+uint32_t MeshBatch::GetDefragmentVersion( ) const
+{
+    std::shared_lock lock( m_newMeshLock );
+    return m_defragmentVersion;
+}
+
+void MeshBatch::ReleaseUploads( )
+{
+    if ( m_updating )
+    {
+        spdlog::error( "ReleaseUploads: The update is still being recorded" );
+        return;
+    }
+    // The lists of the other threads may still be copying out of the buffer
+    if ( m_uploadBuffer && IsUpdateComplete( ) )
+    {
+        m_uploadBuffer->Reset( );
+    }
+}
+
+MeshBatchGeometryUsage MeshBatch::GetGeometryUsage( ) const
+{
+    std::shared_lock       lock( m_newMeshLock );
+    MeshBatchGeometryUsage usage{ };
+    usage.UsedVertexBytes     = m_usedVertices * GetVertexStride( );
+    usage.ReservedVertexBytes = std::max( m_reservedVertices, m_usedVertices ) * GetVertexStride( );
+    usage.UsedIndexBytes      = m_usedIndexUnits * IndexAllocationUnit;
+    usage.ReservedIndexBytes  = std::max( m_reservedIndexUnits, m_usedIndexUnits ) * IndexAllocationUnit;
+    return usage;
+}
+
+const GeometryPool *MeshBatch::GetPool( ) const
+{
+    return m_pool;
+}
+
+GeometryPoolStats MeshBatch::GetPoolStats( ) const
+{
+    return m_pool->GetStats( );
+}
+
+uint32_t MeshBatch::GetGeometryVersion( ) const
+{
+    return m_pool->GetVersion( );
+}
+
+MeshBatchUploadStats MeshBatch::GetUploadStats( ) const
+{
+    MeshBatchUploadStats stats{ };
+    stats.NumUploadedBytes      = m_numUploadedBytes.load( std::memory_order_relaxed );
+    stats.NumStagedBytes        = m_numStagedBytes.load( std::memory_order_relaxed );
+    stats.NumCopiedBytes        = m_numCopiedBytes.load( std::memory_order_relaxed );
+    stats.PeakUploadBufferBytes = m_uploadBuffer ? m_uploadBuffer->GetPeakBytes( ) : 0;
+    return stats;
 }
 
 GPUSubMesh MeshBatch::GetSubMesh( const MeshHandle handle ) const
 {
-    if ( handle.Id >= m_meshes.size( ) )
+    std::shared_lock              lock( m_newMeshLock );
+    const PublishedSubMesh *const published = m_subMeshes.Find( handle.Id );
+    if ( !published )
     {
         spdlog::error( "GetSubMesh: Invalid handle" );
         return GPUSubMesh{ };
     }
-    return m_subMeshes[ handle.Id ];
+    return ResolveBuffers( published->SubMesh );
+}
+
+const MeshAssetData *MeshBatch::GetMeshMetadata( const MeshHandle handle ) const
+{
+    std::shared_lock              lock( m_newMeshLock );
+    const PublishedSubMesh *const published = m_subMeshes.Find( handle.Id );
+    return published ? m_meshes[ published->MeshIndex ].Metadata : nullptr;
+}
+
+uint32_t MeshBatch::GetNumLODs( const MeshHandle handle ) const
+{
+    std::shared_lock              lock( m_newMeshLock );
+    const PublishedSubMesh *const published = m_subMeshes.Find( handle.Id );
+    return published ? static_cast<uint32_t>( 1 + FindBaseSubMesh( *published )->LODs.size( ) ) : 0;
+}
+
+GPUSubMesh MeshBatch::GetLOD( const MeshHandle handle, const uint32_t level ) const
+{
+    std::shared_lock              lock( m_newMeshLock );
+    const PublishedSubMesh *const published = m_subMeshes.Find( handle.Id );
+    if ( !published )
+    {
+        spdlog::error( "GetLOD: Invalid handle" );
+        return GPUSubMesh{ };
+    }
+
+    const std::vector<SubMeshLOD> &lods = FindBaseSubMesh( *published )->LODs;
+    if ( level == 0 || lods.empty( ) )
+    {
+        return ResolveBuffers( published->SubMesh );
+    }
+    const uint32_t subMeshIndex = lods[ std::min<size_t>( level, lods.size( ) ) - 1 ].SubMeshIndex;
+    return ResolveBuffers( m_meshes[ published->MeshIndex ].SubMeshes[ subMeshIndex ] );
+}
+
+MeshHandle MeshBatch::SelectLOD( const MeshHandle handle, const float pixelsPerUnit, const float maxPixelError ) const
+{
+    std::shared_lock              lock( m_newMeshLock );
+    const PublishedSubMesh *const published = m_subMeshes.Find( handle.Id );
+    if ( !published )
+    {
+        return handle;
+    }
+
+    // Errors grow along the chain, the first level over the threshold ends it
+    MeshHandle selected = handle;
+    for ( const SubMeshLOD &lod : FindBaseSubMesh( *published )->LODs )
+    {
+        if ( lod.Error * pixelsPerUnit > maxPixelError )
+        {
+            break;
+        }
+        selected = m_meshes[ published->MeshIndex ].SubMeshes[ lod.SubMeshIndex ].Handle;
+    }
+    return selected;
 }
 
 GPUBufferView MeshBatch::GetVertexBuffer( ) const
 {
-    return GPUBufferView{ .Buffer = m_vertexBuffer.get( ), .NumBytes = m_nextVertexOffset, .Offset = 0 };
+    const size_t numBytes = m_pool->GetHighWaterMark( GeometryStream::Vertices ) * GetVertexStride( );
+    return GPUBufferView{ .Buffer = m_pool->GetBuffer( GeometryStream::Vertices ), .NumBytes = numBytes, .Offset = 0 };
 }
 
 GPUBufferView MeshBatch::GetIndexBuffer( ) const
 {
-    return GPUBufferView{ .Buffer = m_indexBuffer.get( ), .NumBytes = m_nextIndexOffset, .Offset = 0 };
+    const size_t numBytes = m_pool->GetHighWaterMark( GeometryStream::Indices ) * IndexAllocationUnit;
+    return GPUBufferView{ .Buffer = m_pool->GetBuffer( GeometryStream::Indices ), .NumBytes = numBytes, .Offset = 0 };
+}
+
+size_t MeshBatch::GetNumIndexBytes( const IndexType indexType ) const
+{
+    std::shared_lock lock( m_newMeshLock );
+    return indexType == IndexType::Uint16 ? m_numIndexBytes16 : m_numIndexBytes32;
+}
+
+uint32_t MeshBatch::IndexStride( const IndexType indexType )
+{
+    return indexType == IndexType::Uint16 ? sizeof( uint16_t ) : sizeof( uint32_t );
+}
+
+VertexFormat MeshBatch::GetVertexFormat( ) const
+{
+    return m_vertexFormat;
+}
+
+uint32_t MeshBatch::GetVertexStride( ) const
+{
+    return VertexQuantization::VertexStride( m_vertexFormat );
+}
+
+bool MeshBatch::HasPositionStream( ) const
+{
+    return m_separatePositionStream;
+}
+
+GPUBufferView MeshBatch::GetPositionBuffer( ) const
+{
+    if ( !m_separatePositionStream )
+    {
+        return GPUBufferView{ };
+    }
+    const size_t numBytes = m_pool->GetHighWaterMark( GeometryStream::Vertices ) * VertexQuantization::PositionStride( m_vertexFormat );
+    return GPUBufferView{ .Buffer = m_pool->GetPositionBuffer( ), .NumBytes = numBytes, .Offset = 0 };
 }
 
 GPUMesh MeshBatch::GetParentMesh( const std::string &subMeshAlias )
 {
-    if ( !m_parentMeshes.contains( subMeshAlias ) )
+    std::shared_lock lock( m_newMeshLock );
+    const auto       parentMesh = m_parentMeshes.find( subMeshAlias );
+    if ( parentMesh == m_parentMeshes.end( ) )
     {
         spdlog::error( "GetMesh: Invalid alias" );
         return GPUMesh{ };
     }
-    return m_meshes[ m_parentMeshes[ subMeshAlias ] ];
+    GPUMesh mesh = m_meshes[ parentMesh->second ];
+    for ( GPUSubMesh &subMesh : mesh.SubMeshes )
+    {
+        subMesh = ResolveBuffers( subMesh );
+    }
+    return mesh;
 }
 
 GPUSubMesh MeshBatch::GetSubMesh( const std::string &alias ) const
 {
-    if ( !m_aliases.contains( alias ) )
+    std::shared_lock lock( m_newMeshLock );
+    const auto       handle = m_aliases.find( alias );
+    if ( handle == m_aliases.end( ) )
     {
         spdlog::error( "GetMesh: Invalid alias" );
         return GPUSubMesh{ };
     }
-    return m_subMeshes[ m_aliases.at( alias ).Id ];
+    return ResolveBuffers( m_subMeshes.Find( handle->second.Id )->SubMesh );
 }
 
-size_t MeshBatch::NextHandle( const std::string &alias )
+BatchResourceCopy *MeshBatch::ThreadCopy( )
+{
+    m_hasUploads = true;
+    if ( std::this_thread::get_id( ) == m_updateThread )
+    {
+        return m_batchResourceCopy.get( );
+    }
+
+    std::lock_guard lock( m_threadCopyLock );
+    auto           &copy = m_threadCopies[ std::this_thread::get_id( ) ];
+    if ( !copy )
+    {
+        copy = std::make_unique<BatchResourceCopy>( m_logicalDevice );
+        copy->Begin( );
+    }
+    return copy.get( );
+}
+
+void MeshBatch::FlushCopies( )
+{
+    std::lock_guard lock( m_threadCopyLock );
+    for ( auto &copy : m_threadCopies | std::views::values )
+    {
+        copy->Submit( nullptr );
+        copy = std::make_unique<BatchResourceCopy>( m_logicalDevice );
+        copy->Begin( );
+    }
+    if ( m_batchResourceCopy )
+    {
+        m_batchResourceCopy->Submit( nullptr );
+        m_batchResourceCopy = std::make_unique<BatchResourceCopy>( m_logicalDevice );
+        m_batchResourceCopy->Begin( );
+    }
+}
+
+GPUMesh MeshBatch::PublishMesh( GPUMesh mesh, std::unique_ptr<MeshAssetData> metadata, const std::vector<std::string> &aliases, const MeshRanges &ranges )
 {
     std::lock_guard lock( m_newMeshLock );
-    m_nextHandle++;
-    if ( m_nextHandle >= m_subMeshes.size( ) )
+    size_t          parentMeshIndex = m_meshes.size( );
+    if ( !m_freeMeshIndices.empty( ) )
+    {
+        parentMeshIndex = m_freeMeshIndices.back( );
+        m_freeMeshIndices.pop_back( );
+    }
+    for ( size_t i = 0; i < mesh.SubMeshes.size( ); ++i )
+    {
+        GPUSubMesh &subMesh = mesh.SubMeshes[ i ];
+        subMesh.Handle      = MeshHandle( m_subMeshes.Insert( PublishedSubMesh{ subMesh, parentMeshIndex } ) );
+        if ( PublishedSubMesh *published = m_subMeshes.Find( subMesh.Handle.Id ) )
+        {
+            published->SubMesh.Handle = subMesh.Handle;
+        }
+        ( subMesh.IndexType == IndexType::Uint16 ? m_numIndexBytes16 : m_numIndexBytes32 ) += subMesh.IndexBuffer.NumBytes;
+        if ( i < aliases.size( ) )
+        {
+            m_aliases[ aliases[ i ] ]      = subMesh.Handle;
+            m_parentMeshes[ aliases[ i ] ] = parentMeshIndex;
+        }
+    }
+
+    if ( parentMeshIndex == m_meshes.size( ) )
+    {
+        m_meshes.push_back( mesh );
+    }
+    else
+    {
+        m_meshes[ parentMeshIndex ] = mesh;
+    }
+    m_meshDataStorage.push_back( std::move( metadata ) );
+    RegisterRanges( parentMeshIndex, ranges );
+    return mesh;
+}
+
+MeshBatch::StagedUpload MeshBatch::BeginUpload( IBufferResource *dstBuffer, const size_t dstOffset, const size_t numBytes )
+{
+    StagedUpload upload{ };
+    upload.DstBuffer  = dstBuffer;
+    upload.DstOffset  = dstOffset;
+    upload.NumBytes   = numBytes;
+    upload.Allocation = m_uploadBuffer ? m_uploadBuffer->Allocate( numBytes ) : UploadAllocation{ };
+    if ( upload.Allocation.IsValid( ) )
+    {
+        upload.Data = upload.Allocation.Data;
+        return upload;
+    }
+    upload.Staging.resize( numBytes );
+    upload.Data = upload.Staging.data( );
+    return upload;
+}
+
+void MeshBatch::EndUpload( BatchResourceCopy *copy, const StagedUpload &upload )
+{
+    if ( upload.NumBytes == 0 )
+    {
+        return;
+    }
+    if ( upload.Allocation.IsValid( ) )
+    {
+        CopyBufferRegionDesc copyDesc{ };
+        copyDesc.SrcBuffer = upload.Allocation.Buffer;
+        copyDesc.SrcOffset = upload.Allocation.Offset;
+        copyDesc.DstBuffer = upload.DstBuffer;
+        copyDesc.DstOffset = upload.DstOffset;
+        copyDesc.NumBytes  = upload.NumBytes;
+        copy->CopyBufferRegion( copyDesc );
+        m_numUploadedBytes.fetch_add( upload.NumBytes, std::memory_order_relaxed );
+        return;
+    }
+
+    CopyToGpuBufferDesc copyDesc{ };
+    copyDesc.DstBuffer       = upload.DstBuffer;
+    copyDesc.DstBufferOffset = upload.DstOffset;
+    copyDesc.Data            = { upload.Staging.data( ), upload.NumBytes };
+    copy->CopyToGPUBuffer( copyDesc );
+    m_numStagedBytes.fetch_add( upload.NumBytes, std::memory_order_relaxed );
+    m_numCopiedBytes.fetch_add( upload.NumBytes, std::memory_order_relaxed );
+}
+
+void MeshBatch::UploadStream( BatchResourceCopy *copy, MeshAssetReader &meshReader, BinaryReader &reader, const AssetDataStream stream, IBufferResource *dst, const size_t dstOffset )
+{
+    if ( const UploadAllocation allocation = m_uploadBuffer ? m_uploadBuffer->Allocate( stream.NumBytes ) : UploadAllocation{ }; allocation.IsValid( ) )
+    {
+        LoadToMemoryDesc loadDesc{ };
+        loadDesc.Stream = stream;
+        loadDesc.Memory = ByteArray{ allocation.Data, stream.NumBytes };
+        meshReader.LoadStreamToMemory( loadDesc );
+
+        StagedUpload upload{ };
+        upload.DstBuffer  = dst;
+        upload.DstOffset  = dstOffset;
+        upload.NumBytes   = stream.NumBytes;
+        upload.Allocation = allocation;
+        EndUpload( copy, upload );
+        return;
+    }
+
+    LoadAssetStreamToBufferDesc loadDesc;
+    loadDesc.Stream          = stream;
+    loadDesc.DstBuffer       = dst;
+    loadDesc.DstBufferOffset = dstOffset;
+    loadDesc.Reader          = &reader;
+    copy->LoadAssetStreamToBuffer( loadDesc );
+    m_numStagedBytes.fetch_add( stream.NumBytes, std::memory_order_relaxed );
+    m_numCopiedBytes.fetch_add( stream.NumBytes, std::memory_order_relaxed );
+}
+
+void MeshBatch::UploadData( BatchResourceCopy *copy, const Byte *data, const size_t numBytes, IBufferResource *dstBuffer, const size_t dstOffset )
+{
+    if ( const UploadAllocation allocation = m_uploadBuffer ? m_uploadBuffer->Allocate( numBytes ) : UploadAllocation{ }; allocation.IsValid( ) )
+    {
+        memcpy( allocation.Data, data, numBytes );
+        m_numCopiedBytes.fetch_add( numBytes, std::memory_order_relaxed );
+
+        StagedUpload upload{ };
+        upload.DstBuffer  = dstBuffer;
+        upload.DstOffset  = dstOffset;
+        upload.NumBytes   = numBytes;
+        upload.Allocation = allocation;
+        EndUpload( copy, upload );
+        return;
+    }
+
+    // BatchResourceCopy stages the data itself, going through StagedUpload would copy it twice
+    CopyToGpuBufferDesc copyDesc{ };
+    copyDesc.DstBuffer       = dstBuffer;
+    copyDesc.DstBufferOffset = dstOffset;
+    copyDesc.Data            = { data, numBytes };
+    copy->CopyToGPUBuffer( copyDesc );
+    m_numStagedBytes.fetch_add( numBytes, std::memory_order_relaxed );
+    m_numCopiedBytes.fetch_add( numBytes, std::memory_order_relaxed );
+}
+
+size_t MeshBatch::CopyCompactVertices( BatchResourceCopy *copy, const std::span<const StaticMeshVertex> vertices, SubMeshData &metadata, const size_t dstOffset )
+{
+    if ( vertices.empty( ) )
+    {
+        return 0;
+    }
+
+    constexpr float unlikelyMin = std::numeric_limits<float>::max( );
+    constexpr float unlikelyMax = std::numeric_limits<float>::lowest( );
+    Float3          boundsMin   = { unlikelyMin, unlikelyMin, unlikelyMin };
+    Float3          boundsMax   = { unlikelyMax, unlikelyMax, unlikelyMax };
+    VertexQuantization::ComputeBounds( vertices.data( ), vertices.size( ), boundsMin, boundsMax );
+    metadata.MinBounds = boundsMin;
+    metadata.MaxBounds = boundsMax;
+
+    const size_t       numBytes        = vertices.size( ) * sizeof( CompactMeshVertex );
+    const StagedUpload vertexUpload    = BeginUpload( m_pool->GetBuffer( GeometryStream::Vertices ), dstOffset, numBytes );
+    auto              *compactVertices = reinterpret_cast<CompactMeshVertex *>( vertexUpload.Data );
+    if ( !m_separatePositionStream )
+    {
+        VertexQuantization::Encode( vertices.data( ), vertices.size( ), boundsMin, boundsMax, compactVertices );
+        EndUpload( copy, vertexUpload );
+        return numBytes;
+    }
+
+    // Both streams are written from the encoded vertex, upload memory is never read back
+    const size_t       positionStride = VertexQuantization::PositionStride( VertexFormat::Compact );
+    const StagedUpload positionUpload = BeginUpload( m_pool->GetPositionBuffer( ), dstOffset / GetVertexStride( ) * positionStride, vertices.size( ) * positionStride );
+    auto              *positions      = reinterpret_cast<uint32_t *>( positionUpload.Data );
+    for ( size_t i = 0; i < vertices.size( ); ++i )
+    {
+        const CompactMeshVertex vertex = VertexQuantization::Encode( vertices[ i ], boundsMin, boundsMax );
+        compactVertices[ i ]           = vertex;
+        positions[ i * 2 ]             = vertex.PositionXY;
+        positions[ i * 2 + 1 ]         = vertex.PositionZW;
+    }
+    EndUpload( copy, vertexUpload );
+    EndUpload( copy, positionUpload );
+    return numBytes;
+}
+
+void MeshBatch::CopyPositions( BatchResourceCopy *copy, const std::span<const StaticMeshVertex> vertices, const size_t dstOffset )
+{
+    if ( !m_separatePositionStream || vertices.empty( ) )
+    {
+        return;
+    }
+
+    const StagedUpload upload    = BeginUpload( m_pool->GetPositionBuffer( ), dstOffset / GetVertexStride( ) * sizeof( Float4 ), vertices.size( ) * sizeof( Float4 ) );
+    auto              *positions = reinterpret_cast<Float4 *>( upload.Data );
+    for ( size_t i = 0; i < vertices.size( ); ++i )
+    {
+        positions[ i ] = vertices[ i ].Position;
+    }
+    EndUpload( copy, upload );
+}
+
+IndexType MeshBatch::SelectIndexType( const size_t numVertices ) const
+{
+    // Indices address vertices relative to VertexOffset, so only the submesh's own vertex count matters
+    constexpr size_t maxUint16Vertices = static_cast<size_t>( std::numeric_limits<uint16_t>::max( ) ) + 1;
+    return m_allow16BitIndices && numVertices <= maxUint16Vertices ? IndexType::Uint16 : IndexType::Uint32;
+}
+
+size_t MeshBatch::IndexRangeNumBytes( const size_t numIndices, const IndexType indexType )
+{
+    return ( numIndices * IndexStride( indexType ) + IndexAllocationUnit - 1 ) / IndexAllocationUnit * IndexAllocationUnit;
+}
+
+void MeshBatch::CopyIndices( BatchResourceCopy *copy, const Byte *indices, const size_t numIndices, const IndexType srcType, const IndexType dstType, const size_t dstOffset )
+{
+    if ( !indices || numIndices == 0 )
+    {
+        return;
+    }
+    if ( srcType == dstType )
+    {
+        UploadData( copy, indices, numIndices * IndexStride( dstType ), m_pool->GetBuffer( GeometryStream::Indices ), dstOffset );
+        return;
+    }
+
+    // Converted straight into upload memory
+    const StagedUpload upload = BeginUpload( m_pool->GetBuffer( GeometryStream::Indices ), dstOffset, numIndices * IndexStride( dstType ) );
+    for ( size_t i = 0; i < numIndices; ++i )
+    {
+        if ( dstType == IndexType::Uint16 )
+        {
+            uint32_t index;
+            memcpy( &index, indices + i * sizeof( uint32_t ), sizeof( uint32_t ) );
+            const auto narrowed = static_cast<uint16_t>( index );
+            memcpy( upload.Data + i * sizeof( uint16_t ), &narrowed, sizeof( uint16_t ) );
+        }
+        else
+        {
+            uint16_t index;
+            memcpy( &index, indices + i * sizeof( uint16_t ), sizeof( uint16_t ) );
+            const uint32_t widened = index;
+            memcpy( upload.Data + i * sizeof( uint32_t ), &widened, sizeof( uint32_t ) );
+        }
+    }
+    EndUpload( copy, upload );
+}
+
+bool MeshBatch::AllocateRanges( const size_t numVertices, const size_t numIndexBytes, MeshRanges &outRanges )
+{
+    if ( TryAllocateRanges( numVertices, numIndexBytes, nullptr, outRanges ) )
+    {
+        return true;
+    }
+
+    // Growing copies the live geometry into new buffers, every upload recorded so far has to land in the old ones first
+    std::unique_lock  geometryLock( m_geometryLock );
+    FlushCopies( );
+    BatchResourceCopy growthCopy( m_logicalDevice );
+    growthCopy.Begin( );
+    const bool allocated = TryAllocateRanges( numVertices, numIndexBytes, &growthCopy, outRanges );
+    growthCopy.Submit( nullptr );
+    return allocated;
+}
+
+bool MeshBatch::TryAllocateRanges( const size_t numVertices, const size_t numIndexBytes, BatchResourceCopy *copy, MeshRanges &outRanges ) const
+{
+    outRanges.Vertices = m_pool->Allocate( GeometryStream::Vertices, numVertices, copy );
+    outRanges.Indices  = m_pool->Allocate( GeometryStream::Indices, numIndexBytes / IndexAllocationUnit, copy );
+
+    const bool hasVertices = numVertices == 0 || outRanges.Vertices.IsValid( );
+    const bool hasIndices  = numIndexBytes == 0 || outRanges.Indices.IsValid( );
+    if ( hasVertices && hasIndices )
+    {
+        return true;
+    }
+
+    m_pool->Free( GeometryStream::Vertices, outRanges.Vertices );
+    m_pool->Free( GeometryStream::Indices, outRanges.Indices );
+    outRanges = MeshRanges{ };
+    return false;
+}
+
+void MeshBatch::RegisterRanges( const size_t meshIndex, const MeshRanges &ranges )
+{
+    m_meshRanges[ meshIndex ] = ranges;
+    m_usedVertices += ranges.Vertices.Size;
+    m_usedIndexUnits += ranges.Indices.Size;
+    if ( ranges.Vertices.IsValid( ) )
+    {
+        m_vertexRangeOwners[ ranges.Vertices.Offset ] = meshIndex;
+    }
+    if ( ranges.Indices.IsValid( ) )
+    {
+        m_indexRangeOwners[ ranges.Indices.Offset ] = meshIndex;
+    }
+}
+
+const DZEngine::SubMeshData *MeshBatch::FindBaseSubMesh( const PublishedSubMesh &published ) const
+{
+    const MeshAssetData *metadata = m_meshes[ published.MeshIndex ].Metadata;
+    const SubMeshData   *subMesh  = published.SubMesh.Metadata;
+    return subMesh->LODOf >= 0 ? &metadata->SubMeshes[ subMesh->LODOf ] : subMesh;
+}
+
+GPUSubMesh MeshBatch::ResolveBuffers( GPUSubMesh subMesh ) const
+{
+    if ( subMesh.VertexBuffer.Buffer )
+    {
+        subMesh.VertexBuffer.Buffer = m_pool->GetBuffer( GeometryStream::Vertices );
+    }
+    if ( subMesh.IndexBuffer.Buffer )
+    {
+        subMesh.IndexBuffer.Buffer = m_pool->GetBuffer( GeometryStream::Indices );
+    }
+    if ( subMesh.PositionBuffer.Buffer )
     {
-        m_subMeshes.resize( m_nextHandle + 1 );
+        subMesh.PositionBuffer.Buffer = m_pool->GetPositionBuffer( );
     }
-    m_aliases[ alias ] = MeshHandle( m_nextHandle );
-    return m_nextHandle;
+    return subMesh;
 }
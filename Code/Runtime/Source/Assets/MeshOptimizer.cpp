@@ -0,0 +1,556 @@
+/*
+Den Of Iz - Game/Game Engine
+Copyright (c) 2020-2024 Muhammed Murat Cengiz
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "DZEngine/Assets/MeshOptimizer.h"
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <numeric>
+
+using namespace DZEngine;
+
+namespace
+{
+    constexpr uint32_t Unused           = ~0u;
+    constexpr uint32_t MaxScoredValence = 32;
+    constexpr size_t   CacheLineSize    = 64;
+    constexpr size_t   NumCacheLines    = 256; // 16 KiB, about the vertex fetch cache of one shader engine
+    constexpr int      OverdrawGridSize = 256;
+
+    const float *PositionOf( const Byte *vertices, const size_t vertexStride, const uint32_t vertex )
+    {
+        return reinterpret_cast<const float *>( vertices + vertex * vertexStride );
+    }
+
+    // FNV-1a, vertices are short and the table only needs a decent spread
+    uint64_t HashBytes( const Byte *data, const size_t numBytes )
+    {
+        uint64_t hash = 14695981039346656037ull;
+        for ( size_t i = 0; i < numBytes; ++i )
+        {
+            hash = ( hash ^ data[ i ] ) * 1099511628211ull;
+        }
+        return hash;
+    }
+
+    // FIFO cache of cacheSize vertices, a vertex is cached while fewer than cacheSize misses happened since it was transformed
+    class FifoCache
+    {
+        std::vector<uint64_t> m_timestamps;
+        uint64_t              m_time;
+        uint32_t              m_cacheSize;
+
+    public:
+        FifoCache( const size_t numVertices, const uint32_t cacheSize ) : m_timestamps( numVertices, 0 ), m_time( cacheSize + 1 ), m_cacheSize( cacheSize )
+        {
+        }
+
+        uint32_t Access( const uint32_t *triangle ) // Returns the number of misses
+        {
+            uint32_t numMisses = 0;
+            for ( uint32_t corner = 0; corner < 3; ++corner )
+            {
+                if ( m_time - m_timestamps[ triangle[ corner ] ] > m_cacheSize )
+                {
+                    m_timestamps[ triangle[ corner ] ] = ++m_time;
+                    ++numMisses;
+                }
+            }
+            return numMisses;
+        }
+
+        void Reset( )
+        {
+            m_time += m_cacheSize + 1;
+        }
+    };
+
+    // Scores of "Linear-Speed Vertex Cache Optimisation", the three most recent vertices score the same so a triangle doesn't favor its own order
+    float VertexScore( const int cachePosition, const uint32_t numLiveTriangles )
+    {
+        if ( numLiveTriangles == 0 )
+        {
+            return -1.0f;
+        }
+
+        float score = 0.0f;
+        if ( cachePosition >= 0 && cachePosition < 3 )
+        {
+            score = 0.75f;
+        }
+        else if ( cachePosition >= 3 && cachePosition < static_cast<int>( MeshOptimizer::CacheSize ) )
+        {
+            const float scale = 1.0f / static_cast<float>( MeshOptimizer::CacheSize - 3 );
+            score             = std::pow( 1.0f - static_cast<float>( cachePosition - 3 ) * scale, 1.5f );
+        }
+        return score + 2.0f / std::sqrt( static_cast<float>( std::min( numLiveTriangles, MaxScoredValence ) ) );
+    }
+} // namespace
+
+size_t MeshOptimizer::Optimize( Byte *vertices, size_t numVertices, const size_t vertexStride, std::vector<uint32_t> &indices, const float overdrawThreshold )
+{
+    indices.resize( indices.size( ) / 3 * 3 );
+    if ( indices.empty( ) )
+    {
+        return numVertices;
+    }
+
+    numVertices = DeduplicateVertices( vertices, numVertices, vertexStride, indices );
+    OptimizeVertexCache( indices, numVertices );
+    OptimizeOverdraw( indices, vertices, numVertices, vertexStride, overdrawThreshold );
+    return OptimizeVertexFetch( vertices, numVertices, vertexStride, indices );
+}
+
+size_t MeshOptimizer::DeduplicateVertices( Byte *vertices, const size_t numVertices, const size_t vertexStride, const std::span<uint32_t> indices )
+{
+    // Open addressing over the first vertex of each distinct byte pattern
+    const size_t          tableSize = std::bit_ceil( std::max<size_t>( numVertices * 2, 16 ) );
+    std::vector<uint32_t> table( tableSize, Unused );
+    std::vector<uint32_t> remap( numVertices, Unused );
+    uint32_t              numUnique = 0;
+    for ( const uint32_t index : indices )
+    {
+        if ( remap[ index ] != Unused )
+        {
+            continue;
+        }
+
+        const Byte *vertex = vertices + index * vertexStride;
+        size_t      slot   = HashBytes( vertex, vertexStride ) & ( tableSize - 1 );
+        while ( table[ slot ] != Unused && std::memcmp( vertices + table[ slot ] * vertexStride, vertex, vertexStride ) != 0 )
+        {
+            slot = ( slot + 1 ) & ( tableSize - 1 );
+        }
+        if ( table[ slot ] == Unused )
+        {
+            table[ slot ]  = index;
+            remap[ index ] = numUnique++;
+        }
+        else
+        {
+            remap[ index ] = remap[ table[ slot ] ];
+        }
+    }
+    return ReorderVertices( vertices, numVertices, vertexStride, indices, remap );
+}
+
+void MeshOptimizer::OptimizeVertexCache( const std::span<uint32_t> indices, const size_t numVertices )
+{
+    const size_t numTriangles = indices.size( ) / 3;
+    if ( numTriangles == 0 )
+    {
+        return;
+    }
+
+    // Live triangles of each vertex, emitted triangles are swapped past the live count
+    std::vector<uint32_t> numLive( numVertices, 0 );
+    for ( const uint32_t index : indices )
+    {
+        ++numLive[ index ];
+    }
+    std::vector<uint32_t> offsets( numVertices + 1, 0 );
+    std::inclusive_scan( numLive.begin( ), numLive.end( ), offsets.begin( ) + 1 );
+    std::vector<uint32_t> adjacency( indices.size( ) );
+    {
+        std::vector<uint32_t> cursors( offsets.begin( ), offsets.end( ) - 1 );
+        for ( size_t i = 0; i < indices.size( ); ++i )
+        {
+            adjacency[ cursors[ indices[ i ] ]++ ] = static_cast<uint32_t>( i / 3 );
+        }
+    }
+
+    std::vector<int>   cachePositions( numVertices, -1 );
+    std::vector<float> vertexScores( numVertices );
+    for ( uint32_t vertex = 0; vertex < numVertices; ++vertex )
+    {
+        vertexScores[ vertex ] = VertexScore( -1, numLive[ vertex ] );
+    }
+    std::vector<float>   triangleScores( numTriangles );
+    std::vector<uint8_t> emitted( numTriangles, 0 );
+    uint32_t             bestTriangle = 0;
+    for ( uint32_t triangle = 0; triangle < numTriangles; ++triangle )
+    {
+        triangleScores[ triangle ] = vertexScores[ indices[ triangle * 3 ] ] + vertexScores[ indices[ triangle * 3 + 1 ] ] + vertexScores[ indices[ triangle * 3 + 2 ] ];
+        bestTriangle               = triangleScores[ triangle ] > triangleScores[ bestTriangle ] ? triangle : bestTriangle;
+    }
+
+    std::vector<uint32_t> output;
+    output.reserve( indices.size( ) );
+    std::vector<uint32_t> cache;
+    std::vector<uint32_t> nextCache;
+    cache.reserve( CacheSize + 3 );
+    nextCache.reserve( CacheSize + 3 );
+    size_t inputCursor = 0;
+    while ( output.size( ) < indices.size( ) )
+    {
+        if ( bestTriangle == Unused )
+        {
+            // Nothing in the cache has triangles left, continue with the next triangle in input order
+            while ( emitted[ inputCursor ] )
+            {
+                ++inputCursor;
+            }
+            bestTriangle = static_cast<uint32_t>( inputCursor );
+        }
+
+        const uint32_t *triangle = &indices[ bestTriangle * 3 ];
+        emitted[ bestTriangle ]  = 1;
+        output.insert( output.end( ), triangle, triangle + 3 );
+
+        nextCache.clear( );
+        for ( uint32_t corner = 0; corner < 3; ++corner )
+        {
+            const uint32_t vertex = triangle[ corner ];
+            if ( std::ranges::find( nextCache, vertex ) == nextCache.end( ) ) // Degenerate triangles repeat a vertex
+            {
+                nextCache.push_back( vertex );
+            }
+            const auto     live   = std::span( adjacency ).subspan( offsets[ vertex ], numLive[ vertex ] );
+            std::swap( *std::ranges::find( live, bestTriangle ), live.back( ) );
+            --numLive[ vertex ];
+        }
+        for ( const uint32_t vertex : cache )
+        {
+            if ( vertex != triangle[ 0 ] && vertex != triangle[ 1 ] && vertex != triangle[ 2 ] )
+            {
+                nextCache.push_back( vertex );
+            }
+        }
+
+        // Vertices pushed past the modelled cache are rescored once more as uncached, then dropped
+        for ( size_t position = 0; position < nextCache.size( ); ++position )
+        {
+            const uint32_t vertex    = nextCache[ position ];
+            cachePositions[ vertex ] = position < CacheSize ? static_cast<int>( position ) : -1;
+            vertexScores[ vertex ]   = VertexScore( cachePositions[ vertex ], numLive[ vertex ] );
+        }
+        bestTriangle    = Unused;
+        float bestScore = -std::numeric_limits<float>::max( );
+        for ( const uint32_t vertex : nextCache )
+        {
+            for ( const uint32_t adjacent : std::span( adjacency ).subspan( offsets[ vertex ], numLive[ vertex ] ) )
+            {
+                const uint32_t *corners    = &indices[ adjacent * 3 ];
+                triangleScores[ adjacent ] = vertexScores[ corners[ 0 ] ] + vertexScores[ corners[ 1 ] ] + vertexScores[ corners[ 2 ] ];
+                if ( triangleScores[ adjacent ] > bestScore )
+                {
+                    bestScore    = triangleScores[ adjacent ];
+                    bestTriangle = adjacent;
+                }
+            }
+        }
+        nextCache.resize( std::min<size_t>( nextCache.size( ), CacheSize ) );
+        std::swap( cache, nextCache );
+    }
+    std::ranges::copy( output, indices.begin( ) );
+}
+
+void MeshOptimizer::OptimizeOverdraw( const std::span<uint32_t> indices, const Byte *vertices, const size_t numVertices, const size_t vertexStride, const float threshold )
+{
+    const size_t numTriangles = indices.size( ) / 3;
+    if ( numTriangles == 0 )
+    {
+        return;
+    }
+
+    struct Cluster
+    {
+        uint32_t Start;
+        uint32_t End;
+        float    Sort; // Distance of the cluster from the center along its normal, outward facing clusters occlude more of the mesh
+    };
+
+    std::vector<Cluster>        clusters;
+    const std::vector<uint32_t> starts = FindClusters( indices, numVertices, threshold );
+    for ( size_t i = 0; i < starts.size( ); ++i )
+    {
+        clusters.push_back( Cluster{ starts[ i ], i + 1 < starts.size( ) ? starts[ i + 1 ] : static_cast<uint32_t>( numTriangles ), 0.0f } );
+    }
+
+    // Area weighted centroids and normals
+    std::vector<double> centroids( clusters.size( ) * 3, 0.0 );
+    std::vector<double> normals( clusters.size( ) * 3, 0.0 );
+    std::vector<double> areas( clusters.size( ), 0.0 );
+    double              meshCentroid[ 3 ] = { };
+    double              meshArea          = 0.0;
+    for ( size_t c = 0; c < clusters.size( ); ++c )
+    {
+        for ( uint32_t triangle = clusters[ c ].Start; triangle < clusters[ c ].End; ++triangle )
+        {
+            const float *p0 = PositionOf( vertices, vertexStride, indices[ triangle * 3 + 0 ] );
+            const float *p1 = PositionOf( vertices, vertexStride, indices[ triangle * 3 + 1 ] );
+            const float *p2 = PositionOf( vertices, vertexStride, indices[ triangle * 3 + 2 ] );
+
+            const double e1[ 3 ] = { p1[ 0 ] - p0[ 0 ], p1[ 1 ] - p0[ 1 ], p1[ 2 ] - p0[ 2 ] };
+            const double e2[ 3 ] = { p2[ 0 ] - p0[ 0 ], p2[ 1 ] - p0[ 1 ], p2[ 2 ] - p0[ 2 ] };
+            const double n[ 3 ]  = { e1[ 1 ] * e2[ 2 ] - e1[ 2 ] * e2[ 1 ], e1[ 2 ] * e2[ 0 ] - e1[ 0 ] * e2[ 2 ], e1[ 0 ] * e2[ 1 ] - e1[ 1 ] * e2[ 0 ] };
+            const double area    = std::sqrt( n[ 0 ] * n[ 0 ] + n[ 1 ] * n[ 1 ] + n[ 2 ] * n[ 2 ] );
+            for ( int axis = 0; axis < 3; ++axis )
+            {
+                const double center = ( p0[ axis ] + p1[ axis ] + p2[ axis ] ) / 3.0;
+                centroids[ c * 3 + axis ] += center * area;
+                normals[ c * 3 + axis ] += n[ axis ];
+                meshCentroid[ axis ] += center * area;
+            }
+            areas[ c ] += area;
+            meshArea += area;
+        }
+    }
+
+    for ( size_t c = 0; c < clusters.size( ); ++c )
+    {
+        const double *normal = &normals[ c * 3 ];
+        const double  length = std::sqrt( normal[ 0 ] * normal[ 0 ] + normal[ 1 ] * normal[ 1 ] + normal[ 2 ] * normal[ 2 ] );
+        if ( length <= 0.0 || areas[ c ] <= 0.0 || meshArea <= 0.0 )
+        {
+            continue;
+        }
+
+        double sort = 0.0;
+        for ( int axis = 0; axis < 3; ++axis )
+        {
+            sort += ( centroids[ c * 3 + axis ] / areas[ c ] - meshCentroid[ axis ] / meshArea ) * normal[ axis ] / length;
+        }
+        clusters[ c ].Sort = static_cast<float>( sort );
+    }
+    std::ranges::stable_sort( clusters, std::ranges::greater{ }, &Cluster::Sort );
+
+    std::vector<uint32_t> output;
+    output.reserve( indices.size( ) );
+    for ( const Cluster &cluster : clusters )
+    {
+        output.insert( output.end( ), indices.begin( ) + cluster.Start * 3, indices.begin( ) + cluster.End * 3 );
+    }
+    std::ranges::copy( output, indices.begin( ) );
+}
+
+size_t MeshOptimizer::OptimizeVertexFetch( Byte *vertices, const size_t numVertices, const size_t vertexStride, const std::span<uint32_t> indices )
+{
+    std::vector<uint32_t> remap( numVertices, Unused );
+    uint32_t              numUsed = 0;
+    for ( const uint32_t index : indices )
+    {
+        if ( remap[ index ] == Unused )
+        {
+            remap[ index ] = numUsed++;
+        }
+    }
+    return ReorderVertices( vertices, numVertices, vertexStride, indices, remap );
+}
+
+MeshVertexCacheStats MeshOptimizer::AnalyzeVertexCache( const std::span<const uint32_t> indices, const size_t numVertices, const uint32_t cacheSize )
+{
+    MeshVertexCacheStats stats{ };
+    FifoCache            cache( numVertices, cacheSize );
+    std::vector<uint8_t> referenced( numVertices, 0 );
+    size_t               numReferenced = 0;
+    for ( size_t i = 0; i + 2 < indices.size( ); i += 3 )
+    {
+        stats.NumTransformed += cache.Access( &indices[ i ] );
+        for ( uint32_t corner = 0; corner < 3; ++corner )
+        {
+            numReferenced += referenced[ indices[ i + corner ] ] == 0;
+            referenced[ indices[ i + corner ] ] = 1;
+        }
+    }
+
+    const size_t numTriangles = indices.size( ) / 3;
+    stats.ACMR                = numTriangles > 0 ? static_cast<float>( stats.NumTransformed ) / static_cast<float>( numTriangles ) : 0.0f;
+    stats.ATVR                = numReferenced > 0 ? static_cast<float>( stats.NumTransformed ) / static_cast<float>( numReferenced ) : 0.0f;
+    return stats;
+}
+
+MeshOverdrawStats MeshOptimizer::AnalyzeOverdraw( const std::span<const uint32_t> indices, const Byte *vertices, const size_t numVertices, const size_t vertexStride )
+{
+    MeshOverdrawStats stats{ };
+    float             minimum[ 3 ] = { std::numeric_limits<float>::max( ), std::numeric_limits<float>::max( ), std::numeric_limits<float>::max( ) };
+    float             extent       = 0.0f;
+    for ( uint32_t vertex = 0; vertex < numVertices; ++vertex )
+    {
+        const float *position = PositionOf( vertices, vertexStride, vertex );
+        for ( int axis = 0; axis < 3; ++axis )
+        {
+            minimum[ axis ] = std::min( minimum[ axis ], position[ axis ] );
+        }
+    }
+    for ( uint32_t vertex = 0; vertex < numVertices; ++vertex )
+    {
+        const float *position = PositionOf( vertices, vertexStride, vertex );
+        for ( int axis = 0; axis < 3; ++axis )
+        {
+            extent = std::max( extent, position[ axis ] - minimum[ axis ] );
+        }
+    }
+    const float scale = extent > 0.0f ? static_cast<float>( OverdrawGridSize - 1 ) / extent : 0.0f;
+
+    std::vector<float> depth( OverdrawGridSize * OverdrawGridSize );
+    for ( int view = 0; view < 6; ++view )
+    {
+        const int   axis      = view / 2;
+        const float direction = view % 2 == 0 ? 1.0f : -1.0f;
+        std::ranges::fill( depth, std::numeric_limits<float>::max( ) );
+        for ( size_t i = 0; i + 2 < indices.size( ); i += 3 )
+        {
+            // Projected onto the other two axes in pixels, the depth grows away from the viewer
+            float x[ 3 ], y[ 3 ], z[ 3 ];
+            for ( uint32_t corner = 0; corner < 3; ++corner )
+            {
+                const float *position = PositionOf( vertices, vertexStride, indices[ i + corner ] );
+                x[ corner ]           = ( position[ ( axis + 1 ) % 3 ] - minimum[ ( axis + 1 ) % 3 ] ) * scale;
+                y[ corner ]           = ( position[ ( axis + 2 ) % 3 ] - minimum[ ( axis + 2 ) % 3 ] ) * scale;
+                z[ corner ]           = ( position[ axis ] - minimum[ axis ] ) * direction;
+            }
+
+            const float area = ( x[ 1 ] - x[ 0 ] ) * ( y[ 2 ] - y[ 0 ] ) - ( x[ 2 ] - x[ 0 ] ) * ( y[ 1 ] - y[ 0 ] );
+            if ( area * direction >= 0.0f )
+            {
+                continue; // Back facing or degenerate, the cross product of the edges points away from the viewer
+            }
+
+            const int minX = std::max( 0, static_cast<int>( std::floor( std::min( { x[ 0 ], x[ 1 ], x[ 2 ] } ) ) ) );
+            const int maxX = std::min( OverdrawGridSize - 1, static_cast<int>( std::ceil( std::max( { x[ 0 ], x[ 1 ], x[ 2 ] } ) ) ) );
+            const int minY = std::max( 0, static_cast<int>( std::floor( std::min( { y[ 0 ], y[ 1 ], y[ 2 ] } ) ) ) );
+            const int maxY = std::min( OverdrawGridSize - 1, static_cast<int>( std::ceil( std::max( { y[ 0 ], y[ 1 ], y[ 2 ] } ) ) ) );
+            for ( int py = minY; py <= maxY; ++py )
+            {
+                for ( int px = minX; px <= maxX; ++px )
+                {
+                    // Barycentrics at the pixel center, normalized by the signed area so either winding rasterizes
+                    const float cx = static_cast<float>( px ) + 0.5f;
+                    const float cy = static_cast<float>( py ) + 0.5f;
+                    const float w0 = ( ( x[ 1 ] - cx ) * ( y[ 2 ] - cy ) - ( x[ 2 ] - cx ) * ( y[ 1 ] - cy ) ) / area;
+                    const float w1 = ( ( x[ 2 ] - cx ) * ( y[ 0 ] - cy ) - ( x[ 0 ] - cx ) * ( y[ 2 ] - cy ) ) / area;
+                    const float w2 = 1.0f - w0 - w1;
+                    if ( w0 < 0.0f || w1 < 0.0f || w2 < 0.0f )
+                    {
+                        continue;
+                    }
+
+                    float &pixel = depth[ py * OverdrawGridSize + px ];
+                    if ( const float pixelDepth = w0 * z[ 0 ] + w1 * z[ 1 ] + w2 * z[ 2 ]; pixelDepth < pixel )
+                    {
+                        pixel = pixelDepth;
+                        ++stats.NumShaded;
+                    }
+                }
+            }
+        }
+        stats.NumCovered += std::ranges::count_if( depth, []( const float pixel ) { return pixel != std::numeric_limits<float>::max( ); } );
+    }
+
+    stats.Overdraw = stats.NumCovered > 0 ? static_cast<float>( stats.NumShaded ) / static_cast<float>( stats.NumCovered ) : 0.0f;
+    return stats;
+}
+
+MeshVertexFetchStats MeshOptimizer::AnalyzeVertexFetch( const std::span<const uint32_t> indices, const size_t numVertices, const size_t vertexStride )
+{
+    MeshVertexFetchStats stats{ };
+    std::vector<size_t>  lines( NumCacheLines, std::numeric_limits<size_t>::max( ) );
+    std::vector<uint8_t> referenced( numVertices, 0 );
+    size_t               numReferenced = 0;
+    for ( const uint32_t index : indices )
+    {
+        numReferenced += referenced[ index ] == 0;
+        referenced[ index ] = 1;
+
+        const size_t first = index * vertexStride / CacheLineSize;
+        const size_t last  = ( ( index + 1 ) * vertexStride - 1 ) / CacheLineSize;
+        for ( size_t line = first; line <= last; ++line )
+        {
+            if ( lines[ line % NumCacheLines ] != line )
+            {
+                lines[ line % NumCacheLines ] = line;
+                stats.NumBytesFetched += CacheLineSize;
+            }
+        }
+    }
+
+    const size_t numReferencedBytes = numReferenced * vertexStride;
+    stats.Overfetch                 = numReferencedBytes > 0 ? static_cast<float>( stats.NumBytesFetched ) / static_cast<float>( numReferencedBytes ) : 0.0f;
+    return stats;
+}
+
+std::vector<uint32_t> MeshOptimizer::FindClusters( const std::span<const uint32_t> indices, const size_t numVertices, const float threshold )
+{
+    const auto numTriangles = static_cast<uint32_t>( indices.size( ) / 3 );
+    FifoCache  cache( numVertices, CacheSize );
+
+    std::vector<uint32_t> hardStarts;
+    for ( uint32_t triangle = 0; triangle < numTriangles; ++triangle )
+    {
+        if ( cache.Access( &indices[ triangle * 3 ] ) == 3 || triangle == 0 )
+        {
+            hardStarts.push_back( triangle );
+        }
+    }
+
+    // Each cluster starts with a cold cache, so a cluster is split as soon as its prefix is within threshold of the ACMR of the whole cluster
+    std::vector<uint32_t> starts;
+    for ( size_t i = 0; i < hardStarts.size( ); ++i )
+    {
+        const uint32_t start = hardStarts[ i ];
+        const uint32_t end   = i + 1 < hardStarts.size( ) ? hardStarts[ i + 1 ] : numTriangles;
+
+        cache.Reset( );
+        size_t numMisses = 0;
+        for ( uint32_t triangle = start; triangle < end; ++triangle )
+        {
+            numMisses += cache.Access( &indices[ triangle * 3 ] );
+        }
+        const float targetACMR = static_cast<float>( numMisses ) / static_cast<float>( end - start ) * threshold;
+
+        cache.Reset( );
+        starts.push_back( start );
+        uint32_t clusterStart = start;
+        numMisses             = 0;
+        for ( uint32_t triangle = start; triangle < end; ++triangle )
+        {
+            numMisses += cache.Access( &indices[ triangle * 3 ] );
+            if ( triangle + 1 < end && static_cast<float>( numMisses ) <= targetACMR * static_cast<float>( triangle + 1 - clusterStart ) )
+            {
+                cache.Reset( );
+                clusterStart = triangle + 1;
+                numMisses    = 0;
+                starts.push_back( clusterStart );
+            }
+        }
+    }
+    return starts;
+}
+
+size_t MeshOptimizer::ReorderVertices( Byte *vertices, const size_t numVertices, const size_t vertexStride, const std::span<uint32_t> indices,
+                                       const std::span<const uint32_t> remap )
+{
+    const std::vector<Byte> source( vertices, vertices + numVertices * vertexStride );
+    size_t                  numRemapped = 0;
+    for ( uint32_t vertex = 0; vertex < numVertices; ++vertex )
+    {
+        if ( remap[ vertex ] != Unused )
+        {
+            std::memcpy( vertices + remap[ vertex ] * vertexStride, source.data( ) + vertex * vertexStride, vertexStride );
+            numRemapped = std::max<size_t>( numRemapped, remap[ vertex ] + 1 );
+        }
+    }
+    for ( uint32_t &index : indices )
+    {
+        index = remap[ index ];
+    }
+    return numRemapped;
+}
@@ -0,0 +1,560 @@
+/*
+Den Of Iz - Game/Game Engine
+Copyright (c) 2020-2024 Muhammed Murat Cengiz
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "DZEngine/Assets/MeshSimplifier.h"
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <unordered_map>
+
+using namespace DZEngine;
+
+namespace
+{
+    constexpr double BorderWeight = 10.0; // Open borders keep their outline harder than seams, nothing on the other side hides their motion
+    constexpr double SeamWeight   = 1.0;
+
+    struct PositionKey
+    {
+        uint32_t X, Y, Z;
+
+        bool operator==( const PositionKey &other ) const = default;
+    };
+
+    struct PositionKeyHasher
+    {
+        size_t operator( )( const PositionKey &key ) const
+        {
+            return ( key.X * 73856093u ) ^ ( key.Y * 19349663u ) ^ ( key.Z * 83492791u );
+        }
+    };
+
+    struct Vector
+    {
+        double X, Y, Z;
+    };
+
+    Vector Subtract( const auto &a, const auto &b )
+    {
+        return Vector{ static_cast<double>( a.X ) - b.X, static_cast<double>( a.Y ) - b.Y, static_cast<double>( a.Z ) - b.Z };
+    }
+
+    Vector Cross( const Vector &a, const Vector &b )
+    {
+        return Vector{ a.Y * b.Z - a.Z * b.Y, a.Z * b.X - a.X * b.Z, a.X * b.Y - a.Y * b.X };
+    }
+
+    double Dot( const Vector &a, const Vector &b )
+    {
+        return a.X * b.X + a.Y * b.Y + a.Z * b.Z;
+    }
+
+    double Length( const Vector &a )
+    {
+        return std::sqrt( Dot( a, a ) );
+    }
+
+    // Adjacency lists of the vertices in one array, the items of vertex v are Items[ Offsets[ v ] .. Offsets[ v + 1 ] )
+    struct VertexLists
+    {
+        std::vector<uint32_t> Offsets;
+        std::vector<uint32_t> Items;
+
+        std::span<const uint32_t> Of( const uint32_t vertex ) const
+        {
+            return std::span( Items ).subspan( Offsets[ vertex ], Offsets[ vertex + 1 ] - Offsets[ vertex ] );
+        }
+    };
+
+    // Item of every corner is either its triangle or the next vertex of the triangle, so the half edges leaving the vertex
+    VertexLists BuildVertexLists( const std::vector<uint32_t> &indices, const size_t numVertices, const bool halfEdges )
+    {
+        VertexLists lists;
+        lists.Offsets.assign( numVertices + 1, 0 );
+        for ( const uint32_t index : indices )
+        {
+            ++lists.Offsets[ index + 1 ];
+        }
+        for ( size_t i = 0; i < numVertices; ++i )
+        {
+            lists.Offsets[ i + 1 ] += lists.Offsets[ i ];
+        }
+
+        std::vector<uint32_t> cursors( lists.Offsets.begin( ), lists.Offsets.end( ) - 1 );
+        lists.Items.resize( indices.size( ) );
+        for ( size_t i = 0; i < indices.size( ); ++i )
+        {
+            const size_t triangle = i / 3;
+            const size_t next     = triangle * 3 + ( i + 1 ) % 3;
+            lists.Items[ cursors[ indices[ i ] ]++ ] = halfEdges ? indices[ next ] : static_cast<uint32_t>( triangle );
+        }
+        return lists;
+    }
+} // namespace
+
+void MeshSimplifier::Quadric::AddPlane( const double a, const double b, const double c, const double d, const double weight )
+{
+    A00 += weight * a * a;
+    A11 += weight * b * b;
+    A22 += weight * c * c;
+    A10 += weight * b * a;
+    A20 += weight * c * a;
+    A21 += weight * c * b;
+    B0 += weight * a * d;
+    B1 += weight * b * d;
+    B2 += weight * c * d;
+    C += weight * d * d;
+    Weight += weight;
+}
+
+void MeshSimplifier::Quadric::Add( const Quadric &other )
+{
+    A00 += other.A00;
+    A11 += other.A11;
+    A22 += other.A22;
+    A10 += other.A10;
+    A20 += other.A20;
+    A21 += other.A21;
+    B0 += other.B0;
+    B1 += other.B1;
+    B2 += other.B2;
+    C += other.C;
+    Weight += other.Weight;
+}
+
+double MeshSimplifier::Quadric::Error( const Position &position ) const
+{
+    if ( Weight <= 0.0 )
+    {
+        return 0.0;
+    }
+
+    const double x  = position.X;
+    const double y  = position.Y;
+    const double z  = position.Z;
+    const double rx = A00 * x + A10 * y + A20 * z;
+    const double ry = A10 * x + A11 * y + A21 * z;
+    const double rz = A20 * x + A21 * y + A22 * z;
+    const double r  = rx * x + ry * y + rz * z + 2.0 * ( B0 * x + B1 * y + B2 * z ) + C;
+    return std::max( r, 0.0 ) / Weight;
+}
+
+MeshSimplifier::MeshSimplifier( const MeshSimplifierDesc &desc ) : m_indices( desc.Indices.begin( ), desc.Indices.begin( ) + desc.Indices.size( ) / 3 * 3 )
+{
+    std::erase_if( m_indices, [ & ]( const uint32_t index ) { return index >= desc.NumVertices; } );
+    m_indices.resize( m_indices.size( ) / 3 * 3 );
+
+    BuildPositions( desc );
+    std::vector<OpenEdge> openEdges;
+    ClassifyVertices( openEdges );
+    BuildQuadrics( openEdges );
+}
+
+size_t MeshSimplifier::Simplify( const size_t targetNumIndices, const float maxError )
+{
+    const double normalizedError = maxError / m_scale;
+    const float  maxErrorSquared = maxError == FLT_MAX ? FLT_MAX : static_cast<float>( normalizedError * normalizedError );
+    while ( m_indices.size( ) > targetNumIndices )
+    {
+        if ( CollapseEdges( ( m_indices.size( ) - targetNumIndices + 2 ) / 3, maxErrorSquared ) == 0 )
+        {
+            break;
+        }
+    }
+    return m_indices.size( );
+}
+
+const std::vector<uint32_t> &MeshSimplifier::GetIndices( ) const
+{
+    return m_indices;
+}
+
+float MeshSimplifier::GetError( ) const
+{
+    return std::sqrt( m_error ) * m_scale;
+}
+
+std::vector<MeshLODLevel> MeshSimplifier::BuildLODChain( const MeshSimplifierDesc &desc, const MeshLODChainDesc &chainDesc )
+{
+    std::vector<MeshLODLevel> levels;
+    MeshSimplifier            simplifier( desc );
+    size_t                    numIndices = simplifier.GetIndices( ).size( );
+    for ( uint32_t level = 0; level < chainDesc.NumLevels; ++level )
+    {
+        const size_t target = std::max<size_t>( static_cast<size_t>( numIndices / 3 * chainDesc.Reduction ), chainDesc.MinNumTriangles ) * 3;
+        if ( target >= numIndices )
+        {
+            break;
+        }
+
+        const size_t simplified = simplifier.Simplify( target, chainDesc.MaxError );
+        if ( simplified == 0 || static_cast<float>( simplified ) > static_cast<float>( numIndices ) * chainDesc.MinProgress )
+        {
+            break;
+        }
+        levels.push_back( MeshLODLevel{ simplifier.GetIndices( ), simplifier.GetError( ) } );
+        numIndices = simplified;
+    }
+    return levels;
+}
+
+void MeshSimplifier::BuildPositions( const MeshSimplifierDesc &desc )
+{
+    const auto *data = reinterpret_cast<const std::byte *>( desc.Positions );
+    m_positions.resize( desc.NumVertices );
+    m_remap.resize( desc.NumVertices );
+    m_wedges.resize( desc.NumVertices );
+
+    std::unordered_map<PositionKey, uint32_t, PositionKeyHasher> firstVertices;
+    firstVertices.reserve( desc.NumVertices );
+    Position minimum{ FLT_MAX, FLT_MAX, FLT_MAX };
+    Position maximum{ -FLT_MAX, -FLT_MAX, -FLT_MAX };
+    for ( uint32_t i = 0; i < desc.NumVertices; ++i )
+    {
+        const auto *position = reinterpret_cast<const float *>( data + i * desc.PositionStride );
+        m_positions[ i ]     = Position{ position[ 0 ], position[ 1 ], position[ 2 ] };
+        minimum              = Position{ std::min( minimum.X, position[ 0 ] ), std::min( minimum.Y, position[ 1 ] ), std::min( minimum.Z, position[ 2 ] ) };
+        maximum              = Position{ std::max( maximum.X, position[ 0 ] ), std::max( maximum.Y, position[ 1 ] ), std::max( maximum.Z, position[ 2 ] ) };
+
+        // + 0.0f folds -0 into 0
+        const PositionKey key{ std::bit_cast<uint32_t>( position[ 0 ] + 0.0f ), std::bit_cast<uint32_t>( position[ 1 ] + 0.0f ), std::bit_cast<uint32_t>( position[ 2 ] + 0.0f ) };
+        const auto [ first, inserted ] = firstVertices.try_emplace( key, i );
+        m_remap[ i ]                   = first->second;
+        m_wedges[ i ]                  = i;
+        if ( !inserted )
+        {
+            m_wedges[ i ]             = m_wedges[ first->second ];
+            m_wedges[ first->second ] = i;
+        }
+    }
+
+    const float extent = std::max( { maximum.X - minimum.X, maximum.Y - minimum.Y, maximum.Z - minimum.Z } );
+    m_scale            = extent > 0.0f ? extent : 1.0f;
+    for ( Position &position : m_positions )
+    {
+        position = Position{ ( position.X - minimum.X ) / m_scale, ( position.Y - minimum.Y ) / m_scale, ( position.Z - minimum.Z ) / m_scale };
+    }
+}
+
+void MeshSimplifier::ClassifyVertices( std::vector<OpenEdge> &outOpenEdges )
+{
+    const size_t      numVertices = m_positions.size( );
+    const VertexLists edges       = BuildVertexLists( m_indices, numVertices, true );
+    const auto        hasEdge     = [ & ]( const uint32_t a, const uint32_t b ) { return std::ranges::find( edges.Of( a ), b ) != edges.Of( a ).end( ); };
+    // Any side of a edge between the positions of a and b
+    const auto hasPositionEdge = [ & ]( const uint32_t a, const uint32_t b )
+    {
+        uint32_t wedge = a;
+        do
+        {
+            for ( const uint32_t next : edges.Of( wedge ) )
+            {
+                if ( m_remap[ next ] == m_remap[ b ] )
+                {
+                    return true;
+                }
+            }
+            wedge = m_wedges[ wedge ];
+        }
+        while ( wedge != a );
+        return false;
+    };
+
+    m_openNext.assign( numVertices, InvalidVertex );
+    m_openPrev.assign( numVertices, InvalidVertex );
+    std::vector<uint32_t> numOpenNext( numVertices, 0 );
+    std::vector<uint32_t> numOpenPrev( numVertices, 0 );
+    for ( size_t i = 0; i < m_indices.size( ); ++i )
+    {
+        const uint32_t a = m_indices[ i ];
+        const uint32_t b = m_indices[ i / 3 * 3 + ( i + 1 ) % 3 ];
+        if ( !hasEdge( b, a ) )
+        {
+            m_openNext[ a ] = b;
+            m_openPrev[ b ] = a;
+            ++numOpenNext[ a ];
+            ++numOpenPrev[ b ];
+            outOpenEdges.push_back( OpenEdge{ static_cast<uint32_t>( i ), hasPositionEdge( b, a ) } );
+        }
+    }
+
+    m_kinds.assign( numVertices, VertexKind::Locked );
+    for ( uint32_t i = 0; i < numVertices; ++i )
+    {
+        if ( m_remap[ i ] != i )
+        {
+            continue;
+        }
+
+        const bool oneOpenEdgeEach = numOpenNext[ i ] == 1 && numOpenPrev[ i ] == 1;
+        VertexKind kind            = VertexKind::Locked;
+        if ( m_wedges[ i ] == i )
+        {
+            kind = numOpenNext[ i ] == 0 && numOpenPrev[ i ] == 0 ? VertexKind::Manifold : oneOpenEdgeEach ? VertexKind::Border : VertexKind::Locked;
+        }
+        else if ( const uint32_t other = m_wedges[ i ]; m_wedges[ other ] == i && oneOpenEdgeEach && numOpenNext[ other ] == 1 && numOpenPrev[ other ] == 1 )
+        {
+            // Both sides end their open edges at the same positions, so the open edges run along the seam and aren't a border of the surface
+            const bool seam = hasPositionEdge( m_openNext[ i ], i ) && hasPositionEdge( i, m_openPrev[ i ] ) && hasPositionEdge( m_openNext[ other ], other ) &&
+                              hasPositionEdge( other, m_openPrev[ other ] );
+            kind = seam ? VertexKind::Seam : VertexKind::Locked;
+        }
+
+        uint32_t wedge = i;
+        do
+        {
+            m_kinds[ wedge ] = kind;
+            wedge            = m_wedges[ wedge ];
+        }
+        while ( wedge != i );
+    }
+}
+
+void MeshSimplifier::BuildQuadrics( const std::span<const OpenEdge> openEdges )
+{
+    m_quadrics.assign( m_positions.size( ), Quadric{ } );
+    const auto triangleNormal = [ & ]( const size_t triangle, double &outArea )
+    {
+        const Position &p0     = m_positions[ m_indices[ triangle * 3 + 0 ] ];
+        const Vector    normal = Cross( Subtract( m_positions[ m_indices[ triangle * 3 + 1 ] ], p0 ), Subtract( m_positions[ m_indices[ triangle * 3 + 2 ] ], p0 ) );
+        const double    length = Length( normal );
+        outArea                = length * 0.5;
+        return length > 0.0 ? Vector{ normal.X / length, normal.Y / length, normal.Z / length } : normal;
+    };
+
+    // Area weighted planes of the triangles, so the error of moving a vertex is the mean squared distance to the surface around it
+    for ( size_t triangle = 0; triangle < m_indices.size( ) / 3; ++triangle )
+    {
+        double       area;
+        const Vector normal = triangleNormal( triangle, area );
+        if ( area <= 0.0 )
+        {
+            continue;
+        }
+
+        const Position &p0       = m_positions[ m_indices[ triangle * 3 ] ];
+        const double    distance = -( normal.X * p0.X + normal.Y * p0.Y + normal.Z * p0.Z );
+        for ( uint32_t corner = 0; corner < 3; ++corner )
+        {
+            m_quadrics[ m_remap[ m_indices[ triangle * 3 + corner ] ] ].AddPlane( normal.X, normal.Y, normal.Z, distance, area );
+        }
+    }
+
+    // Planes through the open edges perpendicular to their triangles, moving along the surface off the outline is an error as well
+    for ( const auto &[ corner, seam ] : openEdges )
+    {
+        double       area;
+        const Vector normal = triangleNormal( corner / 3, area );
+        const uint32_t a    = m_indices[ corner ];
+        const uint32_t b    = m_indices[ corner / 3 * 3 + ( corner + 1 ) % 3 ];
+        const Vector   edge = Subtract( m_positions[ b ], m_positions[ a ] );
+        const Vector   perpendicular = Cross( edge, normal );
+        const double   length        = Length( perpendicular );
+        if ( area <= 0.0 || length <= 0.0 )
+        {
+            continue;
+        }
+
+        const Vector    plane    = { perpendicular.X / length, perpendicular.Y / length, perpendicular.Z / length };
+        const Position &pa       = m_positions[ a ];
+        const double    distance = -( plane.X * pa.X + plane.Y * pa.Y + plane.Z * pa.Z );
+        const double    weight   = Dot( edge, edge ) * ( seam ? SeamWeight : BorderWeight );
+        m_quadrics[ m_remap[ a ] ].AddPlane( plane.X, plane.Y, plane.Z, distance, weight );
+        m_quadrics[ m_remap[ b ] ].AddPlane( plane.X, plane.Y, plane.Z, distance, weight );
+    }
+}
+
+bool MeshSimplifier::CanCollapse( const uint32_t vertex, const uint32_t target ) const
+{
+    if ( m_remap[ vertex ] == m_remap[ target ] )
+    {
+        return false;
+    }
+
+    const bool alongOpenEdge = target == m_openNext[ vertex ] || target == m_openPrev[ vertex ];
+    switch ( m_kinds[ vertex ] )
+    {
+    case VertexKind::Manifold:
+        return true;
+    case VertexKind::Border:
+        return alongOpenEdge && m_kinds[ target ] != VertexKind::Manifold;
+    case VertexKind::Seam:
+        return alongOpenEdge && ( m_kinds[ target ] == VertexKind::Seam || m_kinds[ target ] == VertexKind::Locked ) && SeamTarget( vertex, target ) != InvalidVertex;
+    case VertexKind::Locked:
+        return false;
+    }
+    return false;
+}
+
+uint32_t MeshSimplifier::SeamTarget( const uint32_t vertex, const uint32_t target ) const
+{
+    const uint32_t other = m_wedges[ vertex ];
+    for ( const uint32_t candidate : { m_openNext[ other ], m_openPrev[ other ] } )
+    {
+        if ( candidate != InvalidVertex && m_remap[ candidate ] == m_remap[ target ] )
+        {
+            return candidate;
+        }
+    }
+    return InvalidVertex;
+}
+
+bool MeshSimplifier::HasTriangleFlips( const std::span<const uint32_t> triangles, const std::vector<uint32_t> &collapseRemap, const uint32_t vertex, const uint32_t target ) const
+{
+    const Position &from = m_positions[ vertex ];
+    const Position &to   = m_positions[ target ];
+    for ( const uint32_t triangle : triangles )
+    {
+        uint32_t corner = 0;
+        while ( m_indices[ triangle * 3 + corner ] != vertex )
+        {
+            ++corner;
+        }
+
+        // Corners moved by the collapses of this pass are already where they will be
+        const uint32_t b = collapseRemap[ m_indices[ triangle * 3 + ( corner + 1 ) % 3 ] ];
+        const uint32_t c = collapseRemap[ m_indices[ triangle * 3 + ( corner + 2 ) % 3 ] ];
+        if ( m_remap[ b ] == m_remap[ target ] || m_remap[ c ] == m_remap[ target ] || m_remap[ b ] == m_remap[ c ] )
+        {
+            continue; // Removed by the collapse or already degenerate
+        }
+
+        // Rejecting only turns past 90 degrees lets a triangle flip over through a series of collapses just short of it, so the cutoff is ~75 degrees
+        const Vector before = Cross( Subtract( m_positions[ b ], from ), Subtract( m_positions[ c ], from ) );
+        const Vector after  = Cross( Subtract( m_positions[ b ], to ), Subtract( m_positions[ c ], to ) );
+        if ( Dot( before, before ) > 0.0 && Dot( before, after ) <= 0.25 * std::sqrt( Dot( before, before ) * Dot( after, after ) ) )
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+size_t MeshSimplifier::CollapseEdges( const size_t numTrianglesToRemove, const float maxError )
+{
+    const size_t      numVertices = m_positions.size( );
+    const VertexLists triangles   = BuildVertexLists( m_indices, numVertices, false );
+
+    std::vector<Collapse> collapses;
+    collapses.reserve( m_indices.size( ) * 2 );
+    for ( size_t i = 0; i < m_indices.size( ); ++i )
+    {
+        const uint32_t a = m_indices[ i ];
+        const uint32_t b = m_indices[ i / 3 * 3 + ( i + 1 ) % 3 ];
+        for ( const auto &[ vertex, target ] : { std::pair( a, b ), std::pair( b, a ) } )
+        {
+            if ( CanCollapse( vertex, target ) )
+            {
+                collapses.push_back( Collapse{ vertex, target, static_cast<float>( m_quadrics[ m_remap[ vertex ] ].Error( m_positions[ target ] ) ) } );
+            }
+        }
+    }
+    std::ranges::sort( collapses, { }, &Collapse::Error );
+
+    // The one-ring of a collapse is locked for the rest of the pass, a triangle moves at most one corner per pass so the flip checks see final positions
+    std::vector<uint32_t> collapseRemap( numVertices );
+    std::vector<uint8_t>  locked( numVertices, 0 );
+    for ( uint32_t i = 0; i < numVertices; ++i )
+    {
+        collapseRemap[ i ] = i;
+    }
+
+    size_t numCollapses = 0;
+    size_t numRemoved   = 0;
+    for ( const auto &[ vertex, target, error ] : collapses )
+    {
+        if ( error > maxError || numRemoved >= numTrianglesToRemove )
+        {
+            break;
+        }
+        if ( locked[ vertex ] || locked[ target ] )
+        {
+            continue;
+        }
+
+        const bool     seam        = m_kinds[ vertex ] == VertexKind::Seam;
+        const uint32_t otherVertex = seam ? m_wedges[ vertex ] : InvalidVertex;
+        const uint32_t otherTarget = seam ? SeamTarget( vertex, target ) : InvalidVertex;
+        if ( seam && ( otherTarget == InvalidVertex || locked[ otherVertex ] || locked[ otherTarget ] ) )
+        {
+            continue;
+        }
+        if ( HasTriangleFlips( triangles.Of( vertex ), collapseRemap, vertex, target ) ||
+             ( seam && HasTriangleFlips( triangles.Of( otherVertex ), collapseRemap, otherVertex, otherTarget ) ) )
+        {
+            continue;
+        }
+
+        const auto lockRing = [ & ]( const uint32_t moved )
+        {
+            for ( const uint32_t triangle : triangles.Of( moved ) )
+            {
+                locked[ m_indices[ triangle * 3 + 0 ] ] = 1;
+                locked[ m_indices[ triangle * 3 + 1 ] ] = 1;
+                locked[ m_indices[ triangle * 3 + 2 ] ] = 1;
+            }
+        };
+        collapseRemap[ vertex ] = target;
+        lockRing( vertex );
+        if ( seam )
+        {
+            collapseRemap[ otherVertex ] = otherTarget;
+            lockRing( otherVertex );
+        }
+        m_quadrics[ m_remap[ target ] ].Add( m_quadrics[ m_remap[ vertex ] ] );
+        m_error = std::max( m_error, error );
+        numRemoved += m_kinds[ vertex ] == VertexKind::Border ? 1 : 2;
+        ++numCollapses;
+    }
+    if ( numCollapses == 0 )
+    {
+        return 0;
+    }
+
+    size_t numIndices = 0;
+    for ( size_t i = 0; i < m_indices.size( ); i += 3 )
+    {
+        const uint32_t a = collapseRemap[ m_indices[ i + 0 ] ];
+        const uint32_t b = collapseRemap[ m_indices[ i + 1 ] ];
+        const uint32_t c = collapseRemap[ m_indices[ i + 2 ] ];
+        if ( m_remap[ a ] != m_remap[ b ] && m_remap[ b ] != m_remap[ c ] && m_remap[ c ] != m_remap[ a ] )
+        {
+            m_indices[ numIndices++ ] = a;
+            m_indices[ numIndices++ ] = b;
+            m_indices[ numIndices++ ] = c;
+        }
+    }
+    m_indices.resize( numIndices );
+
+    // An open edge to a collapsed vertex now ends at its target, or continues past it when the vertex collapsed onto this one
+    const auto remapOpenEdges = [ & ]( std::vector<uint32_t> &openEdges )
+    {
+        const std::vector<uint32_t> previous = openEdges;
+        for ( uint32_t i = 0; i < numVertices; ++i )
+        {
+            if ( const uint32_t other = previous[ i ]; other != InvalidVertex && collapseRemap[ other ] != other )
+            {
+                const uint32_t continued = previous[ other ];
+                openEdges[ i ]           = collapseRemap[ other ] != i ? collapseRemap[ other ] : continued == InvalidVertex ? InvalidVertex : collapseRemap[ continued ];
+            }
+        }
+    };
+    remapOpenEdges( m_openNext );
+    remapOpenEdges( m_openPrev );
+    return numCollapses;
+}
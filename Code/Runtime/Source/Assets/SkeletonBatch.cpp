@@ -17,6 +17,7 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 */
 
 #include "DZEngine/Assets/SkeletonBatch.h"
+#include <ranges>
 #include <spdlog/spdlog.h>
 
 using namespace DZEngine;
@@ -73,39 +74,63 @@ SkeletonHandle SkeletonBatch::LoadSkeleton( const std::string &alias, BinaryRead
 
 SkeletonHandle SkeletonBatch::AddSkeleton( const std::string &alias, const SkeletonAssetData &skeletonData )
 {
-    const size_t nextSkelHandle              = NextSkeletonHandle( alias );
-    m_skeletonData[ nextSkelHandle ]         = std::make_unique<SkeletonAssetData>( skeletonData );
-    m_skeletonData[ nextSkelHandle ]->Handle = SkeletonHandle( nextSkelHandle );
-    return SkeletonHandle( nextSkelHandle );
+    auto                 data    = std::make_unique<SkeletonAssetData>( skeletonData );
+    SkeletonAssetData   *dataPtr = data.get( );
+    std::lock_guard      lock( m_skeletonLock );
+    const SkeletonHandle handle( m_skeletonData.Insert( std::move( data ) ) );
+    if ( handle.IsValid( ) )
+    {
+        dataPtr->Handle        = handle;
+        m_skelAliases[ alias ] = handle;
+    }
+    return handle;
 }
 
-SkeletonAssetData *SkeletonBatch::GetSkeleton( const std::string &alias )
+bool SkeletonBatch::RemoveSkeleton( const SkeletonHandle handle )
 {
-    const auto it = m_skelAliases.find( alias );
-    if ( it == m_skelAliases.end( ) )
+    std::lock_guard lock( m_skeletonLock );
+    if ( !m_skeletonData.Remove( handle.Id ) )
     {
-        return nullptr;
+        spdlog::error( "SkeletonBatch::RemoveSkeleton - Invalid handle: {}", handle.Id );
+        return false;
     }
-    return m_skeletonData[ it->second.Id ].get( );
+    std::erase_if( m_skelAliases, [ & ]( const auto &alias ) { return alias.second == handle; } );
+    return true;
 }
 
-SkeletonAssetData *SkeletonBatch::GetSkeleton( const SkeletonHandle handle ) const
+bool SkeletonBatch::ReplaceSkeleton( const SkeletonHandle target, const SkeletonHandle replacement )
 {
-    if ( handle.Id >= m_skeletonData.size( ) )
+    std::lock_guard lock( m_skeletonLock );
+    const auto     *targetData      = m_skeletonData.Find( target.Id );
+    const auto     *replacementData = m_skeletonData.Find( replacement.Id );
+    if ( !targetData || !replacementData )
     {
-        return nullptr;
+        spdlog::error( "SkeletonBatch::ReplaceSkeleton - Invalid handle: {} or {}", target.Id, replacement.Id );
+        return false;
+    }
+    std::swap( **targetData, **replacementData );
+    std::swap( ( *targetData )->Handle, ( *replacementData )->Handle );
+    for ( SkeletonHandle &handle : m_skelAliases | std::views::values )
+    {
+        handle = handle == replacement ? target : handle;
     }
-    return m_skeletonData[ handle.Id ].get( );
+    return true;
 }
 
-size_t SkeletonBatch::NextSkeletonHandle( const std::string &alias )
+SkeletonAssetData *SkeletonBatch::GetSkeleton( const std::string &alias )
 {
-    std::lock_guard lock( m_nextSkelHandleLock );
-    m_nextSkelHandle++;
-    if ( m_nextSkelHandle >= m_skeletonData.size( ) )
+    std::shared_lock lock( m_skeletonLock );
+    const auto       it = m_skelAliases.find( alias );
+    if ( it == m_skelAliases.end( ) )
     {
-        m_skeletonData.resize( m_nextSkelHandle + 1 );
+        return nullptr;
     }
-    m_skelAliases[ alias ] = SkeletonHandle( m_nextSkelHandle );
-    return m_nextSkelHandle;
+    return m_skeletonData.Find( it->second.Id )->get( );
+}
+
+SkeletonAssetData *SkeletonBatch::GetSkeleton( const SkeletonHandle handle ) const
+{
+    std::shared_lock lock( m_skeletonLock );
+    const auto      *data = m_skeletonData.Find( handle.Id );
+    return data ? data->get( ) : nullptr;
 }
@@ -0,0 +1,89 @@
+/*
+Den Of Iz - Game/Game Engine
+Copyright (c) 2020-2024 Muhammed Murat Cengiz
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "DZEngine/Assets/UploadBuffer.h"
+
+#include <spdlog/spdlog.h>
+
+using namespace DZEngine;
+
+UploadBuffer::UploadBuffer( const UploadBufferDesc &desc )
+{
+    if ( !desc.LogicalDevice || desc.NumBytes == 0 )
+    {
+        return;
+    }
+
+    BufferDesc bufferDesc{ };
+    bufferDesc.Descriptor = ResourceDescriptor::Buffer;
+    bufferDesc.Usages     = ResourceUsage::CopySrc;
+    bufferDesc.HeapType   = HeapType::CPU_GPU;
+    bufferDesc.NumBytes   = desc.NumBytes;
+    bufferDesc.DebugName  = "Asset Upload Buffer";
+    m_buffer              = std::unique_ptr<IBufferResource>( desc.LogicalDevice->CreateBufferResource( bufferDesc ) );
+    if ( !m_buffer )
+    {
+        spdlog::error( "UploadBuffer: Failed to create a {} byte upload buffer", desc.NumBytes );
+        return;
+    }
+    m_mappedMemory = static_cast<Byte *>( m_buffer->MapMemory( ) );
+    m_numBytes     = m_mappedMemory ? desc.NumBytes : 0;
+}
+
+UploadBuffer::~UploadBuffer( )
+{
+    if ( m_mappedMemory )
+    {
+        m_buffer->UnmapMemory( );
+    }
+}
+
+UploadAllocation UploadBuffer::Allocate( const size_t numBytes )
+{
+    const size_t alignedNumBytes = ( numBytes + Alignment - 1 ) & ~( Alignment - 1 );
+    size_t       offset          = m_usedBytes.load( std::memory_order_relaxed );
+    do
+    {
+        if ( alignedNumBytes > m_numBytes - offset )
+        {
+            return UploadAllocation{ };
+        }
+    }
+    while ( !m_usedBytes.compare_exchange_weak( offset, offset + alignedNumBytes, std::memory_order_relaxed ) );
+
+    size_t peakBytes = m_peakBytes.load( std::memory_order_relaxed );
+    while ( offset + alignedNumBytes > peakBytes && !m_peakBytes.compare_exchange_weak( peakBytes, offset + alignedNumBytes, std::memory_order_relaxed ) )
+    {
+    }
+    return UploadAllocation{ m_buffer.get( ), offset, m_mappedMemory + offset };
+}
+
+void UploadBuffer::Reset( )
+{
+    m_usedBytes.store( 0, std::memory_order_relaxed );
+}
+
+size_t UploadBuffer::GetNumBytes( ) const
+{
+    return m_numBytes;
+}
+
+size_t UploadBuffer::GetPeakBytes( ) const
+{
+    return m_peakBytes.load( std::memory_order_relaxed );
+}
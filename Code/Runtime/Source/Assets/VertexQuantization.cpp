@@ -0,0 +1,229 @@
+/*
+Den Of Iz - Game/Game Engine
+Copyright (c) 2020-2024 Muhammed Murat Cengiz
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "DZEngine/Assets/VertexQuantization.h"
+
+#include <DirectXPackedVector.h>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+using namespace DZEngine;
+
+namespace
+{
+    uint32_t EncodeUnorm16( const float value )
+    {
+        return static_cast<uint32_t>( std::lround( std::clamp( value, 0.0f, 1.0f ) * 65535.0f ) );
+    }
+
+    float DecodeUnorm16( const uint32_t value )
+    {
+        return static_cast<float>( value & 0xFFFF ) / 65535.0f;
+    }
+
+    uint32_t EncodeSnorm16( const float value )
+    {
+        const auto quantized = static_cast<int16_t>( std::lround( std::clamp( value, -1.0f, 1.0f ) * 32767.0f ) );
+        return static_cast<uint16_t>( quantized );
+    }
+
+    float DecodeSnorm16( const uint32_t value )
+    {
+        return std::max( static_cast<float>( static_cast<int16_t>( value & 0xFFFF ) ) / 32767.0f, -1.0f );
+    }
+
+    uint32_t EncodeUnorm8( const float value )
+    {
+        return static_cast<uint32_t>( std::lround( std::clamp( value, 0.0f, 1.0f ) * 255.0f ) );
+    }
+
+    float SignNotZero( const float value )
+    {
+        return value >= 0.0f ? 1.0f : -1.0f;
+    }
+
+    float QuantizationT( const float value, const float min, const float max )
+    {
+        const float extent = max - min;
+        return extent > 0.0f ? ( value - min ) / extent : 0.0f;
+    }
+
+    float AngleBetween( const Float3 &a, const Float3 &b )
+    {
+        const float lengthA = std::sqrt( a.X * a.X + a.Y * a.Y + a.Z * a.Z );
+        const float lengthB = std::sqrt( b.X * b.X + b.Y * b.Y + b.Z * b.Z );
+        if ( lengthA == 0.0f || lengthB == 0.0f )
+        {
+            return 0.0f;
+        }
+        const float cosAngle = ( a.X * b.X + a.Y * b.Y + a.Z * b.Z ) / ( lengthA * lengthB );
+        return std::acos( std::clamp( cosAngle, -1.0f, 1.0f ) );
+    }
+} // namespace
+
+uint32_t VertexQuantization::VertexStride( const VertexFormat format )
+{
+    switch ( format )
+    {
+    case VertexFormat::Compact:
+        return sizeof( CompactMeshVertex );
+    case VertexFormat::Full:
+    default:
+        return sizeof( StaticMeshVertex );
+    }
+}
+
+uint32_t VertexQuantization::PositionStride( const VertexFormat format )
+{
+    switch ( format )
+    {
+    case VertexFormat::Compact:
+        return 2 * sizeof( uint32_t );
+    case VertexFormat::Full:
+    default:
+        return sizeof( Float4 );
+    }
+}
+
+CompactMeshVertex VertexQuantization::Encode( const StaticMeshVertex &vertex, const Float3 &boundsMin, const Float3 &boundsMax )
+{
+    CompactMeshVertex result{ };
+
+    const uint32_t x = EncodeUnorm16( QuantizationT( vertex.Position.X, boundsMin.X, boundsMax.X ) );
+    const uint32_t y = EncodeUnorm16( QuantizationT( vertex.Position.Y, boundsMin.Y, boundsMax.Y ) );
+    const uint32_t z = EncodeUnorm16( QuantizationT( vertex.Position.Z, boundsMin.Z, boundsMax.Z ) );
+
+    const uint32_t tangentSign = vertex.Tangent.W < 0.0f ? 1 : 0;
+    result.PositionXY          = x | y << 16;
+    result.PositionZW          = z | tangentSign << 16;
+    result.Normal              = EncodeOctahedral( Float3{ vertex.Normal.X, vertex.Normal.Y, vertex.Normal.Z } );
+    result.Tangent             = EncodeOctahedral( Float3{ vertex.Tangent.X, vertex.Tangent.Y, vertex.Tangent.Z } );
+
+    const uint32_t u = DirectX::PackedVector::XMConvertFloatToHalf( vertex.TexCoord.X );
+    const uint32_t v = DirectX::PackedVector::XMConvertFloatToHalf( vertex.TexCoord.Y );
+    result.TexCoord  = u | v << 16;
+
+    result.Color = EncodeUnorm8( vertex.Color.X ) | EncodeUnorm8( vertex.Color.Y ) << 8 | EncodeUnorm8( vertex.Color.Z ) << 16 | EncodeUnorm8( vertex.Color.W ) << 24;
+    return result;
+}
+
+StaticMeshVertex VertexQuantization::Decode( const CompactMeshVertex &vertex, const Float3 &boundsMin, const Float3 &boundsMax )
+{
+    StaticMeshVertex result{ };
+
+    result.Position.X = boundsMin.X + DecodeUnorm16( vertex.PositionXY ) * ( boundsMax.X - boundsMin.X );
+    result.Position.Y = boundsMin.Y + DecodeUnorm16( vertex.PositionXY >> 16 ) * ( boundsMax.Y - boundsMin.Y );
+    result.Position.Z = boundsMin.Z + DecodeUnorm16( vertex.PositionZW ) * ( boundsMax.Z - boundsMin.Z );
+    result.Position.W = 1.0f;
+
+    const Float3 normal  = DecodeOctahedral( vertex.Normal );
+    const Float3 tangent = DecodeOctahedral( vertex.Tangent );
+    result.Normal        = Float4{ normal.X, normal.Y, normal.Z, 0.0f };
+    result.Tangent       = Float4{ tangent.X, tangent.Y, tangent.Z, ( vertex.PositionZW >> 16 & 1 ) != 0 ? -1.0f : 1.0f };
+
+    result.TexCoord.X = DirectX::PackedVector::XMConvertHalfToFloat( static_cast<DirectX::PackedVector::HALF>( vertex.TexCoord & 0xFFFF ) );
+    result.TexCoord.Y = DirectX::PackedVector::XMConvertHalfToFloat( static_cast<DirectX::PackedVector::HALF>( vertex.TexCoord >> 16 ) );
+
+    result.Color.X = static_cast<float>( vertex.Color & 0xFF ) / 255.0f;
+    result.Color.Y = static_cast<float>( vertex.Color >> 8 & 0xFF ) / 255.0f;
+    result.Color.Z = static_cast<float>( vertex.Color >> 16 & 0xFF ) / 255.0f;
+    result.Color.W = static_cast<float>( vertex.Color >> 24 & 0xFF ) / 255.0f;
+    return result;
+}
+
+void VertexQuantization::Encode( const StaticMeshVertex *vertices, const size_t numVertices, const Float3 &boundsMin, const Float3 &boundsMax, CompactMeshVertex *outVertices )
+{
+    for ( size_t i = 0; i < numVertices; ++i )
+    {
+        outVertices[ i ] = Encode( vertices[ i ], boundsMin, boundsMax );
+    }
+}
+
+void VertexQuantization::ComputeBounds( const StaticMeshVertex *vertices, const size_t numVertices, Float3 &outMin, Float3 &outMax )
+{
+    for ( size_t i = 0; i < numVertices; ++i )
+    {
+        const Float4 &position = vertices[ i ].Position;
+        outMin.X               = std::min( outMin.X, position.X );
+        outMin.Y               = std::min( outMin.Y, position.Y );
+        outMin.Z               = std::min( outMin.Z, position.Z );
+        outMax.X               = std::max( outMax.X, position.X );
+        outMax.Y               = std::max( outMax.Y, position.Y );
+        outMax.Z               = std::max( outMax.Z, position.Z );
+    }
+}
+
+VertexQuantizationError VertexQuantization::MeasureError( const StaticMeshVertex *vertices, const size_t numVertices, const Float3 &boundsMin, const Float3 &boundsMax )
+{
+    VertexQuantizationError error{ };
+    for ( size_t i = 0; i < numVertices; ++i )
+    {
+        const StaticMeshVertex &original = vertices[ i ];
+        const StaticMeshVertex  decoded  = Decode( Encode( original, boundsMin, boundsMax ), boundsMin, boundsMax );
+
+        const float positionError = std::max( { std::abs( original.Position.X - decoded.Position.X ), std::abs( original.Position.Y - decoded.Position.Y ),
+                                                 std::abs( original.Position.Z - decoded.Position.Z ) } );
+        const float normalAngle   = AngleBetween( Float3{ original.Normal.X, original.Normal.Y, original.Normal.Z }, Float3{ decoded.Normal.X, decoded.Normal.Y, decoded.Normal.Z } );
+        const float tangentAngle =
+            AngleBetween( Float3{ original.Tangent.X, original.Tangent.Y, original.Tangent.Z }, Float3{ decoded.Tangent.X, decoded.Tangent.Y, decoded.Tangent.Z } );
+        const float texCoordError = std::max( std::abs( original.TexCoord.X - decoded.TexCoord.X ), std::abs( original.TexCoord.Y - decoded.TexCoord.Y ) );
+        const float colorError    = std::max( { std::abs( std::clamp( original.Color.X, 0.0f, 1.0f ) - decoded.Color.X ), std::abs( std::clamp( original.Color.Y, 0.0f, 1.0f ) - decoded.Color.Y ),
+                                                std::abs( std::clamp( original.Color.Z, 0.0f, 1.0f ) - decoded.Color.Z ), std::abs( std::clamp( original.Color.W, 0.0f, 1.0f ) - decoded.Color.W ) } );
+
+        error.MaxPositionError = std::max( error.MaxPositionError, positionError );
+        error.MaxNormalAngle   = std::max( error.MaxNormalAngle, normalAngle );
+        error.MaxTangentAngle  = std::max( error.MaxTangentAngle, tangentAngle );
+        error.MaxTexCoordError = std::max( error.MaxTexCoordError, texCoordError );
+        error.MaxColorError    = std::max( error.MaxColorError, colorError );
+    }
+    return error;
+}
+
+uint32_t VertexQuantization::EncodeOctahedral( const Float3 &direction )
+{
+    const float l1 = std::abs( direction.X ) + std::abs( direction.Y ) + std::abs( direction.Z );
+    if ( l1 == 0.0f )
+    {
+        return 0;
+    }
+
+    float x = direction.X / l1;
+    float y = direction.Y / l1;
+    if ( direction.Z < 0.0f )
+    {
+        const float foldedX = ( 1.0f - std::abs( y ) ) * SignNotZero( x );
+        const float foldedY = ( 1.0f - std::abs( x ) ) * SignNotZero( y );
+        x                   = foldedX;
+        y                   = foldedY;
+    }
+    return EncodeSnorm16( x ) | EncodeSnorm16( y ) << 16;
+}
+
+Float3 VertexQuantization::DecodeOctahedral( const uint32_t encoded )
+{
+    float       x = DecodeSnorm16( encoded );
+    float       y = DecodeSnorm16( encoded >> 16 );
+    const float z = 1.0f - std::abs( x ) - std::abs( y );
+    const float t = std::max( -z, 0.0f );
+    x += x >= 0.0f ? -t : t;
+    y += y >= 0.0f ? -t : t;
+
+    const float length = std::sqrt( x * x + y * y + z * z );
+    return Float3{ x / length, y / length, z / length };
+}
@@ -36,6 +36,8 @@ void GameRunner::HandleEvent( const Event &event )
 
 void GameRunner::Update( )
 {
+    UpdateHotReload( );
+    m_assetLoader->Update( );
     m_world->Progress( );
     m_game->Update( );
 
@@ -44,6 +46,7 @@ void GameRunner::Update( )
     {
         return;
     }
+    m_assetBatcher->UpdateResidency( );
 
     RenderDesc renderDesc{ };
     renderDesc.FrameIndex      = frameState.FrameIndex;
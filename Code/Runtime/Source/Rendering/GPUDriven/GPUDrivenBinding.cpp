@@ -38,11 +38,17 @@ GPUDrivenBinding::GPUDrivenBinding( const GPUDrivenBindingDesc &bindingDesc )
     {
         spdlog::error( "GPUDrivenBinding: DataUpload is required" );
     }
+    if ( !bindingDesc.ShadowPass )
+    {
+        spdlog::error( "GPUDrivenBinding: ShadowPass is required" );
+        return;
+    }
 
     m_graphicsContext = bindingDesc.AppContext->GraphicsContext;
     m_numFrames       = bindingDesc.AppContext->NumFrames;
     m_rootSig         = bindingDesc.RootSig;
     m_dataUpload      = bindingDesc.DataUpload;
+    m_shadowPass      = bindingDesc.ShadowPass;
     m_assetBatcher    = bindingDesc.AppContext->AssetBatcher;
     m_world           = bindingDesc.AppContext->World;
     m_batchId         = bindingDesc.BatchId;
@@ -60,6 +66,11 @@ GPUDrivenBinding::GPUDrivenBinding( const GPUDrivenBindingDesc &bindingDesc )
 
 void GPUDrivenBinding::Update( const uint32_t frameIndex ) const
 {
+    // The geometry pool replaces its buffers when it grows
+    if ( const auto meshBatch = m_assetBatcher->Mesh( m_batchId ); meshBatch && meshBatch->GetGeometryVersion( ) != m_frameBindings[ frameIndex ]->GeometryVersion )
+    {
+        UpdateBuffers( frameIndex );
+    }
     UpdateTextures( frameIndex );
 }
 
@@ -133,27 +144,42 @@ void GPUDrivenBinding::CreateBuffersBinding( ) const
     for ( int i = 0; i < m_numFrames; ++i )
     {
         m_frameBindings[ i ]->BuffersBinding = std::unique_ptr<IResourceBindGroup>( m_graphicsContext->LogicalDevice->CreateResourceBindGroup( bindGroupDesc ) );
+        UpdateBuffers( i );
+    }
+}
 
-        const GPUDrivenBuffers buffers = m_dataUpload->GetBuffers( i );
-
-        m_frameBindings[ i ]->BuffersBinding->BeginUpdate( );
-        m_frameBindings[ i ]->BuffersBinding->Cbv( 0, buffers.GlobalDataBuffer );
-        m_frameBindings[ i ]->BuffersBinding->Srv( 0, buffers.ObjectBuffer );
-        m_frameBindings[ i ]->BuffersBinding->Srv( 1, buffers.MaterialBuffer );
-        m_frameBindings[ i ]->BuffersBinding->Srv( 2, buffers.MeshBuffer );
-        m_frameBindings[ i ]->BuffersBinding->Srv( 3, buffers.InstanceBuffer );
+void GPUDrivenBinding::UpdateBuffers( const uint32_t frameIndex ) const
+{
+    const GPUDrivenBuffers buffers      = m_dataUpload->GetBuffers( frameIndex );
+    const auto            &frameBinding = m_frameBindings[ frameIndex ];
 
-        if ( const auto meshBatch = m_assetBatcher->Mesh( m_batchId ) )
-        {
-            const auto vb = meshBatch->GetVertexBuffer( );
-            const auto ib = meshBatch->GetIndexBuffer( );
-            m_frameBindings[ i ]->BuffersBinding->Srv( 4, vb.Buffer );
-            m_frameBindings[ i ]->BuffersBinding->Srv( 5, ib.Buffer );
-        }
+    frameBinding->BuffersBinding->BeginUpdate( );
+    frameBinding->BuffersBinding->Cbv( 0, buffers.GlobalDataBuffer );
+    frameBinding->BuffersBinding->Srv( 0, buffers.ObjectBuffer );
+    frameBinding->BuffersBinding->Srv( 1, buffers.MaterialBuffer );
+    frameBinding->BuffersBinding->Srv( 2, buffers.MeshBuffer );
+    frameBinding->BuffersBinding->Srv( 3, buffers.InstanceBuffer );
 
-        m_frameBindings[ i ]->BuffersBinding->Srv( 6, buffers.DrawArgsBuffer );
-        m_frameBindings[ i ]->BuffersBinding->EndUpdate( );
+    if ( const auto meshBatch = m_assetBatcher->Mesh( m_batchId ) )
+    {
+        const auto vb = meshBatch->GetVertexBuffer( );
+        const auto ib = meshBatch->GetIndexBuffer( );
+        frameBinding->BuffersBinding->Srv( 4, vb.Buffer );
+        frameBinding->BuffersBinding->Srv( 5, ib.Buffer );
+        frameBinding->BuffersBinding->Srv( 11, vb.Buffer );
+
+        const auto positions = meshBatch->HasPositionStream( ) ? meshBatch->GetPositionBuffer( ).Buffer : vb.Buffer;
+        frameBinding->BuffersBinding->Srv( 12, positions );
+        frameBinding->BuffersBinding->Srv( 13, positions );
+        frameBinding->GeometryVersion = meshBatch->GetGeometryVersion( );
     }
+
+    frameBinding->BuffersBinding->Srv( 6, buffers.DrawArgsBuffer );
+    frameBinding->BuffersBinding->Srv( 7, buffers.LightBuffer );
+    frameBinding->BuffersBinding->Srv( 8, buffers.LightClusterBuffer );
+    frameBinding->BuffersBinding->Srv( 9, buffers.LightIndexBuffer );
+    frameBinding->BuffersBinding->Srv( 10, m_shadowPass->GetShadowMap( frameIndex ) );
+    frameBinding->BuffersBinding->EndUpdate( );
 }
 
 void GPUDrivenBinding::CreateTexturesBinding( )
@@ -185,14 +211,18 @@ void GPUDrivenBinding::UpdateTextures( const uint32_t frameIndex ) const
 {
     std::vector<ITextureResource *> textures;
 
+    // Materials refer to textures by slot index, the slots of removed textures are bound to the null texture until reused
     const auto texHandles = m_assetBatcher->Material( m_batchId )->GetTextures( );
-    textures.reserve( texHandles.size( ) );
     for ( const auto &batchTextures : texHandles )
     {
-        textures[ batchTextures.Handle.Id ] = batchTextures.Texture;
-        if ( batchTextures.Texture == nullptr )
+        const uint32_t index = batchTextures.Handle.Index( );
+        if ( index >= textures.size( ) )
+        {
+            textures.resize( index + 1, m_nullTexture.get( ) );
+        }
+        if ( batchTextures.Texture != nullptr )
         {
-            textures[ batchTextures.Handle.Id ] = m_nullTexture.get( );
+            textures[ index ] = batchTextures.Texture;
         }
     }
 
@@ -18,7 +18,9 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 
 #include "DZEngine/Rendering/GPUDriven/GPUDrivenDataUpload.h"
 
+#include <algorithm>
 #include <cmath>
+#include <limits>
 #include <flecs.h>
 #include "DZEngine/Assets/StaticMeshVertex.h"
 #include "DZEngine/Components/CameraComponent.h"
@@ -47,7 +49,7 @@ GPUDrivenDataUpload::GPUDrivenDataUpload( const GPUDrivenDataUploadDesc &uploadD
 
         CommandListPoolDesc poolDesc{ };
         poolDesc.CommandQueue    = m_copyQueue.get( );
-        poolDesc.NumCommandLists = 6;
+        poolDesc.NumCommandLists = 7;
 
         m_frames[ i ]->OnComplete      = std::unique_ptr<ISemaphore>( m_logicalDevice->CreateSemaphore( ) );
         m_frames[ i ]->CommandListPool = std::unique_ptr<ICommandListPool>( m_logicalDevice->CreateCommandListPool( poolDesc ) );
@@ -66,7 +68,8 @@ GPUDrivenDataUpload::GPUDrivenDataUpload( const GPUDrivenDataUploadDesc &uploadD
     m_dataRanges.MeshBufferOffset   = DataUtilities::Align( m_dataRanges.MaterialBufferNumBytes + m_dataRanges.MaterialBufferOffset, 256 );
     m_dataRanges.MeshBufferNumBytes = sizeof( GPUMeshData ) * maxNumMeshes;
 
-    const size_t maxNumInstances        = maxNumObjects;
+    const size_t maxNumShadowCasters    = uploadDesc.Shadows ? uploadDesc.Shadows->NumCascades( ) * uploadDesc.MaxShadowCastersPerCascade : 0;
+    const size_t maxNumInstances        = maxNumObjects + maxNumShadowCasters;
     m_dataRanges.InstanceBufferOffset   = DataUtilities::Align( m_dataRanges.MeshBufferNumBytes + m_dataRanges.MeshBufferOffset, 256 );
     m_dataRanges.InstanceBufferNumBytes = sizeof( GPUInstanceData ) * maxNumInstances;
 
@@ -74,10 +77,26 @@ GPUDrivenDataUpload::GPUDrivenDataUpload( const GPUDrivenDataUploadDesc &uploadD
     m_dataRanges.DrawArgsBufferOffset   = DataUtilities::Align( m_dataRanges.InstanceBufferNumBytes + m_dataRanges.InstanceBufferOffset, 256 );
     m_dataRanges.DrawArgsBufferNumBytes = sizeof( DrawArguments ) * maxDrawArgs;
 
-    const size_t maxIndirectCommands    = maxNumObjects;
+    const size_t maxIndirectCommands    = maxNumObjects + maxNumShadowCasters;
     m_dataRanges.IndirectBufferOffset   = DataUtilities::Align( m_dataRanges.DrawArgsBufferNumBytes + m_dataRanges.DrawArgsBufferOffset, 256 );
     m_dataRanges.IndirectBufferNumBytes = sizeof( DrawIndexedIndirectCommand ) * maxIndirectCommands;
 
+    // Batches binding the light buffers of the light owner stage no lights
+    const ClusteredLightCulling *lightCulling = uploadDesc.LightCulling;
+    const bool                   ownsLights   = uploadDesc.LightOwner == nullptr;
+
+    const size_t maxNumLights        = ownsLights ? MaxNumDirectionalLights + ( lightCulling ? lightCulling->GetClusters( ).GetDesc( ).MaxLights : 0 ) : 0;
+    m_dataRanges.LightBufferOffset   = DataUtilities::Align( m_dataRanges.IndirectBufferNumBytes + m_dataRanges.IndirectBufferOffset, 256 );
+    m_dataRanges.LightBufferNumBytes = sizeof( GPULightData ) * maxNumLights;
+
+    const size_t numLightClusters           = ownsLights ? ( lightCulling ? lightCulling->GetClusters( ).NumClusters( ) : 1 ) : 0;
+    m_dataRanges.LightClusterBufferOffset   = DataUtilities::Align( m_dataRanges.LightBufferNumBytes + m_dataRanges.LightBufferOffset, 256 );
+    m_dataRanges.LightClusterBufferNumBytes = sizeof( GPULightCluster ) * numLightClusters;
+
+    const size_t maxLightIndices          = ownsLights ? ( lightCulling ? lightCulling->GetClusters( ).GetDesc( ).MaxLightIndices : 1 ) : 0;
+    m_dataRanges.LightIndexBufferOffset   = DataUtilities::Align( m_dataRanges.LightClusterBufferNumBytes + m_dataRanges.LightClusterBufferOffset, 256 );
+    m_dataRanges.LightIndexBufferNumBytes = sizeof( uint32_t ) * maxLightIndices;
+
     BufferDesc globalDataBufferDesc{ };
     globalDataBufferDesc.Descriptor = ResourceDescriptor::Buffer;
     globalDataBufferDesc.Usages     = ResourceUsage::VertexAndConstantBuffer;
@@ -88,7 +107,7 @@ GPUDrivenDataUpload::GPUDrivenDataUpload( const GPUDrivenDataUploadDesc &uploadD
     stagingBufferDesc.Descriptor = ResourceDescriptor::Buffer;
     stagingBufferDesc.Usages     = ResourceUsage::CopySrc | ResourceUsage::CopyDst;
     stagingBufferDesc.HeapType   = HeapType::CPU_GPU;
-    size_t totalStagingSize      = m_dataRanges.IndirectBufferOffset + m_dataRanges.IndirectBufferNumBytes;
+    size_t totalStagingSize      = m_dataRanges.LightIndexBufferOffset + m_dataRanges.LightIndexBufferNumBytes;
     stagingBufferDesc.NumBytes   = DataUtilities::Align( totalStagingSize, 256 );
 
     for ( size_t i = 0; i < m_frames.size( ); ++i )
@@ -116,6 +135,19 @@ GPUDrivenDataUpload::GPUDrivenDataUpload( const GPUDrivenDataUploadDesc &uploadD
         bufferDesc.Stride             = sizeof( DrawArguments );
         m_frames[ i ]->DrawArgsBuffer = CreateStructuredBuffer( bufferDesc );
 
+        if ( ownsLights )
+        {
+            bufferDesc.NumElements            = maxNumLights;
+            bufferDesc.Stride                 = sizeof( GPULightData );
+            m_frames[ i ]->LightBuffer        = CreateStructuredBuffer( bufferDesc );
+            bufferDesc.NumElements            = numLightClusters;
+            bufferDesc.Stride                 = sizeof( GPULightCluster );
+            m_frames[ i ]->LightClusterBuffer = CreateStructuredBuffer( bufferDesc );
+            bufferDesc.NumElements            = maxLightIndices;
+            bufferDesc.Stride                 = sizeof( uint32_t );
+            m_frames[ i ]->LightIndexBuffer   = CreateStructuredBuffer( bufferDesc );
+        }
+
         BufferDesc indirectBufferDesc{ };
         indirectBufferDesc.Descriptor = ResourceDescriptor::Buffer | ResourceDescriptor::IndirectBuffer;
         indirectBufferDesc.Usages     = ResourceUsage::IndirectArgument | ResourceUsage::CopyDst;
@@ -128,6 +160,7 @@ GPUDrivenDataUpload::GPUDrivenDataUpload( const GPUDrivenDataUploadDesc &uploadD
 ISemaphore *GPUDrivenDataUpload::UpdateFrame( const uint32_t frameIndex ) const
 {
     UpdateStagingBuffer( frameIndex );
+    UpdateLightBuffers( frameIndex );
     UpdateGlobalDataBuffer( frameIndex );
 
     const ICommandListArray commandLists = m_frames[ frameIndex ]->CommandLists;
@@ -202,7 +235,34 @@ ISemaphore *GPUDrivenDataUpload::UpdateFrame( const uint32_t frameIndex ) const
     commandList->CopyBufferRegion( copyRegionDesc );
     commandList->End( );
 
-    Submit( frameData->OnComplete.get( ), commandLists );
+    // Only the used part of the light buffers, all three in one list
+    if ( frameData->NumLightBytes + frameData->NumLightClusterBytes + frameData->NumLightIndexBytes > 0 )
+    {
+        commandListIndex++;
+        commandList = commandLists.Elements[ commandListIndex ];
+        commandList->Begin( );
+        const auto copyLights = [ & ]( IBufferResource *dstBuffer, const size_t srcOffset, const size_t numBytes )
+        {
+            if ( numBytes == 0 )
+            {
+                return;
+            }
+            copyRegionDesc.SrcBuffer = frameData->StagingBuffer.get( );
+            copyRegionDesc.DstBuffer = dstBuffer;
+            copyRegionDesc.SrcOffset = srcOffset;
+            copyRegionDesc.DstOffset = 0;
+            copyRegionDesc.NumBytes  = numBytes;
+            commandList->CopyBufferRegion( copyRegionDesc );
+        };
+        copyLights( frameData->LightBuffer.get( ), m_dataRanges.LightBufferOffset, frameData->NumLightBytes );
+        copyLights( frameData->LightClusterBuffer.get( ), m_dataRanges.LightClusterBufferOffset, frameData->NumLightClusterBytes );
+        copyLights( frameData->LightIndexBuffer.get( ), m_dataRanges.LightIndexBufferOffset, frameData->NumLightIndexBytes );
+        commandList->End( );
+    }
+
+    ICommandListArray recordedCommandLists = commandLists;
+    recordedCommandLists.NumElements       = commandListIndex + 1;
+    Submit( frameData->OnComplete.get( ), recordedCommandLists );
     return frameData->OnComplete.get( );
 }
 
@@ -246,65 +306,81 @@ void GPUDrivenDataUpload::UpdateStagingBuffer( const uint32_t frameIndex ) const
     materialData[ 0 ].Flags                    = 0;
     materialIndex                              = 1;
 
-    meshData[ 0 ].VertexOffset = 0;
-    meshData[ 0 ].IndexOffset  = 0;
-    meshData[ 0 ].IndexCount   = 0;
-    meshData[ 0 ].VertexCount  = 0;
-    meshData[ 0 ].AABBMin      = { -1.0f, -1.0f, -1.0f };
-    meshData[ 0 ].AABBMax      = { 1.0f, 1.0f, 1.0f };
-    meshData[ 0 ].Padding0     = 0.0f;
-    meshData[ 0 ].Padding1     = 0.0f;
-    meshIndex                  = 1;
-
-    const auto meshQuery = world.query<const MeshComponent, const RenderableComponent>( );
-    meshQuery.each(
-        [ & ]( const MeshComponent &mesh, const RenderableComponent &renderable )
+    meshData[ 0 ].VertexOffset   = 0;
+    meshData[ 0 ].IndexOffset    = 0;
+    meshData[ 0 ].IndexCount     = 0;
+    meshData[ 0 ].VertexCount    = 0;
+    meshData[ 0 ].AABBMin        = { -1.0f, -1.0f, -1.0f };
+    meshData[ 0 ].AABBMax        = { 1.0f, 1.0f, 1.0f };
+    meshData[ 0 ].VertexFormat   = 0;
+    meshData[ 0 ].PositionStream = 0;
+    meshIndex                    = 1;
+
+    // Not part of GPUMeshData, only the draw list needs it to group the commands by index width
+    std::vector<IndexType> meshIndexTypes( m_uploadDesc.MaxMeshes, IndexType::Uint32 );
+
+    // Mesh data is added for the level of detail each object draws, see SelectLOD below. Returns 0, the empty mesh, when it can't be added.
+    const MeshBatch *meshBatch = m_assets->Mesh( m_batchId );
+    const auto       addMesh   = [ & ]( const GPUSubMesh &gpuSubMesh ) -> uint32_t
+    {
+        if ( const auto meshIt = meshHandleToId.find( gpuSubMesh.Handle ); meshIt != meshHandleToId.end( ) )
         {
-            if ( !renderable.Visible || mesh.Handle.Id == AssetHandle<TMeshHandle>::Invalid )
-            {
-                return;
-            }
-            if ( mesh.BatchId != m_batchId )
-            {
-                return;
-            }
+            return meshIt->second;
+        }
+        if ( meshIndex >= m_uploadDesc.MaxMeshes || !gpuSubMesh.Metadata )
+        {
+            return 0;
+        }
 
-            if ( !meshHandleToId.contains( mesh.Handle ) )
-            {
-                if ( meshIndex >= m_uploadDesc.MaxMeshes )
-                {
-                    return;
-                }
+        meshData[ meshIndex ].VertexOffset = static_cast<uint32_t>( gpuSubMesh.VertexBuffer.Offset / meshBatch->GetVertexStride( ) );
+        meshData[ meshIndex ].IndexOffset  = static_cast<uint32_t>( gpuSubMesh.IndexBuffer.Offset / MeshBatch::IndexStride( gpuSubMesh.IndexType ) );
+        meshData[ meshIndex ].IndexCount   = gpuSubMesh.Metadata->NumIndices;
+        meshData[ meshIndex ].VertexCount  = gpuSubMesh.Metadata->NumVertices;
+
+        if ( meshBatch->GetVertexFormat( ) == VertexFormat::Compact )
+        {
+            meshData[ meshIndex ].AABBMin = gpuSubMesh.Metadata->MinBounds;
+            meshData[ meshIndex ].AABBMax = gpuSubMesh.Metadata->MaxBounds;
+        }
+        else if ( !gpuSubMesh.Metadata->BoundingVolumes.empty( ) )
+        {
+            const auto &bounds            = gpuSubMesh.Metadata->BoundingVolumes[ 0 ];
+            meshData[ meshIndex ].AABBMin = bounds.Box.Min;
+            meshData[ meshIndex ].AABBMax = bounds.Box.Max;
+        }
+        else
+        {
+            meshData[ meshIndex ].AABBMin = { -1.0f, -1.0f, -1.0f };
+            meshData[ meshIndex ].AABBMax = { 1.0f, 1.0f, 1.0f };
+        }
 
-                if ( const GPUSubMesh gpuSubMesh = m_assets->Mesh( mesh.BatchId )->GetSubMesh( mesh.Handle ); gpuSubMesh.Metadata )
+        meshData[ meshIndex ].VertexFormat   = static_cast<uint32_t>( meshBatch->GetVertexFormat( ) );
+        meshData[ meshIndex ].PositionStream = meshBatch->HasPositionStream( ) ? 1 : 0;
+
+        meshIndexTypes[ meshIndex ]         = gpuSubMesh.IndexType;
+        meshHandleToId[ gpuSubMesh.Handle ] = meshIndex;
+        return meshIndex++;
+    };
+
+    // Pixels covered by one world unit at distance 1 along the view direction of the active camera, 0 without one and always draws level 0
+    Float3 cameraPosition{ 0.0f, 0.0f, 0.0f };
+    float  lodPixelScale = 0.0f;
+    if ( m_uploadDesc.MaxLODPixelError > 0.0f && m_uploadDesc.GraphicsContext->WindowHandle )
+    {
+        const float surfaceHeight = static_cast<float>( m_uploadDesc.GraphicsContext->WindowHandle->GetSurface( ).Height );
+        world.query<const TransformComponent, const CameraComponent>( ).each(
+            [ & ]( const TransformComponent &transform, const CameraComponent &camera )
+            {
+                if ( camera.Active )
                 {
-                    meshData[ meshIndex ].VertexOffset = static_cast<uint32_t>( gpuSubMesh.VertexBuffer.Offset / sizeof( StaticMeshVertex ) );
-                    meshData[ meshIndex ].IndexOffset  = static_cast<uint32_t>( gpuSubMesh.IndexBuffer.Offset / sizeof( uint32_t ) );
-                    meshData[ meshIndex ].IndexCount   = gpuSubMesh.Metadata->NumIndices;
-                    meshData[ meshIndex ].VertexCount  = gpuSubMesh.Metadata->NumVertices;
-
-                    if ( !gpuSubMesh.Metadata->BoundingVolumes.empty( ) )
-                    {
-                        const auto &bounds            = gpuSubMesh.Metadata->BoundingVolumes[ 0 ];
-                        meshData[ meshIndex ].AABBMin = bounds.Box.Min;
-                        meshData[ meshIndex ].AABBMax = bounds.Box.Max;
-                    }
-                    else
-                    {
-                        meshData[ meshIndex ].AABBMin = { -1.0f, -1.0f, -1.0f };
-                        meshData[ meshIndex ].AABBMax = { 1.0f, 1.0f, 1.0f };
-                    }
-
-                    meshData[ meshIndex ].Padding0 = 0.0f;
-                    meshData[ meshIndex ].Padding1 = 0.0f;
-
-                    meshHandleToId[ mesh.Handle ] = meshIndex;
-                    meshIndex++;
+                    cameraPosition = transform.Position;
+                    lodPixelScale  = 0.5f * surfaceHeight * std::abs( camera.Projection._22 ); // _22 is 1 / tan( fovY / 2 ) for perspective projections
                 }
-            }
-        } );
+            } );
+    }
 
-    const auto materialQuery = world.query<const MaterialComponent>( );
+    const MaterialBatch *materials     = m_assets->Material( );
+    const auto           materialQuery = world.query<const MaterialComponent>( );
     materialQuery.each(
         [ & ]( const MaterialComponent &materialComp )
         {
@@ -313,7 +389,7 @@ void GPUDrivenDataUpload::UpdateStagingBuffer( const uint32_t frameIndex ) const
 
             if ( !materialHandleToId.contains( materialComp.Handle ) )
             {
-                if ( const auto materialData_ptr = m_assets->Material( )->GetMaterial( materialComp.Handle ) )
+                if ( const auto materialData_ptr = materials->GetMaterial( materialComp.Handle ) )
                 {
                     materialData[ materialIndex ].BaseColorFactor   = materialData_ptr->BaseColorFactor;
                     materialData[ materialIndex ].MetallicFactor    = materialData_ptr->MetallicFactor;
@@ -322,13 +398,13 @@ void GPUDrivenDataUpload::UpdateStagingBuffer( const uint32_t frameIndex ) const
                     materialData[ materialIndex ].OcclusionStrength = materialData_ptr->OcclusionStrength;
                     materialData[ materialIndex ].EmissiveFactor    = materialData_ptr->EmissiveFactor;
 
-                    materialData[ materialIndex ].BaseColorTexture         = materialData_ptr->Albedo.IsValid( ) ? materialData_ptr->Albedo.Id : 0;
-                    materialData[ materialIndex ].NormalTexture            = materialData_ptr->Normal.IsValid( ) ? materialData_ptr->Normal.Id : 0;
-                    materialData[ materialIndex ].MetallicRoughnessTexture = materialData_ptr->Metallic.IsValid( ) ? materialData_ptr->Metallic.Id : 0;
-                    materialData[ materialIndex ].OcclusionTexture         = materialData_ptr->Occlusion.IsValid( ) ? materialData_ptr->Occlusion.Id : 0;
-                    materialData[ materialIndex ].EmissiveTexture          = materialData_ptr->Emissive.IsValid( ) ? materialData_ptr->Emissive.Id : 0;
-                    materialData[ materialIndex ].CustomTexture0           = materialData_ptr->Custom0.IsValid( ) ? materialData_ptr->Custom0.Id : 0;
-                    materialData[ materialIndex ].CustomTexture1           = materialData_ptr->Custom1.IsValid( ) ? materialData_ptr->Custom1.Id : 0;
+                    materialData[ materialIndex ].BaseColorTexture         = materials->GetTextureIndex( materialData_ptr->Albedo );
+                    materialData[ materialIndex ].NormalTexture            = materials->GetTextureIndex( materialData_ptr->Normal );
+                    materialData[ materialIndex ].MetallicRoughnessTexture = materials->GetTextureIndex( materialData_ptr->Metallic );
+                    materialData[ materialIndex ].OcclusionTexture         = materials->GetTextureIndex( materialData_ptr->Occlusion );
+                    materialData[ materialIndex ].EmissiveTexture          = materials->GetTextureIndex( materialData_ptr->Emissive );
+                    materialData[ materialIndex ].CustomTexture0           = materials->GetTextureIndex( materialData_ptr->Custom0 );
+                    materialData[ materialIndex ].CustomTexture1           = materials->GetTextureIndex( materialData_ptr->Custom1 );
                     materialData[ materialIndex ].Flags                    = 0;
 
                     materialHandleToId[ materialComp.Handle ] = materialIndex;
@@ -337,6 +413,11 @@ void GPUDrivenDataUpload::UpdateStagingBuffer( const uint32_t frameIndex ) const
             }
         } );
 
+    const ShadowCascades *shadows           = m_uploadDesc.Shadows;
+    const uint32_t        numShadowCascades = shadows && shadows->IsValid( ) ? shadows->NumCascades( ) : 0;
+    std::vector<Float4>   casterSpheres;
+    std::vector<uint32_t> casterObjects;
+
     const auto renderQuery = world.query<const TransformComponent, const MeshComponent, const RenderableComponent>( );
     renderQuery.each(
         [ & ]( const flecs::entity e, const TransformComponent &transform, const MeshComponent &mesh, const RenderableComponent &renderable )
@@ -370,13 +451,31 @@ void GPUDrivenDataUpload::UpdateStagingBuffer( const uint32_t frameIndex ) const
             }
             objectData[ objectIndex ].MaterialID = materialId;
 
-            const auto meshIt                = meshHandleToId.find( mesh.Handle );
-            objectData[ objectIndex ].MeshID = meshIt != meshHandleToId.end( ) ? meshIt->second : 0;
-            if ( const GPUSubMesh gpuSubMesh = m_assets->Mesh( mesh.BatchId )->GetSubMesh( mesh.Handle ); gpuSubMesh.Metadata->BoundingVolumes.size( ) > 0 )
+            // Bounds are those of level 0 so culling doesn't change with the level of detail
+            const GPUSubMesh gpuSubMesh = mesh.Handle.Id != AssetHandle<TMeshHandle>::Invalid ? meshBatch->GetSubMesh( mesh.Handle ) : GPUSubMesh{ };
+            if ( gpuSubMesh.Metadata && gpuSubMesh.Metadata->BoundingVolumes.size( ) > 0 )
             {
                 const SphereBoundingVolume boundingVolume = gpuSubMesh.Metadata->BoundingVolumes[ 0 ].Sphere;
                 objectData[ objectIndex ].BoundingSphere  = { boundingVolume.Center.X, boundingVolume.Center.Y, boundingVolume.Center.Z, boundingVolume.Radius };
             }
+
+            const Float4           &localSphere = objectData[ objectIndex ].BoundingSphere;
+            const DirectX::XMVECTOR worldCenter = DirectX::XMVector3Transform( DirectX::XMVectorSet( localSphere.X, localSphere.Y, localSphere.Z, 1.0f ), modelMatrix );
+            const float             maxScale    = std::max( { std::abs( transform.Scale.X ), std::abs( transform.Scale.Y ), std::abs( transform.Scale.Z ) } );
+
+            // The coarsest level whose simplification error stays under MaxLODPixelError at the nearest point of the bounding sphere
+            GPUSubMesh drawnSubMesh = gpuSubMesh;
+            if ( gpuSubMesh.Metadata && lodPixelScale > 0.0f && localSphere.W > 0.0f )
+            {
+                const DirectX::XMVECTOR toCamera = DirectX::XMVectorSubtract( MathConverter::Float3ToXMVECTOR( cameraPosition ), worldCenter );
+                const float             distance = DirectX::XMVectorGetX( DirectX::XMVector3Length( toCamera ) ) - localSphere.W * maxScale;
+                if ( distance > 0.0f )
+                {
+                    const MeshHandle lod = meshBatch->SelectLOD( mesh.Handle, lodPixelScale * maxScale / distance, m_uploadDesc.MaxLODPixelError );
+                    drawnSubMesh         = lod == mesh.Handle ? gpuSubMesh : meshBatch->GetSubMesh( lod );
+                }
+            }
+            objectData[ objectIndex ].MeshID = addMesh( drawnSubMesh );
             uint32_t flags = 0;
             if ( renderable.CastShadows )
             {
@@ -389,6 +488,14 @@ void GPUDrivenDataUpload::UpdateStagingBuffer( const uint32_t frameIndex ) const
             objectData[ objectIndex ].Flags      = flags;
             objectData[ objectIndex ].CustomData = 0;
 
+            if ( renderable.CastShadows && numShadowCascades > 0 )
+            {
+                // Meshes without bounds are never culled
+                const float worldRadius = localSphere.W > 0.0f ? localSphere.W * maxScale : std::numeric_limits<float>::max( );
+                casterSpheres.push_back( Float4{ DirectX::XMVectorGetX( worldCenter ), DirectX::XMVectorGetY( worldCenter ), DirectX::XMVectorGetZ( worldCenter ), worldRadius } );
+                casterObjects.push_back( objectIndex );
+            }
+
             instanceData[ instanceIndex ].ObjectID   = objectIndex;
             instanceData[ instanceIndex ].BatchIndex = 0;
             instanceData[ instanceIndex ].Padding    = Float2{ 0.0f, 0.0f };
@@ -404,6 +511,8 @@ void GPUDrivenDataUpload::UpdateStagingBuffer( const uint32_t frameIndex ) const
         std::vector<uint32_t> instanceIndices;
     };
 
+    const auto is16Bit = [ & ]( const uint32_t meshId ) { return meshId < meshIndex && meshIndexTypes[ meshId ] == IndexType::Uint16; };
+
     std::unordered_map<uint32_t, MeshInstanceGroup> meshGroups;
     for ( uint32_t i = 0; i < objectIndex; ++i )
     {
@@ -419,10 +528,21 @@ void GPUDrivenDataUpload::UpdateStagingBuffer( const uint32_t frameIndex ) const
         group.instanceIndices.push_back( i );
     }
 
+    // Uint16 groups first, each index width is drawn with its own BindIndexBuffer + DrawIndexedIndirect
+    std::vector<const MeshInstanceGroup *> sortedGroups;
+    sortedGroups.reserve( meshGroups.size( ) );
+    for ( const auto &group : meshGroups | std::views::values )
+    {
+        sortedGroups.push_back( &group );
+    }
+    std::ranges::sort( sortedGroups, { }, [ & ]( const MeshInstanceGroup *group ) { return std::pair( !is16Bit( group->meshId ), group->meshId ); } );
+
     uint32_t drawArgsIndex         = 0;
     uint32_t currentInstanceOffset = 0;
-    for ( const auto &group : meshGroups | std::views::values )
+    uint32_t numDraws16            = 0;
+    for ( const MeshInstanceGroup *groupPtr : sortedGroups )
     {
+        const MeshInstanceGroup &group = *groupPtr;
         if ( drawArgsIndex >= m_uploadDesc.MaxObjects )
         {
             break;
@@ -442,6 +562,7 @@ void GPUDrivenDataUpload::UpdateStagingBuffer( const uint32_t frameIndex ) const
         }
 
         currentInstanceOffset += static_cast<uint32_t>( group.instanceIndices.size( ) );
+        numDraws16 += is16Bit( group.meshId ) ? 1 : 0;
         drawArgsIndex++;
     }
 
@@ -465,7 +586,61 @@ void GPUDrivenDataUpload::UpdateStagingBuffer( const uint32_t frameIndex ) const
         }
     }
 
-    m_frames[ frameIndex ]->NumDraws = drawArgsIndex;
+    m_frames[ frameIndex ]->NumDraws   = drawArgsIndex;
+    m_frames[ frameIndex ]->NumDraws16 = numDraws16;
+
+    std::vector<uint32_t> visibleCasters;
+    for ( uint32_t cascade = 0; cascade < MaxShadowCascades; ++cascade )
+    {
+        m_frames[ frameIndex ]->NumShadowDraws[ cascade ]   = 0;
+        m_frames[ frameIndex ]->NumShadowDraws16[ cascade ] = 0;
+        if ( cascade >= numShadowCascades )
+        {
+            continue;
+        }
+
+        visibleCasters.clear( );
+        shadows->CullCasters( cascade, casterSpheres, visibleCasters );
+        // Stable so the instance order, and with it the draw order, doesn't change between frames, Uint16 meshes first like the main pass
+        std::ranges::stable_sort( visibleCasters, { },
+                                  [ & ]( const uint32_t caster )
+                                  {
+                                      const uint32_t meshId = objectData[ casterObjects[ caster ] ].MeshID;
+                                      return std::pair( !is16Bit( meshId ), meshId );
+                                  } );
+
+        const uint32_t regionOffset = ShadowRegionOffset( cascade );
+        const uint32_t numInstances = std::min( static_cast<uint32_t>( visibleCasters.size( ) ), m_uploadDesc.MaxShadowCastersPerCascade );
+        uint32_t       numDraws     = 0;
+        uint32_t       numDraws16   = 0;
+        for ( uint32_t first = 0; first < numInstances; )
+        {
+            const uint32_t meshId = objectData[ casterObjects[ visibleCasters[ first ] ] ].MeshID;
+
+            uint32_t last = first;
+            for ( ; last < numInstances && objectData[ casterObjects[ visibleCasters[ last ] ] ].MeshID == meshId; ++last )
+            {
+                instanceData[ regionOffset + last ].ObjectID   = casterObjects[ visibleCasters[ last ] ];
+                instanceData[ regionOffset + last ].BatchIndex = 0;
+                instanceData[ regionOffset + last ].Padding    = Float2{ 0.0f, 0.0f };
+            }
+
+            if ( meshId < meshIndex && meshData[ meshId ].IndexCount > 0 )
+            {
+                DrawIndexedIndirectCommand &command = indirectData[ regionOffset + numDraws ];
+                command.NumIndices                  = meshData[ meshId ].IndexCount;
+                command.NumInstances                = last - first;
+                command.FirstIndex                  = meshData[ meshId ].IndexOffset;
+                command.VertexOffset                = meshData[ meshId ].VertexOffset;
+                command.FirstInstance               = regionOffset + first;
+                numDraws16 += is16Bit( meshId ) ? 1 : 0;
+                numDraws++;
+            }
+            first = last;
+        }
+        m_frames[ frameIndex ]->NumShadowDraws[ cascade ]   = numDraws;
+        m_frames[ frameIndex ]->NumShadowDraws16[ cascade ] = numDraws16;
+    }
 }
 
 void GPUDrivenDataUpload::UpdateGlobalDataBuffer( const uint32_t frameIndex ) const
@@ -527,6 +702,75 @@ void GPUDrivenDataUpload::UpdateGlobalDataBuffer( const uint32_t frameIndex ) co
     globalData->ScreenSize = Float2{ 1920.0f, 1080.0f };
     globalData->Time       = 0.0f;
     globalData->DeltaTime  = 0.016f;
+
+    globalData->NumDirectionalLights = 0;
+    globalData->NumClustersX         = 0;
+    globalData->NumClustersY         = 0;
+    globalData->NumClustersZ         = 0;
+    if ( const ClusteredLightCulling *lightCulling = m_uploadDesc.LightCulling )
+    {
+        const LightClusterBuilder &clusters = lightCulling->GetClusters( );
+        globalData->NumDirectionalLights    = lightCulling->NumDirectionalLights( );
+        globalData->NumClustersX            = clusters.GetDesc( ).NumClustersX;
+        globalData->NumClustersY            = clusters.GetDesc( ).NumClustersY;
+        globalData->NumClustersZ            = clusters.GetDesc( ).NumClustersZ;
+        globalData->ClusterDepthScale       = clusters.GetDepthScale( );
+        globalData->ClusterDepthBias        = clusters.GetDepthBias( );
+        globalData->ClusterNear             = clusters.GetNear( );
+        globalData->ClusterFar              = clusters.GetFar( );
+    }
+
+    globalData->NumShadowCascades = 0;
+    if ( const ShadowCascades *shadows = m_uploadDesc.Shadows; shadows && shadows->IsValid( ) )
+    {
+        const auto &cascades = shadows->GetCascades( );
+        float       splits[ MaxShadowCascades ]{ };
+        float       texelSizes[ MaxShadowCascades ]{ };
+        for ( uint32_t i = 0; i < shadows->NumCascades( ); ++i )
+        {
+            globalData->CascadeViewProj[ i ] = cascades[ i ].ViewProjection;
+            splits[ i ]                      = cascades[ i ].SplitFar;
+            texelSizes[ i ]                  = cascades[ i ].TexelSize;
+        }
+        globalData->CascadeSplits       = Float4{ splits[ 0 ], splits[ 1 ], splits[ 2 ], splits[ 3 ] };
+        globalData->CascadeTexelSizes   = Float4{ texelSizes[ 0 ], texelSizes[ 1 ], texelSizes[ 2 ], texelSizes[ 3 ] };
+        globalData->NumShadowCascades   = shadows->NumCascades( );
+        globalData->ShadowMapResolution = shadows->GetDesc( ).Resolution;
+        globalData->ShadowDepthBias     = shadows->GetDesc( ).DepthBias;
+        globalData->ShadowNormalBias    = shadows->GetDesc( ).NormalBias;
+    }
+}
+
+void GPUDrivenDataUpload::UpdateLightBuffers( const uint32_t frameIndex ) const
+{
+    FrameData                   &frameData    = *m_frames[ frameIndex ];
+    const ClusteredLightCulling *lightCulling = m_uploadDesc.LightCulling;
+    frameData.NumLightBytes                   = 0;
+    frameData.NumLightClusterBytes            = 0;
+    frameData.NumLightIndexBytes              = 0;
+    if ( !lightCulling || m_uploadDesc.LightOwner )
+    {
+        return;
+    }
+
+    Byte                      *mappedMemory = frameData.StagingBufferMappedMemory;
+    const auto                &lights       = lightCulling->GetLights( );
+    const LightClusterBuilder &clusters     = lightCulling->GetClusters( );
+
+    frameData.NumLightBytes = std::min( lights.size( ) * sizeof( GPULightData ), m_dataRanges.LightBufferNumBytes );
+    memcpy( mappedMemory + m_dataRanges.LightBufferOffset, lights.data( ), frameData.NumLightBytes );
+
+    // An empty grid stays valid in the frame's buffer until a clustered light shows up
+    const bool clustersEmpty = clusters.GetStats( ).NumLightIndices == 0;
+    if ( !clustersEmpty || !frameData.LightClustersEmpty )
+    {
+        frameData.NumLightClusterBytes = std::min( clusters.GetClusters( ).size( ) * sizeof( GPULightCluster ), m_dataRanges.LightClusterBufferNumBytes );
+        memcpy( mappedMemory + m_dataRanges.LightClusterBufferOffset, clusters.GetClusters( ).data( ), frameData.NumLightClusterBytes );
+    }
+    frameData.LightClustersEmpty = clustersEmpty;
+
+    frameData.NumLightIndexBytes = std::min( static_cast<size_t>( clusters.GetStats( ).NumLightIndices ) * sizeof( uint32_t ), m_dataRanges.LightIndexBufferNumBytes );
+    memcpy( mappedMemory + m_dataRanges.LightIndexBufferOffset, clusters.GetLightIndices( ).data( ), frameData.NumLightIndexBytes );
 }
 
 void GPUDrivenDataUpload::Submit( ISemaphore *onComplete, const ICommandListArray &commandListsToSubmit ) const
@@ -541,13 +785,23 @@ void GPUDrivenDataUpload::Submit( ISemaphore *onComplete, const ICommandListArra
 GPUDrivenBuffers GPUDrivenDataUpload::GetBuffers( const uint32_t frameIndex ) const
 {
     GPUDrivenBuffers buffers{ };
-    buffers.GlobalDataBuffer = m_frames[ frameIndex ]->GlobalDataBuffer.get( );
-    buffers.ObjectBuffer     = m_frames[ frameIndex ]->ObjectBuffer.get( );
-    buffers.MaterialBuffer   = m_frames[ frameIndex ]->MaterialBuffer.get( );
-    buffers.MeshBuffer       = m_frames[ frameIndex ]->MeshBuffer.get( );
-    buffers.InstanceBuffer   = m_frames[ frameIndex ]->InstanceBuffer.get( );
-    buffers.DrawArgsBuffer   = m_frames[ frameIndex ]->DrawArgsBuffer.get( );
-    buffers.IndirectBuffer   = m_frames[ frameIndex ]->IndirectBuffer.get( );
+    buffers.GlobalDataBuffer   = m_frames[ frameIndex ]->GlobalDataBuffer.get( );
+    buffers.ObjectBuffer       = m_frames[ frameIndex ]->ObjectBuffer.get( );
+    buffers.MaterialBuffer     = m_frames[ frameIndex ]->MaterialBuffer.get( );
+    buffers.MeshBuffer         = m_frames[ frameIndex ]->MeshBuffer.get( );
+    buffers.InstanceBuffer     = m_frames[ frameIndex ]->InstanceBuffer.get( );
+    buffers.DrawArgsBuffer     = m_frames[ frameIndex ]->DrawArgsBuffer.get( );
+    buffers.IndirectBuffer     = m_frames[ frameIndex ]->IndirectBuffer.get( );
+    buffers.LightBuffer        = m_frames[ frameIndex ]->LightBuffer.get( );
+    buffers.LightClusterBuffer = m_frames[ frameIndex ]->LightClusterBuffer.get( );
+    buffers.LightIndexBuffer   = m_frames[ frameIndex ]->LightIndexBuffer.get( );
+    if ( m_uploadDesc.LightOwner )
+    {
+        const GPUDrivenBuffers lightBuffers = m_uploadDesc.LightOwner->GetBuffers( frameIndex );
+        buffers.LightBuffer                 = lightBuffers.LightBuffer;
+        buffers.LightClusterBuffer          = lightBuffers.LightClusterBuffer;
+        buffers.LightIndexBuffer            = lightBuffers.LightIndexBuffer;
+    }
     return buffers;
 }
 
@@ -556,6 +810,52 @@ uint32_t GPUDrivenDataUpload::GetNumDraws( const uint32_t frameIndex ) const
     return m_frames[ frameIndex ]->NumDraws;
 }
 
+uint32_t GPUDrivenDataUpload::GetNumDraws( const uint32_t frameIndex, const IndexType indexType ) const
+{
+    const auto &frame = m_frames[ frameIndex ];
+    return indexType == IndexType::Uint16 ? frame->NumDraws16 : frame->NumDraws - frame->NumDraws16;
+}
+
+uint64_t GPUDrivenDataUpload::GetDrawOffset( const uint32_t frameIndex, const IndexType indexType ) const
+{
+    const uint32_t firstDraw = indexType == IndexType::Uint16 ? 0 : m_frames[ frameIndex ]->NumDraws16;
+    return static_cast<uint64_t>( firstDraw ) * sizeof( DrawIndexedIndirectCommand );
+}
+
+uint32_t GPUDrivenDataUpload::GetNumShadowDraws( const uint32_t frameIndex, const uint32_t cascade ) const
+{
+    return cascade < MaxShadowCascades ? m_frames[ frameIndex ]->NumShadowDraws[ cascade ] : 0;
+}
+
+uint32_t GPUDrivenDataUpload::GetNumShadowDraws( const uint32_t frameIndex, const uint32_t cascade, const IndexType indexType ) const
+{
+    if ( cascade >= MaxShadowCascades )
+    {
+        return 0;
+    }
+    const auto &frame = m_frames[ frameIndex ];
+    return indexType == IndexType::Uint16 ? frame->NumShadowDraws16[ cascade ] : frame->NumShadowDraws[ cascade ] - frame->NumShadowDraws16[ cascade ];
+}
+
+uint64_t GPUDrivenDataUpload::GetShadowDrawOffset( const uint32_t cascade ) const
+{
+    return static_cast<uint64_t>( ShadowRegionOffset( cascade ) ) * sizeof( DrawIndexedIndirectCommand );
+}
+
+uint64_t GPUDrivenDataUpload::GetShadowDrawOffset( const uint32_t frameIndex, const uint32_t cascade, const IndexType indexType ) const
+{
+    if ( indexType == IndexType::Uint16 || cascade >= MaxShadowCascades )
+    {
+        return GetShadowDrawOffset( cascade );
+    }
+    return GetShadowDrawOffset( cascade ) + static_cast<uint64_t>( m_frames[ frameIndex ]->NumShadowDraws16[ cascade ] ) * sizeof( DrawIndexedIndirectCommand );
+}
+
+uint32_t GPUDrivenDataUpload::ShadowRegionOffset( const uint32_t cascade ) const
+{
+    return m_uploadDesc.MaxObjects + cascade * m_uploadDesc.MaxShadowCastersPerCascade;
+}
+
 GPUDrivenDataUpload::~GPUDrivenDataUpload( )
 {
     for ( const auto &frame : m_frames )
@@ -18,18 +18,38 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 
 #include "DZEngine/Rendering/GPUDriven/GPUDrivenRenderer.h"
 #include "DZEngine/Rendering/GPUDriven/GPUDrivenBinding.h"
+#include <spdlog/spdlog.h>
 
 using namespace DZEngine;
 
+namespace
+{
+    constexpr auto UberVertexShaderPath = "_Assets/Engine/Shaders/GPUDriven/UberShader.vs.hlsl";
+    constexpr auto UberPixelShaderPath  = "_Assets/Engine/Shaders/GPUDriven/UberShader.ps.hlsl";
+} // namespace
+
 GPUDrivenRenderer::GPUDrivenRenderer( const RendererDesc &rendererDesc )
 {
     m_graphicsContext = rendererDesc.AppContext->GraphicsContext;
     m_numFrames       = rendererDesc.AppContext->NumFrames;
     m_assetBatcher    = rendererDesc.AppContext->AssetBatcher;
     m_world           = rendererDesc.AppContext->World;
+    m_shaderHotReload = rendererDesc.AppContext->ShaderHotReload;
 
     m_rootSig = std::make_unique<GPUDrivenRootSig>( m_graphicsContext->LogicalDevice );
 
+    ClusteredLightCullingDesc lightCullingDesc{ };
+    lightCullingDesc.World             = m_world;
+    lightCullingDesc.Clusters.Executor = rendererDesc.AppContext->Executor;
+    m_lightCulling                     = std::make_unique<ClusteredLightCulling>( lightCullingDesc );
+
+    GPUDrivenShadowPassDesc shadowPassDesc{ };
+    shadowPassDesc.GraphicsContext = m_graphicsContext;
+    shadowPassDesc.RootSig         = m_rootSig.get( );
+    shadowPassDesc.NumFrames       = m_numFrames;
+    shadowPassDesc.ShaderHotReload = m_shaderHotReload;
+    m_shadowPass                   = std::make_unique<GPUDrivenShadowPass>( shadowPassDesc );
+
     m_batches.resize( m_assetBatcher->NumBatches( ) );
 
     for ( int i = 0; i < m_assetBatcher->NumBatches( ); ++i )
@@ -40,6 +60,9 @@ GPUDrivenRenderer::GPUDrivenRenderer( const RendererDesc &rendererDesc )
         uploadDesc.GraphicsContext = m_graphicsContext;
         uploadDesc.Assets          = m_assetBatcher;
         uploadDesc.World           = m_world;
+        uploadDesc.LightCulling    = m_lightCulling.get( );
+        uploadDesc.LightOwner      = i > 0 ? m_batches[ 0 ]->DataUpload.get( ) : nullptr; // The lights are the same for every batch
+        uploadDesc.Shadows         = &m_shadowPass->GetCascades( );
         uploadDesc.BatchId         = i;
         uploadDesc.NumFrames       = rendererDesc.AppContext->NumFrames;
         m_batches[ i ]->DataUpload = std::make_unique<GPUDrivenDataUpload>( uploadDesc );
@@ -47,18 +70,34 @@ GPUDrivenRenderer::GPUDrivenRenderer( const RendererDesc &rendererDesc )
         GPUDrivenBindingDesc bindingDesc{ };
         bindingDesc.RootSig         = m_rootSig.get( );
         bindingDesc.DataUpload      = m_batches[ i ]->DataUpload.get( );
+        bindingDesc.ShadowPass      = m_shadowPass.get( );
         bindingDesc.AppContext      = rendererDesc.AppContext;
         bindingDesc.BatchId         = i;
         m_batches[ i ]->DataBinding = std::make_unique<GPUDrivenBinding>( bindingDesc );
     }
 
     InitTestPipeline( );
+    if ( m_shaderHotReload )
+    {
+        m_shaderHotReloadId = m_shaderHotReload->Register( { UberVertexShaderPath, UberPixelShaderPath }, [ this ] { CreatePipeline( ); } );
+    }
+}
+
+GPUDrivenRenderer::~GPUDrivenRenderer( )
+{
+    if ( m_shaderHotReload )
+    {
+        m_shaderHotReload->Unregister( m_shaderHotReloadId );
+    }
 }
 
 ISemaphore *GPUDrivenRenderer::RenderFrame( const RenderFrameDesc &renderFrame )
 {
     RecreateDepthTexturesIfNeeded( );
 
+    m_lightCulling->Update( );
+    m_shadowPass->Update( *m_lightCulling );
+
     std::vector<ISemaphore *> waitSemaphores{ };
 
     for ( int i = 0; i < m_assetBatcher->NumBatches( ); ++i )
@@ -73,6 +112,8 @@ ISemaphore *GPUDrivenRenderer::RenderFrame( const RenderFrameDesc &renderFrame )
     auto cmdList = m_commandLists[ renderFrame.FrameIndex ];
     cmdList->Begin( );
 
+    RenderShadows( cmdList, renderFrame.FrameIndex );
+
     m_graphicsContext->ResourceTracking->TransitionTexture( cmdList, renderFrame.RenderTarget, ResourceUsage::RenderTarget );
 
     const auto depthTarget = m_depthTargets[ renderFrame.FrameIndex ].get( );
@@ -106,12 +147,16 @@ ISemaphore *GPUDrivenRenderer::RenderFrame( const RenderFrameDesc &renderFrame )
 
         const auto buffers = m_batches[ i ]->DataUpload->GetBuffers( renderFrame.FrameIndex );
 
+        // The index buffer holds ranges of both widths, the draws of each width are contiguous in the indirect buffer
         const auto indexBufferView = m_assetBatcher->Mesh( i )->GetIndexBuffer( );
-        cmdList->BindIndexBuffer( indexBufferView.Buffer, IndexType::Uint32, indexBufferView.Offset );
-
-        if ( const uint32_t numDraws = m_batches[ i ]->DataUpload->GetNumDraws( renderFrame.FrameIndex ); numDraws > 0 )
+        for ( const IndexType indexType : { IndexType::Uint16, IndexType::Uint32 } )
         {
-            cmdList->DrawIndexedIndirect( buffers.IndirectBuffer, 0, numDraws, sizeof( DrawIndexedIndirectCommand ) );
+            if ( const uint32_t numDraws = m_batches[ i ]->DataUpload->GetNumDraws( renderFrame.FrameIndex, indexType ); numDraws > 0 )
+            {
+                const uint64_t drawOffset = m_batches[ i ]->DataUpload->GetDrawOffset( renderFrame.FrameIndex, indexType );
+                cmdList->BindIndexBuffer( indexBufferView.Buffer, indexType, indexBufferView.Offset );
+                cmdList->DrawIndexedIndirect( buffers.IndirectBuffer, drawOffset, numDraws, sizeof( DrawIndexedIndirectCommand ) );
+            }
         }
     }
 
@@ -133,6 +178,46 @@ ISemaphore *GPUDrivenRenderer::RenderFrame( const RenderFrameDesc &renderFrame )
     return signalSemaphore;
 }
 
+void GPUDrivenRenderer::RenderShadows( ICommandList *cmdList, const uint32_t frameIndex ) const
+{
+    m_shadowPass->Begin( cmdList, frameIndex );
+
+    const ShadowCascades &cascades = m_shadowPass->GetCascades( );
+    for ( uint32_t cascade = 0; cascades.IsValid( ) && cascade < cascades.NumCascades( ); ++cascade )
+    {
+        m_shadowPass->BindCascade( cmdList, cascade );
+
+        for ( int i = 0; i < m_assetBatcher->NumBatches( ); ++i )
+        {
+            const auto    &dataUpload = m_batches[ i ]->DataUpload;
+            const uint32_t numDraws   = dataUpload->GetNumShadowDraws( frameIndex, cascade );
+            if ( numDraws == 0 )
+            {
+                continue;
+            }
+
+            const auto &binding = m_batches[ i ]->DataBinding;
+            cmdList->BindResourceGroup( binding->GetSamplerBinding( ) );
+            cmdList->BindResourceGroup( binding->GetBuffersBinding( frameIndex ) );
+            cmdList->BindResourceGroup( binding->GetTexturesBinding( frameIndex ) );
+
+            const auto indexBufferView = m_assetBatcher->Mesh( i )->GetIndexBuffer( );
+            const auto buffers         = dataUpload->GetBuffers( frameIndex );
+            for ( const IndexType indexType : { IndexType::Uint16, IndexType::Uint32 } )
+            {
+                if ( const uint32_t numTypedDraws = dataUpload->GetNumShadowDraws( frameIndex, cascade, indexType ); numTypedDraws > 0 )
+                {
+                    const uint64_t drawOffset = dataUpload->GetShadowDrawOffset( frameIndex, cascade, indexType );
+                    cmdList->BindIndexBuffer( indexBufferView.Buffer, indexType, indexBufferView.Offset );
+                    cmdList->DrawIndexedIndirect( buffers.IndirectBuffer, drawOffset, numTypedDraws, sizeof( DrawIndexedIndirectCommand ) );
+                }
+            }
+        }
+    }
+
+    m_shadowPass->End( cmdList, frameIndex );
+}
+
 void GPUDrivenRenderer::InitTestPipeline( )
 {
     for ( int i = 0; i < m_numFrames; ++i )
@@ -140,45 +225,56 @@ void GPUDrivenRenderer::InitTestPipeline( )
         m_signalSemaphores.emplace_back( std::unique_ptr<ISemaphore>( m_graphicsContext->LogicalDevice->CreateSemaphore( ) ) );
     }
 
+    CommandQueueDesc cmdQueueDesc{ };
+    cmdQueueDesc.QueueType = QueueType::Graphics;
+
+    m_commandQueue = std::unique_ptr<ICommandQueue>( m_graphicsContext->LogicalDevice->CreateCommandQueue( cmdQueueDesc ) );
+
+    CommandListPoolDesc cmdListPoolDesc{ };
+    cmdListPoolDesc.NumCommandLists = 3;
+    cmdListPoolDesc.CommandQueue    = m_commandQueue.get( );
+    m_commandListPool               = std::unique_ptr<ICommandListPool>( m_graphicsContext->LogicalDevice->CreateCommandListPool( cmdListPoolDesc ) );
+
+    const auto commandListArray = m_commandListPool->GetCommandLists( );
+    m_commandLists.resize( commandListArray.NumElements );
+    for ( int i = 0; i < commandListArray.NumElements; ++i )
+    {
+        m_commandLists[ i ] = commandListArray.Elements[ i ];
+    }
+
+    CreatePipeline( );
+    RecreateDepthTexturesIfNeeded( );
+}
+
+bool GPUDrivenRenderer::CreatePipeline( )
+{
     std::array<ShaderStageDesc, 2> shaderStages{ };
 
     ShaderStageDesc vertShaderStageDesc{ };
     vertShaderStageDesc.Stage      = ShaderStage::Vertex;
-    vertShaderStageDesc.Path       = "_Assets/Engine/Shaders/GPUDriven/UberShader.vs.hlsl";
+    vertShaderStageDesc.Path       = UberVertexShaderPath;
     vertShaderStageDesc.EntryPoint = "VSMain";
     shaderStages[ 0 ]              = vertShaderStageDesc;
 
     ShaderStageDesc pixShaderStageDesc{ };
     pixShaderStageDesc.Stage      = ShaderStage::Pixel;
-    pixShaderStageDesc.Path       = "_Assets/Engine/Shaders/GPUDriven/UberShader.ps.hlsl";
+    pixShaderStageDesc.Path       = UberPixelShaderPath;
     pixShaderStageDesc.EntryPoint = "PSMain";
     shaderStages[ 1 ]             = pixShaderStageDesc;
 
     ShaderProgramDesc shaderProgramDesc{ };
     shaderProgramDesc.ShaderStages.Elements    = shaderStages.data( );
     shaderProgramDesc.ShaderStages.NumElements = shaderStages.size( );
-    m_program                                  = std::make_unique<ShaderProgram>( shaderProgramDesc );
-
-    CommandQueueDesc cmdQueueDesc{ };
-    cmdQueueDesc.QueueType = QueueType::Graphics;
-
-    m_commandQueue = std::unique_ptr<ICommandQueue>( m_graphicsContext->LogicalDevice->CreateCommandQueue( cmdQueueDesc ) );
-
-    CommandListPoolDesc cmdListPoolDesc{ };
-    cmdListPoolDesc.NumCommandLists = 3;
-    cmdListPoolDesc.CommandQueue    = m_commandQueue.get( );
-    m_commandListPool               = std::unique_ptr<ICommandListPool>( m_graphicsContext->LogicalDevice->CreateCommandListPool( cmdListPoolDesc ) );
-
-    const auto commandListArray = m_commandListPool->GetCommandLists( );
-    m_commandLists.resize( commandListArray.NumElements );
-    for ( int i = 0; i < commandListArray.NumElements; ++i )
+    auto program                               = std::make_unique<ShaderProgram>( shaderProgramDesc );
+    if ( program->CompiledShaders( ).NumElements != shaderStages.size( ) )
     {
-        m_commandLists[ i ] = commandListArray.Elements[ i ];
+        spdlog::error( "GPUDrivenRenderer: Failed to compile the uber shader" );
+        return false;
     }
 
     PipelineDesc pipelineDesc{ };
     pipelineDesc.RootSignature = m_rootSig->GetRootSignature( );
-    pipelineDesc.ShaderProgram = m_program.get( );
+    pipelineDesc.ShaderProgram = program.get( );
     pipelineDesc.BindPoint     = BindPoint::Graphics;
 
     RenderTargetDesc renderTargetDesc{ };
@@ -189,9 +285,19 @@ void GPUDrivenRenderer::InitTestPipeline( )
     pipelineDesc.Graphics.DepthTest.Enable             = true;
     pipelineDesc.Graphics.DepthStencilAttachmentFormat = Format::D32Float;
 
-    m_pipeline = std::unique_ptr<IPipeline>( m_graphicsContext->LogicalDevice->CreatePipeline( pipelineDesc ) );
-
-    RecreateDepthTexturesIfNeeded( );
+    auto pipeline = std::unique_ptr<IPipeline>( m_graphicsContext->LogicalDevice->CreatePipeline( pipelineDesc ) );
+    if ( !pipeline )
+    {
+        spdlog::error( "GPUDrivenRenderer: Failed to create the uber shader pipeline" );
+        return false;
+    }
+    if ( m_pipeline )
+    {
+        m_graphicsContext->LogicalDevice->WaitIdle( ); // The frames in flight may still use the previous pipeline
+    }
+    m_program  = std::move( program );
+    m_pipeline = std::move( pipeline );
+    return true;
 }
 
 void GPUDrivenRenderer::RecreateDepthTexturesIfNeeded( )
@@ -1,6 +1,7 @@
 #include "DZEngine/Rendering/GPUDriven/GPUDrivenRootSig.h"
 #include <spdlog/spdlog.h>
 #include <vector>
+#include "DZEngine/Assets/VertexQuantization.h"
 #include "DZEngine/Rendering/GPUDriven/GPUDrivenSceneData.h"
 #include "DenOfIzGraphics/Support/ShaderBinding/ShaderBindingTypes.h"
 
@@ -75,7 +76,7 @@ GPUDrivenRootSig::GPUDrivenRootSig( ILogicalDevice *device )
     ResourceBindingDesc vertexBufferBinding{ };
     vertexBufferBinding.Name          = "g_VertexBuffer";
     vertexBufferBinding.DataType      = BindingDataType::Struct;
-    vertexBufferBinding.NumBytes      = 72;
+    vertexBufferBinding.NumBytes      = sizeof( StaticMeshVertex );
     vertexBufferBinding.Descriptor    = ResourceDescriptor::StructuredBuffer;
     vertexBufferBinding.BindingType   = ResourceBindingType::ShaderResource;
     vertexBufferBinding.Binding       = 4;
@@ -85,7 +86,7 @@ GPUDrivenRootSig::GPUDrivenRootSig( ILogicalDevice *device )
     m_resourceBindings.push_back( vertexBufferBinding );
 
     ResourceBindingDesc indexBufferBinding{ };
-    indexBufferBinding.Name          = "g_IndexBuffer";
+    indexBufferBinding.Name          = "g_IndexBuffer"; // Holds Uint16 and Uint32 ranges, see GPUSubMesh::IndexType
     indexBufferBinding.DataType      = BindingDataType::Struct;
     indexBufferBinding.NumBytes      = sizeof( uint32_t );
     indexBufferBinding.Descriptor    = ResourceDescriptor::StructuredBuffer;
@@ -108,6 +109,91 @@ GPUDrivenRootSig::GPUDrivenRootSig( ILogicalDevice *device )
     drawArgsBufferBinding.Stages        = globalDataBinding.Stages;
     m_resourceBindings.push_back( drawArgsBufferBinding );
 
+    ResourceBindingDesc lightBufferBinding{ };
+    lightBufferBinding.Name          = "g_LightBuffer";
+    lightBufferBinding.DataType      = BindingDataType::Struct;
+    lightBufferBinding.NumBytes      = sizeof( GPULightData );
+    lightBufferBinding.Descriptor    = ResourceDescriptor::StructuredBuffer;
+    lightBufferBinding.BindingType   = ResourceBindingType::ShaderResource;
+    lightBufferBinding.Binding       = 7;
+    lightBufferBinding.RegisterSpace = 1;
+    lightBufferBinding.ArraySize     = 1;
+    lightBufferBinding.Stages        = globalDataBinding.Stages;
+    m_resourceBindings.push_back( lightBufferBinding );
+
+    ResourceBindingDesc lightClusterBufferBinding{ };
+    lightClusterBufferBinding.Name          = "g_LightClusterBuffer";
+    lightClusterBufferBinding.DataType      = BindingDataType::Struct;
+    lightClusterBufferBinding.NumBytes      = sizeof( GPULightCluster );
+    lightClusterBufferBinding.Descriptor    = ResourceDescriptor::StructuredBuffer;
+    lightClusterBufferBinding.BindingType   = ResourceBindingType::ShaderResource;
+    lightClusterBufferBinding.Binding       = 8;
+    lightClusterBufferBinding.RegisterSpace = 1;
+    lightClusterBufferBinding.ArraySize     = 1;
+    lightClusterBufferBinding.Stages        = globalDataBinding.Stages;
+    m_resourceBindings.push_back( lightClusterBufferBinding );
+
+    ResourceBindingDesc lightIndexBufferBinding{ };
+    lightIndexBufferBinding.Name          = "g_LightIndexBuffer";
+    lightIndexBufferBinding.DataType      = BindingDataType::Struct;
+    lightIndexBufferBinding.NumBytes      = sizeof( uint32_t );
+    lightIndexBufferBinding.Descriptor    = ResourceDescriptor::StructuredBuffer;
+    lightIndexBufferBinding.BindingType   = ResourceBindingType::ShaderResource;
+    lightIndexBufferBinding.Binding       = 9;
+    lightIndexBufferBinding.RegisterSpace = 1;
+    lightIndexBufferBinding.ArraySize     = 1;
+    lightIndexBufferBinding.Stages        = globalDataBinding.Stages;
+    m_resourceBindings.push_back( lightIndexBufferBinding );
+
+    ResourceBindingDesc shadowMapBinding{ };
+    shadowMapBinding.Name          = "g_ShadowMap";
+    shadowMapBinding.DataType      = BindingDataType::Texture;
+    shadowMapBinding.Descriptor    = ResourceDescriptor::Texture;
+    shadowMapBinding.BindingType   = ResourceBindingType::ShaderResource;
+    shadowMapBinding.Binding       = 10;
+    shadowMapBinding.RegisterSpace = 1;
+    shadowMapBinding.ArraySize     = 1;
+    shadowMapBinding.Stages        = globalDataBinding.Stages;
+    m_resourceBindings.push_back( shadowMapBinding );
+
+    // Aliases g_VertexBuffer, the shaders pick one based on GPUMeshData::VertexFormat
+    ResourceBindingDesc compactVertexBufferBinding{ };
+    compactVertexBufferBinding.Name          = "g_CompactVertexBuffer";
+    compactVertexBufferBinding.DataType      = BindingDataType::Struct;
+    compactVertexBufferBinding.NumBytes      = sizeof( CompactMeshVertex );
+    compactVertexBufferBinding.Descriptor    = ResourceDescriptor::StructuredBuffer;
+    compactVertexBufferBinding.BindingType   = ResourceBindingType::ShaderResource;
+    compactVertexBufferBinding.Binding       = 11;
+    compactVertexBufferBinding.RegisterSpace = 1;
+    compactVertexBufferBinding.ArraySize     = 1;
+    compactVertexBufferBinding.Stages        = globalDataBinding.Stages;
+    m_resourceBindings.push_back( compactVertexBufferBinding );
+
+    // Optional position only stream of the batch, aliases g_VertexBuffer when the batch doesn't have one
+    ResourceBindingDesc positionBufferBinding{ };
+    positionBufferBinding.Name          = "g_PositionBuffer";
+    positionBufferBinding.DataType      = BindingDataType::Struct;
+    positionBufferBinding.NumBytes      = VertexQuantization::PositionStride( VertexFormat::Full );
+    positionBufferBinding.Descriptor    = ResourceDescriptor::StructuredBuffer;
+    positionBufferBinding.BindingType   = ResourceBindingType::ShaderResource;
+    positionBufferBinding.Binding       = 12;
+    positionBufferBinding.RegisterSpace = 1;
+    positionBufferBinding.ArraySize     = 1;
+    positionBufferBinding.Stages        = globalDataBinding.Stages;
+    m_resourceBindings.push_back( positionBufferBinding );
+
+    ResourceBindingDesc compactPositionBufferBinding{ };
+    compactPositionBufferBinding.Name          = "g_CompactPositionBuffer";
+    compactPositionBufferBinding.DataType      = BindingDataType::Struct;
+    compactPositionBufferBinding.NumBytes      = VertexQuantization::PositionStride( VertexFormat::Compact );
+    compactPositionBufferBinding.Descriptor    = ResourceDescriptor::StructuredBuffer;
+    compactPositionBufferBinding.BindingType   = ResourceBindingType::ShaderResource;
+    compactPositionBufferBinding.Binding       = 13;
+    compactPositionBufferBinding.RegisterSpace = 1;
+    compactPositionBufferBinding.ArraySize     = 1;
+    compactPositionBufferBinding.Stages        = globalDataBinding.Stages;
+    m_resourceBindings.push_back( compactPositionBufferBinding );
+
     ResourceBindingDesc textureArrayBinding{ };
     textureArrayBinding.Name          = "g_Textures";
     textureArrayBinding.DataType      = BindingDataType::Texture;
@@ -155,6 +241,16 @@ GPUDrivenRootSig::GPUDrivenRootSig( ILogicalDevice *device )
     m_desc.ResourceBindings.Elements    = m_resourceBindings.data( );
     m_desc.ResourceBindings.NumElements = static_cast<uint32_t>( m_resourceBindings.size( ) );
 
+    RootConstantResourceBindingDesc shadowPassConstants{ };
+    shadowPassConstants.Name     = "g_ShadowPassConstants";
+    shadowPassConstants.Binding  = 0;
+    shadowPassConstants.NumBytes = sizeof( GPUShadowPassConstants );
+    shadowPassConstants.Stages   = globalDataBinding.Stages;
+    m_rootConstants.push_back( shadowPassConstants );
+
+    m_desc.RootConstants.Elements    = m_rootConstants.data( );
+    m_desc.RootConstants.NumElements = static_cast<uint32_t>( m_rootConstants.size( ) );
+
     m_rootSignature.reset( device->CreateRootSignature( m_desc ) );
 
     if ( !m_rootSignature )
@@ -0,0 +1,169 @@
+/*
+Den Of Iz - Game/Game Engine
+Copyright (c) 2020-2024 Muhammed Murat Cengiz
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "DZEngine/Rendering/GPUDriven/GPUDrivenShadowPass.h"
+
+#include <spdlog/spdlog.h>
+
+using namespace DZEngine;
+
+namespace
+{
+    constexpr auto ShadowVertexShaderPath = "_Assets/Engine/Shaders/GPUDriven/Shadow.vs.hlsl";
+} // namespace
+
+GPUDrivenShadowPass::GPUDrivenShadowPass( const GPUDrivenShadowPassDesc &desc ) :
+    m_graphicsContext( desc.GraphicsContext ), m_rootSig( desc.RootSig ), m_cascades( desc.Cascades ), m_shaderHotReload( desc.ShaderHotReload )
+{
+    CreatePipeline( );
+    if ( m_shaderHotReload )
+    {
+        m_shaderHotReloadId = m_shaderHotReload->Register( { ShadowVertexShaderPath }, [ this ] { CreatePipeline( ); } );
+    }
+
+    const ShadowCascadesDesc &cascadesDesc = m_cascades.GetDesc( );
+
+    TextureDesc shadowMapDesc{ };
+    shadowMapDesc.Width      = cascadesDesc.Resolution * cascadesDesc.NumCascades;
+    shadowMapDesc.Height     = cascadesDesc.Resolution;
+    shadowMapDesc.Format     = Format::D32Float;
+    shadowMapDesc.Usages     = ResourceUsage::DepthWrite | ResourceUsage::DepthRead | ResourceUsage::ShaderResource;
+    shadowMapDesc.Descriptor = ResourceDescriptor::DepthStencil | ResourceDescriptor::Texture;
+    shadowMapDesc.DebugName  = InteropString( "Shadow Cascades Atlas" );
+
+    m_shadowMaps.resize( desc.NumFrames );
+    for ( uint32_t i = 0; i < desc.NumFrames; ++i )
+    {
+        m_shadowMaps[ i ] = std::unique_ptr<ITextureResource>( m_graphicsContext->LogicalDevice->CreateTextureResource( shadowMapDesc ) );
+        m_graphicsContext->ResourceTracking->TrackTexture( m_shadowMaps[ i ].get( ), ResourceUsage::Common );
+    }
+
+    for ( uint32_t i = 0; i < cascadesDesc.NumCascades; ++i )
+    {
+        m_cascadeConstants[ i ].CascadeIndex = i;
+
+        m_cascadeBindGroups[ i ] = std::unique_ptr<IResourceBindGroup>(
+            m_graphicsContext->LogicalDevice->CreateResourceBindGroup( RootConstantBindGroupDesc( m_rootSig->GetRootSignature( ) ) ) );
+        m_cascadeBindGroups[ i ]->SetRootConstants( 0, &m_cascadeConstants[ i ] );
+    }
+}
+
+GPUDrivenShadowPass::~GPUDrivenShadowPass( )
+{
+    if ( m_shaderHotReload )
+    {
+        m_shaderHotReload->Unregister( m_shaderHotReloadId );
+    }
+}
+
+void GPUDrivenShadowPass::Update( const ClusteredLightCulling &lightCulling )
+{
+    if ( !lightCulling.HasActiveCamera( ) || lightCulling.NumDirectionalLights( ) == 0 )
+    {
+        m_cascades.Invalidate( );
+        return;
+    }
+
+    m_cascades.Fit( lightCulling.GetView( ), lightCulling.GetProjection( ), lightCulling.GetLights( )[ 0 ].Direction );
+}
+
+void GPUDrivenShadowPass::Begin( ICommandList *cmdList, const uint32_t frameIndex ) const
+{
+    ITextureResource *shadowMap = m_shadowMaps[ frameIndex ].get( );
+    m_graphicsContext->ResourceTracking->TransitionTexture( cmdList, shadowMap, ResourceUsage::DepthWrite );
+
+    RenderingAttachmentDesc depthAttachment{ };
+    depthAttachment.Resource = shadowMap;
+    depthAttachment.SetClearDepthStencil( 1.0f, 0.0f );
+
+    const ShadowCascadesDesc &cascadesDesc = m_cascades.GetDesc( );
+
+    RenderingDesc renderingDesc{ };
+    renderingDesc.DepthAttachment  = depthAttachment;
+    renderingDesc.RenderAreaWidth  = static_cast<float>( cascadesDesc.Resolution * cascadesDesc.NumCascades );
+    renderingDesc.RenderAreaHeight = static_cast<float>( cascadesDesc.Resolution );
+
+    cmdList->BeginRendering( renderingDesc );
+    cmdList->BindPipeline( m_pipeline.get( ) );
+}
+
+void GPUDrivenShadowPass::BindCascade( ICommandList *cmdList, const uint32_t cascade ) const
+{
+    const auto resolution = static_cast<float>( m_cascades.GetDesc( ).Resolution );
+    cmdList->BindViewport( resolution * static_cast<float>( cascade ), 0.0f, resolution, resolution );
+    cmdList->BindScissorRect( resolution * static_cast<float>( cascade ), 0.0f, resolution, resolution );
+    cmdList->BindResourceGroup( m_cascadeBindGroups[ cascade ].get( ) );
+}
+
+void GPUDrivenShadowPass::End( ICommandList *cmdList, const uint32_t frameIndex ) const
+{
+    cmdList->EndRendering( );
+    m_graphicsContext->ResourceTracking->TransitionTexture( cmdList, m_shadowMaps[ frameIndex ].get( ), ResourceUsage::ShaderResource );
+}
+
+const ShadowCascades &GPUDrivenShadowPass::GetCascades( ) const
+{
+    return m_cascades;
+}
+
+ITextureResource *GPUDrivenShadowPass::GetShadowMap( const uint32_t frameIndex ) const
+{
+    return m_shadowMaps[ frameIndex ].get( );
+}
+
+bool GPUDrivenShadowPass::CreatePipeline( )
+{
+    ShaderStageDesc vertShaderStageDesc{ };
+    vertShaderStageDesc.Stage      = ShaderStage::Vertex;
+    vertShaderStageDesc.Path       = ShadowVertexShaderPath;
+    vertShaderStageDesc.EntryPoint = "VSMain";
+
+    ShaderProgramDesc shaderProgramDesc{ };
+    shaderProgramDesc.ShaderStages.Elements    = &vertShaderStageDesc;
+    shaderProgramDesc.ShaderStages.NumElements = 1;
+    auto program                               = std::make_unique<ShaderProgram>( shaderProgramDesc );
+    if ( program->CompiledShaders( ).NumElements != shaderProgramDesc.ShaderStages.NumElements )
+    {
+        spdlog::error( "GPUDrivenShadowPass: Failed to compile the shadow shader" );
+        return false;
+    }
+
+    PipelineDesc pipelineDesc{ };
+    pipelineDesc.RootSignature = m_rootSig->GetRootSignature( );
+    pipelineDesc.ShaderProgram = program.get( );
+    pipelineDesc.BindPoint     = BindPoint::Graphics;
+
+    pipelineDesc.Graphics.DepthTest.Enable             = true;
+    pipelineDesc.Graphics.DepthTest.CompareOp          = CompareOp::Less;
+    pipelineDesc.Graphics.DepthTest.Write              = true;
+    pipelineDesc.Graphics.DepthStencilAttachmentFormat = Format::D32Float;
+
+    auto pipeline = std::unique_ptr<IPipeline>( m_graphicsContext->LogicalDevice->CreatePipeline( pipelineDesc ) );
+    if ( !pipeline )
+    {
+        spdlog::error( "GPUDrivenShadowPass: Failed to create shadow pipeline" );
+        return false;
+    }
+    if ( m_pipeline )
+    {
+        m_graphicsContext->LogicalDevice->WaitIdle( ); // The frames in flight may still use the previous pipeline
+    }
+    m_program  = std::move( program );
+    m_pipeline = std::move( pipeline );
+    return true;
+}
@@ -0,0 +1,158 @@
+/*
+Den Of Iz - Game/Game Engine
+Copyright (c) 2020-2024 Muhammed Murat Cengiz
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "DZEngine/Rendering/Lighting/ClusteredLightCulling.h"
+
+#include <cmath>
+#include <flecs.h>
+#include "DZEngine/Components/CameraComponent.h"
+#include "DZEngine/Components/Graphics/LightComponent.h"
+#include "DZEngine/Components/TransformComponent.h"
+#include "DZEngine/Math/MathConverter.h"
+
+using namespace DZEngine;
+
+namespace
+{
+    Float3 LightDirection( const TransformComponent &transform )
+    {
+        const DirectX::XMVECTOR rotation  = MathConverter::Float4ToXMVECTOR( transform.Rotation );
+        const DirectX::XMVECTOR direction = DirectX::XMVector3Rotate( DirectX::XMVectorSet( 0.0f, 0.0f, 1.0f, 0.0f ), rotation );
+        return MathConverter::Float3FromXMVECTOR( DirectX::XMVector3Normalize( direction ) );
+    }
+} // namespace
+
+ClusteredLightCulling::ClusteredLightCulling( const ClusteredLightCullingDesc &desc ) : m_world( desc.World ), m_builder( desc.Clusters )
+{
+    m_lights.reserve( MaxNumDirectionalLights + desc.Clusters.MaxLights );
+    m_bounds.reserve( desc.Clusters.MaxLights );
+}
+
+void ClusteredLightCulling::Update( )
+{
+    const auto &world = m_world->GetWorld( );
+
+    m_hasActiveCamera      = false;
+    const auto cameraQuery = world.query<const CameraComponent>( );
+    cameraQuery.each(
+        [ & ]( const CameraComponent &camera )
+        {
+            if ( camera.Active )
+            {
+                m_view            = camera.View;
+                m_projection      = camera.Projection;
+                m_hasActiveCamera = true;
+            }
+        } );
+
+    m_lights.clear( );
+    m_bounds.clear( );
+
+    const auto directionalQuery = world.query<const TransformComponent, const DirectionalLightComponent>( );
+    directionalQuery.each(
+        [ & ]( const TransformComponent &transform, const DirectionalLightComponent &light )
+        {
+            if ( m_lights.size( ) >= MaxNumDirectionalLights )
+            {
+                return;
+            }
+            GPULightData &gpuLight = m_lights.emplace_back( );
+            gpuLight.Type          = GPULightType::Directional;
+            gpuLight.Direction     = LightDirection( transform );
+            gpuLight.Color         = light.Color;
+            gpuLight.Intensity     = light.Intensity;
+        } );
+    m_numDirectionalLights = static_cast<uint32_t>( m_lights.size( ) );
+
+    const uint32_t maxLights  = m_numDirectionalLights + m_builder.GetDesc( ).MaxLights;
+    const auto     pointQuery = world.query<const TransformComponent, const PointLightComponent>( );
+    pointQuery.each(
+        [ & ]( const TransformComponent &transform, const PointLightComponent &light )
+        {
+            if ( m_lights.size( ) >= maxLights )
+            {
+                return;
+            }
+            GPULightData &gpuLight = m_lights.emplace_back( );
+            gpuLight.Type          = GPULightType::Point;
+            gpuLight.Position      = transform.Position;
+            gpuLight.Range         = light.Range;
+            gpuLight.Color         = light.Color;
+            gpuLight.Intensity     = light.Intensity;
+            m_bounds.push_back( { transform.Position, light.Range } );
+        } );
+
+    const auto spotQuery = world.query<const TransformComponent, const SpotLightComponent>( );
+    spotQuery.each(
+        [ & ]( const TransformComponent &transform, const SpotLightComponent &light )
+        {
+            if ( m_lights.size( ) >= maxLights )
+            {
+                return;
+            }
+            GPULightData &gpuLight = m_lights.emplace_back( );
+            gpuLight.Type          = GPULightType::Spot;
+            gpuLight.Position      = transform.Position;
+            gpuLight.Range         = light.Range;
+            gpuLight.Direction     = LightDirection( transform );
+            gpuLight.Color         = light.Color;
+            gpuLight.Intensity     = light.Intensity;
+            gpuLight.SpotCosOuter  = std::cos( light.OuterConeAngle );
+            gpuLight.SpotCosInner  = std::cos( light.InnerConeAngle );
+            m_bounds.push_back( LightClusterBuilder::SpotLightBounds( transform.Position, gpuLight.Direction, light.Range, light.OuterConeAngle ) );
+        } );
+
+    if ( !m_hasActiveCamera )
+    {
+        m_lights.resize( m_numDirectionalLights );
+        m_bounds.clear( );
+        m_builder.Reset( );
+        return;
+    }
+    m_builder.Build( m_view, m_projection, m_bounds );
+}
+
+const std::vector<GPULightData> &ClusteredLightCulling::GetLights( ) const
+{
+    return m_lights;
+}
+
+uint32_t ClusteredLightCulling::NumDirectionalLights( ) const
+{
+    return m_numDirectionalLights;
+}
+
+const LightClusterBuilder &ClusteredLightCulling::GetClusters( ) const
+{
+    return m_builder;
+}
+
+bool ClusteredLightCulling::HasActiveCamera( ) const
+{
+    return m_hasActiveCamera;
+}
+
+const Float4x4 &ClusteredLightCulling::GetView( ) const
+{
+    return m_view;
+}
+
+const Float4x4 &ClusteredLightCulling::GetProjection( ) const
+{
+    return m_projection;
+}
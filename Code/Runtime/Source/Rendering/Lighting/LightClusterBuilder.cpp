@@ -0,0 +1,450 @@
+/*
+Den Of Iz - Game/Game Engine
+Copyright (c) 2020-2024 Muhammed Murat Cengiz
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "DZEngine/Rendering/Lighting/LightClusterBuilder.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <spdlog/spdlog.h>
+#include <taskflow/algorithm/for_each.hpp>
+#include <taskflow/taskflow.hpp>
+#include "DZEngine/Math/MathConverter.h"
+
+using namespace DZEngine;
+using namespace DirectX;
+
+namespace
+{
+    // Distance from v to the [min, max] interval, 0 if inside. Build and BuildReference must compute this identically for their results to match
+    float AxisDistance( const float v, const float min, const float max )
+    {
+        return std::max( std::max( min - v, v - max ), 0.0f );
+    }
+
+    void AxisDistanceSq( const float v, const float *mins, const float *maxs, const uint32_t count, float *outDistSq )
+    {
+        const XMVECTOR value = XMVectorReplicate( v );
+        const XMVECTOR zero  = XMVectorZero( );
+
+        uint32_t i = 0;
+        for ( ; i + 4 <= count; i += 4 )
+        {
+            const XMVECTOR min  = XMLoadFloat4( reinterpret_cast<const XMFLOAT4 *>( mins + i ) );
+            const XMVECTOR max  = XMLoadFloat4( reinterpret_cast<const XMFLOAT4 *>( maxs + i ) );
+            const XMVECTOR dist = XMVectorMax( XMVectorMax( XMVectorSubtract( min, value ), XMVectorSubtract( value, max ) ), zero );
+            XMStoreFloat4( reinterpret_cast<XMFLOAT4 *>( outDistSq + i ), XMVectorMultiply( dist, dist ) );
+        }
+        for ( ; i < count; ++i )
+        {
+            const float dist = AxisDistance( v, mins[ i ], maxs[ i ] );
+            outDistSq[ i ]   = dist * dist;
+        }
+    }
+} // namespace
+
+LightClusterBuilder::LightClusterBuilder( const LightClusterBuilderDesc &desc ) : m_desc( desc )
+{
+    m_desc.NumClustersX = std::max( 1u, m_desc.NumClustersX );
+    m_desc.NumClustersY = std::max( 1u, m_desc.NumClustersY );
+    m_desc.NumClustersZ = std::max( 1u, m_desc.NumClustersZ );
+    m_numClusters       = m_desc.NumClustersX * m_desc.NumClustersY * m_desc.NumClustersZ;
+
+    m_sliceMinZ.resize( m_desc.NumClustersZ );
+    m_sliceMaxZ.resize( m_desc.NumClustersZ );
+    m_tileMinX.resize( m_desc.NumClustersZ * m_desc.NumClustersX );
+    m_tileMaxX.resize( m_desc.NumClustersZ * m_desc.NumClustersX );
+    m_tileMinY.resize( m_desc.NumClustersZ * m_desc.NumClustersY );
+    m_tileMaxY.resize( m_desc.NumClustersZ * m_desc.NumClustersY );
+
+    m_sliceScratch.resize( m_desc.NumClustersZ );
+    for ( auto &scratch : m_sliceScratch )
+    {
+        scratch.Cursors.resize( m_desc.NumClustersX * m_desc.NumClustersY );
+        scratch.DistSqX.resize( m_desc.NumClustersX );
+        scratch.DistSqY.resize( m_desc.NumClustersY );
+    }
+
+    m_clusters.resize( m_numClusters );
+    m_lightIndices.reserve( m_desc.MaxLightIndices );
+}
+
+void LightClusterBuilder::Build( const Float4x4 &view, const Float4x4 &projection, const std::vector<ClusterLightBounds> &lights )
+{
+    const auto start = std::chrono::high_resolution_clock::now( );
+
+    UpdateClusterBounds( projection );
+    TransformLights( view, lights );
+
+    if ( m_desc.Executor )
+    {
+        tf::Taskflow taskflow;
+        taskflow.for_each_index( 0u, m_desc.NumClustersZ, 1u, [ this ]( const uint32_t slice ) { BinSlice( slice ); } );
+        m_desc.Executor->run( taskflow ).wait( );
+    }
+    else
+    {
+        for ( uint32_t slice = 0; slice < m_desc.NumClustersZ; ++slice )
+        {
+            BinSlice( slice );
+        }
+    }
+
+    const uint32_t numIndices = ClampIndexCounts( );
+    m_lightIndices.resize( numIndices );
+    for ( const auto &scratch : m_sliceScratch )
+    {
+        if ( scratch.Base >= numIndices )
+        {
+            break;
+        }
+        const size_t numToCopy = std::min<size_t>( scratch.Indices.size( ), numIndices - scratch.Base );
+        std::memcpy( m_lightIndices.data( ) + scratch.Base, scratch.Indices.data( ), numToCopy * sizeof( uint32_t ) );
+    }
+
+    m_stats.NumLightIndices     = numIndices;
+    m_stats.MaxLightsPerCluster = 0;
+    for ( const auto &cluster : m_clusters )
+    {
+        m_stats.MaxLightsPerCluster = std::max( m_stats.MaxLightsPerCluster, cluster.Count );
+    }
+    m_stats.BuildMilliseconds = std::chrono::duration<double, std::milli>( std::chrono::high_resolution_clock::now( ) - start ).count( );
+}
+
+void LightClusterBuilder::BuildReference( const Float4x4 &view, const Float4x4 &projection, const std::vector<ClusterLightBounds> &lights )
+{
+    const auto start = std::chrono::high_resolution_clock::now( );
+
+    UpdateClusterBounds( projection );
+    TransformLights( view, lights );
+
+    const uint32_t numX = m_desc.NumClustersX;
+    const uint32_t numY = m_desc.NumClustersY;
+
+    m_lightIndices.clear( );
+    m_stats.NumDroppedIndices   = 0;
+    m_stats.MaxLightsPerCluster = 0;
+    for ( uint32_t clusterIndex = 0; clusterIndex < m_numClusters; ++clusterIndex )
+    {
+        const uint32_t x     = clusterIndex % numX;
+        const uint32_t y     = clusterIndex / numX % numY;
+        const uint32_t slice = clusterIndex / ( numX * numY );
+
+        const float minX = m_tileMinX[ slice * numX + x ];
+        const float maxX = m_tileMaxX[ slice * numX + x ];
+        const float minY = m_tileMinY[ slice * numY + y ];
+        const float maxY = m_tileMaxY[ slice * numY + y ];
+        const float minZ = m_sliceMinZ[ slice ];
+        const float maxZ = m_sliceMaxZ[ slice ];
+
+        GPULightCluster &cluster = m_clusters[ clusterIndex ];
+        cluster.Offset           = static_cast<uint32_t>( m_lightIndices.size( ) );
+        cluster.Count            = 0;
+        for ( uint32_t lightIndex = 0; lightIndex < m_viewLights.size( ); ++lightIndex )
+        {
+            const Float4 &light    = m_viewLights[ lightIndex ];
+            const float   dx       = AxisDistance( light.X, minX, maxX );
+            const float   dy       = AxisDistance( light.Y, minY, maxY );
+            const float   dz       = AxisDistance( light.Z, minZ, maxZ );
+            const float   dxSq     = dx * dx;
+            const float   dySq     = dy * dy;
+            const float   dzSq     = dz * dz;
+            const float   dxySq    = dxSq + dySq;
+            const float   distSq   = dxySq + dzSq;
+            const float   radiusSq = light.W * light.W;
+            if ( distSq > radiusSq )
+            {
+                continue;
+            }
+            if ( m_lightIndices.size( ) >= m_desc.MaxLightIndices )
+            {
+                m_stats.NumDroppedIndices++;
+                continue;
+            }
+            m_lightIndices.push_back( lightIndex );
+            cluster.Count++;
+        }
+        m_stats.MaxLightsPerCluster = std::max( m_stats.MaxLightsPerCluster, cluster.Count );
+    }
+
+    m_stats.NumLightIndices   = static_cast<uint32_t>( m_lightIndices.size( ) );
+    m_stats.BuildMilliseconds = std::chrono::duration<double, std::milli>( std::chrono::high_resolution_clock::now( ) - start ).count( );
+}
+
+void LightClusterBuilder::Reset( )
+{
+    std::fill( m_clusters.begin( ), m_clusters.end( ), GPULightCluster{ 0, 0 } );
+    m_lightIndices.clear( );
+    m_stats = { };
+}
+
+bool LightClusterBuilder::Matches( const LightClusterBuilder &other ) const
+{
+    if ( m_clusters.size( ) != other.m_clusters.size( ) || m_lightIndices != other.m_lightIndices )
+    {
+        return false;
+    }
+    for ( size_t i = 0; i < m_clusters.size( ); ++i )
+    {
+        if ( m_clusters[ i ].Offset != other.m_clusters[ i ].Offset || m_clusters[ i ].Count != other.m_clusters[ i ].Count )
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+const std::vector<GPULightCluster> &LightClusterBuilder::GetClusters( ) const
+{
+    return m_clusters;
+}
+
+const std::vector<uint32_t> &LightClusterBuilder::GetLightIndices( ) const
+{
+    return m_lightIndices;
+}
+
+const LightClusterStats &LightClusterBuilder::GetStats( ) const
+{
+    return m_stats;
+}
+
+const LightClusterBuilderDesc &LightClusterBuilder::GetDesc( ) const
+{
+    return m_desc;
+}
+
+uint32_t LightClusterBuilder::NumClusters( ) const
+{
+    return m_numClusters;
+}
+
+float LightClusterBuilder::GetNear( ) const
+{
+    return m_near;
+}
+
+float LightClusterBuilder::GetFar( ) const
+{
+    return m_far;
+}
+
+float LightClusterBuilder::GetDepthScale( ) const
+{
+    return static_cast<float>( m_desc.NumClustersZ ) / std::log( m_far / m_near );
+}
+
+float LightClusterBuilder::GetDepthBias( ) const
+{
+    return -static_cast<float>( m_desc.NumClustersZ ) * std::log( m_near ) / std::log( m_far / m_near );
+}
+
+ClusterLightBounds LightClusterBuilder::SpotLightBounds( const Float3 &position, const Float3 &direction, const float range, const float outerConeAngle )
+{
+    // Smallest sphere enclosing the cone, for wide cones the sphere around the cap is smaller than the one passing through the apex
+    float centerDistance;
+    float radius;
+    if ( outerConeAngle > XM_PIDIV4 )
+    {
+        centerDistance = std::cos( outerConeAngle ) * range;
+        radius         = std::sin( outerConeAngle ) * range;
+    }
+    else
+    {
+        centerDistance = range / ( 2.0f * std::cos( outerConeAngle ) );
+        radius         = centerDistance;
+    }
+
+    ClusterLightBounds bounds{ };
+    bounds.Position = { position.X + direction.X * centerDistance, position.Y + direction.Y * centerDistance, position.Z + direction.Z * centerDistance };
+    bounds.Radius   = radius;
+    return bounds;
+}
+
+void LightClusterBuilder::UpdateClusterBounds( const Float4x4 &projection )
+{
+    if ( m_near > 0.0f && std::memcmp( &projection, &m_cachedProjection, sizeof( Float4x4 ) ) == 0 )
+    {
+        return;
+    }
+    m_cachedProjection = projection;
+
+    // Left-handed perspective: _33 = f / ( f - n ), _43 = -n * f / ( f - n )
+    if ( projection._33 == 0.0f || projection._33 == 1.0f || projection._11 == 0.0f || projection._22 == 0.0f )
+    {
+        spdlog::error( "LightClusterBuilder::UpdateClusterBounds - Projection is not a finite left-handed perspective projection" );
+        m_near = 0.1f;
+        m_far  = 100.0f;
+    }
+    else
+    {
+        m_near = -projection._43 / projection._33;
+        m_far  = projection._43 / ( 1.0f - projection._33 );
+    }
+
+    const uint32_t numX = m_desc.NumClustersX;
+    const uint32_t numY = m_desc.NumClustersY;
+    const uint32_t numZ = m_desc.NumClustersZ;
+    const float    logFarNear = std::log( m_far / m_near );
+
+    for ( uint32_t slice = 0; slice < numZ; ++slice )
+    {
+        const float minZ    = m_near * std::exp( logFarNear * static_cast<float>( slice ) / static_cast<float>( numZ ) );
+        const float maxZ    = m_near * std::exp( logFarNear * static_cast<float>( slice + 1 ) / static_cast<float>( numZ ) );
+        m_sliceMinZ[ slice ] = minZ;
+        m_sliceMaxZ[ slice ] = maxZ;
+
+        // View space x = ( ndcX - _31 ) * z / _11, extremes are always at the slice's near or far plane
+        for ( uint32_t x = 0; x < numX; ++x )
+        {
+            const float left  = ( -1.0f + 2.0f * static_cast<float>( x ) / static_cast<float>( numX ) - projection._31 ) / projection._11;
+            const float right = ( -1.0f + 2.0f * static_cast<float>( x + 1 ) / static_cast<float>( numX ) - projection._31 ) / projection._11;
+
+            m_tileMinX[ slice * numX + x ] = std::min( { left * minZ, left * maxZ, right * minZ, right * maxZ } );
+            m_tileMaxX[ slice * numX + x ] = std::max( { left * minZ, left * maxZ, right * minZ, right * maxZ } );
+        }
+        for ( uint32_t y = 0; y < numY; ++y )
+        {
+            const float top    = ( 1.0f - 2.0f * static_cast<float>( y ) / static_cast<float>( numY ) - projection._32 ) / projection._22;
+            const float bottom = ( 1.0f - 2.0f * static_cast<float>( y + 1 ) / static_cast<float>( numY ) - projection._32 ) / projection._22;
+
+            m_tileMinY[ slice * numY + y ] = std::min( { top * minZ, top * maxZ, bottom * minZ, bottom * maxZ } );
+            m_tileMaxY[ slice * numY + y ] = std::max( { top * minZ, top * maxZ, bottom * minZ, bottom * maxZ } );
+        }
+    }
+}
+
+void LightClusterBuilder::TransformLights( const Float4x4 &view, const std::vector<ClusterLightBounds> &lights )
+{
+    const uint32_t numLights = static_cast<uint32_t>( std::min<size_t>( lights.size( ), m_desc.MaxLights ) );
+    m_stats.NumLights        = numLights;
+    m_stats.NumDroppedLights = static_cast<uint32_t>( lights.size( ) - numLights );
+
+    m_viewLights.resize( numLights );
+    if ( numLights == 0 )
+    {
+        return;
+    }
+
+    XMVector3TransformCoordStream( reinterpret_cast<XMFLOAT3 *>( m_viewLights.data( ) ), sizeof( Float4 ), reinterpret_cast<const XMFLOAT3 *>( &lights[ 0 ].Position ),
+                                   sizeof( ClusterLightBounds ), numLights, MathConverter::Float4X4ToXMMATRIX( view ) );
+    for ( uint32_t i = 0; i < numLights; ++i )
+    {
+        m_viewLights[ i ].W = lights[ i ].Radius;
+    }
+}
+
+void LightClusterBuilder::BinSlice( const uint32_t slice )
+{
+    const uint32_t numX             = m_desc.NumClustersX;
+    const uint32_t numY             = m_desc.NumClustersY;
+    const uint32_t numSliceClusters = numX * numY;
+
+    SliceScratch    &scratch  = m_sliceScratch[ slice ];
+    GPULightCluster *clusters = m_clusters.data( ) + slice * numSliceClusters;
+    const float      minZ     = m_sliceMinZ[ slice ];
+    const float      maxZ     = m_sliceMaxZ[ slice ];
+
+    scratch.Pairs.clear( );
+    for ( uint32_t i = 0; i < numSliceClusters; ++i )
+    {
+        clusters[ i ] = { 0, 0 };
+    }
+
+    for ( uint32_t lightIndex = 0; lightIndex < m_viewLights.size( ); ++lightIndex )
+    {
+        const Float4 &light    = m_viewLights[ lightIndex ];
+        const float   radiusSq = light.W * light.W;
+        const float   dz       = AxisDistance( light.Z, minZ, maxZ );
+        const float   dzSq     = dz * dz;
+        if ( dzSq > radiusSq )
+        {
+            continue;
+        }
+
+        AxisDistanceSq( light.X, &m_tileMinX[ slice * numX ], &m_tileMaxX[ slice * numX ], numX, scratch.DistSqX.data( ) );
+        AxisDistanceSq( light.Y, &m_tileMinY[ slice * numY ], &m_tileMaxY[ slice * numY ], numY, scratch.DistSqY.data( ) );
+
+        // Same summation order as BuildReference, adding non-negative terms is monotonic so the early outs never reject a cluster the full test accepts
+        for ( uint32_t y = 0; y < numY; ++y )
+        {
+            const float dySq  = scratch.DistSqY[ y ];
+            const float dyzSq = dySq + dzSq;
+            if ( dyzSq > radiusSq )
+            {
+                continue;
+            }
+            for ( uint32_t x = 0; x < numX; ++x )
+            {
+                const float dxySq  = scratch.DistSqX[ x ] + dySq;
+                const float distSq = dxySq + dzSq;
+                if ( distSq <= radiusSq )
+                {
+                    const uint32_t clusterIndex = y * numX + x;
+                    scratch.Pairs.push_back( clusterIndex );
+                    scratch.Pairs.push_back( lightIndex );
+                    clusters[ clusterIndex ].Count++;
+                }
+            }
+        }
+    }
+
+    // Stable counting sort by cluster, lights stay in ascending order within each cluster
+    uint32_t offset = 0;
+    for ( uint32_t i = 0; i < numSliceClusters; ++i )
+    {
+        clusters[ i ].Offset  = offset;
+        scratch.Cursors[ i ] = offset;
+        offset += clusters[ i ].Count;
+    }
+    scratch.Indices.resize( offset );
+    for ( size_t i = 0; i < scratch.Pairs.size( ); i += 2 )
+    {
+        scratch.Indices[ scratch.Cursors[ scratch.Pairs[ i ] ]++ ] = scratch.Pairs[ i + 1 ];
+    }
+}
+
+uint32_t LightClusterBuilder::ClampIndexCounts( )
+{
+    const uint32_t numSliceClusters = m_desc.NumClustersX * m_desc.NumClustersY;
+    const uint32_t maxIndices       = m_desc.MaxLightIndices;
+
+    uint32_t base             = 0;
+    m_stats.NumDroppedIndices = 0;
+    for ( uint32_t slice = 0; slice < m_desc.NumClustersZ; ++slice )
+    {
+        SliceScratch &scratch = m_sliceScratch[ slice ];
+        scratch.Base          = base;
+
+        GPULightCluster *clusters = m_clusters.data( ) + slice * numSliceClusters;
+        for ( uint32_t i = 0; i < numSliceClusters; ++i )
+        {
+            GPULightCluster &cluster = clusters[ i ];
+            cluster.Offset           = std::min( cluster.Offset + base, maxIndices );
+            const uint32_t available = maxIndices - cluster.Offset;
+            if ( cluster.Count > available )
+            {
+                m_stats.NumDroppedIndices += cluster.Count - available;
+                cluster.Count = available;
+            }
+        }
+        base += static_cast<uint32_t>( scratch.Indices.size( ) );
+    }
+    return std::min( base, maxIndices );
+}
@@ -0,0 +1,120 @@
+/*
+Den Of Iz - Game/Game Engine
+Copyright (c) 2020-2024 Muhammed Murat Cengiz
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "DZEngine/Rendering/ShaderHotReload.h"
+#include <algorithm>
+#include <fstream>
+#include <regex>
+#include <spdlog/spdlog.h>
+
+using namespace DZEngine;
+
+uint32_t ShaderHotReload::Register( std::vector<std::filesystem::path> sources, std::function<void( )> rebuild )
+{
+    const uint32_t id      = m_nextId++;
+    Program       &program = m_programs[ id ];
+    program.Files          = CollectFiles( sources );
+    program.Sources        = std::move( sources );
+    program.Rebuild        = std::move( rebuild );
+    return id;
+}
+
+void ShaderHotReload::Unregister( const uint32_t id )
+{
+    m_programs.erase( id );
+}
+
+uint32_t ShaderHotReload::OnFilesChanged( const std::span<const FileChange> changes )
+{
+    std::unordered_set<std::string> changed;
+    for ( const FileChange &change : changes )
+    {
+        if ( change.Type != FileChangeType::Removed )
+        {
+            changed.insert( FileKey( change.Path ) );
+        }
+    }
+
+    std::vector<uint32_t> affected;
+    for ( const auto &[ id, program ] : m_programs )
+    {
+        if ( std::ranges::any_of( program.Files, [ & ]( const std::string &file ) { return changed.contains( file ); } ) )
+        {
+            affected.push_back( id );
+        }
+    }
+
+    // Rebuild may register or unregister programs, each one is looked up again
+    for ( const uint32_t id : affected )
+    {
+        const auto program = m_programs.find( id );
+        if ( program == m_programs.end( ) )
+        {
+            continue;
+        }
+        spdlog::info( "ShaderHotReload: Rebuilding {}", program->second.Sources.front( ).string( ) );
+        program->second.Files = CollectFiles( program->second.Sources ); // Includes may have been added or removed
+        std::function<void( )> rebuild = program->second.Rebuild;
+        rebuild( );
+    }
+    return static_cast<uint32_t>( affected.size( ) );
+}
+
+size_t ShaderHotReload::NumPrograms( ) const
+{
+    return m_programs.size( );
+}
+
+std::string ShaderHotReload::FileKey( const std::filesystem::path &path )
+{
+    std::error_code             error;
+    const std::filesystem::path canonical = std::filesystem::weakly_canonical( path, error );
+    return ( error ? path.lexically_normal( ) : canonical ).generic_string( );
+}
+
+std::unordered_set<std::string> ShaderHotReload::CollectFiles( const std::vector<std::filesystem::path> &sources )
+{
+    static const std::regex includePattern( R"pattern(^\s*#\s*include\s*"([^"]+)")pattern" );
+
+    std::unordered_set<std::string>    files;
+    std::vector<std::filesystem::path> pending( sources.begin( ), sources.end( ) );
+    while ( !pending.empty( ) )
+    {
+        const std::filesystem::path path = std::move( pending.back( ) );
+        pending.pop_back( );
+        if ( !files.insert( FileKey( path ) ).second )
+        {
+            continue;
+        }
+
+        std::ifstream file( path );
+        std::string   line;
+        std::smatch   match;
+        while ( std::getline( file, line ) )
+        {
+            if ( !std::regex_search( line, match, includePattern ) )
+            {
+                continue;
+            }
+            std::error_code             error;
+            const std::filesystem::path include = path.parent_path( ) / match[ 1 ].str( );
+            pending.push_back( std::filesystem::exists( include, error ) ? include : std::filesystem::path( match[ 1 ].str( ) ) );
+        }
+    }
+    return files;
+}
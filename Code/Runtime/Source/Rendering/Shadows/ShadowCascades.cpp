@@ -0,0 +1,188 @@
+/*
+Den Of Iz - Game/Game Engine
+Copyright (c) 2020-2024 Muhammed Murat Cengiz
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "DZEngine/Rendering/Shadows/ShadowCascades.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <spdlog/spdlog.h>
+#include "DZEngine/Math/MathConverter.h"
+
+using namespace DZEngine;
+using namespace DirectX;
+
+namespace
+{
+    bool IsCasterVisible( const XMMATRIX &lightView, const ShadowCascade &cascade, const Float4 &worldSphere )
+    {
+        const XMVECTOR center = XMVector3Transform( XMVectorSet( worldSphere.X, worldSphere.Y, worldSphere.Z, 1.0f ), lightView );
+        const float    extent = cascade.Radius + worldSphere.W;
+
+        return std::abs( XMVectorGetX( center ) - cascade.LightSpaceCenter.X ) <= extent && std::abs( XMVectorGetY( center ) - cascade.LightSpaceCenter.Y ) <= extent &&
+               XMVectorGetZ( center ) - worldSphere.W <= cascade.LightSpaceCenter.Z + cascade.Radius;
+    }
+} // namespace
+
+ShadowCascades::ShadowCascades( const ShadowCascadesDesc &desc ) : m_desc( desc )
+{
+    m_desc.NumCascades = std::clamp( m_desc.NumCascades, 1u, MaxShadowCascades );
+    m_desc.Resolution  = std::max( m_desc.Resolution, 1u );
+    m_cascades.resize( m_desc.NumCascades );
+}
+
+void ShadowCascades::Fit( const Float4x4 &cameraView, const Float4x4 &cameraProjection, const Float3 &lightDirection )
+{
+    m_valid = false;
+    const bool isPerspective = cameraProjection._34 == 1.0f && cameraProjection._44 == 0.0f;
+    if ( !isPerspective || cameraProjection._33 == 0.0f || cameraProjection._33 == 1.0f || cameraProjection._11 == 0.0f || cameraProjection._22 == 0.0f )
+    {
+        spdlog::error( "ShadowCascades::Fit - Camera projection is not a finite left-handed perspective projection" );
+        return;
+    }
+
+    const XMVECTOR direction = XMVector3Normalize( MathConverter::Float3ToXMVECTOR( lightDirection ) );
+    if ( XMVectorGetX( XMVector3LengthSq( direction ) ) < 0.5f )
+    {
+        spdlog::error( "ShadowCascades::Fit - Light direction is zero" );
+        return;
+    }
+
+    // Left-handed perspective: _33 = f / ( f - n ), _43 = -n * f / ( f - n )
+    const float nearPlane = -cameraProjection._43 / cameraProjection._33;
+    const float farPlane  = std::min( cameraProjection._43 / ( 1.0f - cameraProjection._33 ), m_desc.MaxShadowDistance );
+
+    std::array<float, MaxShadowCascades> splitFar{ };
+    ComputeSplits( nearPlane, farPlane, m_desc.NumCascades, m_desc.SplitLambda, splitFar.data( ) );
+
+    const XMMATRIX invView = XMMatrixInverse( nullptr, MathConverter::Float4X4ToXMMATRIX( cameraView ) );
+    const XMVECTOR up      = std::abs( XMVectorGetY( direction ) ) > 0.99f ? XMVectorSet( 0.0f, 0.0f, 1.0f, 0.0f ) : XMVectorSet( 0.0f, 1.0f, 0.0f, 0.0f );
+    // Rotation only, keeping the light space origin fixed is what makes texel snapping stable
+    const XMMATRIX lightView = XMMatrixLookToLH( XMVectorZero( ), direction, up );
+    m_lightView              = MathConverter::Float4X4FromXMMATRIX( lightView );
+
+    // Squared distance from the view axis of a frustum corner at depth 1
+    const float tanX        = 1.0f / cameraProjection._11;
+    const float tanY        = 1.0f / cameraProjection._22;
+    const float cornerSlope = tanX * tanX + tanY * tanY;
+
+    for ( uint32_t i = 0; i < m_desc.NumCascades; ++i )
+    {
+        ShadowCascade &cascade = m_cascades[ i ];
+        cascade.SplitNear      = i == 0 ? nearPlane : splitFar[ i - 1 ];
+        cascade.SplitFar       = splitFar[ i ];
+
+        // Sphere through the near and far corner rings of the slice, centered on the view axis
+        const float zn      = cascade.SplitNear;
+        const float zf      = cascade.SplitFar;
+        float       centerZ = 0.5f * ( cornerSlope + 1.0f ) * ( zn + zf );
+        float       radius;
+        if ( centerZ >= zf )
+        {
+            centerZ = zf;
+            radius  = std::sqrt( cornerSlope ) * zf;
+        }
+        else
+        {
+            radius = std::sqrt( cornerSlope * zn * zn + ( zn - centerZ ) * ( zn - centerZ ) );
+        }
+        radius = std::ceil( radius * 16.0f ) / 16.0f;
+
+        const XMVECTOR centerWorld = XMVector3TransformCoord( XMVectorSet( 0.0f, 0.0f, centerZ, 1.0f ), invView );
+        const XMVECTOR centerLight = XMVector3TransformCoord( centerWorld, lightView );
+
+        cascade.Radius    = radius;
+        cascade.TexelSize = 2.0f * radius / static_cast<float>( m_desc.Resolution );
+
+        cascade.LightSpaceCenter.X = std::floor( XMVectorGetX( centerLight ) / cascade.TexelSize ) * cascade.TexelSize;
+        cascade.LightSpaceCenter.Y = std::floor( XMVectorGetY( centerLight ) / cascade.TexelSize ) * cascade.TexelSize;
+        cascade.LightSpaceCenter.Z = XMVectorGetZ( centerLight );
+
+        const Float3  &c          = cascade.LightSpaceCenter;
+        const XMMATRIX projection = XMMatrixOrthographicOffCenterLH( c.X - radius, c.X + radius, c.Y - radius, c.Y + radius, c.Z - radius, c.Z + radius );
+
+        cascade.View           = m_lightView;
+        cascade.Projection     = MathConverter::Float4X4FromXMMATRIX( projection );
+        cascade.ViewProjection = MathConverter::Float4X4FromXMMATRIX( XMMatrixMultiply( lightView, projection ) );
+    }
+    m_valid = true;
+}
+
+void ShadowCascades::Invalidate( )
+{
+    m_valid = false;
+}
+
+bool ShadowCascades::IsCasterVisible( const uint32_t cascade, const Float4 &worldSphere ) const
+{
+    if ( !m_valid || cascade >= m_cascades.size( ) )
+    {
+        return false;
+    }
+    return ::IsCasterVisible( MathConverter::Float4X4ToXMMATRIX( m_lightView ), m_cascades[ cascade ], worldSphere );
+}
+
+void ShadowCascades::CullCasters( const uint32_t cascade, const std::vector<Float4> &worldSpheres, std::vector<uint32_t> &outVisible ) const
+{
+    if ( !m_valid || cascade >= m_cascades.size( ) )
+    {
+        return;
+    }
+
+    const XMMATRIX       lightView     = MathConverter::Float4X4ToXMMATRIX( m_lightView );
+    const ShadowCascade &shadowCascade = m_cascades[ cascade ];
+    for ( uint32_t i = 0; i < worldSpheres.size( ); ++i )
+    {
+        if ( ::IsCasterVisible( lightView, shadowCascade, worldSpheres[ i ] ) )
+        {
+            outVisible.push_back( i );
+        }
+    }
+}
+
+bool ShadowCascades::IsValid( ) const
+{
+    return m_valid;
+}
+
+uint32_t ShadowCascades::NumCascades( ) const
+{
+    return m_desc.NumCascades;
+}
+
+const std::vector<ShadowCascade> &ShadowCascades::GetCascades( ) const
+{
+    return m_cascades;
+}
+
+const ShadowCascadesDesc &ShadowCascades::GetDesc( ) const
+{
+    return m_desc;
+}
+
+void ShadowCascades::ComputeSplits( const float nearPlane, const float farPlane, const uint32_t numCascades, const float lambda, float *outSplitFar )
+{
+    // Practical split scheme, blends logarithmic and uniform distributions
+    for ( uint32_t i = 1; i <= numCascades; ++i )
+    {
+        const float t           = static_cast<float>( i ) / static_cast<float>( numCascades );
+        const float logSplit    = nearPlane * std::pow( farPlane / nearPlane, t );
+        const float uniform     = nearPlane + ( farPlane - nearPlane ) * t;
+        outSplitFar[ i - 1 ] = lambda * logSplit + ( 1.0f - lambda ) * uniform;
+    }
+}
@@ -19,6 +19,7 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 #include "DZEngine/Scene/ComponentSerialization.h"
 
 #include "DZEngine/Components/CameraComponent.h"
+#include "DZEngine/Components/Graphics/LightComponent.h"
 #include "DZEngine/Components/Graphics/MaterialComponent.h"
 #include "DZEngine/Components/Graphics/MeshComponent.h"
 #include "DZEngine/Components/Graphics/RenderableComponent.h"
@@ -96,4 +97,18 @@ void ComponentSerialization::RegisterEngineComponents( flecs::world &world )
         .member( "Projection", &CameraComponent::Projection )
         .member( "ViewProjection", &CameraComponent::ViewProjection )
         .member( "Position", &CameraComponent::Position );
+
+    world.component<DirectionalLightComponent>( ).member( "Color", &DirectionalLightComponent::Color ).member( "Intensity", &DirectionalLightComponent::Intensity );
+
+    world.component<PointLightComponent>( )
+        .member( "Color", &PointLightComponent::Color )
+        .member( "Intensity", &PointLightComponent::Intensity )
+        .member( "Range", &PointLightComponent::Range );
+
+    world.component<SpotLightComponent>( )
+        .member( "Color", &SpotLightComponent::Color )
+        .member( "Intensity", &SpotLightComponent::Intensity )
+        .member( "Range", &SpotLightComponent::Range )
+        .member( "InnerConeAngle", &SpotLightComponent::InnerConeAngle )
+        .member( "OuterConeAngle", &SpotLightComponent::OuterConeAngle );
 }
@@ -74,8 +74,8 @@ flecs::entity Scene::GetRoot( ) const
     return m_root;
 }
 
-bool Scene::LoadFromFile( const std::filesystem::path &filePath )
+bool Scene::LoadFromFile( const std::filesystem::path &filePath, const SceneLoadDesc &desc )
 {
-    const LoadResult result = SceneLoader::LoadSceneFromFile( this, filePath );
+    const LoadResult result = SceneLoader::LoadSceneFromFile( this, filePath, desc );
     return result == LoadResult::Success;
 }
@@ -17,17 +17,41 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 */
 
 #include "DZEngine/Scene/SceneLoader.h"
+#include "DZEngine/Assets/AssetLoader.h"
+#include "DZEngine/Assets/AssetRegistry.h"
+#include "DZEngine/Components/Graphics/MaterialComponent.h"
+#include "DZEngine/Components/Graphics/MeshComponent.h"
 #include "DZEngine/Scene/ComponentSerialization.h"
 #include "DZEngine/Scene/Scene.h"
 
 #include <fstream>
+#include <map>
 #include <nlohmann/json.hpp>
 #include <spdlog/spdlog.h>
+#include <thread>
 
 using namespace DZEngine;
 using json = nlohmann::json;
 
-LoadResult SceneLoader::LoadSceneFromFile( Scene *scene, const std::filesystem::path &filePath )
+namespace
+{
+    struct SceneAsset
+    {
+        AssetLoadType       Type;
+        size_t              BatchId;
+        std::string         Uri;
+        AssetLoadHandle     Load;
+        std::vector<json *> Handles; // Handle objects of the components referencing the asset, remapped once it is loaded
+    };
+
+    // Matches the component names of entity_to_json
+    std::string ComponentName( const flecs::entity component )
+    {
+        return component.path( ".", "" ).c_str( );
+    }
+} // namespace
+
+LoadResult SceneLoader::LoadSceneFromFile( Scene *scene, const std::filesystem::path &filePath, const SceneLoadDesc &desc )
 {
     if ( !scene )
     {
@@ -57,7 +81,7 @@ LoadResult SceneLoader::LoadSceneFromFile( Scene *scene, const std::filesystem::
         return LoadResult::FileOpenError;
     }
 
-    const LoadResult result = LoadSceneFromJson( scene, jsonData );
+    const LoadResult result = LoadSceneFromJson( scene, jsonData, desc );
     if ( result == LoadResult::Success )
     {
         spdlog::info( "Scene loaded from: {}", filePath.string( ) );
@@ -66,7 +90,7 @@ LoadResult SceneLoader::LoadSceneFromFile( Scene *scene, const std::filesystem::
     return result;
 }
 
-LoadResult SceneLoader::LoadSceneFromJson( Scene *scene, const std::string &jsonData )
+LoadResult SceneLoader::LoadSceneFromJson( Scene *scene, const std::string &jsonData, const SceneLoadDesc &desc )
 {
     if ( !scene )
     {
@@ -87,6 +111,13 @@ LoadResult SceneLoader::LoadSceneFromJson( Scene *scene, const std::string &json
 
     ComponentSerialization::RegisterAllComponents( world );
 
+    // The current scene stays alive until the assets of the new one are loaded
+    std::vector<AssetLoadHandle> loads;
+    if ( sceneJson.contains( "entities" ) && sceneJson[ "entities" ].is_array( ) && desc.AssetLoader && desc.AssetRegistry )
+    {
+        loads = PreloadAssets( world, sceneJson[ "entities" ], desc );
+    }
+
     scene->Clear( );
 
     if ( sceneJson.contains( "entities" ) && sceneJson[ "entities" ].is_array( ) )
@@ -98,6 +129,126 @@ LoadResult SceneLoader::LoadSceneFromJson( Scene *scene, const std::string &json
             entity.from_json( entityJsonStr.c_str( ) );
         }
     }
+    for ( const AssetLoadHandle load : loads )
+    {
+        desc.AssetLoader->Release( load );
+    }
 
     return LoadResult::Success;
-}
\ No newline at end of file
+}
+
+std::vector<AssetLoadHandle> SceneLoader::PreloadAssets( flecs::world &world, json &entities, const SceneLoadDesc &desc )
+{
+    const std::string meshComponent     = ComponentName( world.component<MeshComponent>( ) );
+    const std::string materialComponent = ComponentName( world.component<MaterialComponent>( ) );
+
+    // Collect every distinct asset first so that all of them are requested at once
+    std::vector<SceneAsset>                                       assets;
+    std::map<std::tuple<AssetLoadType, size_t, uint32_t>, size_t> assetIndices; // SIZE_MAX when the handle has no uri
+
+    const auto addReference = [ & ]( const AssetLoadType type, const size_t batchId, json &handle )
+    {
+        const uint32_t id = handle.value( "Id", UINT32_MAX );
+        if ( id == UINT32_MAX )
+        {
+            return;
+        }
+        const auto [ it, inserted ] = assetIndices.try_emplace( { type, batchId, id }, assets.size( ) );
+        if ( inserted )
+        {
+            std::string uri;
+            const bool  found = type == AssetLoadType::Mesh ? desc.AssetRegistry->GetMeshAssetUri( batchId, MeshHandle( id ), uri )
+                                                            : desc.AssetRegistry->GetMaterialAssetUri( batchId, MaterialHandle( id ), uri );
+            if ( !found )
+            {
+                // Possibly added by the game itself, the handle is kept as it is
+                spdlog::warn( "SceneLoader::PreloadAssets - No uri registered for handle {} of batch {}", id, batchId );
+                it->second = SIZE_MAX;
+                return;
+            }
+            assets.push_back( SceneAsset{ type, batchId, std::move( uri ) } );
+        }
+        if ( it->second != SIZE_MAX )
+        {
+            assets[ it->second ].Handles.push_back( &handle );
+        }
+    };
+
+    for ( json &entityJson : entities )
+    {
+        const auto components = entityJson.find( "components" );
+        if ( components == entityJson.end( ) || !components->is_object( ) )
+        {
+            continue;
+        }
+
+        size_t batchId = 0;
+        if ( const auto mesh = components->find( meshComponent ); mesh != components->end( ) && mesh->contains( "Handle" ) )
+        {
+            batchId = mesh->value( "BatchId", size_t{ 0 } );
+            addReference( AssetLoadType::Mesh, batchId, ( *mesh )[ "Handle" ] );
+        }
+        // MaterialComponent has no batch of its own, it shares the one of the mesh
+        if ( const auto material = components->find( materialComponent ); material != components->end( ) && material->contains( "Handle" ) )
+        {
+            addReference( AssetLoadType::Material, batchId, ( *material )[ "Handle" ] );
+        }
+    }
+
+    std::vector<AssetLoadHandle> loads;
+    if ( assets.empty( ) )
+    {
+        return loads;
+    }
+
+    for ( SceneAsset &asset : assets )
+    {
+        asset.Load = asset.Type == AssetLoadType::Mesh ? desc.AssetLoader->LoadMesh( asset.BatchId, asset.Uri )
+                                                       : desc.AssetLoader->LoadMaterial( asset.BatchId, asset.Uri, asset.Uri );
+        loads.push_back( asset.Load );
+    }
+
+    SceneLoadProgress progress{ };
+    progress.NumAssets = assets.size( );
+    if ( desc.OnProgress )
+    {
+        desc.OnProgress( progress );
+    }
+    while ( progress.NumCompleted < progress.NumAssets )
+    {
+        desc.AssetLoader->Update( );
+
+        SceneLoadProgress current{ };
+        current.NumAssets = assets.size( );
+        for ( const SceneAsset &asset : assets )
+        {
+            const AssetLoadState state = desc.AssetLoader->GetState( asset.Load );
+            current.NumCompleted += state != AssetLoadState::Pending;
+            current.NumFailed    += state == AssetLoadState::Failed || state == AssetLoadState::Cancelled;
+        }
+        if ( current.NumCompleted != progress.NumCompleted )
+        {
+            progress = current;
+            if ( desc.OnProgress )
+            {
+                desc.OnProgress( progress );
+            }
+            continue;
+        }
+        std::this_thread::yield( );
+    }
+
+    for ( const SceneAsset &asset : assets )
+    {
+        const uint32_t id = asset.Type == AssetLoadType::Mesh ? desc.AssetLoader->GetMesh( asset.Load ).Id : desc.AssetLoader->GetMaterial( asset.Load ).Id;
+        for ( json *handle : asset.Handles )
+        {
+            ( *handle )[ "Id" ] = id;
+        }
+    }
+    if ( progress.NumFailed > 0 )
+    {
+        spdlog::error( "SceneLoader::PreloadAssets - {} of {} assets failed to load", progress.NumFailed, progress.NumAssets );
+    }
+    return loads;
+}
@@ -0,0 +1,55 @@
+/*
+Den Of Iz - Game/Game Engine
+Copyright (c) 2020-2024 Muhammed Murat Cengiz
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <cmath>
+#include <spdlog/spdlog.h>
+
+namespace DZTests
+{
+    /// Failed checks are logged and counted, the test keeps going so a single run reports every failure. main returns Result( ).
+    inline int &NumFailures( )
+    {
+        static int numFailures = 0;
+        return numFailures;
+    }
+
+    inline bool Check( const bool condition, const char *expression, const char *file, const int line )
+    {
+        if ( !condition )
+        {
+            spdlog::error( "{}:{}: Check failed: {}", file, line, expression );
+            NumFailures( )++;
+        }
+        return condition;
+    }
+
+    inline int Result( )
+    {
+        if ( NumFailures( ) > 0 )
+        {
+            spdlog::error( "{} checks failed", NumFailures( ) );
+            return 1;
+        }
+        return 0;
+    }
+} // namespace DZTests
+
+#define DZ_CHECK( condition ) DZTests::Check( static_cast<bool>( condition ), #condition, __FILE__, __LINE__ )
+#define DZ_CHECK_NEAR( a, b, tolerance ) DZTests::Check( std::abs( ( a ) - ( b ) ) <= ( tolerance ), #a " ~ " #b, __FILE__, __LINE__ )
@@ -0,0 +1,401 @@
+/*
+Den Of Iz - Game/Game Engine
+Copyright (c) 2020-2024 Muhammed Murat Cengiz
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <DenOfIzGraphics/DenOfIzGraphics.h>
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace DZTests
+{
+    using namespace DenOfIz;
+
+    /// Buffers live in CPU memory, command lists record buffer copies and a queue runs them when the lists are executed, so fences and semaphores
+    /// are signaled right away. Only what BatchResourceCopy and the geometry code use is implemented, everything else records nothing or returns null.
+    class FakeBuffer final : public IBufferResource
+    {
+        std::vector<Byte> m_data;
+
+    public:
+        explicit FakeBuffer( const BufferDesc &desc ) : m_data( desc.NumBytes )
+        {
+        }
+
+        void *MapMemory( ) override
+        {
+            return m_data.data( );
+        }
+        void UnmapMemory( ) override
+        {
+        }
+        [[nodiscard]] uint32_t InitialState( ) const override
+        {
+            return ResourceUsage::Common;
+        }
+        [[nodiscard]] size_t NumBytes( ) const override
+        {
+            return m_data.size( );
+        }
+        [[nodiscard]] const void *Data( ) const override
+        {
+            return m_data.data( );
+        }
+        [[nodiscard]] ByteArray GetData( ) const override
+        {
+            return ByteArray{ const_cast<Byte *>( m_data.data( ) ), m_data.size( ) };
+        }
+        void SetData( const ByteArrayView &data, bool ) override
+        {
+            memcpy( m_data.data( ), data.Elements, std::min( data.NumElements, m_data.size( ) ) );
+        }
+        void WriteData( const ByteArrayView &data, const uint32_t bufferOffset ) override
+        {
+            memcpy( m_data.data( ) + bufferOffset, data.Elements, std::min<size_t>( data.NumElements, m_data.size( ) - bufferOffset ) );
+        }
+
+        [[nodiscard]] Byte *Bytes( )
+        {
+            return m_data.data( );
+        }
+    };
+
+    class FakeCommandList final : public ICommandList
+    {
+        QueueType                         m_queueType;
+        std::vector<CopyBufferRegionDesc> m_copies;
+
+    public:
+        explicit FakeCommandList( const QueueType queueType ) : m_queueType( queueType )
+        {
+        }
+
+        // Copies within one buffer may overlap when a range slides towards the start of the buffer
+        void Execute( ) const
+        {
+            for ( const CopyBufferRegionDesc &copy : m_copies )
+            {
+                Byte *dst = static_cast<FakeBuffer *>( copy.DstBuffer )->Bytes( ) + copy.DstOffset;
+                Byte *src = static_cast<FakeBuffer *>( copy.SrcBuffer )->Bytes( ) + copy.SrcOffset;
+                memmove( dst, src, copy.NumBytes );
+            }
+        }
+        [[nodiscard]] size_t NumCopies( ) const
+        {
+            return m_copies.size( );
+        }
+
+        void Begin( ) override
+        {
+            m_copies.clear( );
+        }
+        void CopyBufferRegion( const CopyBufferRegionDesc &copyBufferRegionDesc ) override
+        {
+            m_copies.push_back( copyBufferRegionDesc );
+        }
+        const QueueType GetQueueType( ) override
+        {
+            return m_queueType;
+        }
+
+        void BeginRendering( const RenderingDesc & ) override
+        {
+        }
+        void EndRendering( ) override
+        {
+        }
+        void End( ) override
+        {
+        }
+        void BindPipeline( IPipeline * ) override
+        {
+        }
+        void BindVertexBuffer( IBufferResource *, uint64_t, uint32_t, uint32_t ) override
+        {
+        }
+        void BindIndexBuffer( IBufferResource *, const IndexType &, uint64_t ) override
+        {
+        }
+        void BindViewport( float, float, float, float ) override
+        {
+        }
+        void BindScissorRect( float, float, float, float ) override
+        {
+        }
+        void BindResourceGroup( IResourceBindGroup * ) override
+        {
+        }
+        void PipelineBarrier( const PipelineBarrierDesc & ) override
+        {
+        }
+        void DrawIndexed( uint32_t, uint32_t, uint32_t, uint32_t, uint32_t ) override
+        {
+        }
+        void Draw( uint32_t, uint32_t, uint32_t, uint32_t ) override
+        {
+        }
+        void CopyTextureRegion( const CopyTextureRegionDesc & ) override
+        {
+        }
+        void CopyBufferToTexture( const CopyBufferToTextureDesc & ) override
+        {
+        }
+        void CopyTextureToBuffer( const CopyTextureToBufferDesc & ) override
+        {
+        }
+        void UpdateTopLevelAS( const UpdateTopLevelASDesc & ) override
+        {
+        }
+        void BuildTopLevelAS( const BuildTopLevelASDesc & ) override
+        {
+        }
+        void BuildBottomLevelAS( const BuildBottomLevelASDesc & ) override
+        {
+        }
+        void DispatchRays( const DispatchRaysDesc & ) override
+        {
+        }
+        void Dispatch( uint32_t, uint32_t, uint32_t ) override
+        {
+        }
+        void DispatchMesh( uint32_t, uint32_t, uint32_t ) override
+        {
+        }
+        void DrawIndirect( IBufferResource *, uint64_t, uint32_t, uint32_t ) override
+        {
+        }
+        void DrawIndexedIndirect( IBufferResource *, uint64_t, uint32_t, uint32_t ) override
+        {
+        }
+        void DispatchIndirect( IBufferResource *, uint64_t ) override
+        {
+        }
+        void BeginDebugMarker( float, float, float, StringView ) override
+        {
+        }
+        void EndDebugMarker( ) override
+        {
+        }
+        void InsertDebugMarker( float, float, float, StringView ) override
+        {
+        }
+        void BeginQuery( IQueryPool *, const QueryDesc & ) override
+        {
+        }
+        void EndQuery( IQueryPool *, const QueryDesc & ) override
+        {
+        }
+        void ResolveQuery( IQueryPool *, uint32_t, uint32_t ) override
+        {
+        }
+        void ResetQuery( IQueryPool *, uint32_t, uint32_t ) override
+        {
+        }
+    };
+
+    class FakeCommandListPool final : public ICommandListPool
+    {
+        std::vector<std::unique_ptr<FakeCommandList>> m_commandLists;
+        std::vector<ICommandList *>                   m_elements;
+
+    public:
+        FakeCommandListPool( const QueueType queueType, const uint32_t numCommandLists )
+        {
+            for ( uint32_t i = 0; i < numCommandLists; ++i )
+            {
+                m_elements.push_back( m_commandLists.emplace_back( std::make_unique<FakeCommandList>( queueType ) ).get( ) );
+            }
+        }
+
+        ICommandListArray GetCommandLists( ) override
+        {
+            return ICommandListArray{ m_elements.data( ), static_cast<uint32_t>( m_elements.size( ) ) };
+        }
+    };
+
+    class FakeFence final : public IFence
+    {
+    public:
+        void Wait( ) override
+        {
+        }
+        void Reset( ) override
+        {
+        }
+    };
+
+    class FakeSemaphore final : public ISemaphore
+    {
+        std::atomic<bool> m_completed = false;
+
+    public:
+        void Notify( ) override
+        {
+            m_completed = true;
+        }
+        [[nodiscard]] bool IsCompleted( ) const override
+        {
+            return m_completed;
+        }
+    };
+
+    struct FakeDeviceStats
+    {
+        size_t NumExecutedLists;
+        size_t NumExecutedCopies;
+    };
+
+    class FakeCommandQueue final : public ICommandQueue
+    {
+        QueueType        m_queueType;
+        std::mutex      &m_executeLock;
+        FakeDeviceStats &m_stats;
+
+    public:
+        FakeCommandQueue( const QueueType queueType, std::mutex &executeLock, FakeDeviceStats &stats ) : m_queueType( queueType ), m_executeLock( executeLock ), m_stats( stats )
+        {
+        }
+
+        void WaitIdle( ) override
+        {
+        }
+        // Every queue of the device executes under one lock, like a GPU that never overlaps two submissions
+        void ExecuteCommandLists( const ExecuteCommandListsDesc &executeCommandListsDesc ) override
+        {
+            std::lock_guard lock( m_executeLock );
+            for ( uint32_t i = 0; i < executeCommandListsDesc.CommandLists.NumElements; ++i )
+            {
+                const auto *commandList = static_cast<const FakeCommandList *>( executeCommandListsDesc.CommandLists.Elements[ i ] );
+                commandList->Execute( );
+                m_stats.NumExecutedLists++;
+                m_stats.NumExecutedCopies += commandList->NumCopies( );
+            }
+            for ( size_t i = 0; i < executeCommandListsDesc.SignalSemaphores.NumElements; ++i )
+            {
+                executeCommandListsDesc.SignalSemaphores.Elements[ i ]->Notify( );
+            }
+        }
+    };
+
+    class FakeLogicalDevice final : public ILogicalDevice
+    {
+        std::mutex      m_executeLock;
+        FakeDeviceStats m_stats{ };
+
+    public:
+        [[nodiscard]] FakeDeviceStats GetStats( )
+        {
+            std::lock_guard lock( m_executeLock );
+            return m_stats;
+        }
+
+        ICommandQueue *CreateCommandQueue( const CommandQueueDesc &desc ) override
+        {
+            return new FakeCommandQueue( desc.QueueType, m_executeLock, m_stats );
+        }
+        ICommandListPool *CreateCommandListPool( const CommandListPoolDesc &desc ) override
+        {
+            return new FakeCommandListPool( QueueType::Copy, desc.NumCommandLists );
+        }
+        IFence *CreateFence( ) override
+        {
+            return new FakeFence( );
+        }
+        ISemaphore *CreateSemaphore( ) override
+        {
+            return new FakeSemaphore( );
+        }
+        IBufferResource *CreateBufferResource( const BufferDesc &desc ) override
+        {
+            return new FakeBuffer( desc );
+        }
+
+        void CreateDevice( const LogicalDeviceDesc & ) override
+        {
+        }
+        PhysicalDeviceArray ListPhysicalDevices( ) override
+        {
+            return PhysicalDeviceArray{ nullptr, 0 };
+        }
+        void LoadPhysicalDevice( const PhysicalDevice & ) override
+        {
+        }
+        bool IsDeviceLost( ) override
+        {
+            return false;
+        }
+        void WaitIdle( ) override
+        {
+        }
+        IPipeline *CreatePipeline( const PipelineDesc & ) override
+        {
+            return nullptr;
+        }
+        ISwapChain *CreateSwapChain( const SwapChainDesc & ) override
+        {
+            return nullptr;
+        }
+        IRootSignature *CreateRootSignature( const RootSignatureDesc & ) override
+        {
+            return nullptr;
+        }
+        IInputLayout *CreateInputLayout( const InputLayoutDesc & ) override
+        {
+            return nullptr;
+        }
+        IResourceBindGroup *CreateResourceBindGroup( const ResourceBindGroupDesc & ) override
+        {
+            return nullptr;
+        }
+        ITextureResource *CreateTextureResource( const TextureDesc & ) override
+        {
+            return nullptr;
+        }
+        ISampler *CreateSampler( const SamplerDesc & ) override
+        {
+            return nullptr;
+        }
+        IQueryPool *CreateQueryPool( const QueryPoolDesc & ) override
+        {
+            return nullptr;
+        }
+        ITopLevelAS *CreateTopLevelAS( const TopLevelASDesc & ) override
+        {
+            return nullptr;
+        }
+        IBottomLevelAS *CreateBottomLevelAS( const BottomLevelASDesc & ) override
+        {
+            return nullptr;
+        }
+        IShaderBindingTable *CreateShaderBindingTable( const ShaderBindingTableDesc & ) override
+        {
+            return nullptr;
+        }
+        ILocalRootSignature *CreateLocalRootSignature( const LocalRootSignatureDesc & ) override
+        {
+            return nullptr;
+        }
+        IShaderLocalData *CreateShaderLocalData( const ShaderLocalDataDesc & ) override
+        {
+            return nullptr;
+        }
+    };
+} // namespace DZTests
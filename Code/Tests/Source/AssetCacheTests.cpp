@@ -0,0 +1,235 @@
+/*
+Den Of Iz - Game/Game Engine
+Copyright (c) 2020-2024 Muhammed Murat Cengiz
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include "DZEngine/Assets/AssetCache.h"
+#include "DZTests/Check.h"
+
+using namespace DZEngine;
+
+namespace
+{
+    constexpr uint32_t NumThreads = 16;
+
+    std::string MeshUri( const uint32_t index )
+    {
+        return "assets://mesh" + std::to_string( index );
+    }
+
+    // Concurrent Acquires of a uri load it once and share the published handle
+    void ConcurrentAcquire( )
+    {
+        AssetCache               cache;
+        std::atomic<uint32_t>    numLoads = 0;
+        std::vector<uint32_t>    ids( NumThreads, UINT32_MAX );
+        std::vector<std::thread> threads;
+        for ( uint32_t i = 0; i < NumThreads; ++i )
+        {
+            threads.emplace_back(
+                [ &, i ]
+                {
+                    if ( cache.Acquire( AssetRegistryType::Mesh, 0, "assets://shared", ids[ i ] ) )
+                    {
+                        ++numLoads;
+                        std::this_thread::sleep_for( std::chrono::milliseconds( 20 ) );
+                        cache.Publish( AssetRegistryType::Mesh, 0, "assets://shared", 7, 100 );
+                        ids[ i ] = 7;
+                    }
+                } );
+        }
+        for ( std::thread &thread : threads )
+        {
+            thread.join( );
+        }
+
+        DZ_CHECK( numLoads == 1 );
+        for ( const uint32_t id : ids )
+        {
+            DZ_CHECK( id == 7 );
+        }
+        DZ_CHECK( cache.GetNumReferences( AssetRegistryType::Mesh, 0, 7 ) == NumThreads );
+        DZ_CHECK( cache.GetStats( AssetRegistryType::Mesh ).NumResidentBytes == 100 );
+
+        // The same uri in another batch is a separate asset
+        uint32_t id = UINT32_MAX;
+        DZ_CHECK( cache.Acquire( AssetRegistryType::Mesh, 1, "assets://shared", id ) );
+        cache.Publish( AssetRegistryType::Mesh, 1, "assets://shared", 3 );
+        size_t batchId = SIZE_MAX;
+        DZ_CHECK( cache.FindAny( AssetRegistryType::Mesh, "assets://shared", batchId, id ) );
+        DZ_CHECK( cache.GetNumEntries( ) == 2 );
+    }
+
+    // A failed load isn't cached, the next Acquire loads again
+    void FailedLoad( )
+    {
+        AssetCache cache;
+        uint32_t   id = 0;
+        DZ_CHECK( cache.Acquire( AssetRegistryType::Texture, 0, "assets://texture", id ) );
+        cache.Publish( AssetRegistryType::Texture, 0, "assets://texture", UINT32_MAX );
+        DZ_CHECK( !cache.TryAcquire( AssetRegistryType::Texture, 0, "assets://texture", id ) );
+        size_t batchId = 0;
+        DZ_CHECK( !cache.FindAny( AssetRegistryType::Texture, "assets://texture", batchId, id ) );
+
+        DZ_CHECK( cache.Acquire( AssetRegistryType::Texture, 0, "assets://texture", id ) );
+        cache.Publish( AssetRegistryType::Texture, 0, "assets://texture", 3 );
+        DZ_CHECK( cache.TryAcquire( AssetRegistryType::Texture, 0, "assets://texture", id ) && id == 3 );
+        DZ_CHECK( cache.GetNumReferences( AssetRegistryType::Texture, 0, 3 ) == 2 );
+        DZ_CHECK( cache.Release( AssetRegistryType::Texture, 0, 3 ) == 1 );
+
+        // Releasing what isn't cached or has no references left is a no op
+        DZ_CHECK( cache.Release( AssetRegistryType::Texture, 0, 42 ) == 0 );
+        DZ_CHECK( cache.Release( AssetRegistryType::Texture, 0, 3 ) == 0 );
+        DZ_CHECK( cache.Release( AssetRegistryType::Texture, 0, 3 ) == 0 );
+        DZ_CHECK( cache.Retain( AssetRegistryType::Texture, 0, 42 ) == 0 );
+    }
+
+    // Only unreferenced assets are evicted, least recently released first and only while their type is over its budget
+    void EvictLeastRecentlyReleased( )
+    {
+        AssetCache                 cache;
+        std::vector<AssetCacheKey> evicted;
+        cache.SetBudget( AssetRegistryType::Mesh, 250 );
+        for ( uint32_t i = 0; i < 4; ++i )
+        {
+            cache.Add( AssetRegistryType::Mesh, 0, MeshUri( i ), i, 1, 100 );
+        }
+        cache.Evict( evicted );
+        DZ_CHECK( evicted.empty( ) );
+        DZ_CHECK( cache.GetStats( AssetRegistryType::Mesh ).NumResidentBytes == 400 );
+
+        cache.Release( AssetRegistryType::Mesh, 0, 2 );
+        cache.Release( AssetRegistryType::Mesh, 0, 0 );
+        cache.Release( AssetRegistryType::Mesh, 0, 3 );
+        AssetCacheStats stats = cache.GetStats( AssetRegistryType::Mesh );
+        DZ_CHECK( stats.NumUnreferenced == 3 );
+        DZ_CHECK( stats.NumUnreferencedBytes == 300 );
+
+        cache.Evict( evicted );
+        DZ_CHECK( evicted.size( ) == 2 && evicted[ 0 ] == ( AssetCacheKey{ AssetRegistryType::Mesh, 0, 2 } ) && evicted[ 1 ].Id == 0 );
+        stats = cache.GetStats( AssetRegistryType::Mesh );
+        DZ_CHECK( stats.NumResidentBytes == 200 );
+        DZ_CHECK( stats.NumAssets == 2 );
+        DZ_CHECK( stats.NumUnreferenced == 1 );
+        DZ_CHECK( stats.NumEvicted == 2 );
+
+        // An evicted asset is gone, a cached unreferenced one is revived instead of loaded again
+        uint32_t id = UINT32_MAX;
+        DZ_CHECK( !cache.TryAcquire( AssetRegistryType::Mesh, 0, MeshUri( 2 ), id ) );
+        DZ_CHECK( cache.TryAcquire( AssetRegistryType::Mesh, 0, MeshUri( 3 ), id ) && id == 3 );
+        stats = cache.GetStats( AssetRegistryType::Mesh );
+        DZ_CHECK( stats.NumUnreferenced == 0 );
+        DZ_CHECK( stats.NumUnreferencedBytes == 0 );
+
+        // Released again it moves to the back, the older release goes first
+        cache.Add( AssetRegistryType::Mesh, 0, MeshUri( 4 ), 4, 1, 100 );
+        cache.Release( AssetRegistryType::Mesh, 0, 4 );
+        cache.Release( AssetRegistryType::Mesh, 0, 3 );
+        cache.SetBudget( AssetRegistryType::Mesh, 150 );
+        evicted.clear( );
+        cache.Evict( evicted );
+        DZ_CHECK( evicted.size( ) == 2 && evicted[ 0 ].Id == 4 && evicted[ 1 ].Id == 3 );
+        DZ_CHECK( cache.GetStats( AssetRegistryType::Mesh ).NumResidentBytes == 100 );
+
+        // Other types keep their default budget of 0 and aren't affected by the mesh budget
+        cache.Add( AssetRegistryType::Texture, 0, "assets://texture", 5, 0, 10 );
+        evicted.clear( );
+        cache.Evict( evicted );
+        DZ_CHECK( evicted.size( ) == 1 && evicted[ 0 ] == ( AssetCacheKey{ AssetRegistryType::Texture, 0, 5 } ) );
+        DZ_CHECK( cache.GetNumEntries( ) == 1 );
+    }
+
+    // An evicted asset releases its dependencies, a material and the texture it held go in the same Evict
+    void EvictDependencies( )
+    {
+        AssetCache                 cache;
+        std::vector<AssetCacheKey> evicted;
+        const AssetCacheKey        texture{ AssetRegistryType::Texture, 0, 7 };
+        const AssetCacheKey        material{ AssetRegistryType::Material, 0, 9 };
+        cache.Add( texture.Type, 0, "assets://texture", texture.Id, 1, 50 );
+        cache.Add( material.Type, 0, "assets://material", material.Id, 1, 10 );
+        DZ_CHECK( cache.SetDependencies( material.Type, 0, material.Id, { texture } ) );
+        DZ_CHECK( !cache.SetDependencies( material.Type, 0, material.Id, { texture } ) );
+        DZ_CHECK( !cache.SetDependencies( material.Type, 0, 1234, { texture } ) );
+
+        cache.Evict( evicted );
+        DZ_CHECK( evicted.empty( ) );
+
+        cache.Release( material.Type, 0, material.Id );
+        cache.Evict( evicted );
+        DZ_CHECK( evicted.size( ) == 2 && evicted[ 0 ] == material && evicted[ 1 ] == texture );
+        DZ_CHECK( cache.GetNumEntries( ) == 0 );
+
+        // A dependency that is still referenced elsewhere stays
+        cache.Add( texture.Type, 0, "assets://texture", texture.Id, 2, 50 );
+        cache.Add( material.Type, 0, "assets://material", material.Id, 1, 10 );
+        cache.SetDependencies( material.Type, 0, material.Id, { texture } );
+        cache.Release( material.Type, 0, material.Id );
+        evicted.clear( );
+        cache.Evict( evicted );
+        DZ_CHECK( evicted.size( ) == 1 && evicted[ 0 ] == material );
+        DZ_CHECK( cache.GetNumReferences( texture.Type, 0, texture.Id ) == 1 );
+    }
+
+    // A reload keeps the handle, updates the resident bytes and swaps the dependencies without dropping the shared ones
+    void Reload( )
+    {
+        AssetCache                 cache;
+        std::vector<AssetCacheKey> evicted;
+        const AssetCacheKey        shared{ AssetRegistryType::Texture, 0, 1 };
+        const AssetCacheKey        previous{ AssetRegistryType::Texture, 0, 2 };
+        const AssetCacheKey        next{ AssetRegistryType::Texture, 0, 3 };
+        const AssetCacheKey        material{ AssetRegistryType::Material, 0, 9 };
+        cache.Add( shared.Type, 0, "assets://shared", shared.Id, 1, 10 );
+        cache.Add( previous.Type, 0, "assets://previous", previous.Id, 1, 10 );
+        cache.Add( material.Type, 0, "assets://material", material.Id, 1, 10 );
+        cache.SetDependencies( material.Type, 0, material.Id, { shared, previous } );
+
+        cache.Add( next.Type, 0, "assets://next", next.Id, 1, 10 );
+        cache.Retain( shared.Type, 0, shared.Id );
+        DZ_CHECK( cache.Reload( material.Type, 0, material.Id, 30, { shared, next } ) );
+        DZ_CHECK( !cache.Reload( material.Type, 0, 1234, 30, { } ) );
+        DZ_CHECK( cache.GetStats( AssetRegistryType::Material ).NumResidentBytes == 30 );
+        DZ_CHECK( cache.GetNumReferences( shared.Type, 0, shared.Id ) == 1 );
+        DZ_CHECK( cache.GetNumReferences( previous.Type, 0, previous.Id ) == 0 );
+
+        cache.Evict( evicted );
+        DZ_CHECK( evicted.size( ) == 1 && evicted[ 0 ] == previous );
+
+        cache.Release( material.Type, 0, material.Id );
+        evicted.clear( );
+        cache.Evict( evicted );
+        DZ_CHECK( evicted.size( ) == 3 && evicted[ 0 ] == material );
+        DZ_CHECK( cache.GetNumEntries( ) == 0 );
+        DZ_CHECK( cache.GetStats( AssetRegistryType::Texture ).NumResidentBytes == 0 );
+        DZ_CHECK( cache.GetStats( AssetRegistryType::Texture ).NumEvicted == 3 );
+    }
+} // namespace
+
+int main( )
+{
+    ConcurrentAcquire( );
+    FailedLoad( );
+    EvictLeastRecentlyReleased( );
+    EvictDependencies( );
+    Reload( );
+    return DZTests::Result( );
+}
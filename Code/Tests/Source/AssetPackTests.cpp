@@ -0,0 +1,154 @@
+/*
+Den Of Iz - Game/Game Engine
+Copyright (c) 2020-2024 Muhammed Murat Cengiz
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+#include "DZEngine/Assets/AssetPack.h"
+#include "DZTests/Check.h"
+
+using namespace DZEngine;
+
+namespace
+{
+    std::filesystem::path TestDirectory( )
+    {
+        return std::filesystem::temp_directory_path( ) / "DZAssetPackTests";
+    }
+
+    void WriteFile( const std::filesystem::path &path, const std::vector<Byte> &bytes )
+    {
+        std::filesystem::create_directories( path.parent_path( ) );
+        std::ofstream file( path, std::ios::binary | std::ios::trunc );
+        file.write( reinterpret_cast<const char *>( bytes.data( ) ), static_cast<std::streamsize>( bytes.size( ) ) );
+    }
+
+    std::vector<Byte> Compressible( const size_t numBytes )
+    {
+        std::vector<Byte> bytes( numBytes );
+        for ( size_t i = 0; i < numBytes; ++i )
+        {
+            bytes[ i ] = static_cast<Byte>( "vertex normal texcoord "[ i % 23 ] );
+        }
+        return bytes;
+    }
+
+    std::vector<Byte> Random( const size_t numBytes )
+    {
+        std::mt19937      random( 7 );
+        std::vector<Byte> bytes( numBytes );
+        for ( Byte &byte : bytes )
+        {
+            byte = static_cast<Byte>( random( ) );
+        }
+        return bytes;
+    }
+
+    struct TestAsset
+    {
+        std::string       Path;
+        std::vector<Byte> Bytes;
+    };
+
+    std::vector<TestAsset> TestAssets( )
+    {
+        return { { "Materials/Brick.dzmat", Compressible( 3000 ) },
+                 { "Meshes/Cube.dzmesh", Compressible( 200000 ) },
+                 { "Meshes/Empty.dzmesh", { } },
+                 { "Textures/Noise.dztex", Random( 70000 ) } };
+    }
+
+    void CheckPack( const std::filesystem::path &packPath, const std::vector<TestAsset> &assets )
+    {
+        const AssetPack pack( packPath );
+        DZ_CHECK( pack.IsValid( ) );
+
+        std::vector<std::string> expectedPaths;
+        for ( const TestAsset &asset : assets )
+        {
+            expectedPaths.push_back( asset.Path );
+            DZ_CHECK( pack.Contains( asset.Path ) );
+            DZ_CHECK( pack.GetAssetNumBytes( asset.Path ) == asset.Bytes.size( ) );
+
+            std::vector<Byte> bytes( asset.Bytes.size( ) );
+            DZ_CHECK( pack.ReadAsset( asset.Path, bytes.data( ), bytes.size( ) ) );
+            DZ_CHECK( bytes == asset.Bytes );
+        }
+        std::vector<std::string> paths = pack.GetAssetPaths( );
+        std::ranges::sort( paths );
+        DZ_CHECK( paths == expectedPaths );
+        DZ_CHECK( !pack.Contains( "Meshes/Missing.dzmesh" ) );
+    }
+
+    // Every asset reads back from the pack, whether it was stored compressed, raw because it didn't shrink, or empty
+    void BuildAndRead( )
+    {
+        const std::filesystem::path  assetsDirectory = TestDirectory( ) / "Assets";
+        const std::vector<TestAsset> assets          = TestAssets( );
+        for ( const TestAsset &asset : assets )
+        {
+            WriteFile( assetsDirectory / asset.Path, asset.Bytes );
+        }
+
+        for ( const BlockCompressionCodec codec : { BlockCompressionCodec::None, BlockCompressionCodec::LZ4, BlockCompressionCodec::Zstd } )
+        {
+            AssetPackBuildDesc desc{ };
+            desc.AssetsDirectory   = assetsDirectory;
+            desc.OutputPath        = TestDirectory( ) / ( std::string( "Assets" ) + AssetPack::Extension );
+            desc.Compression.Codec = codec;
+            DZ_CHECK( AssetPack::Build( desc ) );
+            CheckPack( desc.OutputPath, assets );
+
+            const AssetPack pack( desc.OutputPath );
+            DZ_CHECK( pack.GetAssetStoredNumBytes( "Textures/Noise.dztex" ) == 70000 );
+            DZ_CHECK( codec == BlockCompressionCodec::None || pack.GetAssetStoredNumBytes( "Meshes/Cube.dzmesh" ) < 200000 / 10 );
+        }
+    }
+
+    // A pack written into the assets directory, earlier packs and temporary files are left out, rebuilding doesn't nest the previous pack
+    void SkipPacksAndTemporaryFiles( )
+    {
+        const std::filesystem::path  assetsDirectory = TestDirectory( ) / "Assets";
+        const std::vector<TestAsset> assets          = TestAssets( );
+        WriteFile( assetsDirectory / ( std::string( "Old" ) + AssetPack::Extension ), Random( 5000 ) );
+        WriteFile( assetsDirectory / "Meshes/Cube.dzmesh.tmp", Random( 5000 ) );
+
+        AssetPackBuildDesc desc{ };
+        desc.AssetsDirectory = assetsDirectory;
+        desc.OutputPath      = assetsDirectory / ".." / "Assets" / ( std::string( "Assets" ) + AssetPack::Extension );
+        DZ_CHECK( AssetPack::Build( desc ) );
+        const uintmax_t numBytes = std::filesystem::file_size( desc.OutputPath );
+        CheckPack( desc.OutputPath, assets );
+
+        DZ_CHECK( AssetPack::Build( desc ) );
+        DZ_CHECK( std::filesystem::file_size( desc.OutputPath ) == numBytes );
+        CheckPack( desc.OutputPath, assets );
+    }
+} // namespace
+
+int main( )
+{
+    std::filesystem::remove_all( TestDirectory( ) );
+    BuildAndRead( );
+    SkipPacksAndTemporaryFiles( );
+    std::filesystem::remove_all( TestDirectory( ) );
+    return DZTests::Result( );
+}
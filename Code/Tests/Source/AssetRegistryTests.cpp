@@ -0,0 +1,201 @@
+/*
+Den Of Iz - Game/Game Engine
+Copyright (c) 2020-2024 Muhammed Murat Cengiz
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <vector>
+#include "DZEngine/Assets/AssetRegistry.h"
+#include "DZTests/Check.h"
+
+using namespace DZEngine;
+
+namespace
+{
+    constexpr uint32_t NumMeshes = 300;
+
+    std::filesystem::path TestDirectory( )
+    {
+        const std::filesystem::path directory = std::filesystem::temp_directory_path( ) / "DZAssetRegistryTests";
+        std::filesystem::create_directories( directory );
+        return directory;
+    }
+
+    std::string MeshUri( const uint32_t index )
+    {
+        return "assets://models/mesh" + std::to_string( index ) + ".dzmesh";
+    }
+
+    std::vector<Byte> ReadBytes( const std::filesystem::path &path )
+    {
+        std::ifstream     file( path, std::ios::binary );
+        std::vector<Byte> bytes( std::filesystem::file_size( path ) );
+        file.read( reinterpret_cast<char *>( bytes.data( ) ), static_cast<std::streamsize>( bytes.size( ) ) );
+        return bytes;
+    }
+
+    void WriteBytes( const std::filesystem::path &path, const std::vector<Byte> &bytes )
+    {
+        std::ofstream file( path, std::ios::binary | std::ios::trunc );
+        file.write( reinterpret_cast<const char *>( bytes.data( ) ), static_cast<std::streamsize>( bytes.size( ) ) );
+    }
+
+    // Every third mesh is unregistered, so the tables hold removed slots too
+    AssetRegistry BuildRegistry( )
+    {
+        AssetRegistry registry;
+        for ( uint32_t i = 0; i < NumMeshes; ++i )
+        {
+            registry.RegisterMeshAsset( 0, MeshHandle{ i }, MeshUri( i ) );
+        }
+        for ( uint32_t i = 0; i < NumMeshes; i += 3 )
+        {
+            registry.Unregister( AssetRegistryType::Mesh, 0, i );
+        }
+        registry.Register( AssetRegistryType::Material, 2, 5, "assets://materials/brick.dzmat" );
+        registry.Register( AssetRegistryType::Texture, 2, 5, "assets://textures/brick.dztex" );
+        // The same uri in another batch is interned once
+        registry.Register( AssetRegistryType::Mesh, 3, 1, MeshUri( 1 ) );
+        return registry;
+    }
+
+    void CheckRegistry( const AssetRegistry &registry )
+    {
+        DZ_CHECK( registry.GetNumEntries( ) == NumMeshes - NumMeshes / 3 + 3 );
+        for ( uint32_t i = 0; i < NumMeshes; ++i )
+        {
+            std::string uri;
+            MeshHandle  handle{ };
+            DZ_CHECK( registry.GetMeshAssetUri( 0, MeshHandle{ i }, uri ) == ( i % 3 != 0 ) );
+            DZ_CHECK( registry.FindMeshAsset( 0, MeshUri( i ), handle ) == ( i % 3 != 0 ) );
+            if ( i % 3 != 0 )
+            {
+                DZ_CHECK( uri == MeshUri( i ) );
+                DZ_CHECK( handle.Id == i );
+            }
+        }
+
+        std::string_view uri;
+        uint32_t         handleId = 0;
+        DZ_CHECK( registry.GetUri( AssetRegistryType::Material, 2, 5, uri ) && uri == "assets://materials/brick.dzmat" );
+        DZ_CHECK( registry.GetUri( AssetRegistryType::Texture, 2, 5, uri ) && uri == "assets://textures/brick.dztex" );
+        DZ_CHECK( registry.Find( AssetRegistryType::Mesh, 3, MeshUri( 1 ), handleId ) && handleId == 1 );
+        DZ_CHECK( !registry.GetUri( AssetRegistryType::Material, 0, 5, uri ) );
+        DZ_CHECK( !registry.Find( AssetRegistryType::Texture, 2, "assets://textures/missing.dztex", handleId ) );
+    }
+
+    // JSON imported and saved as binary maps back to the same lookups, and stays usable once modified
+    void JsonToBinaryRoundTrip( )
+    {
+        const std::filesystem::path directory  = TestDirectory( );
+        const std::filesystem::path jsonPath   = directory / "Registry.json";
+        const std::filesystem::path binaryPath = directory / ( std::string( "Registry" ) + AssetRegistry::BinaryExtension );
+
+        AssetRegistry source = BuildRegistry( );
+        CheckRegistry( source );
+        DZ_CHECK( source.SaveToFile( jsonPath ) );
+
+        AssetRegistry imported;
+        DZ_CHECK( imported.LoadFromFile( jsonPath ) );
+        CheckRegistry( imported );
+        DZ_CHECK( imported.SaveToFile( binaryPath ) );
+
+        AssetRegistry mapped;
+        DZ_CHECK( mapped.LoadFromFile( binaryPath ) );
+        CheckRegistry( mapped );
+
+        mapped.Register( AssetRegistryType::Skeleton, 1, 9, "assets://skeletons/hero.dzskel" );
+        std::string_view uri;
+        DZ_CHECK( mapped.GetUri( AssetRegistryType::Skeleton, 1, 9, uri ) && uri == "assets://skeletons/hero.dzskel" );
+        mapped.Unregister( AssetRegistryType::Skeleton, 1, 9 );
+        CheckRegistry( mapped );
+    }
+
+    // Tables that would read out of bounds or never end a probe sequence are rejected instead of mapped
+    void RejectCorruptBinary( )
+    {
+        const std::filesystem::path directory  = TestDirectory( );
+        const std::filesystem::path binaryPath = directory / ( std::string( "Registry" ) + AssetRegistry::BinaryExtension );
+        const std::filesystem::path corrupt    = directory / ( std::string( "Corrupt" ) + AssetRegistry::BinaryExtension );
+        DZ_CHECK( BuildRegistry( ).SaveToFile( binaryPath ) );
+
+        const std::vector<Byte> bytes = ReadBytes( binaryPath );
+        AssetRegistryHeader     header{ };
+        std::memcpy( &header, bytes.data( ), sizeof( header ) );
+
+        const auto loads = [ & ]( const std::function<void( std::vector<Byte> & )> &modify )
+        {
+            std::vector<Byte> copy = bytes;
+            modify( copy );
+            WriteBytes( corrupt, copy );
+            AssetRegistry registry;
+            return registry.LoadFromFile( corrupt );
+        };
+        const auto handleSlots = [ & ]( std::vector<Byte> &data ) { return reinterpret_cast<AssetRegistrySlot *>( data.data( ) + header.HandleSlotsOffset ); };
+        const auto usedSlot    = [ & ]( std::vector<Byte> &data ) -> AssetRegistrySlot &
+        {
+            AssetRegistrySlot *slot = handleSlots( data );
+            while ( slot->Value == AssetRegistrySlot::Empty || slot->Value == AssetRegistrySlot::Removed )
+            {
+                ++slot;
+            }
+            return *slot;
+        };
+
+        DZ_CHECK( loads( []( std::vector<Byte> & ) { } ) );
+        DZ_CHECK( !loads( []( std::vector<Byte> &data ) { data.pop_back( ); } ) );
+        DZ_CHECK( !loads( [ & ]( std::vector<Byte> &data ) { usedSlot( data ).Value = header.NumUris; } ) );
+        DZ_CHECK( !loads( [ & ]( std::vector<Byte> &data ) { usedSlot( data ).Type = AssetRegistryType::Count; } ) );
+        DZ_CHECK( !loads(
+            [ & ]( std::vector<Byte> &data )
+            {
+                auto *uris                        = reinterpret_cast<AssetRegistryUri *>( data.data( ) + header.UrisOffset );
+                uris[ header.NumUris - 1 ].Offset = static_cast<uint32_t>( header.UriDataNumBytes );
+            } ) );
+        DZ_CHECK( !loads(
+            [ & ]( std::vector<Byte> &data )
+            {
+                auto *internSlots = reinterpret_cast<uint32_t *>( data.data( ) + header.InternSlotsOffset );
+                for ( uint32_t i = 0; i < header.NumInternSlots; ++i )
+                {
+                    internSlots[ i ] = internSlots[ i ] == UINT32_MAX ? UINT32_MAX : header.NumUris;
+                }
+            } ) );
+        // Without an empty slot a lookup of a missing key never ends, even with matching counts
+        DZ_CHECK( !loads(
+            [ & ]( std::vector<Byte> &data )
+            {
+                AssetRegistrySlot *slots = handleSlots( data );
+                for ( uint32_t i = 0; i < header.NumHandleSlots; ++i )
+                {
+                    slots[ i ].Value = slots[ i ].Value == AssetRegistrySlot::Empty ? AssetRegistrySlot::Removed : slots[ i ].Value;
+                }
+                reinterpret_cast<AssetRegistryHeader *>( data.data( ) )->NumHandleSlotsUsed = header.NumHandleSlots;
+            } ) );
+    }
+} // namespace
+
+int main( )
+{
+    JsonToBinaryRoundTrip( );
+    RejectCorruptBinary( );
+    std::filesystem::remove_all( TestDirectory( ) );
+    return DZTests::Result( );
+}
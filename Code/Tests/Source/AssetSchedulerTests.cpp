@@ -0,0 +1,272 @@
+/*
+Den Of Iz - Game/Game Engine
+Copyright (c) 2020-2024 Muhammed Murat Cengiz
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <chrono>
+#include <vector>
+#include "DZEngine/Assets/AssetScheduler.h"
+#include "DZTests/Check.h"
+
+using namespace DZEngine;
+
+namespace
+{
+    constexpr size_t KB = 1024;
+
+    /// Time only moves when a test advances it, the epoch is skipped because a default constructed time_point means no deadline
+    struct SimulatedClock
+    {
+        AssetSchedulerClock::time_point Time = AssetSchedulerClock::time_point{ std::chrono::hours( 1 ) };
+
+        void Advance( const double seconds )
+        {
+            Time += std::chrono::duration_cast<AssetSchedulerClock::duration>( std::chrono::duration<double>( seconds ) );
+        }
+
+        [[nodiscard]] AssetSchedulerClock::time_point In( const double seconds ) const
+        {
+            return Time + std::chrono::duration_cast<AssetSchedulerClock::duration>( std::chrono::duration<double>( seconds ) );
+        }
+    };
+
+    AssetSchedulerDesc TestDesc( SimulatedClock &clock )
+    {
+        AssetSchedulerDesc desc{ };
+        desc.Clock = [ &clock ] { return clock.Time; };
+        return desc;
+    }
+
+    // Higher priorities go first, equal priorities keep their push order
+    void PriorityOrder( )
+    {
+        SimulatedClock clock;
+        AssetScheduler scheduler( TestDesc( clock ) );
+        scheduler.Push( 1, KB, AssetSchedule{ 1.0f } );
+        scheduler.Push( 2, KB, AssetSchedule{ 5.0f } );
+        scheduler.Push( 3, KB, AssetSchedule{ 1.0f } );
+        scheduler.Push( 4, KB, AssetSchedule{ 3.0f } );
+        scheduler.Push( 5, KB, AssetSchedule{ 1.0f } );
+
+        DZ_CHECK( scheduler.Schedule( ) == std::vector<uint32_t>( { 2, 4, 1, 3, 5 } ) );
+        DZ_CHECK( scheduler.Schedule( ).empty( ) );
+
+        // A duplicate push is rejected instead of dispatching the id twice
+        scheduler.Push( 6, KB );
+        scheduler.Push( 6, KB );
+        scheduler.Push( 2, KB );
+        DZ_CHECK( scheduler.Schedule( ) == std::vector<uint32_t>( { 6 } ) );
+    }
+
+    // A frame stops at the first request over a budget instead of letting smaller, less important ones overtake it
+    void FrameBudgets( )
+    {
+        SimulatedClock     clock;
+        AssetSchedulerDesc desc  = TestDesc( clock );
+        desc.BytesPerFrame       = 10 * KB;
+        desc.MaxRequestsPerFrame = 3;
+        AssetScheduler scheduler( desc );
+
+        scheduler.Push( 1, 6 * KB, AssetSchedule{ 3.0f } );
+        scheduler.Push( 2, 6 * KB, AssetSchedule{ 2.0f } );
+        scheduler.Push( 3, KB, AssetSchedule{ 1.0f } );
+        DZ_CHECK( scheduler.Schedule( ) == std::vector<uint32_t>( { 1 } ) );
+        DZ_CHECK( scheduler.Schedule( ) == std::vector<uint32_t>( { 2, 3 } ) );
+
+        for ( uint32_t id = 10; id < 15; ++id )
+        {
+            scheduler.Push( id, KB );
+        }
+        DZ_CHECK( scheduler.Schedule( ) == std::vector<uint32_t>( { 10, 11, 12 } ) );
+        DZ_CHECK( scheduler.Schedule( ) == std::vector<uint32_t>( { 13, 14 } ) );
+
+        // Larger than the whole frame budget, it goes alone rather than never
+        scheduler.Push( 20, 64 * KB, AssetSchedule{ 1.0f } );
+        scheduler.Push( 21, KB );
+        DZ_CHECK( scheduler.Schedule( ) == std::vector<uint32_t>( { 20 } ) );
+        DZ_CHECK( scheduler.Schedule( ) == std::vector<uint32_t>( { 21 } ) );
+    }
+
+    // Dispatched bytes count against the in flight budget until they are completed
+    void InFlightBudget( )
+    {
+        SimulatedClock     clock;
+        AssetSchedulerDesc desc = TestDesc( clock );
+        desc.BytesPerFrame      = 64 * KB;
+        desc.MaxInFlightBytes   = 8 * KB;
+        AssetScheduler scheduler( desc );
+
+        scheduler.Push( 1, 4 * KB );
+        scheduler.Push( 2, 4 * KB );
+        scheduler.Push( 3, 4 * KB );
+        DZ_CHECK( scheduler.Schedule( ) == std::vector<uint32_t>( { 1, 2 } ) );
+        DZ_CHECK( scheduler.GetStats( ).InFlightBytes == 8 * KB );
+        DZ_CHECK( scheduler.GetStats( ).NumInFlight == 2 );
+        DZ_CHECK( scheduler.Schedule( ).empty( ) );
+
+        scheduler.Complete( 1 );
+        scheduler.Complete( 1 ); // Completing twice doesn't return the bytes twice
+        DZ_CHECK( scheduler.GetStats( ).InFlightBytes == 4 * KB );
+        DZ_CHECK( scheduler.Schedule( ) == std::vector<uint32_t>( { 3 } ) );
+
+        // Nothing in flight, a request larger than the budget is still dispatched
+        scheduler.Complete( 2 );
+        scheduler.Complete( 3 );
+        scheduler.Push( 4, 32 * KB );
+        DZ_CHECK( scheduler.Schedule( ) == std::vector<uint32_t>( { 4 } ) );
+        DZ_CHECK( scheduler.GetStats( ).InFlightBytes == 32 * KB );
+    }
+
+    // Requests close to their deadline go ahead of every priority, earliest deadline first
+    void Deadlines( )
+    {
+        SimulatedClock     clock;
+        AssetSchedulerDesc desc = TestDesc( clock );
+        desc.UrgencySeconds     = 0.5;
+        AssetScheduler scheduler( desc );
+
+        scheduler.Push( 1, KB, AssetSchedule{ 10.0f } );
+        scheduler.Push( 2, KB, AssetSchedule{ 0.0f, clock.In( 2.0 ) } );
+        scheduler.Push( 3, KB, AssetSchedule{ 0.0f, clock.In( 0.4 ) } );
+        scheduler.Push( 4, KB, AssetSchedule{ 0.0f, clock.In( 0.2 ) } );
+        DZ_CHECK( scheduler.Schedule( ) == std::vector<uint32_t>( { 4, 3, 1, 2 } ) );
+
+        // Not urgent yet, a deadline only breaks ties between equal priorities
+        scheduler.Push( 5, KB, AssetSchedule{ 1.0f } );
+        scheduler.Push( 6, KB, AssetSchedule{ 1.0f, clock.In( 3.0 ) } );
+        scheduler.Push( 7, KB, AssetSchedule{ 1.0f, clock.In( 2.0 ) } );
+        scheduler.Push( 8, KB, AssetSchedule{ 2.0f, clock.In( 5.0 ) } );
+        DZ_CHECK( scheduler.Schedule( ) == std::vector<uint32_t>( { 8, 7, 6, 5 } ) );
+
+        // Simulated time passes while a request waits behind a full in flight budget
+        desc.MaxInFlightBytes = KB;
+        AssetScheduler blocked( desc );
+        blocked.Push( 1, KB );
+        blocked.Push( 2, KB, AssetSchedule{ 0.0f, clock.In( 1.0 ) } );
+        DZ_CHECK( blocked.Schedule( ) == std::vector<uint32_t>( { 2 } ) );
+        blocked.Push( 3, KB, AssetSchedule{ 0.0f, clock.In( 1.0 ) } );
+        clock.Advance( 2.0 );
+        blocked.Complete( 2 );
+        DZ_CHECK( blocked.Schedule( ) == std::vector<uint32_t>( { 3 } ) );
+        DZ_CHECK( blocked.GetStats( ).NumMissedDeadlines == 1 );
+        blocked.Complete( 3 );
+        DZ_CHECK( blocked.Schedule( ) == std::vector<uint32_t>( { 1 } ) );
+        DZ_CHECK( blocked.GetStats( ).NumMissedDeadlines == 1 );
+    }
+
+    // A waiting low priority request eventually overtakes newer high priority ones
+    void Aging( )
+    {
+        SimulatedClock     clock;
+        AssetSchedulerDesc desc  = TestDesc( clock );
+        desc.AgingPerSecond      = 1.0f;
+        desc.MaxRequestsPerFrame = 1;
+        AssetScheduler scheduler( desc );
+
+        scheduler.Push( 1, KB, AssetSchedule{ 0.0f } );
+        for ( uint32_t id = 2; id < 6; ++id )
+        {
+            scheduler.Push( id, KB, AssetSchedule{ 3.5f } );
+            DZ_CHECK( scheduler.Schedule( ) == std::vector<uint32_t>( { id } ) );
+            clock.Advance( 1.0 );
+        }
+        // Waited four seconds, 0 + 4 beats a fresh 3.5
+        scheduler.Push( 6, KB, AssetSchedule{ 3.5f } );
+        DZ_CHECK( scheduler.Schedule( ) == std::vector<uint32_t>( { 1 } ) );
+        DZ_CHECK( scheduler.Schedule( ) == std::vector<uint32_t>( { 6 } ) );
+
+        // Without aging the same sequence starves it
+        desc.AgingPerSecond = 0.0f;
+        AssetScheduler starving( desc );
+        starving.Push( 1, KB, AssetSchedule{ 0.0f } );
+        for ( uint32_t id = 2; id < 8; ++id )
+        {
+            starving.Push( id, KB, AssetSchedule{ 3.5f } );
+            DZ_CHECK( starving.Schedule( ) == std::vector<uint32_t>( { id } ) );
+            clock.Advance( 1.0 );
+        }
+        DZ_CHECK( starving.IsQueued( 1 ) );
+    }
+
+    // Cancel and Reschedule only apply while queued, a rescheduled request keeps the time it already waited
+    void CancelAndReschedule( )
+    {
+        SimulatedClock     clock;
+        AssetSchedulerDesc desc = TestDesc( clock );
+        desc.AgingPerSecond     = 1.0f;
+        AssetScheduler scheduler( desc );
+
+        scheduler.Push( 1, KB, AssetSchedule{ 1.0f } );
+        scheduler.Push( 2, KB, AssetSchedule{ 2.0f } );
+        scheduler.Push( 3, KB, AssetSchedule{ 3.0f } );
+        DZ_CHECK( scheduler.Cancel( 2 ) );
+        DZ_CHECK( !scheduler.Cancel( 2 ) );
+        DZ_CHECK( !scheduler.IsQueued( 2 ) );
+        DZ_CHECK( scheduler.Reschedule( 1, AssetSchedule{ 5.0f } ) );
+        DZ_CHECK( scheduler.Schedule( ) == std::vector<uint32_t>( { 1, 3 } ) );
+        DZ_CHECK( !scheduler.Cancel( 1 ) );
+        DZ_CHECK( !scheduler.Reschedule( 3, AssetSchedule{ } ) );
+
+        scheduler.Push( 4, KB, AssetSchedule{ 0.0f } );
+        clock.Advance( 2.0 );
+        scheduler.Push( 5, KB, AssetSchedule{ 1.0f } );
+        DZ_CHECK( scheduler.Reschedule( 4, AssetSchedule{ 0.0f } ) );
+        DZ_CHECK( scheduler.Schedule( ) == std::vector<uint32_t>( { 4, 5 } ) );
+
+        // A cancelled id can be pushed again
+        scheduler.Push( 2, KB );
+        DZ_CHECK( scheduler.IsQueued( 2 ) );
+
+        const AssetSchedulerStats stats = scheduler.GetStats( );
+        DZ_CHECK( stats.NumQueued == 1 );
+        DZ_CHECK( stats.NumCancelled == 1 );
+        DZ_CHECK( stats.NumDispatched == 4 );
+        DZ_CHECK( stats.NumInFlight == 4 );
+    }
+
+    // Rejected requests stay queued in their place and don't use the frame budget
+    void DispatchRejection( )
+    {
+        SimulatedClock     clock;
+        AssetSchedulerDesc desc = TestDesc( clock );
+        desc.BytesPerFrame      = 4 * KB;
+        AssetScheduler scheduler( desc );
+
+        scheduler.Push( 1, 4 * KB, AssetSchedule{ 2.0f } );
+        scheduler.Push( 2, 2 * KB, AssetSchedule{ 1.0f } );
+        scheduler.Push( 3, 2 * KB, AssetSchedule{ 0.0f } );
+        DZ_CHECK( scheduler.Schedule( []( const uint32_t id ) { return id != 1; } ) == std::vector<uint32_t>( { 2, 3 } ) );
+        DZ_CHECK( scheduler.IsQueued( 1 ) );
+        DZ_CHECK( scheduler.GetStats( ).InFlightBytes == 4 * KB );
+
+        scheduler.Push( 4, KB, AssetSchedule{ 1.0f } );
+        DZ_CHECK( scheduler.Schedule( ) == std::vector<uint32_t>( { 1 } ) );
+        DZ_CHECK( scheduler.Schedule( ) == std::vector<uint32_t>( { 4 } ) );
+        DZ_CHECK( scheduler.Schedule( []( uint32_t ) { return false; } ).empty( ) );
+    }
+} // namespace
+
+int main( )
+{
+    PriorityOrder( );
+    FrameBudgets( );
+    InFlightBudget( );
+    Deadlines( );
+    Aging( );
+    CancelAndReschedule( );
+    DispatchRejection( );
+    return DZTests::Result( );
+}
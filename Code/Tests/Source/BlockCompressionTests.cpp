@@ -0,0 +1,153 @@
+/*
+Den Of Iz - Game/Game Engine
+Copyright (c) 2020-2024 Muhammed Murat Cengiz
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <cstring>
+#include <random>
+#include <vector>
+#include "DZEngine/Assets/BlockCompression.h"
+#include "DZTests/Check.h"
+
+using namespace DZEngine;
+
+namespace
+{
+    constexpr BlockCompressionCodec Codecs[]  = { BlockCompressionCodec::LZ4, BlockCompressionCodec::Zstd };
+    constexpr uint32_t              ChunkSize = 4096;
+
+    std::vector<Byte> CompressibleData( const size_t numBytes )
+    {
+        std::vector<Byte> data( numBytes );
+        for ( size_t i = 0; i < numBytes; ++i )
+        {
+            data[ i ] = static_cast<Byte>( i / 64 % 7 );
+        }
+        return data;
+    }
+
+    std::vector<Byte> RandomData( const size_t numBytes )
+    {
+        std::mt19937      random( 42 );
+        std::vector<Byte> data( numBytes );
+        for ( Byte &value : data )
+        {
+            value = static_cast<Byte>( random( ) );
+        }
+        return data;
+    }
+
+    size_t TableNumBytes( const size_t numBytes )
+    {
+        return sizeof( BlockCompressionHeader ) + ( numBytes + ChunkSize - 1 ) / ChunkSize * sizeof( uint32_t );
+    }
+
+    bool RoundTrips( const std::vector<Byte> &data, const std::vector<Byte> &block )
+    {
+        if ( !BlockCompression::IsCompressed( block.data( ), block.size( ) ) || BlockCompression::GetNumBytes( block.data( ), block.size( ) ) != data.size( ) )
+        {
+            return false;
+        }
+        std::vector<Byte> decompressed( data.size( ) );
+        return BlockCompression::Decompress( block.data( ), block.size( ), decompressed.data( ), decompressed.size( ) ) && decompressed == data;
+    }
+
+    // Compressible data shrinks and decodes back to the same bytes, including a partial last chunk
+    void Compressible( )
+    {
+        const std::vector<Byte> data = CompressibleData( ChunkSize * 5 + 123 );
+        for ( const BlockCompressionCodec codec : Codecs )
+        {
+            const std::vector<Byte> block = BlockCompression::Compress( data.data( ), data.size( ), { .Codec = codec, .ChunkSize = ChunkSize } );
+            DZ_CHECK( block.size( ) < data.size( ) / 4 );
+            DZ_CHECK( RoundTrips( data, block ) );
+        }
+    }
+
+    // Chunks that don't shrink are stored raw, so the block is the payload plus the chunk table
+    void Incompressible( )
+    {
+        const std::vector<Byte> data = RandomData( ChunkSize * 3 + 17 );
+        for ( const BlockCompressionCodec codec : Codecs )
+        {
+            const std::vector<Byte> block = BlockCompression::Compress( data.data( ), data.size( ), { .Codec = codec, .ChunkSize = ChunkSize } );
+            DZ_CHECK( block.size( ) == TableNumBytes( data.size( ) ) + data.size( ) );
+            DZ_CHECK( std::memcmp( block.data( ) + TableNumBytes( data.size( ) ), data.data( ), data.size( ) ) == 0 );
+            DZ_CHECK( RoundTrips( data, block ) );
+        }
+    }
+
+    // A raw chunk next to compressed chunks keeps every chunk at its own offset
+    void MixedChunks( )
+    {
+        std::vector<Byte>       data       = CompressibleData( ChunkSize * 3 );
+        const std::vector<Byte> randomData = RandomData( ChunkSize );
+        std::memcpy( data.data( ) + ChunkSize, randomData.data( ), ChunkSize );
+        for ( const BlockCompressionCodec codec : Codecs )
+        {
+            const std::vector<Byte> block = BlockCompression::Compress( data.data( ), data.size( ), { .Codec = codec, .ChunkSize = ChunkSize } );
+            DZ_CHECK( block.size( ) < data.size( ) );
+
+            uint32_t chunkNumBytes[ 3 ];
+            std::memcpy( chunkNumBytes, block.data( ) + sizeof( BlockCompressionHeader ), sizeof( chunkNumBytes ) );
+            DZ_CHECK( chunkNumBytes[ 0 ] < ChunkSize );
+            DZ_CHECK( chunkNumBytes[ 1 ] == ChunkSize );
+            DZ_CHECK( chunkNumBytes[ 2 ] < ChunkSize );
+            DZ_CHECK( RoundTrips( data, block ) );
+        }
+    }
+
+    // Empty input is a header without chunks
+    void Empty( )
+    {
+        const std::vector<Byte> data;
+        for ( const BlockCompressionCodec codec : Codecs )
+        {
+            const std::vector<Byte> block = BlockCompression::Compress( data.data( ), 0, { .Codec = codec, .ChunkSize = ChunkSize } );
+            DZ_CHECK( block.size( ) == sizeof( BlockCompressionHeader ) );
+            DZ_CHECK( BlockCompression::IsCompressed( block.data( ), block.size( ) ) );
+            DZ_CHECK( BlockCompression::GetNumBytes( block.data( ), block.size( ) ) == 0 );
+            DZ_CHECK( BlockCompression::Decompress( block.data( ), block.size( ), nullptr, 0 ) );
+        }
+    }
+
+    // Truncated blocks and corrupt chunks are rejected instead of read past
+    void Corrupt( )
+    {
+        const std::vector<Byte> data = CompressibleData( ChunkSize * 2 );
+        for ( const BlockCompressionCodec codec : Codecs )
+        {
+            std::vector<Byte> block = BlockCompression::Compress( data.data( ), data.size( ), { .Codec = codec, .ChunkSize = ChunkSize } );
+            std::vector<Byte> decompressed( data.size( ) );
+            DZ_CHECK( !BlockCompression::Decompress( block.data( ), block.size( ) - 1, decompressed.data( ), decompressed.size( ) ) );
+            DZ_CHECK( !BlockCompression::Decompress( block.data( ), block.size( ), decompressed.data( ), decompressed.size( ) - 1 ) );
+            DZ_CHECK( !BlockCompression::IsCompressed( block.data( ), sizeof( BlockCompressionHeader ) - 1 ) );
+
+            std::memset( block.data( ) + TableNumBytes( data.size( ) ), 0xFF, 8 );
+            DZ_CHECK( !BlockCompression::Decompress( block.data( ), block.size( ), decompressed.data( ), decompressed.size( ) ) );
+        }
+    }
+} // namespace
+
+int main( )
+{
+    Compressible( );
+    Incompressible( );
+    MixedChunks( );
+    Empty( );
+    Corrupt( );
+    return DZTests::Result( );
+}
@@ -0,0 +1,193 @@
+/*
+Den Of Iz - Game/Game Engine
+Copyright (c) 2020-2024 Muhammed Murat Cengiz
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+#include <vector>
+#include "DZEngine/Assets/DerivedDataCache.h"
+#include "DZTests/Check.h"
+
+using namespace DZEngine;
+
+namespace
+{
+    constexpr size_t HeaderNumBytes = 48;
+
+    std::filesystem::path CacheDirectory( const char *name )
+    {
+        const std::filesystem::path directory = std::filesystem::temp_directory_path( ) / "DZDerivedDataCacheTests" / name;
+        std::filesystem::remove_all( directory );
+        return directory;
+    }
+
+    std::filesystem::path EntryPath( const std::filesystem::path &directory, const ContentHash &key )
+    {
+        const std::string name = key.ToString( );
+        return directory / name.substr( 0, 2 ) / name;
+    }
+
+    ContentHash Key( const uint32_t index )
+    {
+        return DerivedDataCache::MakeKey( "Test", 1, ContentHash::Of( reinterpret_cast<const Byte *>( &index ), sizeof( index ) ) );
+    }
+
+    std::vector<Byte> Payload( const uint32_t index, const size_t numBytes )
+    {
+        std::vector<Byte> data( numBytes );
+        for ( size_t i = 0; i < numBytes; ++i )
+        {
+            data[ i ] = static_cast<Byte>( i * 31 + index );
+        }
+        return data;
+    }
+
+    // Gives consecutive uses distinct last use times, the clock may be coarser than a few calls
+    void NextUse( )
+    {
+        std::this_thread::sleep_for( std::chrono::milliseconds( 20 ) );
+    }
+
+    // Put entries read back unchanged, also from a new cache scanning the same directory
+    void PutGet( )
+    {
+        const std::filesystem::path directory = CacheDirectory( "PutGet" );
+        const std::vector<Byte>     data      = Payload( 1, 1000 );
+        std::vector<Byte>           out;
+        {
+            DerivedDataCache cache( { .Directory = directory } );
+            DZ_CHECK( cache.IsValid( ) );
+            DZ_CHECK( !cache.Get( Key( 1 ), out ) );
+            DZ_CHECK( cache.Put( Key( 1 ), data ) );
+            DZ_CHECK( cache.Put( Key( 2 ), { } ) );
+            DZ_CHECK( cache.Contains( Key( 1 ) ) );
+            DZ_CHECK( cache.Get( Key( 1 ), out ) && out == data );
+            DZ_CHECK( cache.Get( Key( 2 ), out ) && out.empty( ) );
+
+            const DerivedDataCacheStats stats = cache.GetStats( );
+            DZ_CHECK( stats.NumLocalHits == 2 && stats.NumMisses == 1 && stats.NumPuts == 2 );
+            DZ_CHECK( stats.NumEntries == 2 && stats.NumBytes == 2 * HeaderNumBytes + data.size( ) );
+        }
+
+        DerivedDataCache cache( { .Directory = directory } );
+        DZ_CHECK( cache.GetStats( ).NumEntries == 2 );
+        DZ_CHECK( cache.Get( Key( 1 ), out ) && out == data );
+        DZ_CHECK( !cache.Get( Key( 3 ), out ) && out.empty( ) );
+    }
+
+    // An entry copied to the path of another key holds a valid payload, but not the data of that key
+    void RejectMismatchedKey( )
+    {
+        const std::filesystem::path directory = CacheDirectory( "RejectMismatchedKey" );
+        DerivedDataCache            cache( { .Directory = directory } );
+        DZ_CHECK( cache.Put( Key( 1 ), Payload( 1, 100 ) ) );
+
+        const std::filesystem::path copy = EntryPath( directory, Key( 2 ) );
+        std::filesystem::create_directories( copy.parent_path( ) );
+        std::filesystem::copy_file( EntryPath( directory, Key( 1 ) ), copy );
+
+        std::vector<Byte> out;
+        DZ_CHECK( !cache.Get( Key( 2 ), out ) );
+        DZ_CHECK( !std::filesystem::exists( copy ) );
+        DZ_CHECK( cache.GetStats( ).NumCorrupted == 1 );
+        DZ_CHECK( cache.Get( Key( 1 ), out ) && out == Payload( 1, 100 ) );
+    }
+
+    // A payload that no longer matches its hash is removed and counted as a miss
+    void RemoveCorruptedPayload( )
+    {
+        const std::filesystem::path directory = CacheDirectory( "RemoveCorruptedPayload" );
+        DerivedDataCache            cache( { .Directory = directory } );
+        DZ_CHECK( cache.Put( Key( 1 ), Payload( 1, 100 ) ) );
+
+        const std::filesystem::path path = EntryPath( directory, Key( 1 ) );
+        {
+            std::fstream file( path, std::ios::binary | std::ios::in | std::ios::out );
+            file.seekp( HeaderNumBytes + 10 );
+            file.put( static_cast<char>( Payload( 1, 100 )[ 10 ] + 1 ) );
+        }
+
+        std::vector<Byte> out;
+        DZ_CHECK( !cache.Get( Key( 1 ), out ) && out.empty( ) );
+        DZ_CHECK( !std::filesystem::exists( path ) );
+        DZ_CHECK( !cache.Contains( Key( 1 ) ) );
+
+        const DerivedDataCacheStats stats = cache.GetStats( );
+        DZ_CHECK( stats.NumCorrupted == 1 && stats.NumMisses == 1 );
+        DZ_CHECK( stats.NumEntries == 0 && stats.NumBytes == 0 );
+    }
+
+    // Trim evicts the least recently used entries until the store fits, a Get counts as a use
+    void TrimOldestFirst( )
+    {
+        const std::filesystem::path directory     = CacheDirectory( "TrimOldestFirst" );
+        constexpr size_t            EntryNumBytes = HeaderNumBytes + 1000;
+        DerivedDataCache            cache( { .Directory = directory, .MaxNumBytes = 0 } );
+        for ( uint32_t i = 0; i < 4; ++i )
+        {
+            DZ_CHECK( cache.Put( Key( i ), Payload( i, 1000 ) ) );
+            NextUse( );
+        }
+        std::vector<Byte> out;
+        DZ_CHECK( cache.Get( Key( 0 ), out ) );
+
+        cache.Trim( 4 * EntryNumBytes );
+        DZ_CHECK( cache.GetStats( ).NumTrimmed == 0 );
+
+        cache.Trim( 2 * EntryNumBytes );
+        DZ_CHECK( cache.Contains( Key( 0 ) ) );
+        DZ_CHECK( !cache.Contains( Key( 1 ) ) && !std::filesystem::exists( EntryPath( directory, Key( 1 ) ) ) );
+        DZ_CHECK( !cache.Contains( Key( 2 ) ) && !std::filesystem::exists( EntryPath( directory, Key( 2 ) ) ) );
+        DZ_CHECK( cache.Contains( Key( 3 ) ) );
+
+        const DerivedDataCacheStats stats = cache.GetStats( );
+        DZ_CHECK( stats.NumTrimmed == 2 && stats.NumEntries == 2 && stats.NumBytes == 2 * EntryNumBytes );
+    }
+
+    // Opening a store past MaxNumBytes trims it to TrimRatio, ordered by the last write times of the files
+    void TrimOnOpen( )
+    {
+        const std::filesystem::path directory     = CacheDirectory( "TrimOnOpen" );
+        constexpr size_t            EntryNumBytes = HeaderNumBytes + 1000;
+        {
+            DerivedDataCache cache( { .Directory = directory, .MaxNumBytes = 0 } );
+            for ( uint32_t i = 0; i < 4; ++i )
+            {
+                DZ_CHECK( cache.Put( Key( i ), Payload( i, 1000 ) ) );
+                NextUse( );
+            }
+            std::vector<Byte> out;
+            DZ_CHECK( cache.Get( Key( 0 ), out ) );
+        }
+
+        DerivedDataCache cache( { .Directory = directory, .MaxNumBytes = 3 * EntryNumBytes, .TrimRatio = 0.5 } );
+        DZ_CHECK( cache.GetStats( ).NumEntries == 1 );
+        DZ_CHECK( cache.Contains( Key( 0 ) ) );
+    }
+} // namespace
+
+int main( )
+{
+    PutGet( );
+    RejectMismatchedKey( );
+    RemoveCorruptedPayload( );
+    TrimOldestFirst( );
+    TrimOnOpen( );
+    return DZTests::Result( );
+}
@@ -0,0 +1,132 @@
+/*
+Den Of Iz - Game/Game Engine
+Copyright (c) 2020-2024 Muhammed Murat Cengiz
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+#include <vector>
+#include "DZEngine/Assets/FileWatcher.h"
+#include "DZTests/Check.h"
+
+using namespace DZEngine;
+
+namespace
+{
+    constexpr auto Debounce = std::chrono::milliseconds( 200 );
+    constexpr auto Step     = std::chrono::milliseconds( 50 );
+
+    std::vector<FileChange> Collect( FileChangeDebouncer &debouncer, const std::chrono::steady_clock::time_point now )
+    {
+        std::vector<FileChange> changes;
+        debouncer.Collect( now, changes );
+        return changes;
+    }
+
+    // Changes are held until the file was quiet for the whole window, every event restarts it
+    void SettlesAfterQuiet( )
+    {
+        FileChangeDebouncer debouncer( Debounce );
+        const auto          start = std::chrono::steady_clock::time_point( );
+        debouncer.Add( "Shader.hlsl", FileChangeType::Modified, start );
+        debouncer.Add( "Shader.hlsl", FileChangeType::Modified, start + Debounce - Step );
+        DZ_CHECK( Collect( debouncer, start + Debounce ).empty( ) );
+        DZ_CHECK( Collect( debouncer, start + 2 * Debounce - 2 * Step ).empty( ) );
+
+        const std::vector<FileChange> changes = Collect( debouncer, start + 2 * Debounce - Step );
+        DZ_CHECK( changes.size( ) == 1 );
+        DZ_CHECK( !changes.empty( ) && changes[ 0 ].Path == "Shader.hlsl" && changes[ 0 ].Type == FileChangeType::Modified );
+        DZ_CHECK( Collect( debouncer, start + 10 * Debounce ).empty( ) );
+    }
+
+    // A file written right after it was created is still new to the consumer
+    void AddThenModify( )
+    {
+        FileChangeDebouncer debouncer( Debounce );
+        const auto          start = std::chrono::steady_clock::time_point( );
+        debouncer.Add( "Texture.png", FileChangeType::Added, start );
+        debouncer.Add( "Texture.png", FileChangeType::Modified, start + Step );
+        debouncer.Add( "Texture.png", FileChangeType::Modified, start + 2 * Step );
+
+        const std::vector<FileChange> changes = Collect( debouncer, start + 2 * Step + Debounce );
+        DZ_CHECK( changes.size( ) == 1 );
+        DZ_CHECK( !changes.empty( ) && changes[ 0 ].Type == FileChangeType::Added );
+    }
+
+    // The consumer only learns that the file is gone, not about the writes before
+    void ModifyThenRemove( )
+    {
+        FileChangeDebouncer debouncer( Debounce );
+        const auto          start = std::chrono::steady_clock::time_point( );
+        debouncer.Add( "Mesh.gltf", FileChangeType::Modified, start );
+        debouncer.Add( "Mesh.gltf", FileChangeType::Removed, start + Step );
+
+        const std::vector<FileChange> changes = Collect( debouncer, start + Step + Debounce );
+        DZ_CHECK( changes.size( ) == 1 );
+        DZ_CHECK( !changes.empty( ) && changes[ 0 ].Type == FileChangeType::Removed );
+    }
+
+    // A temporary file created and removed within the window is never reported
+    void AddThenRemove( )
+    {
+        FileChangeDebouncer debouncer( Debounce );
+        const auto          start = std::chrono::steady_clock::time_point( );
+        debouncer.Add( "Shader.hlsl.tmp", FileChangeType::Added, start );
+        debouncer.Add( "Shader.hlsl.tmp", FileChangeType::Modified, start + Step );
+        debouncer.Add( "Shader.hlsl.tmp", FileChangeType::Removed, start + 2 * Step );
+        DZ_CHECK( Collect( debouncer, start + 10 * Debounce ).empty( ) );
+    }
+
+    // A file replaced by a rename over it is reported as modified, not removed
+    void RemoveThenAdd( )
+    {
+        FileChangeDebouncer debouncer( Debounce );
+        const auto          start = std::chrono::steady_clock::time_point( );
+        debouncer.Add( "Shader.hlsl", FileChangeType::Removed, start );
+        debouncer.Add( "Shader.hlsl", FileChangeType::Added, start + Step );
+
+        const std::vector<FileChange> changes = Collect( debouncer, start + Step + Debounce );
+        DZ_CHECK( changes.size( ) == 1 );
+        DZ_CHECK( !changes.empty( ) && changes[ 0 ].Type == FileChangeType::Modified );
+    }
+
+    // Every file has a window of its own
+    void IndependentFiles( )
+    {
+        FileChangeDebouncer debouncer( Debounce );
+        const auto          start = std::chrono::steady_clock::time_point( );
+        debouncer.Add( "A.hlsl", FileChangeType::Modified, start );
+        debouncer.Add( "B.hlsl", FileChangeType::Added, start + 2 * Step );
+
+        std::vector<FileChange> changes = Collect( debouncer, start + Debounce );
+        DZ_CHECK( changes.size( ) == 1 );
+        DZ_CHECK( !changes.empty( ) && changes[ 0 ].Path == "A.hlsl" );
+
+        changes = Collect( debouncer, start + 2 * Step + Debounce );
+        DZ_CHECK( changes.size( ) == 1 );
+        DZ_CHECK( !changes.empty( ) && changes[ 0 ].Path == "B.hlsl" && changes[ 0 ].Type == FileChangeType::Added );
+    }
+} // namespace
+
+int main( )
+{
+    SettlesAfterQuiet( );
+    AddThenModify( );
+    ModifyThenRemove( );
+    AddThenRemove( );
+    RemoveThenAdd( );
+    IndependentFiles( );
+    return DZTests::Result( );
+}
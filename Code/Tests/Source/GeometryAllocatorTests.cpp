@@ -0,0 +1,214 @@
+/*
+Den Of Iz - Game/Game Engine
+Copyright (c) 2020-2024 Muhammed Murat Cengiz
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <random>
+#include "DZEngine/Assets/GeometryAllocator.h"
+#include "DZTests/Check.h"
+
+using namespace DZEngine;
+
+namespace
+{
+    // Freed neighbours coalesce and the stats describe the holes
+    void AllocateAndFree( )
+    {
+        GeometryAllocator               allocator( GeometryAllocatorDesc{ .Capacity = 1000 } );
+        std::vector<GeometryAllocation> allocations;
+        for ( int i = 0; i < 10; ++i )
+        {
+            allocations.push_back( allocator.Allocate( 100 ) );
+            DZ_CHECK( allocations.back( ).IsValid( ) && allocations.back( ).Offset == static_cast<size_t>( i ) * 100 );
+        }
+        DZ_CHECK( !allocator.Allocate( 1 ).IsValid( ) );
+        DZ_CHECK( !allocator.Allocate( 0 ).IsValid( ) );
+        DZ_CHECK( allocator.GetStats( ).FirstFreeOffset == 1000 );
+
+        for ( int i = 0; i < 10; i += 2 )
+        {
+            allocator.Free( allocations[ i ] );
+        }
+        GeometryAllocatorStats stats = allocator.GetStats( );
+        DZ_CHECK( stats.FreeSize == 500 && stats.UsedSize == 500 );
+        DZ_CHECK( stats.NumFreeBlocks == 5 && stats.LargestFreeBlock == 100 );
+        DZ_CHECK( stats.NumAllocations == 5 );
+        DZ_CHECK( stats.HighWaterMark == 1000 );
+        DZ_CHECK( stats.FirstFreeOffset == 0 );
+        DZ_CHECK_NEAR( stats.Fragmentation, 0.8f, 1e-5f );
+        DZ_CHECK( !allocator.Allocate( 200 ).IsValid( ) );
+
+        // [ 100, 200 ) joins the holes on both sides
+        allocator.Free( allocations[ 1 ] );
+        stats = allocator.GetStats( );
+        DZ_CHECK( stats.NumFreeBlocks == 4 && stats.LargestFreeBlock == 300 );
+
+        const GeometryAllocation joined = allocator.Allocate( 300 );
+        DZ_CHECK( joined.IsValid( ) && joined.Offset == 0 );
+    }
+
+    // The smallest hole that fits is used, larger ones stay whole
+    void BestFit( )
+    {
+        GeometryAllocator  allocator( GeometryAllocatorDesc{ .Capacity = 1000 } );
+        GeometryAllocation a = allocator.Allocate( 300 );
+        allocator.Allocate( 10 );
+        GeometryAllocation b = allocator.Allocate( 50 );
+        allocator.Allocate( 10 );
+        allocator.Free( a );
+        allocator.Free( b );
+
+        const GeometryAllocation small = allocator.Allocate( 40 );
+        DZ_CHECK( small.Offset == 310 );
+        DZ_CHECK( allocator.GetStats( ).LargestFreeBlock == 630 );
+    }
+
+    // Moves only go towards the start into holes that don't overlap the source, completing them leaves a single free block
+    void Defragment( )
+    {
+        GeometryAllocator               allocator( GeometryAllocatorDesc{ .Capacity = 1000 } );
+        std::vector<GeometryAllocation> allocations;
+        for ( int i = 0; i < 10; ++i )
+        {
+            allocations.push_back( allocator.Allocate( 100 ) );
+        }
+        for ( int i = 0; i < 10; i += 2 )
+        {
+            allocator.Free( allocations[ i ] );
+        }
+
+        // The budget limits how much is moved per pass
+        std::vector<GeometryMove> moves = allocator.PlanDefragment( 100 );
+        DZ_CHECK( moves.size( ) == 1 );
+        DZ_CHECK( allocator.HasPendingDefragment( ) );
+        allocator.CompleteDefragment( moves );
+        DZ_CHECK( !allocator.HasPendingDefragment( ) );
+
+        moves = allocator.PlanDefragment( 1000 );
+        for ( const GeometryMove &move : moves )
+        {
+            DZ_CHECK( move.DstOffset + move.Size <= move.SrcOffset );
+        }
+        // Sources stay reserved until the copies are complete
+        DZ_CHECK( allocator.GetStats( ).NumAllocations == 5 );
+        DZ_CHECK( allocator.GetStats( ).HighWaterMark > 500 );
+        allocator.CompleteDefragment( moves );
+
+        const GeometryAllocatorStats stats = allocator.GetStats( );
+        DZ_CHECK( stats.NumFreeBlocks == 1 );
+        DZ_CHECK( stats.Fragmentation == 0.0f );
+        DZ_CHECK( stats.HighWaterMark == 500 );
+        DZ_CHECK( stats.FirstFreeOffset == 500 );
+        DZ_CHECK( allocator.PlanDefragment( 1000 ).empty( ) );
+    }
+
+    // Freeing a range while it moves drops the move and its destination
+    void FreeWhileMoving( )
+    {
+        GeometryAllocator        allocator( GeometryAllocatorDesc{ .Capacity = 300 } );
+        const GeometryAllocation first  = allocator.Allocate( 100 );
+        const GeometryAllocation second = allocator.Allocate( 100 );
+        allocator.Free( first );
+
+        const std::vector<GeometryMove> moves = allocator.PlanDefragment( 1000 );
+        DZ_CHECK( moves.size( ) == 1 && moves[ 0 ].SrcOffset == second.Offset && moves[ 0 ].DstOffset == 0 );
+        allocator.Free( second );
+        allocator.CompleteDefragment( moves );
+
+        const GeometryAllocatorStats stats = allocator.GetStats( );
+        DZ_CHECK( stats.FreeSize == 300 && stats.NumFreeBlocks == 1 && stats.NumAllocations == 0 );
+    }
+
+    // Growing appends free space that merges with the tail, canMove restricts the moves to the ranges of one owner
+    void GrowAndFilter( )
+    {
+        GeometryAllocator        allocator( GeometryAllocatorDesc{ .Capacity = 100 } );
+        const GeometryAllocation first = allocator.Allocate( 100 );
+        DZ_CHECK( !allocator.Allocate( 10 ).IsValid( ) );
+
+        allocator.Grow( 300 );
+        allocator.Grow( 200 ); // Shrinking is ignored
+        DZ_CHECK( allocator.GetCapacity( ) == 300 );
+        const GeometryAllocation second = allocator.Allocate( 80 );
+        DZ_CHECK( second.IsValid( ) && second.Offset == 100 );
+        allocator.Free( first );
+
+        DZ_CHECK( allocator.PlanDefragment( 1000, [ & ]( const size_t offset ) { return offset != second.Offset; } ).empty( ) );
+        const std::vector<GeometryMove> moves = allocator.PlanDefragment( 1000 );
+        DZ_CHECK( moves.size( ) == 1 && moves[ 0 ].DstOffset == 0 );
+        allocator.CompleteDefragment( moves );
+        DZ_CHECK( allocator.GetStats( ).NumFreeBlocks == 1 && allocator.GetStats( ).HighWaterMark == 80 );
+    }
+
+    // Random allocations, frees and defragment passes keep the bookkeeping consistent with what is live
+    void Stress( )
+    {
+        GeometryAllocator               allocator( GeometryAllocatorDesc{ .Capacity = 1 << 20 } );
+        std::mt19937                    random( 1 );
+        std::vector<GeometryAllocation> live;
+        bool                            consistent = true;
+        for ( int i = 0; i < 20000; ++i )
+        {
+            if ( live.empty( ) || random( ) % 3 != 0 )
+            {
+                if ( const GeometryAllocation allocation = allocator.Allocate( 1 + random( ) % 5000 ); allocation.IsValid( ) )
+                {
+                    live.push_back( allocation );
+                }
+            }
+            else
+            {
+                const size_t index = random( ) % live.size( );
+                allocator.Free( live[ index ] );
+                live[ index ] = live.back( );
+                live.pop_back( );
+            }
+
+            if ( i % 1000 == 0 )
+            {
+                const std::vector<GeometryMove> moves = allocator.PlanDefragment( 20000 );
+                for ( const GeometryMove &move : moves )
+                {
+                    for ( GeometryAllocation &allocation : live )
+                    {
+                        allocation.Offset = allocation.Offset == move.SrcOffset ? move.DstOffset : allocation.Offset;
+                    }
+                }
+                allocator.CompleteDefragment( moves );
+            }
+
+            const GeometryAllocatorStats stats = allocator.GetStats( );
+            size_t                       used  = 0;
+            for ( const GeometryAllocation &allocation : live )
+            {
+                used += allocation.Size;
+            }
+            consistent &= stats.UsedSize == used && stats.NumAllocations == live.size( ) && stats.UsedSize + stats.FreeSize == stats.Capacity;
+        }
+        DZ_CHECK( consistent );
+    }
+} // namespace
+
+int main( )
+{
+    AllocateAndFree( );
+    BestFit( );
+    Defragment( );
+    FreeWhileMoving( );
+    GrowAndFilter( );
+    Stress( );
+    return DZTests::Result( );
+}
@@ -0,0 +1,150 @@
+/*
+Den Of Iz - Game/Game Engine
+Copyright (c) 2020-2024 Muhammed Murat Cengiz
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <DirectXMath.h>
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <taskflow/taskflow.hpp>
+#include "DZEngine/Math/MathConverter.h"
+#include "DZEngine/Rendering/Lighting/LightClusterBuilder.h"
+#include "DZTests/Check.h"
+
+using namespace DZEngine;
+using namespace DirectX;
+
+namespace
+{
+    constexpr uint32_t NumLights = 4096;
+
+    struct Camera
+    {
+        Float4x4 View;
+        Float4x4 Projection;
+    };
+
+    Camera MakeCamera( const XMVECTOR eye, const XMVECTOR target )
+    {
+        Camera camera{ };
+        camera.View       = MathConverter::Float4X4FromXMMATRIX( XMMatrixLookAtLH( eye, target, XMVectorSet( 0.0f, 1.0f, 0.0f, 0.0f ) ) );
+        camera.Projection = MathConverter::Float4X4FromXMMATRIX( XMMatrixPerspectiveFovLH( XM_PIDIV4, 16.0f / 9.0f, 0.1f, 200.0f ) );
+        return camera;
+    }
+
+    std::vector<ClusterLightBounds> RandomLights( std::mt19937 &random, const uint32_t numLights )
+    {
+        std::uniform_real_distribution<float> position( -60.0f, 60.0f );
+        std::uniform_real_distribution<float> radius( 0.25f, 12.0f );
+
+        std::vector<ClusterLightBounds> lights( numLights );
+        for ( ClusterLightBounds &light : lights )
+        {
+            light.Position = Float3{ position( random ), position( random ) * 0.25f, position( random ) + 60.0f };
+            light.Radius   = radius( random );
+        }
+        return lights;
+    }
+
+    bool ClusterListsSorted( const LightClusterBuilder &builder )
+    {
+        const auto &indices = builder.GetLightIndices( );
+        return std::ranges::all_of( builder.GetClusters( ),
+                                    [ & ]( const GPULightCluster &cluster )
+                                    { return std::is_sorted( indices.begin( ) + cluster.Offset, indices.begin( ) + cluster.Offset + cluster.Count ); } );
+    }
+
+    // Thousands of lights seen from several cameras, the binned build has to reproduce the brute force assignment exactly
+    void BuildMatchesReference( tf::Executor *executor )
+    {
+        std::mt19937 random( 7 );
+        const Camera cameras[] = {
+            MakeCamera( XMVectorSet( 0.0f, 2.0f, -5.0f, 1.0f ), XMVectorSet( 0.0f, 0.0f, 60.0f, 1.0f ) ),
+            MakeCamera( XMVectorSet( 30.0f, 15.0f, 0.0f, 1.0f ), XMVectorSet( -10.0f, 0.0f, 80.0f, 1.0f ) ),
+            MakeCamera( XMVectorSet( 0.0f, 0.0f, 60.0f, 1.0f ), XMVectorSet( 0.0f, 0.0f, 0.0f, 1.0f ) ), // Inside the lights, looking back
+        };
+
+        LightClusterBuilderDesc desc{ };
+        desc.MaxLights = NumLights;
+        desc.Executor  = executor;
+        LightClusterBuilder binned( desc );
+        LightClusterBuilder reference( desc );
+        for ( const Camera &camera : cameras )
+        {
+            const std::vector<ClusterLightBounds> lights = RandomLights( random, NumLights );
+            binned.Build( camera.View, camera.Projection, lights );
+            reference.BuildReference( camera.View, camera.Projection, lights );
+
+            DZ_CHECK( binned.Matches( reference ) );
+            DZ_CHECK( binned.GetStats( ).NumLights == NumLights );
+            DZ_CHECK( binned.GetStats( ).NumLightIndices == reference.GetStats( ).NumLightIndices );
+            DZ_CHECK( binned.GetStats( ).NumLightIndices > 0 );
+            DZ_CHECK( binned.GetStats( ).NumDroppedIndices == 0 );
+            DZ_CHECK( ClusterListsSorted( binned ) );
+            spdlog::info( "LightClusterBuilderTests: {} lights, {} indices, binned {:.2f} ms, brute force {:.2f} ms{}", NumLights, binned.GetStats( ).NumLightIndices,
+                          binned.GetStats( ).BuildMilliseconds, reference.GetStats( ).BuildMilliseconds, executor ? " (parallel)" : "" );
+        }
+    }
+
+    // Both builds drop the same indices once MaxLightIndices is reached
+    void IndexBudget( )
+    {
+        std::mt19937            random( 11 );
+        const Camera            camera = MakeCamera( XMVectorSet( 0.0f, 2.0f, -5.0f, 1.0f ), XMVectorSet( 0.0f, 0.0f, 60.0f, 1.0f ) );
+        const auto              lights = RandomLights( random, NumLights );
+        LightClusterBuilderDesc desc{ };
+        desc.MaxLights       = NumLights;
+        desc.MaxLightIndices = 2048;
+        LightClusterBuilder binned( desc );
+        LightClusterBuilder reference( desc );
+        binned.Build( camera.View, camera.Projection, lights );
+        reference.BuildReference( camera.View, camera.Projection, lights );
+
+        DZ_CHECK( binned.Matches( reference ) );
+        DZ_CHECK( binned.GetStats( ).NumLightIndices == desc.MaxLightIndices );
+        DZ_CHECK( binned.GetStats( ).NumDroppedIndices > 0 );
+        DZ_CHECK( binned.GetStats( ).NumDroppedIndices == reference.GetStats( ).NumDroppedIndices );
+    }
+
+    // A light behind the camera touches no cluster, one in front of it at least one
+    void Visibility( )
+    {
+        const Camera            camera = MakeCamera( XMVectorSet( 0.0f, 0.0f, 0.0f, 1.0f ), XMVectorSet( 0.0f, 0.0f, 1.0f, 1.0f ) );
+        LightClusterBuilderDesc desc{ };
+        LightClusterBuilder     builder( desc );
+
+        builder.Build( camera.View, camera.Projection, { ClusterLightBounds{ Float3{ 0.0f, 0.0f, -20.0f }, 5.0f } } );
+        DZ_CHECK( builder.GetStats( ).NumLightIndices == 0 );
+
+        builder.Build( camera.View, camera.Projection, { ClusterLightBounds{ Float3{ 0.0f, 0.0f, 20.0f }, 1.0f } } );
+        DZ_CHECK( builder.GetStats( ).NumLightIndices > 0 );
+        DZ_CHECK( builder.GetStats( ).MaxLightsPerCluster == 1 );
+
+        builder.Reset( );
+        DZ_CHECK( builder.GetStats( ).NumLightIndices == 0 );
+    }
+} // namespace
+
+int main( )
+{
+    BuildMatchesReference( nullptr );
+    tf::Executor executor;
+    BuildMatchesReference( &executor );
+    IndexBudget( );
+    Visibility( );
+    return DZTests::Result( );
+}
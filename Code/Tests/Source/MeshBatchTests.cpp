@@ -0,0 +1,406 @@
+/*
+Den Of Iz - Game/Game Engine
+Copyright (c) 2020-2024 Muhammed Murat Cengiz
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+#include <cstring>
+#include <set>
+#include <thread>
+#include "DZEngine/Assets/MeshBatch.h"
+#include "DZEngine/Assets/StaticMeshVertex.h"
+#include "DZTests/Check.h"
+#include "DZTests/FakeDevice.h"
+
+using namespace DZEngine;
+using namespace DZTests;
+
+namespace
+{
+    constexpr uint32_t NumThreads         = 8;
+    constexpr uint32_t NumMeshesPerThread = 48;
+
+    struct TestMesh
+    {
+        MeshHandle Handle;
+        uint32_t   Id          = 0;
+        uint32_t   NumVertices = 0;
+    };
+
+    // Positions encode the mesh and the vertex, so the pool contents show which upload landed where
+    TestMesh AddTestMesh( MeshBatch &batch, const uint32_t id )
+    {
+        const uint32_t                  numVertices = 3 * ( 1 + id % 50 );
+        std::vector<GeometryVertexData> vertices( numVertices );
+        std::vector<uint32_t>           indices( numVertices );
+        for ( uint32_t i = 0; i < numVertices; ++i )
+        {
+            vertices[ i ].Position = { static_cast<float>( id ), static_cast<float>( i ), 0.0f };
+            vertices[ i ].Normal   = { 0.0f, 0.0f, 1.0f };
+            indices[ i ]           = i;
+        }
+
+        GeometryData geometry;
+        geometry.Vertices    = GeometryVertexDataArray{ vertices.data( ), numVertices };
+        geometry.Indices     = UInt32Array{ indices.data( ), indices.size( ) };
+        const GPUMesh mesh   = batch.AddGeometry( &geometry, "Mesh" + std::to_string( id ) );
+        const bool    hasOne = mesh.SubMeshes.size( ) == 1;
+        return TestMesh{ hasOne ? mesh.SubMeshes[ 0 ].Handle : MeshHandle( ), id, numVertices };
+    }
+
+    bool MatchesPool( const MeshBatch &batch, const TestMesh &mesh )
+    {
+        const GPUSubMesh subMesh = batch.GetSubMesh( mesh.Handle );
+        if ( !subMesh.VertexBuffer.Buffer || !subMesh.IndexBuffer.Buffer || subMesh.IndexType != IndexType::Uint16 )
+        {
+            return false;
+        }
+
+        const auto *vertices = reinterpret_cast<const StaticMeshVertex *>( static_cast<FakeBuffer *>( subMesh.VertexBuffer.Buffer )->Bytes( ) + subMesh.VertexBuffer.Offset );
+        const auto *indices  = reinterpret_cast<const uint16_t *>( static_cast<FakeBuffer *>( subMesh.IndexBuffer.Buffer )->Bytes( ) + subMesh.IndexBuffer.Offset );
+        for ( uint32_t i = 0; i < mesh.NumVertices; ++i )
+        {
+            if ( vertices[ i ].Position.X != static_cast<float>( mesh.Id ) || vertices[ i ].Position.Y != static_cast<float>( i ) || indices[ i ] != i )
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Byte ranges of the live submeshes must never share a byte
+    template <typename RangeOf>
+    bool RangesAreDisjoint( const MeshBatch &batch, const std::vector<TestMesh> &meshes, RangeOf rangeOf )
+    {
+        std::vector<std::pair<size_t, size_t>> ranges;
+        for ( const TestMesh &mesh : meshes )
+        {
+            const GPUBufferView view = rangeOf( batch.GetSubMesh( mesh.Handle ) );
+            ranges.emplace_back( view.Offset, view.Offset + view.NumBytes );
+        }
+        std::ranges::sort( ranges );
+        for ( size_t i = 1; i < ranges.size( ); ++i )
+        {
+            if ( ranges[ i - 1 ].second > ranges[ i ].first )
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void CheckBatch( const MeshBatch &batch, const std::vector<TestMesh> &meshes )
+    {
+        std::set<uint32_t> ids;
+        size_t             numVertexBytes = 0;
+        for ( const TestMesh &mesh : meshes )
+        {
+            DZ_CHECK( mesh.Handle.IsValid( ) );
+            DZ_CHECK( MatchesPool( batch, mesh ) );
+            ids.insert( mesh.Handle.Id );
+            numVertexBytes += mesh.NumVertices * sizeof( StaticMeshVertex );
+        }
+        DZ_CHECK( ids.size( ) == meshes.size( ) );
+        DZ_CHECK( RangesAreDisjoint( batch, meshes, []( const GPUSubMesh &subMesh ) { return subMesh.VertexBuffer; } ) );
+        DZ_CHECK( RangesAreDisjoint( batch, meshes, []( const GPUSubMesh &subMesh ) { return subMesh.IndexBuffer; } ) );
+        DZ_CHECK( batch.GetGeometryUsage( ).UsedVertexBytes == numVertexBytes );
+    }
+
+    // Every thread adds its meshes and resolves each handle right after publishing it, ids are unique across threads.
+    // The calling thread adds meshes too, it records into the list of BeginUpdate.
+    std::vector<TestMesh> AddConcurrently( MeshBatch &batch, const uint32_t firstId, bool &allResolved )
+    {
+        std::vector<std::vector<TestMesh>> threadMeshes( NumThreads + 1 );
+        std::vector<uint8_t>               threadResolved( NumThreads + 1, 1 );
+        const auto                         addMeshes = [ & ]( const uint32_t thread )
+        {
+            for ( uint32_t i = 0; i < NumMeshesPerThread; ++i )
+            {
+                const TestMesh mesh = AddTestMesh( batch, firstId + thread * NumMeshesPerThread + i );
+                threadResolved[ thread ] &= batch.GetMeshMetadata( mesh.Handle ) != nullptr;
+                threadMeshes[ thread ].push_back( mesh );
+            }
+        };
+
+        std::vector<std::thread> threads;
+        for ( uint32_t thread = 0; thread < NumThreads; ++thread )
+        {
+            threads.emplace_back( addMeshes, thread );
+        }
+        addMeshes( NumThreads );
+        for ( std::thread &thread : threads )
+        {
+            thread.join( );
+        }
+
+        allResolved = std::ranges::all_of( threadResolved, []( const uint8_t resolved ) { return resolved != 0; } );
+        std::vector<TestMesh> meshes;
+        for ( const std::vector<TestMesh> &added : threadMeshes )
+        {
+            meshes.insert( meshes.end( ), added.begin( ), added.end( ) );
+        }
+        return meshes;
+    }
+
+    MeshBatchDesc TestBatchDesc( FakeLogicalDevice &device, GeometryPool &pool )
+    {
+        MeshBatchDesc desc{ };
+        desc.LogicalDevice        = &device;
+        desc.Pool                 = &pool;
+        desc.OptimizeGeometry     = false; // Keeps the vertex order the test wrote
+        desc.ReservedVertexBytes  = 0;
+        desc.ReservedIndexBytes   = 0;
+        desc.UploadBufferNumBytes = 262144; // Small enough that the later uploads are staged
+        return desc;
+    }
+
+    // Small pages make the pool grow many times while other threads are recording uploads
+    GeometryPoolDesc TestPoolDesc( FakeLogicalDevice &device )
+    {
+        GeometryPoolDesc desc{ };
+        desc.LogicalDevice = &device;
+        desc.PageBytes     = 65536;
+        return desc;
+    }
+
+    // Threads race to allocate, grow the pool, upload and publish, every upload lands in the range its handle resolves to
+    void ConcurrentAdd( )
+    {
+        FakeLogicalDevice device;
+        GeometryPool      pool( TestPoolDesc( device ) );
+        MeshBatch         batch( TestBatchDesc( device, pool ) );
+
+        batch.BeginUpdate( );
+        bool                        allResolved = false;
+        const std::vector<TestMesh> meshes      = AddConcurrently( batch, 0, allResolved );
+        batch.EndUpdate( nullptr );
+
+        DZ_CHECK( allResolved );
+        DZ_CHECK( meshes.size( ) == ( NumThreads + 1 ) * NumMeshesPerThread );
+        DZ_CHECK( batch.IsUpdateComplete( ) );
+        CheckBatch( batch, meshes );
+
+        const GeometryPoolStats    poolStats   = batch.GetPoolStats( );
+        const MeshBatchUploadStats uploadStats = batch.GetUploadStats( );
+        DZ_CHECK( poolStats.NumGrowths > 1 );
+        DZ_CHECK( uploadStats.NumUploadedBytes > 0 && uploadStats.NumStagedBytes > 0 );
+        DZ_CHECK( device.GetStats( ).NumExecutedCopies > 0 );
+
+        // The retired buffers were flushed before the growth copies, the current ones hold everything
+        pool.ReleaseRetiredBuffers( );
+        CheckBatch( batch, meshes );
+    }
+
+    // Removing from several threads while others add reuses mesh slots without ever handing out a removed handle again
+    void ConcurrentRemoveAndAdd( )
+    {
+        FakeLogicalDevice device;
+        GeometryPool      pool( TestPoolDesc( device ) );
+        MeshBatch         batch( TestBatchDesc( device, pool ) );
+
+        batch.BeginUpdate( );
+        bool                  allResolved = false;
+        std::vector<TestMesh> meshes      = AddConcurrently( batch, 0, allResolved );
+        batch.EndUpdate( nullptr );
+
+        std::vector<TestMesh> removed;
+        std::vector<TestMesh> kept;
+        for ( size_t i = 0; i < meshes.size( ); ++i )
+        {
+            ( i % 2 == 0 ? removed : kept ).push_back( meshes[ i ] );
+        }
+
+        batch.BeginUpdate( );
+        std::vector<uint8_t>     removedOk( NumThreads, 1 );
+        std::vector<std::thread> removers;
+        for ( uint32_t thread = 0; thread < NumThreads; ++thread )
+        {
+            removers.emplace_back(
+                [ &, thread ]
+                {
+                    for ( size_t i = thread; i < removed.size( ); i += NumThreads )
+                    {
+                        removedOk[ thread ] &= batch.RemoveMesh( removed[ i ].Handle );
+                    }
+                } );
+        }
+        std::vector<TestMesh> added = AddConcurrently( batch, static_cast<uint32_t>( meshes.size( ) ), allResolved );
+        for ( std::thread &thread : removers )
+        {
+            thread.join( );
+        }
+        batch.EndUpdate( nullptr );
+
+        DZ_CHECK( allResolved );
+        DZ_CHECK( std::ranges::all_of( removedOk, []( const uint8_t ok ) { return ok != 0; } ) );
+        std::set<uint32_t> removedIds;
+        for ( const TestMesh &mesh : removed )
+        {
+            DZ_CHECK( batch.GetMeshMetadata( mesh.Handle ) == nullptr );
+            removedIds.insert( mesh.Handle.Id );
+        }
+        for ( const TestMesh &mesh : added )
+        {
+            DZ_CHECK( !removedIds.contains( mesh.Handle.Id ) );
+        }
+
+        kept.insert( kept.end( ), added.begin( ), added.end( ) );
+        CheckBatch( batch, kept );
+    }
+
+    // Compacting moves the live ranges into the holes, their contents follow and the sources stay allocated until released, not alongside uploads
+    void Defragment( )
+    {
+        FakeLogicalDevice device;
+        GeometryPool      pool( TestPoolDesc( device ) );
+        MeshBatch         batch( TestBatchDesc( device, pool ) );
+
+        batch.BeginUpdate( );
+        bool                  allResolved = false;
+        std::vector<TestMesh> meshes      = AddConcurrently( batch, 0, allResolved );
+        // The uploads of the other threads aren't ordered against the moves on the GPU
+        DZ_CHECK( batch.Defragment( SIZE_MAX ) == 0 );
+        batch.EndUpdate( nullptr );
+
+        batch.BeginUpdate( );
+        std::vector<TestMesh> kept;
+        for ( size_t i = 0; i < meshes.size( ); ++i )
+        {
+            if ( i % 3 == 0 )
+            {
+                batch.RemoveMesh( meshes[ i ].Handle );
+                continue;
+            }
+            kept.push_back( meshes[ i ] );
+        }
+        DZ_CHECK( batch.NeedsDefragment( ) );
+        DZ_CHECK( batch.Defragment( SIZE_MAX ) > 0 );
+        // Removed while its move is in flight, the move is dropped
+        DZ_CHECK( batch.RemoveMesh( kept.back( ).Handle ) );
+        kept.pop_back( );
+        batch.EndUpdate( nullptr );
+
+        DZ_CHECK( batch.GetDefragmentVersion( ) == 1 );
+        CheckBatch( batch, kept );
+
+        const size_t usedVertexBytes = batch.GetGeometryUsage( ).UsedVertexBytes;
+        DZ_CHECK( batch.GetPoolStats( ).Vertices.UsedSize * sizeof( StaticMeshVertex ) > usedVertexBytes );
+        batch.ReleaseDefragmentSources( batch.GetDefragmentVersion( ) );
+        DZ_CHECK( batch.GetPoolStats( ).Vertices.UsedSize * sizeof( StaticMeshVertex ) == usedVertexBytes );
+        CheckBatch( batch, kept );
+    }
+
+    // Indices count down from the last vertex, so the largest index is the first one written
+    std::vector<uint32_t> BoundaryIndices( const uint32_t numVertices )
+    {
+        std::vector<uint32_t> indices( ( numVertices + 2 ) / 3 * 3 );
+        for ( uint32_t i = 0; i < indices.size( ); ++i )
+        {
+            indices[ i ] = numVertices - 1 - i % numVertices;
+        }
+        return indices;
+    }
+
+    // The pool holds the indices the mesh was added with in the width picked for its vertex count
+    template <typename Index>
+    bool MatchesIndices( const GPUSubMesh &subMesh, const std::vector<uint32_t> &indices )
+    {
+        if ( subMesh.IndexBuffer.NumBytes != indices.size( ) * sizeof( Index ) || subMesh.Metadata->IndexType != subMesh.IndexType )
+        {
+            return false;
+        }
+        const auto *vertices = reinterpret_cast<const StaticMeshVertex *>( static_cast<FakeBuffer *>( subMesh.VertexBuffer.Buffer )->Bytes( ) + subMesh.VertexBuffer.Offset );
+        const Byte *pool     = static_cast<FakeBuffer *>( subMesh.IndexBuffer.Buffer )->Bytes( ) + subMesh.IndexBuffer.Offset;
+        for ( size_t i = 0; i < indices.size( ); ++i )
+        {
+            Index index;
+            std::memcpy( &index, pool + i * sizeof( Index ), sizeof( Index ) );
+            if ( index != indices[ i ] || vertices[ index ].Position.Y != static_cast<float>( indices[ i ] ) )
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Submeshes addressing at most 65536 vertices narrow their indices to 16 bits without changing them, one more vertex keeps 32 bits
+    void IndexWidth( )
+    {
+        FakeLogicalDevice device;
+        GeometryPool      pool( TestPoolDesc( device ) );
+        MeshBatch         batch( TestBatchDesc( device, pool ) );
+
+        constexpr uint32_t   NumVertices[]   = { 65535, 65536, 65537 };
+        constexpr IndexType  ExpectedTypes[] = { IndexType::Uint16, IndexType::Uint16, IndexType::Uint32 };
+        std::vector<GPUMesh> meshes;
+        batch.BeginUpdate( );
+        for ( const uint32_t numVertices : NumVertices )
+        {
+            std::vector<GeometryVertexData> vertices( numVertices );
+            for ( uint32_t i = 0; i < numVertices; ++i )
+            {
+                vertices[ i ].Position = { 0.0f, static_cast<float>( i ), 0.0f };
+            }
+            std::vector<uint32_t> indices = BoundaryIndices( numVertices );
+
+            GeometryData geometry;
+            geometry.Vertices = GeometryVertexDataArray{ vertices.data( ), numVertices };
+            geometry.Indices  = UInt32Array{ indices.data( ), indices.size( ) };
+            meshes.push_back( batch.AddGeometry( &geometry, "Mesh" + std::to_string( numVertices ) ) );
+        }
+        batch.EndUpdate( nullptr );
+
+        size_t numIndexBytes16 = 0;
+        for ( size_t i = 0; i < meshes.size( ); ++i )
+        {
+            DZ_CHECK( meshes[ i ].SubMeshes.size( ) == 1 );
+            if ( meshes[ i ].SubMeshes.size( ) != 1 )
+            {
+                continue;
+            }
+            const GPUSubMesh            subMesh = batch.GetSubMesh( meshes[ i ].SubMeshes[ 0 ].Handle );
+            const std::vector<uint32_t> indices = BoundaryIndices( NumVertices[ i ] );
+            DZ_CHECK( subMesh.IndexType == ExpectedTypes[ i ] );
+            DZ_CHECK( ExpectedTypes[ i ] == IndexType::Uint16 ? MatchesIndices<uint16_t>( subMesh, indices ) : MatchesIndices<uint32_t>( subMesh, indices ) );
+            numIndexBytes16 += ExpectedTypes[ i ] == IndexType::Uint16 ? subMesh.IndexBuffer.NumBytes : 0;
+        }
+        DZ_CHECK( batch.GetNumIndexBytes( IndexType::Uint16 ) == numIndexBytes16 );
+        DZ_CHECK( batch.GetNumIndexBytes( IndexType::Uint32 ) == BoundaryIndices( 65537 ).size( ) * sizeof( uint32_t ) );
+
+        // Without 16 bit indices every submesh keeps the width it was added with
+        MeshBatchDesc desc     = TestBatchDesc( device, pool );
+        desc.Allow16BitIndices = false;
+        MeshBatch wideBatch( desc );
+        wideBatch.BeginUpdate( );
+        std::vector<GeometryVertexData> vertices( 3 );
+        std::vector<uint32_t>           indices = BoundaryIndices( 3 );
+        GeometryData                    geometry;
+        geometry.Vertices    = GeometryVertexDataArray{ vertices.data( ), 3 };
+        geometry.Indices     = UInt32Array{ indices.data( ), indices.size( ) };
+        const GPUMesh mesh   = wideBatch.AddGeometry( &geometry, "Triangle" );
+        wideBatch.EndUpdate( nullptr );
+        DZ_CHECK( mesh.SubMeshes.size( ) == 1 && wideBatch.GetSubMesh( mesh.SubMeshes[ 0 ].Handle ).IndexType == IndexType::Uint32 );
+    }
+} // namespace
+
+int main( )
+{
+    ConcurrentAdd( );
+    ConcurrentRemoveAndAdd( );
+    Defragment( );
+    IndexWidth( );
+    return DZTests::Result( );
+}
@@ -0,0 +1,321 @@
+/*
+Den Of Iz - Game/Game Engine
+Copyright (c) 2020-2024 Muhammed Murat Cengiz
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <numbers>
+#include <random>
+#include <vector>
+#include "DZEngine/Assets/MeshOptimizer.h"
+#include "DZTests/Check.h"
+
+using namespace DZEngine;
+
+namespace
+{
+    struct Vertex
+    {
+        float X, Y, Z;
+        float U, V;
+    };
+
+    struct TestMesh
+    {
+        std::vector<Vertex>   Vertices;
+        std::vector<uint32_t> Indices;
+    };
+
+    using TriangleKey = std::array<float, 9>;
+
+    TestMesh Sphere( const uint32_t segments, const uint32_t rings )
+    {
+        TestMesh mesh;
+        for ( uint32_t r = 0; r <= rings; ++r )
+        {
+            for ( uint32_t s = 0; s <= segments; ++s )
+            {
+                const float theta = std::numbers::pi_v<float> * r / rings;
+                const float phi   = 2.0f * std::numbers::pi_v<float> * s / segments;
+                const float u     = static_cast<float>( s ) / segments;
+                const float v     = static_cast<float>( r ) / rings;
+                mesh.Vertices.push_back( Vertex{ std::sin( theta ) * std::cos( phi ), std::cos( theta ), std::sin( theta ) * std::sin( phi ), u, v } );
+            }
+        }
+        for ( uint32_t r = 0; r < rings; ++r )
+        {
+            for ( uint32_t s = 0; s < segments; ++s )
+            {
+                const uint32_t a = r * ( segments + 1 ) + s;
+                const uint32_t b = a + segments + 1;
+                mesh.Indices.insert( mesh.Indices.end( ), { a, b, a + 1, a + 1, b, b + 1 } );
+            }
+        }
+        return mesh;
+    }
+
+    // Concave, so unlike the sphere the triangle order decides how much is overdrawn
+    TestMesh Torus( const uint32_t segments, const uint32_t sides )
+    {
+        TestMesh mesh;
+        for ( uint32_t s = 0; s <= segments; ++s )
+        {
+            for ( uint32_t t = 0; t <= sides; ++t )
+            {
+                const float a      = 2.0f * std::numbers::pi_v<float> * s / segments;
+                const float b      = 2.0f * std::numbers::pi_v<float> * t / sides;
+                const float radius = 1.0f + 0.3f * std::cos( b );
+                const float u      = static_cast<float>( s ) / segments;
+                const float v      = static_cast<float>( t ) / sides;
+                mesh.Vertices.push_back( Vertex{ radius * std::cos( a ), 0.3f * std::sin( b ), radius * std::sin( a ), u, v } );
+            }
+        }
+        for ( uint32_t s = 0; s < segments; ++s )
+        {
+            for ( uint32_t t = 0; t < sides; ++t )
+            {
+                const uint32_t a = s * ( sides + 1 ) + t;
+                const uint32_t b = a + sides + 1;
+                mesh.Indices.insert( mesh.Indices.end( ), { a, a + 1, b, a + 1, b + 1, b } );
+            }
+        }
+        return mesh;
+    }
+
+    // Like an unoptimized export: triangles in random order, every corner its own vertex
+    TestMesh ShuffleAndUnindex( const TestMesh &mesh )
+    {
+        std::vector<uint32_t> triangles( mesh.Indices.size( ) / 3 );
+        for ( uint32_t i = 0; i < triangles.size( ); ++i )
+        {
+            triangles[ i ] = i;
+        }
+        std::mt19937 random( 1 );
+        std::ranges::shuffle( triangles, random );
+
+        TestMesh result;
+        for ( const uint32_t triangle : triangles )
+        {
+            for ( uint32_t corner = 0; corner < 3; ++corner )
+            {
+                result.Vertices.push_back( mesh.Vertices[ mesh.Indices[ triangle * 3 + corner ] ] );
+                result.Indices.push_back( static_cast<uint32_t>( result.Indices.size( ) ) );
+            }
+        }
+        return result;
+    }
+
+    Byte *Bytes( std::vector<Vertex> &vertices )
+    {
+        return reinterpret_cast<Byte *>( vertices.data( ) );
+    }
+
+    // Sorted corner positions of every triangle, equal when two meshes draw the same triangles with the same winding
+    std::vector<TriangleKey> Triangles( const float *positions, const size_t stride, const std::vector<uint32_t> &indices )
+    {
+        std::vector<TriangleKey> triangles;
+        for ( size_t i = 0; i + 2 < indices.size( ); i += 3 )
+        {
+            TriangleKey key{ };
+            for ( uint32_t corner = 0; corner < 3; ++corner )
+            {
+                for ( uint32_t axis = 0; axis < 3; ++axis )
+                {
+                    key[ corner * 3 + axis ] = positions[ indices[ i + corner ] * stride + axis ];
+                }
+            }
+            // Rotating a triangle keeps its winding, the stages may start it at any corner
+            const TriangleKey rotated1{ key[ 3 ], key[ 4 ], key[ 5 ], key[ 6 ], key[ 7 ], key[ 8 ], key[ 0 ], key[ 1 ], key[ 2 ] };
+            const TriangleKey rotated2{ key[ 6 ], key[ 7 ], key[ 8 ], key[ 0 ], key[ 1 ], key[ 2 ], key[ 3 ], key[ 4 ], key[ 5 ] };
+            triangles.push_back( std::min( { key, rotated1, rotated2 } ) );
+        }
+        std::ranges::sort( triangles );
+        return triangles;
+    }
+
+    std::vector<TriangleKey> Triangles( const std::vector<Vertex> &vertices, const std::vector<uint32_t> &indices )
+    {
+        return Triangles( &vertices[ 0 ].X, sizeof( Vertex ) / sizeof( float ), indices );
+    }
+
+    // The analyzers on orders whose results are known by hand
+    void AnalyzeKnownOrders( )
+    {
+        const std::vector<uint32_t> triangle{ 0, 1, 2 };
+        MeshVertexCacheStats        cache = MeshOptimizer::AnalyzeVertexCache( triangle, 3 );
+        DZ_CHECK( cache.NumTransformed == 3 );
+        DZ_CHECK_NEAR( cache.ACMR, 3.0f, 1e-6f );
+        DZ_CHECK_NEAR( cache.ATVR, 1.0f, 1e-6f );
+
+        // The second triangle of the quad only transforms its new vertex
+        const std::vector<uint32_t> quad{ 0, 1, 2, 2, 1, 3 };
+        cache = MeshOptimizer::AnalyzeVertexCache( quad, 4 );
+        DZ_CHECK( cache.NumTransformed == 4 );
+        DZ_CHECK_NEAR( cache.ACMR, 2.0f, 1e-6f );
+
+        // A cache of 3 has evicted vertex 0 by the time the last triangle uses it again
+        const std::vector<uint32_t> fan{ 0, 1, 2, 3, 4, 5, 0, 1, 2 };
+        DZ_CHECK( MeshOptimizer::AnalyzeVertexCache( fan, 6, 3 ).NumTransformed == 9 );
+        DZ_CHECK( MeshOptimizer::AnalyzeVertexCache( fan, 6, 6 ).NumTransformed == 6 );
+
+        // Vertices read in order touch every byte once
+        TestMesh sphere = Sphere( 16, 8 );
+        DZ_CHECK_NEAR( MeshOptimizer::AnalyzeVertexFetch( sphere.Indices, sphere.Vertices.size( ), sizeof( Vertex ) ).Overfetch, 1.0f, 0.2f );
+        // A convex mesh is never overdrawn whatever its order
+        const MeshOverdrawStats overdraw = MeshOptimizer::AnalyzeOverdraw( sphere.Indices, Bytes( sphere.Vertices ), sphere.Vertices.size( ), sizeof( Vertex ) );
+        DZ_CHECK( overdraw.NumCovered > 0 );
+        DZ_CHECK_NEAR( overdraw.Overdraw, 1.0f, 0.01f );
+    }
+
+    // Optimize restores the shared vertices of a shuffled, unindexed mesh and reaches near ideal cache and overdraw figures
+    void OptimizeShuffledMeshes( )
+    {
+        for ( const TestMesh &source : { Sphere( 128, 64 ), Torus( 192, 64 ) } )
+        {
+            TestMesh                   mesh           = ShuffleAndUnindex( source );
+            const MeshVertexCacheStats before         = MeshOptimizer::AnalyzeVertexCache( mesh.Indices, mesh.Vertices.size( ) );
+            const MeshOverdrawStats    beforeOverdraw = MeshOptimizer::AnalyzeOverdraw( mesh.Indices, Bytes( mesh.Vertices ), mesh.Vertices.size( ), sizeof( Vertex ) );
+            DZ_CHECK_NEAR( before.ACMR, 3.0f, 1e-6f );
+
+            const size_t numVertices = MeshOptimizer::Optimize( Bytes( mesh.Vertices ), mesh.Vertices.size( ), sizeof( Vertex ), mesh.Indices );
+            mesh.Vertices.resize( numVertices );
+            DZ_CHECK( numVertices == source.Vertices.size( ) );
+            DZ_CHECK( mesh.Indices.size( ) == source.Indices.size( ) );
+            DZ_CHECK( std::ranges::all_of( mesh.Indices, [ & ]( const uint32_t index ) { return index < numVertices; } ) );
+            DZ_CHECK( Triangles( mesh.Vertices, mesh.Indices ) == Triangles( source.Vertices, source.Indices ) );
+
+            const MeshVertexCacheStats after = MeshOptimizer::AnalyzeVertexCache( mesh.Indices, numVertices );
+            DZ_CHECK( after.ACMR < 0.8f );
+            DZ_CHECK( after.ATVR < 1.6f );
+            const MeshOverdrawStats overdraw = MeshOptimizer::AnalyzeOverdraw( mesh.Indices, Bytes( mesh.Vertices ), numVertices, sizeof( Vertex ) );
+            DZ_CHECK( overdraw.NumCovered == beforeOverdraw.NumCovered );
+            DZ_CHECK( overdraw.Overdraw < 1.05f );
+            DZ_CHECK( overdraw.Overdraw <= beforeOverdraw.Overdraw + 0.01f );
+            DZ_CHECK( MeshOptimizer::AnalyzeVertexFetch( mesh.Indices, numVertices, sizeof( Vertex ) ).Overfetch < 2.0f );
+        }
+    }
+
+    // The cache order alone draws the torus back to front, OptimizeOverdraw fixes that within its ACMR threshold
+    void OverdrawWithinThreshold( )
+    {
+        TestMesh mesh = Torus( 192, 64 );
+        MeshOptimizer::OptimizeVertexCache( mesh.Indices, mesh.Vertices.size( ) );
+        const float             cacheACMR     = MeshOptimizer::AnalyzeVertexCache( mesh.Indices, mesh.Vertices.size( ) ).ACMR;
+        const MeshOverdrawStats cacheOverdraw = MeshOptimizer::AnalyzeOverdraw( mesh.Indices, Bytes( mesh.Vertices ), mesh.Vertices.size( ), sizeof( Vertex ) );
+
+        const std::vector<uint32_t> cacheOrder = mesh.Indices;
+        MeshOptimizer::OptimizeOverdraw( mesh.Indices, Bytes( mesh.Vertices ), mesh.Vertices.size( ), sizeof( Vertex ) );
+        const float             acmr     = MeshOptimizer::AnalyzeVertexCache( mesh.Indices, mesh.Vertices.size( ) ).ACMR;
+        const MeshOverdrawStats overdraw = MeshOptimizer::AnalyzeOverdraw( mesh.Indices, Bytes( mesh.Vertices ), mesh.Vertices.size( ), sizeof( Vertex ) );
+
+        DZ_CHECK( Triangles( mesh.Vertices, mesh.Indices ) == Triangles( mesh.Vertices, cacheOrder ) );
+        DZ_CHECK( overdraw.NumCovered == cacheOverdraw.NumCovered );
+        DZ_CHECK( overdraw.Overdraw - 1.0f < 0.25f * ( cacheOverdraw.Overdraw - 1.0f ) );
+        DZ_CHECK( acmr <= cacheACMR * MeshOptimizer::OverdrawThreshold + 1e-4f );
+
+        // A threshold of 1 gives up no cache hits beyond the misses where clusters are reordered
+        std::vector<uint32_t> strict = cacheOrder;
+        MeshOptimizer::OptimizeOverdraw( strict, Bytes( mesh.Vertices ), mesh.Vertices.size( ), sizeof( Vertex ), 1.0f );
+        DZ_CHECK( MeshOptimizer::AnalyzeVertexCache( strict, mesh.Vertices.size( ) ).ACMR <= cacheACMR * 1.001f );
+    }
+
+    // Vertices in first use order read less memory than vertices in random order
+    void VertexFetchOrder( )
+    {
+        TestMesh              mesh = Sphere( 64, 32 );
+        std::vector<uint32_t> remap( mesh.Vertices.size( ) );
+        for ( uint32_t i = 0; i < remap.size( ); ++i )
+        {
+            remap[ i ] = i;
+        }
+        std::mt19937 random( 2 );
+        std::ranges::shuffle( remap, random );
+        std::vector<Vertex> shuffled( mesh.Vertices.size( ) );
+        for ( uint32_t i = 0; i < remap.size( ); ++i )
+        {
+            shuffled[ remap[ i ] ] = mesh.Vertices[ i ];
+        }
+        for ( uint32_t &index : mesh.Indices )
+        {
+            index = remap[ index ];
+        }
+        mesh.Vertices = shuffled;
+        MeshOptimizer::OptimizeVertexCache( mesh.Indices, mesh.Vertices.size( ) );
+
+        const TestMesh copy   = mesh;
+        const float    before = MeshOptimizer::AnalyzeVertexFetch( mesh.Indices, mesh.Vertices.size( ), sizeof( Vertex ) ).Overfetch;
+        const size_t   count  = MeshOptimizer::OptimizeVertexFetch( Bytes( mesh.Vertices ), mesh.Vertices.size( ), sizeof( Vertex ), mesh.Indices );
+        const float    after  = MeshOptimizer::AnalyzeVertexFetch( mesh.Indices, count, sizeof( Vertex ) ).Overfetch;
+
+        DZ_CHECK( count == copy.Vertices.size( ) );
+        DZ_CHECK( after < before );
+        DZ_CHECK( after < 1.5f );
+        mesh.Vertices.resize( count );
+        DZ_CHECK( Triangles( mesh.Vertices, mesh.Indices ) == Triangles( copy.Vertices, copy.Indices ) );
+    }
+
+    // Degenerate, duplicated and partial input keeps its triangles and never indexes past the vertices left
+    void RandomMeshes( )
+    {
+        // Without a triangle the vertices are left alone
+        std::vector<uint32_t> partial{ 0, 1 };
+        std::vector<float>    positions( 12 );
+        DZ_CHECK( MeshOptimizer::Optimize( reinterpret_cast<Byte *>( positions.data( ) ), 4, 3 * sizeof( float ), partial ) == 4 );
+        DZ_CHECK( partial.empty( ) );
+
+        std::mt19937 random( 3 );
+        for ( uint32_t iteration = 0; iteration < 200; ++iteration )
+        {
+            const size_t numVertices = 1 + random( ) % 200;
+            positions.resize( numVertices * 3 );
+            for ( float &position : positions )
+            {
+                position = static_cast<float>( random( ) % 5 ); // Few distinct values, many duplicate vertices
+            }
+            std::vector<uint32_t> indices( random( ) % 400 );
+            for ( uint32_t &index : indices )
+            {
+                index = static_cast<uint32_t>( random( ) % numVertices );
+            }
+
+            const std::vector<float> sourcePositions = positions;
+            std::vector<uint32_t>    sourceIndices   = indices;
+            const size_t             count           = MeshOptimizer::Optimize( reinterpret_cast<Byte *>( positions.data( ) ), numVertices, 3 * sizeof( float ), indices );
+
+            sourceIndices.resize( sourceIndices.size( ) / 3 * 3 );
+            const bool sameSize  = indices.size( ) == sourceIndices.size( );
+            const bool inRange   = std::ranges::all_of( indices, [ & ]( const uint32_t index ) { return index < count; } );
+            const bool sameShape = Triangles( positions.data( ), 3, indices ) == Triangles( sourcePositions.data( ), 3, sourceIndices );
+            if ( !DZ_CHECK( sameSize && inRange && sameShape ) )
+            {
+                spdlog::error( "Random mesh {} with {} vertices and {} indices", iteration, numVertices, sourceIndices.size( ) );
+                break;
+            }
+        }
+    }
+} // namespace
+
+int main( )
+{
+    AnalyzeKnownOrders( );
+    OptimizeShuffledMeshes( );
+    OverdrawWithinThreshold( );
+    VertexFetchOrder( );
+    RandomMeshes( );
+    return DZTests::Result( );
+}
@@ -0,0 +1,326 @@
+/*
+Den Of Iz - Game/Game Engine
+Copyright (c) 2020-2024 Muhammed Murat Cengiz
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <cmath>
+#include <map>
+#include <numbers>
+#include <tuple>
+#include <vector>
+#include "DZEngine/Assets/MeshSimplifier.h"
+#include "DZTests/Check.h"
+
+using namespace DZEngine;
+
+namespace
+{
+    struct Vertex
+    {
+        float X, Y, Z;
+        float U, V;
+    };
+
+    struct TestMesh
+    {
+        std::vector<Vertex>   Vertices;
+        std::vector<uint32_t> Indices;
+    };
+
+    // Closed, the u seam and the poles are vertices sharing a position
+    TestMesh Sphere( const uint32_t segments, const uint32_t rings )
+    {
+        TestMesh mesh;
+        for ( uint32_t r = 0; r <= rings; ++r )
+        {
+            for ( uint32_t s = 0; s <= segments; ++s )
+            {
+                const float theta = std::numbers::pi_v<float> * r / rings;
+                const float phi   = 2.0f * std::numbers::pi_v<float> * ( s % segments ) / segments;
+                const float ring  = r == 0 || r == rings ? 0.0f : std::sin( theta ); // Exactly shared pole positions
+                const float u     = static_cast<float>( s ) / segments;
+                const float v     = static_cast<float>( r ) / rings;
+                mesh.Vertices.push_back( Vertex{ ring * std::cos( phi ), std::cos( theta ), ring * std::sin( phi ), u, v } );
+            }
+        }
+        for ( uint32_t r = 0; r < rings; ++r )
+        {
+            for ( uint32_t s = 0; s < segments; ++s )
+            {
+                const uint32_t a = r * ( segments + 1 ) + s;
+                const uint32_t b = a + segments + 1;
+                if ( r != 0 )
+                {
+                    mesh.Indices.insert( mesh.Indices.end( ), { a, a + 1, b } );
+                }
+                if ( r != rings - 1 )
+                {
+                    mesh.Indices.insert( mesh.Indices.end( ), { a + 1, b + 1, b } );
+                }
+            }
+        }
+        return mesh;
+    }
+
+    // Closed with seams along both directions
+    TestMesh Torus( const uint32_t segments, const uint32_t sides )
+    {
+        TestMesh mesh;
+        for ( uint32_t s = 0; s <= segments; ++s )
+        {
+            for ( uint32_t t = 0; t <= sides; ++t )
+            {
+                const float a      = 2.0f * std::numbers::pi_v<float> * ( s % segments ) / segments;
+                const float b      = 2.0f * std::numbers::pi_v<float> * ( t % sides ) / sides;
+                const float radius = 1.0f + 0.3f * std::cos( b );
+                const float u      = static_cast<float>( s ) / segments;
+                const float v      = static_cast<float>( t ) / sides;
+                mesh.Vertices.push_back( Vertex{ radius * std::cos( a ), 0.3f * std::sin( b ), radius * std::sin( a ), u, v } );
+            }
+        }
+        for ( uint32_t s = 0; s < segments; ++s )
+        {
+            for ( uint32_t t = 0; t < sides; ++t )
+            {
+                const uint32_t a = s * ( sides + 1 ) + t;
+                const uint32_t b = a + sides + 1;
+                mesh.Indices.insert( mesh.Indices.end( ), { a, a + 1, b, a + 1, b + 1, b } );
+            }
+        }
+        return mesh;
+    }
+
+    // Open, a unit square with gentle hills
+    TestMesh Terrain( const uint32_t size )
+    {
+        TestMesh mesh;
+        for ( uint32_t y = 0; y <= size; ++y )
+        {
+            for ( uint32_t x = 0; x <= size; ++x )
+            {
+                const float u = static_cast<float>( x ) / size;
+                const float v = static_cast<float>( y ) / size;
+                mesh.Vertices.push_back( Vertex{ u, 0.05f * std::sin( x * 0.3f ) * std::cos( y * 0.2f ), v, u, v } );
+            }
+        }
+        for ( uint32_t y = 0; y < size; ++y )
+        {
+            for ( uint32_t x = 0; x < size; ++x )
+            {
+                const uint32_t a = y * ( size + 1 ) + x;
+                const uint32_t b = a + size + 1;
+                mesh.Indices.insert( mesh.Indices.end( ), { a, b, a + 1, a + 1, b, b + 1 } );
+            }
+        }
+        return mesh;
+    }
+
+    MeshSimplifierDesc SimplifierDesc( const TestMesh &mesh )
+    {
+        MeshSimplifierDesc desc{ };
+        desc.Positions      = &mesh.Vertices[ 0 ].X;
+        desc.PositionStride = sizeof( Vertex );
+        desc.NumVertices    = mesh.Vertices.size( );
+        desc.Indices        = mesh.Indices;
+        return desc;
+    }
+
+    // Directed edges between positions without their opposite edge, none for a closed mesh. The vertices of a seam are welded first so a crack
+    // opens edges, the edges are returned as the first vertex of each position.
+    std::vector<std::pair<uint32_t, uint32_t>> OpenEdges( const TestMesh &mesh, const std::vector<uint32_t> &indices )
+    {
+        std::map<std::tuple<float, float, float>, uint32_t> positions;
+        std::vector<uint32_t>                               welded( mesh.Vertices.size( ) );
+        for ( uint32_t i = 0; i < mesh.Vertices.size( ); ++i )
+        {
+            const Vertex &vertex = mesh.Vertices[ i ];
+            welded[ i ]          = positions.try_emplace( { vertex.X, vertex.Y, vertex.Z }, i ).first->second;
+        }
+
+        std::map<std::pair<uint32_t, uint32_t>, uint32_t> edges;
+        for ( size_t i = 0; i + 2 < indices.size( ); i += 3 )
+        {
+            for ( uint32_t corner = 0; corner < 3; ++corner )
+            {
+                ++edges[ { welded[ indices[ i + corner ] ], welded[ indices[ i + ( corner + 1 ) % 3 ] ] } ];
+            }
+        }
+        std::vector<std::pair<uint32_t, uint32_t>> open;
+        for ( const auto &[ edge, count ] : edges )
+        {
+            if ( !edges.contains( { edge.second, edge.first } ) )
+            {
+                open.insert( open.end( ), count, edge );
+            }
+        }
+        return open;
+    }
+
+    // Triangles whose corners come from both sides of a u or v seam, their attributes would be interpolated across the whole texture
+    size_t NumSmearedTriangles( const TestMesh &mesh, const std::vector<uint32_t> &indices )
+    {
+        size_t numSmeared = 0;
+        for ( size_t i = 0; i + 2 < indices.size( ); i += 3 )
+        {
+            const Vertex &a = mesh.Vertices[ indices[ i ] ];
+            const Vertex &b = mesh.Vertices[ indices[ i + 1 ] ];
+            const Vertex &c = mesh.Vertices[ indices[ i + 2 ] ];
+            const float   u = std::max( { std::abs( a.U - b.U ), std::abs( b.U - c.U ), std::abs( a.U - c.U ) } );
+            const float   v = std::max( { std::abs( a.V - b.V ), std::abs( b.V - c.V ), std::abs( a.V - c.V ) } );
+            numSmeared += u > 0.5f || v > 0.5f ? 1 : 0;
+        }
+        return numSmeared;
+    }
+
+    // Triangles facing into the surface. The surfaces are around a ring of ringRadius in the xz plane, 0 for the sphere around the origin.
+    size_t NumInvertedTriangles( const TestMesh &mesh, const std::vector<uint32_t> &indices, const float ringRadius )
+    {
+        size_t numInverted = 0;
+        for ( size_t i = 0; i + 2 < indices.size( ); i += 3 )
+        {
+            const Vertex &a = mesh.Vertices[ indices[ i ] ];
+            const Vertex &b = mesh.Vertices[ indices[ i + 1 ] ];
+            const Vertex &c = mesh.Vertices[ indices[ i + 2 ] ];
+            // Counter clockwise seen from outside
+            const float nx = ( b.Y - a.Y ) * ( c.Z - a.Z ) - ( b.Z - a.Z ) * ( c.Y - a.Y );
+            const float ny = ( b.Z - a.Z ) * ( c.X - a.X ) - ( b.X - a.X ) * ( c.Z - a.Z );
+            const float nz = ( b.X - a.X ) * ( c.Y - a.Y ) - ( b.Y - a.Y ) * ( c.X - a.X );
+
+            const float x      = ( a.X + b.X + c.X ) / 3.0f;
+            const float y      = ( a.Y + b.Y + c.Y ) / 3.0f;
+            const float z      = ( a.Z + b.Z + c.Z ) / 3.0f;
+            const float length = std::hypot( x, z );
+            const float ring   = length > 0.0f ? ringRadius / length : 0.0f;
+            const float ox     = x - x * ring;
+            const float oz     = z - z * ring;
+            // Triangles standing edge-on to the surface (all corners on one meridian) sit at a cosine of zero, only count clearly inward facing ones
+            const float cosine = ( nx * ox + ny * y + nz * oz ) / std::sqrt( ( nx * nx + ny * ny + nz * nz ) * ( ox * ox + y * y + oz * oz ) );
+            numInverted += cosine < -0.1f ? 1 : 0;
+        }
+        return numInverted;
+    }
+
+    // Every level roughly halves the triangles, errors never decrease and closed meshes stay closed with hardly any flipped triangles and no smeared ones
+    void ClosedMeshChains( )
+    {
+        for ( const auto &[ mesh, ringRadius ] : { std::pair( Sphere( 96, 48 ), 0.0f ), std::pair( Torus( 128, 48 ), 1.0f ) } )
+        {
+            DZ_CHECK( OpenEdges( mesh, mesh.Indices ).empty( ) );
+            DZ_CHECK( NumInvertedTriangles( mesh, mesh.Indices, ringRadius ) == 0 );
+
+            MeshLODChainDesc chainDesc{ };
+            chainDesc.NumLevels                    = 5;
+            const std::vector<MeshLODLevel> levels = MeshSimplifier::BuildLODChain( SimplifierDesc( mesh ), chainDesc );
+            DZ_CHECK( levels.size( ) == chainDesc.NumLevels );
+
+            size_t previousNumIndices = mesh.Indices.size( );
+            float  previousError      = 0.0f;
+            for ( const MeshLODLevel &level : levels )
+            {
+                DZ_CHECK( level.Indices.size( ) % 3 == 0 );
+                DZ_CHECK( level.Indices.size( ) <= previousNumIndices * chainDesc.Reduction + 3 );
+                DZ_CHECK( level.Indices.size( ) / 3 >= chainDesc.MinNumTriangles );
+                DZ_CHECK( level.Error >= previousError );
+                DZ_CHECK( OpenEdges( mesh, level.Indices ).empty( ) );
+                DZ_CHECK( NumSmearedTriangles( mesh, level.Indices ) == 0 );
+                // Flip checks bound the turn of every collapse, not the tilt a triangle picks up over many passes, a stray coarse one may end up facing inwards
+                DZ_CHECK( NumInvertedTriangles( mesh, level.Indices, ringRadius ) * 500 <= level.Indices.size( ) / 3 );
+                previousNumIndices = level.Indices.size( );
+                previousError      = level.Error;
+            }
+            // A few percent of the radius at 3% of the triangles
+            DZ_CHECK( !levels.empty( ) && levels.front( ).Error > 0.0f && levels.back( ).Error < 0.15f );
+        }
+    }
+
+    // Borders only collapse along themselves, the outline of the square keeps its shape and length
+    void BorderOutline( )
+    {
+        const TestMesh   mesh = Terrain( 96 );
+        MeshLODChainDesc chainDesc{ };
+        chainDesc.NumLevels                    = 4;
+        const std::vector<MeshLODLevel> levels = MeshSimplifier::BuildLODChain( SimplifierDesc( mesh ), chainDesc );
+        DZ_CHECK( levels.size( ) == chainDesc.NumLevels );
+
+        const auto onSameSide = []( const Vertex &a, const Vertex &b )
+        { return ( a.X == b.X && ( a.X == 0.0f || a.X == 1.0f ) ) || ( a.Z == b.Z && ( a.Z == 0.0f || a.Z == 1.0f ) ); };
+        size_t previousNumOpenEdges = OpenEdges( mesh, mesh.Indices ).size( );
+        float  previousError        = 0.0f;
+        for ( const MeshLODLevel &level : levels )
+        {
+            const std::vector<std::pair<uint32_t, uint32_t>> openEdges = OpenEdges( mesh, level.Indices );
+            float                                            perimeter = 0.0f;
+            size_t                                           numInside = 0;
+            for ( const auto &[ from, to ] : openEdges )
+            {
+                const Vertex &a = mesh.Vertices[ from ];
+                const Vertex &b = mesh.Vertices[ to ];
+                perimeter += std::hypot( a.X - b.X, a.Z - b.Z );
+                numInside += onSameSide( a, b ) ? 0 : 1;
+            }
+            DZ_CHECK( numInside == 0 );
+            DZ_CHECK_NEAR( perimeter, 4.0f, 1e-4f );
+            DZ_CHECK( openEdges.size( ) <= previousNumOpenEdges );
+            DZ_CHECK( level.Error >= previousError );
+            previousNumOpenEdges = openEdges.size( );
+            previousError        = level.Error;
+        }
+    }
+
+    // Simplify stops at its error bound, the chain at MaxError and at levels that barely simplify
+    void ErrorBounds( )
+    {
+        const TestMesh mesh = Sphere( 64, 32 );
+        MeshSimplifier simplifier( SimplifierDesc( mesh ) );
+        DZ_CHECK( simplifier.Simplify( mesh.Indices.size( ) ) == mesh.Indices.size( ) );
+        DZ_CHECK( simplifier.GetError( ) == 0.0f );
+
+        const size_t numIndices = simplifier.Simplify( mesh.Indices.size( ) / 2, 0.01f );
+        DZ_CHECK( numIndices == simplifier.GetIndices( ).size( ) );
+        DZ_CHECK( simplifier.GetError( ) <= 0.01f );
+        const float error = simplifier.GetError( );
+        simplifier.Simplify( 0, 0.01f );
+        DZ_CHECK( simplifier.GetError( ) >= error );
+        DZ_CHECK( simplifier.GetError( ) <= 0.01f );
+        DZ_CHECK( simplifier.GetIndices( ).size( ) > 0 );
+        DZ_CHECK( OpenEdges( mesh, simplifier.GetIndices( ) ).empty( ) );
+
+        MeshLODChainDesc chainDesc{ };
+        chainDesc.NumLevels = 8;
+        chainDesc.MaxError  = 0.02f;
+        const std::vector<MeshLODLevel> levels = MeshSimplifier::BuildLODChain( SimplifierDesc( mesh ), chainDesc );
+        DZ_CHECK( !levels.empty( ) && levels.size( ) < chainDesc.NumLevels );
+        for ( const MeshLODLevel &level : levels )
+        {
+            DZ_CHECK( level.Error <= chainDesc.MaxError );
+        }
+
+        chainDesc           = MeshLODChainDesc{ };
+        chainDesc.NumLevels = 0;
+        DZ_CHECK( MeshSimplifier::BuildLODChain( SimplifierDesc( mesh ), chainDesc ).empty( ) );
+        chainDesc.NumLevels       = 8;
+        chainDesc.MinNumTriangles = mesh.Indices.size( ) / 3;
+        DZ_CHECK( MeshSimplifier::BuildLODChain( SimplifierDesc( mesh ), chainDesc ).empty( ) );
+    }
+} // namespace
+
+int main( )
+{
+    ClosedMeshChains( );
+    BorderOutline( );
+    ErrorBounds( );
+    return DZTests::Result( );
+}
@@ -0,0 +1,156 @@
+/*
+Den Of Iz - Game/Game Engine
+Copyright (c) 2020-2024 Muhammed Murat Cengiz
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include "DZEngine/Rendering/ShaderHotReload.h"
+#include "DZTests/Check.h"
+
+using namespace DZEngine;
+
+namespace
+{
+    std::filesystem::path ShaderDirectory( const char *name )
+    {
+        const std::filesystem::path directory = std::filesystem::temp_directory_path( ) / "DZShaderHotReloadTests" / name;
+        std::filesystem::remove_all( directory );
+        std::filesystem::create_directories( directory );
+        return directory;
+    }
+
+    void WriteFile( const std::filesystem::path &path, const std::string &contents )
+    {
+        std::filesystem::create_directories( path.parent_path( ) );
+        std::ofstream( path ) << contents;
+    }
+
+    uint32_t Changed( ShaderHotReload &hotReload, const std::filesystem::path &path, const FileChangeType type = FileChangeType::Modified )
+    {
+        const FileChange change{ path, type };
+        return hotReload.OnFilesChanged( { &change, 1 } );
+    }
+
+    // A change to an include rebuilds every program that includes it, directly or through other includes, and only those
+    void TransitiveIncludes( )
+    {
+        const std::filesystem::path directory = ShaderDirectory( "TransitiveIncludes" );
+        WriteFile( directory / "Common.hlsli", "float4 Common( );\n" );
+        WriteFile( directory / "Lighting/Lighting.hlsli", "#include \"../Common.hlsli\"\n" );
+        WriteFile( directory / "Lit.hlsl", "  # include \"Lighting/Lighting.hlsli\"\nfloat4 main( ) : SV_Target { return Common( ); }\n" );
+        WriteFile( directory / "Unlit.hlsl", "#include \"Common.hlsli\"\n" );
+        WriteFile( directory / "Debug.hlsl", "// #include \"Common.hlsli\" is only mentioned\n#include <System.hlsli>\n" );
+
+        ShaderHotReload hotReload;
+        uint32_t        numLit = 0, numUnlit = 0, numDebug = 0;
+        hotReload.Register( { directory / "Lit.hlsl" }, [ & ] { ++numLit; } );
+        hotReload.Register( { directory / "Unlit.hlsl" }, [ & ] { ++numUnlit; } );
+        hotReload.Register( { directory / "Debug.hlsl" }, [ & ] { ++numDebug; } );
+
+        DZ_CHECK( Changed( hotReload, directory / "Lighting" / ".." / "Common.hlsli" ) == 2 );
+        DZ_CHECK( numLit == 1 && numUnlit == 1 && numDebug == 0 );
+
+        DZ_CHECK( Changed( hotReload, directory / "Lighting/Lighting.hlsli" ) == 1 );
+        DZ_CHECK( numLit == 2 && numUnlit == 1 );
+
+        DZ_CHECK( Changed( hotReload, directory / "Debug.hlsl" ) == 1 );
+        DZ_CHECK( numDebug == 1 );
+    }
+
+    // Every source of a program contributes its includes
+    void MultipleSources( )
+    {
+        const std::filesystem::path directory = ShaderDirectory( "MultipleSources" );
+        WriteFile( directory / "Vertex.hlsli", "" );
+        WriteFile( directory / "Pixel.hlsli", "" );
+        WriteFile( directory / "Mesh.vs.hlsl", "#include \"Vertex.hlsli\"\n" );
+        WriteFile( directory / "Mesh.ps.hlsl", "#include \"Pixel.hlsli\"\n" );
+
+        ShaderHotReload hotReload;
+        uint32_t        numRebuilds = 0;
+        hotReload.Register( { directory / "Mesh.vs.hlsl", directory / "Mesh.ps.hlsl" }, [ & ] { ++numRebuilds; } );
+        DZ_CHECK( Changed( hotReload, directory / "Vertex.hlsli" ) == 1 );
+        DZ_CHECK( Changed( hotReload, directory / "Pixel.hlsli" ) == 1 );
+        DZ_CHECK( numRebuilds == 2 );
+    }
+
+    // Includes that include each other are collected once instead of looping
+    void IncludeCycle( )
+    {
+        const std::filesystem::path directory = ShaderDirectory( "IncludeCycle" );
+        WriteFile( directory / "A.hlsli", "#include \"B.hlsli\"\n" );
+        WriteFile( directory / "B.hlsli", "#include \"A.hlsli\"\n#include \"A.hlsli\"\n" );
+        WriteFile( directory / "Main.hlsl", "#include \"A.hlsli\"\n" );
+
+        ShaderHotReload hotReload;
+        uint32_t        numRebuilds = 0;
+        hotReload.Register( { directory / "Main.hlsl" }, [ & ] { ++numRebuilds; } );
+        DZ_CHECK( Changed( hotReload, directory / "B.hlsli" ) == 1 );
+        DZ_CHECK( numRebuilds == 1 );
+    }
+
+    // The include graph is collected again on rebuild, so includes added by the edit are tracked and removed ones no longer are
+    void IncludesChangeOnRebuild( )
+    {
+        const std::filesystem::path directory = ShaderDirectory( "IncludesChangeOnRebuild" );
+        WriteFile( directory / "Old.hlsli", "" );
+        WriteFile( directory / "New.hlsli", "" );
+        WriteFile( directory / "Main.hlsl", "#include \"Old.hlsli\"\n" );
+
+        ShaderHotReload hotReload;
+        uint32_t        numRebuilds = 0;
+        hotReload.Register( { directory / "Main.hlsl" }, [ & ] { ++numRebuilds; } );
+        DZ_CHECK( Changed( hotReload, directory / "New.hlsli" ) == 0 );
+
+        WriteFile( directory / "Main.hlsl", "#include \"New.hlsli\"\n" );
+        DZ_CHECK( Changed( hotReload, directory / "Main.hlsl" ) == 1 );
+        DZ_CHECK( Changed( hotReload, directory / "New.hlsli" ) == 1 );
+        DZ_CHECK( Changed( hotReload, directory / "Old.hlsli" ) == 0 );
+        DZ_CHECK( numRebuilds == 2 );
+    }
+
+    // Removing a file rebuilds nothing, the program keeps its last build until the file is back. Unregistered programs aren't rebuilt.
+    void RemovedAndUnregistered( )
+    {
+        const std::filesystem::path directory = ShaderDirectory( "RemovedAndUnregistered" );
+        WriteFile( directory / "Common.hlsli", "" );
+        WriteFile( directory / "Main.hlsl", "#include \"Common.hlsli\"\n#include \"Missing.hlsli\"\n" );
+
+        ShaderHotReload hotReload;
+        uint32_t        numRebuilds = 0;
+        const uint32_t  id          = hotReload.Register( { directory / "Main.hlsl" }, [ & ] { ++numRebuilds; } );
+        DZ_CHECK( Changed( hotReload, directory / "Common.hlsli", FileChangeType::Removed ) == 0 );
+        DZ_CHECK( Changed( hotReload, directory / "Common.hlsli", FileChangeType::Added ) == 1 );
+        DZ_CHECK( numRebuilds == 1 );
+
+        hotReload.Unregister( id );
+        DZ_CHECK( hotReload.NumPrograms( ) == 0 );
+        DZ_CHECK( Changed( hotReload, directory / "Main.hlsl" ) == 0 );
+        DZ_CHECK( numRebuilds == 1 );
+    }
+} // namespace
+
+int main( )
+{
+    TransitiveIncludes( );
+    MultipleSources( );
+    IncludeCycle( );
+    IncludesChangeOnRebuild( );
+    RemovedAndUnregistered( );
+    return DZTests::Result( );
+}
@@ -0,0 +1,241 @@
+/*
+Den Of Iz - Game/Game Engine
+Copyright (c) 2020-2024 Muhammed Murat Cengiz
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <DirectXMath.h>
+#include <array>
+#include <cmath>
+#include <random>
+#include "DZEngine/Math/MathConverter.h"
+#include "DZEngine/Rendering/Shadows/ShadowCascades.h"
+#include "DZTests/Check.h"
+
+using namespace DZEngine;
+using namespace DirectX;
+
+namespace
+{
+    constexpr float NearPlane = 0.1f;
+    constexpr float FarPlane  = 100.0f;
+
+    struct Camera
+    {
+        XMMATRIX View;
+        XMMATRIX Projection;
+    };
+
+    Camera MakeCamera( const XMVECTOR eye, const XMVECTOR direction )
+    {
+        return Camera{ XMMatrixLookToLH( eye, direction, XMVectorSet( 0.0f, 1.0f, 0.0f, 0.0f ) ), XMMatrixPerspectiveFovLH( XM_PIDIV4, 16.0f / 9.0f, NearPlane, FarPlane ) };
+    }
+
+    void Fit( ShadowCascades &cascades, const Camera &camera, const Float3 &lightDirection )
+    {
+        cascades.Fit( MathConverter::Float4X4FromXMMATRIX( camera.View ), MathConverter::Float4X4FromXMMATRIX( camera.Projection ), lightDirection );
+    }
+
+    XMVECTOR SliceCorner( const Camera &camera, const float depth, const uint32_t corner )
+    {
+        const float    x    = ( corner & 1 ? 1.0f : -1.0f ) * depth / XMVectorGetX( camera.Projection.r[ 0 ] );
+        const float    y    = ( corner & 2 ? 1.0f : -1.0f ) * depth / XMVectorGetY( camera.Projection.r[ 1 ] );
+        const XMMATRIX view = XMMatrixInverse( nullptr, camera.View );
+        return XMVector3TransformCoord( XMVectorSet( x, y, depth, 1.0f ), view );
+    }
+
+    bool IsMultipleOf( const float value, const float step )
+    {
+        const float steps = value / step;
+        return std::abs( steps - std::round( steps ) ) < 1e-2f;
+    }
+
+    const std::array<Camera, 3> &Cameras( )
+    {
+        static const std::array cameras = {
+            MakeCamera( XMVectorSet( 0.0f, 2.0f, -5.0f, 1.0f ), XMVectorSet( 0.0f, 0.0f, 1.0f, 0.0f ) ),
+            MakeCamera( XMVectorSet( 40.0f, 25.0f, 10.0f, 1.0f ), XMVectorSet( -1.0f, -0.5f, 0.3f, 0.0f ) ),
+            MakeCamera( XMVectorSet( -12.0f, 1.0f, 70.0f, 1.0f ), XMVectorSet( 0.2f, 0.1f, -1.0f, 0.0f ) ),
+        };
+        return cameras;
+    }
+
+    constexpr std::array LightDirections = { Float3{ -1.0f, -1.0f, -1.0f }, Float3{ 0.3f, -1.0f, 0.2f }, Float3{ 0.0f, -1.0f, 0.0f }, Float3{ 1.0f, -0.2f, 0.0f } };
+
+    // Splits grow monotonically, start at the camera near plane and end at min( camera far, MaxShadowDistance )
+    void Splits( )
+    {
+        std::array<float, MaxShadowCascades> splitFar{ };
+        ShadowCascades::ComputeSplits( NearPlane, 60.0f, MaxShadowCascades, 0.75f, splitFar.data( ) );
+        for ( uint32_t i = 1; i < MaxShadowCascades; ++i )
+        {
+            DZ_CHECK( splitFar[ i ] > splitFar[ i - 1 ] );
+        }
+        DZ_CHECK_NEAR( splitFar[ MaxShadowCascades - 1 ], 60.0f, 1e-3f );
+
+        ShadowCascades::ComputeSplits( NearPlane, 60.0f, 4, 0.0f, splitFar.data( ) );
+        DZ_CHECK_NEAR( splitFar[ 0 ], NearPlane + ( 60.0f - NearPlane ) * 0.25f, 1e-3f );
+
+        ShadowCascades cascades( ShadowCascadesDesc{ } );
+        Fit( cascades, Cameras( )[ 0 ], LightDirections[ 0 ] );
+        DZ_CHECK( cascades.IsValid( ) );
+
+        const auto &fitted = cascades.GetCascades( );
+        DZ_CHECK( fitted.size( ) == cascades.NumCascades( ) );
+        DZ_CHECK_NEAR( fitted.front( ).SplitNear, NearPlane, 1e-3f );
+        DZ_CHECK_NEAR( fitted.back( ).SplitFar, cascades.GetDesc( ).MaxShadowDistance, 1e-2f );
+        for ( uint32_t i = 1; i < fitted.size( ); ++i )
+        {
+            DZ_CHECK( fitted[ i ].SplitNear == fitted[ i - 1 ].SplitFar );
+            DZ_CHECK( fitted[ i ].Radius >= fitted[ i - 1 ].Radius );
+        }
+    }
+
+    // Every corner of a cascade's frustum slice has to land inside that cascade's shadow map and depth range
+    void SliceInsideCascade( )
+    {
+        ShadowCascades cascades( ShadowCascadesDesc{ } );
+        for ( const Camera &camera : Cameras( ) )
+        {
+            for ( const Float3 &lightDirection : LightDirections )
+            {
+                Fit( cascades, camera, lightDirection );
+                DZ_CHECK( cascades.IsValid( ) );
+                for ( const ShadowCascade &cascade : cascades.GetCascades( ) )
+                {
+                    const XMMATRIX viewProjection = MathConverter::Float4X4ToXMMATRIX( cascade.ViewProjection );
+                    for ( uint32_t corner = 0; corner < 8; ++corner )
+                    {
+                        const float    depth  = corner & 4 ? cascade.SplitFar : cascade.SplitNear;
+                        const XMVECTOR shadow = XMVector3TransformCoord( SliceCorner( camera, depth, corner ), viewProjection );
+                        DZ_CHECK( std::abs( XMVectorGetX( shadow ) ) <= 1.0f );
+                        DZ_CHECK( std::abs( XMVectorGetY( shadow ) ) <= 1.0f );
+                        DZ_CHECK( XMVectorGetZ( shadow ) >= 0.0f && XMVectorGetZ( shadow ) <= 1.0f );
+                    }
+                }
+            }
+        }
+    }
+
+    // Moving the camera only moves the cascades in whole texels and turning it doesn't change their size, this is what stops shimmering
+    void TexelSnapping( )
+    {
+        ShadowCascades cascades( ShadowCascadesDesc{ } );
+        const Float3   lightDirection = LightDirections[ 0 ];
+
+        Fit( cascades, Cameras( )[ 0 ], lightDirection );
+        const std::vector<ShadowCascade> reference = cascades.GetCascades( );
+
+        for ( uint32_t step = 1; step <= 16; ++step )
+        {
+            const float  t      = static_cast<float>( step ) * 0.137f;
+            const Camera moved  = MakeCamera( XMVectorSet( t * 3.3f, 2.0f, -5.0f + t, 1.0f ), XMVectorSet( std::sin( t ), 0.0f, std::cos( t ), 0.0f ) );
+            Fit( cascades, moved, lightDirection );
+            for ( uint32_t i = 0; i < reference.size( ); ++i )
+            {
+                const ShadowCascade &cascade = cascades.GetCascades( )[ i ];
+                DZ_CHECK( cascade.Radius == reference[ i ].Radius );
+                DZ_CHECK( cascade.TexelSize == reference[ i ].TexelSize );
+                DZ_CHECK( IsMultipleOf( cascade.LightSpaceCenter.X - reference[ i ].LightSpaceCenter.X, cascade.TexelSize ) );
+                DZ_CHECK( IsMultipleOf( cascade.LightSpaceCenter.Y - reference[ i ].LightSpaceCenter.Y, cascade.TexelSize ) );
+            }
+        }
+    }
+
+    // Off-screen casters between the light and a cascade still cast into it, casters behind the cascade or beside it don't
+    void CasterCulling( )
+    {
+        ShadowCascades cascades( ShadowCascadesDesc{ } );
+        const Camera  &camera = Cameras( )[ 0 ];
+        const XMVECTOR toLight = XMVector3Normalize( XMVectorNegate( MathConverter::Float3ToXMVECTOR( LightDirections[ 0 ] ) ) );
+        Fit( cascades, camera, LightDirections[ 0 ] );
+
+        std::mt19937                          random( 3 );
+        std::uniform_real_distribution<float> position( -80.0f, 80.0f );
+        std::uniform_real_distribution<float> radius( 0.1f, 4.0f );
+        for ( uint32_t i = 0; i < cascades.NumCascades( ); ++i )
+        {
+            const ShadowCascade &cascade = cascades.GetCascades( )[ i ];
+            const XMVECTOR       center  = XMVector3TransformCoord( XMVectorSet( 0.0f, 0.0f, 0.5f * ( cascade.SplitNear + cascade.SplitFar ), 1.0f ),
+                                                                    XMMatrixInverse( nullptr, camera.View ) );
+            const float          distance = 2.0f * cascade.Radius + 30.0f;
+            const auto           sphere   = [ & ]( const XMVECTOR position, const float sphereRadius )
+            { return Float4{ XMVectorGetX( position ), XMVectorGetY( position ), XMVectorGetZ( position ), sphereRadius }; };
+
+            DZ_CHECK( cascades.IsCasterVisible( i, sphere( center, 0.5f ) ) );
+            DZ_CHECK( cascades.IsCasterVisible( i, sphere( XMVectorAdd( center, XMVectorScale( toLight, distance ) ), 0.5f ) ) );
+            DZ_CHECK( !cascades.IsCasterVisible( i, sphere( XMVectorSubtract( center, XMVectorScale( toLight, distance ) ), 0.5f ) ) );
+
+            const XMVECTOR side = XMVector3Normalize( XMVector3Cross( toLight, XMVectorSet( 0.0f, 1.0f, 0.0f, 0.0f ) ) );
+            DZ_CHECK( !cascades.IsCasterVisible( i, sphere( XMVectorAdd( center, XMVectorScale( side, distance ) ), 0.5f ) ) );
+            // A large caster beside the cascade still reaches into it
+            DZ_CHECK( cascades.IsCasterVisible( i, sphere( XMVectorAdd( center, XMVectorScale( side, distance ) ), distance ) ) );
+
+            std::vector<Float4> spheres( 512 );
+            for ( Float4 &s : spheres )
+            {
+                s = Float4{ position( random ), position( random ) * 0.25f, position( random ), radius( random ) };
+            }
+            std::vector<uint32_t> visible;
+            cascades.CullCasters( i, spheres, visible );
+            uint32_t expected = 0;
+            for ( uint32_t s = 0; s < spheres.size( ); ++s )
+            {
+                if ( cascades.IsCasterVisible( i, spheres[ s ] ) )
+                {
+                    DZ_CHECK( expected < visible.size( ) && visible[ expected ] == s );
+                    ++expected;
+                }
+            }
+            DZ_CHECK( visible.size( ) == expected );
+            DZ_CHECK( expected > 0 && expected < spheres.size( ) );
+        }
+
+        DZ_CHECK( !cascades.IsCasterVisible( cascades.NumCascades( ), Float4{ 0.0f, 0.0f, 0.0f, 1.0f } ) );
+        cascades.Invalidate( );
+        DZ_CHECK( !cascades.IsValid( ) );
+        DZ_CHECK( !cascades.IsCasterVisible( 0, Float4{ 0.0f, 0.0f, 0.0f, 1000.0f } ) );
+    }
+
+    // Orthographic cameras and a zero light direction are rejected instead of producing garbage cascades
+    void InvalidInput( )
+    {
+        ShadowCascades cascades( ShadowCascadesDesc{ } );
+        const Camera  &camera = Cameras( )[ 0 ];
+
+        const XMMATRIX orthographic = XMMatrixOrthographicOffCenterLH( -5.0f, 5.0f, -5.0f, 5.0f, 0.1f, 100.0f );
+        cascades.Fit( MathConverter::Float4X4FromXMMATRIX( camera.View ), MathConverter::Float4X4FromXMMATRIX( orthographic ), LightDirections[ 0 ] );
+        DZ_CHECK( !cascades.IsValid( ) );
+
+        Fit( cascades, camera, Float3{ 0.0f, 0.0f, 0.0f } );
+        DZ_CHECK( !cascades.IsValid( ) );
+
+        ShadowCascadesDesc desc{ };
+        desc.NumCascades = 0;
+        DZ_CHECK( ShadowCascades( desc ).NumCascades( ) == 1 );
+        desc.NumCascades = MaxShadowCascades + 4;
+        DZ_CHECK( ShadowCascades( desc ).NumCascades( ) == MaxShadowCascades );
+    }
+} // namespace
+
+int main( )
+{
+    Splits( );
+    SliceInsideCascade( );
+    TexelSnapping( );
+    CasterCulling( );
+    InvalidInput( );
+    return DZTests::Result( );
+}
@@ -0,0 +1,117 @@
+/*
+Den Of Iz - Game/Game Engine
+Copyright (c) 2020-2024 Muhammed Murat Cengiz
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <string>
+#include <vector>
+#include "DZEngine/Assets/SlotMap.h"
+#include "DZTests/Check.h"
+
+using namespace DZEngine;
+
+namespace
+{
+    uint32_t IndexOf( const uint32_t id )
+    {
+        return id & AssetHandleIndexMask;
+    }
+
+    uint32_t GenerationOf( const uint32_t id )
+    {
+        return id >> AssetHandleIndexBits;
+    }
+
+    // The id of a removed value never resolves again, also after its slot holds a new value
+    void StaleIds( )
+    {
+        SlotMap<std::string> map;
+        const uint32_t       first = map.Insert( "first" );
+        DZ_CHECK( IndexOf( first ) == 1 );
+        DZ_CHECK( map.Remove( first ) );
+        DZ_CHECK( !map.Remove( first ) );
+
+        const uint32_t second = map.Insert( "second" );
+        DZ_CHECK( IndexOf( second ) == IndexOf( first ) );
+        DZ_CHECK( GenerationOf( second ) == GenerationOf( first ) + 1 );
+        DZ_CHECK( map.Find( first ) == nullptr );
+        DZ_CHECK( !map.Contains( first ) );
+        DZ_CHECK( !map.Remove( first ) );
+        DZ_CHECK( map.Find( second ) && *map.Find( second ) == "second" );
+        DZ_CHECK( map.Find( UINT32_MAX ) == nullptr );
+        DZ_CHECK( map.Find( MakeAssetHandleId( 7, 0 ) ) == nullptr );
+        DZ_CHECK( map.Size( ) == 1 );
+    }
+
+    // Freed slots are reused in the order they were freed, so every slot ages at the same rate
+    void OldestFirstReuse( )
+    {
+        SlotMap<uint32_t>     map;
+        std::vector<uint32_t> ids;
+        for ( uint32_t i = 0; i < 4; ++i )
+        {
+            ids.push_back( map.Insert( i ) );
+        }
+        DZ_CHECK( map.NumSlots( ) == 5 );
+        map.Remove( ids[ 2 ] );
+        map.Remove( ids[ 0 ] );
+        DZ_CHECK( IndexOf( map.Insert( 10 ) ) == IndexOf( ids[ 2 ] ) );
+        DZ_CHECK( IndexOf( map.Insert( 11 ) ) == IndexOf( ids[ 0 ] ) );
+        DZ_CHECK( IndexOf( map.Insert( 12 ) ) == 5 );
+
+        std::vector<uint32_t> values;
+        map.ForEach(
+            [ & ]( const uint32_t id, const uint32_t value )
+            {
+                DZ_CHECK( map.Contains( id ) );
+                values.push_back( value );
+            } );
+        DZ_CHECK( ( values == std::vector<uint32_t>{ 11, 1, 10, 3, 12 } ) );
+    }
+
+    // A slot whose generation would wrap is retired, the oldest ids of the slot can't come back to life
+    void GenerationRetirement( )
+    {
+        SlotMap<uint32_t>     map;
+        std::vector<uint32_t> removed;
+        for ( uint32_t generation = 0; generation <= AssetHandleMaxGeneration; ++generation )
+        {
+            const uint32_t id = map.Insert( generation );
+            DZ_CHECK( IndexOf( id ) == 1 );
+            DZ_CHECK( GenerationOf( id ) == generation );
+            DZ_CHECK( map.Remove( id ) );
+            removed.push_back( id );
+        }
+
+        const uint32_t next = map.Insert( 0 );
+        DZ_CHECK( IndexOf( next ) == 2 );
+        DZ_CHECK( GenerationOf( next ) == 0 );
+        DZ_CHECK( map.NumSlots( ) == 3 );
+        for ( const uint32_t id : removed )
+        {
+            DZ_CHECK( !map.Contains( id ) );
+        }
+        DZ_CHECK( map.Size( ) == 1 );
+    }
+} // namespace
+
+int main( )
+{
+    StaleIds( );
+    OldestFirstReuse( );
+    GenerationRetirement( );
+    return DZTests::Result( );
+}
@@ -0,0 +1,158 @@
+/*
+Den Of Iz - Game/Game Engine
+Copyright (c) 2020-2024 Muhammed Murat Cengiz
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <random>
+#include "DZEngine/Assets/VertexQuantization.h"
+#include "DZTests/Check.h"
+
+using namespace DZEngine;
+
+namespace
+{
+    constexpr float Degrees = 180.0f / 3.14159265f;
+
+    Float3 Normalize( const Float3 &v )
+    {
+        const float length = std::sqrt( v.X * v.X + v.Y * v.Y + v.Z * v.Z );
+        return Float3{ v.X / length, v.Y / length, v.Z / length };
+    }
+
+    float AngleDegrees( const Float3 &a, const Float3 &b )
+    {
+        const float cosine = std::clamp( a.X * b.X + a.Y * b.Y + a.Z * b.Z, -1.0f, 1.0f );
+        return std::acos( cosine ) * Degrees;
+    }
+
+    std::vector<StaticMeshVertex> RandomVertices( std::mt19937 &random, const size_t numVertices, const Float3 &center, const Float3 &extent, const float texCoordRange )
+    {
+        std::uniform_real_distribution<float> signedUnit( -1.0f, 1.0f );
+        std::uniform_real_distribution<float> unit( 0.0f, 1.0f );
+
+        std::vector<StaticMeshVertex> vertices( numVertices );
+        for ( StaticMeshVertex &vertex : vertices )
+        {
+            vertex.Position = Float4{ center.X + signedUnit( random ) * extent.X, center.Y + signedUnit( random ) * extent.Y, center.Z + signedUnit( random ) * extent.Z, 1.0f };
+
+            const Float3 normal  = Normalize( Float3{ signedUnit( random ), signedUnit( random ), signedUnit( random ) } );
+            const Float3 tangent = Normalize( Float3{ normal.Y, -normal.X, 0.0f } );
+            vertex.Normal        = Float4{ normal.X, normal.Y, normal.Z, 0.0f };
+            vertex.Tangent       = Float4{ tangent.X, tangent.Y, tangent.Z, signedUnit( random ) < 0.0f ? -1.0f : 1.0f };
+            vertex.TexCoord      = Float2{ unit( random ) * texCoordRange, unit( random ) * texCoordRange };
+            vertex.Color         = Float4{ unit( random ), unit( random ), unit( random ), unit( random ) };
+        }
+        return vertices;
+    }
+
+    // Round trip error stays within what the bit depth of every attribute allows
+    void ErrorBounds( )
+    {
+        std::mt19937                        random( 3 );
+        const Float3                        extent{ 5.0f, 2.0f, 0.5f };
+        const std::vector<StaticMeshVertex> vertices = RandomVertices( random, 100000, Float3{ 0.0f, 3.0f, 0.0f }, extent, 4.0f );
+
+        Float3 boundsMin{ 1e30f, 1e30f, 1e30f };
+        Float3 boundsMax{ -1e30f, -1e30f, -1e30f };
+        VertexQuantization::ComputeBounds( vertices.data( ), vertices.size( ), boundsMin, boundsMax );
+        DZ_CHECK( boundsMin.X >= -extent.X && boundsMax.X <= extent.X && boundsMax.X - boundsMin.X > extent.X );
+
+        const VertexQuantizationError error = VertexQuantization::MeasureError( vertices.data( ), vertices.size( ), boundsMin, boundsMax );
+        // Half a unorm16 step of the largest bounds axis
+        const float maxExtent = std::max( { boundsMax.X - boundsMin.X, boundsMax.Y - boundsMin.Y, boundsMax.Z - boundsMin.Z } );
+        DZ_CHECK( error.MaxPositionError <= 0.5f * maxExtent / 65535.0f * 1.01f );
+        DZ_CHECK( error.MaxNormalAngle * Degrees < 0.05f );
+        DZ_CHECK( error.MaxTangentAngle * Degrees < 0.05f );
+        // Half a half-float ulp in [2, 4)
+        DZ_CHECK( error.MaxTexCoordError <= 1.0f / 1024.0f );
+        DZ_CHECK( error.MaxColorError <= 0.5f / 255.0f + 1e-6f );
+        spdlog::info( "VertexQuantizationTests: position {:g}, normal {:g} deg, tangent {:g} deg, uv {:g}, color {:g}", error.MaxPositionError, error.MaxNormalAngle * Degrees,
+                      error.MaxTangentAngle * Degrees, error.MaxTexCoordError, error.MaxColorError );
+
+        std::vector<CompactMeshVertex> encoded( vertices.size( ) );
+        VertexQuantization::Encode( vertices.data( ), vertices.size( ), boundsMin, boundsMax, encoded.data( ) );
+        bool batchMatches = true;
+        bool signMatches  = true;
+        for ( size_t i = 0; i < vertices.size( ); ++i )
+        {
+            const CompactMeshVertex single = VertexQuantization::Encode( vertices[ i ], boundsMin, boundsMax );
+            batchMatches &= std::memcmp( &single, &encoded[ i ], sizeof( CompactMeshVertex ) ) == 0;
+            signMatches &= VertexQuantization::Decode( encoded[ i ], boundsMin, boundsMax ).Tangent.W == vertices[ i ].Tangent.W;
+        }
+        DZ_CHECK( batchMatches );
+        DZ_CHECK( signMatches );
+    }
+
+    // The axes and the folded -Z hemisphere are where octahedral encodings usually break
+    void Octahedral( )
+    {
+        const std::array directions = {
+            Float3{ 1.0f, 0.0f, 0.0f },  Float3{ -1.0f, 0.0f, 0.0f }, Float3{ 0.0f, 1.0f, 0.0f },   Float3{ 0.0f, -1.0f, 0.0f },
+            Float3{ 0.0f, 0.0f, 1.0f },  Float3{ 0.0f, 0.0f, -1.0f }, Float3{ 0.577f, -0.577f, -0.577f }, Float3{ -0.001f, 0.001f, -1.0f },
+        };
+        for ( const Float3 &direction : directions )
+        {
+            const Float3 normalized = Normalize( direction );
+            const Float3 decoded    = VertexQuantization::DecodeOctahedral( VertexQuantization::EncodeOctahedral( normalized ) );
+            DZ_CHECK( AngleDegrees( normalized, decoded ) < 0.05f );
+            DZ_CHECK_NEAR( decoded.X * decoded.X + decoded.Y * decoded.Y + decoded.Z * decoded.Z, 1.0f, 1e-5f );
+        }
+        DZ_CHECK( VertexQuantization::EncodeOctahedral( Float3{ 0.0f, 0.0f, 0.0f } ) == 0 );
+    }
+
+    // A flat mesh has zero extent on one axis, that axis has to decode back to the plane instead of NaN
+    void FlatBounds( )
+    {
+        std::mt19937                  random( 5 );
+        std::vector<StaticMeshVertex> vertices = RandomVertices( random, 1024, Float3{ 0.0f, 0.0f, 0.0f }, Float3{ 10.0f, 0.0f, 10.0f }, 1.0f );
+        for ( StaticMeshVertex &vertex : vertices )
+        {
+            vertex.Position.Y = 2.5f;
+        }
+
+        Float3 boundsMin{ 1e30f, 1e30f, 1e30f };
+        Float3 boundsMax{ -1e30f, -1e30f, -1e30f };
+        VertexQuantization::ComputeBounds( vertices.data( ), vertices.size( ), boundsMin, boundsMax );
+        DZ_CHECK( boundsMin.Y == boundsMax.Y );
+
+        const VertexQuantizationError error = VertexQuantization::MeasureError( vertices.data( ), vertices.size( ), boundsMin, boundsMax );
+        DZ_CHECK( std::isfinite( error.MaxPositionError ) );
+        DZ_CHECK( error.MaxPositionError <= 20.0f / 65535.0f );
+        DZ_CHECK( VertexQuantization::Decode( VertexQuantization::Encode( vertices[ 0 ], boundsMin, boundsMax ), boundsMin, boundsMax ).Position.Y == 2.5f );
+    }
+
+    // The compact format has to at least halve vertex memory and fetch bandwidth
+    void Strides( )
+    {
+        DZ_CHECK( VertexQuantization::VertexStride( VertexFormat::Full ) == sizeof( StaticMeshVertex ) );
+        DZ_CHECK( VertexQuantization::VertexStride( VertexFormat::Compact ) == sizeof( CompactMeshVertex ) );
+        DZ_CHECK( 2 * VertexQuantization::VertexStride( VertexFormat::Compact ) < VertexQuantization::VertexStride( VertexFormat::Full ) );
+        DZ_CHECK( 2 * VertexQuantization::PositionStride( VertexFormat::Compact ) <= VertexQuantization::PositionStride( VertexFormat::Full ) );
+    }
+} // namespace
+
+int main( )
+{
+    ErrorBounds( );
+    Octahedral( );
+    FlatBounds( );
+    Strides( );
+    return DZTests::Result( );
+}
@@ -0,0 +1,131 @@
+/*
+Den Of Iz - Game/Game Engine
+Copyright (c) 2020-2024 Muhammed Murat Cengiz
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "DZEngine/Assets/AssetCooker.h"
+
+#include <algorithm>
+#include <memory>
+#include <ranges>
+#include <spdlog/spdlog.h>
+#include <string>
+#include <taskflow/taskflow.hpp>
+#include <thread>
+
+using namespace DZEngine;
+
+namespace
+{
+    constexpr size_t NumSlowestReported = 10;
+
+    int PrintUsage( )
+    {
+        spdlog::info( "Usage: DZCook <sourceDirectory> <outputDirectory> [--force] [--jobs <n>] [--cache <directory>] [--shared-cache <directory>]" );
+        spdlog::info( "                            [--lods <levels>] [--lod-error <units>] [--no-optimize]" );
+        return 1;
+    }
+} // namespace
+
+// Headless, cooks the source assets of a tree into engine assets, see AssetCooker
+int main( const int argc, char **argv )
+{
+    if ( argc < 3 )
+    {
+        return PrintUsage( );
+    }
+
+    AssetCookerDesc desc{ };
+    desc.SourceDirectory = argv[ 1 ];
+    desc.OutputDirectory = argv[ 2 ];
+
+    size_t               numJobs = std::max( 1u, std::thread::hardware_concurrency( ) );
+    DerivedDataCacheDesc cacheDesc{ };
+    for ( int i = 3; i < argc; ++i )
+    {
+        const std::string option = argv[ i ];
+        if ( option == "--force" )
+        {
+            desc.Force = true;
+        }
+        else if ( option == "--jobs" && i + 1 < argc )
+        {
+            numJobs = std::max<size_t>( 1, std::strtoul( argv[ ++i ], nullptr, 10 ) );
+        }
+        else if ( option == "--cache" && i + 1 < argc )
+        {
+            cacheDesc.Directory = argv[ ++i ];
+        }
+        else if ( option == "--shared-cache" && i + 1 < argc )
+        {
+            cacheDesc.SharedDirectory = argv[ ++i ];
+        }
+        else if ( option == "--lods" && i + 1 < argc )
+        {
+            desc.LODs.NumLevels = static_cast<uint32_t>( std::strtoul( argv[ ++i ], nullptr, 10 ) );
+        }
+        else if ( option == "--lod-error" && i + 1 < argc )
+        {
+            desc.LODs.MaxError = std::strtof( argv[ ++i ], nullptr );
+        }
+        else if ( option == "--no-optimize" )
+        {
+            desc.OptimizeMeshes = false;
+        }
+        else
+        {
+            spdlog::error( "DZCook: Unknown option {}", option );
+            return PrintUsage( );
+        }
+    }
+
+    std::unique_ptr<DerivedDataCache> cache;
+    if ( !cacheDesc.Directory.empty( ) )
+    {
+        cache = std::make_unique<DerivedDataCache>( cacheDesc );
+        if ( !cache->IsValid( ) )
+        {
+            return 1;
+        }
+        desc.Cache = cache.get( );
+    }
+
+    tf::Executor executor( numJobs );
+    desc.Executor = &executor;
+    AssetCooker cooker( desc );
+    const bool  succeeded = cooker.Cook( );
+
+    std::vector<AssetCookResult> results = cooker.GetResults( );
+    std::erase_if( results, []( const AssetCookResult &result ) { return result.Status == AssetCookStatus::UpToDate; } );
+    std::ranges::sort( results, std::ranges::greater{ }, &AssetCookResult::Seconds );
+    for ( const AssetCookResult &result : results | std::views::take( NumSlowestReported ) )
+    {
+        spdlog::info( "DZCook: {:>10.1f} ms {}{}", result.Seconds * 1000.0, result.Path, result.Status == AssetCookStatus::Failed ? " (failed)" : "" );
+    }
+    for ( const AssetCookResult &result : results )
+    {
+        if ( result.Status == AssetCookStatus::Failed )
+        {
+            spdlog::error( "DZCook: Failed to cook {}", result.Path );
+        }
+    }
+    if ( cache )
+    {
+        const DerivedDataCacheStats stats = cache->GetStats( );
+        spdlog::info( "DZCook: Cache {} local hits, {} shared hits, {} misses", stats.NumLocalHits, stats.NumSharedHits, stats.NumMisses );
+    }
+    return succeeded ? 0 : 1;
+}
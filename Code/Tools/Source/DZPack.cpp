@@ -0,0 +1,722 @@
+/*
+Den Of Iz - Game/Game Engine
+Copyright (c) 2020-2024 Muhammed Murat Cengiz
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <DenOfIzGraphics/Data/Geometry.h>
+#include "DZEngine/Assets/AssetBundle.h"
+#include "DZEngine/Assets/DerivedDataCache.h"
+#include "DZEngine/Assets/AssetRegistry.h"
+#include "DZEngine/Assets/MeshOptimizer.h"
+#include "DZEngine/Assets/MeshSimplifier.h"
+#include "DZEngine/Assets/SlotMap.h"
+
+#include <chrono>
+#include <fstream>
+#include <limits>
+#include <numeric>
+#include <random>
+#include <spdlog/spdlog.h>
+#include <taskflow/taskflow.hpp>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+using namespace DZEngine;
+using namespace DenOfIz;
+
+namespace
+{
+    constexpr int NumBenchmarkIterations = 5;
+
+    int PrintUsage( )
+    {
+        spdlog::info( "Usage: DZPack build <assetsDirectory> <pack> [none|lz4|zstd] [level] [alignment] [cacheDirectory] [sharedCacheDirectory]" );
+        spdlog::info( "       DZPack bench <assetsDirectory> <pack>" );
+        spdlog::info( "       DZPack cache <assetsDirectory> [lz4|zstd] [level]" );
+        spdlog::info( "       DZPack codecs <file> [chunkSize]" );
+        spdlog::info( "       DZPack io <directory> [cold]" );
+        spdlog::info( "       DZPack registry [numEntries]" );
+        spdlog::info( "       DZPack handles [numHandles]" );
+        spdlog::info( "       DZPack lod [tessellation]" );
+        spdlog::info( "       DZPack optimize [tessellation]" );
+        return 1;
+    }
+
+    bool ParseCodec( const std::string &name, BlockCompressionCodec &outCodec )
+    {
+        if ( name == "none" )
+        {
+            outCodec = BlockCompressionCodec::None;
+        }
+        else if ( name == "lz4" )
+        {
+            outCodec = BlockCompressionCodec::LZ4;
+        }
+        else if ( name == "zstd" )
+        {
+            outCodec = BlockCompressionCodec::Zstd;
+        }
+        else
+        {
+            spdlog::error( "DZPack: Unknown codec {}", name );
+            return false;
+        }
+        return true;
+    }
+
+    // Best of NumBenchmarkIterations after a warm up run, so every variant measures the page cache and not the disk
+    template <typename Fn>
+    double BestSeconds( Fn &&fn )
+    {
+        fn( );
+        double bestSeconds = std::numeric_limits<double>::max( );
+        for ( int i = 0; i < NumBenchmarkIterations; ++i )
+        {
+            const auto start = std::chrono::steady_clock::now( );
+            fn( );
+            bestSeconds = std::min( bestSeconds, std::chrono::duration<double>( std::chrono::steady_clock::now( ) - start ).count( ) );
+        }
+        return bestSeconds;
+    }
+
+    void Report( const char *name, const size_t numAssets, const size_t numBytes, const double seconds )
+    {
+        const double megabytes = static_cast<double>( numBytes ) / ( 1024.0 * 1024.0 );
+        spdlog::info( "DZPack: {:<6} {} assets, {:.2f} MB in {:.3f} ms, {:.1f} MB/s, {:.2f} us per asset", name, numAssets, megabytes, seconds * 1000.0, megabytes / seconds,
+                      seconds * 1000000.0 / static_cast<double>( std::max<size_t>( numAssets, 1 ) ) );
+    }
+
+    // Reads every byte of every asset through a reader, returns the number of bytes read
+    size_t LoadAll( const AssetBundle &bundle, const std::vector<std::string> &uris, std::vector<Byte> &scratch )
+    {
+        size_t numBytes = 0;
+        for ( const auto &uri : uris )
+        {
+            const size_t assetNumBytes = bundle.GetAssetNumBytes( uri );
+            const auto   reader        = bundle.LoadAsset( uri );
+            if ( !reader )
+            {
+                continue;
+            }
+            scratch.resize( std::max( scratch.size( ), assetNumBytes ) );
+            numBytes += reader->Read( ByteArray{ scratch.data( ), assetNumBytes }, 0, static_cast<uint32_t>( assetNumBytes ) );
+        }
+        return numBytes;
+    }
+
+    // Reads or decompresses every asset straight into the destination
+    size_t ReadAll( const AssetBundle &bundle, const std::vector<std::string> &uris, std::vector<Byte> &scratch )
+    {
+        size_t numBytes = 0;
+        for ( const auto &uri : uris )
+        {
+            const size_t assetNumBytes = bundle.GetAssetNumBytes( uri );
+            scratch.resize( std::max( scratch.size( ), assetNumBytes ) );
+            if ( bundle.ReadAsset( uri, scratch.data( ), assetNumBytes ) )
+            {
+                numBytes += assetNumBytes;
+            }
+        }
+        return numBytes;
+    }
+
+    int Build( const int argc, char **argv )
+    {
+        tf::Executor executor;
+
+        AssetPackBuildDesc desc{ };
+        desc.AssetsDirectory      = argv[ 2 ];
+        desc.OutputPath           = argv[ 3 ];
+        desc.Compression.Executor = &executor;
+        if ( argc > 4 && !ParseCodec( argv[ 4 ], desc.Compression.Codec ) )
+        {
+            return 1;
+        }
+        if ( argc > 5 )
+        {
+            desc.Compression.Level = std::atoi( argv[ 5 ] );
+        }
+        if ( argc > 6 )
+        {
+            desc.Alignment = static_cast<uint32_t>( std::strtoul( argv[ 6 ], nullptr, 10 ) );
+        }
+
+        std::unique_ptr<DerivedDataCache> cache;
+        if ( argc > 7 )
+        {
+            DerivedDataCacheDesc cacheDesc{ };
+            cacheDesc.Directory = argv[ 7 ];
+            if ( argc > 8 )
+            {
+                cacheDesc.SharedDirectory = argv[ 8 ];
+            }
+            cache = std::make_unique<DerivedDataCache>( cacheDesc );
+            if ( !cache->IsValid( ) )
+            {
+                return 1;
+            }
+            desc.Cache = cache.get( );
+        }
+        if ( !AssetPack::Build( desc ) )
+        {
+            return 1;
+        }
+        if ( cache )
+        {
+            const DerivedDataCacheStats stats = cache->GetStats( );
+            spdlog::info( "DZPack: Cache {} local hits, {} shared hits, {} misses, {} trimmed", stats.NumLocalHits, stats.NumSharedHits, stats.NumMisses, stats.NumTrimmed );
+        }
+        return 0;
+    }
+
+    // Pack build time with an empty derived data cache against a second build of the unchanged assets, which only looks the blocks up
+    int CacheBench( const int argc, char **argv )
+    {
+        tf::Executor executor;
+
+        const std::filesystem::path directory = std::filesystem::temp_directory_path( ) / "DZPackCacheBench";
+        std::error_code             error;
+        std::filesystem::remove_all( directory, error );
+
+        AssetPackBuildDesc desc{ };
+        desc.AssetsDirectory      = argv[ 2 ];
+        desc.OutputPath           = directory / "Bench.dzpack";
+        desc.Compression.Codec    = BlockCompressionCodec::Zstd;
+        desc.Compression.Executor = &executor;
+        if ( argc > 3 && !ParseCodec( argv[ 3 ], desc.Compression.Codec ) )
+        {
+            return 1;
+        }
+        if ( argc > 4 )
+        {
+            desc.Compression.Level = std::atoi( argv[ 4 ] );
+        }
+
+        DerivedDataCache cache( DerivedDataCacheDesc{ directory / "Cache" } );
+        desc.Cache = &cache;
+        for ( const char *name : { "cold", "warm" } )
+        {
+            const auto start = std::chrono::steady_clock::now( );
+            if ( !cache.IsValid( ) || !AssetPack::Build( desc ) )
+            {
+                return 1;
+            }
+            const double                seconds = std::chrono::duration<double>( std::chrono::steady_clock::now( ) - start ).count( );
+            const DerivedDataCacheStats stats   = cache.GetStats( );
+            spdlog::info( "DZPack: {:<4} build {:.3f} ms, {} hits, {} misses, cache holds {:.2f} MB", name, seconds * 1000.0, stats.NumLocalHits, stats.NumMisses,
+                          static_cast<double>( stats.NumBytes ) / ( 1024.0 * 1024.0 ) );
+        }
+        std::filesystem::remove_all( directory, error );
+        return 0;
+    }
+
+    // End to end load time of every asset of the pack, loose files against the pack through both read paths
+    int Bench( char **argv )
+    {
+        tf::Executor executor;
+
+        const AssetPack pack( argv[ 3 ] );
+        if ( !pack.IsValid( ) )
+        {
+            return 1;
+        }
+        std::vector<std::string> uris;
+        size_t                   numStoredBytes = 0;
+        for ( const auto &path : pack.GetAssetPaths( ) )
+        {
+            uris.push_back( "assets://" + path );
+            numStoredBytes += pack.GetAssetStoredNumBytes( path );
+        }
+
+        const AssetBundle looseBundle( argv[ 2 ] );
+        AssetBundle       packedBundle( argv[ 2 ] );
+        if ( !packedBundle.MountPack( argv[ 3 ], &executor ) )
+        {
+            return 1;
+        }
+
+        std::vector<Byte> scratch;
+        size_t            numBytes = 0;
+        spdlog::info( "DZPack: {} assets stored as {} bytes", uris.size( ), numStoredBytes );
+        Report( "loose", uris.size( ), numBytes, BestSeconds( [ & ] { numBytes = LoadAll( looseBundle, uris, scratch ); } ) );
+        Report( "packed", uris.size( ), numBytes, BestSeconds( [ & ] { numBytes = LoadAll( packedBundle, uris, scratch ); } ) );
+        Report( "direct", uris.size( ), numBytes, BestSeconds( [ & ] { numBytes = ReadAll( packedBundle, uris, scratch ); } ) );
+        return 0;
+    }
+
+    // Compression ratio and throughput of each codec on one file, decompression serial and on every worker
+    int Codecs( const int argc, char **argv )
+    {
+        std::ifstream in( argv[ 2 ], std::ios::binary | std::ios::ate );
+        if ( !in )
+        {
+            spdlog::error( "DZPack: Failed to read {}", argv[ 2 ] );
+            return 1;
+        }
+        std::vector<Byte> data( static_cast<size_t>( in.tellg( ) ) );
+        in.seekg( 0 );
+        in.read( reinterpret_cast<char *>( data.data( ) ), static_cast<std::streamsize>( data.size( ) ) );
+
+        tf::Executor      executor;
+        std::vector<Byte> decompressed( data.size( ) );
+        const double      gigabytes = static_cast<double>( data.size( ) ) / ( 1024.0 * 1024.0 * 1024.0 );
+        for ( const BlockCompressionCodec codec : { BlockCompressionCodec::LZ4, BlockCompressionCodec::Zstd } )
+        {
+            BlockCompressionDesc desc{ };
+            desc.Codec    = codec;
+            desc.Executor = &executor;
+            if ( argc > 3 )
+            {
+                desc.ChunkSize = static_cast<uint32_t>( std::strtoul( argv[ 3 ], nullptr, 10 ) );
+            }
+
+            std::vector<Byte> block;
+            const auto        decompress = [ & ]( tf::Executor *workers )
+            { BlockCompression::Decompress( block.data( ), block.size( ), decompressed.data( ), decompressed.size( ), workers ); };
+            const double      compressSeconds = BestSeconds( [ & ] { block = BlockCompression::Compress( data.data( ), data.size( ), desc ); } );
+            const double      serialSeconds   = BestSeconds( [ & ] { decompress( nullptr ); } );
+            const double      parallelSeconds = BestSeconds( [ & ] { decompress( &executor ); } );
+            if ( decompressed != data )
+            {
+                spdlog::error( "DZPack: Round trip mismatch" );
+                return 1;
+            }
+
+            const double ratio = static_cast<double>( block.size( ) ) / static_cast<double>( std::max<size_t>( data.size( ), 1 ) );
+            spdlog::info( "DZPack: {:<4} ratio {:.3f}, compress {:.2f} GB/s, decompress {:.2f} GB/s serial, {:.2f} GB/s on {} workers",
+                          codec == BlockCompressionCodec::LZ4 ? "lz4" : "zstd", ratio, gigabytes / compressSeconds, gigabytes / serialSeconds, gigabytes / parallelSeconds,
+                          executor.num_workers( ) );
+        }
+        return 0;
+    }
+    // Drops the cached pages of the files so reads hit the disk, Linux only
+    void EvictFromPageCache( const std::vector<FileRead> &reads )
+    {
+#ifdef __linux__
+        for ( const FileRead &read : reads )
+        {
+            if ( const int file = open( read.Path.c_str( ), O_RDONLY ); file >= 0 )
+            {
+                posix_fadvise( file, 0, 0, POSIX_FADV_DONTNEED );
+                close( file );
+            }
+        }
+#endif
+    }
+
+    // Reads every file of a directory in one batch through each file IO backend
+    int Io( const int argc, char **argv )
+    {
+        const bool cold = argc > 3 && std::string( argv[ 3 ] ) == "cold";
+
+        std::vector<FileRead> reads;
+        std::error_code       error;
+        for ( const auto &entry : std::filesystem::recursive_directory_iterator( argv[ 2 ], error ) )
+        {
+            if ( entry.is_regular_file( ) )
+            {
+                FileRead &read = reads.emplace_back( );
+                read.Path      = entry.path( );
+                read.NumBytes  = static_cast<size_t>( entry.file_size( ) );
+            }
+        }
+        if ( error )
+        {
+            spdlog::error( "DZPack: Failed to list {}: {}", argv[ 2 ], error.message( ) );
+            return 1;
+        }
+
+        size_t numBytes = 0;
+        for ( const FileRead &read : reads )
+        {
+            numBytes += read.NumBytes;
+        }
+        std::vector<Byte> memory( numBytes );
+        size_t            offset = 0;
+        for ( FileRead &read : reads )
+        {
+            read.Dst = memory.data( ) + offset;
+            offset += read.NumBytes;
+        }
+
+        tf::Executor executor;
+        const auto   run = [ & ]( const char *name, IFileIO *fileIO )
+        {
+            const auto readAll = [ & ]
+            {
+                if ( cold )
+                {
+                    EvictFromPageCache( reads );
+                }
+                if ( !fileIO )
+                {
+                    for ( FileRead &read : reads )
+                    {
+                        ThreadPoolFileIO::ReadFile( read );
+                    }
+                    return;
+                }
+                FileReadBatch batch;
+                fileIO->Read( reads, batch );
+                batch.Wait( );
+            };
+            Report( name, reads.size( ), numBytes, BestSeconds( readAll ) );
+            if ( !std::ranges::all_of( reads, &FileRead::Succeeded ) )
+            {
+                spdlog::error( "DZPack: {} failed to read some of the files", name );
+            }
+        };
+
+        FileIODesc threadPoolDesc{ };
+        threadPoolDesc.Backend  = FileIOBackend::ThreadPool;
+        threadPoolDesc.Executor = &executor;
+        FileIODesc ioUringDesc{ };
+        ioUringDesc.Backend = FileIOBackend::IoUring;
+
+        const auto threadPool = IFileIO::Create( threadPoolDesc );
+        const auto ioUring    = IFileIO::Create( ioUringDesc );
+        run( "serial", nullptr );
+        run( "pool", threadPool.get( ) );
+        if ( ioUring->GetBackend( ) == FileIOBackend::IoUring )
+        {
+            run( "uring", ioUring.get( ) );
+        }
+        return 0;
+    }
+
+    // Load and lookup times of a synthetic registry, the JSON import against the mapped binary format
+    int Registry( const int argc, char **argv )
+    {
+        const uint32_t numEntries = argc > 2 ? static_cast<uint32_t>( std::strtoul( argv[ 2 ], nullptr, 10 ) ) : 1000000;
+        const auto     jsonPath   = std::filesystem::temp_directory_path( ) / "DZPackRegistry.json";
+        const auto     binaryPath = std::filesystem::temp_directory_path( ) / ( std::string( "DZPackRegistry" ) + AssetRegistry::BinaryExtension );
+        const auto     typeOf     = []( const uint32_t i ) { return static_cast<AssetRegistryType>( i % static_cast<uint32_t>( AssetRegistryType::Count ) ); };
+
+        AssetRegistry            registry;
+        std::vector<std::string> uris( numEntries );
+        for ( uint32_t i = 0; i < numEntries; ++i )
+        {
+            uris[ i ] = fmt::format( "assets://Models/Set{}/Asset{}.dzmesh", i % 64, i );
+            registry.Register( typeOf( i ), i % 8, i, uris[ i ] );
+        }
+        if ( !registry.SaveToFile( jsonPath ) || !registry.SaveToFile( binaryPath ) )
+        {
+            return 1;
+        }
+
+        // The JSON import takes seconds at this size, it is measured once
+        AssetRegistry jsonRegistry;
+        const auto    start       = std::chrono::steady_clock::now( );
+        const bool    jsonLoaded  = jsonRegistry.LoadFromFile( jsonPath );
+        const double  jsonSeconds = std::chrono::duration<double>( std::chrono::steady_clock::now( ) - start ).count( );
+        AssetRegistry binaryRegistry;
+        bool          binaryLoaded  = false;
+        const double  binarySeconds = BestSeconds( [ & ] { binaryLoaded = binaryRegistry.LoadFromFile( binaryPath ); } );
+        if ( !jsonLoaded || !binaryLoaded || jsonRegistry.GetNumEntries( ) != numEntries || binaryRegistry.GetNumEntries( ) != numEntries )
+        {
+            spdlog::error( "DZPack: Registry round trip mismatch" );
+            return 1;
+        }
+
+        // Shuffled so the lookups don't walk the tables in order
+        std::vector<uint32_t> order( numEntries );
+        std::iota( order.begin( ), order.end( ), 0u );
+        std::ranges::shuffle( order, std::mt19937( 42 ) );
+        size_t       numUris    = 0;
+        size_t       numHandles = 0;
+        const double uriSeconds = BestSeconds(
+            [ & ]
+            {
+                numUris = 0;
+                for ( const uint32_t i : order )
+                {
+                    std::string_view uri;
+                    numUris += binaryRegistry.GetUri( typeOf( i ), i % 8, i, uri );
+                }
+            } );
+        const double handleSeconds = BestSeconds(
+            [ & ]
+            {
+                numHandles = 0;
+                for ( const uint32_t i : order )
+                {
+                    uint32_t handleId = 0;
+                    numHandles += binaryRegistry.Find( typeOf( i ), i % 8, uris[ i ], handleId ) && handleId == i;
+                }
+            } );
+        if ( numUris != numEntries || numHandles != numEntries )
+        {
+            spdlog::error( "DZPack: Registry lookup mismatch, {} uris and {} handles of {}", numUris, numHandles, numEntries );
+            return 1;
+        }
+
+        const double perEntry = 1000000000.0 / static_cast<double>( std::max<uint32_t>( numEntries, 1 ) );
+        spdlog::info( "DZPack: {} entries, json {} bytes, binary {} bytes", numEntries, std::filesystem::file_size( jsonPath ), std::filesystem::file_size( binaryPath ) );
+        spdlog::info( "DZPack: load   json {:.1f} ms, binary {:.3f} ms", jsonSeconds * 1000.0, binarySeconds * 1000.0 );
+        spdlog::info( "DZPack: lookup handle -> uri {:.1f} ns, uri -> handle {:.1f} ns", uriSeconds * perEntry, handleSeconds * perEntry );
+
+        std::error_code error;
+        std::filesystem::remove( jsonPath, error );
+        std::filesystem::remove( binaryPath, error );
+        return 0;
+    }
+
+    // Handle lookups of the slot maps against the tables they replaced, the id indexed vector and the handle keyed parent map of MeshBatch
+    int Handles( const int argc, char **argv )
+    {
+        struct Payload // About the size of a GPUSubMesh
+        {
+            uint64_t Data[ 8 ];
+        };
+
+        const uint32_t numHandles = argc > 2 ? static_cast<uint32_t>( std::strtoul( argv[ 2 ], nullptr, 10 ) ) : 1000000;
+        if ( numHandles == 0 || numHandles >= AssetHandleIndexMask )
+        {
+            spdlog::error( "DZPack: numHandles must be in [1, {})", AssetHandleIndexMask );
+            return 1;
+        }
+
+        std::vector<Payload>               vector( numHandles + 1 );
+        std::unordered_map<size_t, size_t> map;
+        SlotMap<Payload>                   slotMap;
+        std::vector<uint32_t>              ids( numHandles );
+        for ( uint32_t i = 0; i < numHandles; ++i )
+        {
+            vector[ i + 1 ].Data[ 0 ] = i;
+            map[ i + 1 ]              = i;
+            ids[ i ]                  = slotMap.Insert( Payload{ { i } } );
+        }
+
+        // Shuffled so the lookups don't walk the tables in order
+        std::vector<uint32_t> order( numHandles );
+        std::iota( order.begin( ), order.end( ), 0u );
+        std::ranges::shuffle( order, std::mt19937( 42 ) );
+        std::vector<uint32_t> shuffledIds( numHandles );
+        for ( uint32_t i = 0; i < numHandles; ++i )
+        {
+            shuffledIds[ i ] = ids[ order[ i ] ];
+        }
+
+        uint64_t     vectorSum     = 0;
+        uint64_t     mapSum        = 0;
+        uint64_t     slotMapSum    = 0;
+        const double vectorSeconds = BestSeconds(
+            [ & ]
+            {
+                vectorSum = 0;
+                for ( const uint32_t i : order )
+                {
+                    const size_t id = i + 1;
+                    vectorSum += id < vector.size( ) ? vector[ id ].Data[ 0 ] : 0;
+                }
+            } );
+        const double mapSeconds = BestSeconds(
+            [ & ]
+            {
+                mapSum = 0;
+                for ( const uint32_t i : order )
+                {
+                    const auto it = map.find( i + 1 );
+                    mapSum += it != map.end( ) ? it->second : 0;
+                }
+            } );
+        const double slotMapSeconds = BestSeconds(
+            [ & ]
+            {
+                slotMapSum = 0;
+                for ( const uint32_t id : shuffledIds )
+                {
+                    const Payload *payload = slotMap.Find( id );
+                    slotMapSum += payload ? payload->Data[ 0 ] : 0;
+                }
+            } );
+        const uint64_t expectedSum = static_cast<uint64_t>( numHandles ) * ( numHandles - 1 ) / 2;
+        if ( vectorSum != expectedSum || mapSum != expectedSum || slotMapSum != expectedSum )
+        {
+            spdlog::error( "DZPack: Handle lookup mismatch" );
+            return 1;
+        }
+
+        // Every other asset is unloaded and its slot reused, a bare index would now resolve to the replacing asset
+        size_t numReplaced = 0;
+        for ( uint32_t i = 0; i < numHandles; i += 2 )
+        {
+            slotMap.Remove( ids[ i ] );
+            ++numReplaced;
+        }
+        for ( uint32_t i = 0; i < numHandles; i += 2 )
+        {
+            slotMap.Insert( Payload{ { numHandles + i } } );
+        }
+        size_t numStaleResolved = 0;
+        for ( uint32_t i = 0; i < numHandles; i += 2 )
+        {
+            numStaleResolved += slotMap.Contains( ids[ i ] );
+        }
+
+        const double perHandle = 1000000000.0 / static_cast<double>( numHandles );
+        spdlog::info( "DZPack: {} handles, {} bytes per value", numHandles, sizeof( Payload ) );
+        spdlog::info( "DZPack: lookup vector {:.1f} ns, unordered_map {:.1f} ns, slot map {:.1f} ns", vectorSeconds * perHandle, mapSeconds * perHandle,
+                      slotMapSeconds * perHandle );
+        spdlog::info( "DZPack: {} assets replaced, {} of their stale handles still resolve", numReplaced, numStaleResolved );
+        return numStaleResolved == 0 ? 0 : 1;
+    }
+
+    // LOD chains of the standard shapes, the sphere, cylinder, cone and torus have a UV seam and the cylinder and cone have hard edged caps
+    int Lod( const int argc, char **argv )
+    {
+        const size_t tessellation = argc > 2 ? std::max<size_t>( 3, std::strtoull( argv[ 2 ], nullptr, 10 ) ) : 128;
+        const auto   buildDesc    = BuildDesc::BuildNormal | BuildDesc::BuildTexCoord;
+
+        std::vector<std::pair<const char *, std::unique_ptr<GeometryData>>> shapes;
+        shapes.emplace_back( "sphere", Geometry::BuildSphere( SphereDesc{ buildDesc, 1.0f, tessellation } ) );
+        shapes.emplace_back( "geosphere", Geometry::BuildGeoSphere( GeoSphereDesc{ buildDesc, 1.0f, std::max<size_t>( 1, tessellation / 32 ) } ) );
+        shapes.emplace_back( "cylinder", Geometry::BuildCylinder( CylinderDesc{ buildDesc, 1.0f, 1.0f, tessellation } ) );
+        shapes.emplace_back( "cone", Geometry::BuildCone( ConeDesc{ buildDesc, 1.0f, 1.0f, tessellation } ) );
+        shapes.emplace_back( "torus", Geometry::BuildTorus( TorusDesc{ buildDesc, 1.0f, 0.33f, tessellation } ) );
+
+        MeshLODChainDesc chainDesc{ };
+        chainDesc.NumLevels = 6;
+        for ( const auto &[ name, geometry ] : shapes )
+        {
+            MeshSimplifierDesc desc{ };
+            desc.Positions      = &geometry->Vertices.Elements[ 0 ].Position.X;
+            desc.PositionStride = sizeof( GeometryVertexData );
+            desc.NumVertices    = geometry->Vertices.NumElements;
+            desc.Indices        = std::span( geometry->Indices.Elements, geometry->Indices.NumElements );
+
+            std::vector<MeshLODLevel> levels;
+            const double              seconds      = BestSeconds( [ & ] { levels = MeshSimplifier::BuildLODChain( desc, chainDesc ); } );
+            const size_t              numTriangles = desc.Indices.size( ) / 3;
+            spdlog::info( "DZPack: {:<9} {} vertices, {} triangles, chain in {:.2f} ms", name, desc.NumVertices, numTriangles, seconds * 1000.0 );
+            for ( size_t level = 0; level < levels.size( ); ++level )
+            {
+                const size_t levelTriangles = levels[ level ].Indices.size( ) / 3;
+                spdlog::info( "DZPack:   LOD{} {:>7} triangles {:>6.2f}%, error {:.5f} ({:.3f}% of the diameter)", level + 1, levelTriangles,
+                              100.0 * static_cast<double>( levelTriangles ) / static_cast<double>( numTriangles ), levels[ level ].Error, levels[ level ].Error * 100.0f );
+            }
+        }
+        return 0;
+    }
+
+    // Vertex cache, overdraw and vertex fetch of the standard shapes, in the order they are generated and with their triangles shuffled like an
+    // unoptimized export, before and after MeshOptimizer::Optimize
+    int Optimize( const int argc, char **argv )
+    {
+        const size_t tessellation = argc > 2 ? std::max<size_t>( 3, std::strtoull( argv[ 2 ], nullptr, 10 ) ) : 128;
+        const auto   buildDesc    = BuildDesc::BuildNormal | BuildDesc::BuildTexCoord;
+
+        std::vector<std::pair<const char *, std::unique_ptr<GeometryData>>> shapes;
+        shapes.emplace_back( "sphere", Geometry::BuildSphere( SphereDesc{ buildDesc, 1.0f, tessellation } ) );
+        shapes.emplace_back( "geosphere", Geometry::BuildGeoSphere( GeoSphereDesc{ buildDesc, 1.0f, std::max<size_t>( 1, tessellation / 32 ) } ) );
+        shapes.emplace_back( "cylinder", Geometry::BuildCylinder( CylinderDesc{ buildDesc, 1.0f, 1.0f, tessellation } ) );
+        shapes.emplace_back( "cone", Geometry::BuildCone( ConeDesc{ buildDesc, 1.0f, 1.0f, tessellation } ) );
+        shapes.emplace_back( "torus", Geometry::BuildTorus( TorusDesc{ buildDesc, 1.0f, 0.33f, tessellation } ) );
+
+        constexpr size_t vertexStride = sizeof( GeometryVertexData );
+        const auto       report       = []( const std::string &label, const std::vector<GeometryVertexData> &vertices, const std::vector<uint32_t> &indices )
+        {
+            const auto                *bytes    = reinterpret_cast<const Byte *>( vertices.data( ) );
+            const MeshVertexCacheStats cache    = MeshOptimizer::AnalyzeVertexCache( indices, vertices.size( ) );
+            const MeshOverdrawStats    overdraw = MeshOptimizer::AnalyzeOverdraw( indices, bytes, vertices.size( ), vertexStride );
+            const MeshVertexFetchStats fetch    = MeshOptimizer::AnalyzeVertexFetch( indices, vertices.size( ), vertexStride );
+            spdlog::info( "DZPack:   {:<18} {:>7} vertices, ACMR {:.3f}, ATVR {:.3f}, overdraw {:.3f}, overfetch {:.3f}", label, vertices.size( ), cache.ACMR, cache.ATVR,
+                          overdraw.Overdraw, fetch.Overfetch );
+        };
+
+        std::mt19937 random( 1 );
+        for ( const auto &[ name, geometry ] : shapes )
+        {
+            const std::vector<GeometryVertexData> generatedVertices( geometry->Vertices.Elements, geometry->Vertices.Elements + geometry->Vertices.NumElements );
+            const std::vector<uint32_t>           generatedIndices( geometry->Indices.Elements, geometry->Indices.Elements + geometry->Indices.NumElements );
+            spdlog::info( "DZPack: {}, {} triangles", name, generatedIndices.size( ) / 3 );
+
+            std::vector<uint32_t> triangles( generatedIndices.size( ) / 3 );
+            std::iota( triangles.begin( ), triangles.end( ), 0u );
+            std::ranges::shuffle( triangles, random );
+            std::vector<uint32_t> shuffledIndices;
+            for ( const uint32_t triangle : triangles )
+            {
+                shuffledIndices.insert( shuffledIndices.end( ), generatedIndices.begin( ) + triangle * 3, generatedIndices.begin( ) + triangle * 3 + 3 );
+            }
+
+            for ( const auto &[ order, sourceIndices ] : { std::pair{ "generated", &generatedIndices }, std::pair{ "shuffled", &std::as_const( shuffledIndices ) } } )
+            {
+                std::vector<GeometryVertexData> vertices = generatedVertices;
+                std::vector<uint32_t>           indices  = *sourceIndices;
+                report( order, vertices, indices );
+
+                size_t       numVertices = 0;
+                const double seconds     = BestSeconds(
+                    [ & ]
+                    {
+                        vertices    = generatedVertices;
+                        indices     = *sourceIndices;
+                        numVertices = MeshOptimizer::Optimize( reinterpret_cast<Byte *>( vertices.data( ) ), vertices.size( ), vertexStride, indices );
+                    } );
+                vertices.resize( numVertices );
+                report( fmt::format( "{} optimized", order ), vertices, indices );
+                spdlog::info( "DZPack:   optimized in {:.2f} ms", seconds * 1000.0 );
+            }
+        }
+        return 0;
+    }
+} // namespace
+
+int main( const int argc, char **argv )
+{
+    const std::string command = argc > 1 ? argv[ 1 ] : "";
+    if ( command == "build" && argc > 3 )
+    {
+        return Build( argc, argv );
+    }
+    if ( command == "bench" && argc > 3 )
+    {
+        return Bench( argv );
+    }
+    if ( command == "cache" && argc > 2 )
+    {
+        return CacheBench( argc, argv );
+    }
+    if ( command == "codecs" && argc > 2 )
+    {
+        return Codecs( argc, argv );
+    }
+    if ( command == "io" && argc > 2 )
+    {
+        return Io( argc, argv );
+    }
+    if ( command == "registry" )
+    {
+        return Registry( argc, argv );
+    }
+    if ( command == "handles" )
+    {
+        return Handles( argc, argv );
+    }
+    if ( command == "lod" )
+    {
+        return Lod( argc, argv );
+    }
+    if ( command == "optimize" )
+    {
+        return Optimize( argc, argv );
+    }
+    return PrintUsage( );
+}
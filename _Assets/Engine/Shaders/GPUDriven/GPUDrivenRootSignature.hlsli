@@ -33,11 +33,13 @@ struct GPUMeshData
     uint IndexCount;
     uint VertexCount;
     float3 AABBMin;
-    float Padding0;
+    uint VertexFormat;
     float3 AABBMax;
-    float Padding1;
+    uint PositionStream;
 };
 
+#define MAX_SHADOW_CASCADES 4
+
 struct GPUGlobalData
 {
     float4x4 ViewMatrix;
@@ -48,6 +50,44 @@ struct GPUGlobalData
     float2 ScreenSize;
     float Time;
     float DeltaTime;
+    uint NumDirectionalLights;
+    uint NumClustersX;
+    uint NumClustersY;
+    uint NumClustersZ;
+    float ClusterDepthScale;
+    float ClusterDepthBias;
+    float ClusterNear;
+    float ClusterFar;
+    float4x4 CascadeViewProj[MAX_SHADOW_CASCADES];
+    float4 CascadeSplits;
+    float4 CascadeTexelSizes;
+    uint NumShadowCascades;
+    uint ShadowMapResolution;
+    float ShadowDepthBias;
+    float ShadowNormalBias;
+};
+
+#define LIGHT_TYPE_DIRECTIONAL 0
+#define LIGHT_TYPE_POINT 1
+#define LIGHT_TYPE_SPOT 2
+
+struct GPULightData
+{
+    float3 Position;
+    float Range;
+    float3 Direction;
+    uint Type;
+    float3 Color;
+    float Intensity;
+    float SpotCosOuter;
+    float SpotCosInner;
+    float2 Padding;
+};
+
+struct GPULightCluster
+{
+    uint Offset;
+    uint Count;
 };
 
 struct GPUInstanceData
@@ -66,6 +106,19 @@ struct Vertex
     float4 Tangent;
 };
 
+#define VERTEX_FORMAT_FULL 0
+#define VERTEX_FORMAT_COMPACT 1
+
+struct CompactVertex
+{
+    uint PositionXY; // unorm16 x2, relative to GPUMeshData AABB
+    uint PositionZW; // unorm16 z, bit 16 is the tangent handedness
+    uint Normal; // Octahedral snorm16 x2
+    uint Tangent; // Octahedral snorm16 x2
+    uint TexCoord; // half x2
+    uint Color; // RGBA8
+};
+
 struct DrawIndirectCommand
 {
     uint VertexCountPerInstance;
@@ -83,6 +136,12 @@ struct DrawIndexedIndirectCommand
     uint FirstInstance;
 };
 
+struct ShadowPassConstants
+{
+    uint CascadeIndex;
+    uint3 Padding;
+};
+
 struct DrawArguments
 {
     uint MeshID;
@@ -104,7 +163,73 @@ StructuredBuffer<GPUInstanceData> g_InstanceBuffer : register(t3, space1);
 StructuredBuffer<Vertex> g_VertexBuffer : register(t4, space1);
 StructuredBuffer<uint> g_IndexBuffer : register(t5, space1);
 StructuredBuffer<DrawArguments> g_DrawArgsBuffer : register(t6, space1);
+StructuredBuffer<GPULightData> g_LightBuffer : register(t7, space1); // [directional lights | clustered lights]
+StructuredBuffer<GPULightCluster> g_LightClusterBuffer : register(t8, space1);
+StructuredBuffer<uint> g_LightIndexBuffer : register(t9, space1);
+Texture2D<float> g_ShadowMap : register(t10, space1); // Cascades laid out horizontally
+StructuredBuffer<CompactVertex> g_CompactVertexBuffer : register(t11, space1); // Same buffer as g_VertexBuffer
+StructuredBuffer<float4> g_PositionBuffer : register(t12, space1); // Position only stream, indexed like g_VertexBuffer
+StructuredBuffer<uint2> g_CompactPositionBuffer : register(t13, space1); // Same buffer as g_PositionBuffer
+
+ConstantBuffer<ShadowPassConstants> g_ShadowPassConstants : register(b0, space31); // Root constants, only set by the shadow pass
 
 SamplerState g_LinearSampler : register(s0, space2);
 SamplerState g_PointSampler : register(s1, space2);
-SamplerState g_AnisotropicSampler : register(s2, space2);
\ No newline at end of file
+SamplerState g_AnisotropicSampler : register(s2, space2);
+
+float2 UnpackSnorm16x2(uint packed)
+{
+    int2 values = int2(int(packed << 16) >> 16, int(packed) >> 16);
+    return max(float2(values) / 32767.0, -1.0);
+}
+
+float3 DecodeOctahedral(uint packed)
+{
+    float2 encoded = UnpackSnorm16x2(packed);
+    float3 direction = float3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+    float t = max(-direction.z, 0.0);
+    direction.x += direction.x >= 0.0 ? -t : t;
+    direction.y += direction.y >= 0.0 ? -t : t;
+    return normalize(direction);
+}
+
+float4 DecodeCompactPosition(uint positionXY, uint positionZW, GPUMeshData meshData)
+{
+    float3 positionT = float3(positionXY & 0xFFFF, positionXY >> 16, positionZW & 0xFFFF) / 65535.0;
+    return float4(meshData.AABBMin + positionT * (meshData.AABBMax - meshData.AABBMin), 1.0);
+}
+
+Vertex DecodeCompactVertex(CompactVertex compact, GPUMeshData meshData)
+{
+    Vertex vertex;
+    vertex.Position = DecodeCompactPosition(compact.PositionXY, compact.PositionZW, meshData);
+    vertex.Normal = float4(DecodeOctahedral(compact.Normal), 0.0);
+    vertex.Tangent = float4(DecodeOctahedral(compact.Tangent), ((compact.PositionZW >> 16) & 1) != 0 ? -1.0 : 1.0);
+    vertex.TexCoord = f16tof32(uint2(compact.TexCoord & 0xFFFF, compact.TexCoord >> 16));
+    vertex.Color = float4(compact.Color & 0xFF, (compact.Color >> 8) & 0xFF, (compact.Color >> 16) & 0xFF, compact.Color >> 24) / 255.0;
+    return vertex;
+}
+
+Vertex FetchVertex(GPUMeshData meshData, uint index)
+{
+    if (meshData.VertexFormat == VERTEX_FORMAT_COMPACT)
+    {
+        return DecodeCompactVertex(g_CompactVertexBuffer[index], meshData);
+    }
+    return g_VertexBuffer[index];
+}
+
+// Depth only passes, reads the position only stream when the batch has one
+float4 FetchPosition(GPUMeshData meshData, uint index)
+{
+    if (meshData.PositionStream == 0)
+    {
+        return FetchVertex(meshData, index).Position;
+    }
+    if (meshData.VertexFormat == VERTEX_FORMAT_COMPACT)
+    {
+        uint2 packed = g_CompactPositionBuffer[index];
+        return DecodeCompactPosition(packed.x, packed.y, meshData);
+    }
+    return g_PositionBuffer[index];
+}
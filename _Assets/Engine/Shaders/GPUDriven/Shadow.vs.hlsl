@@ -0,0 +1,16 @@
+#include "GPUDrivenRootSignature.hlsli"
+
+float4 VSMain(uint vertexID : SV_VertexID, uint instanceID : SV_InstanceID) : SV_POSITION
+{
+    GPUInstanceData instanceData = g_InstanceBuffer[instanceID];
+    GPUObjectData objectData = g_ObjectBuffer[instanceData.ObjectID];
+    GPUMeshData meshData = g_MeshBuffer[objectData.MeshID];
+
+    float4 position = FetchPosition(meshData, meshData.VertexOffset + vertexID);
+
+    float4 worldPos = mul(position, objectData.ModelMatrix);
+    float4 clipPos = mul(worldPos, g_GlobalData.CascadeViewProj[g_ShadowPassConstants.CascadeIndex]);
+    // Casters between the light and the cascade volume are flattened onto the near plane instead of being clipped
+    clipPos.z = max(clipPos.z, 0.0);
+    return clipPos;
+}
@@ -35,6 +35,92 @@ float3 GetNormalFromMap(float3 normal, float4 tangent, float2 uv, uint normalTex
     return normalize(mul(tangentNormal, TBN));
 }
 
+float3 EvaluateBRDF(float3 normal, float3 V, float3 L, float3 baseColor, float metallic, float roughness)
+{
+    float3 H = normalize(V + L);
+    float NdotL = max(dot(normal, L), 0.0);
+    float NdotV = max(dot(normal, V), 0.0);
+    float NdotH = max(dot(normal, H), 0.0);
+    float VdotH = max(dot(V, H), 0.0);
+
+    float D = ((roughness * roughness) / (3.14159265 * pow(NdotH * NdotH * (roughness * roughness - 1.0) + 1.0, 2.0)));
+    float G_V = NdotV / (NdotV * (1.0 - roughness * 0.5) + roughness * 0.5);
+    float G_L = NdotL / (NdotL * (1.0 - roughness * 0.5) + roughness * 0.5);
+    float G = G_V * G_L;
+    float3 F0 = lerp(float3(0.04, 0.04, 0.04), baseColor, metallic);
+    float3 F = F0 + (1.0 - F0) * pow(1.0 - VdotH, 5.0);
+
+    float3 specular = D * G * F / (4.0 * NdotV * NdotL + 0.001);
+    float3 diffuse = baseColor * (1.0 - metallic) / 3.14159265;
+    return (diffuse + specular) * NdotL;
+}
+
+float3 EvaluateLocalLight(GPULightData light, float3 worldPos, float3 normal, float3 V, float3 baseColor, float metallic, float roughness)
+{
+    float3 toLight = light.Position - worldPos;
+    float distanceSq = dot(toLight, toLight);
+    float3 L = toLight * rsqrt(max(distanceSq, 0.0001));
+
+    float rangeFactor = distanceSq / (light.Range * light.Range);
+    float attenuation = saturate(1.0 - rangeFactor * rangeFactor);
+    attenuation = attenuation * attenuation / (distanceSq + 1.0);
+    if (light.Type == LIGHT_TYPE_SPOT)
+    {
+        attenuation *= smoothstep(light.SpotCosOuter, light.SpotCosInner, dot(-L, light.Direction));
+    }
+    return EvaluateBRDF(normal, V, L, baseColor, metallic, roughness) * light.Color * light.Intensity * attenuation;
+}
+
+uint GetClusterIndex(float3 worldPos)
+{
+    float4 clipPos = mul(float4(worldPos, 1.0), g_GlobalData.ViewProjMatrix);
+    float2 ndc = clipPos.xy / clipPos.w;
+    // clip w is the view space depth for a perspective projection
+    uint slice = (uint) clamp(log(clipPos.w) * g_GlobalData.ClusterDepthScale + g_GlobalData.ClusterDepthBias, 0.0, g_GlobalData.NumClustersZ - 1);
+    uint x = (uint) clamp((ndc.x * 0.5 + 0.5) * g_GlobalData.NumClustersX, 0.0, g_GlobalData.NumClustersX - 1);
+    uint y = (uint) clamp((0.5 - ndc.y * 0.5) * g_GlobalData.NumClustersY, 0.0, g_GlobalData.NumClustersY - 1);
+    return x + g_GlobalData.NumClustersX * (y + g_GlobalData.NumClustersY * slice);
+}
+
+float SampleShadow(float3 worldPos, float3 normal)
+{
+    float viewDepth = mul(float4(worldPos, 1.0), g_GlobalData.ViewProjMatrix).w;
+    uint cascade = 0;
+    while (cascade + 1 < g_GlobalData.NumShadowCascades && viewDepth > g_GlobalData.CascadeSplits[cascade])
+    {
+        ++cascade;
+    }
+    if (viewDepth > g_GlobalData.CascadeSplits[cascade])
+    {
+        return 1.0;
+    }
+
+    float3 offsetPos = worldPos + normal * g_GlobalData.CascadeTexelSizes[cascade] * g_GlobalData.ShadowNormalBias;
+    float4 shadowPos = mul(float4(offsetPos, 1.0), g_GlobalData.CascadeViewProj[cascade]);
+    float2 uv = float2(shadowPos.x * 0.5 + 0.5, 0.5 - shadowPos.y * 0.5);
+    if (any(uv < 0.0) || any(uv > 1.0))
+    {
+        return 1.0;
+    }
+
+    // Cascades are laid out horizontally in the atlas, clamp the PCF taps to the cascade's tile
+    int resolution = (int) g_GlobalData.ShadowMapResolution;
+    int tileMin = (int) cascade * resolution;
+    int2 center = int2(tileMin + (int) (uv.x * resolution), (int) (uv.y * resolution));
+    float depth = shadowPos.z - g_GlobalData.ShadowDepthBias;
+
+    float lit = 0.0;
+    for (int y = -1; y <= 1; ++y)
+    {
+        for (int x = -1; x <= 1; ++x)
+        {
+            int2 coord = int2(clamp(center.x + x, tileMin, tileMin + resolution - 1), clamp(center.y + y, 0, resolution - 1));
+            lit += depth <= g_ShadowMap.Load(int3(coord, 0)) ? 1.0 : 0.0;
+        }
+    }
+    return lit / 9.0;
+}
+
 PSOutput PSMain(VSOutput input)
 {
     GPUMaterialData material = g_MaterialBuffer[input.MaterialID];
@@ -74,24 +160,30 @@ PSOutput PSMain(VSOutput input)
     }
     
     float3 V = normalize(g_GlobalData.CameraPosition.xyz - input.WorldPos);
-    float3 L = normalize(float3(1, 1, 1));
-    float3 H = normalize(V + L);
-    float NdotL = max(dot(normal, L), 0.0);
-    float NdotV = max(dot(normal, V), 0.0);
-    float NdotH = max(dot(normal, H), 0.0);
-    float VdotH = max(dot(V, H), 0.0);
-    
-    float D = ((roughness * roughness) / (3.14159265 * pow(NdotH * NdotH * (roughness * roughness - 1.0) + 1.0, 2.0)));
-    float G_V = NdotV / (NdotV * (1.0 - roughness * 0.5) + roughness * 0.5);
-    float G_L = NdotL / (NdotL * (1.0 - roughness * 0.5) + roughness * 0.5);
-    float G = G_V * G_L;
-    float3 F0 = lerp(float3(0.04, 0.04, 0.04), baseColor.rgb, metallic);
-    float3 F = F0 + (1.0 - F0) * pow(1.0 - VdotH, 5.0);
-    
-    float3 specular = D * G * F / (4.0 * NdotV * NdotL + 0.001);
-    float3 diffuse = baseColor.rgb * (1.0 - metallic) / 3.14159265;
-    
-    float3 color = emissive + (diffuse + specular) * NdotL * occlusion;
+    float3 lighting = float3(0.0, 0.0, 0.0);
+    for (uint i = 0; i < g_GlobalData.NumDirectionalLights; ++i)
+    {
+        GPULightData light = g_LightBuffer[i];
+        float shadow = 1.0;
+        // Only the first directional light casts shadows
+        if (i == 0 && g_GlobalData.NumShadowCascades > 0 && (g_ObjectBuffer[input.ObjectID].Flags & 2) != 0)
+        {
+            shadow = SampleShadow(input.WorldPos, normalize(input.Normal));
+        }
+        lighting += EvaluateBRDF(normal, V, -light.Direction, baseColor.rgb, metallic, roughness) * light.Color * light.Intensity * shadow;
+    }
+
+    if (g_GlobalData.NumClustersZ > 0)
+    {
+        GPULightCluster cluster = g_LightClusterBuffer[GetClusterIndex(input.WorldPos)];
+        for (uint j = 0; j < cluster.Count; ++j)
+        {
+            GPULightData light = g_LightBuffer[g_GlobalData.NumDirectionalLights + g_LightIndexBuffer[cluster.Offset + j]];
+            lighting += EvaluateLocalLight(light, input.WorldPos, normal, V, baseColor.rgb, metallic, roughness);
+        }
+    }
+
+    float3 color = emissive + lighting * occlusion;
     
     PSOutput output;
     output.Color = float4(color, baseColor.a);